@@ -0,0 +1,266 @@
+/**
+ * @file bench.c
+ * @brief Request/response microbenchmarks of the server and client over the mock transport
+ * @details Every iteration sends one request with UDSSendBytes and polls the client and the
+ * server until the client is idle again. Time is virtual: UDSMillis() advances by one millisecond
+ * per poll so that timers never stall a request, and the server's p2 pacing is disabled. Only the
+ * wall clock time spent in the library is measured.
+ *
+ * Usage: bench [--json FILE] [--filter NAME] [--min-time-ms MS]
+ */
+#include "src/iso14229.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define NUM_DIDS 32
+#define NUM_DTCS 64
+#define DID_LEN 4
+
+static uint32_t now_ms;
+uint32_t UDSMillis(void) { return now_ms; }
+
+typedef struct {
+    UDSServer_t srv;
+    UDSClient_t client;
+    uint16_t blockLength; /* maxNumberOfBlockLength returned to 0x34 */
+} Bench_t;
+
+typedef struct {
+    const char *name;
+    uint64_t iterations;
+    double ns_per_request;
+    double bytes_per_second; /* request and response bytes */
+} Result_t;
+
+static uint64_t NowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static UDSErr_t ServerFn(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    Bench_t *b = (Bench_t *)srv->fn_data;
+    switch (ev) {
+    case UDS_EVT_ReadDataByIdent: {
+        UDSRDBIArgs_t *r = (UDSRDBIArgs_t *)arg;
+        const uint8_t value[DID_LEN] = {(uint8_t)(r->dataId >> 8), (uint8_t)r->dataId, 0xA5, 0x5A};
+        return r->copy(srv, value, sizeof(value));
+    }
+    case UDS_EVT_ReadDTCInformation: {
+        UDSRDTCIArgs_t *r = (UDSRDTCIArgs_t *)arg;
+        if (0x02 != r->type) {
+            return UDS_NRC_SubFunctionNotSupported;
+        }
+        uint8_t availability = 0xFF;
+        uint8_t err = r->copy(srv, &availability, 1);
+        for (int i = 0; UDS_PositiveResponse == err && i < NUM_DTCS; i++) {
+            const uint8_t record[4] = {0x12, (uint8_t)(i >> 8), (uint8_t)i, 0x09};
+            if (record[3] & r->subFuncArgs.dtcStatusByMaskArgs.mask) {
+                err = r->copy(srv, record, sizeof(record));
+            }
+        }
+        return err;
+    }
+    case UDS_EVT_RequestDownload: {
+        UDSRequestDownloadArgs_t *r = (UDSRequestDownloadArgs_t *)arg;
+        r->maxNumberOfBlockLength = b->blockLength;
+        return UDS_PositiveResponse;
+    }
+    case UDS_EVT_TransferData:
+    case UDS_EVT_RequestTransferExit:
+        return UDS_PositiveResponse;
+    default:
+        return UDS_PositiveResponse;
+    }
+}
+
+static int ClientFn(UDSClient_t *client, UDSEvent_t evt, void *ev_data) {
+    (void)client;
+    (void)evt;
+    (void)ev_data;
+    return UDS_OK;
+}
+
+static void BenchInit(Bench_t *b) {
+    memset(b, 0, sizeof(*b));
+    UDSServerInit(&b->srv);
+    b->srv.fn = ServerFn;
+    b->srv.fn_data = b;
+    b->srv.tp = ISOTPMockNew("server", &(ISOTPMockArgs_t){.sa_phys = 0x7E8,
+                                                          .ta_phys = 0x7E0,
+                                                          .sa_func = 0x7DF,
+                                                          .ta_func = UDS_TP_NOOP_ADDR});
+    UDSClientInit(&b->client);
+    b->client.fn = ClientFn;
+    b->client.tp = ISOTPMockNew("client", &(ISOTPMockArgs_t){.sa_phys = 0x7E0,
+                                                             .ta_phys = 0x7E8,
+                                                             .sa_func = UDS_TP_NOOP_ADDR,
+                                                             .ta_func = 0x7DF});
+}
+
+static void BenchFree(Bench_t *b) {
+    ISOTPMockFree(b->srv.tp);
+    ISOTPMockFree(b->client.tp);
+    ISOTPMockReset();
+}
+
+/**
+ * @brief Send one request and poll until it is answered
+ * @return length of the positive response, or -1
+ */
+static int Exchange(Bench_t *b, const uint8_t *req, uint16_t len) {
+    // the server would otherwise hold each response until p2 has passed since the last one
+    b->srv.p2_ms = 0;
+    if (UDSSendBytes(&b->client, req, len)) {
+        return -1;
+    }
+    for (int polls = 0; polls < 1000; polls++) {
+        UDSServerPoll(&b->srv);
+        UDSErr_t err = UDSClientPoll(&b->client);
+        now_ms++;
+        if (err) {
+            return -1;
+        }
+        if (0 == b->client.state) {
+            return b->client.recv_size;
+        }
+    }
+    return -1;
+}
+
+typedef struct {
+    const char *name;
+    uint8_t req[UDS_TP_MTU];
+    uint16_t len;
+    uint16_t blockLength; /* 0x36 only: block size, including the two header bytes */
+} Case_t;
+
+static int StartDownload(Bench_t *b, uint16_t blockLength) {
+    const uint8_t req[] = {0x34, 0x00, 0x44, 0x00, 0x00, 0x00, 0x00, 0x7F, 0xFF, 0xFF, 0xFF};
+    b->blockLength = blockLength;
+    return Exchange(b, req, sizeof(req)) > 0 ? 0 : -1;
+}
+
+static int RunCase(Case_t *c, uint32_t min_time_ms, Result_t *result) {
+    static Bench_t b;
+    BenchInit(&b);
+    if (c->blockLength && StartDownload(&b, c->blockLength)) {
+        BenchFree(&b);
+        return -1;
+    }
+
+    uint64_t iterations = 0;
+    uint64_t bytes = 0;
+    uint64_t elapsed = 0;
+    uint64_t batch = 64;
+    while (elapsed < (uint64_t)min_time_ms * 1000000ULL) {
+        uint64_t start = NowNs();
+        for (uint64_t i = 0; i < batch; i++) {
+            if (c->blockLength) {
+                c->req[1]++; // blockSequenceCounter
+            }
+            int resp_len = Exchange(&b, c->req, c->len);
+            if (resp_len <= 0) {
+                (void)fprintf(stderr, "%s: request failed\n", c->name);
+                BenchFree(&b);
+                return -1;
+            }
+            bytes += (uint64_t)c->len + (uint64_t)resp_len;
+        }
+        elapsed += NowNs() - start;
+        iterations += batch;
+        batch *= 2;
+    }
+    BenchFree(&b);
+
+    result->name = c->name;
+    result->iterations = iterations;
+    result->ns_per_request = (double)elapsed / (double)iterations;
+    result->bytes_per_second = (double)bytes * 1e9 / (double)elapsed;
+    return 0;
+}
+
+static void WriteJSON(FILE *f, const Result_t *results, int n) {
+    (void)fprintf(f, "{\n  \"context\": {\"library\": \"iso14229\", \"version\": \"%s\"},\n",
+                  UDS_LIB_VERSION);
+    (void)fprintf(f, "  \"benchmarks\": [\n");
+    for (int i = 0; i < n; i++) {
+        (void)fprintf(f,
+                      "    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_request\": %.1f, "
+                      "\"bytes_per_second\": %.0f}%s\n",
+                      results[i].name, (unsigned long long)results[i].iterations,
+                      results[i].ns_per_request, results[i].bytes_per_second,
+                      i + 1 < n ? "," : "");
+    }
+    (void)fprintf(f, "  ]\n}\n");
+}
+
+int main(int ac, char **av) {
+    const char *json_path = NULL;
+    const char *filter = NULL;
+    uint32_t min_time_ms = 200;
+    for (int i = 1; i < ac; i++) {
+        if (0 == strcmp(av[i], "--json") && i + 1 < ac) {
+            json_path = av[++i];
+        } else if (0 == strcmp(av[i], "--filter") && i + 1 < ac) {
+            filter = av[++i];
+        } else if (0 == strcmp(av[i], "--min-time-ms") && i + 1 < ac) {
+            min_time_ms = (uint32_t)strtoul(av[++i], NULL, 0);
+        } else {
+            (void)fprintf(stderr, "usage: %s [--json FILE] [--filter NAME] [--min-time-ms MS]\n",
+                          av[0]);
+            return 2;
+        }
+    }
+
+    static Case_t cases[] = {
+        {.name = "0x3E_TesterPresent", .req = {0x3E, 0x00}, .len = 2},
+        {.name = "0x22_RDBI_1_DID", .req = {0x22, 0xF1, 0x90}, .len = 3},
+        {.name = "0x22_RDBI_32_DIDs", .len = 1 + 2 * NUM_DIDS},
+        {.name = "0x19_ReportDTCByStatusMask", .req = {0x19, 0x02, 0xFF}, .len = 3},
+        {.name = "0x36_TransferData_64", .blockLength = 64},
+        {.name = "0x36_TransferData_512", .blockLength = 512},
+        {.name = "0x36_TransferData_4095", .blockLength = 4095},
+    };
+    const int num_cases = (int)(sizeof(cases) / sizeof(cases[0]));
+    cases[2].req[0] = 0x22;
+    for (int i = 0; i < NUM_DIDS; i++) {
+        cases[2].req[1 + 2 * i] = 0xF1;
+        cases[2].req[2 + 2 * i] = (uint8_t)(0x80 + i);
+    }
+    for (int i = 0; i < num_cases; i++) {
+        if (cases[i].blockLength) {
+            cases[i].req[0] = 0x36;
+            cases[i].len = cases[i].blockLength;
+        }
+    }
+
+    Result_t results[sizeof(cases) / sizeof(cases[0])];
+    int n = 0;
+    printf("%-28s %12s %14s %14s\n", "benchmark", "iterations", "ns/request", "MB/s");
+    for (int i = 0; i < num_cases; i++) {
+        if (filter && NULL == strstr(cases[i].name, filter)) {
+            continue;
+        }
+        if (RunCase(&cases[i], min_time_ms, &results[n])) {
+            return 1;
+        }
+        printf("%-28s %12llu %14.1f %14.2f\n", results[n].name,
+               (unsigned long long)results[n].iterations, results[n].ns_per_request,
+               results[n].bytes_per_second / 1e6);
+        n++;
+    }
+
+    if (json_path) {
+        FILE *f = fopen(json_path, "w");
+        if (NULL == f) {
+            (void)fprintf(stderr, "cannot open %s\n", json_path);
+            return 1;
+        }
+        WriteJSON(f, results, n);
+        (void)fclose(f);
+    }
+    return 0;
+}
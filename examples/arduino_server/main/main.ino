@@ -6,7 +6,7 @@
 static UDSServer_t srv;
 static UDSISOTpC_t tp;
 
-extern "C" uint32_t isotp_user_get_us(void) { return UDSMillis() * 1000; }
+extern "C" uint32_t isotp_user_get_us(void) { return UDSMicros(); }
 
 extern "C" int isotp_user_send_can(uint32_t arb_id, const uint8_t *data, const uint8_t size, void *ud) {
   (void)ud;
@@ -1,6 +1,5 @@
 #include "driver/gpio.h"
 #include "iso14229.h"
-#include <driver/twai.h>
 #include <esp_log.h>
 #include "freertos/task.h"
 
@@ -12,67 +11,33 @@
 
 const char *TAG = "UDS";
 
-static const twai_timing_config_t t_config = TWAI_TIMING_CONFIG_500KBITS();
-static const twai_filter_config_t f_config = TWAI_FILTER_CONFIG_ACCEPT_ALL();
-static const twai_general_config_t g_config = {.mode = TWAI_MODE_NORMAL,
-                                               .tx_io = CAN_TX_PIN,
-                                               .rx_io = CAN_RX_PIN,
-                                               .clkout_io = TWAI_IO_UNUSED,
-                                               .bus_off_io = TWAI_IO_UNUSED,
-                                               .tx_queue_len = 50,
-                                               .rx_queue_len = 50,
-                                               .alerts_enabled =
-                                                   TWAI_ALERT_RX_DATA | TWAI_ALERT_BUS_OFF,
-                                               .clkout_divider = 0,
-                                               .intr_flags = ESP_INTR_FLAG_LEVEL1};
-
 static UDSServer_t srv;
-static UDSISOTpC_t tp;
-
-int isotp_user_send_can(const uint32_t arbitration_id, const uint8_t *data, const uint8_t size,
-                        void *user_data) {
-    (void)user_data;
-    twai_message_t tx_msg;
-    tx_msg.identifier = arbitration_id;
-    tx_msg.data_length_code = size;
-    memmove(tx_msg.data, data, size);
-    if (ESP_OK == twai_transmit(&tx_msg, 0)) {
-        return size;
-    } else {
-        return -1;
-    }
-}
+static UDSTpESP32TWAI_t tp;
 
-void isotp_user_debug(const char *fmt, ...) { (void)fmt; }
-
-uint32_t isotp_user_get_us(void) { return UDSMillis() * 1000; }
-
-static const UDSISOTpCConfig_t tp_cfg = {
-    .source_addr = 0x7E0,
-    .target_addr = 0x7E8,
-    .source_addr_func = 0x7DF,
-    .target_addr_func = UDS_TP_NOOP_ADDR,
+// TWAI is a classic CAN controller, so the links keep the default 8 byte TX_DL
+static const UDSTpESP32TWAIConfig_t tp_cfg = {
+    .isotp =
+        {
+            .source_addr = 0x7E0,
+            .target_addr = 0x7E8,
+            .source_addr_func = 0x7DF,
+            .target_addr_func = UDS_TP_NOOP_ADDR,
+        },
+    .tx_io = CAN_TX_PIN,
+    .rx_io = CAN_RX_PIN,
+    .timing = TWAI_TIMING_CONFIG_500KBITS(),
+    .tx_queue_len = 50,
+    .rx_queue_len = 50,
+    .rx_core = 0,
+    .rx_priority = 6, // above uds_task
 };
 
 static void uds_task(void *arg) {
     (void)arg;
     ESP_LOGI(TAG, "starting...");
     for (;;) {
-        twai_message_t rx_msg;
-        if (twai_receive(&rx_msg, pdMS_TO_TICKS(10)) == ESP_OK) {
-            if (rx_msg.identifier == tp.phys_sa) {
-                isotp_on_can_message(&tp.phys_link, rx_msg.data, rx_msg.data_length_code);
-            } else if (rx_msg.identifier == tp.func_sa) {
-                if (ISOTP_RECEIVE_STATUS_IDLE != tp.phys_link.receive_status) {
-                    ESP_LOGI(TAG,
-                             "func frame received but cannot process because link is not idle");
-                    continue;
-                }
-                isotp_on_can_message(&tp.func_link, rx_msg.data, rx_msg.data_length_code);
-            } else {
-                ESP_LOGI(TAG, "received unknown can id 0x%03lx", rx_msg.identifier);
-            }
-        }
+        // sleeps until the RX task has moved a batch of frames into the transport's ring
+        UDSTpESP32TWAIWait(&tp, pdMS_TO_TICKS(10));
         UDSServerPoll(&srv);
     }
 }
@@ -103,9 +68,6 @@ static UDSErr_t fn(UDSServer_t *srv, UDSEvent_t evt, void *data) {
 }
 
 void app_main(void) {
-    ESP_ERROR_CHECK(twai_driver_install(&g_config, &t_config, &f_config));
-    ESP_ERROR_CHECK(twai_start());
-
     gpio_config_t io_conf;
     io_conf.intr_type = GPIO_INTR_DISABLE;
     io_conf.mode = GPIO_MODE_OUTPUT;
@@ -115,9 +77,9 @@ void app_main(void) {
     gpio_config(&io_conf);
 
     ESP_ERROR_CHECK(UDSServerInit(&srv));
-    ESP_ERROR_CHECK(UDSISOTpCInit(&tp, &tp_cfg));
+    ESP_ERROR_CHECK(UDSTpESP32TWAIInit(&tp, &tp_cfg));
     srv.fn = fn;
-    srv.tp = &tp.hdl;
+    srv.tp = &tp.isotp.hdl;
 
     xTaskCreate(uds_task, "uds_task", 4096, NULL, 5, NULL);
 }
@@ -0,0 +1 @@
+../../iso14229.c
\ No newline at end of file
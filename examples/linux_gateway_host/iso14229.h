@@ -0,0 +1 @@
+../../iso14229.h
\ No newline at end of file
@@ -0,0 +1,76 @@
+/**
+ * @file examples/linux_gateway_host/main.c
+ * @brief Many UDS servers on a few epoll-driven worker threads
+ */
+#include "iso14229.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+
+#define NUM_SERVERS 8
+#define NUM_WORKERS 2
+
+static UDSServer_t srvs[NUM_SERVERS];
+static UDSTpIsoTpSock_t tps[NUM_SERVERS];
+static UDSHostServer_t hosted[NUM_SERVERS];
+static UDSHost_t host;
+static volatile sig_atomic_t done = 0;
+
+void sigint_handler(int signum) { done = 1; }
+
+static UDSErr_t fn(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    // called from the worker thread of this server only
+    int idx = (int)(srv - srvs);
+    switch (ev) {
+    case UDS_EVT_SessionTimeout:
+        printf("server %d: session timeout\n", idx);
+        return UDS_OK;
+    default:
+        printf("server %d: unhandled event: %d\n", idx, ev);
+        return UDS_NRC_ServiceNotSupported;
+    }
+}
+
+int main(int ac, char **av) {
+    const char *ifname = ac > 1 ? av[1] : "vcan0";
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = sigint_handler;
+    sigaction(SIGINT, &sa, NULL);
+
+    // 1. Initialize the servers and their transports
+    for (int i = 0; i < NUM_SERVERS; i++) {
+        if (UDSTpIsoTpSockInitServer(&tps[i], ifname, 0x7E0 + i, 0x7E8 + i, 0x7DF)) {
+            fprintf(stderr, "UDSTpIsoTpSockInitServer failed for server %d\n", i);
+            exit(-1);
+        }
+        if (UDSServerInit(&srvs[i])) {
+            fprintf(stderr, "UDSServerInit failed\n");
+            exit(-1);
+        }
+        srvs[i].fn = fn;
+        hosted[i] = (UDSHostServer_t){.srv = &srvs[i], .tp = &tps[i]};
+    }
+
+    // 2. Hand them to the host, which sets srv.tp and shards them across the workers
+    if (UDSHostInit(&host, hosted, NUM_SERVERS, NUM_WORKERS)) {
+        fprintf(stderr, "UDSHostInit failed\n");
+        exit(-1);
+    }
+    if (UDSHostStart(&host)) {
+        fprintf(stderr, "UDSHostStart failed\n");
+        exit(-1);
+    }
+
+    printf("%d servers up on %d workers\n", NUM_SERVERS, NUM_WORKERS);
+    while (!done) {
+        pause();
+    }
+    printf("host exiting\n");
+    UDSErr_t err = UDSHostStop(&host);
+    for (int i = 0; i < NUM_SERVERS; i++) {
+        UDSTpIsoTpSockDeinit(&tps[i]);
+    }
+    return err ? EXIT_FAILURE : EXIT_SUCCESS;
+}
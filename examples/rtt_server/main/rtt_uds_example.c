@@ -35,8 +35,13 @@ static rt_device_t can_dev = RT_NULL;
 /** @brief Thread ID for the main UDS processing task. */
 static rt_thread_t uds_task_tid = RT_NULL;
 
-/** @brief Message queue for buffering incoming CAN frames from the ISR. */
-static rt_mq_t can_rx_mq = RT_NULL;
+/** @brief Lock-free ring buffering incoming CAN frames from the ISR. */
+static UDSCANRing_t can_rx_ring;
+
+/** @brief Event used by the ISR to wake the UDS task when frames are pending. */
+static rt_event_t can_rx_evt = RT_NULL;
+
+#define CAN_RX_EVT_FRAME (1u << 0)
 
 /** @brief Stores the original CAN RX callback to restore it when the service stops. */
 static rt_err_t (*old_can_rx_indicate)(rt_device_t dev, rt_size_t size) = RT_NULL;
@@ -128,9 +133,7 @@ int isotp_user_send_can(const uint32_t arbitration_id, const uint8_t *data, cons
     return ISOTP_RET_ERROR;
 }
 
-uint32_t isotp_user_get_us(void) {
-    return (uint32_t)((rt_uint64_t)rt_tick_get() * 1000000 / RT_TICK_PER_SECOND);
-}
+uint32_t isotp_user_get_us(void) { return UDSMicros(); }
 
 /**
  * @brief  Platform-specific debug logging function.
@@ -216,9 +219,10 @@ static UDSErr_t server_callback(UDSServer_t *srv, UDSEvent_t evt, void *data) {
 
 /**
  * @brief  CAN device receive interrupt callback (Producer).
- * @details This function is called in an interrupt context whenever a CAN frame is
- *          received. It reads the message and pushes it into a message queue
- *          for deferred processing by the UDS task. This keeps ISR processing minimal.
+ * @details This function is called in an interrupt context whenever CAN frames are
+ *          received. It reads every pending message into the lock-free frame ring and
+ *          wakes the UDS task once. Frames that do not fit are counted in
+ *          can_rx_ring.dropped instead of being logged from the ISR.
  * @param  dev   The device that triggered the interrupt.
  * @param  size  The number of messages ready to be read.
  * @return RT_EOK on success.
@@ -228,49 +232,50 @@ static rt_err_t can_rx_callback(rt_device_t dev, rt_size_t size) {
     // Key: Set hdr_index to -1 to receive messages from any hardware filter bank.
     msg.hdr_index = -1;
 
-    if (rt_device_read(dev, 0, &msg, sizeof(msg)) == sizeof(msg)) {
-        // Send the received message to the queue.
-        if (rt_mq_send(can_rx_mq, &msg, sizeof(struct rt_can_msg)) == -RT_EFULL) {
-            LOG_W("CAN RX message queue is full, message dropped.");
-        }
+    while (rt_device_read(dev, 0, &msg, sizeof(msg)) == sizeof(msg)) {
+        UDSCANRingPush(&can_rx_ring, msg.id, msg.data, msg.len);
     }
+    rt_event_send(can_rx_evt, CAN_RX_EVT_FRAME);
     return RT_EOK;
 }
 
+/**
+ * @brief  Feeds one frame drained from the ring to the ISO-TP links (runs in the UDS task).
+ */
+static void can_rx_frame(void *ctx, const UDSCANFrame_t *frame) {
+#if (DBG_LVL >= DBG_LOG)
+    char title[32];
+    rt_snprintf(title, sizeof(title), "CAN RX ID:0x%X", frame->id);
+    print_hex_data(title, frame->data, frame->len);
+#endif
+    // Routes by CAN ID and drops functional frames while a physical transfer is in progress.
+    UDSISOTpCOnFrame((UDSISOTpC_t *)ctx, frame->id, frame->data, frame->len);
+}
+
 /**
  * @brief  Main UDS processing thread entry point (Consumer).
- * @details This thread waits for incoming CAN messages from the queue, forwards them
- *          to the appropriate ISO-TP link (physical or functional), and periodically
- *          polls the UDS server state machine.
+ * @details This thread sleeps until the ISR signals new frames, drains every pending
+ *          frame from the ring in one batch into the ISO-TP links, and polls the UDS
+ *          server state machine. The wait timeout is taken from UDSServerNextDeadlineMs
+ *          so the thread only wakes when there is work to do.
  * @param  parameter Unused parameter.
  */
 static void uds_task_entry(void *parameter) {
-    struct rt_can_msg rx_msg;
+    uint32_t dropped = 0;
 
     while (1) {
-        if (rt_mq_recv(can_rx_mq, &rx_msg, sizeof(struct rt_can_msg),
-                       rt_tick_from_millisecond(10)) == sizeof(struct rt_can_msg)) {
-#if (DBG_LVL >= DBG_LOG)
-            char title[32];
-            rt_snprintf(title, sizeof(title), "CAN RX ID:0x%X", rx_msg.id);
-            print_hex_data(title, rx_msg.data, rx_msg.len);
-#endif
-
-            // Feed the message to the appropriate ISO-TP link based on CAN ID.
-            if (rx_msg.id == tp.phys_sa) // Physical addressing
-            {
-                isotp_on_can_message(&tp.phys_link, rx_msg.data, rx_msg.len);
-            } else if (rx_msg.id == tp.func_sa) // Functional addressing
-            {
-                // Key: If a physical transfer is already in progress, ignore the functional frame.
-                if (ISOTP_RECEIVE_STATUS_IDLE != tp.phys_link.receive_status) {
-                    LOG_W("Functional frame received but physical link is busy, dropping.");
-                    continue;
-                }
-                isotp_on_can_message(&tp.func_link, rx_msg.data, rx_msg.len);
-            } else {
-                LOG_W("Received unknown CAN ID 0x%03lX", rx_msg.id);
-            }
+        // Sleep until a CAN frame arrives or the next server timer is due.
+        uint32_t deadline_ms = UDSServerNextDeadlineMs(&srv);
+        rt_int32_t timeout = (UDS_NO_DEADLINE == deadline_ms || deadline_ms > INT32_MAX)
+                                 ? RT_WAITING_FOREVER
+                                 : rt_tick_from_millisecond((rt_int32_t)deadline_ms);
+        rt_event_recv(can_rx_evt, CAN_RX_EVT_FRAME, RT_EVENT_FLAG_OR | RT_EVENT_FLAG_CLEAR,
+                      timeout, RT_NULL);
+
+        UDSCANRingDrain(&can_rx_ring, can_rx_frame, &tp, 0);
+        if (dropped != can_rx_ring.dropped) {
+            LOG_W("CAN RX ring full, %u frames dropped.", can_rx_ring.dropped - dropped);
+            dropped = can_rx_ring.dropped;
         }
 
         UDSServerPoll(&srv);
@@ -283,7 +288,7 @@ static void uds_task_entry(void *parameter) {
 
 /**
  * @brief Starts the UDS server example.
- * @details Initializes all required resources (CAN device, threads, message queues),
+ * @details Initializes all required resources (CAN device, threads, the frame ring),
  *          configures hardware, and starts the UDS processing task.
  */
 static void uds_start(void) {
@@ -301,16 +306,17 @@ static void uds_start(void) {
     old_can_rx_indicate = can_dev->rx_indicate;
     rt_device_close(can_dev);
 
-    can_rx_mq = rt_mq_create("uds_rx_mq", sizeof(struct rt_can_msg), 32, RT_IPC_FLAG_FIFO);
-    if (!can_rx_mq) {
-        LOG_E("Failed to create can_rx_mq.");
+    UDSCANRingInit(&can_rx_ring);
+    can_rx_evt = rt_event_create("uds_rx", RT_IPC_FLAG_FIFO);
+    if (!can_rx_evt) {
+        LOG_E("Failed to create can_rx_evt.");
         return;
     }
 
     uds_task_tid = rt_thread_create("uds_task", uds_task_entry, RT_NULL,
                                     UDS_EXAMPLE_THREAD_STACK_SIZE, UDS_EXAMPLE_THREAD_PRIO, 10);
     if (!uds_task_tid) {
-        rt_mq_delete(can_rx_mq);
+        rt_event_delete(can_rx_evt);
         LOG_E("Failed to create uds_task thread.");
         return;
     }
@@ -365,7 +371,7 @@ static void uds_start(void) {
 
 /**
  * @brief Stops the UDS server example.
- * @details Deletes the processing thread and message queue, and restores the
+ * @details Deletes the processing thread and RX event, and restores the
  *          original CAN device configuration.
  */
 static void uds_stop(void) {
@@ -376,10 +382,10 @@ static void uds_stop(void) {
 
     if (uds_task_tid)
         rt_thread_delete(uds_task_tid);
-    if (can_rx_mq)
-        rt_mq_delete(can_rx_mq);
+    if (can_rx_evt)
+        rt_event_delete(can_rx_evt);
     uds_task_tid = RT_NULL;
-    can_rx_mq = RT_NULL;
+    can_rx_evt = RT_NULL;
 
     if (can_dev) {
         rt_device_set_rx_indicate(can_dev, old_can_rx_indicate);
@@ -3,6 +3,7 @@
 #include "edma_driver.h"
 #include "flexcan_driver.h"
 #include "system_S32K144.h"
+#include "bsp.h"
 
 /*! @brief User number of configured pins */
 #define NUM_OF_CONFIGURED_PINS 12
@@ -227,11 +228,11 @@ static flexcan_state_t canCom1_State;
 const flexcan_user_config_t canCom1_InitConfig0 = {
     .fd_enable = true,
     .pe_clock = FLEXCAN_CLK_SOURCE_OSC,
-    .max_num_mb = 16,
+    .max_num_mb = 7, // message buffers that fit the CAN0 RAM with 64 byte payloads
     .num_id_filters = FLEXCAN_RX_FIFO_ID_FILTERS_8,
     .is_rx_fifo_needed = false,
     .flexcanMode = FLEXCAN_NORMAL_MODE,
-    .payload = FLEXCAN_PAYLOAD_SIZE_16,
+    .payload = FLEXCAN_PAYLOAD_SIZE_64,
     .bitrate = {.propSeg = 7, .phaseSeg1 = 4, .phaseSeg2 = 1, .preDivider = 0, .rJumpwidth = 1},
     .bitrate_cbt = {.propSeg = 7, .phaseSeg1 = 4, .phaseSeg2 = 1, .preDivider = 0, .rJumpwidth = 1},
     .transfer_type = FLEXCAN_RXFIFO_USING_INTERRUPTS,
@@ -240,11 +241,9 @@ const flexcan_user_config_t canCom1_InitConfig0 = {
 #define TX_MAILBOX (1UL)
 #define TX_MSG_ID (1UL)
 #define RX_MAILBOX (0UL)
-#define RX_MSG_ID (2UL)
 static flexcan_msgbuff_t recvBuff;
-typedef enum { LED0_CHANGE_REQUESTED = 0x00U, LED1_CHANGE_REQUESTED = 0x01U } can_commands_list;
+static UDSCANRing_t *rxRing = NULL;
 
-uint8_t ledRequested = (uint8_t)LED0_CHANGE_REQUESTED;
 uint8_t callback_test = 0;
 
 void flexcan0_Callback(uint8_t instance, flexcan_event_type_t eventType, uint32_t buffIdx,
@@ -257,12 +256,9 @@ void flexcan0_Callback(uint8_t instance, flexcan_event_type_t eventType, uint32_
     case FLEXCAN_EVENT_RX_COMPLETE:
         callback_test |= 0x1; // set bit0 to to evidence RX was complete
         if (buffIdx == RX_MAILBOX) {
-            if ((recvBuff.data[0] == LED0_CHANGE_REQUESTED) && recvBuff.msgId == RX_MSG_ID) {
-                /* Toggle output value LED1 */
-                PINS_DRV_TogglePins(GPIO_PORT, (1 << LED0));
-            } else if ((recvBuff.data[0] == LED1_CHANGE_REQUESTED) && recvBuff.msgId == RX_MSG_ID) {
-                /* Toggle output value LED0 */
-                PINS_DRV_TogglePins(GPIO_PORT, (1 << LED1));
+            /* hand the frame to the main loop, which drains the ring into the ISO-TP links */
+            if (NULL != rxRing) {
+                UDSCANRingPush(rxRing, recvBuff.msgId, recvBuff.data, recvBuff.dataLen);
             }
             /* Start receiving data in RX_MAILBOX again. */
             FLEXCAN_DRV_Receive(INST_CANCOM1, RX_MAILBOX, &recvBuff);
@@ -322,17 +318,17 @@ void flexcan0_ErrorCallback(uint8_t instance, flexcan_event_type_t eventType,
  */
 status_t SendCANData(uint32_t mailbox, uint32_t messageId, uint8_t *data, uint32_t len) {
     /* Set information about the data to be sent
-     *  - 1 byte in length
+     *  - up to 64 bytes in length
      *  - Standard message ID
      *  - Bit rate switch enabled to use a different bitrate for the data segment
      *  - Flexible data rate enabled
-     *  - Use zeros for FD padding
+     *  - Pad to the next CAN FD data length with 0xCC, as recommended by ISO 15765-2
      */
     flexcan_data_info_t dataInfo = {.data_length = len,
                                     .msg_id_type = FLEXCAN_MSG_ID_STD,
                                     .enable_brs = true,
-                                    .fd_enable = false,
-                                    .fd_padding = 0U};
+                                    .fd_enable = true,
+                                    .fd_padding = 0xCCU};
 
     /* Configure TX message buffer with index TX_MSG_ID and TX_MAILBOX*/
     FLEXCAN_DRV_ConfigTxMb(INST_CANCOM1, mailbox, &dataInfo, messageId);
@@ -352,7 +348,7 @@ int BSPSendCAN(uint32_t id, uint8_t *data, uint32_t len) {
 void FlexCANInit(void) {
     /*
      * Initialize FlexCAN driver
-     *  - 8 byte payload size
+     *  - 64 byte payload size
      *  - FD enabled
      *  - Bus clock as peripheral engine clock
      */
@@ -362,8 +358,21 @@ void FlexCANInit(void) {
                                      (void *)NULL);
     FLEXCAN_DRV_InstallErrorCallback(INST_CANCOM1, (flexcan_error_callback_t)flexcan0_ErrorCallback,
                                      (void *)NULL);
+
+    /* accept every standard ID in RX_MAILBOX, the ISO-TP links are selected in software */
+    flexcan_data_info_t rxInfo = {.data_length = 64,
+                                  .msg_id_type = FLEXCAN_MSG_ID_STD,
+                                  .enable_brs = true,
+                                  .fd_enable = true,
+                                  .fd_padding = 0U};
+    FLEXCAN_DRV_SetRxMaskType(INST_CANCOM1, FLEXCAN_RX_MASK_INDIVIDUAL);
+    FLEXCAN_DRV_SetRxIndividualMask(INST_CANCOM1, FLEXCAN_MSG_ID_STD, RX_MAILBOX, 0U);
+    FLEXCAN_DRV_ConfigRxMb(INST_CANCOM1, RX_MAILBOX, &rxInfo, 0U);
+    FLEXCAN_DRV_Receive(INST_CANCOM1, RX_MAILBOX, &recvBuff);
 }
 
+void BSPSetCANRxRing(UDSCANRing_t *ring) { rxRing = ring; }
+
 /*! @brief Count of user configuration structures */
 #define CLOCK_MANAGER_CONFIG_CNT 1U
 
@@ -683,3 +692,14 @@ int BSPSetLED(uint8_t led, bool value) {
 }
 
 uint32_t UDSMillis(void) { return OSIF_GetMilliseconds(); }
+
+/* milliseconds from OSIF plus the elapsed part of the current 1 ms SysTick period */
+uint32_t UDSMicros(void) {
+    uint32_t ms, cvr;
+    do {
+        ms = OSIF_GetMilliseconds();
+        cvr = S32_SysTick->CVR;
+    } while (ms != OSIF_GetMilliseconds());
+    const uint32_t reload = S32_SysTick->RVR + 1u;
+    return ms * 1000u + (reload - cvr) * 1000u / reload;
+}
@@ -3,9 +3,13 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "iso14229.h"
 
 void BSPInit(void);
 int BSPSetLED(uint8_t led, bool value);
 int BSPSendCAN(uint32_t id, uint8_t *data, uint32_t len);
 
+/* received frames are pushed into `ring` from the FlexCAN interrupt */
+void BSPSetCANRxRing(UDSCANRing_t *ring);
+
 #endif
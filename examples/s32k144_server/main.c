@@ -1,25 +1,28 @@
 #include <stdint.h>
 #include "bsp.h"
 #include "iso14229.h"
-#include "tp/isotp_c.h"
 
 UDSServer_t server;
-UDSTpISOTpC_t tp;
+UDSISOTpC_t tp;
+static UDSCANRing_t rx_ring;
 
-static int isotp_user_send_can(const uint32_t arbitration_id, const uint8_t *data,
-                               const uint8_t size, void *user_data) {
-    if (0 != BSPSendCAN(arbitration_id, data, size)) {
+int isotp_user_send_can(const uint32_t arbitration_id, const uint8_t *data, const uint8_t size,
+                        void *user_data) {
+    (void)user_data;
+    if (0 != BSPSendCAN(arbitration_id, (uint8_t *)data, size)) {
         return ISOTP_RET_ERROR;
     } else {
         return ISOTP_RET_OK;
     }
 }
 
-static void isotp_debug(const char *msg, ...) {
+void isotp_user_debug(const char *msg, ...) {
     // BSPLog("%s", msg);
 }
 
-static uint8_t fn(UDSServer_t *srv, UDSEvent_t ev, const void *arg) { return UDS_PositiveResponse; }
+uint32_t isotp_user_get_us(void) { return UDSMicros(); }
+
+static UDSErr_t fn(UDSServer_t *srv, UDSEvent_t ev, void *arg) { return UDS_PositiveResponse; }
 
 int main() {
     BSPInit();
@@ -27,27 +30,28 @@ int main() {
     server.fn = fn;
     server.tp = &tp.hdl;
 
-    UDSTpISOTpCInit(&tp, &(UDSTpISOTpCConfig_t){
-                             .source_addr = 0x7E8,
-                             .target_addr = 0x7E0,
-                             .source_addr_func = 0x7DF,
-                             .target_addr_func = 0,
-                             .user_data = NULL,
-                             .isotp_user_send_can = isotp_user_send_can,
-                             .isotp_user_debug = isotp_debug,
-                         });
-
-    uint8_t data[] = {0xf0, 0xf0};
+    UDSISOTpCInit(&tp, &(UDSISOTpCConfig_t){
+                           .source_addr = 0x7E8,
+                           .target_addr = 0x7E0,
+                           .source_addr_func = 0x7DF,
+                           .target_addr_func = 0,
+                           .tx_dl = 64,
+                       });
+
+    UDSCANRingInit(&rx_ring);
+    BSPSetCANRxRing(&rx_ring);
+
+    uint32_t led_timer = UDSMillis();
+    bool led = false;
     while (1) {
+        // frames pushed by the FlexCAN interrupt since the last pass, in one batch
+        UDSISOTpCDrainRing(&tp, &rx_ring);
         UDSServerPoll(&server);
-        BSPSetLED(0, true);
-        for (volatile int i = 0; i < 1000000; i++) {
-            __asm__("nop");
-        }
-        BSPSetLED(0, false);
-        for (volatile int i = 0; i < 1000000; i++) {
-            __asm__("nop");
+
+        if (UDSTimeAfter(UDSMillis(), led_timer)) {
+            led = !led;
+            BSPSetLED(0, led);
+            led_timer = UDSMillis() + 500;
         }
-        BSPSendCAN(0x123, data, sizeof(data));
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,576 @@
+/**
+ * @file fuzz_server_structured.cc
+ * @brief Structure-aware server fuzz target
+ * @details The input is read as a sequence of operations. Most of them build a well-formed request
+ * for one service from a few input bytes (lengths are always consistent, sub-functions mostly
+ * valid, 0x36 blockSequenceCounters and 0x27 keys usually right), so mutations reach the service
+ * state machines instead of the length checks. One server and one pair of mock transports are
+ * reused across inputs and reset in place, and time is virtual: between requests it jumps to the
+ * next deadline of the server or the network.
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "src/iso14229.h"
+
+#ifdef __cplusplus
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *, size_t);
+#else
+int LLVMFuzzerTestOneInput(const uint8_t *, size_t);
+#endif
+
+#define MAX_OPS 64
+#define MAX_WAIT_MS 12000 /* longer than the default P2* */
+#define KEY_XOR 0xA5
+
+uint32_t UDSMillis() { return ISOTPMockMillis(); }
+
+/* reads the input front to back, zeros once it is used up */
+struct Input {
+    const uint8_t *p;
+    const uint8_t *end;
+
+    bool Empty() const { return p >= end; }
+    uint8_t U8() { return p < end ? *p++ : 0; }
+    uint16_t U16() { return (uint16_t)((U8() << 8) | U8()); }
+    uint32_t U32() { return ((uint32_t)U16() << 16) | U16(); }
+    /* a value from `choices` most of the time, any byte otherwise */
+    uint8_t Pick(const uint8_t *choices, size_t n) {
+        uint8_t b = U8();
+        return (b & 0xC0) == 0xC0 ? U8() : choices[b % n];
+    }
+    size_t Bytes(uint8_t *dst, size_t max) {
+        size_t n = U8() % (max + 1);
+        for (size_t i = 0; i < n; i++) {
+            dst[i] = U8();
+        }
+        return n;
+    }
+};
+
+/* state shared by the request generator and the server callback */
+struct Ctx {
+    Input in;
+    uint8_t policy;     /* how the callback answers the current request */
+    bool pendingSent;   /* a 0x78 has been returned for the current request */
+    uint8_t seed[4];    /* last seed handed out by the server */
+    uint8_t seedLevel;  /* level of the last positive 0x27 seed response, 0 if none */
+    uint8_t bsc;        /* blockSequenceCounter of the next 0x36 */
+    uint16_t blockLen;  /* maxNumberOfBlockLength of the transfer in progress, 0 if none */
+    uint32_t seedCount; /* seeds handed out, makes every seed different */
+    bool functional;    /* send the next request functionally */
+    bool resetDue;      /* the server asked for the scheduled ECU reset */
+};
+
+static UDSServer_t srv;
+static UDSTp_t *srvTp;
+static UDSTp_t *clientTp;
+static Ctx ctx;
+static uint8_t mem[64]; /* stands in for every memory address */
+
+static uint8_t didStorage[3][8];
+static UDSDIDEntry_t dids[] = {
+    {.did = 0xF190, .len = 8, .ptr = didStorage[0], .access = UDS_DID_READ | UDS_DID_WRITE},
+    {.did = 0xF18C,
+     .len = 4,
+     .ptr = didStorage[1],
+     .sessionMask = UDS_DID_SESSION(UDS_LEV_DS_EXTDS),
+     .access = UDS_DID_READ},
+    {.did = 0x0100, .len = 2, .ptr = didStorage[2], .access = UDS_DID_WRITE},
+};
+
+static const UDSDTCRecord_t dtcTemplate[] = {
+    {{0x12, 0x34, 0x56}, 0x09}, {{0x12, 0x34, 0x57}, 0x00}, {{0xC0, 0x01, 0x00}, 0x2F},
+    {{0xC0, 0x01, 0x01}, 0x08}, {{0xD1, 0x00, 0x00}, 0x50}, {{0xFF, 0xFF, 0x00}, 0x01},
+};
+static UDSDTCRecord_t dtcRecords[sizeof(dtcTemplate) / sizeof(dtcTemplate[0])];
+static uint32_t dtcBitmaps[UDS_DTC_BITMAP_SIZE(sizeof(dtcTemplate) / sizeof(dtcTemplate[0]))];
+static UDSDTCStore_t dtcStore;
+
+/* answer with the policy of the request: positive mostly, sometimes an NRC or 0x78 first */
+static UDSErr_t Verdict(Ctx *c) {
+    if ((c->policy & 0x30) == 0x30 && !c->pendingSent) {
+        c->pendingSent = true;
+        return UDS_NRC_RequestCorrectlyReceived_ResponsePending;
+    }
+    if ((c->policy & 0x0F) == 0x0F) {
+        static const UDSErr_t nrcs[] = {
+            UDS_NRC_GeneralReject,
+            UDS_NRC_ConditionsNotCorrect,
+            UDS_NRC_RequestOutOfRange,
+            UDS_NRC_GeneralProgrammingFailure,
+        };
+        return nrcs[(c->policy >> 6) & 3];
+    }
+    return UDS_PositiveResponse;
+}
+
+static UDSErr_t fn(UDSServer_t *s, UDSEvent_t ev, void *arg) {
+    Ctx *c = (Ctx *)s->fn_data;
+    UDSErr_t verdict = Verdict(c);
+    if (UDS_PositiveResponse != verdict) {
+        switch (ev) {
+        case UDS_EVT_SessionTimeout:
+        case UDS_EVT_DoScheduledReset:
+        case UDS_EVT_TransferCheckpoint:
+            break;
+        default:
+            return verdict;
+        }
+    }
+    switch (ev) {
+    case UDS_EVT_DiagSessCtrl:
+        break;
+    case UDS_EVT_DoScheduledReset:
+        c->resetDue = true;
+        break;
+    case UDS_EVT_EcuReset: {
+        UDSECUResetArgs_t *r = (UDSECUResetArgs_t *)arg;
+        r->powerDownTimeMillis = c->policy;
+        break;
+    }
+    case UDS_EVT_ReadDataByIdent: {
+        UDSRDBIArgs_t *r = (UDSRDBIArgs_t *)arg;
+        return static_cast<UDSErr_t>(r->copy(s, mem, (uint16_t)(r->dataId % 16)));
+    }
+    case UDS_EVT_ReadMemByAddr: {
+        UDSReadMemByAddrArgs_t *r = (UDSReadMemByAddrArgs_t *)arg;
+        if (r->memSize > sizeof(mem)) {
+            return UDS_NRC_RequestOutOfRange;
+        }
+        return static_cast<UDSErr_t>(r->copy(s, mem, (uint16_t)r->memSize));
+    }
+    case UDS_EVT_SecAccessRequestSeed: {
+        UDSSecAccessRequestSeedArgs_t *r = (UDSSecAccessRequestSeedArgs_t *)arg;
+        c->seedCount++;
+        for (int i = 0; i < 4; i++) {
+            c->seed[i] = (uint8_t)((c->seedCount * 0x9E3779B1U) >> (8 * i));
+        }
+        return static_cast<UDSErr_t>(r->copySeed(s, c->seed, sizeof(c->seed)));
+    }
+    case UDS_EVT_SecAccessValidateKey: {
+        UDSSecAccessValidateKeyArgs_t *r = (UDSSecAccessValidateKeyArgs_t *)arg;
+        if (r->len != sizeof(c->seed)) {
+            return UDS_NRC_InvalidKey;
+        }
+        for (int i = 0; i < 4; i++) {
+            if (r->key[i] != (c->seed[i] ^ KEY_XOR)) {
+                return UDS_NRC_InvalidKey;
+            }
+        }
+        break;
+    }
+    case UDS_EVT_IOControl: {
+        UDSIOCtrlArgs_t *r = (UDSIOCtrlArgs_t *)arg;
+        return static_cast<UDSErr_t>(r->copy(s, mem, 2));
+    }
+    case UDS_EVT_RoutineCtrl: {
+        UDSRoutineCtrlArgs_t *r = (UDSRoutineCtrlArgs_t *)arg;
+        return static_cast<UDSErr_t>(r->copyStatusRecord(s, mem, (uint16_t)(r->id & 7)));
+    }
+    case UDS_EVT_RequestDownload: {
+        UDSRequestDownloadArgs_t *r = (UDSRequestDownloadArgs_t *)arg;
+        r->maxNumberOfBlockLength = (uint16_t)(3 + c->policy);
+        break;
+    }
+    case UDS_EVT_RequestUpload: {
+        UDSRequestUploadArgs_t *r = (UDSRequestUploadArgs_t *)arg;
+        r->maxNumberOfBlockLength = (uint16_t)(3 + c->policy);
+        break;
+    }
+    case UDS_EVT_TransferData: {
+        UDSTransferDataArgs_t *r = (UDSTransferDataArgs_t *)arg;
+        uint16_t n = r->maxRespLen < sizeof(mem) ? r->maxRespLen : sizeof(mem);
+        return static_cast<UDSErr_t>(r->copyResponse(s, mem, (uint16_t)(n & c->policy)));
+    }
+    case UDS_EVT_RequestFileTransfer: {
+        UDSRequestFileTransferArgs_t *r = (UDSRequestFileTransferArgs_t *)arg;
+        r->maxNumberOfBlockLength = (uint16_t)(3 + c->policy);
+        break;
+    }
+    default:
+        break;
+    }
+    return UDS_PositiveResponse;
+}
+
+/* learn what the generator needs to build valid follow-up requests */
+static void Observe(Ctx *c, const uint8_t *resp, ssize_t len) {
+    if (len >= 2 && 0x67 == resp[0] && (resp[1] & 1)) {
+        c->seedLevel = resp[1];
+    } else if (len >= 2 && 0x67 == resp[0]) {
+        c->seedLevel = 0;
+    } else if (len >= 3 && (0x74 == resp[0] || 0x75 == resp[0])) {
+        uint8_t n = resp[1] >> 4;
+        uint32_t block = 0;
+        for (uint8_t i = 0; i < n && i < 4 && 2 + i < len; i++) {
+            block = (block << 8) | resp[2 + i];
+        }
+        c->blockLen = (uint16_t)(block > UDS_TP_MTU ? UDS_TP_MTU : block);
+        c->bsc = 1;
+    } else if (len >= 2 && 0x76 == resp[0]) {
+        c->bsc = (uint8_t)(resp[1] + 1);
+    } else if (len >= 1 && 0x77 == resp[0]) {
+        c->blockLen = 0;
+    }
+}
+
+/*
+ * poll until the request has been answered (or its response suppressed) when `await` is set,
+ * otherwise for `max_ms`, skipping idle time
+ */
+static void Reset(void);
+
+static void Run(Ctx *c, bool await, uint32_t max_ms) {
+    static uint8_t resp[UDS_TP_MTU];
+    uint32_t start = UDSMillis();
+    for (int polls = 0; polls < 4096; polls++) {
+        UDSServerPoll(&srv);
+        if (c->resetDue) {
+            c->resetDue = false;
+            Reset(); // as the ECU would come back up
+        }
+        ssize_t len;
+        while ((len = UDSTpRecv(clientTp, resp, sizeof(resp), NULL)) > 0) {
+            Observe(c, resp, len);
+        }
+        uint32_t net = ISOTPMockNextDeadlineMs();
+        if (await && !srv.requestInProgress && UDS_NO_DEADLINE == net) {
+            return; // the request has been handled and its response, if any, read
+        }
+        uint32_t elapsed = UDSMillis() - start;
+        if (elapsed >= max_ms) {
+            return;
+        }
+        uint32_t step = UDSServerNextDeadlineMs(&srv);
+        step = net < step ? net : step;
+        step = step ? step : 1;
+        ISOTPMockAdvance(step < max_ms - elapsed ? step : max_ms - elapsed);
+    }
+}
+
+static const uint8_t DIDS[] = {0xF1, 0x90, 0xF1, 0x8C, 0x01, 0x00, 0xF2, 0x00,
+                               0xF2, 0x01, 0xFD, 0x00, 0xF1, 0x86, 0x12, 0x34};
+
+static size_t PutDID(Input *in, uint8_t *p) {
+    uint8_t i = in->U8();
+    if ((i & 0xE0) == 0xE0) {
+        p[0] = in->U8();
+        p[1] = in->U8();
+    } else {
+        i = (uint8_t)(2 * (i % (sizeof(DIDS) / 2)));
+        p[0] = DIDS[i];
+        p[1] = DIDS[i + 1];
+    }
+    return 2;
+}
+
+/* addressAndLengthFormatIdentifier 0x44 mostly, then the address and the size */
+static size_t PutAddrAndSize(Input *in, uint8_t *p) {
+    static const uint8_t ALFIDS[] = {0x44, 0x44, 0x22, 0x14, 0x41};
+    uint8_t alfid = in->Pick(ALFIDS, sizeof(ALFIDS));
+    size_t n = 0;
+    p[n++] = alfid;
+    for (int i = 0; i < (alfid & 0xF) && i < 4; i++) {
+        p[n++] = in->U8();
+    }
+    for (int i = 0; i < (alfid >> 4) && i < 4; i++) {
+        p[n++] = in->U8() & ((alfid >> 4) - 1 == i ? 0xFF : 0x00);
+    }
+    return n;
+}
+
+/* build the next request, return its length */
+static size_t Build(Ctx *c, uint8_t *req) {
+    Input *in = &c->in;
+    size_t n = 0;
+    uint8_t op = in->U8();
+    c->functional = (op & 0x80) && (op & 0x40);
+    switch (op % 28) {
+    case 0: {
+        static const uint8_t SUBS[] = {0x01, 0x02, 0x03, 0x04, 0x81, 0x83};
+        req[n++] = 0x10;
+        req[n++] = in->Pick(SUBS, sizeof(SUBS));
+        break;
+    }
+    case 1: {
+        static const uint8_t SUBS[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x81};
+        req[n++] = 0x11;
+        req[n++] = in->Pick(SUBS, sizeof(SUBS));
+        break;
+    }
+    case 2: {
+        static const uint8_t SUBS[] = {0x01, 0x03, 0x05, 0x01};
+        req[n++] = 0x27;
+        req[n++] = in->Pick(SUBS, sizeof(SUBS));
+        n += in->Bytes(&req[n], 4);
+        break;
+    }
+    case 3: {
+        // sendKey for the last seed, usually with the right key
+        req[n++] = 0x27;
+        req[n++] = (uint8_t)(c->seedLevel ? c->seedLevel + 1 : 2);
+        uint8_t mutate = in->U8();
+        for (int i = 0; i < 4; i++) {
+            req[n++] = (uint8_t)(c->seed[i] ^ KEY_XOR);
+        }
+        if ((mutate & 0x07) == 0x07) {
+            req[2 + (mutate >> 6)] ^= (uint8_t)(mutate | 1);
+        }
+        break;
+    }
+    case 4: {
+        req[n++] = 0x22;
+        int count = 1 + in->U8() % 4;
+        for (int i = 0; i < count; i++) {
+            n += PutDID(in, &req[n]);
+        }
+        break;
+    }
+    case 5: {
+        req[n++] = 0x2E;
+        n += PutDID(in, &req[n]);
+        n += in->Bytes(&req[n], 16);
+        break;
+    }
+    case 6: {
+        // defineByIdentifier of a dynamic DID from one or two sources
+        req[n++] = 0x2C;
+        req[n++] = 0x01;
+        req[n++] = 0xF2;
+        req[n++] = in->U8() & 0x03;
+        int count = 1 + (in->U8() & 1);
+        for (int i = 0; i < count; i++) {
+            n += PutDID(in, &req[n]);
+            req[n++] = (uint8_t)(1 + in->U8() % 8);
+            req[n++] = (uint8_t)(1 + in->U8() % 8);
+        }
+        break;
+    }
+    case 7: {
+        req[n++] = 0x2C;
+        req[n++] = 0x02;
+        req[n++] = 0xF2;
+        req[n++] = in->U8() & 0x03;
+        n += PutAddrAndSize(in, &req[n]);
+        break;
+    }
+    case 8: {
+        req[n++] = 0x2C;
+        req[n++] = 0x03;
+        if (in->U8() & 1) {
+            req[n++] = 0xF2;
+            req[n++] = in->U8() & 0x03;
+        }
+        break;
+    }
+    case 9: {
+        static const uint8_t MODES[] = {0x01, 0x02, 0x03, 0x04};
+        req[n++] = 0x2A;
+        req[n++] = in->Pick(MODES, sizeof(MODES));
+        int count = in->U8() % 3;
+        for (int i = 0; i < count; i++) {
+            req[n++] = (uint8_t)(0x00 | (in->U8() & 0x03)); // 0xF200.. as periodic DIDs
+        }
+        break;
+    }
+    case 10: {
+        static const uint8_t TYPES[] = {0x01, 0x02, 0x03, 0x81};
+        req[n++] = 0x31;
+        req[n++] = in->Pick(TYPES, sizeof(TYPES));
+        req[n++] = in->U8() & 0x03 ? 0xFF : in->U8();
+        req[n++] = in->U8();
+        n += in->Bytes(&req[n], 8);
+        break;
+    }
+    case 11: {
+        static const uint8_t DFIS[] = {0x00, 0x00, 0x11, 0x10};
+        req[n++] = 0x34;
+        req[n++] = in->Pick(DFIS, sizeof(DFIS));
+        n += PutAddrAndSize(in, &req[n]);
+        break;
+    }
+    case 12: {
+        static const uint8_t DFIS[] = {0x00, 0x00, 0x11};
+        req[n++] = 0x35;
+        req[n++] = in->Pick(DFIS, sizeof(DFIS));
+        n += PutAddrAndSize(in, &req[n]);
+        break;
+    }
+    case 13: {
+        // TransferData in sequence most of the time, repeated or skipped otherwise
+        uint8_t b = in->U8();
+        req[n++] = 0x36;
+        req[n++] = (uint8_t)(c->bsc + ((b & 0x07) == 0x07 ? (b >> 6) - 1 : 0));
+        size_t max = c->blockLen > 2 ? c->blockLen - 2U : 16U;
+        size_t len = in->U16() % (max + 1);
+        memset(&req[n], b, len);
+        n += len;
+        break;
+    }
+    case 14: {
+        req[n++] = 0x37;
+        n += in->Bytes(&req[n], 4);
+        break;
+    }
+    case 15: {
+        static const uint8_t SUBS[] = {0x00, 0x80, 0x00};
+        req[n++] = 0x3E;
+        req[n++] = in->Pick(SUBS, sizeof(SUBS));
+        break;
+    }
+    case 16: {
+        static const uint8_t SUBS[] = {0x01, 0x02, 0x81, 0x82};
+        req[n++] = 0x85;
+        req[n++] = in->Pick(SUBS, sizeof(SUBS));
+        break;
+    }
+    case 17: {
+        static const uint8_t SUBS[] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x80};
+        req[n++] = 0x28;
+        req[n++] = in->Pick(SUBS, sizeof(SUBS));
+        req[n++] = (uint8_t)(1 + in->U8() % 3);
+        if ((req[1] & 0x7F) >= 0x04) {
+            req[n++] = in->U8();
+            req[n++] = in->U8();
+        }
+        break;
+    }
+    case 18: {
+        static const uint8_t SUBS[] = {0x01, 0x02, 0x03, 0x04, 0x06, 0x0A, 0x0B, 0x0E, 0x14};
+        req[n++] = 0x19;
+        req[n++] = in->Pick(SUBS, sizeof(SUBS));
+        n += in->Bytes(&req[n], 4);
+        break;
+    }
+    case 19: {
+        req[n++] = 0x14;
+        if (in->U8() & 1) {
+            req[n++] = 0xFF;
+            req[n++] = 0xFF;
+            req[n++] = 0xFF;
+        } else {
+            req[n++] = in->U8();
+            req[n++] = in->U8();
+            req[n++] = in->U8();
+        }
+        break;
+    }
+    case 20: {
+        req[n++] = 0x23;
+        n += PutAddrAndSize(in, &req[n]);
+        break;
+    }
+    case 21: {
+        req[n++] = 0x3D;
+        n += PutAddrAndSize(in, &req[n]);
+        n += in->Bytes(&req[n], 16);
+        break;
+    }
+    case 22: {
+        static const uint8_t PARAMS[] = {0x00, 0x01, 0x02, 0x03};
+        req[n++] = 0x2F;
+        n += PutDID(in, &req[n]);
+        req[n++] = in->Pick(PARAMS, sizeof(PARAMS));
+        n += in->Bytes(&req[n], 4);
+        break;
+    }
+    case 23: {
+        static const uint8_t SUBS[] = {0x00, 0x01, 0x03, 0x04, 0x05, 0x06, 0x07, 0x47};
+        req[n++] = 0x86;
+        req[n++] = in->Pick(SUBS, sizeof(SUBS));
+        n += in->Bytes(&req[n], 12);
+        break;
+    }
+    case 24: {
+        static const uint8_t SUBS[] = {0x01, 0x02, 0x03};
+        req[n++] = 0x87;
+        req[n++] = in->Pick(SUBS, sizeof(SUBS));
+        n += in->Bytes(&req[n], 3);
+        break;
+    }
+    case 25: {
+        // RequestFileTransfer: modeOfOperation, filePathAndNameLength, path, then the rest raw
+        static const uint8_t MODES[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06};
+        req[n++] = 0x38;
+        req[n++] = in->Pick(MODES, sizeof(MODES));
+        uint8_t path = (uint8_t)(1 + in->U8() % 8);
+        req[n++] = 0x00;
+        req[n++] = path;
+        memset(&req[n], 'a' + (path & 7), path);
+        n += path;
+        n += in->Bytes(&req[n], 12);
+        break;
+    }
+    case 26: {
+        // raw bytes for everything the templates do not cover
+        n = in->Bytes(req, 64);
+        break;
+    }
+    default: {
+        // let time pass: session timeouts, scheduled resets, 0x2A and 0x86 transmissions
+        Run(c, false, (uint32_t)in->U16() * 4);
+        break;
+    }
+    }
+    return n;
+}
+
+static void Drain(void) {
+    static uint8_t buf[UDS_TP_MTU];
+    ISOTPMockAdvance(1);
+    UDSTpPoll(clientTp);
+    while (UDSTpRecv(clientTp, buf, sizeof(buf), NULL) > 0) {
+    }
+    while (UDSTpRecv(srvTp, buf, sizeof(buf), NULL) > 0) {
+    }
+}
+
+static void Reset(void) {
+    if (NULL == srvTp) {
+        ISOTPMockSetTime(0);
+        ISOTPMockArgs_t server_args = {
+            .sa_phys = 0x7E0, .ta_phys = 0x7E8, .sa_func = 0x7DF, .ta_func = UDS_TP_NOOP_ADDR};
+        ISOTPMockArgs_t client_args = {
+            .sa_phys = 0x7E8, .ta_phys = 0x7E0, .sa_func = UDS_TP_NOOP_ADDR, .ta_func = 0x7DF};
+        srvTp = ISOTPMockNew("server", &server_args);
+        clientTp = ISOTPMockNew("client", &client_args);
+    }
+    Drain();
+
+    UDSServerInit(&srv);
+    srv.tp = srvTp;
+    srv.fn = fn;
+    srv.fn_data = &ctx;
+    // the 0x27 boot delay would otherwise cost every input a second of virtual time
+    srv.sec_access_boot_delay_timer = UDSMillis();
+    memset(didStorage, 0, sizeof(didStorage));
+    UDSServerRegisterDIDs(&srv, dids, sizeof(dids) / sizeof(dids[0]));
+    memcpy(dtcRecords, dtcTemplate, sizeof(dtcRecords));
+    UDSDTCStoreInit(&dtcStore, dtcRecords, sizeof(dtcRecords) / sizeof(dtcRecords[0]), dtcBitmaps,
+                    0x7F);
+    UDSServerRegisterDTCStore(&srv, &dtcStore);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    static uint8_t req[UDS_TP_MTU];
+    Reset();
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.in.p = data;
+    ctx.in.end = data + size;
+
+    for (int op = 0; op < MAX_OPS && !ctx.in.Empty(); op++) {
+        ctx.policy = ctx.in.U8();
+        ctx.pendingSent = false;
+        size_t len = Build(&ctx, req);
+        if (0 == len) {
+            continue;
+        }
+        UDSSDU_t info = {};
+        info.A_Mtype = UDS_A_MTYPE_DIAG;
+        info.A_TA_Type = ctx.functional ? UDS_A_TA_TYPE_FUNCTIONAL : UDS_A_TA_TYPE_PHYSICAL;
+        UDSTpSend(clientTp, req, (ssize_t)len, &info);
+        Run(&ctx, true, MAX_WAIT_MS);
+    }
+    return 0;
+}
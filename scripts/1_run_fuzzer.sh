@@ -1,10 +1,20 @@
 #!/bin/bash
 
+# Usage: 1_run_fuzzer.sh [fuzz_server|fuzz_server_structured]
+TARGET=${1:-fuzz_server}
+
 # Get workspace path
 WORKSPACE=$(bazel info workspace)
 
-bazel run -c opt --config=hermetic-fuzz //fuzz:fuzz_server_bin -- \
+if [ "$TARGET" = fuzz_server ]; then
+    CORPUS=${WORKSPACE}/fuzz/outputs/corpus
+else
+    CORPUS=${WORKSPACE}/fuzz/outputs/structured_corpus
+fi
+mkdir -p "$CORPUS"
+
+bazel run -c opt --config=hermetic-fuzz //fuzz:${TARGET}_bin -- \
 -max_total_time=600 \
 -artifact_prefix=${WORKSPACE}/fuzz/outputs/ \
 -jobs=64 \
-${WORKSPACE}/fuzz/outputs/corpus
+${CORPUS}
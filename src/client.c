@@ -9,6 +9,7 @@
 #define STATE_SENDING 1
 #define STATE_AWAIT_SEND_COMPLETE 2
 #define STATE_AWAIT_RESPONSE 3
+#define STATE_COLLECT_RESPONSES 4
 
 UDSErr_t UDSClientInit(UDSClient_t *client) {
     if (NULL == client) {
@@ -38,6 +39,8 @@ static const char *ClientStateName(uint8_t state) {
         return "AwaitSendComplete";
     case STATE_AWAIT_RESPONSE:
         return "AwaitResponse";
+    case STATE_COLLECT_RESPONSES:
+        return "CollectResponses";
     default:
         return "Unknown";
     }
@@ -60,6 +63,8 @@ static void changeState(UDSClient_t *client, uint8_t state) {
             break;
         case STATE_AWAIT_RESPONSE:
             break;
+        case STATE_COLLECT_RESPONSES:
+            break;
         default:
             UDS_ASSERT(0);
             break;
@@ -114,7 +119,7 @@ static UDSErr_t ValidateServerResponse(const UDSClient_t *client) {
 static UDSErr_t HandleServerResponse(UDSClient_t *client) {
     if (0x7F == client->recv_buf[0]) {
         if (UDS_NRC_RequestCorrectlyReceived_ResponsePending == client->recv_buf[2]) {
-            client->p2_timer = UDSMillis() + client->p2_star_ms;
+            client->p2_timer = client->now + client->p2_star_ms;
             UDS_LOGI(__FILE__, "got RCRRP, set p2 timer to %" PRIu32 "", client->p2_timer);
             memset(client->recv_buf, 0, sizeof(client->recv_buf));
             client->recv_size = 0;
@@ -147,6 +152,39 @@ static UDSErr_t HandleServerResponse(UDSClient_t *client) {
             client->p2_star_ms = p2_star;
             break;
         }
+        case kSID_ACCESS_TIMING_PARAMETER: {
+            if (client->recv_size < UDS_0X83_RESP_BASE_LEN) {
+                changeState(client, STATE_IDLE);
+                return UDS_ERR_RESP_TOO_SHORT;
+            }
+            if (client->_options_copy & UDS_IGNORE_SRV_TIMINGS) {
+                break;
+            }
+            const uint8_t *record = NULL;
+            switch (client->recv_buf[1] & 0x7F) {
+            case UDS_LEV_ATP_STPTDV:
+                client->p2_ms = UDS_CLIENT_DEFAULT_P2_MS;
+                client->p2_star_ms = UDS_CLIENT_DEFAULT_P2_STAR_MS;
+                break;
+            case UDS_LEV_ATP_STPTGV: // the response has no record, the request holds the values
+                record = &client->send_buf[UDS_0X83_REQ_BASE_LEN];
+                break;
+            case UDS_LEV_ATP_RCATP:
+                if (client->recv_size >= UDS_0X83_RESP_BASE_LEN + UDS_0X83_TIMING_RECORD_LEN) {
+                    record = &client->recv_buf[UDS_0X83_RESP_BASE_LEN];
+                }
+                break;
+            default:
+                break;
+            }
+            if (record) {
+                client->p2_ms = (uint16_t)((record[0] << 8) | record[1]);
+                client->p2_star_ms = (uint32_t)((record[2] << 8) | record[3]) * 10;
+                UDS_LOGI(__FILE__, "received new timings: p2: %" PRIu16 ", p2*: %" PRIu32,
+                         client->p2_ms, client->p2_star_ms);
+            }
+            break;
+        }
         default:
             break;
         }
@@ -154,6 +192,238 @@ static UDSErr_t HandleServerResponse(UDSClient_t *client) {
     return UDS_OK;
 }
 
+static const UDSDIDCachePolicy_t *DIDCachePolicy(const UDSDIDCache_t *cache, uint16_t did) {
+    for (uint16_t i = 0; i < cache->numPolicies; i++) {
+        if (cache->policies[i].did == did) {
+            return &cache->policies[i];
+        }
+    }
+    return NULL;
+}
+
+static bool DIDCacheEntryValid(const UDSDIDCacheEntry_t *e, uint32_t now) {
+    return NULL != e->policy &&
+           (UDS_DID_CACHE_STATIC == e->policy->ttl_ms || !UDSTimeAfter(now, e->expires));
+}
+
+static UDSDIDCacheEntry_t *DIDCacheFind(UDSDIDCache_t *cache, uint32_t sa, uint16_t did) {
+    for (uint16_t i = 0; i < UDS_CLIENT_DID_CACHE_ENTRIES; i++) {
+        UDSDIDCacheEntry_t *e = &cache->entries[i];
+        if (e->policy && e->policy->did == did && e->sa == sa) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static void DIDCacheStore(UDSDIDCache_t *cache, uint32_t sa, const UDSDIDCachePolicy_t *policy,
+                          const uint8_t *data) {
+    uint32_t now = UDSMillis();
+    UDSDIDCacheEntry_t *e = DIDCacheFind(cache, sa, policy->did);
+    for (uint16_t i = 0; NULL == e && i < UDS_CLIENT_DID_CACHE_ENTRIES; i++) {
+        if (!DIDCacheEntryValid(&cache->entries[i], now)) {
+            e = &cache->entries[i];
+        }
+    }
+    if (NULL == e) {
+        e = &cache->entries[cache->evict];
+        cache->evict = (uint16_t)((cache->evict + 1) % UDS_CLIENT_DID_CACHE_ENTRIES);
+    }
+    e->policy = policy;
+    e->sa = sa;
+    e->expires = now + policy->ttl_ms;
+    memmove(e->data, data, policy->len);
+}
+
+/**
+ * @brief Store the records of an 0x22 response in the cache
+ * @details Records are matched against the DIDs of the request in order. Parsing stops at the
+ * first DID without a policy since the length of its record is unknown.
+ */
+static void DIDCacheStoreRDBI(UDSClient_t *client, uint32_t sa) {
+    UDSDIDCache_t *cache = client->did_cache;
+    const uint8_t *p = client->recv_buf + UDS_0X22_RESP_BASE_LEN;
+    const uint8_t *end = client->recv_buf + client->recv_size;
+    for (uint16_t i = 1; i + 1 < client->send_size; i += 2) {
+        uint16_t did = (uint16_t)((uint16_t)(client->send_buf[i] << 8) | client->send_buf[i + 1]);
+        const UDSDIDCachePolicy_t *policy = DIDCachePolicy(cache, did);
+        if (NULL == policy || end - p < (ptrdiff_t)(sizeof(uint16_t) + policy->len) ||
+            (uint16_t)((uint16_t)(p[0] << 8) | (uint16_t)p[1]) != did) {
+            return;
+        }
+        DIDCacheStore(cache, sa, policy, p + sizeof(uint16_t));
+        p += sizeof(uint16_t) + policy->len;
+    }
+}
+
+/**
+ * @brief Update the DID cache after a request has been answered
+ * @param client
+ * @param sa address of the server that answered positively, or UDS_TP_NOOP_ADDR if the request
+ * was sent without waiting for a response and may have reached any server
+ */
+static void DIDCacheUpdate(UDSClient_t *client, uint32_t sa) {
+    UDSDIDCache_t *cache = client->did_cache;
+    if (NULL == cache) {
+        return;
+    }
+    switch (client->send_buf[0]) {
+    case kSID_READ_DATA_BY_IDENTIFIER:
+        if (UDS_TP_NOOP_ADDR != sa) {
+            DIDCacheStoreRDBI(client, sa);
+        }
+        break;
+    case kSID_DIAGNOSTIC_SESSION_CONTROL:
+        UDSDIDCacheInvalidate(cache, sa, true);
+        break;
+    case kSID_ECU_RESET:
+    case kSID_REQUEST_TRANSFER_EXIT:
+        UDSDIDCacheInvalidate(cache, sa, false);
+        break;
+    case kSID_WRITE_DATA_BY_IDENTIFIER: {
+        uint16_t did = (uint16_t)((uint16_t)(client->send_buf[1] << 8) | client->send_buf[2]);
+        for (uint16_t i = 0; i < UDS_CLIENT_DID_CACHE_ENTRIES; i++) {
+            UDSDIDCacheEntry_t *e = &cache->entries[i];
+            if (e->policy && e->policy->did == did && (UDS_TP_NOOP_ADDR == sa || e->sa == sa)) {
+                e->policy = NULL;
+            }
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+UDSErr_t UDSDIDCacheInit(UDSDIDCache_t *cache, const UDSDIDCachePolicy_t *policies,
+                         uint16_t numPolicies) {
+    if (NULL == cache || (NULL == policies && numPolicies)) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    memset(cache, 0, sizeof(*cache));
+    for (uint16_t i = 0; i < numPolicies; i++) {
+        if (policies[i].len > UDS_CLIENT_DID_CACHE_DATA_LEN) {
+            return UDS_ERR_BUFSIZ;
+        }
+    }
+    cache->policies = policies;
+    cache->numPolicies = numPolicies;
+    return UDS_OK;
+}
+
+UDSErr_t UDSDIDCacheRead(UDSDIDCache_t *cache, uint32_t sa, uint16_t did, void *dst,
+                         uint16_t size) {
+    if (NULL == cache || NULL == dst) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    UDSDIDCacheEntry_t *e = DIDCacheFind(cache, sa, did);
+    if (NULL == e || !DIDCacheEntryValid(e, UDSMillis())) {
+        cache->misses++;
+        return UDS_FAIL;
+    }
+    if (size < e->policy->len) {
+        return UDS_ERR_BUFSIZ;
+    }
+    memmove(dst, e->data, e->policy->len);
+    cache->hits++;
+    return UDS_OK;
+}
+
+void UDSDIDCacheInvalidate(UDSDIDCache_t *cache, uint32_t sa, bool keepStatic) {
+    if (NULL == cache) {
+        return;
+    }
+    for (uint16_t i = 0; i < UDS_CLIENT_DID_CACHE_ENTRIES; i++) {
+        UDSDIDCacheEntry_t *e = &cache->entries[i];
+        if (NULL == e->policy || (UDS_TP_NOOP_ADDR != sa && e->sa != sa)) {
+            continue;
+        }
+        if (!keepStatic || UDS_DID_CACHE_STATIC != e->policy->ttl_ms) {
+            e->policy = NULL;
+        }
+    }
+}
+
+#if UDS_CLIENT_STATS
+/**
+ * @brief Count a validated response. A response that is not a 0x78 ends the request in progress
+ */
+static void ClientStatsResponse(UDSClient_t *client, bool final) {
+    UDSClientStats_t *stats = &client->stats;
+    if (0x7F == client->recv_buf[0] && client->recv_size >= UDS_NEG_RESP_LEN) {
+        stats->nrcs[client->recv_buf[2]]++;
+        if (UDS_NRC_RequestCorrectlyReceived_ResponsePending == client->recv_buf[2]) {
+            stats->rcrrp++;
+            return;
+        }
+    }
+    if (final) {
+        UDSHistogramAdd(&stats->turnaround, UDSMicros() - client->statsStartUs);
+    }
+}
+#endif
+
+static uint16_t RequestP2(const UDSClient_t *client) {
+    if (client->queue_active && client->queue[client->queue_head].p2_ms) {
+        return client->queue[client->queue_head].p2_ms;
+    }
+    return client->p2_ms;
+}
+
+static bool CollectingResponses(const UDSClient_t *client) {
+    return (client->_options_copy & (UDS_FUNCTIONAL | UDS_COLLECT_RESPONSES)) ==
+           (UDS_FUNCTIONAL | UDS_COLLECT_RESPONSES);
+}
+
+/**
+ * @brief Read one response to a collecting functional request from `tp`
+ * @details Every server answers on its own, so responses are not checked against each other and a
+ * 0x78 only keeps the window open for p2* instead of waiting on that server.
+ * @param client
+ * @param tp
+ * @return UDSErr_t
+ */
+static UDSErr_t CollectResponse(UDSClient_t *client, UDSTp_t *tp) {
+    UDSSDU_t info = {0};
+    ssize_t len = UDSTpRecv(tp, client->recv_buf, sizeof(client->recv_buf), &info);
+    if (len < 0) {
+#if UDS_CLIENT_STATS
+        client->stats.tpErrors++;
+#endif
+        return UDS_ERR_TPORT;
+    } else if (0 == len) {
+        return UDS_OK;
+    }
+    UDS_ASSERT(len <= (ssize_t)UINT16_MAX);
+    client->recv_size = (uint16_t)len;
+
+    UDSFunctionalResponse_t resp = {
+        .A_SA = info.A_SA,
+        .err = ValidateServerResponse(client),
+        .data = client->recv_buf,
+        .len = client->recv_size,
+    };
+#if UDS_CLIENT_STATS
+    if (UDS_ERR_SID_MISMATCH != resp.err) {
+        ClientStatsResponse(client, false);
+    }
+#endif
+    if (UDS_OK == resp.err && 0x7F == client->recv_buf[0]) {
+        uint32_t deadline = client->now + client->p2_star_ms;
+        UDS_LOGI(__FILE__, "got RCRRP from 0x%" PRIx32, info.A_SA);
+        if (UDSTimeAfter(deadline, client->p2_timer)) {
+            client->p2_timer = deadline;
+        }
+        return UDS_OK;
+    }
+    if (UDS_OK == resp.err && 0x7F != client->recv_buf[0]) {
+        DIDCacheUpdate(client, info.A_SA);
+    }
+    client->collected++;
+    client->fn(client, UDS_EVT_FunctionalResponse, &resp);
+    return UDS_OK;
+}
+
 /**
  * @brief execute the client request state machine
  * @param client
@@ -173,7 +443,8 @@ static UDSErr_t PollLowLevel(UDSClient_t *client) {
         break;
     }
     case STATE_SENDING: {
-        {
+        // the upload engine writes the previous block out of recv_buf while this request is sent
+        if (!client->upload.held) {
             UDSSDU_t info = {0};
             ssize_t len = UDSTpRecv(client->tp, client->recv_buf, sizeof(client->recv_buf), &info);
             if (len < 0) {
@@ -184,9 +455,8 @@ static UDSErr_t PollLowLevel(UDSClient_t *client) {
                 UDS_LOGW(__FILE__, "received %zd unexpected bytes:", len);
                 UDS_LOG_SDU(__FILE__, client->recv_buf, len, &info);
             }
+            memset(client->recv_buf, 0, sizeof(client->recv_buf));
         }
-
-        memset(client->recv_buf, 0, sizeof(client->recv_buf));
         client->recv_size = 0;
 
         UDSTpAddr_t ta_type = client->_options_copy & UDS_FUNCTIONAL ? UDS_A_TA_TYPE_FUNCTIONAL
@@ -197,6 +467,9 @@ static UDSErr_t PollLowLevel(UDSClient_t *client) {
         };
         ssize_t ret = UDSTpSend(client->tp, client->send_buf, client->send_size, &info);
         if (ret < 0) {
+#if UDS_CLIENT_STATS
+            client->stats.tpErrors++;
+#endif
             err = UDS_ERR_TPORT;
             UDS_LOGI(__FILE__, "tport err: %zd", ret);
         } else if (0 == ret) {
@@ -210,9 +483,10 @@ static UDSErr_t PollLowLevel(UDSClient_t *client) {
         break;
     }
     case STATE_AWAIT_SEND_COMPLETE: {
-        if (client->_options_copy & UDS_FUNCTIONAL) {
+        if ((client->_options_copy & UDS_FUNCTIONAL) && !CollectingResponses(client)) {
             // "The Functional addressing is applied only to single frame transmission"
             // Specification of Diagnostic Communication (Diagnostic on CAN - Network Layer)
+            DIDCacheUpdate(client, UDS_TP_NOOP_ADDR);
             changeState(client, STATE_IDLE);
         }
         if (tp_status & UDS_TP_SEND_IN_PROGRESS) {
@@ -220,10 +494,18 @@ static UDSErr_t PollLowLevel(UDSClient_t *client) {
         } else {
             client->fn(client, UDS_EVT_SendComplete, NULL);
             if (client->_options_copy & UDS_SUPPRESS_POS_RESP) {
+                DIDCacheUpdate(client, UDS_TP_NOOP_ADDR);
                 changeState(client, STATE_IDLE);
+            } else if (CollectingResponses(client)) {
+                client->collected = 0;
+                client->p2_timer = client->now + RequestP2(client);
+                changeState(client, STATE_COLLECT_RESPONSES);
             } else {
                 changeState(client, STATE_AWAIT_RESPONSE);
-                client->p2_timer = UDSMillis() + client->p2_ms;
+                client->p2_timer = client->now + RequestP2(client);
+#if UDS_CLIENT_STATS
+                client->statsStartUs = UDSMicros();
+#endif
             }
         }
         break;
@@ -233,11 +515,17 @@ static UDSErr_t PollLowLevel(UDSClient_t *client) {
 
         ssize_t len = UDSTpRecv(client->tp, client->recv_buf, sizeof(client->recv_buf), &info);
         if (len < 0) {
+#if UDS_CLIENT_STATS
+            client->stats.tpErrors++;
+#endif
             err = UDS_ERR_TPORT;
             changeState(client, STATE_IDLE);
         } else if (0 == len) {
-            if (UDSTimeAfter(UDSMillis(), client->p2_timer)) {
+            if (UDSTimeAfter(client->now, client->p2_timer)) {
                 UDS_LOGI(__FILE__, "p2 timeout");
+#if UDS_CLIENT_STATS
+                client->stats.timeouts++;
+#endif
                 err = UDS_ERR_TIMEOUT;
                 changeState(client, STATE_IDLE);
             }
@@ -247,17 +535,35 @@ static UDSErr_t PollLowLevel(UDSClient_t *client) {
             client->recv_size = (uint16_t)len;
 
             err = ValidateServerResponse(client);
+#if UDS_CLIENT_STATS
+            if (UDS_ERR_SID_MISMATCH != err && UDS_ERR_RESP_TOO_SHORT != err) {
+                ClientStatsResponse(client, true);
+            }
+#endif
             if (UDS_OK == err) {
                 err = HandleServerResponse(client);
             }
 
             if (UDS_OK == err) {
+                DIDCacheUpdate(client, info.A_SA);
                 client->fn(client, UDS_EVT_ResponseReceived, NULL);
                 changeState(client, STATE_IDLE);
             }
         }
         break;
     }
+    case STATE_COLLECT_RESPONSES: {
+        err = CollectResponse(client, client->tp);
+        for (uint8_t i = 0; UDS_OK == err && i < client->collect_tps_len; i++) {
+            UDSTpPoll(client->collect_tps[i]);
+            err = CollectResponse(client, client->collect_tps[i]);
+        }
+        if (UDS_OK == err && UDSTimeAfter(client->now, client->p2_timer)) {
+            UDS_LOGI(__FILE__, "collected %" PRIu16 " responses", client->collected);
+            changeState(client, STATE_IDLE);
+        }
+        break;
+    }
 
     default:
         UDS_ASSERT(0);
@@ -268,6 +574,9 @@ static UDSErr_t PollLowLevel(UDSClient_t *client) {
 
 static UDSErr_t SendRequest(UDSClient_t *client) {
     client->_options_copy = client->options;
+#if UDS_CLIENT_STATS
+    client->stats.requests[UDSStatsSIDIndex(client->send_buf[0])]++;
+#endif
 
     if (client->_options_copy & UDS_SUPPRESS_POS_RESP) {
         // UDS-1:2013 8.2.2 Table 11
@@ -275,15 +584,39 @@ static UDSErr_t SendRequest(UDSClient_t *client) {
     }
 
     changeState(client, STATE_SENDING);
+    client->now = UDSMillis();
     UDSErr_t err = PollLowLevel(client); // poll once to begin sending immediately
     return err;
 }
 
+static bool DownloadInProgress(const UDSClient_t *client) {
+    switch (client->download.state) {
+    case UDS_DOWNLOAD_REQUEST_DOWNLOAD:
+    case UDS_DOWNLOAD_TRANSFER_DATA:
+    case UDS_DOWNLOAD_TRANSFER_EXIT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool UploadInProgress(const UDSClient_t *client) {
+    switch (client->upload.state) {
+    case UDS_UPLOAD_REQUEST_UPLOAD:
+    case UDS_UPLOAD_TRANSFER_DATA:
+    case UDS_UPLOAD_READ_MEMORY:
+    case UDS_UPLOAD_TRANSFER_EXIT:
+        return true;
+    default:
+        return false;
+    }
+}
+
 static UDSErr_t PreRequestCheck(UDSClient_t *client) {
     if (NULL == client) {
         return UDS_ERR_INVALID_ARG;
     }
-    if (STATE_IDLE != client->state) {
+    if (STATE_IDLE != client->state || DownloadInProgress(client) || UploadInProgress(client)) {
         return UDS_ERR_BUSY;
     }
 
@@ -301,9 +634,11 @@ UDSErr_t UDSSendBytes(UDSClient_t *client, const uint8_t *data, uint16_t size) {
     if (err) {
         return err;
     }
+#if UDS_CLIENT_SEND_BUF_SIZE < 0xFFFF
     if (size > sizeof(client->send_buf)) {
         return UDS_ERR_BUFSIZ;
     }
+#endif
     memmove(client->send_buf, data, size);
     client->send_size = size;
     return SendRequest(client);
@@ -354,6 +689,28 @@ UDSErr_t UDSSendTesterPresent(UDSClient_t *client) {
     return SendRequest(client);
 }
 
+UDSErr_t UDSSendAccessTimingParameter(UDSClient_t *client, uint8_t type, uint16_t p2_ms,
+                                      uint32_t p2_star_ms) {
+    UDSErr_t err = PreRequestCheck(client);
+    if (err) {
+        return err;
+    }
+    client->send_buf[0] = kSID_ACCESS_TIMING_PARAMETER;
+    client->send_buf[1] = type;
+    client->send_size = UDS_0X83_REQ_BASE_LEN;
+    if (UDS_LEV_ATP_STPTGV == (type & 0x7F)) {
+        if (p2_star_ms / 10 > 0xFFFF) {
+            return UDS_ERR_INVALID_ARG;
+        }
+        client->send_buf[2] = (uint8_t)(p2_ms >> 8);
+        client->send_buf[3] = (uint8_t)p2_ms;
+        client->send_buf[4] = (uint8_t)((p2_star_ms / 10) >> 8);
+        client->send_buf[5] = (uint8_t)(p2_star_ms / 10);
+        client->send_size += UDS_0X83_TIMING_RECORD_LEN;
+    }
+    return SendRequest(client);
+}
+
 UDSErr_t UDSSendRDBI(UDSClient_t *client, const uint16_t *didList,
                      const uint16_t numDataIdentifiers) {
     const uint16_t DID_LEN_BYTES = 2;
@@ -435,6 +792,49 @@ UDSErr_t UDSSendRoutineCtrl(UDSClient_t *client, uint8_t type, uint16_t routineI
     return SendRequest(client);
 }
 
+/* write memoryAddress and memorySize big-endian in the sizes given by the format identifier */
+static uint8_t PackAddressAndSize(uint8_t *dst, uint8_t addressAndLengthFormatIdentifier,
+                                  size_t memoryAddress, size_t memorySize) {
+    const uint8_t numMemorySizeBytes = (addressAndLengthFormatIdentifier & 0xF0) >> 4;
+    const uint8_t numMemoryAddressBytes = addressAndLengthFormatIdentifier & 0x0F;
+    uint8_t *ptr = dst;
+    for (int i = numMemoryAddressBytes - 1; i >= 0; i--) {
+        *ptr++ = (size_t)i < sizeof(size_t) ? (uint8_t)((memoryAddress >> (8 * i)) & 0xFF) : 0;
+    }
+    for (int i = numMemorySizeBytes - 1; i >= 0; i--) {
+        *ptr++ = (size_t)i < sizeof(size_t) ? (uint8_t)((memorySize >> (8 * i)) & 0xFF) : 0;
+    }
+    return (uint8_t)(ptr - dst);
+}
+
+/**
+ * @brief
+ *
+ * @param client
+ * @param addressAndLengthFormatIdentifier
+ * @param memoryAddress
+ * @param memorySize
+ * @return UDSErr_t
+ * @addtogroup readMemByAddr_0x23
+ */
+UDSErr_t UDSSendReadMemoryByAddress(UDSClient_t *client, uint8_t addressAndLengthFormatIdentifier,
+                                    size_t memoryAddress, size_t memorySize) {
+    UDSErr_t err = PreRequestCheck(client);
+    if (err) {
+        return err;
+    }
+    if (0 == (addressAndLengthFormatIdentifier & 0x0F) ||
+        0 == (addressAndLengthFormatIdentifier & 0xF0)) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    client->send_buf[0] = kSID_READ_MEMORY_BY_ADDRESS;
+    client->send_buf[1] = addressAndLengthFormatIdentifier;
+    client->send_size =
+        (uint16_t)(2 + PackAddressAndSize(&client->send_buf[2], addressAndLengthFormatIdentifier,
+                                          memoryAddress, memorySize));
+    return SendRequest(client);
+}
+
 /**
  * @brief
  *
@@ -608,12 +1008,14 @@ UDSErr_t UDSSendRequestFileTransfer(UDSClient_t *client, uint8_t mode, const cha
     }
     uint16_t filePathLen = (uint16_t)filePathLenSize;
 
+    bool hasFileSize =
+        (mode == UDS_MOOP_ADDFILE) || (mode == UDS_MOOP_REPLFILE) || (mode == UDS_MOOP_RSFILE);
     uint8_t fileSizeBytes = 0;
-    if ((mode == UDS_MOOP_ADDFILE) || (mode == UDS_MOOP_REPLFILE)) {
+    if (hasFileSize) {
         fileSizeBytes = fileSizeParameterLength;
     }
     size_t bufSize = 5 + filePathLen + fileSizeBytes + fileSizeBytes;
-    if ((mode == UDS_MOOP_ADDFILE) || (mode == UDS_MOOP_REPLFILE) || (mode == UDS_MOOP_RDFILE)) {
+    if (hasFileSize || (mode == UDS_MOOP_RDFILE)) {
         bufSize += 1;
     }
     if (sizeof(client->send_buf) < bufSize)
@@ -626,10 +1028,10 @@ UDSErr_t UDSSendRequestFileTransfer(UDSClient_t *client, uint8_t mode, const cha
     if (filePathLen > sizeof(client->send_buf) - 4)
         return UDS_ERR_BUFSIZ;
     memcpy(&client->send_buf[4], filePath, filePathLen);
-    if ((mode == UDS_MOOP_ADDFILE) || (mode == UDS_MOOP_REPLFILE) || (mode == UDS_MOOP_RDFILE)) {
+    if (hasFileSize || (mode == UDS_MOOP_RDFILE)) {
         client->send_buf[4 + filePathLen] = dataFormatIdentifier;
     }
-    if ((mode == UDS_MOOP_ADDFILE) || (mode == UDS_MOOP_REPLFILE)) {
+    if (hasFileSize) {
         client->send_buf[5 + filePathLen] = fileSizeParameterLength;
         uint8_t *ptr = &client->send_buf[6 + filePathLen];
         for (int i = fileSizeParameterLength - 1; i >= 0; i--) {
@@ -755,6 +1157,52 @@ UDSErr_t UDSUnpackSecurityAccessResponse(const UDSClient_t *client,
     return UDS_OK;
 }
 
+/**
+ * @brief
+ *
+ * @param client
+ * @param resp
+ * @return UDSErr_t
+ * @addtogroup accessTimingParameter_0x83
+ */
+UDSErr_t UDSUnpackAccessTimingParameterResponse(const UDSClient_t *client,
+                                                struct AccessTimingParameterResponse *resp) {
+    if (NULL == client || NULL == resp) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    if (UDS_RESPONSE_SID_OF(kSID_ACCESS_TIMING_PARAMETER) != client->recv_buf[0]) {
+        return UDS_ERR_SID_MISMATCH;
+    }
+    if (client->recv_size < UDS_0X83_RESP_BASE_LEN) {
+        return UDS_ERR_RESP_TOO_SHORT;
+    }
+    memset(resp, 0, sizeof(*resp));
+    resp->timingParameterAccessType = client->recv_buf[1];
+    size_t records = 0;
+    switch (client->recv_buf[1] & 0x7F) {
+    case UDS_LEV_ATP_RETPS:
+        records = 2;
+        break;
+    case UDS_LEV_ATP_RCATP:
+        records = 1;
+        break;
+    default:
+        return UDS_OK;
+    }
+    if (client->recv_size < UDS_0X83_RESP_BASE_LEN + records * UDS_0X83_TIMING_RECORD_LEN) {
+        return UDS_ERR_RESP_TOO_SHORT;
+    }
+    const uint8_t *rec = &client->recv_buf[UDS_0X83_RESP_BASE_LEN];
+    resp->p2_ms = (uint16_t)((rec[0] << 8) | rec[1]);
+    resp->p2_star_ms = (uint32_t)((rec[2] << 8) | rec[3]) * 10;
+    if (2 == records) {
+        rec += UDS_0X83_TIMING_RECORD_LEN;
+        resp->p2_max_ms = (uint16_t)((rec[0] << 8) | rec[1]);
+        resp->p2_star_max_ms = (uint32_t)((rec[2] << 8) | rec[3]) * 10;
+    }
+    return UDS_OK;
+}
+
 /**
  * @brief
  *
@@ -783,6 +1231,33 @@ UDSErr_t UDSUnpackRoutineControlResponse(const UDSClient_t *client,
     return UDS_OK;
 }
 
+/* 0x74 and 0x75 responses share the same layout */
+static UDSErr_t UnpackMaxNumberOfBlockLength(const UDSClient_t *client, uint8_t sid,
+                                             struct RequestDownloadResponse *resp) {
+    if (NULL == client || NULL == resp) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    if (UDS_RESPONSE_SID_OF(sid) != client->recv_buf[0]) {
+        return UDS_ERR_SID_MISMATCH;
+    }
+    if (client->recv_size < UDS_0X34_RESP_BASE_LEN) {
+        return UDS_ERR_RESP_TOO_SHORT;
+    }
+    uint8_t maxNumberOfBlockLengthSize = (client->recv_buf[1] & 0xF0) >> 4;
+
+    if (sizeof(resp->maxNumberOfBlockLength) < maxNumberOfBlockLengthSize) {
+        UDS_LOGI(__FILE__, "WARNING: sizeof(maxNumberOfBlockLength) > sizeof(size_t)");
+        return UDS_FAIL;
+    }
+    resp->maxNumberOfBlockLength = 0;
+    for (uint8_t byteIdx = 0; byteIdx < maxNumberOfBlockLengthSize; byteIdx++) {
+        uint8_t byte = client->recv_buf[UDS_0X34_RESP_BASE_LEN + byteIdx];
+        uint8_t shiftBytes = maxNumberOfBlockLengthSize - 1 - byteIdx;
+        resp->maxNumberOfBlockLength |= byte << (8 * shiftBytes);
+    }
+    return UDS_OK;
+}
+
 /**
  * @brief
  *
@@ -793,36 +1268,752 @@ UDSErr_t UDSUnpackRoutineControlResponse(const UDSClient_t *client,
  */
 UDSErr_t UDSUnpackRequestDownloadResponse(const UDSClient_t *client,
                                           struct RequestDownloadResponse *resp) {
+    return UnpackMaxNumberOfBlockLength(client, kSID_REQUEST_DOWNLOAD, resp);
+}
+
+/**
+ * @brief Unpack the response to RequestFileTransfer
+ *
+ * @param client
+ * @param resp
+ * @return UDSErr_t
+ * @addtogroup requestFileTransfer_0x38
+ */
+UDSErr_t UDSUnpackRequestFileTransferResponse(const UDSClient_t *client,
+                                              struct RequestFileTransferResponse *resp) {
     if (NULL == client || NULL == resp) {
         return UDS_ERR_INVALID_ARG;
     }
-    if (UDS_RESPONSE_SID_OF(kSID_REQUEST_DOWNLOAD) != client->recv_buf[0]) {
+    if (UDS_RESPONSE_SID_OF(kSID_REQUEST_FILE_TRANSFER) != client->recv_buf[0]) {
         return UDS_ERR_SID_MISMATCH;
     }
-    if (client->recv_size < UDS_0X34_RESP_BASE_LEN) {
+    if (client->recv_size < UDS_0X38_RESP_BASE_LEN) {
         return UDS_ERR_RESP_TOO_SHORT;
     }
-    uint8_t maxNumberOfBlockLengthSize = (client->recv_buf[1] & 0xF0) >> 4;
-
+    resp->modeOfOperation = client->recv_buf[1];
+    uint8_t maxNumberOfBlockLengthSize = client->recv_buf[2];
     if (sizeof(resp->maxNumberOfBlockLength) < maxNumberOfBlockLengthSize) {
         UDS_LOGI(__FILE__, "WARNING: sizeof(maxNumberOfBlockLength) > sizeof(size_t)");
         return UDS_FAIL;
     }
+    size_t idx = UDS_0X38_RESP_BASE_LEN;
+    size_t need = idx + maxNumberOfBlockLengthSize + 1;
+    if (UDS_MOOP_RSFILE == resp->modeOfOperation) {
+        need += 8;
+    }
+    if (client->recv_size < need) {
+        return UDS_ERR_RESP_TOO_SHORT;
+    }
+
     resp->maxNumberOfBlockLength = 0;
     for (uint8_t byteIdx = 0; byteIdx < maxNumberOfBlockLengthSize; byteIdx++) {
-        uint8_t byte = client->recv_buf[UDS_0X34_RESP_BASE_LEN + byteIdx];
-        uint8_t shiftBytes = maxNumberOfBlockLengthSize - 1 - byteIdx;
-        resp->maxNumberOfBlockLength |= byte << (8 * shiftBytes);
+        resp->maxNumberOfBlockLength = resp->maxNumberOfBlockLength << 8 | client->recv_buf[idx++];
+    }
+    resp->dataFormatIdentifier = client->recv_buf[idx++];
+    resp->filePosition = 0;
+    if (UDS_MOOP_RSFILE == resp->modeOfOperation) {
+        for (uint8_t byteIdx = 0; byteIdx < 8; byteIdx++) {
+            resp->filePosition = resp->filePosition << 8 | client->recv_buf[idx++];
+        }
+    }
+    return UDS_OK;
+}
+
+static UDSErr_t DownloadFail(UDSClient_t *client, UDSErr_t err) {
+    UDS_LOGI(__FILE__, "download failed at source offset %zu: %s (%d)", client->download.offset,
+             UDSErrToStr(err), err);
+    client->download.state = UDS_DOWNLOAD_FAILED;
+    client->download.err = err;
+    return err;
+}
+
+static UDSErr_t DownloadSendRequest(UDSClient_t *client) {
+    // the engine relies on responses, so options like UDS_SUPPRESS_POS_RESP must not apply
+    client->options = 0;
+    client->recv_size = 0;
+    return SendRequest(client);
+}
+
+/* read the next `len` bytes of the source */
+static UDSErr_t DownloadRead(UDSDownload_t *dl, uint8_t *dst, size_t len) {
+    const UDSDownloadSource_t *src = &dl->src;
+    if (0 == len) {
+        return UDS_OK;
+    }
+    if (src->data) {
+        memcpy(dst, src->data + dl->offset, len);
+        dl->offset += len;
+        return UDS_OK;
+    }
+
+    if (NULL == src->readahead || len > src->readaheadSize) {
+        ssize_t ret = src->read(src->ctx, dl->offset, dst, len);
+        if (ret != (ssize_t)len) {
+            return UDS_FAIL;
+        }
+        dl->offset += len;
+        return UDS_OK;
+    }
+
+    if (dl->offset < dl->raOffset || dl->offset + len > dl->raOffset + dl->raLen) {
+        size_t want = src->size - dl->offset;
+        if (want > src->readaheadSize) {
+            want = src->readaheadSize;
+        }
+        ssize_t ret = src->read(src->ctx, dl->offset, src->readahead, want);
+        if (ret < (ssize_t)len) {
+            dl->raLen = 0;
+            return UDS_FAIL;
+        }
+        dl->raOffset = dl->offset;
+        dl->raLen = (size_t)ret;
+    }
+    memcpy(dst, src->readahead + (dl->offset - dl->raOffset), len);
+    dl->offset += len;
+    return UDS_OK;
+}
+
+#if UDS_CLIENT_DOWNLOAD_COMPRESS
+/* fill `dst` with compressed data, topping up the encoder from the source as it drains */
+static UDSErr_t DownloadCompress(UDSDownload_t *dl, uint8_t *dst, size_t size, size_t *len) {
+    *len = 0;
+    for (;;) {
+        uint8_t *in = NULL;
+        size_t space = UDSLZEncoderSpace(&dl->lz, &in);
+        if (space > dl->src.size - dl->offset) {
+            space = dl->src.size - dl->offset;
+        }
+        UDSErr_t err = DownloadRead(dl, in, space);
+        if (err) {
+            return err;
+        }
+        UDSLZEncoderAdd(&dl->lz, space);
+
+        size_t n = UDSLZEncode(&dl->lz, dst + *len, size - *len, dl->offset >= dl->src.size);
+        if (0 == n) {
+            return UDS_OK;
+        }
+        *len += n;
+    }
+}
+#endif
+
+static UDSErr_t DownloadSendNext(UDSClient_t *client) {
+    UDSDownload_t *dl = &client->download;
+    uint8_t *dst = &client->send_buf[UDS_0X36_REQ_BASE_LEN];
+    size_t room = dl->blockLength - UDS_0X36_REQ_BASE_LEN;
+    size_t len = 0;
+    UDSErr_t err = UDS_OK;
+
+#if UDS_CLIENT_DOWNLOAD_COMPRESS
+    if (dl->compress) {
+        err = DownloadCompress(dl, dst, room, &len);
+    } else
+#endif
+    {
+        len = dl->src.size - dl->offset;
+        if (len > room) {
+            len = room;
+        }
+        err = DownloadRead(dl, dst, len);
+    }
+    if (err) {
+        return err;
+    }
+
+    if (0 == len) {
+        client->send_buf[0] = kSID_REQUEST_TRANSFER_EXIT;
+        client->send_size = 1;
+        dl->state = UDS_DOWNLOAD_TRANSFER_EXIT;
+        return DownloadSendRequest(client);
+    }
+
+    // the counter starts at 0x01 and wraps from 0xFF to 0x00 (ISO14229-1:2020 14.5.2.1)
+    dl->sequenceCounter++;
+    client->send_buf[0] = kSID_TRANSFER_DATA;
+    client->send_buf[1] = dl->sequenceCounter;
+    client->send_size = (uint16_t)(UDS_0X36_REQ_BASE_LEN + len);
+    dl->pending = (uint16_t)len;
+    dl->blockTime = UDSMillis();
+    dl->state = UDS_DOWNLOAD_TRANSFER_DATA;
+    return DownloadSendRequest(client);
+}
+
+static void DownloadUpdateStats(UDSDownload_t *dl) {
+    UDSDownloadStats_t *stats = &dl->stats;
+    stats->imageBytes = dl->offset;
+    stats->elapsedMs = UDSMillis() - dl->startTime;
+    uint32_t ms = stats->elapsedMs ? stats->elapsedMs : 1;
+    stats->bytesPerSec =
+        (uint32_t)((uint64_t)(stats->imageBytes - stats->startOffset) * 1000U / ms);
+}
+
+/**
+ * @brief advance the download engine once the outstanding request has completed
+ * @param client
+ * @param err result of PollLowLevel
+ * @return UDSErr_t
+ */
+static UDSErr_t PollDownload(UDSClient_t *client, UDSErr_t err) {
+    UDSDownload_t *dl = &client->download;
+
+    if (!DownloadInProgress(client)) {
+        return err;
+    }
+    if (UDS_OK != err && UDS_NRC_RequestCorrectlyReceived_ResponsePending != err) {
+        return DownloadFail(client, err);
+    }
+    if (STATE_IDLE != client->state) {
+        return err;
+    }
+    if (0 == client->recv_size) {
+        return DownloadFail(client, UDS_ERR_MISUSE);
+    }
+
+    switch (dl->state) {
+    case UDS_DOWNLOAD_REQUEST_DOWNLOAD: {
+        struct RequestDownloadResponse resp = {0};
+        if (dl->modeOfOperation) {
+            struct RequestFileTransferResponse file = {0};
+            err = UDSUnpackRequestFileTransferResponse(client, &file);
+            if (err) {
+                return DownloadFail(client, err);
+            }
+            if (file.filePosition > dl->src.size) {
+                UDS_LOGE(__FILE__, "filePosition %" PRIu64 " is past the end of the image",
+                         file.filePosition);
+                return DownloadFail(client, UDS_FAIL);
+            }
+            // ResumeFile: skip what the server already has
+            dl->offset = (size_t)file.filePosition;
+            dl->stats.startOffset = dl->offset;
+            resp.maxNumberOfBlockLength = file.maxNumberOfBlockLength;
+        } else {
+            err = UDSUnpackRequestDownloadResponse(client, &resp);
+            if (err) {
+                return DownloadFail(client, err);
+            }
+        }
+        if (resp.maxNumberOfBlockLength <= UDS_0X36_REQ_BASE_LEN) {
+            UDS_LOGE(__FILE__, "maxNumberOfBlockLength %zu too small", resp.maxNumberOfBlockLength);
+            return DownloadFail(client, UDS_FAIL);
+        }
+#if UDS_CLIENT_DOWNLOAD_COMPRESS
+        if (dl->compress &&
+            resp.maxNumberOfBlockLength < UDS_0X36_REQ_BASE_LEN + UDS_LZ_MAX_GROUP_SIZE) {
+            UDS_LOGE(__FILE__, "maxNumberOfBlockLength %zu too small for compressed data",
+                     resp.maxNumberOfBlockLength);
+            return DownloadFail(client, UDS_FAIL);
+        }
+#endif
+        size_t blockLength = resp.maxNumberOfBlockLength;
+        if (blockLength > sizeof(client->send_buf)) {
+            blockLength = sizeof(client->send_buf);
+        }
+        dl->blockLength = (uint16_t)blockLength;
+        break;
+    }
+    case UDS_DOWNLOAD_TRANSFER_DATA: {
+        if (client->recv_size < UDS_0X36_RESP_BASE_LEN) {
+            return DownloadFail(client, UDS_ERR_RESP_TOO_SHORT);
+        }
+        if (client->recv_buf[1] != dl->sequenceCounter) {
+            return DownloadFail(client, UDS_ERR_SUBFUNCTION_MISMATCH);
+        }
+        UDSDownloadStats_t *stats = &dl->stats;
+        uint32_t latency = UDSMillis() - dl->blockTime;
+        if (0 == stats->blocks || latency < stats->minBlockMs) {
+            stats->minBlockMs = latency;
+        }
+        if (latency > stats->maxBlockMs) {
+            stats->maxBlockMs = latency;
+        }
+        stats->lastBlockMs = latency;
+        stats->blocks++;
+        stats->bytes += dl->pending;
+        dl->pending = 0;
+        DownloadUpdateStats(dl);
+        break;
+    }
+    case UDS_DOWNLOAD_TRANSFER_EXIT:
+        DownloadUpdateStats(dl);
+        dl->state = UDS_DOWNLOAD_DONE;
+        UDS_LOGI(__FILE__, "downloaded %zu bytes in %" PRIu32 " ms", dl->stats.bytes,
+                 dl->stats.elapsedMs);
+        client->fn(client, UDS_EVT_DownloadComplete, &dl->stats);
+        return UDS_OK;
+    default:
+        UDS_ASSERT(0);
+        return UDS_OK;
+    }
+
+    err = DownloadSendNext(client);
+    if (UDS_OK != err) {
+        return DownloadFail(client, err);
+    }
+    return UDS_OK;
+}
+
+UDSErr_t UDSStartDownload(UDSClient_t *client, uint8_t dataFormatIdentifier,
+                          uint8_t addressAndLengthFormatIdentifier, size_t memoryAddress,
+                          const UDSDownloadSource_t *src) {
+    if (NULL == client || NULL == src || (NULL == src->data && NULL == src->read) ||
+        (NULL == src->readahead && src->readaheadSize > 0)) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    client->options = 0;
+    UDSErr_t err = UDSSendRequestDownload(client, dataFormatIdentifier,
+                                          addressAndLengthFormatIdentifier, memoryAddress,
+                                          src->size);
+    if (err) {
+        return err;
+    }
+    memset(&client->download, 0, sizeof(client->download));
+    client->download.src = *src;
+    client->download.state = UDS_DOWNLOAD_REQUEST_DOWNLOAD;
+    client->download.startTime = UDSMillis();
+#if UDS_CLIENT_DOWNLOAD_COMPRESS
+    client->download.compress = UDS_LZ_COMPRESSION_METHOD == (dataFormatIdentifier >> 4);
+    UDSLZEncoderInit(&client->download.lz);
+#endif
+    return UDS_OK;
+}
+
+UDSErr_t UDSStartFileDownload(UDSClient_t *client, uint8_t modeOfOperation, const char *filePath,
+                              uint8_t dataFormatIdentifier, const UDSDownloadSource_t *src) {
+    if (NULL == client || NULL == src || (NULL == src->data && NULL == src->read) ||
+        (NULL == src->readahead && src->readaheadSize > 0)) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    if (UDS_MOOP_ADDFILE != modeOfOperation && UDS_MOOP_REPLFILE != modeOfOperation &&
+        UDS_MOOP_RSFILE != modeOfOperation) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    uint8_t fileSizeParameterLength = (uint64_t)src->size > UINT32_MAX ? 8 : 4;
+    client->options = 0;
+    UDSErr_t err = UDSSendRequestFileTransfer(client, modeOfOperation, filePath,
+                                              dataFormatIdentifier, fileSizeParameterLength,
+                                              src->size, src->size);
+    if (err) {
+        return err;
+    }
+    memset(&client->download, 0, sizeof(client->download));
+    client->download.src = *src;
+    client->download.modeOfOperation = modeOfOperation;
+    client->download.state = UDS_DOWNLOAD_REQUEST_DOWNLOAD;
+    client->download.startTime = UDSMillis();
+    return UDS_OK;
+}
+
+static ssize_t DownloadFileRead(void *ctx, size_t offset, uint8_t *dst, size_t len) {
+    (void)offset; // the engine reads sequentially
+    return (ssize_t)fread(dst, 1, len, (FILE *)ctx);
+}
+
+UDSErr_t UDSConfigDownload(UDSClient_t *client, uint8_t dataFormatIdentifier,
+                           uint8_t addressAndLengthFormatIdentifier, size_t memoryAddress,
+                           size_t memorySize, FILE *fd) {
+    if (NULL == fd) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    const UDSDownloadSource_t src = {
+        .size = memorySize,
+        .ctx = fd,
+        .read = DownloadFileRead,
+    };
+    return UDSStartDownload(client, dataFormatIdentifier, addressAndLengthFormatIdentifier,
+                            memoryAddress, &src);
+}
+
+static UDSErr_t UploadFail(UDSClient_t *client, UDSErr_t err) {
+    UDS_LOGI(__FILE__, "upload failed at offset %zu: %s (%d)", client->upload.offset,
+             UDSErrToStr(err), err);
+    client->upload.held = false;
+    client->upload.state = UDS_UPLOAD_FAILED;
+    client->upload.err = err;
+    return err;
+}
+
+static UDSErr_t UploadSendRequest(UDSClient_t *client) {
+    // the engine relies on responses, so options like UDS_SUPPRESS_POS_RESP must not apply
+    client->options = 0;
+    client->recv_size = 0;
+    return SendRequest(client);
+}
+
+/* bytes asked for by the next 0x23 request */
+static size_t ReadMemoryChunk(const UDSClient_t *client, const UDSUploadSink_t *sink,
+                              size_t offset) {
+    size_t chunk = sizeof(client->recv_buf) - UDS_0X23_RESP_BASE_LEN;
+    if (chunk > UINT16_MAX) {
+        chunk = UINT16_MAX;
+    }
+    if (sink->chunkSize && sink->chunkSize < chunk) {
+        chunk = sink->chunkSize;
+    }
+    if (chunk > sink->size - offset) {
+        chunk = sink->size - offset;
+    }
+    return chunk;
+}
+
+/* request the next block, or end the transfer once every block has been received */
+static UDSErr_t UploadSendNext(UDSClient_t *client) {
+    UDSUpload_t *ul = &client->upload;
+    if (ul->readMemory) {
+        size_t len = ReadMemoryChunk(client, &ul->sink, ul->offset);
+        client->send_buf[0] = kSID_READ_MEMORY_BY_ADDRESS;
+        client->send_buf[1] = ul->alfid;
+        client->send_size = (uint16_t)(2 + PackAddressAndSize(&client->send_buf[2], ul->alfid,
+                                                              ul->memoryAddress + ul->offset, len));
+        ul->pending = (uint16_t)len;
+        ul->state = UDS_UPLOAD_READ_MEMORY;
+    } else if (ul->offset >= ul->sink.size) {
+        client->send_buf[0] = kSID_REQUEST_TRANSFER_EXIT;
+        client->send_size = 1;
+        ul->state = UDS_UPLOAD_TRANSFER_EXIT;
+    } else {
+        // the counter starts at 0x01 and wraps from 0xFF to 0x00 (ISO14229-1:2020 14.5.2.1)
+        ul->sequenceCounter++;
+        client->send_buf[0] = kSID_TRANSFER_DATA;
+        client->send_buf[1] = ul->sequenceCounter;
+        client->send_size = UDS_0X36_REQ_BASE_LEN;
+        ul->state = UDS_UPLOAD_TRANSFER_DATA;
+    }
+    ul->blockTime = UDSMillis();
+    return UploadSendRequest(client);
+}
+
+static UDSErr_t UploadWrite(UDSUpload_t *ul, size_t offset, const uint8_t *block, size_t len) {
+    const UDSUploadSink_t *sink = &ul->sink;
+    if (sink->data) {
+        memcpy(sink->data + offset, block, len);
+        return UDS_OK;
     }
+    return sink->write(sink->ctx, offset, block, len) == (ssize_t)len ? UDS_OK : UDS_FAIL;
+}
+
+static void UploadUpdateStats(UDSUpload_t *ul) {
+    UDSUploadStats_t *stats = &ul->stats;
+    stats->elapsedMs = UDSMillis() - ul->startTime;
+    uint32_t ms = stats->elapsedMs ? stats->elapsedMs : 1;
+    stats->bytesPerSec = (uint32_t)((uint64_t)stats->bytes * 1000U / ms);
+}
+
+static UDSErr_t UploadDone(UDSClient_t *client) {
+    UDSUpload_t *ul = &client->upload;
+    UploadUpdateStats(ul);
+    ul->state = UDS_UPLOAD_DONE;
+    UDS_LOGI(__FILE__, "uploaded %zu bytes in %" PRIu32 " ms", ul->stats.bytes,
+             ul->stats.elapsedMs);
+    client->fn(client, UDS_EVT_UploadComplete, &ul->stats);
     return UDS_OK;
 }
 
-UDSErr_t UDSClientPoll(UDSClient_t *client) {
+/**
+ * @brief advance the upload engine once the outstanding request has completed
+ * @param client
+ * @param err result of PollLowLevel
+ * @return UDSErr_t
+ */
+static UDSErr_t PollUpload(UDSClient_t *client, UDSErr_t err) {
+    UDSUpload_t *ul = &client->upload;
+
+    if (!UploadInProgress(client)) {
+        return err;
+    }
+    if (UDS_UPLOAD_REQUEST_UPLOAD == ul->state && 0 == ul->dataFormatIdentifier &&
+        (UDS_NRC_ServiceNotSupported == err || UDS_NRC_ServiceNotSupportedInActiveSession == err)) {
+        UDS_LOGI(__FILE__, "RequestUpload not supported, reading with ReadMemoryByAddress");
+        changeState(client, STATE_IDLE);
+        ul->readMemory = true;
+        err = UploadSendNext(client);
+        return err ? UploadFail(client, err) : UDS_OK;
+    }
+    if (UDS_OK != err && UDS_NRC_RequestCorrectlyReceived_ResponsePending != err) {
+        return UploadFail(client, err);
+    }
+    if (STATE_IDLE != client->state) {
+        return err;
+    }
+    if (0 == client->recv_size) {
+        return UploadFail(client, UDS_ERR_MISUSE);
+    }
+
+    const uint8_t *block = NULL;
+    size_t len = 0;
+    switch (ul->state) {
+    case UDS_UPLOAD_REQUEST_UPLOAD: {
+        struct RequestDownloadResponse resp = {0};
+        err = UnpackMaxNumberOfBlockLength(client, kSID_REQUEST_UPLOAD, &resp);
+        if (err) {
+            return UploadFail(client, err);
+        }
+        if (resp.maxNumberOfBlockLength <= UDS_0X36_RESP_BASE_LEN) {
+            UDS_LOGE(__FILE__, "maxNumberOfBlockLength %zu too small", resp.maxNumberOfBlockLength);
+            return UploadFail(client, UDS_FAIL);
+        }
+        if (resp.maxNumberOfBlockLength > sizeof(client->recv_buf)) {
+            UDS_LOGE(__FILE__, "maxNumberOfBlockLength %zu does not fit the receive buffer",
+                     resp.maxNumberOfBlockLength);
+            return UploadFail(client, UDS_ERR_BUFSIZ);
+        }
+        break;
+    }
+    case UDS_UPLOAD_TRANSFER_DATA:
+        if (client->recv_size < UDS_0X36_RESP_BASE_LEN) {
+            return UploadFail(client, UDS_ERR_RESP_TOO_SHORT);
+        }
+        if (client->recv_buf[1] != ul->sequenceCounter) {
+            return UploadFail(client, UDS_ERR_SUBFUNCTION_MISMATCH);
+        }
+        block = &client->recv_buf[UDS_0X36_RESP_BASE_LEN];
+        len = client->recv_size - UDS_0X36_RESP_BASE_LEN;
+        break;
+    case UDS_UPLOAD_READ_MEMORY:
+        block = &client->recv_buf[UDS_0X23_RESP_BASE_LEN];
+        len = client->recv_size - UDS_0X23_RESP_BASE_LEN;
+        if (len != ul->pending) {
+            UDS_LOGE(__FILE__, "asked for %" PRIu16 " bytes, got %zu", ul->pending, len);
+            return UploadFail(client, UDS_FAIL);
+        }
+        break;
+    case UDS_UPLOAD_TRANSFER_EXIT:
+        return UploadDone(client);
+    default:
+        UDS_ASSERT(0);
+        return UDS_OK;
+    }
+
+    const size_t offset = ul->offset;
+    if (block) {
+        if (0 == len || len > ul->sink.size - offset) {
+            UDS_LOGE(__FILE__, "block of %zu bytes at offset %zu does not fit the range", len,
+                     offset);
+            return UploadFail(client, UDS_FAIL);
+        }
+        UDSUploadStats_t *stats = &ul->stats;
+        uint32_t latency = UDSMillis() - ul->blockTime;
+        if (0 == stats->blocks || latency < stats->minBlockMs) {
+            stats->minBlockMs = latency;
+        }
+        if (latency > stats->maxBlockMs) {
+            stats->maxBlockMs = latency;
+        }
+        stats->lastBlockMs = latency;
+        stats->blocks++;
+        ul->offset += len;
+    }
+
+    // ask for the next block first, so that the server reads it while this one is written out
+    const bool last = ul->readMemory && ul->offset >= ul->sink.size;
+    if (!last) {
+        ul->held = NULL != block;
+        err = UploadSendNext(client);
+        if (err) {
+            return UploadFail(client, err);
+        }
+    }
+    if (block) {
+        err = UploadWrite(ul, offset, block, len);
+        ul->held = false;
+        if (err) {
+            return UploadFail(client, err);
+        }
+        ul->stats.bytes += len;
+        UploadUpdateStats(ul);
+    }
+    return last ? UploadDone(client) : UDS_OK;
+}
+
+static bool UploadSinkValid(const UDSUploadSink_t *sink) {
+    return NULL != sink && (NULL != sink->data || NULL != sink->write) && sink->size > 0;
+}
+
+static void UploadBegin(UDSClient_t *client, uint8_t addressAndLengthFormatIdentifier,
+                        size_t memoryAddress, const UDSUploadSink_t *sink) {
+    memset(&client->upload, 0, sizeof(client->upload));
+    client->upload.sink = *sink;
+    client->upload.alfid = addressAndLengthFormatIdentifier;
+    client->upload.memoryAddress = memoryAddress;
+    client->upload.startTime = UDSMillis();
+    client->upload.blockTime = client->upload.startTime;
+}
+
+UDSErr_t UDSStartUpload(UDSClient_t *client, uint8_t dataFormatIdentifier,
+                        uint8_t addressAndLengthFormatIdentifier, size_t memoryAddress,
+                        const UDSUploadSink_t *sink) {
+    if (NULL == client || !UploadSinkValid(sink)) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    client->options = 0;
+    UDSErr_t err = UDSSendRequestUpload(client, dataFormatIdentifier,
+                                        addressAndLengthFormatIdentifier, memoryAddress,
+                                        sink->size);
+    if (err) {
+        return err;
+    }
+    UploadBegin(client, addressAndLengthFormatIdentifier, memoryAddress, sink);
+    client->upload.dataFormatIdentifier = dataFormatIdentifier;
+    client->upload.state = UDS_UPLOAD_REQUEST_UPLOAD;
+    return UDS_OK;
+}
+
+UDSErr_t UDSStartReadMemory(UDSClient_t *client, uint8_t addressAndLengthFormatIdentifier,
+                            size_t memoryAddress, const UDSUploadSink_t *sink) {
+    if (NULL == client || !UploadSinkValid(sink)) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    size_t len = ReadMemoryChunk(client, sink, 0);
+    client->options = 0;
+    UDSErr_t err =
+        UDSSendReadMemoryByAddress(client, addressAndLengthFormatIdentifier, memoryAddress, len);
+    if (err) {
+        return err;
+    }
+    UploadBegin(client, addressAndLengthFormatIdentifier, memoryAddress, sink);
+    client->upload.readMemory = true;
+    client->upload.pending = (uint16_t)len;
+    client->upload.state = UDS_UPLOAD_READ_MEMORY;
+    return UDS_OK;
+}
+
+#if UDS_SYS == UDS_SYS_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+UDSErr_t UDSDownloadSourceMapFile(UDSDownloadSource_t *src, const char *path) {
+    if (NULL == src || NULL == path) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        UDS_LOGE(__FILE__, "failed to open %s", path);
+        return UDS_FAIL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size <= 0) {
+        close(fd);
+        return UDS_FAIL;
+    }
+    size_t size = (size_t)st.st_size;
+    void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (MAP_FAILED == data) {
+        UDS_LOGE(__FILE__, "failed to map %s", path);
+        return UDS_FAIL;
+    }
+    // let the kernel read ahead of the engine
+    posix_madvise(data, size, POSIX_MADV_SEQUENTIAL);
+
+    memset(src, 0, sizeof(*src));
+    src->data = data;
+    src->size = size;
+    return UDS_OK;
+}
+
+void UDSDownloadSourceUnmapFile(UDSDownloadSource_t *src) {
+    if (NULL == src || NULL == src->data) {
+        return;
+    }
+    munmap((void *)src->data, src->size);
+    src->data = NULL;
+    src->size = 0;
+}
+
+UDSErr_t UDSUploadSinkMapFile(UDSUploadSink_t *sink, const char *path, size_t size) {
+    if (NULL == sink || NULL == path || 0 == size) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        UDS_LOGE(__FILE__, "failed to create %s", path);
+        return UDS_FAIL;
+    }
+    if (ftruncate(fd, (off_t)size) < 0) {
+        close(fd);
+        return UDS_FAIL;
+    }
+    void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == data) {
+        UDS_LOGE(__FILE__, "failed to map %s", path);
+        return UDS_FAIL;
+    }
+    posix_madvise(data, size, POSIX_MADV_SEQUENTIAL);
+
+    memset(sink, 0, sizeof(*sink));
+    sink->data = data;
+    sink->size = size;
+    return UDS_OK;
+}
+
+void UDSUploadSinkUnmapFile(UDSUploadSink_t *sink) {
+    if (NULL == sink || NULL == sink->data) {
+        return;
+    }
+    msync(sink->data, sink->size, MS_SYNC);
+    munmap(sink->data, sink->size);
+    sink->data = NULL;
+    sink->size = 0;
+}
+#endif
+
+/**
+ * @brief Remove the oldest queued request and call its completion callback
+ */
+static void QueueComplete(UDSClient_t *client, UDSErr_t err) {
+    UDSClientRequest_t req = client->queue[client->queue_head];
+    client->queue_head = (uint8_t)((client->queue_head + 1) % UDS_CLIENT_QUEUE_LEN);
+    client->queue_len--;
+    client->queue_active = false;
+    if (req.done) {
+        req.done(client, err, req.ctx);
+    }
+}
+
+/**
+ * @brief Send queued requests until one is in flight or the queue is empty
+ */
+static void QueueSendNext(UDSClient_t *client) {
+    while (client->queue_len > 0 && !client->queue_active && STATE_IDLE == client->state &&
+           !DownloadInProgress(client) && !UploadInProgress(client)) {
+        const UDSClientRequest_t *req = &client->queue[client->queue_head];
+        client->options = client->defaultOptions | req->options;
+        client->queue_active = true;
+        UDSErr_t err = UDSSendBytes(client, req->data, req->len);
+        if (err && STATE_IDLE == client->state) {
+            QueueComplete(client, err);
+        }
+    }
+}
+
+UDSErr_t UDSClientSubmit(UDSClient_t *client, const UDSClientRequest_t *req) {
+    if (NULL == client || NULL == req || NULL == req->data || 0 == req->len) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    if (client->queue_len >= UDS_CLIENT_QUEUE_LEN) {
+        return UDS_ERR_BUSY;
+    }
+    client->queue[(client->queue_head + client->queue_len) % UDS_CLIENT_QUEUE_LEN] = *req;
+    client->queue_len++;
+    QueueSendNext(client);
+    return UDS_OK;
+}
+
+UDSErr_t UDSClientPoll(UDSClient_t *client) { return UDSClientPollAt(client, UDSMillis()); }
+
+UDSErr_t UDSClientPollAt(UDSClient_t *client, uint32_t now) {
     if (NULL == client->fn) {
         return UDS_ERR_MISUSE;
     }
+    client->now = now;
 
     UDSErr_t err = PollLowLevel(client);
+    err = PollDownload(client, err);
+    err = PollUpload(client, err);
 
     if (err == UDS_OK || err == UDS_NRC_RequestCorrectlyReceived_ResponsePending) {
         ;
@@ -831,10 +2022,35 @@ UDSErr_t UDSClientPoll(UDSClient_t *client) {
         changeState(client, STATE_IDLE);
     }
 
+    if (client->queue_active && STATE_IDLE == client->state) {
+        QueueComplete(client, err);
+    }
+    QueueSendNext(client);
+
     client->fn(client, UDS_EVT_Poll, NULL);
     return err;
 }
 
+uint32_t UDSClientNextDeadlineMs(const UDSClient_t *client) {
+    return UDSClientNextDeadlineMsAt(client, UDSMillis());
+}
+
+uint32_t UDSClientNextDeadlineMsAt(const UDSClient_t *client, uint32_t now) {
+    if (NULL == client) {
+        return UDS_NO_DEADLINE;
+    }
+    switch (client->state) {
+    case STATE_SENDING:
+    case STATE_AWAIT_SEND_COMPLETE:
+        return 0;
+    case STATE_AWAIT_RESPONSE:
+    case STATE_COLLECT_RESPONSES:
+        return UDSMillisUntil(now, client->p2_timer);
+    default:
+        return UDS_NO_DEADLINE;
+    }
+}
+
 UDSErr_t UDSUnpackRDBIResponse(UDSClient_t *client, UDSRDBIVar_t *vars, uint16_t numVars) {
     uint16_t offset = UDS_0X22_RESP_BASE_LEN;
     if (client == NULL || vars == NULL) {
@@ -863,3 +2079,130 @@ UDSErr_t UDSUnpackRDBIResponse(UDSClient_t *client, UDSRDBIVar_t *vars, uint16_t
     }
     return UDS_OK;
 }
+
+static uint16_t RDBIPlanBatchEnd(const UDSRDBIPlan_t *plan, uint16_t start) {
+    size_t resp_len = UDS_0X22_RESP_BASE_LEN;
+    uint16_t i = start;
+    while (i < plan->count && i - start < UDS_CLIENT_RDBI_PLAN_MAX_DIDS) {
+        size_t record_len = sizeof(uint16_t) + plan->schema[i].len;
+        if (resp_len + record_len > plan->maxRespLen) {
+            break;
+        }
+        resp_len += record_len;
+        i++;
+    }
+    return i;
+}
+
+UDSErr_t UDSRDBIPlanInit(UDSRDBIPlan_t *plan, const UDSRDBISchemaEntry_t *schema, uint16_t count,
+                         void *dst, uint16_t maxRespLen) {
+    if (NULL == plan || NULL == schema || 0 == count || NULL == dst) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    memset(plan, 0, sizeof(*plan));
+    plan->schema = schema;
+    plan->count = count;
+    plan->dst = dst;
+#if UDS_CLIENT_RECV_BUF_SIZE < 0xFFFF
+    if (0 == maxRespLen || maxRespLen > UDS_CLIENT_RECV_BUF_SIZE) {
+        maxRespLen = UDS_CLIENT_RECV_BUF_SIZE;
+    }
+#else
+    if (0 == maxRespLen) {
+        maxRespLen = 0xFFFF;
+    }
+#endif
+    plan->maxRespLen = maxRespLen;
+
+    for (uint16_t i = 0; i < count; i = RDBIPlanBatchEnd(plan, i)) {
+        if (RDBIPlanBatchEnd(plan, i) == i) {
+            UDS_LOGW(__FILE__, "DID 0x%04x does not fit a %" PRIu16 " byte response", schema[i].did,
+                     plan->maxRespLen);
+            return UDS_ERR_BUFSIZ;
+        }
+        plan->requests++;
+    }
+    return UDS_OK;
+}
+
+/**
+ * @brief Decode a response of the plan in one pass
+ */
+static UDSErr_t RDBIPlanDecode(const UDSClient_t *client, UDSRDBIPlan_t *plan) {
+    const uint8_t *p = client->recv_buf + UDS_0X22_RESP_BASE_LEN;
+    const uint8_t *end = client->recv_buf + client->recv_size;
+    for (uint16_t i = plan->batch; i < plan->next; i++) {
+        const UDSRDBISchemaEntry_t *e = &plan->schema[i];
+        if (end - p < (ptrdiff_t)(sizeof(uint16_t) + e->len)) {
+            return UDS_ERR_RESP_TOO_SHORT;
+        }
+        if ((uint16_t)((uint16_t)(p[0] << 8) | (uint16_t)p[1]) != e->did) {
+            return UDS_ERR_DID_MISMATCH;
+        }
+        uint8_t *dst = (uint8_t *)plan->dst + e->offset;
+        if (e->UnpackFn) {
+            e->UnpackFn(dst, p + sizeof(uint16_t), e->len);
+        } else {
+            memmove(dst, p + sizeof(uint16_t), e->len);
+        }
+        p += sizeof(uint16_t) + e->len;
+        plan->decoded++;
+    }
+    return UDS_OK;
+}
+
+static void RDBIPlanDone(UDSClient_t *client, UDSErr_t err, void *ctx);
+
+static UDSErr_t RDBIPlanSubmit(UDSClient_t *client, UDSRDBIPlan_t *plan) {
+    uint16_t end = RDBIPlanBatchEnd(plan, plan->next);
+    uint16_t len = 0;
+    plan->req[len++] = kSID_READ_DATA_BY_IDENTIFIER;
+    for (uint16_t i = plan->next; i < end; i++) {
+        plan->req[len++] = (uint8_t)(plan->schema[i].did >> 8);
+        plan->req[len++] = (uint8_t)(plan->schema[i].did & 0xFF);
+    }
+    plan->batch = plan->next;
+    plan->next = end;
+    return UDSClientSubmit(client, &(UDSClientRequest_t){
+                                       .data = plan->req,
+                                       .len = len,
+                                       .done = RDBIPlanDone,
+                                       .ctx = plan,
+                                   });
+}
+
+static void RDBIPlanDone(UDSClient_t *client, UDSErr_t err, void *ctx) {
+    UDSRDBIPlan_t *plan = (UDSRDBIPlan_t *)ctx;
+    if (UDS_OK == err) {
+        err = RDBIPlanDecode(client, plan);
+    }
+    if (err) {
+        UDS_LOGW(__FILE__, "RDBI plan: request for entries %u-%u failed: %s",
+                 (unsigned)plan->batch, (unsigned)plan->next - 1, UDSErrToStr(err));
+        if (UDS_OK == plan->err) {
+            plan->err = err;
+        }
+    }
+    if (plan->next < plan->count) {
+        err = RDBIPlanSubmit(client, plan);
+        if (UDS_OK == err) {
+            return;
+        }
+        if (UDS_OK == plan->err) {
+            plan->err = err;
+        }
+    }
+    if (plan->done) {
+        plan->done(client, plan);
+    }
+}
+
+UDSErr_t UDSRDBIPlanStart(UDSClient_t *client, UDSRDBIPlan_t *plan) {
+    if (NULL == client || NULL == plan || NULL == plan->schema) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    plan->decoded = 0;
+    plan->err = UDS_OK;
+    plan->next = 0;
+    return RDBIPlanSubmit(client, plan);
+}
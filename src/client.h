@@ -4,11 +4,213 @@
 #include "config.h"
 #include "tp.h"
 #include "uds.h"
+#include "lz.h"
+#include "stats.h"
 
 #define UDS_SUPPRESS_POS_RESP 0x1  // set the suppress positive response bit
 #define UDS_FUNCTIONAL 0x2         // send the request as a functional request
+#define UDS_COLLECT_RESPONSES 0x4  // with UDS_FUNCTIONAL: collect every response until p2 expires
 #define UDS_IGNORE_SRV_TIMINGS 0x8 // ignore the server-provided p2 and p2_star
 
+/**
+ * @brief Image source for the download engine
+ * @details Either a memory span (`data` != NULL), for example an image in RAM or a file mapped with
+ * UDSDownloadSourceMapFile, or a pull callback. The callback is called with increasing offsets,
+ * starting at 0 or at the filePosition returned by a 0x38 ResumeFile. If
+ * a readahead buffer is given, the callback fills it in one call and blocks are copied out of it,
+ * otherwise each block is read straight into the client's send buffer.
+ */
+typedef struct {
+    const uint8_t *data;  /**< image in memory, or NULL to use `read` */
+    size_t size;          /**< image size in bytes (memorySize of the 0x34 request) */
+    void *ctx;            /**< user data passed to `read` */
+    uint8_t *readahead;   /**< optional readahead buffer for `read` */
+    size_t readaheadSize; /**< size of `readahead` */
+
+    /** pull callback: returns the number of bytes read, or < 0 on error */
+    ssize_t (*read)(void *ctx, size_t offset, uint8_t *dst, size_t len);
+} UDSDownloadSource_t;
+
+/**
+ * @brief Download engine progress and timings
+ */
+typedef struct {
+    size_t bytes;         /**< TransferData bytes acknowledged by the server */
+    size_t imageBytes;    /**< source offset reached. Equals startOffset + `bytes` unless
+                             compressing */
+    size_t startOffset;   /**< source offset the download started at (ResumeFile filePosition) */
+    uint32_t blocks;      /**< number of 0x36 requests acknowledged */
+    uint32_t elapsedMs;   /**< time since the 0x34 request was sent */
+    uint32_t bytesPerSec; /**< average throughput in source bytes per second since startOffset */
+    uint32_t lastBlockMs; /**< latency of the last 0x36 request, including 0x78 delays */
+    uint32_t minBlockMs;  /**< smallest 0x36 latency */
+    uint32_t maxBlockMs;  /**< largest 0x36 latency */
+} UDSDownloadStats_t;
+
+typedef enum {
+    UDS_DOWNLOAD_IDLE = 0,         /**< no download in progress */
+    UDS_DOWNLOAD_REQUEST_DOWNLOAD, /**< awaiting the 0x34 or 0x38 response */
+    UDS_DOWNLOAD_TRANSFER_DATA,    /**< awaiting a 0x36 response */
+    UDS_DOWNLOAD_TRANSFER_EXIT,    /**< awaiting the 0x37 response */
+    UDS_DOWNLOAD_DONE,             /**< the server accepted the whole image */
+    UDS_DOWNLOAD_FAILED,           /**< see `err` */
+} UDSDownloadState_t;
+
+/**
+ * @brief Download engine state. Driven by UDSClientPoll
+ */
+typedef struct {
+    UDSDownloadSource_t src;  /**< image source */
+    UDSDownloadState_t state; /**< engine state */
+    UDSErr_t err;             /**< reason for UDS_DOWNLOAD_FAILED */
+    uint8_t modeOfOperation;  /**< 0x38 modeOfOperation, or 0 when started with 0x34 */
+    uint8_t sequenceCounter;  /**< blockSequenceCounter of the last 0x36 request */
+    uint16_t blockLength;     /**< maxNumberOfBlockLength, limited to the send buffer */
+    size_t offset;            /**< bytes read from the source */
+    uint16_t pending;         /**< TransferData bytes in the outstanding 0x36 request */
+    size_t raOffset;          /**< image offset of the readahead window */
+    size_t raLen;             /**< bytes in the readahead window */
+    uint32_t startTime;       /**< time the 0x34 request was sent */
+    uint32_t blockTime;       /**< time the outstanding 0x36 request was sent */
+    UDSDownloadStats_t stats; /**< progress and timings */
+#if UDS_CLIENT_DOWNLOAD_COMPRESS
+    bool compress;     /**< the dataFormatIdentifier selects UDS_LZ_COMPRESSION_METHOD */
+    UDSLZEncoder_t lz; /**< compressor */
+#endif
+} UDSDownload_t;
+
+/**
+ * @brief Destination of the upload engine
+ * @details Either a memory span (`data` != NULL), for example a buffer or a file mapped with
+ * UDSUploadSinkMapFile, or a push callback. Each block is handed over straight from the client's
+ * receive buffer with increasing offsets, after the request for the next block has been sent, so
+ * writing it overlaps with the server reading the next one.
+ */
+typedef struct {
+    uint8_t *data;      /**< destination of at least `size` bytes, or NULL to use `write` */
+    size_t size;        /**< bytes to read (memorySize of the 0x35 or 0x23 requests) */
+    void *ctx;          /**< user data passed to `write` */
+    uint16_t chunkSize; /**< most bytes per 0x23 request, 0 to fill the receive buffer */
+
+    /** push callback: returns the number of bytes written, or < 0 on error */
+    ssize_t (*write)(void *ctx, size_t offset, const uint8_t *src, size_t len);
+} UDSUploadSink_t;
+
+/**
+ * @brief Upload engine progress and timings
+ */
+typedef struct {
+    size_t bytes;         /**< bytes received and written to the sink */
+    uint32_t blocks;      /**< number of 0x36 or 0x23 responses received */
+    uint32_t elapsedMs;   /**< time since the first request was sent */
+    uint32_t bytesPerSec; /**< average throughput */
+    uint32_t lastBlockMs; /**< latency of the last block request, including 0x78 delays */
+    uint32_t minBlockMs;  /**< smallest block latency */
+    uint32_t maxBlockMs;  /**< largest block latency */
+} UDSUploadStats_t;
+
+typedef enum {
+    UDS_UPLOAD_IDLE = 0,       /**< no upload in progress */
+    UDS_UPLOAD_REQUEST_UPLOAD, /**< awaiting the 0x35 response */
+    UDS_UPLOAD_TRANSFER_DATA,  /**< awaiting a 0x36 response */
+    UDS_UPLOAD_READ_MEMORY,    /**< awaiting a 0x23 response */
+    UDS_UPLOAD_TRANSFER_EXIT,  /**< awaiting the 0x37 response */
+    UDS_UPLOAD_DONE,           /**< the whole range was written to the sink */
+    UDS_UPLOAD_FAILED,         /**< see `err` */
+} UDSUploadState_t;
+
+/**
+ * @brief Upload engine state. Driven by UDSClientPoll
+ */
+typedef struct {
+    UDSUploadSink_t sink;         /**< destination */
+    UDSUploadState_t state;       /**< engine state */
+    UDSErr_t err;                 /**< reason for UDS_UPLOAD_FAILED */
+    uint8_t dataFormatIdentifier; /**< of the 0x35 request. 0x23 is only used when it is 0 */
+    uint8_t alfid;                /**< addressAndLengthFormatIdentifier of the 0x23 requests */
+    bool readMemory;              /**< the range is read with 0x23 instead of 0x35/0x36 */
+    uint8_t sequenceCounter;      /**< blockSequenceCounter of the last 0x36 request */
+    size_t memoryAddress;         /**< start of the range */
+    size_t offset;                /**< bytes received */
+    uint16_t pending;             /**< bytes asked for by the outstanding 0x23 request */
+    bool held;                    /**< recv_buf holds a block not yet written to the sink */
+    uint32_t startTime;           /**< time the first request was sent */
+    uint32_t blockTime;           /**< time the outstanding block request was sent */
+    UDSUploadStats_t stats;       /**< progress and timings */
+} UDSUpload_t;
+
+/**
+ * @brief A response to a functional request sent with UDS_COLLECT_RESPONSES
+ */
+typedef struct {
+    uint32_t A_SA;       /**< address of the responding server */
+    UDSErr_t err;        /**< UDS_OK, the negative response code, or why the response is invalid */
+    const uint8_t *data; /**< the response, valid until the callback returns */
+    uint16_t len;        /**< length of data */
+} UDSFunctionalResponse_t;
+
+struct UDSClient;
+
+/**
+ * @brief Called when a request submitted with UDSClientSubmit() ends
+ * @param client the response, if any, is in `client->recv_buf`
+ * @param err UDS_OK, the negative response code, or the reason the request failed
+ * @param ctx `ctx` of the request
+ */
+typedef void (*UDSRequestDoneFn)(struct UDSClient *client, UDSErr_t err, void *ctx);
+
+/**
+ * @brief A request for the client queue
+ */
+typedef struct {
+    const uint8_t *data;   /**< request bytes, must remain valid until `done` is called */
+    uint16_t len;          /**< length of data */
+    uint8_t options;       /**< request options, added to `defaultOptions` */
+    uint16_t p2_ms;        /**< p2 timeout of this request, 0 to use the client's p2_ms */
+    UDSRequestDoneFn done; /**< optional completion callback */
+    void *ctx;             /**< passed to done */
+} UDSClientRequest_t;
+
+#define UDS_DID_CACHE_STATIC 0 // ttl_ms of a value that is kept until it is invalidated
+
+/**
+ * @brief How a DID is cached
+ * @details Static values (VIN, part numbers, software versions) are kept across session changes
+ * and only dropped by an 0x11 ECUReset, a completed download or a write to the DID. Volatile values
+ * are also dropped on a session change and after `ttl_ms`.
+ */
+typedef struct {
+    uint16_t did;    /**< data identifier */
+    uint16_t len;    /**< exact length of its data record */
+    uint32_t ttl_ms; /**< UDS_DID_CACHE_STATIC, or how long a volatile value stays valid */
+} UDSDIDCachePolicy_t;
+
+/**
+ * @brief A cached data record
+ */
+typedef struct {
+    const UDSDIDCachePolicy_t *policy; /**< policy of the DID, NULL if the entry is free */
+    uint32_t sa;                       /**< address of the server that sent the value */
+    uint32_t expires;                  /**< UDSMillis() at which a volatile value expires */
+
+    uint8_t data[UDS_CLIENT_DID_CACHE_DATA_LEN]; /**< the data record */
+} UDSDIDCacheEntry_t;
+
+/**
+ * @brief Client DID response cache, keyed by (server address, DID)
+ * @details Filled from the positive responses to 0x22 requests and invalidated by the positive
+ * responses to 0x10, 0x11, 0x2E and 0x37 while attached to `client->did_cache`.
+ */
+typedef struct UDSDIDCache {
+    const UDSDIDCachePolicy_t *policies; /**< DIDs to cache. Others are never cached */
+    uint16_t numPolicies;                /**< number of entries in policies */
+    uint32_t hits;                       /**< reads served from the cache */
+    uint32_t misses;                     /**< reads that found no valid value */
+    uint16_t evict;                      /**< next entry replaced when every entry is in use */
+
+    UDSDIDCacheEntry_t entries[UDS_CLIENT_DID_CACHE_ENTRIES]; /**< cached values */
+} UDSDIDCache_t;
+
 /**
  * @brief UDS client structure
  */
@@ -18,6 +220,7 @@ typedef struct UDSClient {
     UDSTp_t *tp;         /**< transport layer handle */
 
     uint32_t p2_timer; /**< p2 timer value */
+    uint32_t now;      /**< UDSMillis() at the start of the current poll or request */
     uint8_t state;     /**< client request state */
 
     uint8_t options;        /**< current request options */
@@ -27,6 +230,25 @@ typedef struct UDSClient {
     int (*fn)(struct UDSClient *client, UDSEvent_t evt, void *ev_data); /**< callback function */
     void *fn_data; /**< user-specified function data */
 
+    UDSDownload_t download; /**< download engine (UDSStartDownload) */
+    UDSUpload_t upload;     /**< upload engine (UDSStartUpload, UDSStartReadMemory) */
+
+    UDSTp_t *const *collect_tps; /**< more transports read while collecting responses, or NULL */
+    uint8_t collect_tps_len;     /**< number of entries in collect_tps */
+    uint16_t collected;          /**< responses collected for the last functional request */
+
+    UDSDIDCache_t *did_cache; /**< optional DID response cache, or NULL */
+
+#if UDS_CLIENT_STATS
+    UDSClientStats_t stats; /**< request statistics */
+    uint32_t statsStartUs;  /**< UDSMicros() when the request in progress was sent */
+#endif
+
+    UDSClientRequest_t queue[UDS_CLIENT_QUEUE_LEN]; /**< requests from UDSClientSubmit() */
+    uint8_t queue_head;                             /**< index of the oldest request */
+    uint8_t queue_len;                              /**< number of queued requests */
+    bool queue_active;                              /**< the oldest request has been sent */
+
     uint16_t recv_size;                         /**< size of received data */
     uint16_t send_size;                         /**< size of data to send */
     uint8_t recv_buf[UDS_CLIENT_RECV_BUF_SIZE]; /**< receive buffer */
@@ -49,6 +271,16 @@ struct RequestDownloadResponse {
     size_t maxNumberOfBlockLength; /**< maximum number of block length */
 };
 
+/**
+ * @brief Request file transfer response structure
+ */
+struct RequestFileTransferResponse {
+    uint8_t modeOfOperation;       /**< echo of the requested modeOfOperation */
+    size_t maxNumberOfBlockLength; /**< maximum number of block length */
+    uint8_t dataFormatIdentifier;  /**< data format identifier */
+    uint64_t filePosition;         /**< ResumeFile only: where the download continues */
+};
+
 /**
  * @brief Routine control response structure
  */
@@ -59,6 +291,19 @@ struct RoutineControlResponse {
     uint16_t routineStatusRecordLength; /**< length of routine status record */
 };
 
+/**
+ * @brief Access timing parameter response structure
+ * @details For UDS_LEV_ATP_RCATP p2_ms and p2_star_ms are the active values. For
+ * UDS_LEV_ATP_RETPS they are the shortest values the server accepts and the max fields the longest.
+ */
+struct AccessTimingParameterResponse {
+    uint8_t timingParameterAccessType; /**< access type (subfunction) */
+    uint16_t p2_ms;                    /**< P2_server_max */
+    uint32_t p2_star_ms;               /**< P2*_server_max */
+    uint16_t p2_max_ms;                /**< UDS_LEV_ATP_RETPS only */
+    uint32_t p2_star_max_ms;           /**< UDS_LEV_ATP_RETPS only */
+};
+
 /**
  * @brief Read data by identifier variable structure
  */
@@ -69,8 +314,83 @@ typedef struct {
     void *(*UnpackFn)(void *dst, const void *src, size_t n); /**< optional unpack function */
 } UDSRDBIVar_t;
 
+/**
+ * @brief One DID of an RDBI plan schema
+ */
+typedef struct {
+    uint16_t did;  /**< data identifier */
+    uint16_t len;  /**< exact length of its data record */
+    size_t offset; /**< where the record is stored in the plan's `dst`, e.g. offsetof() */
+    void *(*UnpackFn)(void *dst, const void *src, size_t n); /**< optional, memmove if NULL */
+} UDSRDBISchemaEntry_t;
+
+struct UDSRDBIPlan;
+
+/**
+ * @brief Called once every request of an RDBI plan has ended
+ */
+typedef void (*UDSRDBIPlanDoneFn)(struct UDSClient *client, struct UDSRDBIPlan *plan);
+
+/**
+ * @brief Reads a schema of DIDs with as few 0x22 requests as fit the server's responses
+ * @details DIDs are packed into requests in schema order, each request holding as many as its
+ * response can carry in `maxRespLen` bytes, and at most UDS_CLIENT_RDBI_PLAN_MAX_DIDS. Requests go
+ * through the request queue one after the other, and each response is decoded in one pass into
+ * `dst` at the offsets given by the schema.
+ */
+typedef struct UDSRDBIPlan {
+    const UDSRDBISchemaEntry_t *schema; /**< DIDs to read */
+    uint16_t count;                     /**< number of entries in schema */
+    uint16_t maxRespLen;                /**< longest response the server can send */
+    void *dst;                          /**< destination of the data records */
+    UDSRDBIPlanDoneFn done;             /**< optional completion callback */
+    void *ctx;                          /**< user data */
+
+    uint16_t requests; /**< number of requests the schema takes */
+    uint16_t decoded;  /**< DIDs decoded so far */
+    UDSErr_t err;      /**< first error, UDS_OK once every DID was decoded */
+    uint16_t batch;    /**< first schema entry of the request in flight */
+    uint16_t next;     /**< first schema entry of the next request */
+    uint8_t req[1 + 2 * UDS_CLIENT_RDBI_PLAN_MAX_DIDS]; /**< request in flight */
+} UDSRDBIPlan_t;
+
 UDSErr_t UDSClientInit(UDSClient_t *client);
 UDSErr_t UDSClientPoll(UDSClient_t *client);
+
+/**
+ * @brief UDSClientPoll with the time read by the caller (see UDSServerPollAt)
+ * @param client
+ * @param now current UDSMillis()
+ */
+UDSErr_t UDSClientPollAt(UDSClient_t *client, uint32_t now);
+
+/**
+ * @brief Get the time until UDSClientPoll next has work to do that is not triggered by incoming
+ * data.
+ * @param client
+ * @return uint32_t milliseconds until the p2 timeout of the outstanding request, 0 if a request is
+ * being sent, or UDS_NO_DEADLINE if the client is idle
+ */
+uint32_t UDSClientNextDeadlineMs(const UDSClient_t *client);
+
+/**
+ * @brief UDSClientNextDeadlineMs measured from `now` instead of the current UDSMillis()
+ */
+uint32_t UDSClientNextDeadlineMsAt(const UDSClient_t *client, uint32_t now);
+
+/**
+ * @brief Queue a request
+ * @details Queued requests are sent one after the other. The next one is sent from within the
+ * UDSClientPoll() call in which the previous one ended, right after its `done` callback, so there
+ * is no idle poll between them. A request queued while the client is idle is sent immediately.
+ * The request is copied, but not the bytes it points to. Client events are emitted as for
+ * requests sent with UDSSendBytes().
+ * @param client
+ * @param req
+ * @return UDS_OK, UDS_ERR_INVALID_ARG, or UDS_ERR_BUSY if the queue is full
+ */
+UDSErr_t UDSClientSubmit(UDSClient_t *client, const UDSClientRequest_t *req);
+
 UDSErr_t UDSSendBytes(UDSClient_t *client, const uint8_t *data, uint16_t size);
 UDSErr_t UDSSendECUReset(UDSClient_t *client, uint8_t type);
 UDSErr_t UDSSendDiagSessCtrl(UDSClient_t *client, uint8_t mode);
@@ -84,6 +404,21 @@ UDSErr_t UDSSendTesterPresent(UDSClient_t *client);
 UDSErr_t UDSSendRoutineCtrl(UDSClient_t *client, uint8_t type, uint16_t routineIdentifier,
                             const uint8_t *data, uint16_t size);
 
+/**
+ * @brief Send AccessTimingParameter (0x83)
+ * @details Unless UDS_IGNORE_SRV_TIMINGS is set, the client's p2_ms and p2_star_ms follow the
+ * positive response: the values set with UDS_LEV_ATP_STPTGV, the values read with
+ * UDS_LEV_ATP_RCATP, or the client defaults after UDS_LEV_ATP_STPTDV.
+ * @param client
+ * @param type a UDS_LEV_ATP_ timingParameterAccessType
+ * @param p2_ms P2_server_max, sent with UDS_LEV_ATP_STPTGV only
+ * @param p2_star_ms P2*_server_max, a multiple of 10 ms, sent with UDS_LEV_ATP_STPTGV only
+ */
+UDSErr_t UDSSendAccessTimingParameter(UDSClient_t *client, uint8_t type, uint16_t p2_ms,
+                                      uint32_t p2_star_ms);
+
+UDSErr_t UDSSendReadMemoryByAddress(UDSClient_t *client, uint8_t addressAndLengthFormatIdentifier,
+                                    size_t memoryAddress, size_t memorySize);
 UDSErr_t UDSSendRequestDownload(UDSClient_t *client, uint8_t dataFormatIdentifier,
                                 uint8_t addressAndLengthFormatIdentifier, size_t memoryAddress,
                                 size_t memorySize);
@@ -104,13 +439,165 @@ UDSErr_t UDSSendRequestFileTransfer(UDSClient_t *client, uint8_t mode, const cha
 UDSErr_t UDSCtrlDTCSetting(UDSClient_t *client, uint8_t dtcSettingType,
                            uint8_t *dtcSettingControlOptionRecord, uint16_t len);
 UDSErr_t UDSUnpackRDBIResponse(UDSClient_t *client, UDSRDBIVar_t *vars, uint16_t numVars);
+
+/**
+ * @brief Prepare an RDBI plan
+ * @param plan
+ * @param schema must remain valid until the plan is done
+ * @param count number of entries in schema
+ * @param dst destination of the data records
+ * @param maxRespLen longest response the server sends, e.g. its UDS_SERVER_SEND_BUF_SIZE. 0 or a
+ * value larger than UDS_CLIENT_RECV_BUF_SIZE selects UDS_CLIENT_RECV_BUF_SIZE
+ * @return UDS_OK, UDS_ERR_INVALID_ARG, or UDS_ERR_BUFSIZ if a data record can never fit a response
+ */
+UDSErr_t UDSRDBIPlanInit(UDSRDBIPlan_t *plan, const UDSRDBISchemaEntry_t *schema, uint16_t count,
+                         void *dst, uint16_t maxRespLen);
+
+/**
+ * @brief Queue the requests of a plan
+ * @details A request that fails is recorded in `plan->err` and the plan continues with the next
+ * one. `plan->done` is called after the last response.
+ * @return UDS_OK, or the error of UDSClientSubmit()
+ */
+UDSErr_t UDSRDBIPlanStart(UDSClient_t *client, UDSRDBIPlan_t *plan);
+
+/**
+ * @brief Prepare a DID cache. Attach it with `client->did_cache = cache`
+ * @param cache
+ * @param policies must remain valid while the cache is used
+ * @param numPolicies number of entries in policies
+ * @return UDS_OK, UDS_ERR_INVALID_ARG, or UDS_ERR_BUFSIZ if a policy len exceeds
+ * UDS_CLIENT_DID_CACHE_DATA_LEN
+ */
+UDSErr_t UDSDIDCacheInit(UDSDIDCache_t *cache, const UDSDIDCachePolicy_t *policies,
+                         uint16_t numPolicies);
+
+/**
+ * @brief Read a cached value without sending a request
+ * @param cache
+ * @param sa address of the server, `A_SA` of its responses
+ * @param did
+ * @param dst receives the data record
+ * @param size size of dst
+ * @return UDS_OK on a hit, UDS_FAIL on a miss, UDS_ERR_BUFSIZ if dst is too small
+ */
+UDSErr_t UDSDIDCacheRead(UDSDIDCache_t *cache, uint32_t sa, uint16_t did, void *dst,
+                         uint16_t size);
+
+/**
+ * @brief Drop the cached values of a server
+ * @param cache
+ * @param sa address of the server, or UDS_TP_NOOP_ADDR for every server
+ * @param keepStatic keep values with a UDS_DID_CACHE_STATIC policy
+ */
+void UDSDIDCacheInvalidate(UDSDIDCache_t *cache, uint32_t sa, bool keepStatic);
 UDSErr_t UDSUnpackSecurityAccessResponse(const UDSClient_t *client,
                                          struct SecurityAccessResponse *resp);
 UDSErr_t UDSUnpackRequestDownloadResponse(const UDSClient_t *client,
                                           struct RequestDownloadResponse *resp);
+UDSErr_t UDSUnpackRequestFileTransferResponse(const UDSClient_t *client,
+                                              struct RequestFileTransferResponse *resp);
 UDSErr_t UDSUnpackRoutineControlResponse(const UDSClient_t *client,
                                          struct RoutineControlResponse *resp);
+UDSErr_t UDSUnpackAccessTimingParameterResponse(const UDSClient_t *client,
+                                                struct AccessTimingParameterResponse *resp);
 
+/**
+ * @brief Download an image from a FILE with the download engine
+ * @details Equivalent to UDSStartDownload with a pull source that reads `fd` sequentially
+ * @addtogroup requestDownload_0x34
+ */
 UDSErr_t UDSConfigDownload(UDSClient_t *client, uint8_t dataFormatIdentifier,
                            uint8_t addressAndLengthFormatIdentifier, size_t memoryAddress,
                            size_t memorySize, FILE *fd);
+
+/**
+ * @brief Start downloading an image to the server
+ * @details Sends RequestDownload (0x34). Subsequent calls to UDSClientPoll send TransferData (0x36)
+ * blocks of the size the server allows, followed by RequestTransferExit (0x37).
+ * UDS_EVT_DownloadComplete is emitted when the server has accepted the image. On failure,
+ * UDS_EVT_Err is emitted and `client->download.state` becomes UDS_DOWNLOAD_FAILED. When built with
+ * UDS_CLIENT_DOWNLOAD_COMPRESS and the compressionMethod of `dataFormatIdentifier` is
+ * UDS_LZ_COMPRESSION_METHOD, the image is compressed on the fly.
+ * @param client
+ * @param dataFormatIdentifier
+ * @param addressAndLengthFormatIdentifier
+ * @param memoryAddress
+ * @param src image source. Copied; buffers it points to must remain valid until the download ends
+ * @return UDSErr_t
+ * @addtogroup requestDownload_0x34
+ */
+UDSErr_t UDSStartDownload(UDSClient_t *client, uint8_t dataFormatIdentifier,
+                          uint8_t addressAndLengthFormatIdentifier, size_t memoryAddress,
+                          const UDSDownloadSource_t *src);
+
+/**
+ * @brief Start downloading a file to the server with RequestFileTransfer
+ * @details Like UDSStartDownload, but the transfer is started with 0x38 instead of 0x34. With
+ * UDS_MOOP_RSFILE the server answers with the filePosition at which an interrupted download of the
+ * same file stopped, and the engine continues from that offset of `src`. Compression is not used.
+ * @param client
+ * @param modeOfOperation UDS_MOOP_ADDFILE, UDS_MOOP_REPLFILE or UDS_MOOP_RSFILE
+ * @param filePath NUL terminated file path and name
+ * @param dataFormatIdentifier
+ * @param src image source. Copied; buffers it points to must remain valid until the download ends
+ * @return UDSErr_t
+ * @addtogroup requestFileTransfer_0x38
+ */
+UDSErr_t UDSStartFileDownload(UDSClient_t *client, uint8_t modeOfOperation, const char *filePath,
+                              uint8_t dataFormatIdentifier, const UDSDownloadSource_t *src);
+
+/**
+ * @brief Start reading a memory range from the server
+ * @details Sends RequestUpload (0x35). Subsequent calls to UDSClientPoll send TransferData (0x36)
+ * until `sink->size` bytes have been received, followed by RequestTransferExit (0x37). If the
+ * server answers 0x35 with serviceNotSupported or serviceNotSupportedInActiveSession and
+ * `dataFormatIdentifier` is 0, the range is read with ReadMemoryByAddress (0x23) instead, see
+ * UDSStartReadMemory. UDS_EVT_UploadComplete is emitted once the last block has been written to
+ * the sink. On failure, UDS_EVT_Err is emitted and `client->upload.state` becomes
+ * UDS_UPLOAD_FAILED.
+ * @param client
+ * @param dataFormatIdentifier
+ * @param addressAndLengthFormatIdentifier
+ * @param memoryAddress
+ * @param sink destination. Copied; buffers it points to must remain valid until the upload ends
+ * @return UDSErr_t
+ * @addtogroup requestDownload_0x35
+ */
+UDSErr_t UDSStartUpload(UDSClient_t *client, uint8_t dataFormatIdentifier,
+                        uint8_t addressAndLengthFormatIdentifier, size_t memoryAddress,
+                        const UDSUploadSink_t *sink);
+
+/**
+ * @brief Start reading a memory range from the server with ReadMemoryByAddress
+ * @details Like UDSStartUpload, but the range is read with 0x23 requests of up to
+ * `sink->chunkSize` bytes, or as many as the receive buffer holds.
+ * @addtogroup readMemByAddr_0x23
+ */
+UDSErr_t UDSStartReadMemory(UDSClient_t *client, uint8_t addressAndLengthFormatIdentifier,
+                            size_t memoryAddress, const UDSUploadSink_t *sink);
+
+#if UDS_SYS == UDS_SYS_UNIX
+/**
+ * @brief Map a file read-only and describe it as a memory span source
+ * @return UDS_OK, or UDS_FAIL if the file could not be mapped
+ */
+UDSErr_t UDSDownloadSourceMapFile(UDSDownloadSource_t *src, const char *path);
+
+/**
+ * @brief Unmap a source set up by UDSDownloadSourceMapFile
+ */
+void UDSDownloadSourceUnmapFile(UDSDownloadSource_t *src);
+
+/**
+ * @brief Create or truncate a file of `size` bytes, map it writable and describe it as a memory
+ * span sink
+ * @return UDS_OK, or UDS_FAIL if the file could not be created or mapped
+ */
+UDSErr_t UDSUploadSinkMapFile(UDSUploadSink_t *sink, const char *path, size_t size);
+
+/**
+ * @brief Write back and unmap a sink set up by UDSUploadSinkMapFile
+ */
+void UDSUploadSinkUnmapFile(UDSUploadSink_t *sink);
+#endif
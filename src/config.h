@@ -1,5 +1,28 @@
 #pragma once
 
+// Build profiles choose the defaults of the options below. Each option can still be set on its own.
+// UDS_PROFILE_MINIMAL_BOOTLOADER keeps the services needed to reprogram an ECU (0x10, 0x11, 0x27,
+// 0x31, 0x34, 0x36, 0x37, 0x3E) and leaves out the string tables.
+#define UDS_PROFILE_FULL_FEATURED 0
+#define UDS_PROFILE_MINIMAL_BOOTLOADER 1
+
+#ifndef UDS_PROFILE
+#define UDS_PROFILE UDS_PROFILE_FULL_FEATURED
+#endif
+
+#if UDS_PROFILE == UDS_PROFILE_MINIMAL_BOOTLOADER
+#define UDS_PROFILE_OPTIONAL (0)
+#elif UDS_PROFILE == UDS_PROFILE_FULL_FEATURED
+#define UDS_PROFILE_OPTIONAL (1)
+#else
+#error "unknown UDS_PROFILE"
+#endif
+
+// UDSErrToStr() and UDSEventToStr() name every value. Without them they return "".
+#ifndef UDS_CONFIG_STRINGS
+#define UDS_CONFIG_STRINGS UDS_PROFILE_OPTIONAL
+#endif
+
 /** ISO-TP Maximum Transmissiable Unit (ISO-15764-2-2004 section 5.3.3) */
 #define UDS_ISOTP_MTU (4095)
 
@@ -7,6 +30,10 @@
 #define UDS_TP_MTU UDS_ISOTP_MTU
 #endif
 
+// Transports that are not bound by ISO-TP (DoIP) can raise UDS_TP_MTU. Service length fields such
+// as maxNumberOfBlockLength and the event argument lengths are 16 bits wide.
+static_assert(UDS_TP_MTU <= 0xFFFF, "");
+
 #ifndef UDS_SERVER_SEND_BUF_SIZE
 #define UDS_SERVER_SEND_BUF_SIZE (UDS_TP_MTU)
 #endif
@@ -15,6 +42,42 @@
 #define UDS_SERVER_RECV_BUF_SIZE (UDS_TP_MTU)
 #endif
 
+// UDS is strictly request/response, so the server can build the response in the buffer that holds
+// the request. When this is 1 UDSReq_t has send_buf only and UDS_SERVER_RECV_BUF_SIZE is unused: a
+// request the transport does not lend is kept at the end of send_buf and the response is limited
+// to the space in front of it.
+#ifndef UDS_SERVER_SHARED_BUF
+#define UDS_SERVER_SHARED_BUF (0)
+#endif
+
+// Space kept in front of a request stored at the end of send_buf. Longer requests are dropped, so
+// the maxNumberOfBlockLength given to 0x34 must not exceed UDS_SERVER_SEND_BUF_SIZE minus this.
+#ifndef UDS_SERVER_SHARED_BUF_MIN_RESP_LEN
+#define UDS_SERVER_SHARED_BUF_MIN_RESP_LEN (32)
+#endif
+
+static_assert(UDS_SERVER_SHARED_BUF_MIN_RESP_LEN >= 8 &&
+                  UDS_SERVER_SHARED_BUF_MIN_RESP_LEN < UDS_SERVER_SEND_BUF_SIZE,
+              "");
+
+// Transports keep at most one message buffer and copy received messages out rather than lending
+// them. The physical link of the isotp-c transports (isotp_c, isotp_c_socketcan) sends and
+// receives in one UDS_TP_MTU buffer: frames other than flow control are dropped while a message is
+// being sent, and sending discards a message that has not been read yet. isotp_sock reads each
+// message straight into the caller's buffer. Pair with UDS_SERVER_SHARED_BUF.
+#ifndef UDS_TP_HALF_DUPLEX
+#define UDS_TP_HALF_DUPLEX (0)
+#endif
+
+// The isotp-c transports (isotp_c, isotp_c_socketcan) send from the buffer passed to UDSTpSend()
+// instead of copying it into a UDS_TP_MTU send buffer of their own, which they then do not have.
+// The caller leaves the buffer unchanged while UDSTpPoll() reports UDS_TP_SEND_IN_PROGRESS: the
+// server then starts no request until its response has been sent. isotp_sock already writes the
+// caller's buffer to the socket.
+#ifndef UDS_TP_SEND_IN_PLACE
+#define UDS_TP_SEND_IN_PLACE (0)
+#endif
+
 #ifndef UDS_CLIENT_SEND_BUF_SIZE
 #define UDS_CLIENT_SEND_BUF_SIZE (UDS_TP_MTU)
 #endif
@@ -38,6 +101,30 @@
 
 static_assert(UDS_CLIENT_DEFAULT_P2_STAR_MS > UDS_CLIENT_DEFAULT_P2_MS, "");
 
+// Number of requests UDSClientSubmit() can hold, including the one being sent
+#ifndef UDS_CLIENT_QUEUE_LEN
+#define UDS_CLIENT_QUEUE_LEN (8)
+#endif
+
+static_assert(UDS_CLIENT_QUEUE_LEN > 0 && UDS_CLIENT_QUEUE_LEN <= UINT8_MAX, "");
+
+// Most DIDs an RDBI plan puts in one request
+#ifndef UDS_CLIENT_RDBI_PLAN_MAX_DIDS
+#define UDS_CLIENT_RDBI_PLAN_MAX_DIDS (32)
+#endif
+
+// Number of DID values a client DID cache holds
+#ifndef UDS_CLIENT_DID_CACHE_ENTRIES
+#define UDS_CLIENT_DID_CACHE_ENTRIES (16)
+#endif
+
+// Longest data record a client DID cache entry holds
+#ifndef UDS_CLIENT_DID_CACHE_DATA_LEN
+#define UDS_CLIENT_DID_CACHE_DATA_LEN (24)
+#endif
+
+static_assert(UDS_CLIENT_DID_CACHE_ENTRIES > 0 && UDS_CLIENT_DID_CACHE_DATA_LEN > 0, "");
+
 // Default value from ISO14229-2 2013 Table 4: 50 ms
 #ifndef UDS_SERVER_DEFAULT_P2_MS
 #define UDS_SERVER_DEFAULT_P2_MS (50)
@@ -58,6 +145,21 @@ static_assert((0 < UDS_SERVER_DEFAULT_P2_MS) &&
                   (UDS_SERVER_DEFAULT_P2_STAR_MS < UDS_SERVER_DEFAULT_S3_MS),
               "");
 
+// 0x83 AccessTimingParameter: shortest P2 and P2* a tester may set. The server's p2_ms and
+// p2_star_ms when 0x83 first changes them are the longest, and are restored by
+// setTimingParametersToDefaultValues and on a session change.
+#ifndef UDS_SERVER_0x83_MIN_P2_MS
+#define UDS_SERVER_0x83_MIN_P2_MS (10)
+#endif
+#ifndef UDS_SERVER_0x83_MIN_P2_STAR_MS
+#define UDS_SERVER_0x83_MIN_P2_STAR_MS (100)
+#endif
+
+static_assert((0 < UDS_SERVER_0x83_MIN_P2_MS) &&
+                  (UDS_SERVER_0x83_MIN_P2_MS <= UDS_SERVER_DEFAULT_P2_MS) &&
+                  (UDS_SERVER_0x83_MIN_P2_STAR_MS <= UDS_SERVER_DEFAULT_P2_STAR_MS),
+              "");
+
 // Duration between the server sending a positive response to an ECU reset request and the emission
 // of a UDS_EVT_DoScheduledReset event. This should be set to a duration adequate for the server
 // transport layer to finish responding to the ECU reset request.
@@ -86,6 +188,410 @@ TransferData request message from the client. */
 #define UDS_SERVER_DEFAULT_XFER_DATA_MAX_BLOCKLENGTH (UDS_TP_MTU)
 #endif
 
+// Number of testers (distinguished by the request source address UDSSDU_t.A_SA) that the server
+// tracks independently. With more than one the server holds UDS_SERVER_MAX_TESTERS + 1 UDSReq_t:
+// one per tester and one that requests are received into. With the default of 1 the server keeps a
+// single session and a single UDSReq_t as before.
+#ifndef UDS_SERVER_MAX_TESTERS
+#define UDS_SERVER_MAX_TESTERS (1)
+#endif
+
+static_assert(UDS_SERVER_MAX_TESTERS >= 1, "");
+
+// isotp_c, isotp_c_socketcan and isotp_sock send every response to one configured target address
+// and report one fixed source address, so they cannot tell testers apart
+#if UDS_SERVER_MAX_TESTERS > 1 &&                                                                  \
+    (defined(UDS_TP_ISOTP_C) || defined(UDS_TP_ISOTP_C_SOCKETCAN) || defined(UDS_TP_ISOTP_SOCK))
+#error "UDS_SERVER_MAX_TESTERS > 1 needs a transport that addresses each tester"
+#endif
+
+// Requests received while a response is pending (0x78) are kept in a queue of this many entries
+// and processed in order once it is complete. TesterPresent is answered right away and a physical
+// request that does not fit gets 0x21 BusyRepeatRequest. 0 stops receiving after the second 0x78
+// as before. Requires UDS_SERVER_MAX_TESTERS == 1, with more testers only the busy tester waits.
+#ifndef UDS_SERVER_RCRRP_QUEUE_LEN
+#define UDS_SERVER_RCRRP_QUEUE_LEN (0)
+#endif
+
+// longest request the queue keeps
+#ifndef UDS_SERVER_RCRRP_QUEUE_BUF_SIZE
+#define UDS_SERVER_RCRRP_QUEUE_BUF_SIZE (32)
+#endif
+
+static_assert(UDS_SERVER_RCRRP_QUEUE_LEN >= 0 && UDS_SERVER_RCRRP_QUEUE_LEN <= 255, "");
+static_assert(UDS_SERVER_RCRRP_QUEUE_LEN == 0 || UDS_SERVER_MAX_TESTERS == 1,
+              "UDS_SERVER_RCRRP_QUEUE_LEN requires UDS_SERVER_MAX_TESTERS == 1");
+static_assert(UDS_SERVER_RCRRP_QUEUE_BUF_SIZE >= 2, "");
+
+// 0x36 TransferData write-behind pipeline: number of block buffers. When this is > 0 and
+// UDSServer_t.xferWrite is set, each downloaded block is acknowledged as soon as it has been copied
+// into a free buffer and is written to the sink from UDSServerPoll. 0 leaves the pipeline out.
+#ifndef UDS_SERVER_0x36_PIPELINE_DEPTH
+#define UDS_SERVER_0x36_PIPELINE_DEPTH (0)
+#endif
+
+// size of one pipeline buffer: the largest transferRequestParameterRecord the pipeline accepts.
+// maxNumberOfBlockLength is limited accordingly while the pipeline is in use.
+#ifndef UDS_SERVER_0x36_PIPELINE_BLOCK_SIZE
+#define UDS_SERVER_0x36_PIPELINE_BLOCK_SIZE (UDS_TP_MTU - 2)
+#endif
+
+static_assert(UDS_SERVER_0x36_PIPELINE_DEPTH >= 0 && UDS_SERVER_0x36_PIPELINE_DEPTH <= 255, "");
+static_assert(UDS_SERVER_0x36_PIPELINE_BLOCK_SIZE >= 1, "");
+
+// Compressed downloads (src/lz.h). A download whose dataFormatIdentifier has
+// UDS_LZ_COMPRESSION_METHOD in the compressionMethod nibble is compressed by the client download
+// engine when UDS_CLIENT_DOWNLOAD_COMPRESS is 1 and decompressed in front of UDS_EVT_TransferData
+// when UDS_SERVER_0x36_DECOMPRESS is 1. The decoder needs a window of 2^UDS_LZ_WINDOW_BITS bytes, the
+// encoder about eight times that. Both sides must use the same window size.
+#ifndef UDS_LZ_COMPRESSION_METHOD
+#define UDS_LZ_COMPRESSION_METHOD (0x1)
+#endif
+
+#ifndef UDS_LZ_WINDOW_BITS
+#define UDS_LZ_WINDOW_BITS (10)
+#endif
+
+#ifndef UDS_SERVER_0x36_DECOMPRESS
+#define UDS_SERVER_0x36_DECOMPRESS (0)
+#endif
+
+#ifndef UDS_CLIENT_DOWNLOAD_COMPRESS
+#define UDS_CLIENT_DOWNLOAD_COMPRESS (0)
+#endif
+
+static_assert(UDS_LZ_COMPRESSION_METHOD >= 0x1 && UDS_LZ_COMPRESSION_METHOD <= 0xF, "");
+static_assert(UDS_LZ_WINDOW_BITS >= 8 && UDS_LZ_WINDOW_BITS <= 12, "");
+
+// Keep a running CRC-32 (UDSCRC32) of every download as its blocks arrive, so that 0x37 and
+// check-memory routines can verify the image without reading it back. When 0, the CRC is only
+// computed for downloads that take checkpoints (xferCheckpointInterval).
+#ifndef UDS_SERVER_XFER_CRC
+#define UDS_SERVER_XFER_CRC (1)
+#endif
+
+// Built-in service handlers. Define UDS_SERVER_ENABLE_0xNN to 0 to leave a handler out of the
+// build. Requests for a disabled service are passed to the server callback as UDS_EVT_Custom.
+// Services a bootloader does not need default to UDS_PROFILE_OPTIONAL.
+#ifndef UDS_SERVER_ENABLE_0x10
+#define UDS_SERVER_ENABLE_0x10 1
+#endif
+#ifndef UDS_SERVER_ENABLE_0x11
+#define UDS_SERVER_ENABLE_0x11 1
+#endif
+#ifndef UDS_SERVER_ENABLE_0x14
+#define UDS_SERVER_ENABLE_0x14 UDS_PROFILE_OPTIONAL
+#endif
+#ifndef UDS_SERVER_ENABLE_0x19
+#define UDS_SERVER_ENABLE_0x19 UDS_PROFILE_OPTIONAL
+#endif
+#ifndef UDS_SERVER_ENABLE_0x22
+#define UDS_SERVER_ENABLE_0x22 UDS_PROFILE_OPTIONAL
+#endif
+#ifndef UDS_SERVER_ENABLE_0x23
+#define UDS_SERVER_ENABLE_0x23 UDS_PROFILE_OPTIONAL
+#endif
+#ifndef UDS_SERVER_ENABLE_0x27
+#define UDS_SERVER_ENABLE_0x27 1
+#endif
+#ifndef UDS_SERVER_ENABLE_0x28
+#define UDS_SERVER_ENABLE_0x28 UDS_PROFILE_OPTIONAL
+#endif
+#ifndef UDS_SERVER_ENABLE_0x29
+#define UDS_SERVER_ENABLE_0x29 UDS_PROFILE_OPTIONAL
+#endif
+#ifndef UDS_SERVER_ENABLE_0x2A
+#define UDS_SERVER_ENABLE_0x2A UDS_PROFILE_OPTIONAL
+#endif
+#ifndef UDS_SERVER_ENABLE_0x2C
+#define UDS_SERVER_ENABLE_0x2C UDS_PROFILE_OPTIONAL
+#endif
+#ifndef UDS_SERVER_ENABLE_0x2E
+#define UDS_SERVER_ENABLE_0x2E UDS_PROFILE_OPTIONAL
+#endif
+#ifndef UDS_SERVER_ENABLE_0x2F
+#define UDS_SERVER_ENABLE_0x2F UDS_PROFILE_OPTIONAL
+#endif
+#ifndef UDS_SERVER_ENABLE_0x31
+#define UDS_SERVER_ENABLE_0x31 1
+#endif
+#ifndef UDS_SERVER_ENABLE_0x34
+#define UDS_SERVER_ENABLE_0x34 1
+#endif
+#ifndef UDS_SERVER_ENABLE_0x35
+#define UDS_SERVER_ENABLE_0x35 UDS_PROFILE_OPTIONAL
+#endif
+#ifndef UDS_SERVER_ENABLE_0x36
+#define UDS_SERVER_ENABLE_0x36 1
+#endif
+#ifndef UDS_SERVER_ENABLE_0x37
+#define UDS_SERVER_ENABLE_0x37 1
+#endif
+#ifndef UDS_SERVER_ENABLE_0x38
+#define UDS_SERVER_ENABLE_0x38 UDS_PROFILE_OPTIONAL
+#endif
+#ifndef UDS_SERVER_ENABLE_0x3D
+#define UDS_SERVER_ENABLE_0x3D UDS_PROFILE_OPTIONAL
+#endif
+#ifndef UDS_SERVER_ENABLE_0x3E
+#define UDS_SERVER_ENABLE_0x3E 1
+#endif
+#ifndef UDS_SERVER_ENABLE_0x83
+#define UDS_SERVER_ENABLE_0x83 UDS_PROFILE_OPTIONAL
+#endif
+#ifndef UDS_SERVER_ENABLE_0x84
+#define UDS_SERVER_ENABLE_0x84 UDS_PROFILE_OPTIONAL
+#endif
+#ifndef UDS_SERVER_ENABLE_0x85
+#define UDS_SERVER_ENABLE_0x85 UDS_PROFILE_OPTIONAL
+#endif
+#ifndef UDS_SERVER_ENABLE_0x86
+#define UDS_SERVER_ENABLE_0x86 UDS_PROFILE_OPTIONAL
+#endif
+#ifndef UDS_SERVER_ENABLE_0x87
+#define UDS_SERVER_ENABLE_0x87 UDS_PROFILE_OPTIONAL
+#endif
+
+// Sessions in which a built-in service is accepted, as a mask of UDS_SESSION_BIT(sessionType).
+// 0 accepts the service in every session. Other sessions get NRC 0x7F
+// (ServiceNotSupportedInActiveSession) before the handler runs.
+#ifndef UDS_SERVER_0x10_SESSION_MASK
+#define UDS_SERVER_0x10_SESSION_MASK 0
+#endif
+#ifndef UDS_SERVER_0x11_SESSION_MASK
+#define UDS_SERVER_0x11_SESSION_MASK 0
+#endif
+#ifndef UDS_SERVER_0x14_SESSION_MASK
+#define UDS_SERVER_0x14_SESSION_MASK 0
+#endif
+#ifndef UDS_SERVER_0x19_SESSION_MASK
+#define UDS_SERVER_0x19_SESSION_MASK 0
+#endif
+#ifndef UDS_SERVER_0x22_SESSION_MASK
+#define UDS_SERVER_0x22_SESSION_MASK 0
+#endif
+#ifndef UDS_SERVER_0x23_SESSION_MASK
+#define UDS_SERVER_0x23_SESSION_MASK 0
+#endif
+#ifndef UDS_SERVER_0x27_SESSION_MASK
+#define UDS_SERVER_0x27_SESSION_MASK 0
+#endif
+#ifndef UDS_SERVER_0x28_SESSION_MASK
+#define UDS_SERVER_0x28_SESSION_MASK 0
+#endif
+#ifndef UDS_SERVER_0x29_SESSION_MASK
+#define UDS_SERVER_0x29_SESSION_MASK 0
+#endif
+#ifndef UDS_SERVER_0x2A_SESSION_MASK
+#define UDS_SERVER_0x2A_SESSION_MASK 0
+#endif
+#ifndef UDS_SERVER_0x2C_SESSION_MASK
+#define UDS_SERVER_0x2C_SESSION_MASK 0
+#endif
+#ifndef UDS_SERVER_0x2E_SESSION_MASK
+#define UDS_SERVER_0x2E_SESSION_MASK 0
+#endif
+#ifndef UDS_SERVER_0x2F_SESSION_MASK
+#define UDS_SERVER_0x2F_SESSION_MASK 0
+#endif
+#ifndef UDS_SERVER_0x31_SESSION_MASK
+#define UDS_SERVER_0x31_SESSION_MASK 0
+#endif
+#ifndef UDS_SERVER_0x34_SESSION_MASK
+#define UDS_SERVER_0x34_SESSION_MASK 0
+#endif
+#ifndef UDS_SERVER_0x35_SESSION_MASK
+#define UDS_SERVER_0x35_SESSION_MASK 0
+#endif
+#ifndef UDS_SERVER_0x36_SESSION_MASK
+#define UDS_SERVER_0x36_SESSION_MASK 0
+#endif
+#ifndef UDS_SERVER_0x37_SESSION_MASK
+#define UDS_SERVER_0x37_SESSION_MASK 0
+#endif
+#ifndef UDS_SERVER_0x38_SESSION_MASK
+#define UDS_SERVER_0x38_SESSION_MASK 0
+#endif
+#ifndef UDS_SERVER_0x3D_SESSION_MASK
+#define UDS_SERVER_0x3D_SESSION_MASK 0
+#endif
+#ifndef UDS_SERVER_0x3E_SESSION_MASK
+#define UDS_SERVER_0x3E_SESSION_MASK 0
+#endif
+#ifndef UDS_SERVER_0x83_SESSION_MASK
+#define UDS_SERVER_0x83_SESSION_MASK 0
+#endif
+#ifndef UDS_SERVER_0x84_SESSION_MASK
+#define UDS_SERVER_0x84_SESSION_MASK 0
+#endif
+#ifndef UDS_SERVER_0x85_SESSION_MASK
+#define UDS_SERVER_0x85_SESSION_MASK 0
+#endif
+#ifndef UDS_SERVER_0x86_SESSION_MASK
+#define UDS_SERVER_0x86_SESSION_MASK 0
+#endif
+#ifndef UDS_SERVER_0x87_SESSION_MASK
+#define UDS_SERVER_0x87_SESSION_MASK 0
+#endif
+
+// 0x2A ReadDataByPeriodicIdentifier: number of periodicDataIdentifiers that can be scheduled at
+// the same time
+#ifndef UDS_SERVER_0x2A_MAX_PDIDS
+#define UDS_SERVER_0x2A_MAX_PDIDS (8)
+#endif
+
+// 0x2A transmission periods for the slow, medium and fast transmission modes
+#ifndef UDS_SERVER_0x2A_SLOW_RATE_MS
+#define UDS_SERVER_0x2A_SLOW_RATE_MS (1000)
+#endif
+#ifndef UDS_SERVER_0x2A_MEDIUM_RATE_MS
+#define UDS_SERVER_0x2A_MEDIUM_RATE_MS (200)
+#endif
+#ifndef UDS_SERVER_0x2A_FAST_RATE_MS
+#define UDS_SERVER_0x2A_FAST_RATE_MS (50)
+#endif
+
+// 0x2A maximum length of one periodic message (0x6A, periodicDataIdentifier, data). The default
+// fits a classical CAN single frame.
+#ifndef UDS_SERVER_0x2A_MAX_MSG_LEN
+#define UDS_SERVER_0x2A_MAX_MSG_LEN (7)
+#endif
+
+static_assert(UDS_SERVER_0x2A_MAX_PDIDS >= 1 && UDS_SERVER_0x2A_MAX_PDIDS <= 255, "");
+static_assert(UDS_SERVER_0x2A_MAX_MSG_LEN >= 3, "");
+// periodic messages are built on the stack, so sent in place they must fit a classic single frame
+static_assert(!UDS_TP_SEND_IN_PLACE || UDS_SERVER_0x2A_MAX_MSG_LEN <= 7, "");
+
+// 0x22 ReadDataByIdentifier: number of data records kept for DIDs registered with a cacheMs, and
+// the size of each. 0 disables the cache. Longer records are produced on every request.
+#ifndef UDS_SERVER_DID_CACHE_ENTRIES
+#define UDS_SERVER_DID_CACHE_ENTRIES (0)
+#endif
+#ifndef UDS_SERVER_DID_CACHE_RECORD_SIZE
+#define UDS_SERVER_DID_CACHE_RECORD_SIZE (32)
+#endif
+
+static_assert(UDS_SERVER_DID_CACHE_ENTRIES >= 0 && UDS_SERVER_DID_CACHE_RECORD_SIZE > 0 &&
+                  UDS_SERVER_DID_CACHE_RECORD_SIZE <= 0xFFFF,
+              "");
+
+// 0x84 SecuredDataTransmission: longest signature a UDSSecuredProvider_t appends to a response.
+// Space for it and the security header is kept free while the internal response is built.
+#ifndef UDS_SERVER_0x84_MAX_SIGNATURE_LEN
+#define UDS_SERVER_0x84_MAX_SIGNATURE_LEN (32)
+#endif
+
+static_assert(UDS_SERVER_0x84_MAX_SIGNATURE_LEN <= 0xFFFF, "");
+
+// 0x86 ResponseOnEvent: number of event logics that can be set up at the same time
+#ifndef UDS_SERVER_0x86_MAX_EVENTS
+#define UDS_SERVER_0x86_MAX_EVENTS (4)
+#endif
+
+// 0x86 maximum length of a monitored DID and of a serviceToRespondToRecord
+#ifndef UDS_SERVER_0x86_MAX_DATA_LEN
+#define UDS_SERVER_0x86_MAX_DATA_LEN (8)
+#endif
+#ifndef UDS_SERVER_0x86_MAX_SERVICE_LEN
+#define UDS_SERVER_0x86_MAX_SERVICE_LEN (8)
+#endif
+
+// 0x86 interval at which monitored DIDs are compared against their previous value
+#ifndef UDS_SERVER_0x86_SAMPLE_MS
+#define UDS_SERVER_0x86_SAMPLE_MS (10)
+#endif
+
+// 0x86 duration of the short, medium and long eventWindowTime, counted from
+// startResponseOnEvent. The power, ignition and manufacturer trigger windows last until the server
+// restarts.
+#ifndef UDS_SERVER_0x86_SHORT_WINDOW_MS
+#define UDS_SERVER_0x86_SHORT_WINDOW_MS (1000)
+#endif
+#ifndef UDS_SERVER_0x86_MEDIUM_WINDOW_MS
+#define UDS_SERVER_0x86_MEDIUM_WINDOW_MS (10000)
+#endif
+#ifndef UDS_SERVER_0x86_LONG_WINDOW_MS
+#define UDS_SERVER_0x86_LONG_WINDOW_MS (60000)
+#endif
+
+static_assert(UDS_SERVER_0x86_MAX_EVENTS >= 1 && UDS_SERVER_0x86_MAX_EVENTS <= 255, "");
+
+// 0x2C DynamicallyDefineDataIdentifier: number of dynamic DIDs the server can hold, and number of
+// source elements (DID slices or memory ranges) per dynamic DID
+#ifndef UDS_SERVER_0x2C_MAX_DIDS
+#define UDS_SERVER_0x2C_MAX_DIDS (4)
+#endif
+#ifndef UDS_SERVER_0x2C_MAX_ELEMENTS
+#define UDS_SERVER_0x2C_MAX_ELEMENTS (8)
+#endif
+
+static_assert(UDS_SERVER_0x2C_MAX_DIDS >= 1 && UDS_SERVER_0x2C_MAX_DIDS <= 255, "");
+static_assert(UDS_SERVER_0x2C_MAX_ELEMENTS >= 1 && UDS_SERVER_0x2C_MAX_ELEMENTS <= 255, "");
+
+// Request statistics (src/stats.h): per-SID request and NRC counters, 0x78 and transport error
+// counts and latency histograms, kept in UDSServer_t.stats and UDSClient_t.stats
+#ifndef UDS_SERVER_STATS
+#define UDS_SERVER_STATS (0)
+#endif
+
+#ifndef UDS_CLIENT_STATS
+#define UDS_CLIENT_STATS (0)
+#endif
+
+// Number of power of two buckets of a latency histogram. The last of the default 24 buckets counts
+// durations from 4.2 s
+#ifndef UDS_STATS_HIST_BUCKETS
+#define UDS_STATS_HIST_BUCKETS (24)
+#endif
+
+static_assert(UDS_STATS_HIST_BUCKETS >= 2 && UDS_STATS_HIST_BUCKETS <= 32, "");
+
+// DID through which 0x22 reads the server statistics (UDSPackServerStats). 0 leaves it out.
+#ifndef UDS_SERVER_STATS_DID
+#define UDS_SERVER_STATS_DID (0xFD00)
+#endif
+
+// Binary trace (src/trace.h): every SDU passing UDSTpSend/UDSTpRecv/UDSTpPeek is recorded as a
+// fixed size entry in the RAM ring UDSTrace, decoded offline with tools/decode_trace.py
+#ifndef UDS_TRACE
+#define UDS_TRACE (0)
+#endif
+
+// Entries held by the trace ring. Must be a power of two
+#ifndef UDS_TRACE_ENTRIES
+#define UDS_TRACE_ENTRIES (64)
+#endif
+
+static_assert(UDS_TRACE_ENTRIES >= 2 && (UDS_TRACE_ENTRIES & (UDS_TRACE_ENTRIES - 1)) == 0, "");
+
+// Leading bytes of each SDU kept in a trace entry. Must be a multiple of 4
+#ifndef UDS_TRACE_DATA_LEN
+#define UDS_TRACE_DATA_LEN (8)
+#endif
+
+static_assert(UDS_TRACE_DATA_LEN >= 4 && UDS_TRACE_DATA_LEN % 4 == 0, "");
+
+// Servers and clients one UDSScheduler_t (src/scheduler.h) can hold
+#ifndef UDS_SCHEDULER_MAX_ENTRIES
+#define UDS_SCHEDULER_MAX_ENTRIES (16)
+#endif
+
+static_assert(UDS_SCHEDULER_MAX_ENTRIES > 0 && UDS_SCHEDULER_MAX_ENTRIES <= UINT8_MAX, "");
+
+// Worker threads one UDSHost_t (src/host.h) can run. Each worker holds up to
+// UDS_SCHEDULER_MAX_ENTRIES servers
+#ifndef UDS_HOST_MAX_WORKERS
+#define UDS_HOST_MAX_WORKERS (8)
+#endif
+
+static_assert(UDS_HOST_MAX_WORKERS > 0, "");
+
 #ifndef UDS_CUSTOM_MILLIS
 #define UDS_CUSTOM_MILLIS 0
 #endif
+
+// the application implements UDSMicros(). Otherwise it is native, or derived from a custom
+// UDSMillis() so that both stay on the same clock
+#ifndef UDS_CUSTOM_MICROS
+#define UDS_CUSTOM_MICROS 0
+#endif
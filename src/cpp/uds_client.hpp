@@ -0,0 +1,413 @@
+#pragma once
+
+/**
+ * @file uds_client.hpp
+ * @brief C++20 coroutine layer for UDSClient_t
+ * @details Header-only. Each awaitable is a request submitted with UDSClientSubmit() that resumes
+ * the awaiting coroutine from the `done` callback, so requests cost no allocation and the C client
+ * underneath is unchanged. Coroutines are resumed from within UDSClientPoll(), on the thread that
+ * polls the client.
+ *
+ * ```cpp
+ * uds::Task read_vin(uds::Client &ecu) {
+ *     uds::Response r = co_await ecu.rdbi(0xF190);
+ *     if (!r) {
+ *         co_return r.err;
+ *     }
+ *     // r.data and r.len hold the response until the next co_await on ecu
+ *     co_return UDS_OK;
+ * }
+ * ```
+ */
+
+#include "iso14229.h"
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <cstring>
+#include <exception>
+#include <initializer_list>
+#include <utility>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+namespace uds {
+
+/** longest request built inside an awaitable by the typed helpers */
+constexpr uint16_t kInlineRequestLen = 64;
+
+/**
+ * @brief Outcome of a request
+ * @details `data` points into the client's receive buffer and is only valid until the coroutine
+ * next awaits the same client.
+ */
+struct Response {
+    UDSErr_t err = UDS_OK;         /**< UDS_OK, the negative response code, or why it failed */
+    const uint8_t *data = nullptr; /**< the response */
+    uint16_t len = 0;              /**< length of data */
+
+    explicit operator bool() const { return UDS_OK == err; }
+};
+
+/**
+ * @brief Coroutine returning a UDSErr_t
+ * @details Lazy: a task runs once it is awaited by another task or started with start(). The
+ * frame is allocated once per task, not per request.
+ */
+class [[nodiscard]] Task {
+  public:
+    struct promise_type {
+        UDSErr_t result = UDS_OK;
+        std::coroutine_handle<> continuation;
+
+        Task get_return_object() {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                std::coroutine_handle<> next = h.promise().continuation;
+                return next ? next : std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void return_value(UDSErr_t err) { result = err; }
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    Task(Task &&other) noexcept : h_(std::exchange(other.h_, {})) {}
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+    ~Task() {
+        if (h_) {
+            h_.destroy();
+        }
+    }
+
+    /** run a top-level task until its first suspension */
+    void start() { h_.resume(); }
+    bool done() const { return !h_ || h_.done(); }
+    /** value passed to co_return, valid once done() */
+    UDSErr_t result() const { return h_.promise().result; }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        h_.promise().continuation = awaiting;
+        return h_;
+    }
+    UDSErr_t await_resume() const noexcept { return h_.promise().result; }
+
+  private:
+    explicit Task(std::coroutine_handle<promise_type> h) : h_(h) {}
+    std::coroutine_handle<promise_type> h_;
+};
+
+class Client;
+
+/**
+ * @brief Awaitable request. Holds the queue entry and, for the typed helpers, the request bytes.
+ */
+class RequestAwaiter {
+  public:
+    RequestAwaiter(UDSClient_t *client, const uint8_t *data, uint16_t len, uint8_t options,
+                   uint16_t p2_ms)
+        : client_(client) {
+        Init(data, len, options, p2_ms);
+    }
+
+    /** build the request in the awaitable: `head` followed by `tail` */
+    RequestAwaiter(UDSClient_t *client, std::initializer_list<uint8_t> head, const uint8_t *tail,
+                   size_t tail_len, uint8_t options)
+        : client_(client) {
+        Init(buf_.data(), 0, options, 0);
+        if (head.size() + tail_len > buf_.size()) {
+            resp_.err = UDS_ERR_BUFSIZ;
+            return;
+        }
+        memcpy(buf_.data(), head.begin(), head.size());
+        if (tail_len) {
+            memcpy(buf_.data() + head.size(), tail, tail_len);
+        }
+        req_.len = static_cast<uint16_t>(head.size() + tail_len);
+    }
+
+    RequestAwaiter(const RequestAwaiter &) = delete;
+    RequestAwaiter &operator=(const RequestAwaiter &) = delete;
+
+    bool await_ready() const noexcept { return UDS_OK != resp_.err; }
+
+    bool await_suspend(std::coroutine_handle<> h) {
+        h_ = h;
+        submitting_ = true;
+        UDSErr_t err = UDSClientSubmit(client_, &req_);
+        submitting_ = false;
+        if (err) {
+            resp_.err = err;
+            return false;
+        }
+        return !completed_; // the request may have failed before UDSClientSubmit returned
+    }
+
+    Response await_resume() const noexcept { return resp_; }
+
+  private:
+    void Init(const uint8_t *data, uint16_t len, uint8_t options, uint16_t p2_ms) {
+        req_.data = data;
+        req_.len = len;
+        req_.options = options;
+        req_.p2_ms = p2_ms;
+        req_.done = &RequestAwaiter::Done;
+        req_.ctx = this;
+    }
+
+    static void Done(UDSClient_t *client, UDSErr_t err, void *ctx) {
+        RequestAwaiter *self = static_cast<RequestAwaiter *>(ctx);
+        self->resp_ = Response{err, client->recv_buf, client->recv_size};
+        self->completed_ = true;
+        if (!self->submitting_) {
+            self->h_.resume();
+        }
+    }
+
+    UDSClient_t *client_;
+    UDSClientRequest_t req_ = {};
+    Response resp_;
+    std::coroutine_handle<> h_;
+    bool submitting_ = false;
+    bool completed_ = false;
+    std::array<uint8_t, kInlineRequestLen> buf_ = {};
+};
+
+/**
+ * @brief Awaitable download run by the client's download engine
+ */
+class DownloadAwaiter {
+  public:
+    DownloadAwaiter(Client &client, uint8_t dataFormatIdentifier,
+                    uint8_t addressAndLengthFormatIdentifier, size_t memoryAddress,
+                    const UDSDownloadSource_t &src)
+        : client_(client), dfi_(dataFormatIdentifier), alfi_(addressAndLengthFormatIdentifier),
+          addr_(memoryAddress), src_(src) {}
+
+    DownloadAwaiter(const DownloadAwaiter &) = delete;
+    DownloadAwaiter &operator=(const DownloadAwaiter &) = delete;
+
+    bool await_ready() const noexcept { return false; }
+    inline bool await_suspend(std::coroutine_handle<> h);
+    /** UDS_OK once the server accepted the image, otherwise `client.download.err` */
+    UDSErr_t await_resume() const noexcept { return err_; }
+
+  private:
+    friend class Client;
+    void Finish(UDSErr_t err) {
+        err_ = err;
+        h_.resume();
+    }
+
+    Client &client_;
+    uint8_t dfi_;
+    uint8_t alfi_;
+    size_t addr_;
+    UDSDownloadSource_t src_;
+    std::coroutine_handle<> h_;
+    UDSErr_t err_ = UDS_OK;
+};
+
+/**
+ * @brief UDSClient_t driven by coroutines
+ * @details Owns the C client and its event callback. Requests awaited from several coroutines are
+ * queued and sent back to back. Poll it with poll() or from an Executor.
+ */
+class Client {
+  public:
+    explicit Client(UDSTp_t *tp) {
+        UDSClientInit(&c_);
+        c_.tp = tp;
+        c_.fn = &Client::OnEvent;
+        c_.fn_data = this;
+    }
+    Client(const Client &) = delete;
+    Client &operator=(const Client &) = delete;
+
+    /** the C client, for the UDSUnpack* functions and for settings such as p2_ms */
+    UDSClient_t &c() { return c_; }
+    const UDSClient_t &c() const { return c_; }
+
+    UDSErr_t poll() { return UDSClientPoll(&c_); }
+
+    /** true while a request is in flight or queued */
+    bool busy() const {
+        return c_.queue_len > 0 || UDSClientNextDeadlineMs(&c_) != UDS_NO_DEADLINE;
+    }
+
+    /** send `data`, which must stay valid until the request completes */
+    RequestAwaiter request(const uint8_t *data, uint16_t len, uint8_t options = 0,
+                           uint16_t p2_ms = 0) {
+        return RequestAwaiter(&c_, data, len, options, p2_ms);
+    }
+
+    RequestAwaiter session(uint8_t mode) {
+        return RequestAwaiter(&c_, {kSID_DIAGNOSTIC_SESSION_CONTROL, mode}, nullptr, 0, 0);
+    }
+
+    RequestAwaiter ecu_reset(uint8_t type) {
+        return RequestAwaiter(&c_, {kSID_ECU_RESET, type}, nullptr, 0, 0);
+    }
+
+    RequestAwaiter tester_present(uint8_t options = 0) {
+        return RequestAwaiter(&c_, {kSID_TESTER_PRESENT, 0x00}, nullptr, 0, options);
+    }
+
+    /** `co_await ecu.rdbi(0xF190, 0xF18C)` */
+    template <typename... Dids> RequestAwaiter rdbi(Dids... dids) {
+        static_assert(sizeof...(dids) > 0 && 1 + 2 * sizeof...(dids) <= kInlineRequestLen, "");
+        const uint16_t ids[] = {static_cast<uint16_t>(dids)...};
+        uint8_t pairs[2 * sizeof...(dids)];
+        for (size_t i = 0; i < sizeof...(dids); i++) {
+            pairs[2 * i] = static_cast<uint8_t>(ids[i] >> 8);
+            pairs[2 * i + 1] = static_cast<uint8_t>(ids[i]);
+        }
+        return RequestAwaiter(&c_, {kSID_READ_DATA_BY_IDENTIFIER}, pairs, sizeof(pairs), 0);
+    }
+
+    RequestAwaiter wdbi(uint16_t did, const uint8_t *data, uint16_t len) {
+        return RequestAwaiter(&c_,
+                              {kSID_WRITE_DATA_BY_IDENTIFIER, static_cast<uint8_t>(did >> 8),
+                               static_cast<uint8_t>(did)},
+                              data, len, 0);
+    }
+
+    /** run UDSStartDownload() and resume once the image was accepted or the download failed */
+    DownloadAwaiter download(uint8_t dataFormatIdentifier, uint8_t addressAndLengthFormatIdentifier,
+                             size_t memoryAddress, const UDSDownloadSource_t &src) {
+        return DownloadAwaiter(*this, dataFormatIdentifier, addressAndLengthFormatIdentifier,
+                               memoryAddress, src);
+    }
+
+    /** optional observer of every client event, called before the client acts on it */
+    int (*on_event)(UDSClient_t *client, UDSEvent_t evt, void *ev_data) = nullptr;
+
+  private:
+    friend class DownloadAwaiter;
+    friend class Executor;
+
+    static int OnEvent(UDSClient_t *client, UDSEvent_t evt, void *ev_data) {
+        Client *self = static_cast<Client *>(client->fn_data);
+        if (self->on_event) {
+            self->on_event(client, evt, ev_data);
+        }
+        DownloadAwaiter *dl = self->download_;
+        if (dl && UDS_EVT_DownloadComplete == evt) {
+            self->download_ = nullptr;
+            dl->Finish(UDS_OK);
+        } else if (dl && UDS_EVT_Err == evt && UDS_DOWNLOAD_FAILED == client->download.state) {
+            self->download_ = nullptr;
+            dl->Finish(client->download.err);
+        }
+        return UDS_OK;
+    }
+
+    UDSClient_t c_;
+    DownloadAwaiter *download_ = nullptr;
+
+    // Executor bookkeeping
+    Client *next_ = nullptr;
+    int fd_ = -1;
+    bool ready_ = false;
+};
+
+inline bool DownloadAwaiter::await_suspend(std::coroutine_handle<> h) {
+    h_ = h;
+    err_ = UDSStartDownload(&client_.c_, dfi_, alfi_, addr_, &src_);
+    if (err_) {
+        return false;
+    }
+    client_.download_ = this;
+    return true;
+}
+
+#if defined(__linux__)
+/**
+ * @brief Polls many clients from one thread
+ * @details Waits in one epoll_wait on the transport descriptors of every client, bounded by the
+ * nearest client deadline, then polls the clients that have input or a deadline due. Clients
+ * added without a descriptor are polled every millisecond while busy. Run one executor per thread
+ * to spread sessions over a few threads.
+ */
+class Executor {
+  public:
+    Executor() : epfd_(epoll_create1(EPOLL_CLOEXEC)) {}
+    Executor(const Executor &) = delete;
+    Executor &operator=(const Executor &) = delete;
+    ~Executor() {
+        if (epfd_ >= 0) {
+            close(epfd_);
+        }
+    }
+
+    /**
+     * @brief Attach a client
+     * @param client must outlive the executor
+     * @param fd descriptor that becomes readable when the client's transport has data, e.g. from
+     * UDSTpIsoTpSockPollFds() or the isotp-c transport's `fd`, or -1
+     * @return false if the descriptor could not be registered
+     */
+    bool add(Client &client, int fd = -1) {
+        if (fd >= 0) {
+            struct epoll_event ev = {};
+            ev.events = EPOLLIN;
+            ev.data.ptr = &client;
+            if (epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+                return false;
+            }
+        }
+        client.fd_ = fd;
+        client.next_ = clients_;
+        clients_ = &client;
+        return true;
+    }
+
+    /** wait for at most `max_wait_ms` for input or a deadline, then poll the clients due */
+    void run_once(uint32_t max_wait_ms) {
+        uint32_t wait = max_wait_ms;
+        for (Client *c = clients_; c; c = c->next_) {
+            uint32_t d = c->fd_ < 0 && c->busy() ? 1 : UDSClientNextDeadlineMs(&c->c_);
+            wait = d < wait ? d : wait;
+        }
+        struct epoll_event evs[64];
+        int n = epoll_wait(epfd_, evs, 64, static_cast<int>(wait));
+        for (int i = 0; i < n; i++) {
+            static_cast<Client *>(evs[i].data.ptr)->ready_ = true;
+        }
+        for (Client *c = clients_; c; c = c->next_) {
+            if (c->ready_ || (c->busy() && (c->fd_ < 0 || 0 == UDSClientNextDeadlineMs(&c->c_)))) {
+                c->ready_ = false;
+                c->poll();
+            }
+        }
+    }
+
+    /** start `task` and run until it finishes */
+    UDSErr_t run(Task &task) {
+        task.start();
+        while (!task.done()) {
+            run_once(1000);
+        }
+        return task.result();
+    }
+
+  private:
+    int epfd_;
+    Client *clients_ = nullptr;
+};
+#endif
+
+} // namespace uds
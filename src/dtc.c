@@ -0,0 +1,752 @@
+#include "dtc.h"
+#include "log.h"
+#include "util.h"
+
+static uint32_t DTCOf(const UDSDTCRecord_t *rec) {
+    return (uint32_t)rec->dtc[0] << 16 | (uint32_t)rec->dtc[1] << 8 | rec->dtc[2];
+}
+
+static unsigned DTCPopCount(uint32_t x) {
+    x = x - ((x >> 1) & 0x55555555U);
+    x = (x & 0x33333333U) + ((x >> 2) & 0x33333333U);
+    x = (x + (x >> 4)) & 0x0F0F0F0FU;
+    return (unsigned)((x * 0x01010101U) >> 24);
+}
+
+/* the word of the status bitmaps that holds the records matching `mask` */
+static uint32_t DTCMatchWord(const UDSDTCStore_t *store, uint8_t mask, uint16_t word) {
+    uint32_t acc = 0;
+    for (uint8_t b = 0; b < 8; b++) {
+        if (mask & (1U << b)) {
+            acc |= store->bitmaps[b * store->words + word];
+        }
+    }
+    return acc;
+}
+
+static void DTCSetBits(UDSDTCStore_t *store, uint16_t idx, uint8_t status) {
+    uint32_t bit = 1UL << (idx % 32);
+    for (uint8_t b = 0; b < 8; b++) {
+        uint32_t *word = &store->bitmaps[b * store->words + idx / 32];
+        if (status & (1U << b)) {
+            *word |= bit;
+        } else {
+            *word &= ~bit;
+        }
+    }
+}
+
+UDSErr_t UDSDTCStoreInit(UDSDTCStore_t *store, UDSDTCRecord_t *records, uint16_t count,
+                         uint32_t *bitmaps, uint8_t availabilityMask) {
+    if (NULL == store || (count > 0 && (NULL == records || NULL == bitmaps))) {
+        return UDS_ERR_INVALID_ARG;
+    }
+
+    // insertion sort: DTC tables are defined once and are usually already sorted
+    for (uint16_t i = 1; i < count; i++) {
+        UDSDTCRecord_t tmp = records[i];
+        uint16_t j = i;
+        while (j > 0 && DTCOf(&records[j - 1]) > DTCOf(&tmp)) {
+            records[j] = records[j - 1];
+            j--;
+        }
+        records[j] = tmp;
+    }
+
+    for (uint16_t i = 1; i < count; i++) {
+        if (DTCOf(&records[i - 1]) == DTCOf(&records[i])) {
+            UDS_LOGE(__FILE__, "duplicate DTC 0x%06" PRIX32 " in store", DTCOf(&records[i]));
+            return UDS_ERR_INVALID_ARG;
+        }
+    }
+
+    store->records = records;
+    store->bitmaps = bitmaps;
+    store->count = count;
+    store->words = (uint16_t)UDS_DTC_BITMAP_WORDS(count);
+    store->availabilityMask = availabilityMask;
+    store->groups = NULL;
+    store->groupCount = 0;
+
+    if (count > 0) {
+        memset(bitmaps, 0, UDS_DTC_BITMAP_SIZE(count) * sizeof(uint32_t));
+    }
+    for (uint16_t i = 0; i < count; i++) {
+        records[i].status &= availabilityMask;
+        DTCSetBits(store, i, records[i].status);
+    }
+    return UDS_OK;
+}
+
+static int DTCFindIndex(const UDSDTCStore_t *store, uint32_t dtc) {
+    size_t lo = 0;
+    size_t hi = store->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        uint32_t cur = DTCOf(&store->records[mid]);
+        if (cur == dtc) {
+            return (int)mid;
+        } else if (cur < dtc) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return -1;
+}
+
+/* index of the first record with a DTC not below `dtc` */
+static uint16_t DTCLowerBound(const UDSDTCStore_t *store, uint32_t dtc) {
+    uint16_t lo = 0;
+    uint16_t hi = store->count;
+    while (lo < hi) {
+        uint16_t mid = (uint16_t)(lo + (hi - lo) / 2);
+        if (DTCOf(&store->records[mid]) < dtc) {
+            lo = (uint16_t)(mid + 1);
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+UDSErr_t UDSDTCStoreSetGroups(UDSDTCStore_t *store, const UDSDTCGroup_t *groups, uint16_t count) {
+    if (NULL == store || (count > 0 && NULL == groups)) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    for (uint16_t i = 0; i < count; i++) {
+        if (groups[i].first > groups[i].last ||
+            UDS_DTC_GROUP_ALL == (groups[i].group & 0xFFFFFFU)) {
+            return UDS_ERR_INVALID_ARG;
+        }
+    }
+    store->groups = count > 0 ? groups : NULL;
+    store->groupCount = count;
+    return UDS_OK;
+}
+
+static bool DTCIsGroup(const UDSDTCStore_t *store, uint32_t group) {
+    for (uint16_t i = 0; i < store->groupCount; i++) {
+        if ((store->groups[i].group & 0xFFFFFFU) == group) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool UDSDTCStoreHasGroup(const UDSDTCStore_t *store, uint32_t group) {
+    if (NULL == store) {
+        return false;
+    }
+    group &= 0xFFFFFFU;
+    return UDS_DTC_GROUP_ALL == group || DTCIsGroup(store, group) ||
+           DTCFindIndex(store, group) >= 0;
+}
+
+bool UDSDTCStoreInGroup(const UDSDTCStore_t *store, uint32_t group, uint32_t dtc) {
+    group &= 0xFFFFFFU;
+    if (UDS_DTC_GROUP_ALL == group || dtc == group) {
+        return true;
+    }
+    for (uint16_t i = 0; store && i < store->groupCount; i++) {
+        const UDSDTCGroup_t *g = &store->groups[i];
+        if ((g->group & 0xFFFFFFU) == group && dtc >= g->first && dtc <= g->last) {
+            return true;
+        }
+    }
+    return false;
+}
+
+UDSDTCRecord_t *UDSDTCStoreFind(const UDSDTCStore_t *store, uint32_t dtc) {
+    if (NULL == store) {
+        return NULL;
+    }
+    int idx = DTCFindIndex(store, dtc);
+    return idx < 0 ? NULL : &store->records[idx];
+}
+
+UDSErr_t UDSDTCStoreSetStatus(UDSDTCStore_t *store, uint32_t dtc, uint8_t status) {
+    if (NULL == store) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    int idx = DTCFindIndex(store, dtc);
+    if (idx < 0) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    status &= store->availabilityMask;
+    store->records[idx].status = status;
+    DTCSetBits(store, (uint16_t)idx, status);
+    return UDS_OK;
+}
+
+uint16_t UDSDTCStoreCountByMask(const UDSDTCStore_t *store, uint8_t mask) {
+    if (NULL == store) {
+        return 0;
+    }
+    mask &= store->availabilityMask;
+    uint32_t n = 0;
+    for (uint16_t w = 0; w < store->words; w++) {
+        n += DTCPopCount(DTCMatchWord(store, mask, w));
+    }
+    return (uint16_t)n;
+}
+
+UDSErr_t UDSDTCStoreList(const UDSDTCStore_t *store, uint8_t mask, bool all, uint8_t *dst,
+                         size_t size, size_t *len) {
+    if (NULL == store || NULL == dst || NULL == len) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    *len = 0;
+
+    if (all) {
+        if ((size_t)store->count * sizeof(UDSDTCRecord_t) > size) {
+            return UDS_ERR_BUFSIZ;
+        }
+        memcpy(dst, store->records, (size_t)store->count * sizeof(UDSDTCRecord_t));
+        *len = (size_t)store->count * sizeof(UDSDTCRecord_t);
+        return UDS_OK;
+    }
+
+    mask &= store->availabilityMask;
+    for (uint16_t w = 0; w < store->words; w++) {
+        uint32_t acc = DTCMatchWord(store, mask, w);
+        for (uint16_t idx = (uint16_t)(w * 32); acc; idx++, acc >>= 1) {
+            if (0 == (acc & 1U)) {
+                continue;
+            }
+            if (*len + sizeof(UDSDTCRecord_t) > size) {
+                return UDS_ERR_BUFSIZ;
+            }
+            memcpy(dst + *len, &store->records[idx], sizeof(UDSDTCRecord_t));
+            *len += sizeof(UDSDTCRecord_t);
+        }
+    }
+    return UDS_OK;
+}
+
+UDSErr_t UDSDTCStoreClear(UDSDTCStore_t *store, uint32_t group) {
+    if (NULL == store) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    uint8_t cleared = UDS_DTC_STATUS_CLEARED & store->availabilityMask;
+
+    group &= 0xFFFFFFU;
+
+    if (UDS_DTC_GROUP_ALL != group && DTCIsGroup(store, group)) {
+        // the records of a range are adjacent since they are sorted by DTC
+        for (uint16_t i = 0; i < store->groupCount; i++) {
+            const UDSDTCGroup_t *g = &store->groups[i];
+            if ((g->group & 0xFFFFFFU) != group) {
+                continue;
+            }
+            for (uint16_t idx = DTCLowerBound(store, g->first);
+                 idx < store->count && DTCOf(&store->records[idx]) <= g->last; idx++) {
+                store->records[idx].status = cleared;
+                DTCSetBits(store, idx, cleared);
+            }
+        }
+        return UDS_OK;
+    }
+    if (UDS_DTC_GROUP_ALL != group) {
+        return UDSDTCStoreSetStatus(store, group, cleared);
+    }
+    if (0 == store->count) {
+        return UDS_OK;
+    }
+
+    // every record gets the same status, so each bitmap is either all ones or all zeros
+    for (uint8_t b = 0; b < 8; b++) {
+        uint32_t *words = &store->bitmaps[b * store->words];
+        if (0 == (cleared & (1U << b))) {
+            memset(words, 0, store->words * sizeof(uint32_t));
+            continue;
+        }
+        for (uint16_t w = 0; w < store->words; w++) {
+            words[w] = 0xFFFFFFFFU;
+        }
+        if (store->count % 32) {
+            words[store->words - 1] = (1UL << (store->count % 32)) - 1;
+        }
+    }
+    for (uint16_t i = 0; i < store->count; i++) {
+        store->records[i].status = cleared;
+    }
+    return UDS_OK;
+}
+
+#define LOG_MAGIC 0x4454434CU /* "DTCL" */
+#define LOG_SECTOR_HDR_LEN 8U
+#define LOG_RECORD_HDR_LEN 12U
+#define LOG_TYPE_CLEAR 0x14 /* written by UDSDTCLogClear, deletes the records of a group */
+#define LOG_TYPE_COLLECTED 0x01 /* written by LogCollect once the oldest sector is copied forward */
+#define LOG_COPY_CHUNK 32U
+
+/*
+ * Sector header: magic (4), sequence number (4)
+ * Record header: type, memory, DTC (3), record number, data length (2), CRC-32 of the first 8
+ * header bytes and the data (4). All big endian. Records start at a multiple of 4.
+ */
+
+static void LogPut32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static uint32_t LogGet32(const uint8_t *p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static uint16_t LogHeadSector(const UDSDTCLog_t *log) {
+    return (uint16_t)((log->oldest + log->used - 1U) % log->flash->sectorCount);
+}
+
+static int LogCmp(const UDSDTCLogEntry_t *e, uint8_t memory, uint8_t type, uint32_t key) {
+    if (e->memory != memory) {
+        return e->memory < memory ? -1 : 1;
+    }
+    if (e->type != type) {
+        return e->type < type ? -1 : 1;
+    }
+    if (e->key != key) {
+        return e->key < key ? -1 : 1;
+    }
+    return 0;
+}
+
+/* index of the first entry that is not less than (memory, type, key) */
+static uint16_t LogLowerBound(const UDSDTCLog_t *log, uint8_t memory, uint8_t type, uint32_t key) {
+    uint16_t lo = 0;
+    uint16_t hi = log->indexCount;
+    while (lo < hi) {
+        uint16_t mid = (uint16_t)(lo + (hi - lo) / 2);
+        if (LogCmp(&log->index[mid], memory, type, key) < 0) {
+            lo = (uint16_t)(mid + 1);
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static UDSErr_t LogIndexPut(UDSDTCLog_t *log, const uint8_t *hdr, uint32_t addr) {
+    uint8_t type = hdr[0];
+    uint8_t memory = hdr[1];
+    uint32_t key = LogGet32(&hdr[2]);
+    uint16_t len = (uint16_t)(hdr[6] << 8 | hdr[7]);
+    uint16_t i = LogLowerBound(log, memory, type, key);
+    if (i == log->indexCount || 0 != LogCmp(&log->index[i], memory, type, key)) {
+        if (log->indexCount == log->indexSize) {
+            return UDS_ERR_BUFSIZ;
+        }
+        memmove(&log->index[i + 1], &log->index[i],
+                (size_t)(log->indexCount - i) * sizeof(UDSDTCLogEntry_t));
+        log->indexCount++;
+    }
+    log->index[i] = (UDSDTCLogEntry_t){
+        .key = key, .addr = addr, .len = len, .type = type, .memory = memory};
+    return UDS_OK;
+}
+
+static void LogIndexClear(UDSDTCLog_t *log, uint8_t memory, uint32_t group) {
+    uint16_t kept = 0;
+    for (uint16_t i = 0; i < log->indexCount; i++) {
+        const UDSDTCLogEntry_t *e = &log->index[i];
+        if (e->memory != memory || (UDS_DTC_GROUP_ALL != group && (e->key >> 8) != group)) {
+            log->index[kept++] = *e;
+        }
+    }
+    log->indexCount = kept;
+}
+
+static UDSErr_t LogApply(UDSDTCLog_t *log, const uint8_t *hdr, uint32_t addr) {
+    if (LOG_TYPE_COLLECTED == hdr[0]) {
+        return UDS_OK;
+    }
+    if (LOG_TYPE_CLEAR == hdr[0]) {
+        LogIndexClear(log, hdr[1], LogGet32(&hdr[2]) >> 8);
+        return UDS_OK;
+    }
+    return LogIndexPut(log, hdr, addr);
+}
+
+static UDSErr_t LogStartSector(UDSDTCLog_t *log, uint16_t sector, uint32_t seq) {
+    const UDSDTCFlash_t *f = log->flash;
+    uint8_t hdr[LOG_SECTOR_HDR_LEN];
+    LogPut32(&hdr[0], LOG_MAGIC);
+    LogPut32(&hdr[4], seq);
+    UDSErr_t err = f->program(f->ctx, (uint32_t)sector * f->sectorSize, hdr, sizeof(hdr));
+    if (UDS_OK != err) {
+        return err;
+    }
+    log->seq = seq;
+    log->head = (uint32_t)sector * f->sectorSize + LOG_SECTOR_HDR_LEN;
+    return UDS_OK;
+}
+
+/* erase a sector unless it is already blank, so that booting does not cost erase cycles */
+static UDSErr_t LogEraseIfDirty(const UDSDTCFlash_t *f, uint16_t sector) {
+    uint8_t buf[LOG_COPY_CHUNK];
+    uint32_t start = (uint32_t)sector * f->sectorSize;
+    for (uint32_t off = 0; off < f->sectorSize; off += sizeof(buf)) {
+        size_t n = f->sectorSize - off < sizeof(buf) ? f->sectorSize - off : sizeof(buf);
+        UDSErr_t err = f->read(f->ctx, start + off, buf, n);
+        if (UDS_OK != err) {
+            return err;
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (0xFF != buf[i]) {
+                return f->erase(f->ctx, start);
+            }
+        }
+    }
+    return UDS_OK;
+}
+
+/* copy `len` bytes within the flash */
+static UDSErr_t LogCopy(const UDSDTCFlash_t *f, uint32_t dst, uint32_t src, uint32_t len) {
+    uint8_t buf[LOG_COPY_CHUNK];
+    for (uint32_t off = 0; off < len; off += sizeof(buf)) {
+        size_t n = len - off < sizeof(buf) ? len - off : sizeof(buf);
+        UDSErr_t err = f->read(f->ctx, src + off, buf, n);
+        if (UDS_OK == err) {
+            err = f->program(f->ctx, dst + off, buf, n);
+        }
+        if (UDS_OK != err) {
+            return err;
+        }
+    }
+    return UDS_OK;
+}
+
+/* program a record at head, which the caller made sure is in the head sector */
+static UDSErr_t LogProgram(UDSDTCLog_t *log, uint8_t *hdr, const void *data, uint16_t len,
+                           uint32_t *addr) {
+    const UDSDTCFlash_t *f = log->flash;
+    hdr[6] = (uint8_t)(len >> 8);
+    hdr[7] = (uint8_t)len;
+    LogPut32(&hdr[8], UDSCRC32(UDSCRC32(0, hdr, 8), data, len));
+
+    UDSErr_t err = f->program(f->ctx, log->head, hdr, LOG_RECORD_HDR_LEN);
+    if (UDS_OK == err && len > 0) {
+        err = f->program(f->ctx, log->head + LOG_RECORD_HDR_LEN, data, len);
+    }
+    *addr = log->head;
+    // skip a partially programmed record as well
+    log->head += UDS_DTC_LOG_RECORD_SIZE(len);
+    return err;
+}
+
+/* erase the oldest sector, whose live records have been copied forward */
+static UDSErr_t LogReclaim(UDSDTCLog_t *log) {
+    const UDSDTCFlash_t *f = log->flash;
+    UDSErr_t err = f->erase(f->ctx, (uint32_t)log->oldest * f->sectorSize);
+    if (UDS_OK != err) {
+        return err;
+    }
+    log->oldest = (uint16_t)((log->oldest + 1U) % f->sectorCount);
+    log->used--;
+    return UDS_OK;
+}
+
+/*
+ * Copy the live records of the oldest sector to the head, which LogAdvance just started in an
+ * erased sector, and erase the oldest sector once a LOG_TYPE_COLLECTED record marks the copy
+ * complete. UDSDTCLogInit() makes the copy again after a reset before the mark and only erases
+ * after a reset behind it.
+ */
+static UDSErr_t LogCollect(UDSDTCLog_t *log) {
+    const UDSDTCFlash_t *f = log->flash;
+    uint32_t start = (uint32_t)log->oldest * f->sectorSize;
+    uint32_t headEnd = ((uint32_t)LogHeadSector(log) + 1U) * f->sectorSize;
+    for (uint16_t i = 0; i < log->indexCount; i++) {
+        UDSDTCLogEntry_t *e = &log->index[i];
+        if (e->addr < start || e->addr >= start + f->sectorSize) {
+            continue;
+        }
+        uint32_t size = UDS_DTC_LOG_RECORD_SIZE(e->len);
+        if (log->head + size + UDS_DTC_LOG_RECORD_SIZE(0) > headEnd) {
+            UDS_LOGE(__FILE__, "DTC log full");
+            return UDS_ERR_BUFSIZ;
+        }
+        UDSErr_t err = LogCopy(f, log->head, e->addr, LOG_RECORD_HDR_LEN + e->len);
+        if (UDS_OK != err) {
+            return err;
+        }
+        e->addr = log->head;
+        log->head += size;
+    }
+    uint8_t hdr[LOG_RECORD_HDR_LEN] = {LOG_TYPE_COLLECTED};
+    uint32_t addr = 0;
+    UDSErr_t err = LogProgram(log, hdr, NULL, 0, &addr);
+    if (UDS_OK != err) {
+        return err;
+    }
+    return LogReclaim(log);
+}
+
+/* continue in the next sector, which is always erased, and keep one sector free */
+static UDSErr_t LogAdvance(UDSDTCLog_t *log) {
+    uint16_t next = (uint16_t)((log->oldest + log->used) % log->flash->sectorCount);
+    UDSErr_t err = LogStartSector(log, next, log->seq + 1U);
+    if (UDS_OK != err) {
+        return err;
+    }
+    log->used++;
+    return log->used == log->flash->sectorCount ? LogCollect(log) : UDS_OK;
+}
+
+static UDSErr_t LogAppend(UDSDTCLog_t *log, uint8_t *hdr, const void *data, uint16_t len,
+                          uint32_t *addr) {
+    const UDSDTCFlash_t *f = log->flash;
+    uint32_t size = UDS_DTC_LOG_RECORD_SIZE(len);
+    for (uint16_t tries = 0;
+         log->head + size > ((uint32_t)LogHeadSector(log) + 1U) * f->sectorSize; tries++) {
+        if (tries == f->sectorCount) {
+            UDS_LOGE(__FILE__, "DTC log full");
+            return UDS_ERR_BUFSIZ;
+        }
+        UDSErr_t err = LogAdvance(log);
+        if (UDS_OK != err) {
+            return err;
+        }
+    }
+
+    return LogProgram(log, hdr, data, len, addr);
+}
+
+/* verify the CRC of a record of the newest sector, which may have been cut short by a reset */
+static bool LogRecordIntact(const UDSDTCFlash_t *f, const uint8_t *hdr, uint32_t addr) {
+    uint8_t buf[LOG_COPY_CHUNK];
+    uint16_t len = (uint16_t)(hdr[6] << 8 | hdr[7]);
+    uint32_t crc = UDSCRC32(0, hdr, 8);
+    for (uint32_t off = 0; off < len; off += sizeof(buf)) {
+        size_t n = len - off < sizeof(buf) ? len - off : sizeof(buf);
+        if (UDS_OK != f->read(f->ctx, addr + LOG_RECORD_HDR_LEN + off, buf, n)) {
+            return false;
+        }
+        crc = UDSCRC32(crc, buf, n);
+    }
+    return crc == LogGet32(&hdr[8]);
+}
+
+/**
+ * @brief Replay the record headers of a sector into the index
+ * @param collected set if the sector holds a LOG_TYPE_COLLECTED record
+ * @return offset after the last record, or sectorSize if the sector ends in a damaged record
+ */
+static uint32_t LogScanSector(UDSDTCLog_t *log, uint16_t sector, bool newest, bool *collected,
+                              UDSErr_t *err) {
+    const UDSDTCFlash_t *f = log->flash;
+    uint32_t start = (uint32_t)sector * f->sectorSize;
+    uint32_t off = LOG_SECTOR_HDR_LEN;
+    while (off + LOG_RECORD_HDR_LEN <= f->sectorSize) {
+        uint8_t hdr[LOG_RECORD_HDR_LEN];
+        *err = f->read(f->ctx, start + off, hdr, sizeof(hdr));
+        if (UDS_OK != *err) {
+            return f->sectorSize;
+        }
+        if (0xFF == hdr[0]) {
+            for (size_t i = 1; i < sizeof(hdr); i++) {
+                if (0xFF != hdr[i]) {
+                    return f->sectorSize;
+                }
+            }
+            return off;
+        }
+        uint16_t len = (uint16_t)(hdr[6] << 8 | hdr[7]);
+        if (off + UDS_DTC_LOG_RECORD_SIZE(len) > f->sectorSize ||
+            (newest && !LogRecordIntact(f, hdr, start + off))) {
+            UDS_LOGW(__FILE__, "DTC log: damaged record at 0x%08" PRIX32, start + off);
+            return f->sectorSize;
+        }
+        *err = LogApply(log, hdr, start + off);
+        if (UDS_OK != *err) {
+            return f->sectorSize;
+        }
+        *collected = *collected || LOG_TYPE_COLLECTED == hdr[0];
+        off += UDS_DTC_LOG_RECORD_SIZE(len);
+    }
+    return off;
+}
+
+/* rebuild the index from the sectors in use and find the head */
+static UDSErr_t LogScan(UDSDTCLog_t *log, bool *collected) {
+    const UDSDTCFlash_t *f = log->flash;
+    UDSErr_t err = UDS_OK;
+    log->indexCount = 0;
+    for (uint16_t i = 0; i < log->used; i++) {
+        uint16_t s = (uint16_t)((log->oldest + i) % f->sectorCount);
+        bool newest = i + 1U == log->used;
+        *collected = false; // only the newest sector matters
+        uint32_t end = LogScanSector(log, s, newest, collected, &err);
+        if (UDS_OK != err) {
+            return err;
+        }
+        log->head = (uint32_t)s * f->sectorSize + end;
+    }
+    return UDS_OK;
+}
+
+UDSErr_t UDSDTCLogInit(UDSDTCLog_t *log, const UDSDTCFlash_t *flash, UDSDTCLogEntry_t *index,
+                       uint16_t indexSize) {
+    if (NULL == log || NULL == flash || NULL == flash->read || NULL == flash->program ||
+        NULL == flash->erase || flash->sectorCount < 2 || flash->sectorSize % 4 ||
+        flash->sectorSize < LOG_SECTOR_HDR_LEN + LOG_RECORD_HDR_LEN ||
+        (indexSize > 0 && NULL == index)) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    memset(log, 0, sizeof(*log));
+    log->flash = flash;
+    log->index = index;
+    log->indexSize = indexSize;
+
+    // the oldest sector is the valid one with the lowest sequence number
+    UDSErr_t err = UDS_OK;
+    bool found = false;
+    for (uint16_t s = 0; s < flash->sectorCount; s++) {
+        uint8_t hdr[LOG_SECTOR_HDR_LEN];
+        err = flash->read(flash->ctx, (uint32_t)s * flash->sectorSize, hdr, sizeof(hdr));
+        if (UDS_OK != err) {
+            return err;
+        }
+        if (LOG_MAGIC == LogGet32(&hdr[0]) && (!found || LogGet32(&hdr[4]) < log->seq)) {
+            found = true;
+            log->oldest = s;
+            log->seq = LogGet32(&hdr[4]);
+        }
+    }
+
+    // followed by the sectors with consecutive sequence numbers
+    uint32_t seq = log->seq;
+    while (found && log->used < flash->sectorCount) {
+        uint16_t s = (uint16_t)((log->oldest + log->used) % flash->sectorCount);
+        uint8_t hdr[LOG_SECTOR_HDR_LEN];
+        err = flash->read(flash->ctx, (uint32_t)s * flash->sectorSize, hdr, sizeof(hdr));
+        if (UDS_OK != err) {
+            return err;
+        }
+        if (LOG_MAGIC != LogGet32(&hdr[0]) || seq + log->used != LogGet32(&hdr[4])) {
+            break;
+        }
+        log->used++;
+    }
+
+    // whatever is left over from an interrupted erase or a previous layout is erased
+    for (uint16_t i = log->used; i < flash->sectorCount; i++) {
+        err = LogEraseIfDirty(flash, (uint16_t)((log->oldest + i) % flash->sectorCount));
+        if (UDS_OK != err) {
+            return err;
+        }
+    }
+
+    if (!found) {
+        log->used = 1;
+        return LogStartSector(log, 0, 1);
+    }
+
+    bool collected = false;
+    err = LogScan(log, &collected);
+    if (UDS_OK != err) {
+        return err;
+    }
+    log->seq = seq + log->used - 1U;
+    if (log->used < flash->sectorCount) {
+        return UDS_OK;
+    }
+
+    // a reset while the oldest sector was being collected leaves no free sector. Once the copy is
+    // marked complete only the erase is missing, otherwise the partial copy is erased and made again
+    if (collected) {
+        return LogReclaim(log);
+    }
+    err = flash->erase(flash->ctx, (uint32_t)LogHeadSector(log) * flash->sectorSize);
+    if (UDS_OK != err) {
+        return err;
+    }
+    log->used--;
+    log->seq--;
+    err = LogScan(log, &collected);
+    if (UDS_OK != err) {
+        return err;
+    }
+    return LogAdvance(log);
+}
+
+UDSErr_t UDSDTCLogWrite(UDSDTCLog_t *log, uint8_t type, uint8_t memory, uint32_t dtc,
+                        uint8_t recordNum, const void *data, uint16_t len) {
+    if (NULL == log || NULL == log->flash || (len > 0 && NULL == data) || dtc > 0xFFFFFFU ||
+        UDS_DTC_LOG_ALL_RECORDS == recordNum ||
+        (UDS_DTC_LOG_SNAPSHOT != type && UDS_DTC_LOG_EXT_DATA != type) ||
+        UDS_DTC_LOG_RECORD_SIZE(len) > log->flash->sectorSize - LOG_SECTOR_HDR_LEN) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    uint32_t key = dtc << 8 | recordNum;
+    uint16_t i = LogLowerBound(log, memory, type, key);
+    if (log->indexCount == log->indexSize &&
+        (i == log->indexCount || 0 != LogCmp(&log->index[i], memory, type, key))) {
+        return UDS_ERR_BUFSIZ;
+    }
+
+    uint8_t hdr[LOG_RECORD_HDR_LEN] = {type, memory};
+    LogPut32(&hdr[2], key);
+    uint32_t addr = 0;
+    UDSErr_t err = LogAppend(log, hdr, data, len, &addr);
+    if (UDS_OK != err) {
+        return err;
+    }
+    return LogIndexPut(log, hdr, addr);
+}
+
+UDSErr_t UDSDTCLogRead(const UDSDTCLog_t *log, uint8_t type, uint8_t memory, uint32_t dtc,
+                       uint8_t recordNum, uint8_t *dst, size_t size, size_t *len) {
+    if (NULL == log || NULL == log->flash || NULL == dst || NULL == len) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    *len = 0;
+    uint8_t first = UDS_DTC_LOG_ALL_RECORDS == recordNum ? 0 : recordNum;
+    for (uint16_t i = LogLowerBound(log, memory, type, (dtc & 0xFFFFFFU) << 8 | first);
+         i < log->indexCount; i++) {
+        const UDSDTCLogEntry_t *e = &log->index[i];
+        if (e->memory != memory || e->type != type || (e->key >> 8) != (dtc & 0xFFFFFFU) ||
+            (UDS_DTC_LOG_ALL_RECORDS != recordNum && (e->key & 0xFF) != recordNum)) {
+            break;
+        }
+        if (*len + 1U + e->len > size) {
+            return UDS_ERR_BUFSIZ;
+        }
+        dst[*len] = (uint8_t)(e->key & 0xFF);
+        UDSErr_t err =
+            log->flash->read(log->flash->ctx, e->addr + LOG_RECORD_HDR_LEN, dst + *len + 1, e->len);
+        if (UDS_OK != err) {
+            return err;
+        }
+        *len += 1U + e->len;
+    }
+    return UDS_OK;
+}
+
+UDSErr_t UDSDTCLogClear(UDSDTCLog_t *log, uint8_t memory, uint32_t group) {
+    if (NULL == log || NULL == log->flash) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    group &= 0xFFFFFFU;
+    // nothing to write if the group has no records
+    bool any = false;
+    for (uint16_t i = 0; i < log->indexCount && !any; i++) {
+        const UDSDTCLogEntry_t *e = &log->index[i];
+        any = e->memory == memory && (UDS_DTC_GROUP_ALL == group || (e->key >> 8) == group);
+    }
+    if (!any) {
+        return UDS_OK;
+    }
+    uint8_t hdr[LOG_RECORD_HDR_LEN] = {LOG_TYPE_CLEAR, memory};
+    LogPut32(&hdr[2], group << 8);
+    uint32_t addr = 0;
+    UDSErr_t err = LogAppend(log, hdr, NULL, 0, &addr);
+    if (UDS_OK != err) {
+        return err;
+    }
+    return LogApply(log, hdr, addr);
+}
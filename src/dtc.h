@@ -0,0 +1,247 @@
+#pragma once
+
+#include "sys.h"
+#include "config.h"
+#include "uds.h"
+
+/**
+ * @brief DTC status bits (ISO14229-1 D.2)
+ */
+#define UDS_DTC_STATUS_TF 0x01     /**< testFailed */
+#define UDS_DTC_STATUS_TFTOC 0x02  /**< testFailedThisOperationCycle */
+#define UDS_DTC_STATUS_PDTC 0x04   /**< pendingDTC */
+#define UDS_DTC_STATUS_CDTC 0x08   /**< confirmedDTC */
+#define UDS_DTC_STATUS_TNCSLC 0x10 /**< testNotCompletedSinceLastClear */
+#define UDS_DTC_STATUS_TFSLC 0x20  /**< testFailedSinceLastClear */
+#define UDS_DTC_STATUS_TNCTOC 0x40 /**< testNotCompletedThisOperationCycle */
+#define UDS_DTC_STATUS_WIR 0x80    /**< warningIndicatorRequested */
+
+/** status of a DTC after ClearDiagnosticInformation */
+#define UDS_DTC_STATUS_CLEARED (UDS_DTC_STATUS_TNCSLC | UDS_DTC_STATUS_TNCTOC)
+
+/** groupOfDTC that selects all DTCs */
+#define UDS_DTC_GROUP_ALL 0xFFFFFFU
+
+/** DTCFormatIdentifier reported by reportNumberOfDTCByStatusMask: ISO14229-1_DTCFormat */
+#define UDS_DTC_FORMAT_ISO14229_1 0x01
+
+/** number of bitmap words needed per status bit for `n` DTCs */
+#define UDS_DTC_BITMAP_WORDS(n) (((n) + 31U) / 32U)
+
+/** size of the storage passed to UDSDTCStoreInit as `bitmaps`, in uint32_t words */
+#define UDS_DTC_BITMAP_SIZE(n) (8U * UDS_DTC_BITMAP_WORDS(n))
+
+/**
+ * @brief A DTC and its status in the layout used on the wire by 0x19 (DTC high byte first)
+ */
+typedef struct {
+    uint8_t dtc[3]; /**< DTCHighByte, DTCMiddleByte, DTCLowByte */
+    uint8_t status; /**< statusOfDTC (UDS_DTC_STATUS_*) */
+} UDSDTCRecord_t;
+
+/**
+ * @brief DTCs that belong to a functional group of ClearDiagnosticInformation (0x14), such as
+ * 0xFFFF33 (emissions-system group). A group may be made of several ranges
+ */
+typedef struct {
+    uint32_t group; /**< groupOfDTC */
+    uint32_t first; /**< lowest DTC of the range */
+    uint32_t last;  /**< highest DTC of the range */
+} UDSDTCGroup_t;
+
+/**
+ * @brief Indexed DTC database
+ * @details Records are kept sorted by DTC. For every status bit there is a bitmap with one bit per
+ * record, so counting and listing the DTCs that match a status mask touches one word per 32 DTCs
+ * instead of every record. All storage is provided by the caller.
+ */
+typedef struct {
+    UDSDTCRecord_t *records;  /**< DTC records sorted by DTC */
+    uint32_t *bitmaps;        /**< UDS_DTC_BITMAP_SIZE(count) words: bit `b` of record `i` is
+                                 bit i % 32 of bitmaps[b * words + i / 32] */
+    uint16_t count;           /**< number of records */
+    uint16_t words;           /**< UDS_DTC_BITMAP_WORDS(count) */
+    uint8_t availabilityMask; /**< DTCStatusAvailabilityMask: status bits supported by the ECU */
+    const UDSDTCGroup_t *groups; /**< functional groups (UDSDTCStoreSetGroups), may be NULL */
+    uint16_t groupCount;         /**< number of entries in groups */
+} UDSDTCStore_t;
+
+/**
+ * @brief Initialize a DTC store
+ * @param store
+ * @param records DTC records. Sorted in place by DTC. Initial statuses are taken from the records
+ * @param count number of records
+ * @param bitmaps storage for UDS_DTC_BITMAP_SIZE(count) words
+ * @param availabilityMask status bits supported by the ECU. Other bits are masked off
+ * @return UDS_OK, or UDS_ERR_INVALID_ARG if a DTC appears twice
+ */
+UDSErr_t UDSDTCStoreInit(UDSDTCStore_t *store, UDSDTCRecord_t *records, uint16_t count,
+                         uint32_t *bitmaps, uint8_t availabilityMask);
+
+/**
+ * @brief Define the functional groups that UDSDTCStoreClear accepts besides UDS_DTC_GROUP_ALL and
+ * single DTCs
+ * @param store initialized store
+ * @param groups ranges of DTCs by group. Must remain valid for the lifetime of the store
+ * @param count number of entries in groups. 0 removes the groups
+ * @return UDS_OK, or UDS_ERR_INVALID_ARG if a range is empty or claims UDS_DTC_GROUP_ALL
+ */
+UDSErr_t UDSDTCStoreSetGroups(UDSDTCStore_t *store, const UDSDTCGroup_t *groups, uint16_t count);
+
+/**
+ * @brief Check whether `group` is UDS_DTC_GROUP_ALL, a functional group or a DTC of the store
+ */
+bool UDSDTCStoreHasGroup(const UDSDTCStore_t *store, uint32_t group);
+
+/**
+ * @brief Check whether `dtc` is selected by `group`: UDS_DTC_GROUP_ALL, the DTC itself or a
+ * functional group that holds it
+ */
+bool UDSDTCStoreInGroup(const UDSDTCStore_t *store, uint32_t group, uint32_t dtc);
+
+/**
+ * @brief Find the record of a DTC
+ * @return the record or NULL
+ */
+UDSDTCRecord_t *UDSDTCStoreFind(const UDSDTCStore_t *store, uint32_t dtc);
+
+/**
+ * @brief Set the status of a DTC
+ * @return UDS_OK, or UDS_ERR_INVALID_ARG if the DTC is not in the store
+ */
+UDSErr_t UDSDTCStoreSetStatus(UDSDTCStore_t *store, uint32_t dtc, uint8_t status);
+
+/**
+ * @brief Count the DTCs for which (status & mask) != 0
+ */
+uint16_t UDSDTCStoreCountByMask(const UDSDTCStore_t *store, uint8_t mask);
+
+/**
+ * @brief Write the DTCs for which (status & mask) != 0 to `dst` as 4 byte DTCAndStatusRecords
+ * @param store
+ * @param mask status mask
+ * @param all ignore `mask` and list every DTC (reportSupportedDTC)
+ * @param dst destination
+ * @param size size of dst in bytes
+ * @param len number of bytes written
+ * @return UDS_OK, or UDS_ERR_BUFSIZ if dst is too small
+ */
+UDSErr_t UDSDTCStoreList(const UDSDTCStore_t *store, uint8_t mask, bool all, uint8_t *dst,
+                         size_t size, size_t *len);
+
+/**
+ * @brief Reset the status of a group of DTCs to UDS_DTC_STATUS_CLEARED
+ * @param store
+ * @param group UDS_DTC_GROUP_ALL, a functional group (UDSDTCStoreSetGroups) or a single DTC
+ * @return UDS_OK, or UDS_ERR_INVALID_ARG if the group is unknown
+ */
+UDSErr_t UDSDTCStoreClear(UDSDTCStore_t *store, uint32_t group);
+
+/** UDSDTCLogEntry_t.type of a DTCSnapshotRecord (0x19 subfunctions 0x04 and 0x18) */
+#define UDS_DTC_LOG_SNAPSHOT 0x04
+/** UDSDTCLogEntry_t.type of a DTCExtendedDataRecord (0x19 subfunctions 0x06 and 0x19) */
+#define UDS_DTC_LOG_EXT_DATA 0x06
+/** record number that selects every record of a DTC */
+#define UDS_DTC_LOG_ALL_RECORDS 0xFF
+
+/** bytes taken in flash by a record with `len` bytes of data: a 12 byte header, padded to 4 */
+#define UDS_DTC_LOG_RECORD_SIZE(len) ((12U + (len) + 3U) & ~3U)
+
+/**
+ * @brief Flash driver of a UDSDTCLog_t. Addresses are offsets into the area of the log, which is
+ * `sectorCount` sectors of `sectorSize` bytes. Erased flash reads as 0xFF.
+ */
+typedef struct {
+    /*! read `len` bytes at `addr` */
+    UDSErr_t (*read)(void *ctx, uint32_t addr, void *dst, size_t len);
+    /*! program `len` bytes at `addr`. Only ever called on erased flash, with addr aligned to 4 */
+    UDSErr_t (*program)(void *ctx, uint32_t addr, const void *src, size_t len);
+    /*! erase the sector that starts at `addr` */
+    UDSErr_t (*erase)(void *ctx, uint32_t addr);
+    uint32_t sectorSize;  /**< a multiple of 4 */
+    uint16_t sectorCount; /**< at least 2 */
+    void *ctx;            /**< passed to read, program and erase */
+} UDSDTCFlash_t;
+
+/**
+ * @brief Location of the newest record of a DTC
+ */
+typedef struct {
+    uint32_t key;   /**< DTC << 8 | record number */
+    uint32_t addr;  /**< offset of the record in the log */
+    uint16_t len;   /**< length of the record data */
+    uint8_t type;   /**< UDS_DTC_LOG_SNAPSHOT or UDS_DTC_LOG_EXT_DATA */
+    uint8_t memory; /**< MemorySelection of 0x18/0x19. 0 for the primary memory (0x04/0x06) */
+} UDSDTCLogEntry_t;
+
+/**
+ * @brief Append-only log of DTC snapshot and extended data records in flash
+ * @details Records are only ever appended, so writing one programs a few bytes instead of
+ * rewriting a sector. The sectors are used in turn: when the last free one is taken, the records
+ * of the oldest sector that have not been replaced are copied forward and the oldest sector is
+ * erased, which spreads erase cycles evenly over the area. A RAM index sorted by DTC points at the
+ * newest copy of every record and is rebuilt from the record headers by UDSDTCLogInit().
+ */
+typedef struct {
+    const UDSDTCFlash_t *flash;
+    UDSDTCLogEntry_t *index; /**< sorted by memory, type and key */
+    uint16_t indexSize;      /**< capacity of index */
+    uint16_t indexCount;     /**< entries used in index */
+    uint16_t oldest;         /**< oldest sector in use */
+    uint16_t used;           /**< sectors in use, the newest being the one that holds head */
+    uint32_t head;           /**< offset at which the next record is appended */
+    uint32_t seq;            /**< sequence number of the newest sector */
+} UDSDTCLog_t;
+
+/**
+ * @brief Open a record log, formatting the flash if it holds none
+ * @param log
+ * @param flash flash driver, must outlive the log
+ * @param index storage for the RAM index: one entry per record that can be stored
+ * @param indexSize number of entries in index
+ * @return UDS_OK, UDS_ERR_INVALID_ARG, UDS_ERR_BUFSIZ if the index is too small for the records in
+ * flash, or the error of the flash driver
+ */
+UDSErr_t UDSDTCLogInit(UDSDTCLog_t *log, const UDSDTCFlash_t *flash, UDSDTCLogEntry_t *index,
+                       uint16_t indexSize);
+
+/**
+ * @brief Store a record, replacing the previous record with the same memory, type, DTC and number
+ * @param log
+ * @param type UDS_DTC_LOG_SNAPSHOT or UDS_DTC_LOG_EXT_DATA
+ * @param memory MemorySelection, 0 for the primary memory
+ * @param dtc
+ * @param recordNum DTCSnapshotRecordNumber or DTCExtDataRecordNumber, 0x01-0xFE
+ * @param data record as sent after the record number: for snapshots, starting with
+ * DTCSnapshotRecordNumberOfIdentifiers
+ * @param len length of data
+ * @return UDS_OK, UDS_ERR_INVALID_ARG, UDS_ERR_BUFSIZ if the index or the flash is full, or the
+ * error of the flash driver
+ */
+UDSErr_t UDSDTCLogWrite(UDSDTCLog_t *log, uint8_t type, uint8_t memory, uint32_t dtc,
+                        uint8_t recordNum, const void *data, uint16_t len);
+
+/**
+ * @brief Copy records of a DTC from flash to `dst`, each as its record number followed by its data,
+ * in order of record number
+ * @param log
+ * @param type UDS_DTC_LOG_SNAPSHOT or UDS_DTC_LOG_EXT_DATA
+ * @param memory
+ * @param dtc
+ * @param recordNum a record number or UDS_DTC_LOG_ALL_RECORDS
+ * @param dst destination
+ * @param size size of dst in bytes
+ * @param len number of bytes written. 0 if there is no such record
+ * @return UDS_OK, UDS_ERR_BUFSIZ if dst is too small, or the error of the flash driver
+ */
+UDSErr_t UDSDTCLogRead(const UDSDTCLog_t *log, uint8_t type, uint8_t memory, uint32_t dtc,
+                       uint8_t recordNum, uint8_t *dst, size_t size, size_t *len);
+
+/**
+ * @brief Delete the records of a group of DTCs
+ * @param log
+ * @param memory MemorySelection, 0 for the primary memory
+ * @param group UDS_DTC_GROUP_ALL or a single DTC
+ * @return UDS_OK or an error of UDSDTCLogWrite()
+ */
+UDSErr_t UDSDTCLogClear(UDSDTCLog_t *log, uint8_t memory, uint32_t group);
@@ -0,0 +1,246 @@
+#include "host.h"
+
+#if defined(UDS_TP_ISOTP_SOCK) && UDS_SYS == UDS_SYS_UNIX && defined(__linux__)
+
+#include "log.h"
+#include "util.h"
+#include <errno.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// The kernel finishes a multi-frame send on its own and the physical socket becoming writable
+// wakes the worker. Until then the server is only polled this often instead of continuously.
+#define HOST_SEND_RECHECK_MS (10)
+
+/**
+ * @brief The events a server needs to be woken for
+ * @details A single tester server does not read while it works on a request, so the sockets are
+ * not watched for input until it is done. Otherwise a waiting request would wake the worker in a
+ * loop.
+ */
+static void HostWantedEvents(const UDSHostServer_t *hs, uint32_t events[2]) {
+    struct pollfd fds[2];
+    UDSTpIsoTpSockPollFds(hs->tp, fds);
+    bool busy = false;
+#if UDS_SERVER_MAX_TESTERS == 1 && UDS_SERVER_RCRRP_QUEUE_LEN > 0
+    // requests received while a response is pending are queued
+    busy = (hs->srv->requestInProgress && !hs->srv->RCRRP) || hs->srv->notReadyToReceive;
+#elif UDS_SERVER_MAX_TESTERS == 1
+    busy = hs->srv->requestInProgress || hs->srv->notReadyToReceive;
+#endif
+    for (int i = 0; i < 2; i++) {
+        // POLLIN and POLLOUT have the values of EPOLLIN and EPOLLOUT
+        events[i] = (uint32_t)fds[i].events & (busy ? (uint32_t)EPOLLOUT : UINT32_MAX);
+    }
+}
+
+static int HostWatch(UDSHostWorker_t *w, UDSHostServer_t *hs, int op) {
+    uint32_t events[2];
+    HostWantedEvents(hs, events);
+    int fds[2] = {hs->tp->phys_fd, hs->tp->func_fd};
+    for (int i = 0; i < 2; i++) {
+        if (EPOLL_CTL_MOD == op && events[i] == hs->events[i]) {
+            continue;
+        }
+        struct epoll_event ev = {.events = events[i], .data.ptr = hs};
+        if (epoll_ctl(w->epfd, op, fds[i], &ev) < 0) {
+            UDS_LOGE(__FILE__, "epoll_ctl failed: %d", errno);
+            return -1;
+        }
+        hs->events[i] = events[i];
+    }
+    return 0;
+}
+
+/**
+ * @brief Update the socket events of the servers polled by the last UDSSchedulerPoll
+ */
+static int HostAfterPoll(UDSHostWorker_t *w) {
+    for (uint8_t i = 0; i < w->count; i++) {
+        UDSHostServer_t *hs = w->servers[i];
+        if (hs->srv->now != w->sched.now) {
+            continue; // not polled, nothing changed
+        }
+        if (HostWatch(w, hs, EPOLL_CTL_MOD) < 0) {
+            return -1;
+        }
+        if (hs->tp->send_in_progress) {
+            UDSSchedulerDefer(&w->sched, hs->entry, HOST_SEND_RECHECK_MS);
+        }
+    }
+    return 0;
+}
+
+static void *HostWorkerMain(void *arg) {
+    UDSHostWorker_t *w = arg;
+    UDSSchedulerPoll(&w->sched);
+    if (HostAfterPoll(w) < 0) {
+        w->err = UDS_FAIL;
+        return NULL;
+    }
+    for (;;) {
+        struct epoll_event events[32];
+        uint32_t ms = UDSSchedulerNextDeadlineMs(&w->sched);
+        int timeout = UDS_NO_DEADLINE == ms ? -1 : (ms > INT32_MAX ? INT32_MAX : (int)ms);
+        int n = epoll_wait(w->epfd, events, sizeof(events) / sizeof(events[0]), timeout);
+        if (n < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+            UDS_LOGE(__FILE__, "epoll_wait failed: %d", errno);
+            w->err = UDS_FAIL;
+            return NULL;
+        }
+        for (int i = 0; i < n; i++) {
+            UDSHostServer_t *hs = events[i].data.ptr;
+            if (NULL == hs) {
+                return NULL; // stopfd
+            }
+            UDSSchedulerWake(&w->sched, hs->entry);
+        }
+        UDSSchedulerPoll(&w->sched);
+        if (HostAfterPoll(w) < 0) {
+            w->err = UDS_FAIL;
+            return NULL;
+        }
+    }
+}
+
+UDSErr_t UDSHostInit(UDSHost_t *host, UDSHostServer_t *servers, size_t count, size_t numWorkers) {
+    if (NULL == host || (count > 0 && NULL == servers) || 0 == numWorkers ||
+        numWorkers > UDS_HOST_MAX_WORKERS) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    if ((count + numWorkers - 1) / numWorkers > UDS_SCHEDULER_MAX_ENTRIES) {
+        return UDS_ERR_BUFSIZ;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (NULL == servers[i].srv || NULL == servers[i].tp) {
+            return UDS_ERR_INVALID_ARG;
+        }
+    }
+
+    memset(host, 0, sizeof(*host));
+    host->servers = servers;
+    host->count = count;
+    host->numWorkers = numWorkers;
+    host->stopfd = -1;
+    for (size_t i = 0; i < numWorkers; i++) {
+        UDSHostWorker_t *w = &host->workers[i];
+        w->host = host;
+        w->cpu = (int)i;
+        w->epfd = -1;
+        UDSSchedulerInit(&w->sched);
+    }
+    for (size_t i = 0; i < count; i++) {
+        UDSHostServer_t *hs = &servers[i];
+        UDSHostWorker_t *w = &host->workers[i % numWorkers];
+        hs->srv->tp = &hs->tp->hdl;
+        hs->tp->poll_timeout_ms = 0;
+        hs->entry = UDSSchedulerAddServer(&w->sched, hs->srv);
+        w->servers[w->count++] = hs;
+    }
+    return UDS_OK;
+}
+
+/**
+ * @brief Close the descriptors opened by UDSHostStart
+ */
+static void HostClose(UDSHost_t *host) {
+    for (size_t i = 0; i < host->numWorkers; i++) {
+        if (host->workers[i].epfd >= 0) {
+            close(host->workers[i].epfd);
+            host->workers[i].epfd = -1;
+        }
+    }
+    if (host->stopfd >= 0) {
+        close(host->stopfd);
+        host->stopfd = -1;
+    }
+}
+
+static UDSErr_t HostOpenWorker(UDSHost_t *host, UDSHostWorker_t *w) {
+    w->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (w->epfd < 0) {
+        UDS_LOGE(__FILE__, "epoll_create1 failed: %d", errno);
+        return UDS_FAIL;
+    }
+    struct epoll_event ev = {.events = EPOLLIN, .data.ptr = NULL};
+    if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, host->stopfd, &ev) < 0) {
+        UDS_LOGE(__FILE__, "epoll_ctl failed: %d", errno);
+        return UDS_FAIL;
+    }
+    for (uint8_t i = 0; i < w->count; i++) {
+        if (HostWatch(w, w->servers[i], EPOLL_CTL_ADD) < 0) {
+            return UDS_FAIL;
+        }
+    }
+    return UDS_OK;
+}
+
+/**
+ * @brief Wake the first `n` workers to stop and wait for them
+ */
+static UDSErr_t HostJoin(UDSHost_t *host, size_t n) {
+    // the counter stays nonzero, so every worker sees the descriptor readable
+    uint64_t one = 1;
+    if (write(host->stopfd, &one, sizeof(one)) != sizeof(one)) {
+        UDS_LOGE(__FILE__, "eventfd write failed: %d", errno);
+    }
+    UDSErr_t err = UDS_OK;
+    for (size_t i = 0; i < n; i++) {
+        pthread_join(host->workers[i].thread, NULL);
+        if (UDS_OK == err) {
+            err = host->workers[i].err;
+        }
+    }
+    HostClose(host);
+    return err;
+}
+
+UDSErr_t UDSHostStart(UDSHost_t *host) {
+    if (NULL == host) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    host->stopfd = eventfd(0, EFD_CLOEXEC);
+    if (host->stopfd < 0) {
+        UDS_LOGE(__FILE__, "eventfd failed: %d", errno);
+        return UDS_FAIL;
+    }
+    for (size_t i = 0; i < host->numWorkers; i++) {
+        if (UDS_OK != HostOpenWorker(host, &host->workers[i])) {
+            HostClose(host);
+            return UDS_FAIL;
+        }
+    }
+
+    for (size_t i = 0; i < host->numWorkers; i++) {
+        UDSHostWorker_t *w = &host->workers[i];
+        w->err = UDS_OK;
+        if (0 != pthread_create(&w->thread, NULL, HostWorkerMain, w)) {
+            UDS_LOGE(__FILE__, "pthread_create failed for worker %zu", i);
+            HostJoin(host, i);
+            return UDS_FAIL;
+        }
+        if (w->cpu >= 0 && w->cpu < CPU_SETSIZE) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(w->cpu, &set);
+            if (0 != pthread_setaffinity_np(w->thread, sizeof(set), &set)) {
+                UDS_LOGW(__FILE__, "cannot pin worker %zu to cpu %d", i, w->cpu);
+            }
+        }
+    }
+    return UDS_OK;
+}
+
+UDSErr_t UDSHostStop(UDSHost_t *host) {
+    if (NULL == host || host->stopfd < 0) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    return HostJoin(host, host->numWorkers);
+}
+
+#endif
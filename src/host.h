@@ -0,0 +1,78 @@
+#pragma once
+
+#include "sys.h"
+
+#if defined(UDS_TP_ISOTP_SOCK) && UDS_SYS == UDS_SYS_UNIX && defined(__linux__)
+
+#include "config.h"
+#include "uds.h"
+#include "server.h"
+#include "scheduler.h"
+#include "tp/isotp_sock.h"
+#include <pthread.h>
+
+/**
+ * @brief A server run by a UDSHost_t, with the isotp_sock transport it is polled through
+ */
+typedef struct {
+    UDSServer_t *srv;      /**< initialized server with `fn` set */
+    UDSTpIsoTpSock_t *tp;  /**< initialized transport. The host sets `srv->tp` to it */
+    UDSSchedEntry_t *entry; /**< entry in the scheduler of its worker */
+    uint32_t events[2];     /**< epoll events registered for the physical and functional socket */
+} UDSHostServer_t;
+
+typedef struct UDSHostWorker {
+    struct UDSHost *host;
+    UDSScheduler_t sched;
+    UDSHostServer_t *servers[UDS_SCHEDULER_MAX_ENTRIES]; /**< servers of this worker */
+    uint8_t count;                                       /**< number of servers */
+    int cpu;       /**< core the thread is pinned to, -1 to leave it unpinned */
+    int epfd;      /**< epoll instance of the sockets of this worker */
+    pthread_t thread;
+    UDSErr_t err;  /**< reason the worker stopped early */
+} UDSHostWorker_t;
+
+/**
+ * @brief Runs many servers on a fixed pool of threads, each server only when it has work
+ * @details Server `i` is assigned to worker `i % numWorkers`. Each worker thread waits in one
+ * `epoll_wait` on the sockets of its servers, bounded by the nearest deadline of its
+ * UDSScheduler_t, and polls only the servers whose socket is readable or whose timer is due, so
+ * idle servers cost nothing. A server is only ever polled from its own worker, so handlers need no
+ * locking unless they share state with servers of other workers.
+ */
+typedef struct UDSHost {
+    UDSHostServer_t *servers; /**< servers, assigned to workers in order */
+    size_t count;             /**< number of servers */
+    UDSHostWorker_t workers[UDS_HOST_MAX_WORKERS];
+    size_t numWorkers; /**< threads started by UDSHostStart */
+    int stopfd;        /**< eventfd that wakes every worker to stop */
+} UDSHost_t;
+
+/**
+ * @brief Initialize a host and assign servers to workers
+ * @details Worker `i` is pinned to core `i` unless `workers[i].cpu` is changed before
+ * UDSHostStart. The transports are switched to `poll_timeout_ms = 0` so that polling a server
+ * never blocks its worker.
+ * @param host
+ * @param servers servers with `srv` and `tp` set
+ * @param count number of servers
+ * @param numWorkers number of worker threads, 1 to UDS_HOST_MAX_WORKERS
+ * @return UDS_OK, UDS_ERR_INVALID_ARG, or UDS_ERR_BUFSIZ if a worker would hold more than
+ * UDS_SCHEDULER_MAX_ENTRIES servers
+ */
+UDSErr_t UDSHostInit(UDSHost_t *host, UDSHostServer_t *servers, size_t count, size_t numWorkers);
+
+/**
+ * @brief Start the worker threads
+ * @return UDS_OK, or UDS_FAIL if a descriptor or thread could not be created
+ */
+UDSErr_t UDSHostStart(UDSHost_t *host);
+
+/**
+ * @brief Stop the worker threads and wait for them to exit. Safe to call from any thread except
+ * the workers
+ * @return UDS_OK, or the error of the first worker that stopped early
+ */
+UDSErr_t UDSHostStop(UDSHost_t *host);
+
+#endif
@@ -15,10 +15,23 @@ void UDS_LogWrite(UDS_LogLevel_t level, const char *tag, const char *format, ...
 
 void UDS_LogSDUInternal(UDS_LogLevel_t level, const char *tag, const uint8_t *buffer,
                         size_t buff_len, UDSSDU_t *info) {
+    static const char hex[] = "0123456789abcdef";
+    // formatted here 32 bytes at a time, one UDS_LogWrite call per chunk instead of per byte
+    char line[32 * 3 + 2];
+    size_t n = 0;
     (void)info;
-    for (unsigned i = 0; i < buff_len; i++) {
-        UDS_LogWrite(level, tag, "%02x ", buffer[i]);
+    for (size_t i = 0; i < buff_len; i++) {
+        line[n++] = hex[buffer[i] >> 4];
+        line[n++] = hex[buffer[i] & 0xF];
+        line[n++] = ' ';
+        if (n == 32 * 3) {
+            line[n] = '\0';
+            UDS_LogWrite(level, tag, "%s", line);
+            n = 0;
+        }
     }
-    UDS_LogWrite(level, tag, "\n");
+    line[n++] = '\n';
+    line[n] = '\0';
+    UDS_LogWrite(level, tag, "%s", line);
 }
 #endif
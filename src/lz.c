@@ -0,0 +1,175 @@
+#include "lz.h"
+
+// decoder item states
+#define LZ_ITEM 0
+#define LZ_MATCH_LO 1
+
+// hash chain entries visited per match search
+#define LZ_MAX_CHAIN 32
+
+void UDSLZDecoderInit(UDSLZDecoder_t *dec) { memset(dec, 0, sizeof(*dec)); }
+
+UDSErr_t UDSLZDecode(UDSLZDecoder_t *dec, const uint8_t *in, size_t len, size_t *consumed) {
+    size_t i = 0;
+    while (dec->pos < UDS_LZ_WINDOW_SIZE) {
+        if (dec->matchLen > 0) {
+            uint16_t src = (uint16_t)(dec->pos - dec->matchDist) & (UDS_LZ_WINDOW_SIZE - 1);
+            dec->window[dec->pos++] = dec->window[src];
+            dec->total++;
+            dec->matchLen--;
+            continue;
+        }
+        if (i >= len) {
+            break;
+        }
+
+        uint8_t byte = in[i++];
+        if (LZ_MATCH_LO == dec->state) {
+            uint16_t dist = (uint16_t)((dec->matchHi << 4 | byte >> 4) + 1);
+            if (dist > UDS_LZ_WINDOW_SIZE || dist > dec->total) {
+                *consumed = i;
+                return UDS_FAIL;
+            }
+            dec->matchDist = dist;
+            dec->matchLen = (uint8_t)((byte & 0x0F) + UDS_LZ_MIN_MATCH);
+            dec->state = LZ_ITEM;
+        } else if (0 == dec->items) {
+            dec->flags = byte;
+            dec->items = 8;
+        } else {
+            bool isMatch = dec->flags & 1U;
+            dec->flags >>= 1;
+            dec->items--;
+            if (isMatch) {
+                dec->matchHi = byte;
+                dec->state = LZ_MATCH_LO;
+            } else {
+                dec->window[dec->pos++] = byte;
+                dec->total++;
+            }
+        }
+    }
+    *consumed = i;
+    return UDS_OK;
+}
+
+uint16_t UDSLZDecoderOutput(const UDSLZDecoder_t *dec, const uint8_t **data) {
+    *data = &dec->window[dec->out];
+    return (uint16_t)(dec->pos - dec->out);
+}
+
+void UDSLZDecoderRelease(UDSLZDecoder_t *dec) {
+    dec->out = dec->pos;
+    if (UDS_LZ_WINDOW_SIZE == dec->pos) {
+        dec->pos = 0;
+        dec->out = 0;
+    }
+}
+
+void UDSLZEncoderInit(UDSLZEncoder_t *enc) { memset(enc, 0, sizeof(*enc)); }
+
+static uint16_t LZHash(const uint8_t *p) {
+    uint32_t key = (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2];
+    return (uint16_t)((key * 2654435761U) >> (32 - UDS_LZ_HASH_BITS));
+}
+
+static void LZInsert(UDSLZEncoder_t *enc, uint16_t pos) {
+    if (pos + UDS_LZ_MIN_MATCH > enc->len) {
+        return;
+    }
+    uint16_t h = LZHash(&enc->buf[pos]);
+    enc->prev[pos] = enc->head[h];
+    enc->head[h] = (uint16_t)(pos + 1);
+}
+
+static uint8_t LZFindMatch(const UDSLZEncoder_t *enc, uint16_t *dist) {
+    size_t max = enc->len - enc->pos;
+    if (max > UDS_LZ_MAX_MATCH) {
+        max = UDS_LZ_MAX_MATCH;
+    }
+    if (max < UDS_LZ_MIN_MATCH) {
+        return 0;
+    }
+
+    const uint8_t *cur = &enc->buf[enc->pos];
+    size_t best = 0;
+    uint16_t cand = enc->head[LZHash(cur)];
+    for (int chain = 0; cand && chain < LZ_MAX_CHAIN; chain++) {
+        uint16_t c = (uint16_t)(cand - 1);
+        if ((uint16_t)(enc->pos - c) > UDS_LZ_WINDOW_SIZE) {
+            break;
+        }
+        size_t n = 0;
+        while (n < max && enc->buf[c + n] == cur[n]) {
+            n++;
+        }
+        if (n > best) {
+            best = n;
+            *dist = (uint16_t)(enc->pos - c);
+            if (best == max) {
+                break;
+            }
+        }
+        cand = enc->prev[c];
+    }
+    return best >= UDS_LZ_MIN_MATCH ? (uint8_t)best : 0;
+}
+
+/* drop the oldest UDS_LZ_WINDOW_SIZE bytes to make room for more input */
+static void LZSlide(UDSLZEncoder_t *enc) {
+    memmove(enc->buf, &enc->buf[UDS_LZ_WINDOW_SIZE], enc->len - UDS_LZ_WINDOW_SIZE);
+    enc->pos = (uint16_t)(enc->pos - UDS_LZ_WINDOW_SIZE);
+    enc->len = (uint16_t)(enc->len - UDS_LZ_WINDOW_SIZE);
+    for (size_t i = 0; i < UDS_LZ_HASH_SIZE; i++) {
+        uint16_t v = enc->head[i];
+        enc->head[i] = (uint16_t)(v > UDS_LZ_WINDOW_SIZE ? v - UDS_LZ_WINDOW_SIZE : 0);
+    }
+    for (size_t i = 0; i < UDS_LZ_WINDOW_SIZE; i++) {
+        uint16_t v = enc->prev[i + UDS_LZ_WINDOW_SIZE];
+        enc->prev[i] = (uint16_t)(v > UDS_LZ_WINDOW_SIZE ? v - UDS_LZ_WINDOW_SIZE : 0);
+    }
+}
+
+size_t UDSLZEncoderSpace(UDSLZEncoder_t *enc, uint8_t **dst) {
+    if (enc->pos >= UDS_LZ_WINDOW_SIZE) {
+        LZSlide(enc);
+    }
+    *dst = &enc->buf[enc->len];
+    return sizeof(enc->buf) - enc->len;
+}
+
+void UDSLZEncoderAdd(UDSLZEncoder_t *enc, size_t len) {
+    UDS_ASSERT(enc->len + len <= sizeof(enc->buf));
+    enc->len = (uint16_t)(enc->len + len);
+}
+
+size_t UDSLZEncode(UDSLZEncoder_t *enc, uint8_t *out, size_t size, bool final) {
+    size_t n = 0;
+    while (size - n >= UDS_LZ_MAX_GROUP_SIZE && enc->pos < enc->len) {
+        // a group other than the last must have all eight items
+        if (!final && enc->pos + 8U * UDS_LZ_MAX_MATCH > enc->len) {
+            break;
+        }
+        uint8_t *flags = &out[n++];
+        *flags = 0;
+        for (uint8_t bit = 0; bit < 8 && enc->pos < enc->len; bit++) {
+            uint16_t dist = 0;
+            uint8_t match = LZFindMatch(enc, &dist);
+            if (match) {
+                *flags |= (uint8_t)(1U << bit);
+                out[n++] = (uint8_t)((dist - 1) >> 4);
+                out[n++] = (uint8_t)(((dist - 1) & 0x0F) << 4 | (match - UDS_LZ_MIN_MATCH));
+            } else {
+                out[n++] = enc->buf[enc->pos];
+                match = 1;
+            }
+            for (uint8_t k = 0; k < match; k++) {
+                LZInsert(enc, enc->pos);
+                enc->pos++;
+            }
+        }
+    }
+    return n;
+}
+
+bool UDSLZEncoderIsEmpty(const UDSLZEncoder_t *enc) { return enc->pos >= enc->len; }
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "sys.h"
+#include "config.h"
+#include "uds.h"
+
+/**
+ * @brief Streaming LZ codec for compressed downloads
+ * @details LZSS with a byte-aligned format. The stream is a sequence of groups: one flag byte
+ * followed by up to eight items. Bit `i` of the flag byte (LSB first) tells whether item `i` is a
+ * literal byte (0) or a two byte match (1). A match copies `length` bytes from `distance` bytes
+ * back in the decoded output and is encoded as
+ *
+ *     byte 0: (distance - 1) >> 4
+ *     byte 1: ((distance - 1) & 0xF) << 4 | (length - UDS_LZ_MIN_MATCH)
+ *
+ * Only the last group of a stream may hold fewer than eight items. The encoder never refers back
+ * more than UDS_LZ_WINDOW_SIZE bytes, so a decoder needs no more than that much memory.
+ */
+
+#define UDS_LZ_WINDOW_SIZE (1U << UDS_LZ_WINDOW_BITS)
+#define UDS_LZ_MIN_MATCH 3U
+#define UDS_LZ_MAX_MATCH 18U
+
+/** most bytes one group can take in the compressed stream */
+#define UDS_LZ_MAX_GROUP_SIZE (1U + 8U * 2U)
+
+#define UDS_LZ_HASH_BITS 10
+#define UDS_LZ_HASH_SIZE (1U << UDS_LZ_HASH_BITS)
+
+/**
+ * @brief Streaming decoder. Decoded bytes are produced in `window` and must be taken with
+ * UDSLZDecoderOutput/UDSLZDecoderRelease before the window wraps.
+ */
+typedef struct {
+    uint8_t window[UDS_LZ_WINDOW_SIZE]; /**< the last UDS_LZ_WINDOW_SIZE decoded bytes */
+    uint16_t pos;                       /**< write position in window */
+    uint16_t out;                       /**< first decoded byte not yet released */
+    size_t total;                       /**< number of bytes decoded */
+    uint16_t matchDist;                 /**< distance of the match being copied */
+    uint8_t matchLen;                   /**< bytes of the match still to be copied */
+    uint8_t flags;                      /**< remaining flags of the current group */
+    uint8_t items;                      /**< items left in the current group */
+    uint8_t matchHi;                    /**< first byte of a match token */
+    uint8_t state;                      /**< position within the current item */
+} UDSLZDecoder_t;
+
+/**
+ * @brief Streaming encoder
+ * @details Input is added with UDSLZEncoderSpace/UDSLZEncoderAdd and kept in `buf` together with
+ * the window it is matched against. Matches are found through hash chains over 3 byte prefixes.
+ */
+typedef struct {
+    uint8_t buf[2 * UDS_LZ_WINDOW_SIZE];   /**< window followed by input not yet encoded */
+    uint16_t head[UDS_LZ_HASH_SIZE];       /**< latest position + 1 per hash, 0 if none */
+    uint16_t prev[2 * UDS_LZ_WINDOW_SIZE]; /**< previous position + 1 with the same hash */
+    uint16_t pos;                          /**< next byte of buf to encode */
+    uint16_t len;                          /**< number of bytes in buf */
+} UDSLZEncoder_t;
+
+void UDSLZDecoderInit(UDSLZDecoder_t *dec);
+
+/**
+ * @brief Decode compressed bytes until the input is used up or the window is full
+ * @param dec
+ * @param in compressed data
+ * @param len length of `in`
+ * @param consumed number of bytes of `in` that have been decoded
+ * @return UDS_OK, or UDS_FAIL if the stream refers to data outside the window
+ */
+UDSErr_t UDSLZDecode(UDSLZDecoder_t *dec, const uint8_t *in, size_t len, size_t *consumed);
+
+/**
+ * @brief Get the decoded bytes that have not been released yet
+ * @return number of bytes at `*data`
+ */
+uint16_t UDSLZDecoderOutput(const UDSLZDecoder_t *dec, const uint8_t **data);
+
+/**
+ * @brief Release the bytes returned by UDSLZDecoderOutput so that decoding can continue
+ */
+void UDSLZDecoderRelease(UDSLZDecoder_t *dec);
+
+void UDSLZEncoderInit(UDSLZEncoder_t *enc);
+
+/**
+ * @brief Get room for more input
+ * @param enc
+ * @param dst where to write the input
+ * @return number of bytes that can be written to `*dst`
+ */
+size_t UDSLZEncoderSpace(UDSLZEncoder_t *enc, uint8_t **dst);
+
+/**
+ * @brief Add `len` bytes written to the pointer returned by UDSLZEncoderSpace
+ */
+void UDSLZEncoderAdd(UDSLZEncoder_t *enc, size_t len);
+
+/**
+ * @brief Encode whole groups into `out`
+ * @param enc
+ * @param out destination
+ * @param size size of out
+ * @param final no more input follows. Encodes the remaining input, otherwise groups are only
+ * encoded while enough input is buffered to look for the longest matches
+ * @return number of bytes written. 0 if `size` < UDS_LZ_MAX_GROUP_SIZE or more input is needed
+ */
+size_t UDSLZEncode(UDSLZEncoder_t *enc, uint8_t *out, size_t size, bool final);
+
+/**
+ * @brief Check whether all input has been encoded
+ */
+bool UDSLZEncoderIsEmpty(const UDSLZEncoder_t *enc);
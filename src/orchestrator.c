@@ -0,0 +1,152 @@
+#include "orchestrator.h"
+#include "log.h"
+#include "util.h"
+
+UDSErr_t UDSOrchestratorInit(UDSOrchestrator_t *orch, UDSFlashJob_t *jobs, size_t count) {
+    if (NULL == orch || (count > 0 && NULL == jobs)) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (NULL == jobs[i].client) {
+            return UDS_ERR_INVALID_ARG;
+        }
+        jobs[i].state = UDS_DOWNLOAD_IDLE;
+        jobs[i].err = UDS_OK;
+        jobs[i].blocks = 0;
+    }
+    memset(orch, 0, sizeof(*orch));
+    orch->jobs = jobs;
+    orch->count = count;
+    return UDS_OK;
+}
+
+static void OrchestratorFinish(UDSOrchestrator_t *orch, UDSFlashJob_t *job,
+                               UDSDownloadState_t state, UDSErr_t err) {
+    job->state = state;
+    job->err = err;
+    orch->active--;
+    if (UDS_DOWNLOAD_DONE == state) {
+        orch->done++;
+    } else {
+        orch->failed++;
+        UDS_LOGW(__FILE__, "job %zu failed: %s (%d)", (size_t)(job - orch->jobs), UDSErrToStr(err),
+                 err);
+    }
+    if (orch->progress) {
+        orch->progress(orch, job);
+    }
+}
+
+static void OrchestratorStartJobs(UDSOrchestrator_t *orch) {
+    while (orch->next < orch->count && (0 == orch->maxActive || orch->active < orch->maxActive)) {
+        UDSFlashJob_t *job = &orch->jobs[orch->next++];
+        orch->active++;
+        job->state = UDS_DOWNLOAD_REQUEST_DOWNLOAD;
+        UDSErr_t err = UDSStartDownload(job->client, job->dataFormatIdentifier,
+                                        job->addressAndLengthFormatIdentifier, job->memoryAddress,
+                                        &job->src);
+        if (UDS_OK != err) {
+            OrchestratorFinish(orch, job, UDS_DOWNLOAD_FAILED, err);
+        }
+    }
+}
+
+void UDSOrchestratorPoll(UDSOrchestrator_t *orch) {
+    if (NULL == orch) {
+        return;
+    }
+    OrchestratorStartJobs(orch);
+
+    for (size_t i = 0; i < orch->next; i++) {
+        UDSFlashJob_t *job = &orch->jobs[i];
+        if (UDS_DOWNLOAD_DONE == job->state || UDS_DOWNLOAD_FAILED == job->state) {
+            continue;
+        }
+        UDSClientPoll(job->client);
+
+        const UDSDownload_t *dl = &job->client->download;
+        if (UDS_DOWNLOAD_DONE == dl->state || UDS_DOWNLOAD_FAILED == dl->state) {
+            OrchestratorFinish(orch, job, dl->state, dl->err);
+            continue;
+        }
+        job->state = dl->state;
+        if (dl->stats.blocks != job->blocks) {
+            job->blocks = dl->stats.blocks;
+            if (orch->progress) {
+                orch->progress(orch, job);
+            }
+        }
+    }
+
+    // a finished job frees its slot for the next one
+    OrchestratorStartJobs(orch);
+}
+
+bool UDSOrchestratorIsDone(const UDSOrchestrator_t *orch) {
+    return NULL == orch || (orch->next >= orch->count && 0 == orch->active);
+}
+
+uint32_t UDSOrchestratorNextDeadlineMs(const UDSOrchestrator_t *orch) {
+    uint32_t ms = UDS_NO_DEADLINE;
+    if (NULL == orch) {
+        return ms;
+    }
+    for (size_t i = 0; i < orch->next; i++) {
+        const UDSFlashJob_t *job = &orch->jobs[i];
+        if (UDS_DOWNLOAD_DONE == job->state || UDS_DOWNLOAD_FAILED == job->state) {
+            continue;
+        }
+        uint32_t job_ms = job->fd < 0 ? 1 : UDSClientNextDeadlineMs(job->client);
+        if (job_ms < ms) {
+            ms = job_ms;
+        }
+    }
+    return ms;
+}
+
+#if UDS_SYS == UDS_SYS_UNIX && defined(__linux__)
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <errno.h>
+
+UDSErr_t UDSOrchestratorRun(UDSOrchestrator_t *orch) {
+    if (NULL == orch) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        UDS_LOGE(__FILE__, "epoll_create1 failed: %d", errno);
+        return UDS_FAIL;
+    }
+    for (size_t i = 0; i < orch->count; i++) {
+        const UDSFlashJob_t *job = &orch->jobs[i];
+        if (job->fd < 0) {
+            continue;
+        }
+        // several jobs may share a descriptor
+        struct epoll_event ev = {.events = EPOLLIN, .data.fd = job->fd};
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, job->fd, &ev) < 0 && EEXIST != errno) {
+            UDS_LOGE(__FILE__, "epoll_ctl failed for job %zu: %d", i, errno);
+            close(epfd);
+            return UDS_ERR_INVALID_ARG;
+        }
+    }
+
+    UDSOrchestratorPoll(orch);
+    while (!UDSOrchestratorIsDone(orch)) {
+        struct epoll_event events[16];
+        uint32_t ms = UDSOrchestratorNextDeadlineMs(orch);
+        int timeout = UDS_NO_DEADLINE == ms ? -1 : (ms > INT32_MAX ? INT32_MAX : (int)ms);
+        if (epoll_wait(epfd, events, sizeof(events) / sizeof(events[0]), timeout) < 0 &&
+            EINTR != errno) {
+            UDS_LOGE(__FILE__, "epoll_wait failed: %d", errno);
+            close(epfd);
+            return UDS_FAIL;
+        }
+        // clients are cheap to poll, so every running job is polled on each wakeup
+        UDSOrchestratorPoll(orch);
+    }
+    close(epfd);
+    return orch->failed ? UDS_FAIL : UDS_OK;
+}
+#endif
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "sys.h"
+#include "config.h"
+#include "uds.h"
+#include "client.h"
+
+/**
+ * @brief One ECU download driven by a UDSOrchestrator_t
+ * @details The client must be initialized with its own transport and `fn` before the orchestrator
+ * starts the job. The download parameters are passed to UDSStartDownload.
+ */
+typedef struct UDSFlashJob {
+    UDSClient_t *client; /**< client of the ECU, with `tp` and `fn` set */
+    int fd;              /**< descriptor that becomes readable when the client's transport has
+                            received a frame, or -1 to poll the job every millisecond */
+    uint8_t dataFormatIdentifier;             /**< see UDSStartDownload */
+    uint8_t addressAndLengthFormatIdentifier; /**< see UDSStartDownload */
+    size_t memoryAddress;                     /**< see UDSStartDownload */
+    UDSDownloadSource_t src;                  /**< see UDSStartDownload */
+    void *ctx;                                /**< user data */
+
+    UDSDownloadState_t state; /**< UDS_DOWNLOAD_IDLE until the job is started */
+    UDSErr_t err;             /**< reason for UDS_DOWNLOAD_FAILED */
+    uint32_t blocks;          /**< blocks acknowledged at the last progress report */
+} UDSFlashJob_t;
+
+/**
+ * @brief Runs several downloads at the same time, one client per ECU
+ * @details Each client is an independent state machine, so while one ECU is busy (P2 waits, 0x78
+ * during flash erase) the others keep the bus busy with their TransferData requests.
+ */
+typedef struct UDSOrchestrator {
+    UDSFlashJob_t *jobs; /**< jobs, started in order */
+    size_t count;        /**< number of jobs */
+    size_t maxActive;    /**< most jobs downloading at once, 0 for no limit */
+
+    /**
+     * @brief Called after every acknowledged block of a job and once when it is done or failed.
+     * Progress is in `job->client->download.stats`. Optional.
+     */
+    void (*progress)(struct UDSOrchestrator *orch, UDSFlashJob_t *job);
+    void *fn_data; /**< user data */
+
+    size_t next;   /**< index of the next job to start */
+    size_t active; /**< jobs downloading */
+    size_t done;   /**< jobs that completed */
+    size_t failed; /**< jobs that failed */
+} UDSOrchestrator_t;
+
+/**
+ * @brief Initialize an orchestrator
+ * @param orch
+ * @param jobs jobs with their clients and download parameters set
+ * @param count number of jobs
+ * @return UDS_OK, or UDS_ERR_INVALID_ARG
+ */
+UDSErr_t UDSOrchestratorInit(UDSOrchestrator_t *orch, UDSFlashJob_t *jobs, size_t count);
+
+/**
+ * @brief Start jobs as slots become free and poll the clients of running jobs
+ * @details Call periodically, or use UDSOrchestratorRun
+ */
+void UDSOrchestratorPoll(UDSOrchestrator_t *orch);
+
+/**
+ * @brief Whether every job is done or failed
+ */
+bool UDSOrchestratorIsDone(const UDSOrchestrator_t *orch);
+
+/**
+ * @brief Milliseconds until a running job needs to be polled even if none of the job descriptors
+ * became readable, or UDS_NO_DEADLINE
+ */
+uint32_t UDSOrchestratorNextDeadlineMs(const UDSOrchestrator_t *orch);
+
+#if UDS_SYS == UDS_SYS_UNIX && defined(__linux__)
+/**
+ * @brief Run every job to completion in one epoll loop
+ * @details Sleeps until a job descriptor becomes readable or the next client deadline expires.
+ * @return UDS_OK if every job completed, UDS_FAIL if any job failed, or UDS_ERR_INVALID_ARG
+ */
+UDSErr_t UDSOrchestratorRun(UDSOrchestrator_t *orch);
+#endif
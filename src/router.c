@@ -0,0 +1,260 @@
+#include "router.h"
+#include "log.h"
+#include "util.h"
+
+UDSErr_t UDSRouterInit(UDSRouter_t *router, UDSRoute_t *routes, size_t count) {
+    if (NULL == router || (count > 0 && NULL == routes)) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (NULL == routes[i].up || NULL == routes[i].down || routes[i].up == routes[i].down) {
+            return UDS_ERR_INVALID_ARG;
+        }
+        for (size_t j = 0; j < i; j++) {
+            if (routes[j].down == routes[i].down) {
+                return UDS_ERR_INVALID_ARG;
+            }
+        }
+        routes[i].tester = UDS_TP_NOOP_ADDR;
+        routes[i].pending = false;
+        routes[i].timer = 0;
+        routes[i].rcrrp = 0;
+        routes[i].reqHeld = false;
+        routes[i].respHeld = false;
+    }
+    memset(router, 0, sizeof(*router));
+    router->routes = routes;
+    router->count = count;
+    router->p2_ms = UDS_CLIENT_DEFAULT_P2_MS;
+    router->p2_star_ms = UDS_CLIENT_DEFAULT_P2_STAR_MS;
+    return UDS_OK;
+}
+
+static UDSRoute_t *RouterFind(UDSRouter_t *router, const UDSTp_t *up, uint32_t ta) {
+    for (size_t i = 0; i < router->count; i++) {
+        UDSRoute_t *r = &router->routes[i];
+        if (r->up == up && r->ta == ta) {
+            return r;
+        }
+    }
+    return NULL;
+}
+
+#if UDS_TP_SEND_IN_PLACE
+/*
+ * The transport a message was sent on in place reads it from the buffer of `src` until it no
+ * longer reports UDS_TP_SEND_IN_PROGRESS, so the message is only released on a later poll
+ */
+static void RouterHold(UDSRouter_t *router, const UDSTp_t *src, bool *held) {
+    *held = true;
+    if (NULL == src->peek) {
+        router->scratchHeld = true;
+    }
+}
+#endif
+
+static void RouterRelease(UDSRouter_t *router, UDSTp_t *src, bool *held, UDSTpStatus_t status) {
+    if (*held && !(status & UDS_TP_SEND_IN_PROGRESS)) {
+        *held = false;
+        if (NULL == src->peek) {
+            router->scratchHeld = false;
+        }
+        UDSTpAck(src);
+    }
+}
+
+/*
+ * Forward a request received on `up`. Returns false if the request must not be released yet: the
+ * downstream transport is busy, or sends it in place.
+ */
+static bool RouterRequest(UDSRouter_t *router, UDSTp_t *up, const uint8_t *buf, size_t len,
+                          const UDSSDU_t *info) {
+    if (UDS_A_TA_TYPE_FUNCTIONAL == info->A_TA_Type) {
+        // every ECU may answer, so a request that cannot be sent on one bus is not retried on all.
+        // Functional requests are single frames, sent before UDSTpSend() returns.
+        for (size_t i = 0; i < router->count; i++) {
+            UDSRoute_t *r = &router->routes[i];
+            if (r->up != up) {
+                continue; // the ECUs of other upstream links belong to their own testers
+            }
+            r->tester = info->A_SA;
+            if (!r->functional) {
+                continue;
+            }
+            UDSSDU_t down_info = {.A_Mtype = info->A_Mtype,
+                                  .A_TA_Type = UDS_A_TA_TYPE_FUNCTIONAL,
+                                  .A_AE = info->A_AE};
+            if (UDSTpSend(r->down, buf, (ssize_t)len, &down_info) > 0) {
+                router->requests++;
+            } else {
+                router->dropped++;
+            }
+        }
+        return true;
+    }
+
+    UDSRoute_t *r = RouterFind(router, up, info->A_TA);
+    if (NULL == r) {
+        UDS_LOGW(__FILE__, "no route to 0x%03" PRIX32 " for request from 0x%03" PRIX32,
+                 info->A_TA, info->A_SA);
+        router->unrouted++;
+        return true;
+    }
+    UDSSDU_t down_info = {.A_Mtype = info->A_Mtype,
+                          .A_TA = r->downTA,
+                          .A_TA_Type = UDS_A_TA_TYPE_PHYSICAL,
+                          .A_AE = info->A_AE};
+    ssize_t ret = UDSTpSend(r->down, buf, (ssize_t)len, &down_info);
+    if (0 == ret) {
+        if (buf == router->scratch) {
+            // `up` has no peek and already let go of the request: keep it until `down` is free
+            router->scratchHeld = true;
+            router->retryUp = up;
+            router->retryLen = len;
+            router->retryInfo = *info;
+        }
+        return false;
+    }
+    if (ret <= 0) {
+        UDS_LOGW(__FILE__, "request to 0x%03" PRIX32 " dropped: %zd", r->ta, ret);
+        router->dropped++;
+        return true;
+    }
+    r->tester = info->A_SA;
+    r->pending = true;
+    r->timer = UDSMillis() + router->p2_ms;
+    router->requests++;
+#if UDS_TP_SEND_IN_PLACE
+    RouterHold(router, up, &r->reqHeld);
+    return false;
+#else
+    return true;
+#endif
+}
+
+static void RouterPollUp(UDSRouter_t *router, UDSTp_t *up) {
+    UDSTpStatus_t status = UDSTpPoll(up);
+    if (router->retryUp == up) {
+        router->scratchHeld = false;
+        router->retryUp = NULL;
+        RouterRequest(router, up, router->scratch, router->retryLen, &router->retryInfo);
+    }
+    bool held = NULL == up->peek && router->scratchHeld;
+    for (size_t i = 0; i < router->count; i++) {
+        UDSRoute_t *r = &router->routes[i];
+        if (r->up == up) {
+            RouterRelease(router, r->down, &r->respHeld, status);
+            held = held || r->reqHeld;
+        }
+    }
+    while (!held) {
+        const uint8_t *buf = NULL;
+        UDSSDU_t info = {0};
+        ssize_t len = UDSTpPeek(up, router->scratch, sizeof(router->scratch), &buf, &info);
+        if (len <= 0 || !RouterRequest(router, up, buf, (size_t)len, &info)) {
+            return;
+        }
+        UDSTpAck(up);
+    }
+}
+
+static void RouterPollDown(UDSRouter_t *router, UDSRoute_t *r) {
+    RouterRelease(router, r->up, &r->reqHeld, UDSTpPoll(r->down));
+    while (!r->respHeld && !(NULL == r->down->peek && router->scratchHeld)) {
+        const uint8_t *buf = NULL;
+        UDSSDU_t info = {0};
+        ssize_t len = UDSTpPeek(r->down, router->scratch, sizeof(router->scratch), &buf, &info);
+        if (len <= 0) {
+            break;
+        }
+        if (UDS_TP_NOOP_ADDR == r->tester) {
+            UDS_LOGW(__FILE__, "0x%03" PRIX32 " sent %zd bytes before any request", r->ta, len);
+            UDSTpAck(r->down);
+            router->dropped++;
+            continue;
+        }
+        UDSSDU_t up_info = {.A_Mtype = info.A_Mtype,
+                            .A_SA = r->ta,
+                            .A_TA = r->tester,
+                            .A_TA_Type = UDS_A_TA_TYPE_PHYSICAL,
+                            .A_AE = info.A_AE};
+        ssize_t ret = UDSTpSend(r->up, buf, len, &up_info);
+        if (0 == ret && buf != router->scratch) {
+            break;
+        }
+        if (ret <= 0) {
+            UDS_LOGW(__FILE__, "response from 0x%03" PRIX32 " dropped: %zd", r->ta, ret);
+            UDSTpAck(r->down);
+            router->dropped++;
+            continue;
+        }
+        router->responses++;
+        if (UDS_NEG_RESP_LEN == len && 0x7F == buf[0] &&
+            UDS_NRC_RequestCorrectlyReceived_ResponsePending == buf[2]) {
+            // the tester waits for P2* now and so does the route
+            r->rcrrp++;
+            r->timer = UDSMillis() + router->p2_star_ms;
+        } else {
+            r->pending = false;
+        }
+#if UDS_TP_SEND_IN_PLACE
+        RouterHold(router, r->down, &r->respHeld);
+#else
+        UDSTpAck(r->down);
+#endif
+    }
+
+    if (r->pending && UDSTimeAfter(UDSMillis(), r->timer)) {
+        UDS_LOGI(__FILE__, "no response from 0x%03" PRIX32, r->ta);
+        r->pending = false;
+        router->timeouts++;
+    }
+}
+
+void UDSRouterPoll(UDSRouter_t *router) {
+    if (NULL == router) {
+        return;
+    }
+    for (size_t i = 0; i < router->count; i++) {
+        UDSTp_t *up = router->routes[i].up;
+        size_t j = 0;
+        while (j < i && router->routes[j].up != up) {
+            j++;
+        }
+        if (j == i) { // first route of this transport
+            RouterPollUp(router, up);
+        }
+    }
+    for (size_t i = 0; i < router->count; i++) {
+        RouterPollDown(router, &router->routes[i]);
+    }
+}
+
+bool UDSRouterAcceptTA(void *router, uint32_t ta) {
+    const UDSRouter_t *rt = router;
+    if (NULL == rt) {
+        return false;
+    }
+    for (size_t i = 0; i < rt->count; i++) {
+        if (rt->routes[i].ta == ta) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t UDSRouterNextDeadlineMs(const UDSRouter_t *router) {
+    uint32_t ms = UDS_NO_DEADLINE;
+    if (NULL == router) {
+        return ms;
+    }
+    uint32_t now = UDSMillis();
+    for (size_t i = 0; i < router->count; i++) {
+        const UDSRoute_t *r = &router->routes[i];
+        if (r->pending) {
+            uint32_t route_ms = UDSMillisUntil(now, r->timer);
+            ms = route_ms < ms ? route_ms : ms;
+        }
+    }
+    return ms;
+}
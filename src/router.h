@@ -0,0 +1,83 @@
+#pragma once
+
+#include "sys.h"
+#include "config.h"
+#include "uds.h"
+#include "tp.h"
+
+/**
+ * @brief An ECU reached through a UDSRouter_t
+ * @details Requests that arrive on `up` with A_TA == `ta` are sent on `down`, and whatever the ECU
+ * sends on `down` is sent back on `up` from `ta` to the tester of the last request. Each route
+ * needs its own `down`, e.g. one ISO-TP link per ECU.
+ */
+typedef struct UDSRoute {
+    UDSTp_t *up;     /**< transport the tester's requests arrive on */
+    uint32_t ta;     /**< address of the ECU on `up` */
+    UDSTp_t *down;   /**< transport the ECU is reached through */
+    uint32_t downTA; /**< A_TA of requests sent on `down`, 0 for the default peer of `down` */
+    bool functional; /**< send functional requests that arrive on `up` on `down`. Set it on one
+                        route per bus, since every ECU on a bus receives them */
+
+    uint32_t tester; /**< address of the tester responses are sent to, UDS_TP_NOOP_ADDR if none */
+    bool pending;    /**< a physical request was forwarded and its final response not yet seen */
+    uint32_t timer;  /**< P2 or P2* deadline of the pending request */
+    uint32_t rcrrp;  /**< 0x78 responses passed through */
+    bool reqHeld;    /**< `down` sends the request lent by `up` in place (UDS_TP_SEND_IN_PLACE) */
+    bool respHeld;   /**< `up` sends the response lent by `down` in place */
+} UDSRoute_t;
+
+/**
+ * @brief Forwards diagnostic messages between a tester-facing transport and the ECUs behind it
+ * @details A gateway polls the router instead of bridging a server to a client. Messages are sent
+ * on from the buffer the receiving transport lends through UDSTpPeek() and only acknowledged once
+ * the other transport accepted them, so nothing is copied on the way. Every route has its own
+ * pending request, so requests to different ECUs are in flight at the same time. Negative
+ * responses with NRC 0x78 are passed through and extend the deadline of the request to P2*.
+ * With UDS_TP_SEND_IN_PLACE a message is released only once the other transport finished sending it.
+ */
+typedef struct UDSRouter {
+    UDSRoute_t *routes;  /**< routes, matched in order */
+    size_t count;        /**< number of routes */
+    uint32_t p2_ms;      /**< time a pending request waits for its first response */
+    uint32_t p2_star_ms; /**< time a pending request waits after a 0x78 */
+
+    uint32_t requests;  /**< requests forwarded to an ECU */
+    uint32_t responses; /**< messages forwarded to a tester */
+    uint32_t unrouted;  /**< requests for an address without route */
+    uint32_t dropped;   /**< messages lost because the other transport was busy */
+    uint32_t timeouts;  /**< pending requests without final response, including suppressed ones */
+
+    uint8_t scratch[UDS_TP_MTU]; /**< receive buffer for transports without peek */
+    bool scratchHeld;            /**< `scratch` is being sent in place or waits to be sent */
+    UDSTp_t *retryUp;            /**< transport of a request in `scratch` that `down` was busy for */
+    size_t retryLen;             /**< length of that request */
+    UDSSDU_t retryInfo;          /**< addressing of that request */
+} UDSRouter_t;
+
+/**
+ * @brief Initialize a router
+ * @param router
+ * @param routes routes with `up`, `ta` and `down` set
+ * @param count number of routes
+ * @return UDS_OK, or UDS_ERR_INVALID_ARG
+ */
+UDSErr_t UDSRouterInit(UDSRouter_t *router, UDSRoute_t *routes, size_t count);
+
+/**
+ * @brief Poll the transports of all routes and forward what they received
+ * @details Call periodically. The router polls the transports itself.
+ */
+void UDSRouterPoll(UDSRouter_t *router);
+
+/**
+ * @brief Whether `ta` is the address of a route
+ * @details Matches the `accept_ta` hook of transports that check target addresses, e.g. the DoIP
+ * entity of the gateway.
+ */
+bool UDSRouterAcceptTA(void *router, uint32_t ta);
+
+/**
+ * @brief Milliseconds until the nearest P2/P2* deadline of a pending request, or UDS_NO_DEADLINE
+ */
+uint32_t UDSRouterNextDeadlineMs(const UDSRouter_t *router);
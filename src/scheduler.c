@@ -0,0 +1,171 @@
+#include "scheduler.h"
+#include "util.h"
+
+/* idle entries sort after every entry with a deadline */
+static bool EntryBefore(const UDSSchedEntry_t *a, const UDSSchedEntry_t *b) {
+    return !a->idle && (b->idle || UDSTimeAfter(b->due, a->due));
+}
+
+static UDSSchedEntry_t *HeapAt(UDSScheduler_t *sched, uint8_t pos) {
+    return &sched->entries[sched->heap[pos]];
+}
+
+static void HeapSwap(UDSScheduler_t *sched, uint8_t a, uint8_t b) {
+    uint8_t tmp = sched->heap[a];
+    sched->heap[a] = sched->heap[b];
+    sched->heap[b] = tmp;
+    HeapAt(sched, a)->pos = a;
+    HeapAt(sched, b)->pos = b;
+}
+
+static void SiftUp(UDSScheduler_t *sched, uint8_t pos) {
+    while (pos > 0) {
+        uint8_t parent = (uint8_t)((pos - 1) / 2);
+        if (!EntryBefore(HeapAt(sched, pos), HeapAt(sched, parent))) {
+            break;
+        }
+        HeapSwap(sched, pos, parent);
+        pos = parent;
+    }
+}
+
+static void SiftDown(UDSScheduler_t *sched, uint8_t pos) {
+    for (;;) {
+        size_t first = pos;
+        size_t left = 2U * pos + 1U;
+        size_t right = left + 1U;
+        if (left < sched->queued &&
+            EntryBefore(HeapAt(sched, (uint8_t)left), HeapAt(sched, (uint8_t)first))) {
+            first = left;
+        }
+        if (right < sched->queued &&
+            EntryBefore(HeapAt(sched, (uint8_t)right), HeapAt(sched, (uint8_t)first))) {
+            first = right;
+        }
+        if (first == pos) {
+            return;
+        }
+        HeapSwap(sched, pos, (uint8_t)first);
+        pos = (uint8_t)first;
+    }
+}
+
+static UDSSchedEntry_t *SchedulerAdd(UDSScheduler_t *sched, UDSSchedKind_t kind, void *instance) {
+    if (NULL == sched || NULL == instance || sched->count >= UDS_SCHEDULER_MAX_ENTRIES ||
+        sched->queued != sched->count) {
+        return NULL;
+    }
+    uint8_t idx = sched->count++;
+    UDSSchedEntry_t *entry = &sched->entries[idx];
+    *entry = (UDSSchedEntry_t){
+        .kind = kind,
+        .instance = instance,
+        .due = sched->now,
+        .pos = sched->queued,
+    };
+    sched->heap[sched->queued++] = idx;
+    SiftUp(sched, entry->pos);
+    return entry;
+}
+
+/**
+ * @brief Poll one instance and compute when it is due next
+ */
+static void SchedulerPollEntry(UDSSchedEntry_t *entry, uint32_t now) {
+    uint32_t ms = UDS_NO_DEADLINE;
+    if (UDS_SCHED_SERVER == entry->kind) {
+        UDSServer_t *srv = entry->instance;
+        UDSServerPollAt(srv, now);
+        ms = UDSServerNextDeadlineMsAt(srv, now);
+    } else {
+        UDSClient_t *client = entry->instance;
+        UDSClientPollAt(client, now);
+        ms = UDSClientNextDeadlineMsAt(client, now);
+    }
+    entry->idle = UDS_NO_DEADLINE == ms;
+    // further away than UDSTimeAfter can compare: poll early rather than never
+    entry->due = now + (ms < INT32_MAX ? ms : INT32_MAX);
+}
+
+UDSErr_t UDSSchedulerInit(UDSScheduler_t *sched) {
+    if (NULL == sched) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    memset(sched, 0, sizeof(*sched));
+    sched->now = UDSMillis();
+    return UDS_OK;
+}
+
+UDSSchedEntry_t *UDSSchedulerAddServer(UDSScheduler_t *sched, UDSServer_t *srv) {
+    return SchedulerAdd(sched, UDS_SCHED_SERVER, srv);
+}
+
+UDSSchedEntry_t *UDSSchedulerAddClient(UDSScheduler_t *sched, UDSClient_t *client) {
+    return SchedulerAdd(sched, UDS_SCHED_CLIENT, client);
+}
+
+void UDSSchedulerWake(UDSScheduler_t *sched, UDSSchedEntry_t *entry) {
+    if (NULL == sched || NULL == entry) {
+        return;
+    }
+    if (!entry->idle && !UDSTimeAfter(entry->due, sched->now)) {
+        return; // already due
+    }
+    entry->idle = false;
+    entry->due = sched->now;
+    // an entry being polled is put back into the heap by UDSSchedulerPoll
+    if (entry->pos < sched->queued) {
+        SiftUp(sched, entry->pos);
+    }
+}
+
+void UDSSchedulerDefer(UDSScheduler_t *sched, UDSSchedEntry_t *entry, uint32_t ms) {
+    if (NULL == sched || NULL == entry) {
+        return;
+    }
+    entry->idle = false;
+    entry->due = sched->now + (ms < INT32_MAX ? ms : INT32_MAX);
+    if (entry->pos < sched->queued) {
+        SiftUp(sched, entry->pos);
+        SiftDown(sched, entry->pos);
+    }
+}
+
+void UDSSchedulerPoll(UDSScheduler_t *sched) {
+    if (NULL == sched) {
+        return;
+    }
+    uint32_t now = UDSMillis();
+    sched->now = now;
+
+    // move the due entries behind the heap, so that each is polled once per call even if it is
+    // due again right away
+    while (sched->queued > 0) {
+        UDSSchedEntry_t *top = HeapAt(sched, 0);
+        if (top->idle || UDSTimeAfter(top->due, now)) {
+            break;
+        }
+        sched->queued--;
+        HeapSwap(sched, 0, sched->queued);
+        SiftDown(sched, 0);
+    }
+
+    for (uint8_t pos = sched->queued; pos < sched->count; pos++) {
+        SchedulerPollEntry(HeapAt(sched, pos), now);
+    }
+    while (sched->queued < sched->count) {
+        SiftUp(sched, sched->queued++);
+    }
+}
+
+uint32_t UDSSchedulerNextDeadlineMs(const UDSScheduler_t *sched) {
+    if (NULL == sched || 0 == sched->queued) {
+        return UDS_NO_DEADLINE;
+    }
+    const UDSSchedEntry_t *top = &sched->entries[sched->heap[0]];
+    if (top->idle) {
+        return UDS_NO_DEADLINE;
+    }
+    uint32_t now = UDSMillis();
+    return UDSTimeAfter(top->due, now) ? top->due - now : 0;
+}
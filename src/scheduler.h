@@ -0,0 +1,81 @@
+#pragma once
+
+#include "sys.h"
+#include "config.h"
+#include "uds.h"
+#include "client.h"
+#include "server.h"
+
+typedef enum {
+    UDS_SCHED_SERVER = 0,
+    UDS_SCHED_CLIENT,
+} UDSSchedKind_t;
+
+/**
+ * @brief A server or client held by a UDSScheduler_t
+ */
+typedef struct {
+    UDSSchedKind_t kind;
+    void *instance; /**< UDSServer_t or UDSClient_t */
+    uint32_t due;   /**< UDSMillis() at which the instance is polled next */
+    bool idle;      /**< no deadline: polled only once woken */
+    uint8_t pos;    /**< index in UDSScheduler_t.heap */
+} UDSSchedEntry_t;
+
+/**
+ * @brief Polls many servers and clients, each only once its next timer is due
+ * @details The instances are kept in a min-heap ordered by the time of their next deadline
+ * (UDSServerNextDeadlineMs, UDSClientNextDeadlineMs). Each UDSSchedulerPoll reads the clock once,
+ * polls the instances that are due with that time and puts them back with their new deadline, so
+ * a pass over instances that have nothing to do costs one comparison.
+ *
+ * Incoming data is not a timer: call UDSSchedulerWake for an instance whose transport has received
+ * something (its socket became readable, UDSISOTpCOnFrame was called for it, ...), otherwise an
+ * idle server only notices the request at its next deadline, which may be never.
+ */
+typedef struct {
+    UDSSchedEntry_t entries[UDS_SCHEDULER_MAX_ENTRIES];
+    uint8_t heap[UDS_SCHEDULER_MAX_ENTRIES]; /**< indices into entries, earliest due first */
+    uint8_t count;                           /**< number of entries */
+    uint8_t queued; /**< entries in the heap. The others are being polled */
+    uint32_t now;   /**< UDSMillis() at the start of the last UDSSchedulerPoll */
+} UDSScheduler_t;
+
+UDSErr_t UDSSchedulerInit(UDSScheduler_t *sched);
+
+/**
+ * @brief Add a server. It is polled on the next UDSSchedulerPoll
+ * @details Not from the event callbacks of polled instances
+ * @return the entry to pass to UDSSchedulerWake, or NULL if the scheduler is full
+ */
+UDSSchedEntry_t *UDSSchedulerAddServer(UDSScheduler_t *sched, UDSServer_t *srv);
+
+/**
+ * @brief Add a client. It is polled on the next UDSSchedulerPoll
+ * @return the entry to pass to UDSSchedulerWake, or NULL if the scheduler is full
+ */
+UDSSchedEntry_t *UDSSchedulerAddClient(UDSScheduler_t *sched, UDSClient_t *client);
+
+/**
+ * @brief Poll `entry` on the next UDSSchedulerPoll regardless of its deadline
+ * @details May be called from the event callbacks of polled instances, but not from an interrupt.
+ */
+void UDSSchedulerWake(UDSScheduler_t *sched, UDSSchedEntry_t *entry);
+
+/**
+ * @brief Poll `entry` `ms` after the last UDSSchedulerPoll instead of at the deadline it returned
+ * @details For hosts that know better than the instance, for example that a transport which
+ * reports a send in progress (deadline 0) will wake the host once the send is complete.
+ */
+void UDSSchedulerDefer(UDSScheduler_t *sched, UDSSchedEntry_t *entry, uint32_t ms);
+
+/**
+ * @brief Read UDSMillis() once and poll every instance whose deadline has passed or that was woken
+ */
+void UDSSchedulerPoll(UDSScheduler_t *sched);
+
+/**
+ * @brief Milliseconds until the earliest deadline of all instances, 0 if one is due, or
+ * UDS_NO_DEADLINE if the scheduler is empty
+ */
+uint32_t UDSSchedulerNextDeadlineMs(const UDSScheduler_t *sched);
@@ -3,6 +3,7 @@
 #include "uds.h"
 #include "util.h"
 #include "log.h"
+#include <stddef.h>
 #include <stdint.h>
 
 static inline UDSErr_t NegativeResponse(UDSReq_t *r, UDSErr_t nrc) {
@@ -20,10 +21,144 @@ static inline UDSErr_t NegativeResponse(UDSReq_t *r, UDSErr_t nrc) {
 
 static inline void NoResponse(UDSReq_t *r) { r->send_len = 0; }
 
+// Deferred response states (UDSReq_t.pendingState)
+#define PENDING_NONE 0
+#define PENDING_WAIT 1    // waiting for UDSServerCompleteResponse
+#define PENDING_DONE 2    // completed, not yet delivered to the service handler
+#define PENDING_DELIVER 3 // the service handler is being re-evaluated with the result
+
+/*
+ * UDSServerCompleteResponse may run on another thread or in an interrupt. It publishes
+ * pendingState with release after the result, and the server reads pendingState with acquire
+ * before the result, so the result is complete once PENDING_DONE is seen.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define PENDING_LOAD(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define PENDING_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#else
+/* single core: volatile accesses are not reordered against each other by the compiler */
+#define PENDING_LOAD(p) (*(p))
+#define PENDING_STORE(p, v) (*(p) = (v))
+#endif
+
+#if UDS_SERVER_SHARED_BUF
+// requests are received into send_buf and moved to its end, in front of which the response is built
+#define REQ_STORAGE(r) ((r)->send_buf)
+#define REQ_MAX_LEN (UDS_SERVER_SEND_BUF_SIZE - UDS_SERVER_SHARED_BUF_MIN_RESP_LEN)
+#else
+#define REQ_STORAGE(r) ((r)->recv_storage)
+#define REQ_MAX_LEN (UDS_SERVER_RECV_BUF_SIZE)
+#endif
+
+#if UDS_SERVER_SHARED_BUF || UDS_SERVER_MAX_TESTERS > 1 || UDS_SERVER_ENABLE_0x86 ||              \
+    UDS_SERVER_RCRRP_QUEUE_LEN > 0 || UDS_SERVER_ENABLE_0x84
+/**
+ * @brief Get the place in the request context where a request of len bytes is kept, leaving the
+ * rest of send_buf to the response
+ */
+static uint8_t *RequestSlot(UDSReq_t *r, size_t len) {
+#if UDS_SERVER_SHARED_BUF
+    r->send_buf_size = sizeof(r->send_buf) - len;
+    return r->send_buf + sizeof(r->send_buf) - len;
+#else
+    (void)len;
+    r->send_buf_size = sizeof(r->send_buf);
+    return r->recv_storage;
+#endif
+}
+#endif
+
+/**
+ * @brief Get the request context currently being processed
+ */
+static inline UDSReq_t *ActiveRequest(UDSServer_t *srv) {
+#if UDS_SERVER_MAX_TESTERS > 1
+    if (srv->tester) {
+        return srv->tester->r;
+    }
+    return srv->rx;
+#else
+    return &srv->r;
+#endif
+}
+
+static uint8_t safe_copy(UDSServer_t *srv, const void *src, uint16_t count) {
+    if (srv == NULL) {
+        return UDS_NRC_GeneralReject;
+    }
+    if (src == NULL) {
+        return UDS_NRC_GeneralReject;
+    }
+    UDSReq_t *r = ActiveRequest(srv);
+    if (count <= r->send_buf_size - r->send_len) {
+        memmove(r->send_buf + r->send_len, src, count);
+        r->send_len += count;
+        return UDS_PositiveResponse;
+    }
+    return UDS_NRC_ResponseTooLong;
+}
+
+/**
+ * @brief Enter a place the response can be deferred from, and take the result passed to
+ * UDSServerCompleteResponse if the response was deferred from this place. A request can pass
+ * several of them, e.g. a 0x22 with several DIDs, and only the one that deferred gets the result.
+ * @param evt event of the place
+ * @param id DID or address the place handles, 0 if the event occurs once per request
+ * @return true if *err holds the result of a deferred response
+ */
+static bool TakeDeferredResult(UDSReq_t *r, UDSEvent_t evt, uintptr_t id, UDSErr_t *err) {
+    r->deferEvt = (uint8_t)evt;
+    r->deferId = id;
+    if (PENDING_DELIVER != PENDING_LOAD(&r->pendingState) || r->pendingEvt != (uint8_t)evt ||
+        r->pendingId != id) {
+        return false;
+    }
+    *err = r->pendingNrc;
+    r->pendingState = PENDING_NONE;
+    r->pendingToken = 0;
+    return true;
+}
+
+/**
+ * @brief The DID or address of events that a single request can emit more than once
+ */
+static uintptr_t EventId(UDSEvent_t evt, const void *data) {
+    switch (evt) {
+    case UDS_EVT_ReadDataByIdent:
+        return ((const UDSRDBIArgs_t *)data)->dataId;
+    case UDS_EVT_ReadMemByAddr:
+        return (uintptr_t)((const UDSReadMemByAddrArgs_t *)data)->memAddr;
+    case UDS_EVT_DynamicDefineDataId: {
+        const UDSDDDIArgs_t *args = data;
+        if (0x01 == args->type) {
+            return args->subFuncArgs.defineById.sourceDataId;
+        }
+        if (0x02 == args->type) {
+            return (uintptr_t)args->subFuncArgs.defineByMemAddress.memAddr;
+        }
+        return args->dynamicDataId;
+    }
+    default:
+        return 0;
+    }
+}
+
 static UDSErr_t EmitEvent(UDSServer_t *srv, UDSEvent_t evt, void *data) {
     UDSErr_t err = UDS_OK;
-    if (srv->fn) {
+    UDSReq_t *r = ActiveRequest(srv);
+    if (TakeDeferredResult(r, evt, data ? EventId(evt, data) : 0, &err)) {
+        // answer the service handler with the deferred result instead of calling srv->fn again
+        if (UDS_PositiveResponse == err && r->pendingLen > 0) {
+            err = safe_copy(srv, r->pendingData, r->pendingLen);
+        }
+    } else if (srv->fn) {
+#if UDS_SERVER_STATS
+        uint32_t start = UDSMicros();
         err = srv->fn(srv, evt, data);
+        UDSHistogramAdd(&srv->stats.callback, UDSMicros() - start);
+#else
+        err = srv->fn(srv, evt, data);
+#endif
     } else {
         UDS_LOGI(__FILE__, "Unhandled UDSEvent %d, srv.fn not installed!\n", evt);
         err = UDS_NRC_GeneralReject;
@@ -35,6 +170,131 @@ static UDSErr_t EmitEvent(UDSServer_t *srv, UDSEvent_t evt, void *data) {
     return err;
 }
 
+/**
+ * @brief Test a session against a session mask made of UDS_SESSION_BIT(). An empty mask allows
+ * every session.
+ */
+static bool SessionInMask(uint32_t sessionMask, uint8_t sessionType) {
+    if (0 == sessionMask) {
+        return true;
+    }
+    if (0 == sessionType || sessionType > 0x20) {
+        return false;
+    }
+    return 0 != (sessionMask & UDS_SESSION_BIT(sessionType));
+}
+
+#if UDS_SERVER_ENABLE_0x2A
+/**
+ * @brief Find the periodicDataIdentifier `pdid` scheduled by the tester at `ta`
+ */
+static int FindPeriodic(const UDSServer_t *srv, uint32_t ta, uint8_t pdid) {
+    for (int i = 0; i < srv->periodicCount; i++) {
+        if (srv->periodic[i].ta == ta && srv->periodic[i].pdid == pdid) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void RemovePeriodic(UDSServer_t *srv, int idx) {
+    for (int i = idx + 1; i < srv->periodicCount; i++) {
+        srv->periodic[i - 1] = srv->periodic[i];
+    }
+    srv->periodicCount--;
+    if (srv->periodicNext > idx) {
+        srv->periodicNext--;
+    }
+    if (srv->periodicNext >= srv->periodicCount) {
+        srv->periodicNext = 0;
+    }
+}
+
+/**
+ * @brief Stop periodic transmission to the tester at `ta`. ISO14229-1:2020 10.5.1: periodic
+ * transmission stops when the tester leaves its session.
+ */
+static void StopPeriodic(UDSServer_t *srv, uint32_t ta) {
+    for (int i = srv->periodicCount - 1; i >= 0; i--) {
+        if (srv->periodic[i].ta == ta) {
+            RemovePeriodic(srv, i);
+        }
+    }
+}
+#endif
+
+#if UDS_SERVER_ENABLE_0x2A || UDS_SERVER_ENABLE_0x86
+/**
+ * @brief Address of the tester whose request is being processed, 0 for the transport default
+ */
+static uint32_t RequestTesterAddress(const UDSServer_t *srv) {
+#if UDS_SERVER_MAX_TESTERS > 1
+    return srv->tester ? srv->tester->sa : 0;
+#else
+    (void)srv;
+    return 0;
+#endif
+}
+
+/**
+ * @brief The tester at `ta` is waiting for the response to a request
+ */
+static bool TesterIsBusy(const UDSServer_t *srv, uint32_t ta) {
+#if UDS_SERVER_MAX_TESTERS > 1
+    for (size_t i = 0; i < UDS_SERVER_MAX_TESTERS; i++) {
+        const UDSServerTester_t *t = &srv->testers[i];
+        if (t->inUse && t->sa == ta) {
+            return t->requestInProgress;
+        }
+    }
+    return false;
+#else
+    (void)ta;
+    return srv->requestInProgress;
+#endif
+}
+#endif
+
+#if UDS_SERVER_ENABLE_0x86
+/**
+ * @brief ISO14229-1:2020 10.9.1: ResponseOnEvent stops when the tester that started it leaves its
+ * session. The event logic is kept and can be restarted.
+ */
+static void StopROE(UDSServer_t *srv, uint32_t ta) {
+    for (int i = 0; i < srv->roeCount; i++) {
+        UDSROEEvent_t *ev = &srv->roe[i];
+        if (ev->ta == ta) {
+            ev->active = false;
+            ev->pending = false;
+        }
+    }
+}
+#endif
+
+#if UDS_SERVER_ENABLE_0x2C
+/**
+ * @brief ISO14229-1:2020 10.6.1: dynamically defined data identifiers do not survive a return to
+ * the default session or an ECU reset
+ */
+static void ClearDDDI(UDSServer_t *srv) {
+    srv->dddiCount = 0;
+}
+#endif
+
+#if UDS_SERVER_ENABLE_0x83
+/**
+ * @brief Timing parameters set with AccessTimingParameter last until the session changes
+ */
+static void ResetTimingParameters(UDSServer_t *srv) {
+    if (srv->atpActive) {
+        srv->p2_ms = srv->atpDefaultP2_ms;
+        srv->p2_star_ms = srv->atpDefaultP2Star_ms;
+        srv->atpActive = false;
+    }
+}
+#endif
+
+#if UDS_SERVER_ENABLE_0x10
 static UDSErr_t Handle_0x10_DiagnosticSessionControl(UDSServer_t *srv, UDSReq_t *r) {
     if (r->recv_len < UDS_0X10_REQ_LEN) {
         return NegativeResponse(r, UDS_NRC_IncorrectMessageLengthOrInvalidFormat);
@@ -54,6 +314,22 @@ static UDSErr_t Handle_0x10_DiagnosticSessionControl(UDSServer_t *srv, UDSReq_t
         return NegativeResponse(r, err);
     }
 
+    if (sessType != srv->sessionType) {
+#if UDS_SERVER_ENABLE_0x2A
+        StopPeriodic(srv, RequestTesterAddress(srv));
+#endif
+#if UDS_SERVER_ENABLE_0x86
+        StopROE(srv, RequestTesterAddress(srv));
+#endif
+#if UDS_SERVER_ENABLE_0x83
+        ResetTimingParameters(srv);
+#endif
+#if UDS_SERVER_ENABLE_0x2C
+        if (UDS_LEV_DS_DS == sessType) {
+            ClearDDDI(srv);
+        }
+#endif
+    }
     srv->sessionType = sessType;
 
     switch (sessType) {
@@ -62,7 +338,7 @@ static UDSErr_t Handle_0x10_DiagnosticSessionControl(UDSServer_t *srv, UDSReq_t
     case UDS_LEV_DS_PRGS:  // programming session
     case UDS_LEV_DS_EXTDS: // extended diagnostic session
     default:
-        srv->s3_session_timeout_timer = UDSMillis() + srv->s3_ms;
+        srv->s3_session_timeout_timer = srv->now + srv->s3_ms;
         break;
     }
 
@@ -81,7 +357,9 @@ static UDSErr_t Handle_0x10_DiagnosticSessionControl(UDSServer_t *srv, UDSReq_t
     r->send_len = UDS_0X10_RESP_LEN;
     return UDS_PositiveResponse;
 }
+#endif
 
+#if UDS_SERVER_ENABLE_0x11
 static UDSErr_t Handle_0x11_ECUReset(UDSServer_t *srv, UDSReq_t *r) {
     uint8_t resetType = r->recv_buf[1] & 0x3F;
 
@@ -99,7 +377,10 @@ static UDSErr_t Handle_0x11_ECUReset(UDSServer_t *srv, UDSReq_t *r) {
     if (UDS_PositiveResponse == err) {
         srv->notReadyToReceive = true;
         srv->ecuResetScheduled = resetType;
-        srv->ecuResetTimer = UDSMillis() + args.powerDownTimeMillis;
+        srv->ecuResetTimer = srv->now + args.powerDownTimeMillis;
+#if UDS_SERVER_ENABLE_0x2C
+        ClearDDDI(srv);
+#endif
     } else {
         return NegativeResponse(r, err);
     }
@@ -119,6 +400,30 @@ static UDSErr_t Handle_0x11_ECUReset(UDSServer_t *srv, UDSReq_t *r) {
     }
     return UDS_PositiveResponse;
 }
+#endif
+
+#if UDS_SERVER_ENABLE_0x14
+/**
+ * @brief Delete the log records of a group. The log only knows single DTCs and all of them, so a
+ * functional group of the store is deleted DTC by DTC
+ */
+static UDSErr_t ClearDTCLog(UDSServer_t *srv, uint8_t memory, uint32_t group) {
+    const UDSDTCStore_t *store = srv->dtcStore;
+    if (NULL == store || UDS_DTC_GROUP_ALL == group || UDSDTCStoreFind(store, group)) {
+        return UDSDTCLogClear(srv->dtcLog, memory, group);
+    }
+    for (uint16_t i = 0; i < store->count; i++) {
+        const uint8_t *d = store->records[i].dtc;
+        uint32_t dtc = (uint32_t)d[0] << 16 | (uint32_t)d[1] << 8 | d[2];
+        if (UDSDTCStoreInGroup(store, group, dtc)) {
+            UDSErr_t err = UDSDTCLogClear(srv->dtcLog, memory, dtc);
+            if (UDS_OK != err) {
+                return err;
+            }
+        }
+    }
+    return UDS_OK;
+}
 
 static UDSErr_t Handle_0x14_ClearDiagnosticInformation(UDSServer_t *srv, UDSReq_t *r) {
     if (r->recv_len < UDS_0X14_REQ_MIN_LEN) {
@@ -134,29 +439,116 @@ static UDSErr_t Handle_0x14_ClearDiagnosticInformation(UDSServer_t *srv, UDSReq_
         .memorySelection = (r->recv_len >= 5) ? r->recv_buf[4] : 0,
     };
 
+    if (srv->dtcStore && !UDSDTCStoreHasGroup(srv->dtcStore, args.groupOfDTC)) {
+        return NegativeResponse(r, UDS_NRC_RequestOutOfRange);
+    }
+
     UDSErr_t err = EmitEvent(srv, UDS_EVT_ClearDiagnosticInfo, &args);
 
     if (err != UDS_PositiveResponse) {
         return NegativeResponse(r, err);
     }
 
+    if (srv->dtcStore) {
+        UDSDTCStoreClear(srv->dtcStore, args.groupOfDTC);
+    }
+    if (srv->dtcLog) {
+        UDSErr_t logErr = ClearDTCLog(srv, args.memorySelection, args.groupOfDTC);
+        if (UDS_OK != logErr) {
+            UDS_LOGE(__FILE__, "DTC log clear failed: %d", logErr);
+            return NegativeResponse(r, UDS_NRC_GeneralProgrammingFailure);
+        }
+    }
+
     return UDS_PositiveResponse;
 }
+#endif
 
-static uint8_t safe_copy(UDSServer_t *srv, const void *src, uint16_t count) {
-    if (srv == NULL) {
+/**
+ * @brief Give the caller direct access to the unused part of the send buffer. Data written there
+ * becomes part of the response once it is committed with safe_commit.
+ */
+static uint8_t safe_reserve(UDSServer_t *srv, uint8_t **ptr, uint16_t *capacity) {
+    if (srv == NULL || ptr == NULL || capacity == NULL) {
         return UDS_NRC_GeneralReject;
     }
-    if (src == NULL) {
+    UDSReq_t *r = ActiveRequest(srv);
+    size_t avail = r->send_buf_size - r->send_len;
+    *ptr = r->send_buf + r->send_len;
+    *capacity = avail > UINT16_MAX ? UINT16_MAX : (uint16_t)avail;
+    return UDS_PositiveResponse;
+}
+
+static uint8_t safe_commit(UDSServer_t *srv, uint16_t count) {
+    if (srv == NULL) {
         return UDS_NRC_GeneralReject;
     }
-    UDSReq_t *r = (UDSReq_t *)&srv->r;
-    if (count <= sizeof(r->send_buf) - r->send_len) {
-        memmove(r->send_buf + r->send_len, src, count);
-        r->send_len += count;
+    UDSReq_t *r = ActiveRequest(srv);
+    if (count > r->send_buf_size - r->send_len) {
+        return UDS_NRC_ResponseTooLong;
+    }
+    r->send_len += count;
+    return UDS_PositiveResponse;
+}
+
+#if UDS_SERVER_ENABLE_0x19
+/**
+ * @brief Answer the status mask subfunctions of 0x19 from the registered DTC store, writing the
+ * records straight into the send buffer
+ */
+static UDSErr_t ReadDTCStore(const UDSDTCStore_t *store, UDSReq_t *r, uint8_t type) {
+    r->send_buf[r->send_len++] = store->availabilityMask;
+
+    if (0x01 == type) { /* reportNumberOfDTCByStatusMask */
+        uint16_t n = UDSDTCStoreCountByMask(store, r->recv_buf[2]);
+        r->send_buf[r->send_len++] = UDS_DTC_FORMAT_ISO14229_1;
+        r->send_buf[r->send_len++] = (uint8_t)(n >> 8);
+        r->send_buf[r->send_len++] = (uint8_t)(n & 0xFF);
         return UDS_PositiveResponse;
     }
-    return UDS_NRC_ResponseTooLong;
+
+    size_t len = 0;
+    if (UDS_OK != UDSDTCStoreList(store, r->recv_buf[2], 0x0A == type, r->send_buf + r->send_len,
+                                  r->send_buf_size - r->send_len, &len)) {
+        return NegativeResponse(r, UDS_NRC_ResponseTooLong);
+    }
+    r->send_len += len;
+    return UDS_PositiveResponse;
+}
+
+/**
+ * @brief Answer the snapshot and extended data subfunctions of 0x19 from the registered DTC record
+ * log, streaming the records from flash into the send buffer
+ */
+static UDSErr_t ReadDTCLog(UDSServer_t *srv, UDSReq_t *r, uint8_t type) {
+    uint32_t dtc = (uint32_t)(r->recv_buf[2] << 16 | r->recv_buf[3] << 8 | r->recv_buf[4]);
+    uint8_t recordNum = r->recv_buf[5];
+    uint8_t memory = 0;
+    const UDSDTCRecord_t *rec = UDSDTCStoreFind(srv->dtcStore, dtc);
+    if (NULL == rec) {
+        return NegativeResponse(r, UDS_NRC_RequestOutOfRange);
+    }
+    if (0x18 == type || 0x19 == type) { /* DTC records of a user defined memory */
+        memory = r->recv_buf[6];
+        r->send_buf[r->send_len++] = memory;
+    }
+    memcpy(r->send_buf + r->send_len, rec, sizeof(*rec));
+    r->send_len += sizeof(*rec);
+
+    size_t len = 0;
+    UDSErr_t err = UDSDTCLogRead(srv->dtcLog,
+                                 (0x04 == type || 0x18 == type) ? UDS_DTC_LOG_SNAPSHOT
+                                                                : UDS_DTC_LOG_EXT_DATA,
+                                 memory, dtc, recordNum, r->send_buf + r->send_len,
+                                 r->send_buf_size - r->send_len, &len);
+    if (UDS_ERR_BUFSIZ == err) {
+        return NegativeResponse(r, UDS_NRC_ResponseTooLong);
+    } else if (UDS_OK != err) {
+        UDS_LOGE(__FILE__, "DTC log read failed: %d", err);
+        return NegativeResponse(r, UDS_NRC_GeneralReject);
+    }
+    r->send_len += len;
+    return UDS_PositiveResponse;
 }
 
 static UDSErr_t Handle_0x19_ReadDTCInformation(UDSServer_t *srv, UDSReq_t *r) {
@@ -175,6 +567,8 @@ static UDSErr_t Handle_0x19_ReadDTCInformation(UDSServer_t *srv, UDSReq_t *r) {
     UDSRDTCIArgs_t args = {
         .type = type,
         .copy = safe_copy,
+        .reserve = safe_reserve,
+        .commit = safe_commit,
     };
 
     /* Before checks and emitting Request */
@@ -303,6 +697,16 @@ static UDSErr_t Handle_0x19_ReadDTCInformation(UDSServer_t *srv, UDSReq_t *r) {
         return NegativeResponse(r, UDS_NRC_SubFunctionNotSupported);
     }
 
+    if (srv->dtcStore && (0x01 == type || 0x02 == type || 0x0A == type)) {
+        return ReadDTCStore(srv->dtcStore, r, type);
+    }
+    // 0xFE (all OBD extended data records) is left to srv->fn
+    if (srv->dtcStore && srv->dtcLog &&
+        (0x04 == type || 0x18 == type ||
+         ((0x06 == type || 0x19 == type) && 0xFE != r->recv_buf[5]))) {
+        return ReadDTCLog(srv, r, type);
+    }
+
     ret = EmitEvent(srv, UDS_EVT_ReadDTCInformation, &args);
 
     if (UDS_PositiveResponse != ret) {
@@ -414,7 +818,271 @@ respond_to_0x19_malformed_response:
     UDS_LOGE(__FILE__, "RDTCI subFunc 0x%02X is malformed. Length: %zu\n", type, r->send_len);
     return NegativeResponse(r, UDS_NRC_GeneralReject);
 }
+#endif
+
+#if UDS_SERVER_ENABLE_0x22 || UDS_SERVER_ENABLE_0x2A || UDS_SERVER_ENABLE_0x2C || \
+    UDS_SERVER_ENABLE_0x2E || UDS_SERVER_ENABLE_0x86
+/**
+ * @brief Binary search the registered DID table
+ * @return the matching entry or NULL
+ */
+static const UDSDIDEntry_t *FindDID(const UDSServer_t *srv, uint16_t did) {
+    size_t lo = 0;
+    size_t hi = srv->didTableLen;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const UDSDIDEntry_t *entry = &srv->didTable[mid];
+        if (entry->did == did) {
+            return entry;
+        } else if (entry->did < did) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Check `access` to a registered DID against the active session and security level
+ * @return UDS_PositiveResponse, UDS_NRC_RequestOutOfRange or UDS_NRC_SecurityAccessDenied
+ */
+static UDSErr_t DIDAccess(const UDSServer_t *srv, const UDSDIDEntry_t *entry, uint8_t access) {
+    if (0 == (entry->access & access) || !SessionInMask(entry->sessionMask, srv->sessionType)) {
+        return UDS_NRC_RequestOutOfRange;
+    }
+    if (entry->securityLevel && entry->securityLevel != srv->securityLevel) {
+        return UDS_NRC_SecurityAccessDenied;
+    }
+    return UDS_PositiveResponse;
+}
+#endif
+
+#if UDS_SERVER_DID_CACHE_ENTRIES > 0
+static UDSDIDSnapshot_t *FindCachedDID(UDSServer_t *srv, uint16_t did) {
+    for (size_t i = 0; i < UDS_SERVER_DID_CACHE_ENTRIES; i++) {
+        if (srv->didCache[i].len && srv->didCache[i].did == did) {
+            return &srv->didCache[i];
+        }
+    }
+    return NULL;
+}
+
+#if UDS_SERVER_ENABLE_0x22
+static uint32_t DIDVersion(const UDSDIDEntry_t *entry) {
+    return entry->version ? *entry->version : 0;
+}
+
+/**
+ * @brief Get the cached record of a DID registered with a cacheMs
+ * @return NULL if it is not cached, has expired or its version has changed
+ */
+static const UDSDIDSnapshot_t *DIDCacheGet(UDSServer_t *srv, const UDSDIDEntry_t *entry) {
+    UDSDIDSnapshot_t *c = FindCachedDID(srv, entry->did);
+    if (NULL == c) {
+        return NULL;
+    }
+    if (UDSTimeAfter(srv->now, c->filledAt + entry->cacheMs) || c->version != DIDVersion(entry)) {
+        c->len = 0;
+        return NULL;
+    }
+    c->usedAt = ++srv->didCacheTick;
+    return c;
+}
+
+/**
+ * @brief Keep a record that has just been produced, evicting the least recently used one if the
+ * cache is full
+ */
+static void DIDCachePut(UDSServer_t *srv, const UDSDIDEntry_t *entry, const uint8_t *data,
+                        size_t len) {
+    if (0 == len || len > UDS_SERVER_DID_CACHE_RECORD_SIZE) {
+        return;
+    }
+    UDSDIDSnapshot_t *c = FindCachedDID(srv, entry->did);
+    if (NULL == c) {
+        c = &srv->didCache[0];
+        for (size_t i = 1; i < UDS_SERVER_DID_CACHE_ENTRIES && c->len; i++) {
+            UDSDIDSnapshot_t *slot = &srv->didCache[i];
+            if (0 == slot->len || (int32_t)(slot->usedAt - c->usedAt) < 0) {
+                c = slot; // a free slot, or the least recently used one so far
+            }
+        }
+    }
+    c->did = entry->did;
+    c->len = (uint16_t)len;
+    c->version = DIDVersion(entry);
+    c->filledAt = srv->now;
+    c->usedAt = ++srv->didCacheTick;
+    memcpy(c->data, data, len);
+}
+#endif
+#endif
+
+#if UDS_SERVER_ENABLE_0x23 || UDS_SERVER_ENABLE_0x3D || UDS_SERVER_ENABLE_0x2C
+/**
+ * @brief Find the registered memory region holding [addr, addr + len) and check that it may be
+ * accessed
+ * @param region set to the region, NULL if no table is registered
+ * @return UDS_PositiveResponse or the negative response code of the request
+ */
+static UDSErr_t FindMemRegion(const UDSServer_t *srv, uintptr_t addr, size_t len, uint8_t access,
+                              const UDSMemRegion_t **region) {
+    *region = NULL;
+    if (0 == srv->memRegionsLen) {
+        return UDS_PositiveResponse;
+    }
+    for (size_t i = 0; i < srv->memRegionsLen; i++) {
+        const UDSMemRegion_t *m = &srv->memRegions[i];
+        if (addr < m->start || len > m->len || addr - m->start > m->len - len) {
+            continue;
+        }
+        if (!(m->access & access) || !SessionInMask(m->sessionMask, srv->sessionType)) {
+            return UDS_NRC_RequestOutOfRange;
+        }
+        if (m->securityLevel && m->securityLevel != srv->securityLevel) {
+            return UDS_NRC_SecurityAccessDenied;
+        }
+        *region = m;
+        return UDS_PositiveResponse;
+    }
+    return UDS_NRC_RequestOutOfRange;
+}
+#endif
+
+#if UDS_SERVER_ENABLE_0x23 || (UDS_SERVER_ENABLE_0x2C && UDS_SERVER_ENABLE_0x22)
+/**
+ * @brief Append memory of a registered region to the response. Copy engines read into a staging
+ * area behind the 0x78 response and the data already in the response, and the data is moved into
+ * place once they are done.
+ */
+static UDSErr_t ReadMemRegion(UDSServer_t *srv, UDSReq_t *r, const UDSMemRegion_t *region,
+                              uintptr_t addr, size_t len) {
+    size_t stageAt = r->send_len < UDS_NEG_RESP_LEN ? UDS_NEG_RESP_LEN : r->send_len;
+    if (stageAt + len > r->send_buf_size) {
+        return UDS_NRC_ResponseTooLong;
+    }
+    if (NULL == region->read) {
+        memcpy(&r->send_buf[r->send_len], (const void *)addr, len);
+        r->send_len += len;
+        return UDS_PositiveResponse;
+    }
+
+    uint8_t *stage = &r->send_buf[stageAt];
+    UDSErr_t err = UDS_PositiveResponse;
+    if (!TakeDeferredResult(r, UDS_EVT_ReadMemByAddr, addr, &err)) {
+        err = region->read(srv, region, addr, stage, len);
+    }
+    if (UDS_PositiveResponse == err) {
+        memmove(&r->send_buf[r->send_len], stage, len);
+        r->send_len += len;
+    }
+    return err;
+}
+#endif
+
+#if UDS_SERVER_ENABLE_0x2C
+static UDSDDDIDefinition_t *FindDDDI(UDSServer_t *srv, uint16_t did) {
+    for (uint8_t i = 0; i < srv->dddiCount; i++) {
+        if (srv->dddi[i].did == did) {
+            return &srv->dddi[i];
+        }
+    }
+    return NULL;
+}
+
+#if UDS_SERVER_ENABLE_0x22
+/**
+ * @brief Append the data record of a dynamically defined DID to the response by executing its
+ * copy plan. Sources come from the DID table, UDS_EVT_ReadDataByIdent, the memory regions or
+ * UDS_EVT_ReadMemByAddr.
+ */
+static UDSErr_t ReadDDDI(UDSServer_t *srv, UDSReq_t *r, const UDSDDDIDefinition_t *def) {
+    for (uint8_t i = 0; i < def->count; i++) {
+        const UDSDDDIElement_t *el = &def->elements[i];
+        size_t start = r->send_len;
+        UDSErr_t ret = UDS_PositiveResponse;
+
+        if (0x02 == el->type) {
+            const UDSMemRegion_t *region = NULL;
+            ret = FindMemRegion(srv, (uintptr_t)el->memAddr, el->size, UDS_MEM_READ, &region);
+            if (UDS_PositiveResponse != ret) {
+                return ret;
+            }
+            if (region) {
+                ret = ReadMemRegion(srv, r, region, (uintptr_t)el->memAddr, el->size);
+                if (UDS_PositiveResponse != ret) {
+                    return ret;
+                }
+                continue;
+            }
+            UDSReadMemByAddrArgs_t args = {
+                .memAddr = el->memAddr,
+                .memSize = el->size,
+                .copy = safe_copy,
+                .reserve = safe_reserve,
+                .commit = safe_commit,
+            };
+            ret = EmitEvent(srv, UDS_EVT_ReadMemByAddr, &args);
+            if (UDS_PositiveResponse != ret) {
+                return ret;
+            }
+            if (r->send_len != start + el->size) {
+                UDS_LOGE(__FILE__, "DDDI: memory source returned %zu bytes, expected %u\n",
+                         r->send_len - start, el->size);
+                return UDS_NRC_GeneralReject;
+            }
+            continue;
+        }
+
+        const UDSDIDEntry_t *entry = FindDID(srv, el->sourceDataId);
+        ret = entry ? DIDAccess(srv, entry, UDS_DID_READ) : UDS_PositiveResponse;
+        if (UDS_PositiveResponse != ret) {
+            return ret;
+        }
+        if (entry && entry->ptr && !entry->read) {
+            // the common case: slice the record straight out of its storage
+            if (start + el->size > r->send_buf_size) {
+                return UDS_NRC_ResponseTooLong;
+            }
+            memcpy(r->send_buf + start, (const uint8_t *)entry->ptr + el->offset, el->size);
+            r->send_len += el->size;
+            continue;
+        }
+
+        // produce the whole source record behind the response, then keep the slice
+        if (entry && entry->read) {
+            if (start + entry->len > r->send_buf_size) {
+                return UDS_NRC_ResponseTooLong;
+            }
+            ret = entry->read(srv, entry, r->send_buf + start);
+            r->send_len += entry->len;
+        } else {
+            UDSRDBIArgs_t args = {
+                .dataId = el->sourceDataId,
+                .copy = safe_copy,
+                .reserve = safe_reserve,
+                .commit = safe_commit,
+            };
+            ret = EmitEvent(srv, UDS_EVT_ReadDataByIdent, &args);
+        }
+        if (UDS_PositiveResponse != ret) {
+            return ret;
+        }
+        if (r->send_len < start + el->offset + el->size) {
+            UDS_LOGE(__FILE__, "DDDI: source DID 0x%04X is shorter than its definition\n",
+                     el->sourceDataId);
+            return UDS_NRC_GeneralReject;
+        }
+        memmove(r->send_buf + start, r->send_buf + start + el->offset, el->size);
+        r->send_len = start + el->size;
+    }
+    return UDS_PositiveResponse;
+}
+#endif
+#endif
 
+#if UDS_SERVER_ENABLE_0x22
 static UDSErr_t Handle_0x22_ReadDataByIdentifier(UDSServer_t *srv, UDSReq_t *r) {
     uint8_t numDIDs;
     uint16_t dataId = 0;
@@ -436,7 +1104,7 @@ static UDSErr_t Handle_0x22_ReadDataByIdentifier(UDSServer_t *srv, UDSReq_t *r)
         uint16_t idx = (uint16_t)(1 + did * 2);
         dataId = (uint16_t)((uint16_t)(r->recv_buf[idx] << 8) | (uint16_t)r->recv_buf[idx + 1]);
 
-        if (r->send_len + 3 > sizeof(r->send_buf)) {
+        if (r->send_len + 3 > r->send_buf_size) {
             return NegativeResponse(r, UDS_NRC_ResponseTooLong);
         }
         uint8_t *copylocation = r->send_buf + r->send_len;
@@ -444,9 +1112,73 @@ static UDSErr_t Handle_0x22_ReadDataByIdentifier(UDSServer_t *srv, UDSReq_t *r)
         copylocation[1] = dataId & 0xFF;
         r->send_len += 2;
 
+#if UDS_SERVER_ENABLE_0x2C
+        const UDSDDDIDefinition_t *def = FindDDDI(srv, dataId);
+        if (def) {
+            ret = ReadDDDI(srv, r, def);
+            if (UDS_PositiveResponse != ret) {
+                return NegativeResponse(r, ret);
+            }
+            continue;
+        }
+#endif
+
+#if UDS_SERVER_STATS && UDS_SERVER_STATS_DID
+        if (UDS_SERVER_STATS_DID == dataId) {
+            size_t len = 0;
+            if (UDSPackServerStats(&srv->stats, r->send_buf + r->send_len,
+                                   r->send_buf_size - r->send_len, &len)) {
+                return NegativeResponse(r, UDS_NRC_ResponseTooLong);
+            }
+            r->send_len += len;
+            continue;
+        }
+#endif
+
+        const UDSDIDEntry_t *entry = FindDID(srv, dataId);
+        if (entry) {
+            ret = DIDAccess(srv, entry, UDS_DID_READ);
+            if (UDS_PositiveResponse != ret) {
+                return NegativeResponse(r, ret);
+            }
+#if UDS_SERVER_DID_CACHE_ENTRIES > 0
+            const UDSDIDSnapshot_t *cached = entry->cacheMs ? DIDCacheGet(srv, entry) : NULL;
+            if (cached) {
+                if (r->send_len + cached->len > r->send_buf_size) {
+                    return NegativeResponse(r, UDS_NRC_ResponseTooLong);
+                }
+                memcpy(r->send_buf + r->send_len, cached->data, cached->len);
+                r->send_len += cached->len;
+                continue;
+            }
+#endif
+            if (entry->read || entry->ptr) {
+                if (r->send_len + entry->len > r->send_buf_size) {
+                    return NegativeResponse(r, UDS_NRC_ResponseTooLong);
+                }
+                if (entry->read) {
+                    ret = entry->read(srv, entry, r->send_buf + r->send_len);
+                    if (UDS_PositiveResponse != ret) {
+                        return NegativeResponse(r, ret);
+                    }
+#if UDS_SERVER_DID_CACHE_ENTRIES > 0
+                    if (entry->cacheMs) {
+                        DIDCachePut(srv, entry, r->send_buf + r->send_len, entry->len);
+                    }
+#endif
+                } else {
+                    memcpy(r->send_buf + r->send_len, entry->ptr, entry->len);
+                }
+                r->send_len += entry->len;
+                continue;
+            }
+        }
+
         UDSRDBIArgs_t args = {
             .dataId = dataId,
             .copy = safe_copy,
+            .reserve = safe_reserve,
+            .commit = safe_commit,
         };
 
         size_t send_len_before = r->send_len;
@@ -459,10 +1191,18 @@ static UDSErr_t Handle_0x22_ReadDataByIdentifier(UDSServer_t *srv, UDSReq_t *r)
         if (UDS_PositiveResponse != ret) {
             return NegativeResponse(r, ret);
         }
+#if UDS_SERVER_DID_CACHE_ENTRIES > 0
+        if (entry && entry->cacheMs) {
+            DIDCachePut(srv, entry, r->send_buf + send_len_before, r->send_len - send_len_before);
+        }
+#endif
     }
     return UDS_PositiveResponse;
 }
+#endif
 
+#if UDS_SERVER_ENABLE_0x23 || UDS_SERVER_ENABLE_0x2C || UDS_SERVER_ENABLE_0x34 || \
+    UDS_SERVER_ENABLE_0x35 || UDS_SERVER_ENABLE_0x3D
 /**
  * @brief decode the addressAndLengthFormatIdentifier that appears in
  * DynamicallyDefineDataIdentifier (0x2C). This must be handled separatedly because the
@@ -475,7 +1215,7 @@ static UDSErr_t Handle_0x22_ReadDataByIdentifier(UDSServer_t *srv, UDSReq_t *r)
  * @param offset how many elements (addres and size pairs) away from the format identifier
  * @return uint8_t
  */
-static UDSErr_t decodeAddressAndLengthWithOffset(UDSReq_t *r, uint8_t *const buf,
+static UDSErr_t decodeAddressAndLengthWithOffset(UDSReq_t *r, const uint8_t *const buf,
                                                  void **memoryAddress, size_t *memorySize,
                                                  size_t offset) {
     UDS_ASSERT(r);
@@ -485,7 +1225,7 @@ static UDSErr_t decodeAddressAndLengthWithOffset(UDSReq_t *r, uint8_t *const buf
     *memoryAddress = 0;
     *memorySize = 0;
 
-    UDS_ASSERT(buf >= r->recv_buf && buf <= r->recv_buf + sizeof(r->recv_buf));
+    UDS_ASSERT(buf >= r->recv_buf && buf <= r->recv_buf + r->recv_len);
 
     if (r->recv_len < 3) {
         return NegativeResponse(r, UDS_NRC_IncorrectMessageLengthOrInvalidFormat);
@@ -522,7 +1262,10 @@ static UDSErr_t decodeAddressAndLengthWithOffset(UDSReq_t *r, uint8_t *const buf
     }
     return UDS_PositiveResponse;
 }
+#endif
 
+#if UDS_SERVER_ENABLE_0x23 || UDS_SERVER_ENABLE_0x34 || UDS_SERVER_ENABLE_0x35 || \
+    UDS_SERVER_ENABLE_0x3D
 /**
  * @brief decode the addressAndLengthFormatIdentifier that appears in ReadMemoryByAddress (0x23)
  * and RequestDownload (0X34)
@@ -533,11 +1276,13 @@ static UDSErr_t decodeAddressAndLengthWithOffset(UDSReq_t *r, uint8_t *const buf
  * @param memorySize the decoded memory size
  * @return uint8_t
  */
-static UDSErr_t decodeAddressAndLength(UDSReq_t *r, uint8_t *const buf, void **memoryAddress,
+static UDSErr_t decodeAddressAndLength(UDSReq_t *r, const uint8_t *const buf, void **memoryAddress,
                                        size_t *memorySize) {
     return decodeAddressAndLengthWithOffset(r, buf, memoryAddress, memorySize, 0);
 }
+#endif
 
+#if UDS_SERVER_ENABLE_0x23
 static UDSErr_t Handle_0x23_ReadMemoryByAddress(UDSServer_t *srv, UDSReq_t *r) {
     UDSErr_t ret = UDS_PositiveResponse;
     void *address = 0;
@@ -552,14 +1297,26 @@ static UDSErr_t Handle_0x23_ReadMemoryByAddress(UDSServer_t *srv, UDSReq_t *r) {
         return NegativeResponse(r, ret);
     }
 
+    const UDSMemRegion_t *region = NULL;
+    ret = FindMemRegion(srv, (uintptr_t)address, length, UDS_MEM_READ, &region);
+    if (UDS_PositiveResponse != ret) {
+        return NegativeResponse(r, ret);
+    }
+
+    r->send_buf[0] = UDS_RESPONSE_SID_OF(kSID_READ_MEMORY_BY_ADDRESS);
+    r->send_len = UDS_0X23_RESP_BASE_LEN;
+    if (region) {
+        ret = ReadMemRegion(srv, r, region, (uintptr_t)address, length);
+        return UDS_PositiveResponse == ret ? ret : NegativeResponse(r, ret);
+    }
+
     UDSReadMemByAddrArgs_t args = {
         .memAddr = address,
         .memSize = length,
         .copy = safe_copy,
+        .reserve = safe_reserve,
+        .commit = safe_commit,
     };
-
-    r->send_buf[0] = UDS_RESPONSE_SID_OF(kSID_READ_MEMORY_BY_ADDRESS);
-    r->send_len = UDS_0X23_RESP_BASE_LEN;
     ret = EmitEvent(srv, UDS_EVT_ReadMemByAddr, &args);
     if (UDS_PositiveResponse != ret) {
         return NegativeResponse(r, ret);
@@ -571,7 +1328,9 @@ static UDSErr_t Handle_0x23_ReadMemoryByAddress(UDSServer_t *srv, UDSReq_t *r) {
     }
     return UDS_PositiveResponse;
 }
+#endif
 
+#if UDS_SERVER_ENABLE_0x27
 static UDSErr_t Handle_0x27_SecurityAccess(UDSServer_t *srv, UDSReq_t *r) {
     uint8_t subFunction = r->recv_buf[1];
     UDSErr_t response = UDS_PositiveResponse;
@@ -580,11 +1339,11 @@ static UDSErr_t Handle_0x27_SecurityAccess(UDSServer_t *srv, UDSReq_t *r) {
         return NegativeResponse(r, UDS_NRC_IncorrectMessageLengthOrInvalidFormat);
     }
 
-    if (!UDSTimeAfter(UDSMillis(), srv->sec_access_boot_delay_timer)) {
+    if (!UDSTimeAfter(srv->now, srv->sec_access_boot_delay_timer)) {
         return NegativeResponse(r, UDS_NRC_RequiredTimeDelayNotExpired);
     }
 
-    if (!(UDSTimeAfter(UDSMillis(), srv->sec_access_auth_fail_timer))) {
+    if (!(UDSTimeAfter(srv->now, srv->sec_access_auth_fail_timer))) {
         return NegativeResponse(r, UDS_NRC_ExceedNumberOfAttempts);
     }
 
@@ -603,9 +1362,13 @@ static UDSErr_t Handle_0x27_SecurityAccess(UDSServer_t *srv, UDSReq_t *r) {
 
         response = EmitEvent(srv, UDS_EVT_SecAccessValidateKey, &args);
 
+        if (UDS_NRC_RequestCorrectlyReceived_ResponsePending == response) {
+            // the key is still being checked (e.g. UDSServerDeferResponse): not a failed attempt
+            return NegativeResponse(r, response);
+        }
         if (UDS_PositiveResponse != response) {
             srv->sec_access_auth_fail_timer =
-                UDSMillis() + UDS_SERVER_0x27_BRUTE_FORCE_MITIGATION_AUTH_FAIL_DELAY_MS;
+                srv->now + UDS_SERVER_0x27_BRUTE_FORCE_MITIGATION_AUTH_FAIL_DELAY_MS;
             return NegativeResponse(r, response);
         }
 
@@ -638,6 +1401,8 @@ static UDSErr_t Handle_0x27_SecurityAccess(UDSServer_t *srv, UDSReq_t *r) {
                 .dataRecord = &r->recv_buf[UDS_0X27_REQ_BASE_LEN],
                 .len = (uint16_t)(r->recv_len - UDS_0X27_REQ_BASE_LEN),
                 .copySeed = safe_copy,
+                .reserve = safe_reserve,
+                .commit = safe_commit,
             };
 
             response = EmitEvent(srv, UDS_EVT_SecAccessRequestSeed, &args);
@@ -654,7 +1419,9 @@ static UDSErr_t Handle_0x27_SecurityAccess(UDSServer_t *srv, UDSReq_t *r) {
         }
     }
 }
+#endif
 
+#if UDS_SERVER_ENABLE_0x28
 static UDSErr_t Handle_0x28_CommunicationControl(UDSServer_t *srv, UDSReq_t *r) {
     uint8_t controlType = r->recv_buf[1] & 0x7F;
     uint8_t communicationType = r->recv_buf[2];
@@ -686,6 +1453,291 @@ static UDSErr_t Handle_0x28_CommunicationControl(UDSServer_t *srv, UDSReq_t *r)
     r->send_len = UDS_0X28_RESP_LEN;
     return UDS_PositiveResponse;
 }
+#endif
+
+#if UDS_SERVER_ENABLE_0x29
+/**
+ * @brief Read a parameter preceded by its 2 byte length
+ * @return false if the request ends before the parameter does
+ */
+static bool AuthParam(const UDSReq_t *r, size_t *pos, const uint8_t **param, uint16_t *len) {
+    if (*pos + 2 > r->recv_len) {
+        return false;
+    }
+    uint16_t n = (uint16_t)((r->recv_buf[*pos] << 8) | r->recv_buf[*pos + 1]);
+    if (*pos + 2 + n > r->recv_len) {
+        return false;
+    }
+    *param = n > 0 ? &r->recv_buf[*pos + 2] : NULL;
+    *len = n;
+    *pos += 2U + n;
+    return true;
+}
+
+static UDSErr_t Handle_0x29_Authentication(UDSServer_t *srv, UDSReq_t *r) {
+    const uint8_t *buf = r->recv_buf;
+    uint8_t type = buf[1] & 0x7F;
+    size_t pos = UDS_0X29_REQ_BASE_LEN;
+    uint8_t commConfig = 0;
+    uint16_t evalId = 0;
+    const uint8_t *algorithm = NULL, *cert = NULL, *challenge = NULL, *pown = NULL, *epk = NULL,
+                  *additional = NULL;
+    uint16_t certLen = 0, challengeLen = 0, pownLen = 0, epkLen = 0, additionalLen = 0;
+    bool ok = true;
+
+    switch (type) {
+    case UDS_LEV_AT_DA:
+    case UDS_LEV_AT_AC:
+        break;
+    case UDS_LEV_AT_VCU:
+    case UDS_LEV_AT_VCB:
+        ok = pos < r->recv_len;
+        if (ok) {
+            commConfig = buf[pos++];
+        }
+        ok = ok && AuthParam(r, &pos, &cert, &certLen) &&
+             AuthParam(r, &pos, &challenge, &challengeLen);
+        break;
+    case UDS_LEV_AT_POWN:
+        ok = AuthParam(r, &pos, &pown, &pownLen) && AuthParam(r, &pos, &epk, &epkLen);
+        break;
+    case UDS_LEV_AT_TC:
+        ok = pos + 2 <= r->recv_len;
+        if (ok) {
+            evalId = (uint16_t)((buf[pos] << 8) | buf[pos + 1]);
+            pos += 2;
+        }
+        ok = ok && AuthParam(r, &pos, &cert, &certLen);
+        break;
+    case UDS_LEV_AT_RCFA:
+        ok = pos + 1 + UDS_0X29_ALGORITHM_INDICATOR_LEN <= r->recv_len;
+        if (ok) {
+            commConfig = buf[pos];
+            algorithm = &buf[pos + 1];
+            pos += 1 + UDS_0X29_ALGORITHM_INDICATOR_LEN;
+        }
+        break;
+    case UDS_LEV_AT_VPOWNU:
+    case UDS_LEV_AT_VPOWNB:
+        ok = pos + UDS_0X29_ALGORITHM_INDICATOR_LEN <= r->recv_len;
+        if (ok) {
+            algorithm = &buf[pos];
+            pos += UDS_0X29_ALGORITHM_INDICATOR_LEN;
+        }
+        ok = ok && AuthParam(r, &pos, &pown, &pownLen) &&
+             AuthParam(r, &pos, &challenge, &challengeLen) &&
+             AuthParam(r, &pos, &additional, &additionalLen);
+        break;
+    default:
+        return NegativeResponse(r, UDS_NRC_SubFunctionNotSupported);
+    }
+    if (!ok || pos != r->recv_len) {
+        return NegativeResponse(r, UDS_NRC_IncorrectMessageLengthOrInvalidFormat);
+    }
+
+    // proof of ownership only follows the step that asked for it
+    if ((UDS_LEV_AT_POWN == type && UDS_AUTH_CERT_VERIFIED != srv->authState) ||
+        ((UDS_LEV_AT_VPOWNU == type || UDS_LEV_AT_VPOWNB == type) &&
+         UDS_AUTH_CHALLENGE_SENT != srv->authState)) {
+        return NegativeResponse(r, UDS_NRC_RequestSequenceError);
+    }
+
+    r->send_buf[0] = UDS_RESPONSE_SID_OF(kSID_AUTHENTICATION);
+    r->send_buf[1] = type;
+    r->send_len = UDS_0X29_RESP_BASE_LEN;
+
+    UDSAuthArgs_t args = {
+        .type = type,
+        .communicationConfiguration = commConfig,
+        .algorithmIndicator = algorithm,
+        .certificateEvaluationId = evalId,
+        .certificate = cert,
+        .certificateLen = certLen,
+        .challenge = challenge,
+        .challengeLen = challengeLen,
+        .proofOfOwnership = pown,
+        .proofOfOwnershipLen = pownLen,
+        .ephemeralPublicKey = epk,
+        .ephemeralPublicKeyLen = epkLen,
+        .additionalParameter = additional,
+        .additionalParameterLen = additionalLen,
+        .copy = safe_copy,
+        .reserve = safe_reserve,
+        .commit = safe_commit,
+    };
+
+    UDSErr_t err = EmitEvent(srv, UDS_EVT_Authentication, &args);
+    if (UDS_NRC_RequestCorrectlyReceived_ResponsePending == err) {
+        return NegativeResponse(r, err); // e.g. a deferred certificate check, state unchanged
+    }
+    if (UDS_PositiveResponse != err) {
+        if (UDS_LEV_AT_TC != type && UDS_LEV_AT_AC != type) {
+            srv->authState = UDS_AUTH_NONE; // a failed verification starts over
+        }
+        return NegativeResponse(r, err);
+    }
+
+    if (UDS_LEV_AT_DA == type) {
+        srv->authState = UDS_AUTH_NONE;
+        r->send_buf[2] = UDS_AT_DAS;
+        r->send_len = UDS_0X29_RESP_BASE_LEN + 1;
+        return UDS_PositiveResponse;
+    }
+    if (r->send_len <= UDS_0X29_RESP_BASE_LEN) {
+        UDS_LOGE(__FILE__, "0x29: no authenticationReturnParameter was copied");
+        return NegativeResponse(r, UDS_NRC_GeneralReject);
+    }
+    switch (r->send_buf[UDS_0X29_RESP_BASE_LEN]) {
+    case UDS_AT_CVOVN:
+        srv->authState = UDS_AUTH_CERT_VERIFIED;
+        break;
+    case UDS_AT_OVAC:
+        srv->authState = UDS_AUTH_AUTHENTICATED;
+        break;
+    case UDS_AT_RA:
+        if (UDS_LEV_AT_RCFA == type) {
+            srv->authState = UDS_AUTH_CHALLENGE_SENT;
+        }
+        break;
+    default:
+        break;
+    }
+    return UDS_PositiveResponse;
+}
+#endif
+
+#if UDS_SERVER_ENABLE_0x2A
+static uint32_t PeriodicRateMs(uint8_t mode) {
+    switch (mode) {
+    case UDS_LEV_TM_SASR:
+        return UDS_SERVER_0x2A_SLOW_RATE_MS;
+    case UDS_LEV_TM_SAMR:
+        return UDS_SERVER_0x2A_MEDIUM_RATE_MS;
+    default:
+        return UDS_SERVER_0x2A_FAST_RATE_MS;
+    }
+}
+
+/**
+ * @brief Periodic data is served from the DID table: the periodicDataIdentifier must be registered
+ * as a readable DID 0xF2xx that fits in one periodic message
+ */
+static bool PeriodicDIDIsValid(const UDSServer_t *srv, uint8_t pdid) {
+    const UDSDIDEntry_t *entry = FindDID(srv, UDS_PDID_TO_DID(pdid));
+    return entry && (entry->read || entry->ptr) &&
+           UDS_PositiveResponse == DIDAccess(srv, entry, UDS_DID_READ) &&
+           entry->len <= UDS_SERVER_0x2A_MAX_MSG_LEN - 2;
+}
+
+static UDSErr_t Handle_0x2A_ReadDataByPeriodicIdentifier(UDSServer_t *srv, UDSReq_t *r) {
+    uint8_t mode = r->recv_buf[1];
+    const uint8_t *pdids = &r->recv_buf[UDS_0X2A_REQ_MIN_LEN];
+    size_t numPdids = r->recv_len - UDS_0X2A_REQ_MIN_LEN;
+    uint32_t ta = RequestTesterAddress(srv);
+
+    switch (mode) {
+    case UDS_LEV_TM_SASR:
+    case UDS_LEV_TM_SAMR:
+    case UDS_LEV_TM_SAFR: {
+        if (0 == numPdids) {
+            return NegativeResponse(r, UDS_NRC_IncorrectMessageLengthOrInvalidFormat);
+        }
+
+        // validate the whole request before scheduling anything
+        size_t numNew = 0;
+        for (size_t i = 0; i < numPdids; i++) {
+            if (!PeriodicDIDIsValid(srv, pdids[i])) {
+                return NegativeResponse(r, UDS_NRC_RequestOutOfRange);
+            }
+            bool repeated = FindPeriodic(srv, ta, pdids[i]) >= 0;
+            for (size_t j = 0; j < i && !repeated; j++) {
+                repeated = pdids[j] == pdids[i];
+            }
+            if (!repeated) {
+                numNew++;
+            }
+        }
+        if (srv->periodicCount + numNew > UDS_SERVER_0x2A_MAX_PDIDS) {
+            return NegativeResponse(r, UDS_NRC_RequestOutOfRange);
+        }
+
+        for (size_t i = 0; i < numPdids; i++) {
+            int idx = FindPeriodic(srv, ta, pdids[i]);
+            if (idx < 0) {
+                idx = srv->periodicCount++;
+            }
+            srv->periodic[idx] = (UDSPeriodicDID_t){
+                .pdid = pdids[i],
+                .mode = mode,
+                .timer = srv->now,
+                .ta = ta,
+            };
+        }
+        break;
+    }
+    case UDS_LEV_TM_SS:
+        if (0 == numPdids) {
+            StopPeriodic(srv, ta);
+        }
+        for (size_t i = 0; i < numPdids; i++) {
+            int idx = FindPeriodic(srv, ta, pdids[i]);
+            if (idx >= 0) {
+                RemovePeriodic(srv, idx);
+            }
+        }
+        break;
+    default:
+        return NegativeResponse(r, UDS_NRC_RequestOutOfRange);
+    }
+
+    r->send_buf[0] = UDS_RESPONSE_SID_OF(kSID_READ_PERIODIC_DATA_BY_IDENTIFIER);
+    r->send_len = UDS_0X2A_RESP_LEN;
+    return UDS_PositiveResponse;
+}
+#endif
+
+#if UDS_SERVER_ENABLE_0x2C
+/**
+ * @brief Validate a source element and add it to the copy plan of a dynamic DID
+ */
+static UDSErr_t DDDIAppend(UDSServer_t *srv, const UDSReq_t *r, UDSDDDIDefinition_t *def,
+                           const UDSDDDIElement_t *el) {
+    if (def->count >= UDS_SERVER_0x2C_MAX_ELEMENTS || 0 == el->size) {
+        return UDS_NRC_RequestOutOfRange;
+    }
+
+    // the data record must fit a 0x22 response: SID, dynamicDataId, data
+    size_t total = el->size;
+    for (uint8_t i = 0; i < def->count; i++) {
+        total += def->elements[i].size;
+    }
+    if (total + 3 > r->send_buf_size) {
+        return UDS_NRC_RequestOutOfRange;
+    }
+
+    if (0x01 == el->type) {
+        const UDSDIDEntry_t *entry = FindDID(srv, el->sourceDataId);
+        if (entry) {
+            UDSErr_t err = DIDAccess(srv, entry, UDS_DID_READ);
+            if (UDS_PositiveResponse != err) {
+                return err;
+            }
+            if ((size_t)el->offset + el->size > entry->len) {
+                return UDS_NRC_RequestOutOfRange;
+            }
+        }
+    } else {
+        // a memory source obeys the same regions as 0x23
+        const UDSMemRegion_t *region = NULL;
+        UDSErr_t err = FindMemRegion(srv, (uintptr_t)el->memAddr, el->size, UDS_MEM_READ, &region);
+        if (UDS_PositiveResponse != err) {
+            return err;
+        }
+    }
+
+    def->elements[def->count++] = *el;
+    return UDS_PositiveResponse;
+}
 
 static UDSErr_t Handle_0x2C_DynamicDefineDataIdentifier(UDSServer_t *srv, UDSReq_t *r) {
     UDSErr_t ret = UDS_PositiveResponse;
@@ -709,6 +1761,25 @@ static UDSErr_t Handle_0x2C_DynamicDefineDataIdentifier(UDSServer_t *srv, UDSReq
             (uint16_t)((uint16_t)r->recv_buf[2] << 8 | (uint16_t)r->recv_buf[3]) & 0xFFFF,
     };
 
+    /* Definitions are appended to the copy plan of dynamicDataId. A new dynamicDataId takes the
+     * next free slot, which is only claimed once the whole request has been accepted. */
+    UDSDDDIDefinition_t *def = NULL;
+    bool isNew = false;
+    uint8_t countBefore = 0;
+    if (0x01 == type || 0x02 == type) {
+        def = FindDDDI(srv, args.dynamicDataId);
+        if (NULL == def) {
+            if (srv->dddiCount >= UDS_SERVER_0x2C_MAX_DIDS) {
+                return NegativeResponse(r, UDS_NRC_RequestOutOfRange);
+            }
+            def = &srv->dddi[srv->dddiCount];
+            def->did = args.dynamicDataId;
+            def->count = 0;
+            isNew = true;
+        }
+        countBefore = def->count;
+    }
+
     /* Since the paramter for subFunc 0x01 and 0x02 are dynamic and should not be handled by
      * separate events, we need to emit the event for every subfunction separatedly
      */
@@ -732,12 +1803,28 @@ static UDSErr_t Handle_0x2C_DynamicDefineDataIdentifier(UDSServer_t *srv, UDSReq
 
             ret = EmitEvent(srv, UDS_EVT_DynamicDefineDataId, &args);
 
+            if (UDS_PositiveResponse == ret) {
+                /* positionInSourceDataRecord is 1-based */
+                if (0 == args.subFuncArgs.defineById.position) {
+                    ret = UDS_NRC_RequestOutOfRange;
+                } else {
+                    UDSDDDIElement_t el = {
+                        .type = type,
+                        .sourceDataId = args.subFuncArgs.defineById.sourceDataId,
+                        .offset = (uint16_t)(args.subFuncArgs.defineById.position - 1),
+                        .size = args.subFuncArgs.defineById.size,
+                    };
+                    ret = DDDIAppend(srv, r, def, &el);
+                }
+            }
+
             if (UDS_PositiveResponse != ret) {
+                def->count = countBefore;
                 return NegativeResponse(r, ret);
             }
         }
 
-        return UDS_PositiveResponse;
+        break;
     }
     case 0x02: /* defineByMemoryAddress */
     {
@@ -771,18 +1858,30 @@ static UDSErr_t Handle_0x2C_DynamicDefineDataIdentifier(UDSServer_t *srv, UDSReq
                                                    &args.subFuncArgs.defineByMemAddress.memAddr,
                                                    &args.subFuncArgs.defineByMemAddress.memSize, i);
 
-            if (UDS_PositiveResponse != ret) {
-                return NegativeResponse(r, ret);
+            if (UDS_PositiveResponse == ret) {
+                ret = EmitEvent(srv, UDS_EVT_DynamicDefineDataId, &args);
             }
 
-            ret = EmitEvent(srv, UDS_EVT_DynamicDefineDataId, &args);
+            if (UDS_PositiveResponse == ret) {
+                if (args.subFuncArgs.defineByMemAddress.memSize > UINT16_MAX) {
+                    ret = UDS_NRC_RequestOutOfRange;
+                } else {
+                    UDSDDDIElement_t el = {
+                        .type = type,
+                        .size = (uint16_t)args.subFuncArgs.defineByMemAddress.memSize,
+                        .memAddr = args.subFuncArgs.defineByMemAddress.memAddr,
+                    };
+                    ret = DDDIAppend(srv, r, def, &el);
+                }
+            }
 
             if (UDS_PositiveResponse != ret) {
+                def->count = countBefore;
                 return NegativeResponse(r, ret);
             }
         }
 
-        return UDS_PositiveResponse;
+        break;
     }
 
     case 0x03: /* clearDynamicallyDefined */
@@ -797,14 +1896,30 @@ static UDSErr_t Handle_0x2C_DynamicDefineDataIdentifier(UDSServer_t *srv, UDSReq
             return NegativeResponse(r, ret);
         }
 
+        if (args.allDataIds) {
+            srv->dddiCount = 0;
+        } else {
+            UDSDDDIDefinition_t *found = FindDDDI(srv, args.dynamicDataId);
+            if (found) {
+                *found = srv->dddi[--srv->dddiCount];
+            }
+        }
+
         return UDS_PositiveResponse;
     }
     default:
         UDS_LOGW(__FILE__, "Unsupported DDDI subFunc 0x%02X\n", type);
         return NegativeResponse(r, UDS_NRC_SubFunctionNotSupported);
     }
+
+    if (isNew) {
+        srv->dddiCount++;
+    }
+    return UDS_PositiveResponse;
 }
+#endif
 
+#if UDS_SERVER_ENABLE_0x2E
 static UDSErr_t Handle_0x2E_WriteDataByIdentifier(UDSServer_t *srv, UDSReq_t *r) {
     uint16_t dataLen = 0;
     uint16_t dataId = 0;
@@ -818,16 +1933,35 @@ static UDSErr_t Handle_0x2E_WriteDataByIdentifier(UDSServer_t *srv, UDSReq_t *r)
     dataId = (uint16_t)((uint16_t)(r->recv_buf[1] << 8) | (uint16_t)r->recv_buf[2]);
     dataLen = (uint16_t)(r->recv_len - UDS_0X2E_REQ_BASE_LEN);
 
-    UDSWDBIArgs_t args = {
-        .dataId = dataId,
-        .data = &r->recv_buf[UDS_0X2E_REQ_BASE_LEN],
-        .len = dataLen,
-    };
+    const UDSDIDEntry_t *entry = FindDID(srv, dataId);
+    err = entry ? DIDAccess(srv, entry, UDS_DID_WRITE) : UDS_PositiveResponse;
+    if (UDS_PositiveResponse != err) {
+        return NegativeResponse(r, err);
+    }
+
+    if (entry && (entry->write || entry->ptr)) {
+        if (dataLen != entry->len) {
+            return NegativeResponse(r, UDS_NRC_IncorrectMessageLengthOrInvalidFormat);
+        }
+        if (entry->write) {
+            err = entry->write(srv, entry, &r->recv_buf[UDS_0X2E_REQ_BASE_LEN], dataLen);
+        } else {
+            memcpy(entry->ptr, &r->recv_buf[UDS_0X2E_REQ_BASE_LEN], dataLen);
+        }
+    } else {
+        UDSWDBIArgs_t args = {
+            .dataId = dataId,
+            .data = &r->recv_buf[UDS_0X2E_REQ_BASE_LEN],
+            .len = dataLen,
+        };
+
+        err = EmitEvent(srv, UDS_EVT_WriteDataByIdent, &args);
+    }
 
-    err = EmitEvent(srv, UDS_EVT_WriteDataByIdent, &args);
     if (UDS_PositiveResponse != err) {
         return NegativeResponse(r, err);
     }
+    UDSServerInvalidateDID(srv, dataId);
 
     r->send_buf[0] = UDS_RESPONSE_SID_OF(kSID_WRITE_DATA_BY_IDENTIFIER);
     r->send_buf[1] = dataId >> 8;
@@ -835,7 +1969,9 @@ static UDSErr_t Handle_0x2E_WriteDataByIdentifier(UDSServer_t *srv, UDSReq_t *r)
     r->send_len = UDS_0X2E_RESP_LEN;
     return UDS_PositiveResponse;
 }
+#endif
 
+#if UDS_SERVER_ENABLE_0x2F
 static UDSErr_t Handle_0x2F_IOControlByIdentifier(UDSServer_t *srv, UDSReq_t *r) {
     if (r->recv_len < UDS_0X2F_REQ_MIN_LEN) {
         return NegativeResponse(r, UDS_NRC_IncorrectMessageLengthOrInvalidFormat);
@@ -853,6 +1989,8 @@ static UDSErr_t Handle_0x2F_IOControlByIdentifier(UDSServer_t *srv, UDSReq_t *r)
         .ctrlStateAndMask = &r->recv_buf[UDS_0X2F_REQ_MIN_LEN],
         .ctrlStateAndMaskLen = r->recv_len - UDS_0X2F_REQ_MIN_LEN,
         .copy = safe_copy,
+        .reserve = safe_reserve,
+        .commit = safe_commit,
     };
 
     UDSErr_t err = EmitEvent(srv, UDS_EVT_IOControl, &args);
@@ -863,9 +2001,47 @@ static UDSErr_t Handle_0x2F_IOControlByIdentifier(UDSServer_t *srv, UDSReq_t *r)
 
     return UDS_PositiveResponse;
 }
+#endif
+
+#if UDS_SERVER_ENABLE_0x31
+/**
+ * @brief Binary search the registered routine table
+ * @return the matching entry or NULL
+ */
+static const UDSRoutineEntry_t *FindRoutine(const UDSServer_t *srv, uint16_t rid) {
+    size_t lo = 0;
+    size_t hi = srv->routineTableLen;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const UDSRoutineEntry_t *entry = &srv->routineTable[mid];
+        if (entry->rid == rid) {
+            return entry;
+        } else if (entry->rid < rid) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return NULL;
+}
+
+static UDSErr_t RoutineAccess(const UDSServer_t *srv, const UDSRoutineEntry_t *entry,
+                              uint8_t routineControlType) {
+    if (0 == (entry->ctrl & (1U << routineControlType))) {
+        return UDS_NRC_SubFunctionNotSupported;
+    }
+    if (!SessionInMask(entry->sessionMask, srv->sessionType)) {
+        return UDS_NRC_RequestOutOfRange;
+    }
+    if (entry->securityLevel && entry->securityLevel != srv->securityLevel) {
+        return UDS_NRC_SecurityAccessDenied;
+    }
+    return UDS_PositiveResponse;
+}
 
 static UDSErr_t Handle_0x31_RoutineControl(UDSServer_t *srv, UDSReq_t *r) {
     UDSErr_t err = UDS_PositiveResponse;
+    const UDSRoutineEntry_t *entry = NULL;
     if (r->recv_len < UDS_0X31_REQ_MIN_LEN) {
         return NegativeResponse(r, UDS_NRC_IncorrectMessageLengthOrInvalidFormat);
     }
@@ -880,6 +2056,10 @@ static UDSErr_t Handle_0x31_RoutineControl(UDSServer_t *srv, UDSReq_t *r) {
         .optionRecord = &r->recv_buf[UDS_0X31_REQ_MIN_LEN],
         .len = (uint16_t)(r->recv_len - UDS_0X31_REQ_MIN_LEN),
         .copyStatusRecord = safe_copy,
+        .reserve = safe_reserve,
+        .commit = safe_commit,
+        .xferCrc = srv->xferLastCrc,
+        .xferByteCount = srv->xferLastByteCount,
     };
 
     r->send_buf[0] = UDS_RESPONSE_SID_OF(kSID_ROUTINE_CONTROL);
@@ -892,7 +2072,12 @@ static UDSErr_t Handle_0x31_RoutineControl(UDSServer_t *srv, UDSReq_t *r) {
     case UDS_LEV_RCTP_STR:  // start routine
     case UDS_LEV_RCTP_STPR: // stop routine
     case UDS_LEV_RCTP_RRR:  // request routine results
-        err = EmitEvent(srv, UDS_EVT_RoutineCtrl, &args);
+        entry = FindRoutine(srv, routineIdentifier);
+        err = entry ? RoutineAccess(srv, entry, routineControlType) : UDS_PositiveResponse;
+        if (UDS_PositiveResponse == err) {
+            err = (entry && entry->fn) ? entry->fn(srv, entry, &args)
+                                       : EmitEvent(srv, UDS_EVT_RoutineCtrl, &args);
+        }
         if (UDS_PositiveResponse != err) {
             return NegativeResponse(r, err);
         }
@@ -902,15 +2087,36 @@ static UDSErr_t Handle_0x31_RoutineControl(UDSServer_t *srv, UDSReq_t *r) {
     }
     return UDS_PositiveResponse;
 }
+#endif
 
+#if UDS_SERVER_ENABLE_0x34 || UDS_SERVER_ENABLE_0x35 || UDS_SERVER_ENABLE_0x36 || \
+    UDS_SERVER_ENABLE_0x37 || UDS_SERVER_ENABLE_0x38
 static void ResetTransfer(UDSServer_t *srv) {
     UDS_ASSERT(srv);
     srv->xferBlockSequenceCounter = 1;
     srv->xferByteCounter = 0;
     srv->xferTotalBytes = 0;
+    srv->xferCrc = 0;
     srv->xferIsActive = false;
+#if UDS_SERVER_0x36_PIPELINE_DEPTH > 0
+    if (srv->xferIsPipelined) {
+        // blocks that have not been written yet are discarded
+        srv->xferPipeCount = 0;
+        srv->xferPipeErr = UDS_PositiveResponse;
+        srv->xferPipeActive = false;
+    }
+#endif
+    srv->xferIsPipelined = false;
+#if UDS_SERVER_0x36_DECOMPRESS
+    if (srv->xferIsCompressed) {
+        srv->xferLzActive = false;
+    }
+#endif
+    srv->xferIsCompressed = false;
 }
+#endif
 
+#if UDS_SERVER_ENABLE_0x34
 static UDSErr_t Handle_0x34_RequestDownload(UDSServer_t *srv, UDSReq_t *r) {
     UDSErr_t err = UDS_PositiveResponse;
     void *memoryAddress = 0;
@@ -929,6 +2135,14 @@ static UDSErr_t Handle_0x34_RequestDownload(UDSServer_t *srv, UDSReq_t *r) {
         return NegativeResponse(r, err);
     }
 
+#if UDS_SERVER_0x36_DECOMPRESS
+    bool compressed = UDS_LZ_COMPRESSION_METHOD == (r->recv_buf[1] >> 4);
+    if (compressed && srv->xferLzActive) {
+        // the decoder serves one download at a time
+        return NegativeResponse(r, UDS_NRC_BusyRepeatRequest);
+    }
+#endif
+
     UDSRequestDownloadArgs_t args = {
         .addr = memoryAddress,
         .size = memorySize,
@@ -947,10 +2161,41 @@ static UDSErr_t Handle_0x34_RequestDownload(UDSServer_t *srv, UDSReq_t *r) {
         return NegativeResponse(r, err);
     }
 
+#if UDS_SERVER_0x36_PIPELINE_DEPTH > 0
+    // the pipeline serves one download at a time. Other testers fall back to UDS_EVT_TransferData
+    bool pipelined = NULL != srv->xferWrite && !srv->xferPipeActive;
+#if UDS_SERVER_0x36_DECOMPRESS
+    // decompressed data is passed to UDS_EVT_TransferData
+    pipelined = pipelined && !compressed;
+#endif
+    if (pipelined &&
+        args.maxNumberOfBlockLength > UDS_SERVER_0x36_PIPELINE_BLOCK_SIZE + UDS_0X36_REQ_BASE_LEN) {
+        args.maxNumberOfBlockLength = UDS_SERVER_0x36_PIPELINE_BLOCK_SIZE + UDS_0X36_REQ_BASE_LEN;
+    }
+#endif
+
     ResetTransfer(srv);
     srv->xferIsActive = true;
     srv->xferTotalBytes = memorySize;
     srv->xferBlockLength = args.maxNumberOfBlockLength;
+#if UDS_SERVER_0x36_PIPELINE_DEPTH > 0
+    if (pipelined) {
+        srv->xferIsPipelined = true;
+        srv->xferPipeActive = true;
+        srv->xferPipeAddr = memoryAddress;
+        srv->xferPipeHead = 0;
+        srv->xferPipeCount = 0;
+        srv->xferPipeErr = UDS_PositiveResponse;
+    }
+#endif
+#if UDS_SERVER_0x36_DECOMPRESS
+    if (compressed) {
+        srv->xferIsCompressed = true;
+        srv->xferLzActive = true;
+        srv->xferLzInPos = 0;
+        UDSLZDecoderInit(&srv->xferLz);
+    }
+#endif
 
     // ISO-14229-1:2013 Table 401:
     uint8_t lengthFormatIdentifier = (uint8_t)(sizeof(args.maxNumberOfBlockLength) << 4);
@@ -962,9 +2207,11 @@ static UDSErr_t Handle_0x34_RequestDownload(UDSServer_t *srv, UDSReq_t *r) {
     complete message length, including the service identifier and the
     data-parameters present in the TransferData request message.
     */
+#if UDS_TP_MTU < 0xFFFF
     if (args.maxNumberOfBlockLength > UDS_TP_MTU) {
         args.maxNumberOfBlockLength = UDS_TP_MTU;
     }
+#endif
 
     r->send_buf[0] = UDS_RESPONSE_SID_OF(kSID_REQUEST_DOWNLOAD);
     r->send_buf[1] = lengthFormatIdentifier;
@@ -976,7 +2223,9 @@ static UDSErr_t Handle_0x34_RequestDownload(UDSServer_t *srv, UDSReq_t *r) {
     r->send_len = UDS_0X34_RESP_BASE_LEN + (size_t)sizeof(args.maxNumberOfBlockLength);
     return UDS_PositiveResponse;
 }
+#endif
 
+#if UDS_SERVER_ENABLE_0x35
 static UDSErr_t Handle_0x35_RequestUpload(UDSServer_t *srv, UDSReq_t *r) {
     UDSErr_t err = UDS_PositiveResponse;
     void *memoryAddress = 0;
@@ -1030,6 +2279,89 @@ static UDSErr_t Handle_0x35_RequestUpload(UDSServer_t *srv, UDSReq_t *r) {
     r->send_len = UDS_0X35_RESP_BASE_LEN + (size_t)sizeof(args.maxNumberOfBlockLength);
     return UDS_PositiveResponse;
 }
+#endif
+
+#if UDS_SERVER_ENABLE_0x36
+/**
+ * @brief Count `len` accepted bytes, feed them to the CRC and digest, and, with `withCheckpoints`,
+ * emit UDS_EVT_TransferCheckpoint whenever another xferCheckpointInterval bytes have been accepted
+ * or the download is complete
+ */
+static void TransferAdvance(UDSServer_t *srv, const uint8_t *data, uint16_t len,
+                            bool withCheckpoints) {
+    size_t interval = withCheckpoints ? srv->xferCheckpointInterval : 0;
+    size_t before = srv->xferByteCounter;
+    srv->xferByteCounter += len;
+    if (srv->xferDigestUpdate) {
+        srv->xferDigestUpdate(srv, data, len);
+    }
+    if (UDS_SERVER_XFER_CRC || interval > 0) {
+        srv->xferCrc = srv->xferCrcUpdate ? srv->xferCrcUpdate(srv, srv->xferCrc, data, len)
+                                          : UDSCRC32(srv->xferCrc, data, len);
+    }
+    if (0 == interval) {
+        return;
+    }
+    if (before / interval != srv->xferByteCounter / interval ||
+        srv->xferByteCounter == srv->xferTotalBytes) {
+        UDSXferCheckpoint_t checkpoint = {
+            .byteCounter = srv->xferByteCounter,
+            .blockSequenceCounter = (uint8_t)(srv->xferBlockSequenceCounter - 1),
+            .crc = srv->xferCrc,
+        };
+        // checkpoints are advisory: a failure to persist one must not abort the download
+        (void)EmitEvent(srv, UDS_EVT_TransferCheckpoint, &checkpoint);
+    }
+}
+
+#if UDS_SERVER_0x36_DECOMPRESS
+/**
+ * @brief Decode a block of a compressed download and pass the output to UDS_EVT_TransferData, one
+ * window at a time. If the callback returns 0x78 the decoded bytes stay in the window and decoding
+ * resumes from xferLzInPos when the request is evaluated again.
+ */
+static UDSErr_t TransferDataDecompress(UDSServer_t *srv, UDSReq_t *r) {
+    UDSLZDecoder_t *dec = &srv->xferLz;
+    const uint8_t *in = &r->recv_buf[UDS_0X36_REQ_BASE_LEN];
+    size_t len = r->recv_len - UDS_0X36_REQ_BASE_LEN;
+
+    for (;;) {
+        const uint8_t *data = NULL;
+        uint16_t n = UDSLZDecoderOutput(dec, &data);
+        if (n > 0) {
+            if (srv->xferByteCounter + n > srv->xferTotalBytes) {
+                return UDS_NRC_TransferDataSuspended;
+            }
+            UDSTransferDataArgs_t args = {
+                .data = data,
+                .len = n,
+                .maxRespLen = (uint16_t)(srv->xferBlockLength - UDS_0X36_RESP_BASE_LEN),
+                .copyResponse = safe_copy,
+                .reserve = safe_reserve,
+                .commit = safe_commit,
+            };
+            UDSErr_t err = EmitEvent(srv, UDS_EVT_TransferData, &args);
+            if (UDS_PositiveResponse != err) {
+                return err;
+            }
+            TransferAdvance(srv, data, n, false);
+            UDSLZDecoderRelease(dec);
+        }
+
+        if (srv->xferLzInPos >= len && 0 == dec->matchLen) {
+            break;
+        }
+        size_t consumed = 0;
+        if (UDS_OK != UDSLZDecode(dec, &in[srv->xferLzInPos], len - srv->xferLzInPos, &consumed)) {
+            UDS_LOGE(__FILE__, "corrupt compressed data at %zu", srv->xferByteCounter);
+            return UDS_NRC_RequestOutOfRange;
+        }
+        srv->xferLzInPos += consumed;
+    }
+    srv->xferLzInPos = 0;
+    return UDS_PositiveResponse;
+}
+#endif
 
 static UDSErr_t Handle_0x36_TransferData(UDSServer_t *srv, UDSReq_t *r) {
     UDSErr_t err = UDS_PositiveResponse;
@@ -1056,17 +2388,67 @@ static UDSErr_t Handle_0x36_TransferData(UDSServer_t *srv, UDSReq_t *r) {
         }
     }
 
+#if UDS_SERVER_0x36_DECOMPRESS
+    if (srv->xferIsCompressed) {
+        r->send_buf[0] = UDS_RESPONSE_SID_OF(kSID_TRANSFER_DATA);
+        r->send_buf[1] = blockSequenceCounter;
+        r->send_len = UDS_0X36_RESP_BASE_LEN;
+
+        err = TransferDataDecompress(srv, r);
+        if (err == UDS_PositiveResponse) {
+            return UDS_PositiveResponse;
+        } else if (err == UDS_NRC_RequestCorrectlyReceived_ResponsePending) {
+            return NegativeResponse(r, UDS_NRC_RequestCorrectlyReceived_ResponsePending);
+        } else {
+            goto fail;
+        }
+    }
+#endif
+
     if (srv->xferByteCounter + request_data_len > srv->xferTotalBytes) {
         err = UDS_NRC_TransferDataSuspended;
         goto fail;
     }
 
+#if UDS_SERVER_0x36_PIPELINE_DEPTH > 0
+    if (srv->xferIsPipelined) {
+        if (UDS_PositiveResponse != srv->xferPipeErr) {
+            err = srv->xferPipeErr;
+            goto fail;
+        }
+        if (request_data_len > UDS_SERVER_0x36_PIPELINE_BLOCK_SIZE) {
+            err = UDS_NRC_RequestOutOfRange;
+            goto fail;
+        }
+        if (srv->xferPipeCount >= UDS_SERVER_0x36_PIPELINE_DEPTH) {
+            // back-pressure: hold the tester off until the sink frees a buffer
+            return NegativeResponse(r, UDS_NRC_RequestCorrectlyReceived_ResponsePending);
+        }
+
+        uint8_t idx =
+            (uint8_t)((srv->xferPipeHead + srv->xferPipeCount) % UDS_SERVER_0x36_PIPELINE_DEPTH);
+        UDSXferBlock_t *blk = &srv->xferPipe[idx];
+        blk->offset = srv->xferByteCounter;
+        blk->len = request_data_len;
+        memcpy(blk->data, &r->recv_buf[UDS_0X36_REQ_BASE_LEN], request_data_len);
+        srv->xferPipeCount++;
+        TransferAdvance(srv, blk->data, request_data_len, false);
+
+        r->send_buf[0] = UDS_RESPONSE_SID_OF(kSID_TRANSFER_DATA);
+        r->send_buf[1] = blockSequenceCounter;
+        r->send_len = UDS_0X36_RESP_BASE_LEN;
+        return UDS_PositiveResponse;
+    }
+#endif
+
     {
         UDSTransferDataArgs_t args = {
             .data = &r->recv_buf[UDS_0X36_REQ_BASE_LEN],
             .len = (uint16_t)(r->recv_len - UDS_0X36_REQ_BASE_LEN),
             .maxRespLen = (uint16_t)(srv->xferBlockLength - UDS_0X36_RESP_BASE_LEN),
             .copyResponse = safe_copy,
+            .reserve = safe_reserve,
+            .commit = safe_commit,
         };
 
         r->send_buf[0] = UDS_RESPONSE_SID_OF(kSID_TRANSFER_DATA);
@@ -1076,7 +2458,7 @@ static UDSErr_t Handle_0x36_TransferData(UDSServer_t *srv, UDSReq_t *r) {
         err = EmitEvent(srv, UDS_EVT_TransferData, &args);
 
         if (err == UDS_PositiveResponse) {
-            srv->xferByteCounter += request_data_len;
+            TransferAdvance(srv, args.data, request_data_len, true);
             return UDS_PositiveResponse;
         } else if (err == UDS_NRC_RequestCorrectlyReceived_ResponsePending) {
             return NegativeResponse(r, UDS_NRC_RequestCorrectlyReceived_ResponsePending);
@@ -1089,7 +2471,9 @@ fail:
     ResetTransfer(srv);
     return NegativeResponse(r, err);
 }
+#endif
 
+#if UDS_SERVER_ENABLE_0x37
 static UDSErr_t Handle_0x37_RequestTransferExit(UDSServer_t *srv, UDSReq_t *r) {
     UDSErr_t err = UDS_PositiveResponse;
 
@@ -1100,15 +2484,35 @@ static UDSErr_t Handle_0x37_RequestTransferExit(UDSServer_t *srv, UDSReq_t *r) {
     r->send_buf[0] = UDS_RESPONSE_SID_OF(kSID_REQUEST_TRANSFER_EXIT);
     r->send_len = UDS_0X37_RESP_BASE_LEN;
 
+#if UDS_SERVER_0x36_PIPELINE_DEPTH > 0
+    if (srv->xferIsPipelined) {
+        if (UDS_PositiveResponse != srv->xferPipeErr) {
+            err = srv->xferPipeErr;
+            ResetTransfer(srv);
+            return NegativeResponse(r, err);
+        }
+        if (srv->xferPipeCount > 0) {
+            // the exit response confirms that every block has reached the sink
+            return NegativeResponse(r, UDS_NRC_RequestCorrectlyReceived_ResponsePending);
+        }
+    }
+#endif
+
     UDSRequestTransferExitArgs_t args = {
         .data = &r->recv_buf[UDS_0X37_REQ_BASE_LEN],
         .len = (uint16_t)(r->recv_len - UDS_0X37_REQ_BASE_LEN),
         .copyResponse = safe_copy,
+        .reserve = safe_reserve,
+        .commit = safe_commit,
+        .crc = srv->xferCrc,
+        .byteCount = srv->xferByteCounter,
     };
 
     err = EmitEvent(srv, UDS_EVT_RequestTransferExit, &args);
 
     if (err == UDS_PositiveResponse) {
+        srv->xferLastCrc = srv->xferCrc;
+        srv->xferLastByteCount = srv->xferByteCounter;
         ResetTransfer(srv);
         return UDS_PositiveResponse;
     } else if (err == UDS_NRC_RequestCorrectlyReceived_ResponsePending) {
@@ -1118,7 +2522,9 @@ static UDSErr_t Handle_0x37_RequestTransferExit(UDSServer_t *srv, UDSReq_t *r) {
         return NegativeResponse(r, err);
     }
 }
+#endif
 
+#if UDS_SERVER_ENABLE_0x38
 static UDSErr_t Handle_0x38_RequestFileTransfer(UDSServer_t *srv, UDSReq_t *r) {
     UDSErr_t err = UDS_PositiveResponse;
 
@@ -1130,7 +2536,7 @@ static UDSErr_t Handle_0x38_RequestFileTransfer(UDSServer_t *srv, UDSReq_t *r) {
     }
 
     uint8_t mode_of_operation = r->recv_buf[1];
-    if (mode_of_operation < UDS_MOOP_ADDFILE || mode_of_operation > UDS_MOOP_RDFILE) {
+    if (mode_of_operation < UDS_MOOP_ADDFILE || mode_of_operation > UDS_MOOP_RSFILE) {
         return NegativeResponse(r, UDS_NRC_IncorrectMessageLengthOrInvalidFormat);
     }
     uint16_t file_path_len = (uint16_t)(((uint16_t)r->recv_buf[2] << 8) + (uint16_t)r->recv_buf[3]);
@@ -1204,14 +2610,28 @@ static UDSErr_t Handle_0x38_RequestFileTransfer(UDSServer_t *srv, UDSReq_t *r) {
         return NegativeResponse(r, err);
     }
 
+    if (UDS_MOOP_RSFILE == mode_of_operation &&
+        args.checkpoint.byteCounter > args.fileSizeCompressed) {
+        UDS_LOGE(__FILE__, "resume position %zu is past the end of the file",
+                 args.checkpoint.byteCounter);
+        return NegativeResponse(r, UDS_NRC_RequestOutOfRange);
+    }
+
     ResetTransfer(srv);
     srv->xferIsActive = true;
     srv->xferTotalBytes = args.fileSizeCompressed;
     srv->xferBlockLength = args.maxNumberOfBlockLength;
+    if (UDS_MOOP_RSFILE == mode_of_operation) {
+        // the block sequence counter restarts at 0x01, only the byte position is restored
+        srv->xferByteCounter = args.checkpoint.byteCounter;
+        srv->xferCrc = args.checkpoint.crc;
+    }
 
+#if UDS_TP_MTU < 0xFFFF
     if (args.maxNumberOfBlockLength > UDS_TP_MTU) {
         args.maxNumberOfBlockLength = UDS_TP_MTU;
     }
+#endif
 
     r->send_buf[0] = UDS_RESPONSE_SID_OF(kSID_REQUEST_FILE_TRANSFER);
     r->send_buf[1] = args.modeOfOperation;
@@ -1225,9 +2645,20 @@ static UDSErr_t Handle_0x38_RequestFileTransfer(UDSServer_t *srv, UDSReq_t *r) {
         args.dataFormatIdentifier;
 
     r->send_len = UDS_0X38_RESP_BASE_LEN + (size_t)sizeof(args.maxNumberOfBlockLength) + 1;
+
+    if (UDS_MOOP_RSFILE == mode_of_operation) {
+        // ISO14229:2020 Table 483: filePosition is always 8 bytes
+        for (uint8_t idx = 0; idx < 8; idx++) {
+            r->send_buf[r->send_len + idx] =
+                (uint8_t)((uint64_t)srv->xferByteCounter >> (8 * (7 - idx)));
+        }
+        r->send_len += 8;
+    }
     return UDS_PositiveResponse;
 }
+#endif
 
+#if UDS_SERVER_ENABLE_0x3D
 static UDSErr_t Handle_0x3D_WriteMemoryByAddress(UDSServer_t *srv, UDSReq_t *r) {
     UDSErr_t ret = UDS_PositiveResponse;
     void *address = 0;
@@ -1251,13 +2682,30 @@ static UDSErr_t Handle_0x3D_WriteMemoryByAddress(UDSServer_t *srv, UDSReq_t *r)
         return NegativeResponse(r, UDS_NRC_IncorrectMessageLengthOrInvalidFormat);
     }
 
-    UDSWriteMemByAddrArgs_t args = {
-        .memAddr = address,
-        .memSize = length,
-        .data = &r->recv_buf[dataOffset],
-    };
+    const UDSMemRegion_t *region = NULL;
+    ret = FindMemRegion(srv, (uintptr_t)address, length, UDS_MEM_WRITE, &region);
+    if (UDS_PositiveResponse != ret) {
+        return NegativeResponse(r, ret);
+    }
 
-    ret = EmitEvent(srv, UDS_EVT_WriteMemByAddr, &args);
+    if (region && TakeDeferredResult(r, UDS_EVT_WriteMemByAddr, (uintptr_t)address, &ret)) {
+        ; // the copy engine has finished
+    } else if (region && region->write) {
+        ret = region->write(srv, region, (uintptr_t)address, &r->recv_buf[dataOffset], length);
+    } else if (region) {
+        memcpy(address, &r->recv_buf[dataOffset], length);
+    } else {
+        UDSWriteMemByAddrArgs_t args = {
+            .memAddr = address,
+            .memSize = length,
+            .data = &r->recv_buf[dataOffset],
+        };
+        ret = EmitEvent(srv, UDS_EVT_WriteMemByAddr, &args);
+    }
+#if UDS_SERVER_RCRRP_QUEUE_LEN > 0
+    // the engine may still be reading the data out of recv_buf
+    r->recv_pinned = (UDS_NRC_RequestCorrectlyReceived_ResponsePending == ret);
+#endif
     if (UDS_PositiveResponse != ret) {
         return NegativeResponse(r, ret);
     }
@@ -1268,7 +2716,9 @@ static UDSErr_t Handle_0x3D_WriteMemoryByAddress(UDSServer_t *srv, UDSReq_t *r)
     r->send_len = UDS_0X3D_RESP_BASE_LEN + memorySizeLength + memoryAddressLength;
     return UDS_PositiveResponse;
 }
+#endif
 
+#if UDS_SERVER_ENABLE_0x3E
 static UDSErr_t Handle_0x3E_TesterPresent(UDSServer_t *srv, UDSReq_t *r) {
     if ((r->recv_len < UDS_0X3E_REQ_MIN_LEN) || (r->recv_len > UDS_0X3E_REQ_MAX_LEN)) {
         return NegativeResponse(r, UDS_NRC_IncorrectMessageLengthOrInvalidFormat);
@@ -1278,7 +2728,7 @@ static UDSErr_t Handle_0x3E_TesterPresent(UDSServer_t *srv, UDSReq_t *r) {
     switch (zeroSubFunction) {
     case 0x00:
     case 0x80:
-        srv->s3_session_timeout_timer = UDSMillis() + srv->s3_ms;
+        srv->s3_session_timeout_timer = srv->now + srv->s3_ms;
         r->send_buf[0] = UDS_RESPONSE_SID_OF(kSID_TESTER_PRESENT);
         r->send_buf[1] = 0x00;
         r->send_len = UDS_0X3E_RESP_LEN;
@@ -1287,32 +2737,555 @@ static UDSErr_t Handle_0x3E_TesterPresent(UDSServer_t *srv, UDSReq_t *r) {
         return NegativeResponse(r, UDS_NRC_SubFunctionNotSupported);
     }
 }
+#endif
+
+#if UDS_SERVER_ENABLE_0x83
+static void PutTimingRecord(uint8_t *dst, uint16_t p2_ms, uint32_t p2_star_ms) {
+    dst[0] = (uint8_t)(p2_ms >> 8);
+    dst[1] = (uint8_t)p2_ms;
+    dst[2] = (uint8_t)((p2_star_ms / 10) >> 8);
+    dst[3] = (uint8_t)(p2_star_ms / 10);
+}
 
-static UDSErr_t Handle_0x85_ControlDTCSetting(UDSServer_t *srv, UDSReq_t *r) {
-    (void)srv;
-    if (r->recv_len < UDS_0X85_REQ_BASE_LEN) {
-        return NegativeResponse(r, UDS_NRC_IncorrectMessageLengthOrInvalidFormat);
-    }
-
+/**
+ * @brief AccessTimingParameter. The timingParameterResponseRecord has the layout of the 0x10
+ * response: P2_server_max (1 ms) and P2*_server_max (10 ms). readExtendedTimingParameterSet
+ * returns the shortest and the longest values that may be set, in two such records.
+ */
+static UDSErr_t Handle_0x83_AccessTimingParameter(UDSServer_t *srv, UDSReq_t *r) {
     uint8_t type = r->recv_buf[1] & 0x7F;
+    uint16_t maxP2 = srv->atpActive ? srv->atpDefaultP2_ms : srv->p2_ms;
+    uint32_t maxP2Star = srv->atpActive ? srv->atpDefaultP2Star_ms : srv->p2_star_ms;
+    uint16_t p2 = maxP2;
+    uint32_t p2Star = maxP2Star;
 
-    UDSControlDTCSettingArgs_t args = {
-        .type = type,
-        .data = r->recv_len > UDS_0X85_REQ_BASE_LEN ? &r->recv_buf[UDS_0X85_REQ_BASE_LEN] : NULL,
-        .len = r->recv_len > UDS_0X85_REQ_BASE_LEN ? r->recv_len - UDS_0X85_REQ_BASE_LEN : 0,
-    };
+    r->send_buf[0] = UDS_RESPONSE_SID_OF(kSID_ACCESS_TIMING_PARAMETER);
+    r->send_buf[1] = type;
+    r->send_len = UDS_0X83_RESP_BASE_LEN;
 
-    int ret = EmitEvent(srv, UDS_EVT_ControlDTCSetting, &args);
-    if (UDS_PositiveResponse != ret) {
-        return NegativeResponse(r, ret);
-    }
+    switch (type) {
+    case UDS_LEV_ATP_RETPS:
+        if (r->recv_len != UDS_0X83_REQ_BASE_LEN) {
+            return NegativeResponse(r, UDS_NRC_IncorrectMessageLengthOrInvalidFormat);
+        }
+        PutTimingRecord(&r->send_buf[2], UDS_SERVER_0x83_MIN_P2_MS, UDS_SERVER_0x83_MIN_P2_STAR_MS);
+        PutTimingRecord(&r->send_buf[2 + UDS_0X83_TIMING_RECORD_LEN], maxP2, maxP2Star);
+        r->send_len += 2 * UDS_0X83_TIMING_RECORD_LEN;
+        return UDS_PositiveResponse;
+    case UDS_LEV_ATP_RCATP:
+        if (r->recv_len != UDS_0X83_REQ_BASE_LEN) {
+            return NegativeResponse(r, UDS_NRC_IncorrectMessageLengthOrInvalidFormat);
+        }
+        PutTimingRecord(&r->send_buf[2], srv->p2_ms, srv->p2_star_ms);
+        r->send_len += UDS_0X83_TIMING_RECORD_LEN;
+        return UDS_PositiveResponse;
+    case UDS_LEV_ATP_STPTDV:
+        if (r->recv_len != UDS_0X83_REQ_BASE_LEN) {
+            return NegativeResponse(r, UDS_NRC_IncorrectMessageLengthOrInvalidFormat);
+        }
+        break;
+    case UDS_LEV_ATP_STPTGV:
+        if (r->recv_len != UDS_0X83_REQ_BASE_LEN + UDS_0X83_TIMING_RECORD_LEN) {
+            return NegativeResponse(r, UDS_NRC_IncorrectMessageLengthOrInvalidFormat);
+        }
+        p2 = (uint16_t)((r->recv_buf[2] << 8) | r->recv_buf[3]);
+        p2Star = (uint32_t)((r->recv_buf[4] << 8) | r->recv_buf[5]) * 10;
+        if (p2 < UDS_SERVER_0x83_MIN_P2_MS || p2 > maxP2 ||
+            p2Star < UDS_SERVER_0x83_MIN_P2_STAR_MS || p2Star > maxP2Star || p2Star <= p2) {
+            return NegativeResponse(r, UDS_NRC_RequestOutOfRange);
+        }
+        break;
+    default:
+        return NegativeResponse(r, UDS_NRC_SubFunctionNotSupported);
+    }
+
+    UDSAccessTimingArgs_t args = {
+        .type = type,
+        .p2_ms = p2,
+        .p2_star_ms = p2Star,
+    };
+    UDSErr_t err = EmitEvent(srv, UDS_EVT_AccessTimingParam, &args);
+    if (UDS_PositiveResponse != err) {
+        return NegativeResponse(r, err);
+    }
+    if (!srv->atpActive) {
+        srv->atpDefaultP2_ms = srv->p2_ms;
+        srv->atpDefaultP2Star_ms = srv->p2_star_ms;
+    }
+    srv->atpActive = UDS_LEV_ATP_STPTGV == type;
+    srv->p2_ms = p2;
+    srv->p2_star_ms = p2Star;
+    return UDS_PositiveResponse;
+}
+#endif
+
+#if UDS_SERVER_ENABLE_0x84
+static UDSErr_t evaluateServiceResponse(UDSServer_t *srv, UDSReq_t *r);
+
+static void SecuredHeader(const uint8_t *buf, UDSSecuredHeader_t *hdr) {
+    hdr->administrativeParameter = (uint16_t)((buf[1] << 8) | buf[2]);
+    hdr->signatureEncryptionCalculation = buf[3];
+    hdr->signatureLength = (uint16_t)((buf[4] << 8) | buf[5]);
+    hdr->antiReplayCounter = (uint16_t)((buf[6] << 8) | buf[7]);
+}
+
+/**
+ * @brief Check the signature of a 0x84 request and decrypt its internal request where it is, so
+ * that it can be dispatched without another copy. A request lent by the transport is decrypted
+ * into the request context instead.
+ * @param len length of the internal request
+ */
+static UDSErr_t SecuredUnwrap(UDSServer_t *srv, UDSReq_t *r, const UDSSecuredHeader_t *hdr,
+                              uint16_t len) {
+    const uint8_t *in = &r->recv_buf[UDS_0X84_HEADER_LEN];
+    uint8_t *dst = NULL;
+    uint8_t *out = NULL;
+    if (hdr->administrativeParameter & UDS_SDT_AP_ENCRYPTED) {
+        if (r->recv_borrowed) {
+            if (r->recv_len > REQ_MAX_LEN) {
+                return UDS_NRC_ConditionsNotCorrect;
+            }
+            dst = RequestSlot(r, r->recv_len);
+            memcpy(dst, r->recv_buf, UDS_0X84_HEADER_LEN);
+            out = &dst[UDS_0X84_HEADER_LEN];
+        } else {
+            out = (uint8_t *)in; // the request context's own storage
+        }
+    }
+    UDSErr_t err = srv->secured->unwrap(srv->secured->ctx, hdr, in, out, len, &in[len]);
+    if (UDS_PositiveResponse == err && dst) {
+        r->recv_buf = dst;
+    }
+    return err;
+}
+
+static UDSErr_t Handle_0x84_SecuredDataTransmission(UDSServer_t *srv, UDSReq_t *r) {
+    if (NULL == srv->secured) {
+        return NegativeResponse(r, UDS_NRC_ConditionsNotCorrect);
+    }
+    UDSSecuredHeader_t hdr;
+    SecuredHeader(r->recv_buf, &hdr);
+    if (r->recv_len < UDS_0X84_REQ_BASE_LEN + (size_t)hdr.signatureLength ||
+        0 == (hdr.administrativeParameter & UDS_SDT_AP_REQUEST)) {
+        return NegativeResponse(r, UDS_NRC_IncorrectMessageLengthOrInvalidFormat);
+    }
+    uint16_t len = (uint16_t)(r->recv_len - UDS_0X84_HEADER_LEN - hdr.signatureLength);
+    size_t sendBufSize = r->send_buf_size;
+    if (sendBufSize < UDS_0X84_HEADER_LEN + UDS_SERVER_0x84_MAX_SIGNATURE_LEN + UDS_NEG_RESP_LEN) {
+        return NegativeResponse(r, UDS_NRC_ResponseTooLong);
+    }
+
+    // a request whose internal service responded with 0x78 has already been decrypted
+    if (!r->securedUnwrapped) {
+        UDSErr_t err = SecuredUnwrap(srv, r, &hdr, len);
+        if (UDS_PositiveResponse != err) {
+            return NegativeResponse(r, err);
+        }
+        if (kSID_SECURED_DATA_TRANSMISSION == r->recv_buf[UDS_0X84_HEADER_LEN]) {
+            return NegativeResponse(r, UDS_NRC_IncorrectMessageLengthOrInvalidFormat);
+        }
+        r->securedUnwrapped = true;
+    }
+
+    // dispatch the internal request where it is. Its response is built at the start of send_buf
+    // with room left for the security header and signature
+    const uint8_t *outer = r->recv_buf;
+    size_t outerLen = r->recv_len;
+    UDS_A_Mtype_t mtype = r->info.A_Mtype;
+    r->recv_buf = &outer[UDS_0X84_HEADER_LEN];
+    r->recv_len = len;
+    r->send_buf_size = sendBufSize - UDS_0X84_HEADER_LEN - UDS_SERVER_0x84_MAX_SIGNATURE_LEN;
+    r->send_len = 0;
+    r->info.A_Mtype = UDS_A_MTYPE_SECURE_DIAG;
+    UDSErr_t response = evaluateServiceResponse(srv, r);
+    r->recv_buf = outer;
+    r->recv_len = outerLen;
+    r->send_buf_size = sendBufSize;
+    r->info.A_Mtype = mtype;
+
+    if (UDS_NRC_RequestCorrectlyReceived_ResponsePending == response) {
+        return NegativeResponse(r, response); // sent unsecured, the internal request is kept
+    }
+    r->securedUnwrapped = false;
+    if (0 == r->send_len) {
+        return UDS_PositiveResponse; // the internal response is suppressed
+    }
+
+    uint16_t respLen = (uint16_t)r->send_len;
+    uint16_t sigSize = (uint16_t)(sendBufSize - UDS_0X84_HEADER_LEN - respLen);
+    uint8_t *payload = &r->send_buf[UDS_0X84_HEADER_LEN];
+    memmove(payload, r->send_buf, respLen);
+    hdr.administrativeParameter &= (uint16_t)~UDS_SDT_AP_REQUEST;
+    hdr.signatureLength = 0;
+    UDSErr_t err =
+        srv->secured->wrap(srv->secured->ctx, &hdr, payload, respLen, &payload[respLen], sigSize);
+    if (UDS_PositiveResponse != err) {
+        return NegativeResponse(r, err);
+    }
+    if (hdr.signatureLength > sigSize) {
+        return NegativeResponse(r, UDS_NRC_GeneralReject);
+    }
+
+    r->send_buf[0] = UDS_RESPONSE_SID_OF(kSID_SECURED_DATA_TRANSMISSION);
+    r->send_buf[1] = (uint8_t)(hdr.administrativeParameter >> 8);
+    r->send_buf[2] = (uint8_t)hdr.administrativeParameter;
+    r->send_buf[3] = hdr.signatureEncryptionCalculation;
+    r->send_buf[4] = (uint8_t)(hdr.signatureLength >> 8);
+    r->send_buf[5] = (uint8_t)hdr.signatureLength;
+    r->send_buf[6] = (uint8_t)(hdr.antiReplayCounter >> 8);
+    r->send_buf[7] = (uint8_t)hdr.antiReplayCounter;
+    r->send_len = UDS_0X84_HEADER_LEN + respLen + hdr.signatureLength;
+    return UDS_PositiveResponse;
+}
+#endif
+
+#if UDS_SERVER_ENABLE_0x85
+static UDSErr_t Handle_0x85_ControlDTCSetting(UDSServer_t *srv, UDSReq_t *r) {
+    (void)srv;
+    if (r->recv_len < UDS_0X85_REQ_BASE_LEN) {
+        return NegativeResponse(r, UDS_NRC_IncorrectMessageLengthOrInvalidFormat);
+    }
+
+    uint8_t type = r->recv_buf[1] & 0x7F;
+
+    UDSControlDTCSettingArgs_t args = {
+        .type = type,
+        .data = r->recv_len > UDS_0X85_REQ_BASE_LEN ? &r->recv_buf[UDS_0X85_REQ_BASE_LEN] : NULL,
+        .len = r->recv_len > UDS_0X85_REQ_BASE_LEN ? r->recv_len - UDS_0X85_REQ_BASE_LEN : 0,
+    };
+
+    int ret = EmitEvent(srv, UDS_EVT_ControlDTCSetting, &args);
+    if (UDS_PositiveResponse != ret) {
+        return NegativeResponse(r, ret);
+    }
 
     r->send_buf[0] = UDS_RESPONSE_SID_OF(kSID_CONTROL_DTC_SETTING);
     r->send_buf[1] = type;
     r->send_len = UDS_0X85_RESP_LEN;
     return UDS_PositiveResponse;
 }
+#endif
+
+#if UDS_SERVER_ENABLE_0x86
+/**
+ * @brief Length of the eventTypeRecord of a set-up eventType, -1 if it is not supported
+ */
+static int ROERecordLen(uint8_t eventType) {
+    switch (eventType) {
+    case UDS_LEV_RE_ONDTCS:
+        return 1; // DTCStatusMask
+    case UDS_LEV_RE_OCODID:
+        return 2; // dataIdentifier
+    case UDS_LEV_RE_OCOV:
+        return 10; // dataIdentifier, logic, reference value, hysteresis, localization
+    default:
+        return -1;
+    }
+}
+
+static uint16_t ROEDataIdentifier(const UDSROEEvent_t *ev) {
+    return (uint16_t)((uint16_t)(ev->record[0] << 8) | ev->record[1]);
+}
+
+/**
+ * @brief Monitored DIDs are read from the DID table
+ */
+static UDSErr_t ROEReadDID(UDSServer_t *srv, uint16_t did, uint8_t *dst, uint16_t *len) {
+    const UDSDIDEntry_t *entry = FindDID(srv, did);
+    if (NULL == entry || !(entry->read || entry->ptr) ||
+        entry->len > UDS_SERVER_0x86_MAX_DATA_LEN) {
+        return UDS_NRC_RequestOutOfRange;
+    }
+    *len = entry->len;
+    if (entry->read) {
+        return entry->read(srv, entry, dst);
+    }
+    memcpy(dst, entry->ptr, entry->len);
+    return UDS_PositiveResponse;
+}
+
+/**
+ * @brief Extract the value addressed by an onComparisonOfValues localization. Bit 15: signed,
+ * bits 14-10: size in bits (0 means 32), bits 9-0: offset in bits from the most significant bit of
+ * the first data byte.
+ */
+static bool ROEExtractValue(const uint8_t *data, uint16_t len, uint16_t loc, int64_t *value) {
+    uint32_t size = (loc >> 10) & 0x1F;
+    uint32_t offset = loc & 0x3FF;
+    if (0 == size) {
+        size = 32;
+    }
+    if (offset + size > len * 8U) {
+        return false;
+    }
+    uint32_t v = 0;
+    for (uint32_t i = offset; i < offset + size; i++) {
+        v = (v << 1) | ((data[i / 8] >> (7 - i % 8)) & 1U);
+    }
+    *value = v;
+    if ((loc & 0x8000) && (v >> (size - 1)) & 1U) {
+        *value -= (int64_t)1 << size;
+    }
+    return true;
+}
+
+/**
+ * @brief Evaluate an onComparisonOfValues event. It fires when the comparison becomes true and
+ * re-arms once the value has moved back past the reference by the hysteresis (percent of the
+ * reference value).
+ */
+static bool ROECompareFires(UDSROEEvent_t *ev, const uint8_t *data, uint16_t len) {
+    uint8_t logic = ev->record[2];
+    uint32_t rawRef = ((uint32_t)ev->record[3] << 24) | ((uint32_t)ev->record[4] << 16) |
+                      ((uint32_t)ev->record[5] << 8) | ev->record[6];
+    uint8_t hysteresis = ev->record[7];
+    uint16_t loc = (uint16_t)((uint16_t)(ev->record[8] << 8) | ev->record[9]);
+    int64_t ref = (loc & 0x8000) ? (int64_t)(int32_t)rawRef : (int64_t)rawRef;
+    int64_t band = (ref < 0 ? -ref : ref) * hysteresis / 100;
+    int64_t value = 0;
+    if (!ROEExtractValue(data, len, loc, &value)) {
+        return false;
+    }
+
+    bool holds = false;
+    bool rearm = false;
+    switch (logic) {
+    case UDS_RE_CMP_LT:
+        holds = value < ref;
+        rearm = value >= ref + band;
+        break;
+    case UDS_RE_CMP_GT:
+        holds = value > ref;
+        rearm = value <= ref - band;
+        break;
+    case UDS_RE_CMP_EQ:
+        holds = value == ref;
+        rearm = value > ref + band || value < ref - band;
+        break;
+    default: // UDS_RE_CMP_NE
+        holds = value != ref;
+        rearm = value == ref;
+        break;
+    }
+
+    if (ev->armed && holds) {
+        ev->armed = false;
+        return true;
+    }
+    if (rearm) {
+        ev->armed = true;
+    }
+    return false;
+}
+
+static void ROEFire(UDSROEEvent_t *ev) {
+    ev->pending = true;
+    if (ev->identified < UINT8_MAX) {
+        ev->identified++;
+    }
+}
+
+/**
+ * @brief Duration of an eventWindowTime, 0 for the windows that last until the server restarts
+ */
+static uint32_t ROEWindowMs(uint8_t windowTime) {
+    switch (windowTime) {
+    case UDS_RE_WT_SHORT:
+        return UDS_SERVER_0x86_SHORT_WINDOW_MS;
+    case UDS_RE_WT_MEDIUM:
+        return UDS_SERVER_0x86_MEDIUM_WINDOW_MS;
+    case UDS_RE_WT_LONG:
+        return UDS_SERVER_0x86_LONG_WINDOW_MS;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief numberOfIdentifiedEvents of the tester at `ta`
+ */
+static uint8_t ROEIdentified(const UDSServer_t *srv, uint32_t ta) {
+    uint32_t n = 0;
+    for (int i = 0; i < srv->roeCount; i++) {
+        if (srv->roe[i].ta == ta) {
+            n += srv->roe[i].identified;
+        }
+    }
+    return n > UINT8_MAX ? UINT8_MAX : (uint8_t)n;
+}
+
+/**
+ * @brief Start the event logics set up by the tester at `ta`. Their event windows begin now.
+ * @return false if the tester has not set up any event logic
+ */
+static bool ROEStart(UDSServer_t *srv, uint32_t ta) {
+    bool started = false;
+    srv->roeSampleTimer = srv->now;
+    for (int i = 0; i < srv->roeCount; i++) {
+        UDSROEEvent_t *ev = &srv->roe[i];
+        uint16_t len = 0;
+        if (ev->ta != ta) {
+            continue;
+        }
+        ev->active = true;
+        ev->windowTimer = srv->now + ROEWindowMs(ev->windowTime);
+        ev->identified = 0;
+        ev->pending = false;
+        ev->armed = true;
+        if (UDS_LEV_RE_OCODID == ev->eventType) {
+            // baseline: only changes after the start respond
+            ROEReadDID(srv, ROEDataIdentifier(ev), ev->last, &len);
+        }
+        started = true;
+    }
+    return started;
+}
+
+/**
+ * @brief Remove the event logics set up by the tester at `ta`
+ */
+static void ROEClear(UDSServer_t *srv, uint32_t ta) {
+    uint8_t n = 0;
+    for (int i = 0; i < srv->roeCount; i++) {
+        if (srv->roe[i].ta != ta) {
+            srv->roe[n++] = srv->roe[i];
+        }
+    }
+    srv->roeCount = n;
+}
+
+static UDSErr_t ROESetup(UDSServer_t *srv, UDSReq_t *r, uint8_t eventType, uint8_t windowTime) {
+    int recordLen = ROERecordLen(eventType);
+    if (r->recv_len < UDS_0X86_REQ_MIN_LEN + (size_t)recordLen + 1) {
+        return NegativeResponse(r, UDS_NRC_IncorrectMessageLengthOrInvalidFormat);
+    }
+    const uint8_t *record = &r->recv_buf[UDS_0X86_REQ_MIN_LEN];
+    const uint8_t *service = record + recordLen;
+    size_t serviceLen = r->recv_len - UDS_0X86_REQ_MIN_LEN - (size_t)recordLen;
+    if (serviceLen > UDS_SERVER_0x86_MAX_SERVICE_LEN ||
+        kSID_RESPONSE_ON_EVENT == service[0] || windowTime < UDS_RE_WT_INFINITE ||
+        windowTime > UDS_RE_WT_MANUFACTURER) {
+        return NegativeResponse(r, UDS_NRC_RequestOutOfRange);
+    }
+
+    if (UDS_LEV_RE_OCODID == eventType || UDS_LEV_RE_OCOV == eventType) {
+        uint8_t data[UDS_SERVER_0x86_MAX_DATA_LEN];
+        uint16_t len = 0;
+        uint16_t did = (uint16_t)((uint16_t)(record[0] << 8) | record[1]);
+        if (UDS_PositiveResponse != ROEReadDID(srv, did, data, &len)) {
+            return NegativeResponse(r, UDS_NRC_RequestOutOfRange);
+        }
+        int64_t value = 0;
+        if (UDS_LEV_RE_OCOV == eventType &&
+            (record[2] < UDS_RE_CMP_LT || record[2] > UDS_RE_CMP_NE ||
+             !ROEExtractValue(data, len, (uint16_t)((uint16_t)(record[8] << 8) | record[9]),
+                              &value))) {
+            return NegativeResponse(r, UDS_NRC_RequestOutOfRange);
+        }
+    }
+
+    // an event logic of the same tester, type (and DID) is replaced
+    uint32_t ta = RequestTesterAddress(srv);
+    int idx = -1;
+    for (int i = 0; i < srv->roeCount; i++) {
+        const UDSROEEvent_t *ev = &srv->roe[i];
+        if (ev->ta == ta && ev->eventType == eventType &&
+            (UDS_LEV_RE_ONDTCS == eventType || 0 == memcmp(ev->record, record, 2))) {
+            idx = i;
+            break;
+        }
+    }
+    if (idx < 0) {
+        if (srv->roeCount >= UDS_SERVER_0x86_MAX_EVENTS) {
+            return NegativeResponse(r, UDS_NRC_RequestOutOfRange);
+        }
+        idx = srv->roeCount++;
+    }
+
+    UDSROEEvent_t *ev = &srv->roe[idx];
+    memset(ev, 0, sizeof(*ev));
+    ev->eventType = eventType;
+    ev->windowTime = windowTime;
+    memcpy(ev->record, record, (size_t)recordLen);
+    ev->recordLen = (uint8_t)recordLen;
+    memcpy(ev->service, service, serviceLen);
+    ev->serviceLen = (uint8_t)serviceLen;
+    ev->ta = ta;
+    ev->info = r->info;
+
+    r->send_buf[2] = 0; // numberOfIdentifiedEvents
+    r->send_buf[3] = windowTime;
+    r->send_len = UDS_0X86_RESP_BASE_LEN;
+    memcpy(&r->send_buf[r->send_len], record, (size_t)recordLen);
+    r->send_len += (size_t)recordLen;
+    memcpy(&r->send_buf[r->send_len], service, serviceLen);
+    r->send_len += serviceLen;
+    return UDS_PositiveResponse;
+}
+
+static UDSErr_t Handle_0x86_ResponseOnEvent(UDSServer_t *srv, UDSReq_t *r) {
+    uint8_t eventType = r->recv_buf[1] & 0x3F;
+    uint8_t windowTime = r->recv_buf[2];
+    uint32_t ta = RequestTesterAddress(srv);
+
+    if (r->recv_buf[1] & UDS_RE_STORAGE_STATE) {
+        // storing event logic across power cycles is not supported
+        return NegativeResponse(r, UDS_NRC_RequestOutOfRange);
+    }
+
+    r->send_buf[0] = UDS_RESPONSE_SID_OF(kSID_RESPONSE_ON_EVENT);
+    r->send_buf[1] = eventType;
+
+    switch (eventType) {
+    case UDS_LEV_RE_ONDTCS:
+    case UDS_LEV_RE_OCODID:
+    case UDS_LEV_RE_OCOV:
+        return ROESetup(srv, r, eventType, windowTime);
+    case UDS_LEV_RE_STRTROE:
+        if (!ROEStart(srv, ta)) {
+            return NegativeResponse(r, UDS_NRC_ConditionsNotCorrect);
+        }
+        break;
+    case UDS_LEV_RE_STPROE:
+        StopROE(srv, ta);
+        break;
+    case UDS_LEV_RE_CLRROE:
+        ROEClear(srv, ta);
+        break;
+    case UDS_LEV_RE_RAE: {
+        uint8_t numActive = 0;
+        r->send_len = 3;
+        for (int i = 0; i < srv->roeCount; i++) {
+            const UDSROEEvent_t *ev = &srv->roe[i];
+            if (!ev->active || ev->ta != ta) {
+                continue;
+            }
+            if (2U + ev->recordLen + ev->serviceLen > r->send_buf_size - r->send_len) {
+                return NegativeResponse(r, UDS_NRC_ResponseTooLong);
+            }
+            numActive++;
+            r->send_buf[r->send_len++] = ev->eventType;
+            r->send_buf[r->send_len++] = ev->windowTime;
+            memcpy(&r->send_buf[r->send_len], ev->record, ev->recordLen);
+            r->send_len += ev->recordLen;
+            memcpy(&r->send_buf[r->send_len], ev->service, ev->serviceLen);
+            r->send_len += ev->serviceLen;
+        }
+        r->send_buf[2] = numActive;
+        return UDS_PositiveResponse;
+    }
+    default:
+        return NegativeResponse(r, UDS_NRC_SubFunctionNotSupported);
+    }
+
+    r->send_buf[2] = ROEIdentified(srv, ta);
+    r->send_buf[3] = windowTime;
+    r->send_len = UDS_0X86_RESP_BASE_LEN;
+    return UDS_PositiveResponse;
+}
+#endif
 
+#if UDS_SERVER_ENABLE_0x87
 static UDSErr_t Handle_0x87_LinkControl(UDSServer_t *srv, UDSReq_t *r) {
     if (r->recv_len < UDS_0X85_REQ_BASE_LEN) {
         return NegativeResponse(r, UDS_NRC_IncorrectMessageLengthOrInvalidFormat);
@@ -1343,72 +3316,134 @@ static UDSErr_t Handle_0x87_LinkControl(UDSServer_t *srv, UDSReq_t *r) {
 
     return UDS_PositiveResponse;
 }
+#endif
 
 typedef UDSErr_t (*UDSService)(UDSServer_t *srv, UDSReq_t *r);
 
+#define UDS_SVC_SUBFUNCTION 0x01 /* suppressPosRspMsgIndicationBit is honored */
+
+/**
+ * @brief Service descriptor
+ */
+typedef struct {
+    UDSService handler;   /* NULL: the request is passed to srv->fn as UDS_EVT_Custom */
+    uint32_t sessionMask; /* sessions in which the service is allowed (UDS_SESSION_BIT). 0: any */
+    uint8_t minLen;       /* minimum request length including the SID */
+    uint8_t flags;        /* UDS_SVC_* */
+} UDSServiceDesc_t;
+
+/* The table covers 0x10-0x3E and 0x83-0x87 */
+#define SVC_LOW_FIRST 0x10
+#define SVC_LOW_LAST 0x3E
+#define SVC_HIGH_FIRST 0x83
+#define SVC_HIGH_LAST 0x87
+#define SVC_IDX(sid)                                                                               \
+    (((sid) <= SVC_LOW_LAST) ? ((sid)-SVC_LOW_FIRST)                                               \
+                             : ((sid)-SVC_HIGH_FIRST + SVC_LOW_LAST - SVC_LOW_FIRST + 1))
+#define SVC_TABLE_LEN (SVC_IDX(SVC_HIGH_LAST) + 1)
+
+#define SVC(sid, fn, len, fl) [SVC_IDX(sid)] = {fn, UDS_SERVER_##sid##_SESSION_MASK, len, fl}
+
+static const UDSServiceDesc_t services[SVC_TABLE_LEN] = {
+    /* 0x24 ReadScalingDataByIdentifier has no built-in handler. Listing it keeps the initializer
+     * non-empty when every service is disabled */
+    [SVC_IDX(kSID_READ_SCALING_DATA_BY_IDENTIFIER)] = {NULL, 0, 0, 0},
+#if UDS_SERVER_ENABLE_0x10
+    SVC(0x10, Handle_0x10_DiagnosticSessionControl, UDS_0X10_REQ_LEN, UDS_SVC_SUBFUNCTION),
+#endif
+#if UDS_SERVER_ENABLE_0x11
+    SVC(0x11, Handle_0x11_ECUReset, UDS_0X11_REQ_MIN_LEN, UDS_SVC_SUBFUNCTION),
+#endif
+#if UDS_SERVER_ENABLE_0x14
+    SVC(0x14, Handle_0x14_ClearDiagnosticInformation, UDS_0X14_REQ_MIN_LEN, 0),
+#endif
+#if UDS_SERVER_ENABLE_0x19
+    SVC(0x19, Handle_0x19_ReadDTCInformation, UDS_0X19_REQ_MIN_LEN, 0),
+#endif
+#if UDS_SERVER_ENABLE_0x22
+    SVC(0x22, Handle_0x22_ReadDataByIdentifier, UDS_0X22_REQ_MIN_LEN, 0),
+#endif
+#if UDS_SERVER_ENABLE_0x23
+    SVC(0x23, Handle_0x23_ReadMemoryByAddress, UDS_0X23_REQ_MIN_LEN, 0),
+#endif
+#if UDS_SERVER_ENABLE_0x27
+    SVC(0x27, Handle_0x27_SecurityAccess, UDS_0X27_REQ_BASE_LEN, UDS_SVC_SUBFUNCTION),
+#endif
+#if UDS_SERVER_ENABLE_0x28
+    SVC(0x28, Handle_0x28_CommunicationControl, UDS_0X28_REQ_BASE_LEN, UDS_SVC_SUBFUNCTION),
+#endif
+#if UDS_SERVER_ENABLE_0x29
+    SVC(0x29, Handle_0x29_Authentication, UDS_0X29_REQ_BASE_LEN, UDS_SVC_SUBFUNCTION),
+#endif
+#if UDS_SERVER_ENABLE_0x2A
+    SVC(0x2A, Handle_0x2A_ReadDataByPeriodicIdentifier, UDS_0X2A_REQ_MIN_LEN, 0),
+#endif
+#if UDS_SERVER_ENABLE_0x2C
+    SVC(0x2C, Handle_0x2C_DynamicDefineDataIdentifier, UDS_0X2C_REQ_MIN_LEN, 0),
+#endif
+#if UDS_SERVER_ENABLE_0x2E
+    SVC(0x2E, Handle_0x2E_WriteDataByIdentifier, UDS_0X2E_REQ_MIN_LEN, 0),
+#endif
+#if UDS_SERVER_ENABLE_0x2F
+    SVC(0x2F, Handle_0x2F_IOControlByIdentifier, UDS_0X2F_REQ_MIN_LEN, 0),
+#endif
+#if UDS_SERVER_ENABLE_0x31
+    SVC(0x31, Handle_0x31_RoutineControl, UDS_0X31_REQ_MIN_LEN, UDS_SVC_SUBFUNCTION),
+#endif
+#if UDS_SERVER_ENABLE_0x34
+    SVC(0x34, Handle_0x34_RequestDownload, UDS_0X34_REQ_BASE_LEN, 0),
+#endif
+#if UDS_SERVER_ENABLE_0x35
+    SVC(0x35, Handle_0x35_RequestUpload, UDS_0X35_REQ_BASE_LEN, 0),
+#endif
+#if UDS_SERVER_ENABLE_0x36
+    SVC(0x36, Handle_0x36_TransferData, UDS_0X36_REQ_BASE_LEN, 0),
+#endif
+#if UDS_SERVER_ENABLE_0x37
+    SVC(0x37, Handle_0x37_RequestTransferExit, UDS_0X37_REQ_BASE_LEN, 0),
+#endif
+#if UDS_SERVER_ENABLE_0x38
+    SVC(0x38, Handle_0x38_RequestFileTransfer, UDS_0X38_REQ_BASE_LEN, 0),
+#endif
+#if UDS_SERVER_ENABLE_0x3D
+    SVC(0x3D, Handle_0x3D_WriteMemoryByAddress, UDS_0X3D_REQ_MIN_LEN, 0),
+#endif
+#if UDS_SERVER_ENABLE_0x3E
+    SVC(0x3E, Handle_0x3E_TesterPresent, UDS_0X3E_REQ_MIN_LEN, UDS_SVC_SUBFUNCTION),
+#endif
+#if UDS_SERVER_ENABLE_0x83
+    SVC(0x83, Handle_0x83_AccessTimingParameter, UDS_0X83_REQ_BASE_LEN, UDS_SVC_SUBFUNCTION),
+#endif
+#if UDS_SERVER_ENABLE_0x84
+    SVC(0x84, Handle_0x84_SecuredDataTransmission, UDS_0X84_REQ_BASE_LEN, 0),
+#endif
+#if UDS_SERVER_ENABLE_0x85
+    SVC(0x85, Handle_0x85_ControlDTCSetting, UDS_0X85_REQ_BASE_LEN, UDS_SVC_SUBFUNCTION),
+#endif
+#if UDS_SERVER_ENABLE_0x86
+    SVC(0x86, Handle_0x86_ResponseOnEvent, UDS_0X86_REQ_MIN_LEN, UDS_SVC_SUBFUNCTION),
+#endif
+#if UDS_SERVER_ENABLE_0x87
+    SVC(0x87, Handle_0x87_LinkControl, UDS_0X87_REQ_BASE_LEN, UDS_SVC_SUBFUNCTION),
+#endif
+};
+
 /**
- * @brief Get the internal service handler matching the given SID.
+ * @brief Get the internal service descriptor matching the given SID.
  * @param sid
- * @return pointer to UDSService or NULL if no match
+ * @return pointer to the descriptor or NULL if the service has no internal handler
  */
-static UDSService getServiceForSID(uint8_t sid) {
-    switch (sid) {
-    case kSID_DIAGNOSTIC_SESSION_CONTROL:
-        return &Handle_0x10_DiagnosticSessionControl;
-    case kSID_ECU_RESET:
-        return &Handle_0x11_ECUReset;
-    case kSID_CLEAR_DIAGNOSTIC_INFORMATION:
-        return &Handle_0x14_ClearDiagnosticInformation;
-    case kSID_READ_DTC_INFORMATION:
-        return Handle_0x19_ReadDTCInformation;
-    case kSID_READ_DATA_BY_IDENTIFIER:
-        return &Handle_0x22_ReadDataByIdentifier;
-    case kSID_READ_MEMORY_BY_ADDRESS:
-        return &Handle_0x23_ReadMemoryByAddress;
-    case kSID_READ_SCALING_DATA_BY_IDENTIFIER:
-        return NULL;
-    case kSID_SECURITY_ACCESS:
-        return &Handle_0x27_SecurityAccess;
-    case kSID_COMMUNICATION_CONTROL:
-        return &Handle_0x28_CommunicationControl;
-    case kSID_READ_PERIODIC_DATA_BY_IDENTIFIER:
-        return NULL;
-    case kSID_DYNAMICALLY_DEFINE_DATA_IDENTIFIER:
-        return &Handle_0x2C_DynamicDefineDataIdentifier;
-    case kSID_WRITE_DATA_BY_IDENTIFIER:
-        return &Handle_0x2E_WriteDataByIdentifier;
-    case kSID_IO_CONTROL_BY_IDENTIFIER:
-        return &Handle_0x2F_IOControlByIdentifier;
-    case kSID_ROUTINE_CONTROL:
-        return &Handle_0x31_RoutineControl;
-    case kSID_REQUEST_DOWNLOAD:
-        return &Handle_0x34_RequestDownload;
-    case kSID_REQUEST_UPLOAD:
-        return &Handle_0x35_RequestUpload;
-    case kSID_TRANSFER_DATA:
-        return &Handle_0x36_TransferData;
-    case kSID_REQUEST_TRANSFER_EXIT:
-        return &Handle_0x37_RequestTransferExit;
-    case kSID_REQUEST_FILE_TRANSFER:
-        return &Handle_0x38_RequestFileTransfer;
-    case kSID_WRITE_MEMORY_BY_ADDRESS:
-        return &Handle_0x3D_WriteMemoryByAddress;
-    case kSID_TESTER_PRESENT:
-        return &Handle_0x3E_TesterPresent;
-    case kSID_ACCESS_TIMING_PARAMETER:
-        return NULL;
-    case kSID_SECURED_DATA_TRANSMISSION:
-        return NULL;
-    case kSID_CONTROL_DTC_SETTING:
-        return &Handle_0x85_ControlDTCSetting;
-    case kSID_RESPONSE_ON_EVENT:
-        return NULL;
-    case kSID_LINK_CONTROL:
-        return &Handle_0x87_LinkControl;
-    default:
+static const UDSServiceDesc_t *getServiceForSID(uint8_t sid) {
+    const UDSServiceDesc_t *desc = NULL;
+    if ((sid >= SVC_LOW_FIRST && sid <= SVC_LOW_LAST) ||
+        (sid >= SVC_HIGH_FIRST && sid <= SVC_HIGH_LAST)) {
+        desc = &services[SVC_IDX(sid)];
+    }
+    if (NULL == desc || NULL == desc->handler) {
         UDS_LOGI(__FILE__, "no handler for request SID %x", sid);
         return NULL;
     }
+    return desc;
 }
 
 /**
@@ -1422,86 +3457,49 @@ static UDSErr_t evaluateServiceResponse(UDSServer_t *srv, UDSReq_t *r) {
     UDSErr_t response = UDS_PositiveResponse;
     bool suppressResponse = false;
     uint8_t sid = r->recv_buf[0];
-    UDSService service = getServiceForSID(sid);
+    const UDSServiceDesc_t *service = getServiceForSID(sid);
 
     if (NULL == srv->fn)
         return NegativeResponse(r, UDS_NRC_ServiceNotSupported);
     UDS_ASSERT(srv->fn); // service handler functions will call srv->fn. it must be valid
 
-    switch (sid) {
-    /* CASE Service_with_sub-function */
-    /* test if service with sub-function is supported */
-    case kSID_DIAGNOSTIC_SESSION_CONTROL:
-    case kSID_ECU_RESET:
-    case kSID_SECURITY_ACCESS:
-    case kSID_COMMUNICATION_CONTROL:
-    case kSID_ROUTINE_CONTROL:
-    case kSID_TESTER_PRESENT:
-    case kSID_CONTROL_DTC_SETTING:
-    case kSID_LINK_CONTROL: {
-        UDS_ASSERT(service);
-        response = service(srv, r);
-
-        bool suppressPosRspMsgIndicationBit = r->recv_buf[1] & 0x80;
-
-        /* test if positive response is required and if responseCode is positive 0x00 */
-        if (suppressPosRspMsgIndicationBit && (response == UDS_PositiveResponse) &&
-
-            // TODO: *not yet a NRC 0x78 response sent*
-            true) {
-            suppressResponse = true;
+    if (service) {
+        if (!SessionInMask(service->sessionMask, srv->sessionType)) {
+            response = NegativeResponse(r, UDS_NRC_ServiceNotSupportedInActiveSession);
+        } else if (r->recv_len < service->minLen) {
+            response = NegativeResponse(r, UDS_NRC_IncorrectMessageLengthOrInvalidFormat);
         } else {
-            suppressResponse = false;
-        }
-        break;
-    }
-
-    /* CASE Service_without_sub-function */
-    /* test if service without sub-function is supported */
-    case kSID_READ_DATA_BY_IDENTIFIER:
-    case kSID_READ_MEMORY_BY_ADDRESS:
-    case kSID_WRITE_DATA_BY_IDENTIFIER:
-    case kSID_REQUEST_DOWNLOAD:
-    case kSID_REQUEST_UPLOAD:
-    case kSID_TRANSFER_DATA:
-    case kSID_REQUEST_FILE_TRANSFER:
-    case kSID_REQUEST_TRANSFER_EXIT: {
-        UDS_ASSERT(service);
-        response = service(srv, r);
-        break;
-    }
+            response = service->handler(srv, r);
 
-    /* CASE Service_optional */
-    case kSID_CLEAR_DIAGNOSTIC_INFORMATION:
-    case kSID_READ_DTC_INFORMATION:
-    case kSID_READ_SCALING_DATA_BY_IDENTIFIER:
-    case kSID_READ_PERIODIC_DATA_BY_IDENTIFIER:
-    case kSID_DYNAMICALLY_DEFINE_DATA_IDENTIFIER:
-    case kSID_IO_CONTROL_BY_IDENTIFIER:
-    case kSID_WRITE_MEMORY_BY_ADDRESS:
-    case kSID_ACCESS_TIMING_PARAMETER:
-    case kSID_SECURED_DATA_TRANSMISSION:
-    case kSID_RESPONSE_ON_EVENT:
-    default: {
-        if (service) {
-            response = service(srv, r);
-        } else { /* getServiceForSID(sid) returned NULL*/
-            UDSCustomArgs_t args = {
-                .sid = sid,
-                .optionRecord = &r->recv_buf[1],
-                .len = (uint16_t)(r->recv_len - 1),
-                .copyResponse = safe_copy,
-            };
+            /* CASE Service_with_sub-function */
+            if (service->flags & UDS_SVC_SUBFUNCTION) {
+                bool suppressPosRspMsgIndicationBit = r->recv_buf[1] & 0x80;
 
-            r->send_buf[0] = UDS_RESPONSE_SID_OF(sid);
-            r->send_len = 1;
+                /* test if positive response is required and if responseCode is positive 0x00 */
+                if (suppressPosRspMsgIndicationBit && (response == UDS_PositiveResponse) &&
 
-            response = EmitEvent(srv, UDS_EVT_Custom, &args);
-            if (UDS_PositiveResponse != response)
-                return NegativeResponse(r, response);
+                    // TODO: *not yet a NRC 0x78 response sent*
+                    true) {
+                    suppressResponse = true;
+                }
+            }
         }
-        break;
-    }
+    } else { /* no internal handler: let the user handle it */
+        UDSCustomArgs_t args = {
+            .sid = sid,
+            .optionRecord = &r->recv_buf[1],
+            .len = (uint16_t)(r->recv_len - 1),
+            .copyResponse = safe_copy,
+            .reserve = safe_reserve,
+            .commit = safe_commit,
+        };
+
+        r->send_buf[0] = UDS_RESPONSE_SID_OF(sid);
+        r->send_len = 1;
+
+        response = EmitEvent(srv, UDS_EVT_Custom, &args);
+        if (UDS_PositiveResponse != response)
+            return NegativeResponse(r, response);
     }
 
     if ((UDS_A_TA_TYPE_FUNCTIONAL == r->info.A_TA_Type) &&
@@ -1526,104 +3524,1073 @@ static UDSErr_t evaluateServiceResponse(UDSServer_t *srv, UDSReq_t *r) {
 }
 
 // ========================================================================
-//                             Public Functions
+//                             Request Lifecycle
 // ========================================================================
 
-UDSErr_t UDSServerInit(UDSServer_t *srv) {
-    if (NULL == srv) {
-        return UDS_ERR_INVALID_ARG;
-    }
-    memset(srv, 0, sizeof(UDSServer_t));
-    srv->p2_ms = UDS_SERVER_DEFAULT_P2_MS;
-    srv->p2_star_ms = UDS_SERVER_DEFAULT_P2_STAR_MS;
-    srv->s3_ms = UDS_SERVER_DEFAULT_S3_MS;
-    srv->sessionType = UDS_LEV_DS_DS;
-    srv->p2_timer = UDSMillis() + srv->p2_ms;
-    srv->s3_session_timeout_timer = UDSMillis() + srv->s3_ms;
-    srv->sec_access_boot_delay_timer =
-        UDSMillis() + UDS_SERVER_0x27_BRUTE_FORCE_MITIGATION_BOOT_DELAY_MS;
-    srv->sec_access_auth_fail_timer = UDSMillis();
-    return UDS_OK;
-}
-
-void UDSServerPoll(UDSServer_t *srv) {
-    // UDS-1-2013 Figure 38: Session Timeout (S3)
+// UDS-1-2013 Figure 38: Session Timeout (S3)
+static void PollSessionTimeout(UDSServer_t *srv) {
     if (UDS_LEV_DS_DS != srv->sessionType &&
-        UDSTimeAfter(UDSMillis(), srv->s3_session_timeout_timer)) {
+        UDSTimeAfter(srv->now, srv->s3_session_timeout_timer)) {
         EmitEvent(srv, UDS_EVT_SessionTimeout, NULL);
         srv->sessionType = UDS_LEV_DS_DS;
         srv->securityLevel = 0;
+        srv->authState = UDS_AUTH_NONE;
+#if UDS_SERVER_ENABLE_0x2A
+        StopPeriodic(srv, RequestTesterAddress(srv));
+#endif
+#if UDS_SERVER_ENABLE_0x86
+        StopROE(srv, RequestTesterAddress(srv));
+#endif
+#if UDS_SERVER_ENABLE_0x83
+        ResetTimingParameters(srv);
+#endif
+#if UDS_SERVER_ENABLE_0x2C
+        ClearDDDI(srv);
+#endif
     }
+}
 
-    if (srv->ecuResetScheduled && UDSTimeAfter(UDSMillis(), srv->ecuResetTimer)) {
-        EmitEvent(srv, UDS_EVT_DoScheduledReset, &srv->ecuResetScheduled);
+#if UDS_SERVER_ENABLE_0x2A
+/**
+ * @brief Send the next due periodic message (0x6A, periodicDataIdentifier, data). Called after
+ * request handling so responses take priority. At most one message is sent per poll, and none
+ * while the transport is busy, so that due identifiers are served round-robin.
+ */
+static void PollPeriodic(UDSServer_t *srv) {
+    if (srv->tpStatus & UDS_TP_SEND_IN_PROGRESS) {
+        return;
     }
-
-    UDSTpPoll(srv->tp);
-
-    UDSReq_t *r = &srv->r;
-
-    if (srv->requestInProgress) {
-        if (srv->RCRRP) {
-            // responds only if
-            // 1. changed (no longer RCRRP), or
-            // 2. p2_timer has elapsed
-            UDSErr_t response = evaluateServiceResponse(srv, r);
-            if (UDS_NRC_RequestCorrectlyReceived_ResponsePending == response) {
-                // it's the second time the service has responded with RCRRP
-                srv->notReadyToReceive = true;
-            } else {
-                // No longer RCRRP'ing
-                srv->RCRRP = false;
-                srv->notReadyToReceive = false;
-
-                // Not a consecutive 0x78 response, use p2 instead of p2_star * 0.3
-                srv->p2_timer = UDSMillis() + srv->p2_ms;
-            }
+    uint32_t now = srv->now;
+    for (int n = srv->periodicCount; n > 0 && srv->periodicCount > 0; n--) {
+        int idx = srv->periodicNext;
+        UDSPeriodicDID_t *p = &srv->periodic[idx];
+        // the tester's response (including the 0x6A confirming the schedule) goes first
+        if (UDSTimeAfter(p->timer, now) || TesterIsBusy(srv, p->ta)) {
+            srv->periodicNext = (uint8_t)((idx + 1) % srv->periodicCount);
+            continue;
         }
 
-        if (UDSTimeAfter(UDSMillis(), srv->p2_timer)) {
-            ssize_t ret = 0;
-            if (r->send_len) {
-                ret = UDSTpSend(srv->tp, r->send_buf, r->send_len, NULL);
-            }
+        const UDSDIDEntry_t *entry = FindDID(srv, UDS_PDID_TO_DID(p->pdid));
+        if (NULL == entry || entry->len > UDS_SERVER_0x2A_MAX_MSG_LEN - 2) {
+            UDS_LOGW(__FILE__, "periodic DID 0x%02X no longer available", p->pdid);
+            RemovePeriodic(srv, idx);
+            continue;
+        }
 
-            // TODO test injection of transport errors:
-            if (ret < 0) {
-                UDSErr_t err = UDS_ERR_TPORT;
-                EmitEvent(srv, UDS_EVT_Err, &err);
-                UDS_LOGE(__FILE__, "UDSTpSend failed with %zd\n", ret);
-            }
+        uint8_t msg[UDS_SERVER_0x2A_MAX_MSG_LEN];
+        msg[0] = UDS_RESPONSE_SID_OF(kSID_READ_PERIODIC_DATA_BY_IDENTIFIER);
+        msg[1] = p->pdid;
+        UDSErr_t err = UDS_PositiveResponse;
+        if (entry->read) {
+            err = entry->read(srv, entry, &msg[2]);
+        } else if (entry->ptr) {
+            memcpy(&msg[2], entry->ptr, entry->len);
+        }
 
-            if (srv->RCRRP) {
-                // ISO14229-2:2013 Table 4 footnote b
-                // min time between consecutive 0x78 responses is 0.3 * p2*
-                uint32_t wait_time = srv->p2_star_ms * 3 / 10;
-                srv->p2_timer = UDSMillis() + wait_time;
-            } else {
-                srv->p2_timer = UDSMillis() + srv->p2_ms;
-                srv->requestInProgress = false;
+        if (UDS_PositiveResponse == err) {
+            UDSSDU_t info = {
+                .A_Mtype = UDS_A_MTYPE_DIAG,
+                .A_TA = p->ta,
+                .A_TA_Type = UDS_A_TA_TYPE_PHYSICAL,
+            };
+            ssize_t ret = UDSTpSend(srv->tp, msg, 2U + entry->len, &info);
+            if (0 == ret) {
+                return; // transport busy, retry on the next poll
+            } else if (ret < 0) {
+                UDS_LOGE(__FILE__, "periodic send failed with %zd", ret);
             }
+            srv->tpStatus |= UDS_TP_SEND_IN_PROGRESS;
         }
 
-    } else {
-        if (srv->notReadyToReceive) {
-            return; // cannot respond to request right now
-        }
-        ssize_t len = UDSTpRecv(srv->tp, r->recv_buf, sizeof(r->recv_buf), &r->info);
-        if (len < 0) {
-            UDS_LOGE(__FILE__, "UDSTpRecv failed with %zd\n", r->recv_len);
-            return;
+        p->timer = now + PeriodicRateMs(p->mode);
+        srv->periodicNext = (uint8_t)((idx + 1) % srv->periodicCount);
+        if (UDS_PositiveResponse == err) {
+            return; // one message per poll
         }
+    }
+}
+#endif
 
-        r->recv_len = (size_t)len;
-
-        if (r->recv_len > 0) {
-            UDSErr_t response = evaluateServiceResponse(srv, r);
-            srv->requestInProgress = true;
-            if (UDS_NRC_RequestCorrectlyReceived_ResponsePending == response) {
-                srv->RCRRP = true;
+#if UDS_SERVER_STATS
+/**
+ * @brief Count a response handed to the transport, or the lack of one
+ */
+static void ServerStatsResponse(UDSServer_t *srv, const UDSReq_t *r, ssize_t ret) {
+    UDSServerStats_t *stats = &srv->stats;
+    if (ret < 0) {
+        stats->tpErrors++;
+    }
+    if (r->send_len >= UDS_NEG_RESP_LEN && 0x7F == r->send_buf[0]) {
+        stats->nrcs[r->send_buf[2]]++;
+        if (UDS_NRC_RequestCorrectlyReceived_ResponsePending == r->send_buf[2]) {
+            stats->rcrrp++;
+        }
+    }
+    if (!srv->RCRRP) {
+        if (0 == r->send_len) {
+            stats->suppressed++;
+        }
+        UDSHistogramAdd(&stats->turnaround, UDSMicros() - r->statsStartUs);
+    }
+}
+#endif
+
+/**
+ * @brief With UDS_TP_SEND_IN_PLACE the transport sends the last response straight from its buffer
+ * until it no longer reports UDS_TP_SEND_IN_PROGRESS, so no request may write a response before
+ */
+static bool SendBufInUse(const UDSServer_t *srv) {
+    return UDS_TP_SEND_IN_PLACE && (srv->tpStatus & UDS_TP_SEND_IN_PROGRESS);
+}
+
+/**
+ * @brief Send the response to the request in progress once the p2 timer allows it. Services that
+ * responded with 0x78 are re-evaluated until they complete, unless the response was deferred with
+ * UDSServerDeferResponse, in which case they are re-evaluated once after it has been completed.
+ * @param info response addressing, NULL to use the transport defaults
+ */
+static void PollRequestInProgress(UDSServer_t *srv, UDSReq_t *r, UDSSDU_t *info) {
+    uint8_t pendingState = PENDING_LOAD(&r->pendingState);
+    if (srv->RCRRP && PENDING_WAIT == pendingState) {
+        ; // deferred: keep sending 0x78 until UDSServerCompleteResponse is called
+    } else if (srv->RCRRP) {
+        // responds only if
+        // 1. changed (no longer RCRRP), or
+        // 2. p2_timer has elapsed
+        if (PENDING_DONE == pendingState) {
+            r->pendingState = PENDING_DELIVER;
+        }
+        UDSErr_t response = evaluateServiceResponse(srv, r);
+        if (PENDING_DELIVER == r->pendingState) {
+            // the handler finished without emitting its event
+            r->pendingState = PENDING_NONE;
+            r->pendingToken = 0;
+        }
+        if (UDS_NRC_RequestCorrectlyReceived_ResponsePending == response) {
+            // it's the second time the service has responded with RCRRP
+#if UDS_SERVER_RCRRP_QUEUE_LEN > 0
+            // new requests are queued, unless this one still occupies the transport
+            srv->notReadyToReceive = r->recv_borrowed;
+#else
+            srv->notReadyToReceive = true;
+#endif
+        } else {
+            // No longer RCRRP'ing
+            srv->RCRRP = false;
+            srv->notReadyToReceive = false;
+
+            // Not a consecutive 0x78 response, use p2 instead of p2_star * 0.3
+            srv->p2_timer = srv->now + srv->p2_ms;
+        }
+    }
+
+    if (UDSTimeAfter(srv->now, srv->p2_timer)) {
+        ssize_t ret = 0;
+        if (r->send_len) {
+            ret = UDSTpSend(srv->tp, r->send_buf, r->send_len, info);
+            // treat the transport as busy until the next poll refreshes its status
+            srv->tpStatus |= UDS_TP_SEND_IN_PROGRESS;
+        }
+
+        // TODO test injection of transport errors:
+        if (ret < 0) {
+            UDSErr_t err = UDS_ERR_TPORT;
+            EmitEvent(srv, UDS_EVT_Err, &err);
+            UDS_LOGE(__FILE__, "UDSTpSend failed with %zd\n", ret);
+        }
+#if UDS_SERVER_STATS
+        ServerStatsResponse(srv, r, ret);
+#endif
+
+        if (srv->RCRRP) {
+            // ISO14229-2:2013 Table 4 footnote b
+            // min time between consecutive 0x78 responses is 0.3 * p2*
+            uint32_t wait_time = srv->p2_star_ms * 3 / 10;
+            srv->p2_timer = srv->now + wait_time;
+        } else {
+            srv->p2_timer = srv->now + srv->p2_ms;
+            srv->requestInProgress = false;
+        }
+    }
+}
+
+#if UDS_SERVER_SHARED_BUF || UDS_SERVER_MAX_TESTERS > 1 || UDS_SERVER_ENABLE_0x86 ||              \
+    UDS_SERVER_RCRRP_QUEUE_LEN > 0
+/**
+ * @brief Copy a request into the request context, where building the response does not overwrite
+ * it. The caller checks that len does not exceed REQ_MAX_LEN.
+ */
+static void StoreRequest(UDSReq_t *r, const uint8_t *data, size_t len) {
+    uint8_t *dst = RequestSlot(r, len);
+    memmove(dst, data, len);
+    r->recv_buf = dst;
+    r->recv_len = len;
+}
+#endif
+
+/**
+ * @brief Take a request returned by UDSTpPeek() into REQ_STORAGE(r). Requests lent by the
+ * transport are used in place.
+ * @return false if the request is too long to keep
+ */
+static bool AcceptRequest(UDSReq_t *r, size_t len) {
+    r->recv_len = len;
+    r->send_buf_size = sizeof(r->send_buf);
+    if (r->recv_buf != REQ_STORAGE(r)) {
+        return true;
+    }
+    if (len > REQ_MAX_LEN) {
+        return false;
+    }
+#if UDS_SERVER_SHARED_BUF
+    StoreRequest(r, r->recv_buf, len);
+#endif
+    return true;
+}
+
+/**
+ * @brief Point the request context back at its own buffer once the request is no longer needed
+ */
+static void ReleaseRequest(UDSReq_t *r) {
+    r->recv_buf = REQ_STORAGE(r);
+    r->send_buf_size = sizeof(r->send_buf);
+}
+
+static void ProcessRequest(UDSServer_t *srv, UDSReq_t *r) {
+#if UDS_SERVER_STATS
+    srv->stats.requests[UDSStatsSIDIndex(r->recv_buf[0])]++;
+    r->statsStartUs = UDSMicros();
+#endif
+    UDSErr_t response = evaluateServiceResponse(srv, r);
+    srv->requestInProgress = true;
+    if (UDS_NRC_RequestCorrectlyReceived_ResponsePending == response) {
+        srv->RCRRP = true;
+    } else if (PENDING_WAIT == PENDING_LOAD(&r->pendingState)) {
+        UDS_LOGW(__FILE__, "response deferred but service did not return 0x78");
+        r->pendingState = PENDING_NONE;
+        r->pendingToken = 0;
+    }
+}
+
+#if UDS_SERVER_RCRRP_QUEUE_LEN > 0
+/**
+ * @brief Copy a request that responded with 0x78 out of the transport so that the transport can
+ * receive the next one. A request too long to copy keeps the transport until it completes.
+ */
+static void ReleasePendingRequest(UDSServer_t *srv, UDSReq_t *r) {
+    if (r->recv_len > REQ_MAX_LEN || r->recv_pinned) {
+        srv->notReadyToReceive = true;
+        return;
+    }
+    StoreRequest(r, r->recv_buf, r->recv_len); // a no-op for a request that is already stored
+    r->recv_borrowed = false;
+    UDSTpAck(srv->tp);
+}
+
+static void SendBusy(UDSServer_t *srv, const uint8_t *resp, size_t len) {
+    if (UDSTpSend(srv->tp, resp, (ssize_t)len, NULL) < 0) {
+        UDS_LOGW(__FILE__, "cannot respond while a response is pending");
+#if UDS_SERVER_STATS
+        srv->stats.tpErrors++;
+#endif
+    }
+    srv->tpStatus |= UDS_TP_SEND_IN_PROGRESS;
+}
+
+/**
+ * @brief Receive one request while a response is pending (0x78). TesterPresent is handled right
+ * away, other requests are queued or refused with 0x21 BusyRepeatRequest if the queue is full.
+ */
+static void ReceiveWhilePending(UDSServer_t *srv) {
+    uint8_t scratch[UDS_SERVER_RCRRP_QUEUE_BUF_SIZE];
+    const uint8_t *buf = NULL;
+    UDSSDU_t info = {0};
+    ssize_t len = UDSTpPeek(srv->tp, scratch, sizeof(scratch), &buf, &info);
+    if (len < 0) {
+        UDS_LOGE(__FILE__, "UDSTpPeek failed with %zd\n", len);
+#if UDS_SERVER_STATS
+        srv->stats.tpErrors++;
+#endif
+        return;
+    }
+    if (0 == len) {
+        return;
+    }
+
+#if UDS_SERVER_ENABLE_0x3E
+    if (UDS_0X3E_REQ_MIN_LEN == (size_t)len && kSID_TESTER_PRESENT == buf[0] && 0 == (buf[1] & 0x7F)) {
+        srv->s3_session_timeout_timer = srv->now + srv->s3_ms;
+        if (0 == (buf[1] & 0x80)) {
+            const uint8_t resp[] = {UDS_RESPONSE_SID_OF(kSID_TESTER_PRESENT), 0x00};
+            SendBusy(srv, resp, sizeof(resp));
+        }
+        UDSTpAck(srv->tp);
+        return;
+    }
+#endif
+
+    if (srv->queueCount < UDS_SERVER_RCRRP_QUEUE_LEN && (size_t)len <= sizeof(scratch) &&
+        (size_t)len <= REQ_MAX_LEN) {
+        UDSQueuedReq_t *q =
+            &srv->queue[(srv->queueHead + srv->queueCount) % UDS_SERVER_RCRRP_QUEUE_LEN];
+        memcpy(q->buf, buf, (size_t)len);
+        q->len = (uint16_t)len;
+        q->info = info;
+        srv->queueCount++;
+    } else if (UDS_A_TA_TYPE_PHYSICAL == info.A_TA_Type) {
+        const uint8_t resp[] = {0x7F, buf[0], UDS_NRC_BusyRepeatRequest};
+        SendBusy(srv, resp, sizeof(resp));
+#if UDS_SERVER_STATS
+        srv->stats.nrcs[UDS_NRC_BusyRepeatRequest]++;
+#endif
+    } else {
+        UDS_LOGW(__FILE__, "request queue full, dropping functional request");
+#if UDS_SERVER_STATS
+        srv->stats.dropped++;
+#endif
+    }
+    UDSTpAck(srv->tp);
+}
+
+/**
+ * @brief Process the oldest queued request
+ * @return false if the queue is empty
+ */
+static bool ProcessQueuedRequest(UDSServer_t *srv, UDSReq_t *r) {
+    if (0 == srv->queueCount) {
+        return false;
+    }
+    UDSQueuedReq_t *q = &srv->queue[srv->queueHead];
+    srv->queueHead = (uint8_t)((srv->queueHead + 1) % UDS_SERVER_RCRRP_QUEUE_LEN);
+    srv->queueCount--;
+    StoreRequest(r, q->buf, q->len);
+    r->info = q->info;
+    ProcessRequest(srv, r);
+    return true;
+}
+#endif
+
+#if UDS_SERVER_MAX_TESTERS > 1
+
+static void LoadTester(UDSServer_t *srv, UDSServerTester_t *t) {
+    srv->p2_timer = t->p2_timer;
+    srv->s3_session_timeout_timer = t->s3_session_timeout_timer;
+    srv->sec_access_auth_fail_timer = t->sec_access_auth_fail_timer;
+    srv->xferIsActive = t->xferIsActive;
+    srv->xferBlockSequenceCounter = t->xferBlockSequenceCounter;
+    srv->xferTotalBytes = t->xferTotalBytes;
+    srv->xferByteCounter = t->xferByteCounter;
+    srv->xferBlockLength = t->xferBlockLength;
+    srv->xferIsPipelined = t->xferIsPipelined;
+    srv->xferIsCompressed = t->xferIsCompressed;
+    srv->xferCrc = t->xferCrc;
+    srv->xferLastCrc = t->xferLastCrc;
+    srv->xferLastByteCount = t->xferLastByteCount;
+    srv->sessionType = t->sessionType;
+    srv->securityLevel = t->securityLevel;
+    srv->authState = t->authState;
+    srv->RCRRP = t->RCRRP;
+    srv->requestInProgress = t->requestInProgress;
+    srv->notReadyToReceive = t->notReadyToReceive;
+#if UDS_SERVER_ENABLE_0x83
+    // outside of a tester the server holds the configured timing, which 0x83 restores
+    srv->atpActive = t->atpActive;
+    if (t->atpActive) {
+        srv->atpDefaultP2_ms = srv->p2_ms;
+        srv->atpDefaultP2Star_ms = srv->p2_star_ms;
+        srv->p2_ms = t->atpP2_ms;
+        srv->p2_star_ms = t->atpP2Star_ms;
+    }
+#endif
+    srv->tester = t;
+}
+
+static void StoreTester(UDSServer_t *srv, UDSServerTester_t *t) {
+    t->p2_timer = srv->p2_timer;
+    t->s3_session_timeout_timer = srv->s3_session_timeout_timer;
+    t->sec_access_auth_fail_timer = srv->sec_access_auth_fail_timer;
+    t->xferIsActive = srv->xferIsActive;
+    t->xferBlockSequenceCounter = srv->xferBlockSequenceCounter;
+    t->xferTotalBytes = srv->xferTotalBytes;
+    t->xferByteCounter = srv->xferByteCounter;
+    t->xferBlockLength = srv->xferBlockLength;
+    t->xferIsPipelined = srv->xferIsPipelined;
+    t->xferIsCompressed = srv->xferIsCompressed;
+    t->xferCrc = srv->xferCrc;
+    t->xferLastCrc = srv->xferLastCrc;
+    t->xferLastByteCount = srv->xferLastByteCount;
+    t->sessionType = srv->sessionType;
+    t->securityLevel = srv->securityLevel;
+    t->authState = srv->authState;
+    t->RCRRP = srv->RCRRP;
+    t->requestInProgress = srv->requestInProgress;
+    t->notReadyToReceive = srv->notReadyToReceive;
+#if UDS_SERVER_ENABLE_0x83
+    t->atpActive = srv->atpActive;
+    if (srv->atpActive) {
+        t->atpP2_ms = srv->p2_ms;
+        t->atpP2Star_ms = srv->p2_star_ms;
+        srv->p2_ms = srv->atpDefaultP2_ms;
+        srv->p2_star_ms = srv->atpDefaultP2Star_ms;
+        srv->atpActive = false;
+    }
+#endif
+    srv->tester = NULL;
+}
+
+/**
+ * @brief A tester slot can be reused once the tester holds no state that differs from a fresh
+ * connection: default session, locked, not authenticated, no transfer, default timing, nothing
+ * pending and no brute-force penalty.
+ */
+static bool TesterIsReleasable(const UDSServerTester_t *t, uint32_t now) {
+#if UDS_SERVER_ENABLE_0x83
+    if (t->atpActive) {
+        return false;
+    }
+#endif
+    return UDS_LEV_DS_DS == t->sessionType && 0 == t->securityLevel &&
+           UDS_AUTH_NONE == t->authState && !t->xferIsActive &&
+           !t->requestInProgress && !t->RCRRP && !t->notReadyToReceive &&
+           UDSTimeAfter(now, t->sec_access_auth_fail_timer);
+}
+
+static UDSServerTester_t *AcquireTester(UDSServer_t *srv, uint32_t sa) {
+    UDSServerTester_t *free_slot = NULL;
+    for (size_t i = 0; i < UDS_SERVER_MAX_TESTERS; i++) {
+        UDSServerTester_t *t = &srv->testers[i];
+        if (t->inUse && t->sa == sa) {
+            return t;
+        }
+        if (!t->inUse && NULL == free_slot) {
+            free_slot = t;
+        }
+    }
+    if (NULL == free_slot) {
+        return NULL;
+    }
+    memset(free_slot, 0, offsetof(UDSServerTester_t, r));
+    free_slot->inUse = true;
+    free_slot->sa = sa;
+    free_slot->sessionType = UDS_LEV_DS_DS;
+    free_slot->xferBlockSequenceCounter = 1;
+    free_slot->p2_timer = srv->now + srv->p2_ms;
+    free_slot->s3_session_timeout_timer = srv->now + srv->s3_ms;
+    free_slot->sec_access_auth_fail_timer = srv->now;
+    ReleaseRequest(free_slot->r);
+    return free_slot;
+}
+
+/**
+ * @brief Responses are addressed physically to the tester that sent the request
+ */
+static void TesterResponseInfo(const UDSServerTester_t *t, UDSSDU_t *info) {
+    *info = t->r->info;
+    info->A_SA = t->r->info.A_TA_Type == UDS_A_TA_TYPE_PHYSICAL ? t->r->info.A_TA : 0;
+    info->A_TA = t->sa;
+    info->A_TA_Type = UDS_A_TA_TYPE_PHYSICAL;
+}
+
+static void PollTesters(UDSServer_t *srv) {
+    for (size_t i = 0; i < UDS_SERVER_MAX_TESTERS; i++) {
+        UDSServerTester_t *t = &srv->testers[i];
+        if (!t->inUse) {
+            continue;
+        }
+        LoadTester(srv, t);
+        PollSessionTimeout(srv);
+        if (srv->requestInProgress) {
+            UDSSDU_t info;
+            TesterResponseInfo(t, &info);
+            PollRequestInProgress(srv, t->r, &info);
+        }
+        StoreTester(srv, t);
+        if (TesterIsReleasable(t, srv->now)) {
+            t->inUse = false;
+        }
+    }
+}
+
+static void ReceiveTesterRequest(UDSServer_t *srv) {
+    UDSReq_t *scratch = srv->rx;
+
+    if (srv->ecuResetScheduled || SendBufInUse(srv)) {
+        return; // cannot respond to request right now
+    }
+
+    // a request for a tester other than the current one may arrive, so it is received into the
+    // spare request context, which is then handed to the tester, and the transport buffer is
+    // released straight away
+    ssize_t len = UDSTpPeek(srv->tp, REQ_STORAGE(scratch), sizeof(REQ_STORAGE(scratch)),
+                            &scratch->recv_buf, &scratch->info);
+    if (len < 0) {
+        UDS_LOGE(__FILE__, "UDSTpPeek failed with %zd\n", len);
+#if UDS_SERVER_STATS
+        srv->stats.tpErrors++;
+#endif
+        return;
+    }
+    if (0 == len) {
+        return;
+    }
+    bool lent = scratch->recv_buf != REQ_STORAGE(scratch);
+    if (!AcceptRequest(scratch, (size_t)len)) {
+        UDS_LOGW(__FILE__, "request of %zd bytes does not fit, dropping it", len);
+#if UDS_SERVER_STATS
+        srv->stats.dropped++;
+#endif
+        ReleaseRequest(scratch);
+        UDSTpAck(srv->tp);
+        return;
+    }
+
+    UDSServerTester_t *t = AcquireTester(srv, scratch->info.A_SA);
+    if (NULL == t) {
+        UDS_LOGW(__FILE__, "no free tester slot for SA 0x%03" PRIX32, scratch->info.A_SA);
+        if (UDS_A_TA_TYPE_PHYSICAL == scratch->info.A_TA_Type) {
+            NegativeResponse(scratch, UDS_NRC_BusyRepeatRequest);
+#if UDS_SERVER_STATS
+            srv->stats.nrcs[UDS_NRC_BusyRepeatRequest]++;
+#endif
+            UDSSDU_t info = scratch->info;
+            info.A_SA = scratch->info.A_TA;
+            info.A_TA = scratch->info.A_SA;
+            UDSTpSend(srv->tp, scratch->send_buf, scratch->send_len, &info);
+        }
+        ReleaseRequest(scratch);
+        UDSTpAck(srv->tp);
+        return;
+    }
+
+    if (t->requestInProgress || t->notReadyToReceive) {
+        UDS_LOGW(__FILE__, "tester 0x%03" PRIX32 " busy, dropping request", t->sa);
+#if UDS_SERVER_STATS
+        srv->stats.dropped++;
+#endif
+        ReleaseRequest(scratch);
+        UDSTpAck(srv->tp);
+        return;
+    }
+    if (scratch->recv_len > REQ_MAX_LEN) {
+        UDS_LOGW(__FILE__, "request of %zu bytes does not fit, dropping it", scratch->recv_len);
+#if UDS_SERVER_STATS
+        srv->stats.dropped++;
+#endif
+        ReleaseRequest(scratch);
+        UDSTpAck(srv->tp);
+        return;
+    }
+
+    if (lent) {
+        StoreRequest(t->r, scratch->recv_buf, scratch->recv_len);
+        t->r->info = scratch->info;
+        ReleaseRequest(scratch);
+    } else {
+        // the request is already in the spare context: swap it with the tester's, which is idle
+        srv->rx = t->r;
+        t->r = scratch;
+        ReleaseRequest(srv->rx);
+    }
+    UDSTpAck(srv->tp);
+
+    LoadTester(srv, t);
+    ProcessRequest(srv, t->r);
+    StoreTester(srv, t);
+}
+
+#endif
+
+#if UDS_SERVER_ENABLE_0x86
+/**
+ * @brief Process the serviceToRespondToRecord of an event as if the tester had sent it. Returns
+ * false if the tester is busy; the event stays pending and is retried on the next poll.
+ */
+static bool ROERespond(UDSServer_t *srv, const UDSROEEvent_t *ev) {
+    if (SendBufInUse(srv)) {
+        return false;
+    }
+#if UDS_SERVER_MAX_TESTERS > 1
+    UDSServerTester_t *t = AcquireTester(srv, ev->ta);
+    if (NULL == t || t->requestInProgress || t->notReadyToReceive) {
+        return false;
+    }
+    UDSReq_t *r = t->r;
+#else
+    if (srv->requestInProgress || srv->notReadyToReceive) {
+        return false;
+    }
+    UDSReq_t *r = &srv->r;
+#endif
+    StoreRequest(r, ev->service, ev->serviceLen);
+    r->info = ev->info;
+#if UDS_SERVER_MAX_TESTERS > 1
+    LoadTester(srv, t);
+    ProcessRequest(srv, r);
+    StoreTester(srv, t);
+#else
+    ProcessRequest(srv, r);
+#endif
+    return true;
+}
+
+/**
+ * @brief Sample the monitored DIDs every UDS_SERVER_0x86_SAMPLE_MS and respond to the first pending
+ * event. A DID is only compared against its last value, so an unchanged DID costs one read and one
+ * memcmp. An event stops once its event window has ended.
+ */
+static void PollROE(UDSServer_t *srv) {
+    uint32_t now = srv->now;
+    bool sample = !UDSTimeAfter(srv->roeSampleTimer, now);
+    if (sample) {
+        srv->roeSampleTimer = now + UDS_SERVER_0x86_SAMPLE_MS;
+    }
+    for (int i = 0; i < srv->roeCount; i++) {
+        UDSROEEvent_t *ev = &srv->roe[i];
+        uint8_t data[UDS_SERVER_0x86_MAX_DATA_LEN];
+        uint16_t len = 0;
+        if (!ev->active) {
+            continue;
+        }
+        if (ROEWindowMs(ev->windowTime) > 0 && !UDSTimeAfter(ev->windowTimer, now)) {
+            ev->active = false;
+            ev->pending = false;
+            continue;
+        }
+        if (!sample || UDS_LEV_RE_ONDTCS == ev->eventType ||
+            UDS_PositiveResponse != ROEReadDID(srv, ROEDataIdentifier(ev), data, &len)) {
+            continue;
+        }
+        if (UDS_LEV_RE_OCODID == ev->eventType) {
+            if (0 != memcmp(ev->last, data, len)) {
+                memcpy(ev->last, data, len);
+                ROEFire(ev);
+            }
+        } else if (ROECompareFires(ev, data, len)) {
+            ROEFire(ev);
+        }
+    }
+
+    for (int i = 0; i < srv->roeCount; i++) {
+        UDSROEEvent_t *ev = &srv->roe[i];
+        if (ev->pending) {
+            if (ROERespond(srv, ev)) {
+                ev->pending = false;
+            }
+            return; // one response per poll
+        }
+    }
+}
+#endif
+
+#if UDS_SERVER_0x36_PIPELINE_DEPTH > 0
+/**
+ * @brief Hand the oldest buffered TransferData block to the sink
+ */
+static void PollTransferPipeline(UDSServer_t *srv) {
+    if (0 == srv->xferPipeCount || NULL == srv->xferWrite) {
+        return;
+    }
+
+    UDSXferBlock_t *blk = &srv->xferPipe[srv->xferPipeHead];
+    UDSErr_t err =
+        srv->xferWrite(srv, (uint8_t *)srv->xferPipeAddr + blk->offset, blk->data, blk->len);
+
+    if (UDS_NRC_RequestCorrectlyReceived_ResponsePending == err) {
+        return; // still busy with this block
+    }
+    if (UDS_PositiveResponse != err) {
+        UDS_LOGE(__FILE__, "xferWrite failed at offset %zu: %s\n", blk->offset, UDSErrToStr(err));
+        srv->xferPipeErr = err;
+        srv->xferPipeCount = 0;
+        return;
+    }
+    srv->xferPipeHead = (uint8_t)((srv->xferPipeHead + 1) % UDS_SERVER_0x36_PIPELINE_DEPTH);
+    srv->xferPipeCount--;
+}
+#endif
+
+/**
+ * @brief Time until the session state of one tester next needs servicing
+ */
+static uint32_t SessionDeadlineMs(uint32_t now, uint8_t sessionType, uint32_t s3_timer,
+                                  bool requestInProgress, uint32_t p2_timer) {
+    uint32_t ms = UDS_NO_DEADLINE;
+    if (UDS_LEV_DS_DS != sessionType) {
+        ms = UDSMillisUntil(now, s3_timer);
+    }
+    if (requestInProgress) {
+        uint32_t p2 = UDSMillisUntil(now, p2_timer);
+        ms = p2 < ms ? p2 : ms;
+    }
+    return ms;
+}
+
+// ========================================================================
+//                             Public Functions
+// ========================================================================
+
+UDSErr_t UDSServerInit(UDSServer_t *srv) {
+    if (NULL == srv) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    memset(srv, 0, sizeof(UDSServer_t));
+    ReleaseRequest(&srv->r);
+#if UDS_SERVER_MAX_TESTERS > 1
+    for (size_t i = 0; i < UDS_SERVER_MAX_TESTERS; i++) {
+        srv->testers[i].r = &srv->testerReqs[i];
+        ReleaseRequest(srv->testers[i].r);
+    }
+    srv->rx = &srv->r;
+#endif
+    srv->p2_ms = UDS_SERVER_DEFAULT_P2_MS;
+    srv->p2_star_ms = UDS_SERVER_DEFAULT_P2_STAR_MS;
+    srv->s3_ms = UDS_SERVER_DEFAULT_S3_MS;
+    srv->sessionType = UDS_LEV_DS_DS;
+    srv->now = UDSMillis();
+    srv->p2_timer = srv->now + srv->p2_ms;
+    srv->s3_session_timeout_timer = srv->now + srv->s3_ms;
+    srv->sec_access_boot_delay_timer =
+        srv->now + UDS_SERVER_0x27_BRUTE_FORCE_MITIGATION_BOOT_DELAY_MS;
+    srv->sec_access_auth_fail_timer = srv->now;
+    return UDS_OK;
+}
+
+UDSErr_t UDSServerRegisterDIDs(UDSServer_t *srv, UDSDIDEntry_t *table, size_t count) {
+    if (NULL == srv || (NULL == table && count > 0)) {
+        return UDS_ERR_INVALID_ARG;
+    }
+
+    // insertion sort: tables are registered once at startup and are often already sorted
+    for (size_t i = 1; i < count; i++) {
+        UDSDIDEntry_t tmp = table[i];
+        size_t j = i;
+        while (j > 0 && table[j - 1].did > tmp.did) {
+            table[j] = table[j - 1];
+            j--;
+        }
+        table[j] = tmp;
+    }
+
+    for (size_t i = 1; i < count; i++) {
+        if (table[i - 1].did == table[i].did) {
+            UDS_LOGE(__FILE__, "duplicate DID 0x%04X in table", table[i].did);
+            return UDS_ERR_INVALID_ARG;
+        }
+    }
+
+    srv->didTable = table;
+    srv->didTableLen = count;
+#if UDS_SERVER_DID_CACHE_ENTRIES > 0
+    memset(srv->didCache, 0, sizeof(srv->didCache));
+#endif
+    return UDS_OK;
+}
+
+void UDSServerInvalidateDID(UDSServer_t *srv, uint16_t did) {
+#if UDS_SERVER_DID_CACHE_ENTRIES > 0
+    UDSDIDSnapshot_t *c = srv ? FindCachedDID(srv, did) : NULL;
+    if (c) {
+        c->len = 0;
+    }
+#else
+    (void)srv;
+    (void)did;
+#endif
+}
+
+UDSErr_t UDSServerRegisterMemRegions(UDSServer_t *srv, const UDSMemRegion_t *table, size_t count) {
+    if (NULL == srv || (NULL == table && count > 0)) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (table[i].len > 0 && table[i].len - 1 > UINTPTR_MAX - table[i].start) {
+            UDS_LOGE(__FILE__, "memory region %zu wraps around the address space", i);
+            return UDS_ERR_INVALID_ARG;
+        }
+    }
+    srv->memRegions = table;
+    srv->memRegionsLen = count;
+    return UDS_OK;
+}
+
+UDSErr_t UDSServerRegisterRoutines(UDSServer_t *srv, UDSRoutineEntry_t *table, size_t count) {
+    if (NULL == srv || (NULL == table && count > 0)) {
+        return UDS_ERR_INVALID_ARG;
+    }
+
+    // insertion sort: generated tables are already sorted
+    for (size_t i = 1; i < count; i++) {
+        UDSRoutineEntry_t tmp = table[i];
+        size_t j = i;
+        while (j > 0 && table[j - 1].rid > tmp.rid) {
+            table[j] = table[j - 1];
+            j--;
+        }
+        table[j] = tmp;
+    }
+
+    for (size_t i = 1; i < count; i++) {
+        if (table[i - 1].rid == table[i].rid) {
+            UDS_LOGE(__FILE__, "duplicate RID 0x%04X in table", table[i].rid);
+            return UDS_ERR_INVALID_ARG;
+        }
+    }
+
+    srv->routineTable = table;
+    srv->routineTableLen = count;
+    return UDS_OK;
+}
+
+UDSErr_t UDSServerRegisterDTCStore(UDSServer_t *srv, UDSDTCStore_t *store) {
+    if (NULL == srv) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    srv->dtcStore = store;
+    return UDS_OK;
+}
+
+UDSErr_t UDSServerRegisterDTCLog(UDSServer_t *srv, UDSDTCLog_t *log) {
+    if (NULL == srv) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    srv->dtcLog = log;
+    return UDS_OK;
+}
+
+UDSErr_t UDSServerDeferResponse(UDSServer_t *srv, UDSPendingToken_t *token) {
+    if (NULL == srv || NULL == token) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    UDSReq_t *r = ActiveRequest(srv);
+    if (0 == r->recv_len || PENDING_NONE != r->pendingState) {
+        return UDS_ERR_MISUSE;
+    }
+    if (0 == ++srv->lastPendingToken) {
+        srv->lastPendingToken = 1;
+    }
+    r->pendingToken = srv->lastPendingToken;
+    r->pendingEvt = r->deferEvt;
+    r->pendingId = r->deferId;
+    PENDING_STORE(&r->pendingState, PENDING_WAIT);
+    *token = r->pendingToken;
+    return UDS_NRC_RequestCorrectlyReceived_ResponsePending;
+}
+
+UDSErr_t UDSServerCompleteResponse(UDSServer_t *srv, UDSPendingToken_t token, UDSErr_t nrc,
+                                   const uint8_t *data, uint16_t len) {
+    if (NULL == srv || 0 == token || (NULL == data && len > 0) ||
+        UDS_NRC_RequestCorrectlyReceived_ResponsePending == nrc) {
+        return UDS_ERR_INVALID_ARG;
+    }
+
+    UDSReq_t *r = NULL;
+#if UDS_SERVER_MAX_TESTERS > 1
+    for (size_t i = 0; i < UDS_SERVER_MAX_TESTERS; i++) {
+        if (srv->testers[i].inUse && srv->testers[i].r->pendingToken == token) {
+            r = srv->testers[i].r;
+            break;
+        }
+    }
+#else
+    if (srv->r.pendingToken == token) {
+        r = &srv->r;
+    }
+#endif
+    if (NULL == r || PENDING_WAIT != PENDING_LOAD(&r->pendingState)) {
+        return UDS_ERR_INVALID_ARG;
+    }
+
+    r->pendingNrc = nrc;
+    r->pendingData = data;
+    r->pendingLen = len;
+    PENDING_STORE(&r->pendingState, PENDING_DONE); // publish last: may be called from an interrupt
+    return UDS_OK;
+}
+
+bool UDSServerRequestIsSecured(UDSServer_t *srv) {
+    return srv && UDS_A_MTYPE_SECURE_DIAG == ActiveRequest(srv)->info.A_Mtype;
+}
+
+void UDSServerNotifyDTCStatusChange(UDSServer_t *srv, uint8_t oldStatus, uint8_t newStatus) {
+#if UDS_SERVER_ENABLE_0x86
+    if (NULL == srv) {
+        return;
+    }
+    for (int i = 0; i < srv->roeCount; i++) {
+        UDSROEEvent_t *ev = &srv->roe[i];
+        if (ev->active && UDS_LEV_RE_ONDTCS == ev->eventType &&
+            ((oldStatus ^ newStatus) & ev->record[0])) {
+            ROEFire(ev);
+        }
+    }
+#else
+    (void)srv;
+    (void)oldStatus;
+    (void)newStatus;
+#endif
+}
+
+uint32_t UDSServerNextDeadlineMs(const UDSServer_t *srv) {
+    return UDSServerNextDeadlineMsAt(srv, UDSMillis());
+}
+
+uint32_t UDSServerNextDeadlineMsAt(const UDSServer_t *srv, uint32_t now) {
+    if (NULL == srv) {
+        return UDS_NO_DEADLINE;
+    }
+    if (srv->tpStatus & UDS_TP_SEND_IN_PROGRESS) {
+        return 0; // the transport paces multi-frame transmission from within poll
+    }
+
+    uint32_t ms = UDS_NO_DEADLINE;
+
+    if (srv->ecuResetScheduled) {
+        ms = UDSMillisUntil(now, srv->ecuResetTimer);
+    }
+
+#if UDS_SERVER_0x36_PIPELINE_DEPTH > 0
+    if (srv->xferPipeCount > 0) {
+        return 0; // buffered blocks are written from poll
+    }
+#endif
+
+#if UDS_SERVER_RCRRP_QUEUE_LEN > 0
+    if (srv->queueCount > 0 && !srv->requestInProgress) {
+        return 0; // the next queued request is processed on the next poll
+    }
+#endif
+
+#if UDS_SERVER_MAX_TESTERS > 1
+    for (size_t i = 0; i < UDS_SERVER_MAX_TESTERS; i++) {
+        const UDSServerTester_t *t = &srv->testers[i];
+        if (!t->inUse) {
+            continue;
+        }
+        uint32_t tester_ms = SessionDeadlineMs(now, t->sessionType, t->s3_session_timeout_timer,
+                                               t->requestInProgress, t->p2_timer);
+        ms = tester_ms < ms ? tester_ms : ms;
+    }
+#else
+    uint32_t session_ms = SessionDeadlineMs(now, srv->sessionType, srv->s3_session_timeout_timer,
+                                            srv->requestInProgress, srv->p2_timer);
+    ms = session_ms < ms ? session_ms : ms;
+#endif
+
+#if UDS_SERVER_ENABLE_0x86
+    for (int i = 0; i < srv->roeCount; i++) {
+        const UDSROEEvent_t *ev = &srv->roe[i];
+        if (!ev->active) {
+            continue;
+        }
+        bool respond = ev->pending && !TesterIsBusy(srv, ev->ta);
+        uint32_t roe_ms = respond ? 0 : UDSMillisUntil(now, srv->roeSampleTimer - 1);
+        ms = roe_ms < ms ? roe_ms : ms;
+        if (ROEWindowMs(ev->windowTime) > 0) {
+            uint32_t window_ms = UDSMillisUntil(now, ev->windowTimer - 1);
+            ms = window_ms < ms ? window_ms : ms;
+        }
+    }
+#endif
+
+#if UDS_SERVER_ENABLE_0x2A
+    for (int i = 0; i < srv->periodicCount; i++) {
+        if (TesterIsBusy(srv, srv->periodic[i].ta)) {
+            continue; // resumes once the response has been sent
+        }
+        uint32_t periodic_ms = UDSMillisUntil(now, srv->periodic[i].timer - 1); // due at the timer
+        ms = periodic_ms < ms ? periodic_ms : ms;
+    }
+#endif
+    return ms;
+}
+
+void UDSServerPoll(UDSServer_t *srv) { UDSServerPollAt(srv, UDSMillis()); }
+
+void UDSServerPollAt(UDSServer_t *srv, uint32_t now) {
+    srv->now = now;
+#if UDS_SERVER_MAX_TESTERS > 1
+    if (srv->ecuResetScheduled && UDSTimeAfter(now, srv->ecuResetTimer)) {
+        EmitEvent(srv, UDS_EVT_DoScheduledReset, &srv->ecuResetScheduled);
+    }
+
+    srv->tpStatus = UDSTpPoll(srv->tp);
+    PollTesters(srv);
+    ReceiveTesterRequest(srv);
+#if UDS_SERVER_ENABLE_0x86
+    PollROE(srv);
+#endif
+#if UDS_SERVER_ENABLE_0x2A
+    PollPeriodic(srv);
+#endif
+#if UDS_SERVER_0x36_PIPELINE_DEPTH > 0
+    PollTransferPipeline(srv);
+#endif
+#else
+    PollSessionTimeout(srv);
+
+    if (srv->ecuResetScheduled && UDSTimeAfter(now, srv->ecuResetTimer)) {
+        EmitEvent(srv, UDS_EVT_DoScheduledReset, &srv->ecuResetScheduled);
+    }
+
+    srv->tpStatus = UDSTpPoll(srv->tp);
+
+    UDSReq_t *r = &srv->r;
+
+    if (srv->requestInProgress) {
+        PollRequestInProgress(srv, r, NULL);
+#if UDS_SERVER_RCRRP_QUEUE_LEN > 0
+        if (srv->RCRRP && !srv->notReadyToReceive) {
+            ReceiveWhilePending(srv);
+        }
+#endif
+    } else if (srv->notReadyToReceive) {
+        ; // cannot respond to request right now
+    } else if (SendBufInUse(srv)) {
+        ; // the last response is still being sent from send_buf
+#if UDS_SERVER_RCRRP_QUEUE_LEN > 0
+    } else if (ProcessQueuedRequest(srv, r)) {
+        ; // requests received while the previous one was pending go first
+#endif
+    } else {
+        ssize_t len = UDSTpPeek(srv->tp, REQ_STORAGE(r), sizeof(REQ_STORAGE(r)), &r->recv_buf,
+                                &r->info);
+        if (len < 0) {
+            UDS_LOGE(__FILE__, "UDSTpPeek failed with %zd\n", len);
+#if UDS_SERVER_STATS
+            srv->stats.tpErrors++;
+#endif
+        } else if (len > 0) {
+            r->recv_borrowed = true;
+            if (AcceptRequest(r, (size_t)len)) {
+                ProcessRequest(srv, r);
+            } else {
+                UDS_LOGW(__FILE__, "request of %zd bytes does not fit, dropping it", len);
+#if UDS_SERVER_STATS
+                srv->stats.dropped++;
+#endif
             }
         }
     }
+#if UDS_SERVER_RCRRP_QUEUE_LEN > 0
+    if (r->recv_borrowed && srv->RCRRP) {
+        ReleasePendingRequest(srv, r);
+    }
+#endif
+    // a request that is still in progress is evaluated again from recv_buf, so the transport
+    // buffer is only released once the response is final
+    if (r->recv_borrowed && !srv->requestInProgress) {
+        r->recv_borrowed = false;
+        ReleaseRequest(r);
+        UDSTpAck(srv->tp);
+    }
+#if UDS_SERVER_ENABLE_0x86
+    PollROE(srv);
+#endif
+#if UDS_SERVER_ENABLE_0x2A
+    PollPeriodic(srv);
+#endif
+#if UDS_SERVER_0x36_PIPELINE_DEPTH > 0
+    PollTransferPipeline(srv);
+#endif
+#endif
 }
@@ -4,19 +4,304 @@
 #include "tp.h"
 #include "uds.h"
 #include "config.h"
+#include "dtc.h"
+#include "lz.h"
+#include "stats.h"
+
+/**
+ * @brief Identifies a request whose response has been deferred with UDSServerDeferResponse. 0 is
+ * never a valid token.
+ */
+typedef uint32_t UDSPendingToken_t;
+
+/**
+ * @brief Progress of 0x29 Authentication
+ */
+typedef enum {
+    UDS_AUTH_NONE = 0,       /**< not authenticated */
+    UDS_AUTH_CERT_VERIFIED,  /**< certificate verified, proofOfOwnership expected */
+    UDS_AUTH_CHALLENGE_SENT, /**< challenge sent, verifyProofOfOwnership expected */
+    UDS_AUTH_AUTHENTICATED,  /**< ownership verified */
+} UDSAuthState_t;
 
 /**
  * @brief Server request context
  */
 typedef struct {
-    uint8_t recv_buf[UDS_SERVER_RECV_BUF_SIZE]; /**< receive buffer */
-    uint8_t send_buf[UDS_SERVER_SEND_BUF_SIZE]; /**< send buffer */
-    size_t recv_len;                            /**< received data length */
-    size_t send_len;                            /**< send data length */
-    size_t send_buf_size;                       /**< send buffer size */
-    UDSSDU_t info;                              /**< service data unit information */
+#if !UDS_SERVER_SHARED_BUF
+    uint8_t recv_storage[UDS_SERVER_RECV_BUF_SIZE]; /**< receive buffer */
+#endif // otherwise requests are stored at the end of send_buf
+    uint8_t send_buf[UDS_SERVER_SEND_BUF_SIZE];     /**< send buffer */
+    size_t recv_len;                                /**< received data length */
+    size_t send_len;                                /**< send data length */
+    size_t send_buf_size;                           /**< space in send_buf for the response */
+    UDSSDU_t info;                                  /**< service data unit information */
+
+    const uint8_t *recv_buf; /**< received data, in recv_storage or lent by UDSTpPeek() */
+    bool recv_borrowed;      /**< recv_buf is lent by the transport and must be acknowledged */
+
+    UDSPendingToken_t pendingToken; /**< token of the deferred response, 0 if not deferred */
+    volatile uint8_t pendingState;  /**< progress of the deferred response */
+    uint8_t pendingEvt;             /**< event the response was deferred from */
+    uintptr_t pendingId;            /**< DID or address the response was deferred for */
+    UDSErr_t pendingNrc;            /**< result passed to UDSServerCompleteResponse */
+    const uint8_t *pendingData;     /**< response data passed to UDSServerCompleteResponse */
+    uint16_t pendingLen;            /**< length of pendingData */
+    uint8_t deferEvt;               /**< event being handled, recorded by UDSServerDeferResponse */
+    uintptr_t deferId;              /**< DID or address of that event */
+
+#if UDS_SERVER_RCRRP_QUEUE_LEN > 0
+    bool recv_pinned; /**< recv_buf is the source of a deferred memory write and must not move */
+#endif
+#if UDS_SERVER_ENABLE_0x84
+    bool securedUnwrapped; /**< 0x84 internal request decrypted, its response is pending */
+#endif
+#if UDS_SERVER_STATS
+    uint32_t statsStartUs; /**< UDSMicros() when the request was received */
+#endif
 } UDSReq_t;
 
+/**
+ * @brief A request received while the response to another one is pending (0x78)
+ */
+typedef struct {
+    uint8_t buf[UDS_SERVER_RCRRP_QUEUE_BUF_SIZE]; /**< request */
+    uint16_t len;                                 /**< length of the request */
+    UDSSDU_t info;                                /**< addressing of the request */
+} UDSQueuedReq_t;
+
+/**
+ * @brief A TransferData block waiting in the 0x36 write-behind pipeline
+ */
+typedef struct {
+    size_t offset;                                     /**< offset from the download address */
+    uint16_t len;                                      /**< number of bytes in data */
+    uint8_t data[UDS_SERVER_0x36_PIPELINE_BLOCK_SIZE]; /**< transferRequestParameterRecord */
+} UDSXferBlock_t;
+
+/**
+ * @brief Progress of a download that can be saved and restored to resume it after a reset
+ * @details Passed to UDS_EVT_TransferCheckpoint to be persisted, and returned by the
+ * UDS_EVT_RequestFileTransfer handler for 0x38 ResumeFile.
+ */
+typedef struct {
+    size_t byteCounter;           /**< number of bytes accepted by UDS_EVT_TransferData */
+    uint8_t blockSequenceCounter; /**< blockSequenceCounter of the last accepted block */
+    uint32_t crc;                 /**< UDSCRC32 of the first byteCounter bytes */
+} UDSXferCheckpoint_t;
+
+/**
+ * @brief A periodicDataIdentifier scheduled with 0x2A ReadDataByPeriodicIdentifier
+ */
+typedef struct {
+    uint8_t pdid;   /**< periodicDataIdentifier (low byte of DID 0xF2xx) */
+    uint8_t mode;   /**< transmissionMode (UDS_LEV_TM_SASR, _SAMR or _SAFR) */
+    uint32_t timer; /**< time at which the identifier is next due */
+    uint32_t ta;    /**< target address of the tester that scheduled it */
+} UDSPeriodicDID_t;
+
+/**
+ * @brief An event logic set up with 0x86 ResponseOnEvent
+ */
+typedef struct {
+    uint8_t eventType;                                /**< UDS_LEV_RE_ONDTCS, _OCODID or _OCOV */
+    uint8_t windowTime;                               /**< eventWindowTime */
+    uint8_t record[10];                               /**< eventTypeRecord */
+    uint8_t recordLen;                                /**< length of record */
+    uint8_t service[UDS_SERVER_0x86_MAX_SERVICE_LEN]; /**< serviceToRespondToRecord */
+    uint8_t serviceLen;                               /**< length of service */
+    uint8_t last[UDS_SERVER_0x86_MAX_DATA_LEN];       /**< last sampled value of the DID */
+    uint32_t ta;          /**< target address of the tester that set up the event */
+    UDSSDU_t info;        /**< addressing of the request that set up the event */
+    uint32_t windowTimer; /**< time at which a finite event window ends */
+    uint8_t identified;   /**< number of times the event occurred since it was started */
+
+    bool active;  /**< started and within its event window */
+    bool armed;   /**< onComparisonOfValues: fires when the comparison next becomes true */
+    bool pending; /**< the event occurred and the response has not been sent yet */
+} UDSROEEvent_t;
+
+/**
+ * @brief One step of the copy plan of a dynamically defined data identifier
+ */
+typedef struct {
+    uint8_t type;          /**< 0x01 defineByIdentifier or 0x02 defineByMemoryAddress */
+    uint16_t sourceDataId; /**< defineByIdentifier: source DID */
+    uint16_t offset;       /**< defineByIdentifier: offset into the source data record */
+    uint16_t size;         /**< number of bytes to copy */
+    void *memAddr;         /**< defineByMemoryAddress: source address */
+} UDSDDDIElement_t;
+
+/**
+ * @brief A data identifier defined with 0x2C DynamicallyDefineDataIdentifier
+ */
+typedef struct {
+    uint16_t did;                                            /**< dynamicDataId */
+    uint8_t count;                                           /**< number of elements in use */
+    UDSDDDIElement_t elements[UDS_SERVER_0x2C_MAX_ELEMENTS]; /**< copy plan, in order */
+} UDSDDDIDefinition_t;
+
+#if UDS_SERVER_MAX_TESTERS > 1
+/**
+ * @brief Per-tester context
+ * @details Used when UDS_SERVER_MAX_TESTERS > 1. Testers are distinguished by the source address
+ * (UDSSDU_t.A_SA) of their requests. While a tester is being served its state is loaded into the
+ * corresponding UDSServer_t fields, so service handlers and the user callback see the session of
+ * the tester that sent the request.
+ */
+typedef struct {
+    bool inUse;  /**< this slot is assigned to a tester */
+    uint32_t sa; /**< source address of the tester */
+
+    uint32_t p2_timer;                   /**< see UDSServer_t */
+    uint32_t s3_session_timeout_timer;   /**< see UDSServer_t */
+    uint32_t sec_access_auth_fail_timer; /**< see UDSServer_t */
+    bool xferIsActive;                   /**< see UDSServer_t */
+    uint8_t xferBlockSequenceCounter;    /**< see UDSServer_t */
+    size_t xferTotalBytes;               /**< see UDSServer_t */
+    size_t xferByteCounter;              /**< see UDSServer_t */
+    size_t xferBlockLength;              /**< see UDSServer_t */
+    bool xferIsPipelined;                /**< see UDSServer_t */
+    bool xferIsCompressed;               /**< see UDSServer_t */
+    uint32_t xferCrc;                    /**< see UDSServer_t */
+    uint32_t xferLastCrc;                /**< see UDSServer_t */
+    size_t xferLastByteCount;            /**< see UDSServer_t */
+    uint8_t sessionType;                 /**< see UDSServer_t */
+    uint8_t securityLevel;               /**< see UDSServer_t */
+    uint8_t authState;                   /**< see UDSServer_t */
+    bool RCRRP;                          /**< see UDSServer_t */
+    bool requestInProgress;              /**< see UDSServer_t */
+    bool notReadyToReceive;              /**< see UDSServer_t */
+#if UDS_SERVER_ENABLE_0x83
+    bool atpActive;        /**< see UDSServer_t */
+    uint16_t atpP2_ms;     /**< p2_ms set by 0x83 while atpActive */
+    uint32_t atpP2Star_ms; /**< p2_star_ms set by 0x83 while atpActive */
+#endif
+
+    UDSReq_t *r; /**< request context of this tester, one of UDSServer_t.testerReqs or r */
+} UDSServerTester_t;
+#endif
+
+struct UDSServer;
+struct UDSRoutineEntry;
+
+#define UDS_DID_READ 0x1  /**< UDSDIDEntry_t.access: readable with 0x22 */
+#define UDS_DID_WRITE 0x2 /**< UDSDIDEntry_t.access: writable with 0x2E */
+
+/**
+ * @brief Registered data identifier
+ * @details Registered DIDs are served by the server without emitting UDS_EVT_ReadDataByIdent or
+ * UDS_EVT_WriteDataByIdent. Entries that have neither `ptr` nor a `read`/`write` function fall
+ * back to the event, as do DIDs that are not registered at all.
+ */
+typedef struct UDSDIDEntry {
+    uint16_t did;         /**< data identifier */
+    uint16_t len;         /**< size of the data record in bytes */
+    void *ptr;            /**< optional: data record storage, served with memcpy */
+    uint32_t sessionMask; /**< sessions in which the DID is accessible (UDS_SESSION_BIT()). 0: any
+                             session. Sessions above 0x20 are only allowed when this is 0 */
+    uint8_t access;       /**< UDS_DID_READ and/or UDS_DID_WRITE */
+    uint32_t cacheMs;     /**< optional: serve the record produced by `read` or the event from the
+                             DID cache for up to this long. 0: not cached */
+    const volatile uint32_t *version; /**< optional: the cached record is produced again once
+                                         *version differs from its value when it was cached */
+
+    /*! optional: produce exactly `len` bytes of the data record into `dst` */
+    UDSErr_t (*read)(struct UDSServer *srv, const struct UDSDIDEntry *entry, uint8_t *dst);
+    /*! optional: consume a data record of `len` bytes */
+    UDSErr_t (*write)(struct UDSServer *srv, const struct UDSDIDEntry *entry, const uint8_t *src,
+                      uint16_t len);
+
+    uint8_t securityLevel; /**< SecurityAccess level required to read or write the DID. 0: none */
+} UDSDIDEntry_t;
+
+#define UDS_MEM_READ 0x1  /**< UDSMemRegion_t.access: readable with 0x23 */
+#define UDS_MEM_WRITE 0x2 /**< UDSMemRegion_t.access: writable with 0x3D */
+
+/**
+ * @brief Registered memory region
+ * @details Requests of 0x23 ReadMemoryByAddress and 0x3D WriteMemoryByAddress that fall inside of a
+ * region are served by the server without emitting UDS_EVT_ReadMemByAddr or
+ * UDS_EVT_WriteMemByAddr. Once a table is registered, addresses outside of every region are
+ * refused with 0x31. The copy functions may start a DMA or external flash transfer, call
+ * UDSServerDeferResponse and return its result; the transfer is then finished with
+ * UDSServerCompleteResponse(srv, token, result, NULL, 0).
+ */
+typedef struct UDSMemRegion {
+    uintptr_t start;       /**< first address of the region */
+    size_t len;            /**< size of the region in bytes */
+    uint8_t access;        /**< UDS_MEM_READ and/or UDS_MEM_WRITE */
+    uint32_t sessionMask;  /**< sessions in which the region is accessible (UDS_SESSION_BIT()). 0:
+                              any session */
+    uint8_t securityLevel; /**< SecurityAccess level required to access the region. 0: none */
+    void *ctx;             /**< optional: context of the copy functions, e.g. a flash device */
+
+    /*! optional: copy `len` bytes at `addr` to `dst`. NULL: memcpy */
+    UDSErr_t (*read)(struct UDSServer *srv, const struct UDSMemRegion *region, uintptr_t addr,
+                     uint8_t *dst, size_t len);
+    /*! optional: copy `len` bytes from `src` to `addr`. NULL: memcpy */
+    UDSErr_t (*write)(struct UDSServer *srv, const struct UDSMemRegion *region, uintptr_t addr,
+                      const uint8_t *src, size_t len);
+} UDSMemRegion_t;
+
+/**
+ * @brief Security header of a 0x84 SecuredDataTransmission message
+ */
+typedef struct {
+    uint16_t administrativeParameter;       /**< UDS_SDT_AP_* */
+    uint8_t signatureEncryptionCalculation; /**< vehicle manufacturer specific algorithm */
+    uint16_t signatureLength;               /**< length of the signature/MAC */
+    uint16_t antiReplayCounter;             /**< counter of the message */
+} UDSSecuredHeader_t;
+
+/**
+ * @brief Cryptography of 0x84 SecuredDataTransmission
+ * @details Each function is called once per message with the whole payload, so that a hardware
+ * accelerator (e.g. S32K CSEc, ESP32 AES) can process every block of it in one job. The payload
+ * is the internal message from its service ID to the end of its parameters.
+ */
+typedef struct UDSSecuredProvider {
+    /**
+     * @brief Verify the signature and anti-replay counter of a request and decrypt it
+     * @param ctx provider context
+     * @param hdr security header of the request
+     * @param in payload as received
+     * @param out destination of the decrypted payload, which may be `in`. NULL if the request is
+     * not encrypted
+     * @param len length of the payload
+     * @param sig signature of hdr->signatureLength bytes
+     * @return UDS_PositiveResponse or the negative response code of the 0x84 request
+     */
+    UDSErr_t (*unwrap)(void *ctx, const UDSSecuredHeader_t *hdr, const uint8_t *in, uint8_t *out,
+                       uint16_t len, const uint8_t *sig);
+    /**
+     * @brief Encrypt a response in place and append its signature
+     * @param ctx provider context
+     * @param hdr security header of the response, initialized from the request. Set
+     * hdr->signatureLength to the number of bytes written to sig
+     * @param data payload, encrypted in place if hdr->administrativeParameter asks for it
+     * @param len length of the payload
+     * @param sig destination of the signature
+     * @param sigSize space at sig
+     * @return UDS_PositiveResponse or the negative response code of the 0x84 request
+     */
+    UDSErr_t (*wrap)(void *ctx, UDSSecuredHeader_t *hdr, uint8_t *data, uint16_t len, uint8_t *sig,
+                     uint16_t sigSize);
+    void *ctx; /**< passed to unwrap and wrap */
+} UDSSecuredProvider_t;
+
+/**
+ * @brief Data record kept by the DID cache
+ */
+typedef struct {
+    uint16_t did;      /**< data identifier */
+    uint16_t len;      /**< length of data, 0 if the slot is free */
+    uint32_t version;  /**< *UDSDIDEntry_t.version when the record was produced */
+    uint32_t filledAt; /**< srv->now when the record was produced */
+    uint32_t usedAt;   /**< srv->didCacheTick when the record was last produced or served */
+    uint8_t data[UDS_SERVER_DID_CACHE_RECORD_SIZE]; /**< data record */
+} UDSDIDSnapshot_t;
+
 /**
  * @brief UDS server structure
  */
@@ -32,6 +317,14 @@ typedef struct UDSServer {
     uint32_t p2_star_ms; /**< Enhanced (NRC 0x78) P2_server_max supported by the server */
     uint16_t s3_ms;      /**< Session timeout */
 
+#if UDS_SERVER_ENABLE_0x83
+    uint16_t atpDefaultP2_ms;      /**< p2_ms before 0x83 changed it, the longest P2 accepted */
+    uint32_t atpDefaultP2Star_ms;  /**< p2_star_ms before 0x83 changed it */
+    bool atpActive;                /**< p2_ms and p2_star_ms have been set by 0x83 */
+#endif
+
+    uint32_t now; /**< UDSMillis() at the start of the current poll. Timers and handlers use it
+                     instead of reading the clock again */
     uint8_t ecuResetScheduled;         /**< nonzero indicates that an ECUReset has been scheduled */
     uint32_t ecuResetTimer;            /**< for delaying resetting until a response has been sent */
     uint32_t p2_timer;                 /**< for rate limiting server responses */
@@ -39,6 +332,7 @@ typedef struct UDSServer {
     uint32_t sec_access_auth_fail_timer;  /**< brute-force hardening: rate limit security access */
     uint32_t sec_access_boot_delay_timer; /**< brute-force hardening: restrict security access until
                                              timer expires */
+    UDSTpStatus_t tpStatus; /**< transport status from the most recent poll */
 
     /**
      * @brief UDS-1-2013: Table 407 - 0x36 TransferData Supported negative
@@ -51,9 +345,64 @@ typedef struct UDSServer {
     size_t xferTotalBytes;            /**< total transfer size in bytes requested by the client */
     size_t xferByteCounter;           /**< total number of bytes transferred */
     size_t xferBlockLength;           /**< block length (convenience for the TransferData API) */
+    bool xferIsPipelined;             /**< the active download goes through the 0x36 pipeline */
+    bool xferIsCompressed;            /**< the active download is decompressed before it is passed
+                                         to UDS_EVT_TransferData */
+    uint32_t xferCrc;                 /**< UDSCRC32 of the bytes transferred so far */
+    uint32_t xferLastCrc;             /**< xferCrc of the last download ended by 0x37 */
+    size_t xferLastByteCount;         /**< xferByteCounter of the last download ended by 0x37 */
+
+    /**
+     * @brief Optional replacement for UDSCRC32, for example a hardware CRC unit. Must compute the
+     * same CRC-32 so that checkpoints stay valid.
+     */
+    uint32_t (*xferCrcUpdate)(struct UDSServer *srv, uint32_t crc, const uint8_t *data,
+                              uint16_t len);
+
+    /**
+     * @brief Optional digest hook called with the data of every download in order, after the data
+     * has been accepted. The state of the digest (e.g. a SHA-256 context) is kept by the
+     * application, which starts it in UDS_EVT_RequestDownload or UDS_EVT_RequestFileTransfer.
+     */
+    void (*xferDigestUpdate)(struct UDSServer *srv, const uint8_t *data, uint16_t len);
+
+    /**
+     * @brief Emit UDS_EVT_TransferCheckpoint every time this many more bytes of a download have
+     * been accepted by UDS_EVT_TransferData, and when the download is complete. 0 disables
+     * checkpoints.
+     * @details Compressed and pipelined downloads do not produce checkpoints.
+     */
+    size_t xferCheckpointInterval;
+
+#if UDS_SERVER_0x36_PIPELINE_DEPTH > 0
+    /**
+     * @brief Sink for the 0x36 write-behind pipeline. When set, downloads started with 0x34 are
+     * written here instead of emitting UDS_EVT_TransferData.
+     * @details Called from UDSServerPoll with one block at a time, at the address given in the
+     * RequestDownload plus the offset of the block. Return UDS_PositiveResponse when the block has
+     * been written, UDS_NRC_RequestCorrectlyReceived_ResponsePending to be called again with the
+     * same block on a later poll, or an NRC to fail the download. The NRC is returned to the next
+     * 0x36 or 0x37 request.
+     */
+    UDSErr_t (*xferWrite)(struct UDSServer *srv, void *addr, const uint8_t *data, uint16_t len);
+    UDSXferBlock_t xferPipe[UDS_SERVER_0x36_PIPELINE_DEPTH]; /**< write-behind block buffers */
+
+    uint8_t xferPipeHead;  /**< oldest buffer in xferPipe */
+    uint8_t xferPipeCount; /**< number of buffers waiting for xferWrite */
+    void *xferPipeAddr;    /**< memoryAddress of the pipelined download */
+    UDSErr_t xferPipeErr;  /**< first error returned by xferWrite */
+    bool xferPipeActive;   /**< a tester's download owns the pipeline */
+#endif
+
+#if UDS_SERVER_0x36_DECOMPRESS
+    UDSLZDecoder_t xferLz; /**< decoder of the compressed download */
+    size_t xferLzInPos;    /**< bytes of the current 0x36 request that have been decoded */
+    bool xferLzActive;     /**< a tester's download owns the decoder */
+#endif
 
     uint8_t sessionType;   /**< diagnostic session type (0x10) */
     uint8_t securityLevel; /**< SecurityAccess (0x27) level */
+    uint8_t authState;     /**< Authentication (0x29) progress, a UDSAuthState_t */
 
     bool RCRRP;             /**< set to true when user fn returns 0x78 and false otherwise */
     bool requestInProgress; /**< set to true when a request has been processed but the response has
@@ -70,6 +419,65 @@ typedef struct UDSServer {
     bool notReadyToReceive; /**< incoming ISO-TP data will not be processed */
 
     UDSReq_t r; /**< request context */
+
+#if UDS_SERVER_RCRRP_QUEUE_LEN > 0
+    UDSQueuedReq_t queue[UDS_SERVER_RCRRP_QUEUE_LEN]; /**< requests received while RCRRP */
+    uint8_t queueHead;  /**< index of the oldest queued request */
+    uint8_t queueCount; /**< number of queued requests */
+#endif
+
+    UDSPendingToken_t lastPendingToken; /**< most recently issued deferred-response token */
+
+#if UDS_SERVER_ENABLE_0x2A
+    UDSPeriodicDID_t periodic[UDS_SERVER_0x2A_MAX_PDIDS]; /**< scheduled periodicDataIdentifiers */
+    uint8_t periodicCount; /**< number of entries in use in periodic */
+    uint8_t periodicNext;  /**< round-robin position of the periodic scheduler */
+#endif
+
+#if UDS_SERVER_ENABLE_0x86
+    UDSROEEvent_t roe[UDS_SERVER_0x86_MAX_EVENTS]; /**< ResponseOnEvent event logics */
+    uint8_t roeCount;        /**< number of entries in use in roe */
+    uint32_t roeSampleTimer; /**< time at which monitored DIDs are next sampled */
+#endif
+
+#if UDS_SERVER_ENABLE_0x2C
+    UDSDDDIDefinition_t dddi[UDS_SERVER_0x2C_MAX_DIDS]; /**< dynamically defined DIDs */
+    uint8_t dddiCount;                                  /**< number of entries in use in dddi */
+#endif
+
+    UDSDIDEntry_t *didTable; /**< registered data identifiers sorted by DID (UDSServerRegisterDIDs) */
+    size_t didTableLen;      /**< number of entries in didTable */
+
+    struct UDSRoutineEntry *routineTable; /**< registered routines sorted by RID
+                                             (UDSServerRegisterRoutines) */
+    size_t routineTableLen;               /**< number of entries in routineTable */
+
+    const UDSMemRegion_t *memRegions; /**< regions of 0x23, 0x2C and 0x3D
+                                         (UDSServerRegisterMemRegions) */
+    size_t memRegionsLen;             /**< number of entries in memRegions */
+
+    UDSDTCStore_t *dtcStore; /**< DTC database used by 0x14 and 0x19 (UDSServerRegisterDTCStore) */
+    UDSDTCLog_t *dtcLog;     /**< snapshot and extended data records (UDSServerRegisterDTCLog) */
+
+#if UDS_SERVER_DID_CACHE_ENTRIES > 0
+    UDSDIDSnapshot_t didCache[UDS_SERVER_DID_CACHE_ENTRIES]; /**< cached DID records */
+    uint32_t didCacheTick; /**< incremented on every cache access, orders didCache by use */
+#endif
+
+#if UDS_SERVER_ENABLE_0x84
+    const UDSSecuredProvider_t *secured; /**< cryptography of 0x84. NULL rejects 0x84 with 0x22 */
+#endif
+
+#if UDS_SERVER_MAX_TESTERS > 1
+    UDSServerTester_t testers[UDS_SERVER_MAX_TESTERS]; /**< per-tester contexts */
+    UDSReq_t testerReqs[UDS_SERVER_MAX_TESTERS];       /**< request contexts owned by testers */
+    UDSReq_t *rx; /**< request context not owned by a tester. Requests are received into it */
+    UDSServerTester_t *tester; /**< tester currently being served. Valid inside of srv->fn */
+#endif
+
+#if UDS_SERVER_STATS
+    UDSServerStats_t stats; /**< request statistics, also readable as UDS_SERVER_STATS_DID */
+#endif
 } UDSServer_t;
 
 /**
@@ -106,6 +514,10 @@ typedef struct {
     const uint8_t type; /*! invoked subfunction */
     uint8_t (*copy)(UDSServer_t *srv, const void *src,
                     uint16_t count); /*! function for copying data */
+    uint8_t (*reserve)(UDSServer_t *srv, uint8_t **ptr,
+                       uint16_t *capacity); /*! get a pointer into the response buffer */
+    uint8_t (*commit)(UDSServer_t *srv,
+                      uint16_t count); /*! append `count` bytes written after `reserve` */
 
     union {
         struct {
@@ -152,6 +564,10 @@ typedef struct {
     const uint16_t dataId; /*! RDBI Data Identifier */
     uint8_t (*copy)(UDSServer_t *srv, const void *src,
                     uint16_t count); /*! function for copying data */
+    uint8_t (*reserve)(UDSServer_t *srv, uint8_t **ptr,
+                       uint16_t *capacity); /*! get a pointer into the response buffer */
+    uint8_t (*commit)(UDSServer_t *srv,
+                      uint16_t count); /*! append `count` bytes written after `reserve` */
 } UDSRDBIArgs_t;
 
 /**
@@ -162,6 +578,10 @@ typedef struct {
     const size_t memSize;
     uint8_t (*copy)(UDSServer_t *srv, const void *src,
                     uint16_t count); /*! function for copying data */
+    uint8_t (*reserve)(UDSServer_t *srv, uint8_t **ptr,
+                       uint16_t *capacity); /*! get a pointer into the response buffer */
+    uint8_t (*commit)(UDSServer_t *srv,
+                      uint16_t count); /*! append `count` bytes written after `reserve` */
 } UDSReadMemByAddrArgs_t;
 
 /**
@@ -182,6 +602,10 @@ typedef struct {
     const uint16_t len;              /*! size of request data */
     uint8_t (*copySeed)(UDSServer_t *srv, const void *src,
                         uint16_t len); /*! function for copying data */
+    uint8_t (*reserve)(UDSServer_t *srv, uint8_t **ptr,
+                       uint16_t *capacity); /*! get a pointer into the response buffer */
+    uint8_t (*commit)(UDSServer_t *srv,
+                      uint16_t count); /*! append `count` bytes written after `reserve` */
 } UDSSecAccessRequestSeedArgs_t;
 
 /**
@@ -193,6 +617,36 @@ typedef struct {
     const uint16_t len;       /*! length of key */
 } UDSSecAccessValidateKeyArgs_t;
 
+/**
+ * @brief Authentication arguments
+ * @details Parameters the authenticationTask does not carry are NULL or 0. The handler appends the
+ * authenticationReturnParameter (UDS_AT_*) and then the parameters of the positive response, e.g.
+ * lengthOfChallengeServer and challengeServer for verifyCertificateUnidirectional. The server
+ * advances `srv->authState` from the authenticationReturnParameter.
+ */
+typedef struct {
+    const uint8_t type;                       /*! authenticationTask (UDS_LEV_AT_*) */
+    const uint8_t communicationConfiguration; /*! 0x01, 0x02, 0x05 */
+    const uint8_t *const algorithmIndicator; /*! UDS_0X29_ALGORITHM_INDICATOR_LEN bytes (0x05-0x07) */
+    const uint16_t certificateEvaluationId;  /*! 0x04 */
+    const uint8_t *const certificate; /*! certificateClient (0x01, 0x02), certificateData (0x04) */
+    const uint16_t certificateLen;    /*! length of certificate */
+    const uint8_t *const challenge;   /*! challengeClient (0x01, 0x02, 0x06, 0x07) */
+    const uint16_t challengeLen;      /*! length of challenge */
+    const uint8_t *const proofOfOwnership;   /*! proofOfOwnershipClient (0x03, 0x06, 0x07) */
+    const uint16_t proofOfOwnershipLen;      /*! length of proofOfOwnership */
+    const uint8_t *const ephemeralPublicKey; /*! ephemeralPublicKeyClient (0x03) */
+    const uint16_t ephemeralPublicKeyLen;    /*! length of ephemeralPublicKey */
+    const uint8_t *const additionalParameter; /*! additionalParameter (0x06, 0x07) */
+    const uint16_t additionalParameterLen;    /*! length of additionalParameter */
+    uint8_t (*copy)(UDSServer_t *srv, const void *src,
+                    uint16_t len); /*! function for copying response data */
+    uint8_t (*reserve)(UDSServer_t *srv, uint8_t **ptr,
+                       uint16_t *capacity); /*! get a pointer into the response buffer */
+    uint8_t (*commit)(UDSServer_t *srv,
+                      uint16_t count); /*! append `count` bytes written after `reserve` */
+} UDSAuthArgs_t;
+
 /**
  * @brief Write data by identifier arguments
  */
@@ -243,6 +697,10 @@ typedef struct {
     const size_t ctrlStateAndMaskLen;   /*! number of bytes in `ctrlStateAndMask` */
     uint8_t (*copy)(UDSServer_t *srv, const void *src,
                     uint16_t count); /*! function for copying data */
+    uint8_t (*reserve)(UDSServer_t *srv, uint8_t **ptr,
+                       uint16_t *capacity); /*! get a pointer into the response buffer */
+    uint8_t (*commit)(UDSServer_t *srv,
+                      uint16_t count); /*! append `count` bytes written after `reserve` */
 } UDSIOCtrlArgs_t;
 
 /**
@@ -255,8 +713,37 @@ typedef struct {
     const uint16_t len;          /*! length of optional data */
     uint8_t (*copyStatusRecord)(UDSServer_t *srv, const void *src,
                                 uint16_t len); /*! function for copying response data */
+    uint8_t (*reserve)(UDSServer_t *srv, uint8_t **ptr,
+                       uint16_t *capacity); /*! get a pointer into the response buffer */
+    uint8_t (*commit)(UDSServer_t *srv,
+                      uint16_t count); /*! append `count` bytes written after `reserve` */
+    const uint32_t xferCrc;     /*! UDSCRC32 of the last download ended by 0x37 */
+    const size_t xferByteCount; /*! size of the last download ended by 0x37 */
 } UDSRoutineCtrlArgs_t;
 
+#define UDS_RID_START 0x2   /**< UDSRoutineEntry_t.ctrl: startRoutine */
+#define UDS_RID_STOP 0x4    /**< UDSRoutineEntry_t.ctrl: stopRoutine */
+#define UDS_RID_RESULTS 0x8 /**< UDSRoutineEntry_t.ctrl: requestRoutineResults */
+
+/**
+ * @brief Registered routine identifier
+ * @details 0x31 RoutineControl requests for a registered routine are checked against its entry
+ * before they reach `fn`, or UDS_EVT_RoutineCtrl if it has none: a routineControlType outside of
+ * `ctrl` is refused with 0x12, a session outside of `sessionMask` with 0x31 and a missing security
+ * level with 0x33. Routines that are not registered go straight to the event.
+ */
+typedef struct UDSRoutineEntry {
+    uint16_t rid;          /**< routine identifier */
+    uint8_t ctrl;          /**< UDS_RID_START, UDS_RID_STOP and/or UDS_RID_RESULTS */
+    uint32_t sessionMask;  /**< sessions in which the routine is accessible (UDS_SESSION_BIT()). 0:
+                              any session */
+    uint8_t securityLevel; /**< SecurityAccess level required to control the routine. 0: none */
+
+    /*! optional: handle the request instead of UDS_EVT_RoutineCtrl */
+    UDSErr_t (*fn)(struct UDSServer *srv, const struct UDSRoutineEntry *entry,
+                   UDSRoutineCtrlArgs_t *args);
+} UDSRoutineEntry_t;
+
 /**
  * @brief Request download arguments
  */
@@ -289,6 +776,10 @@ typedef struct {
     uint8_t (*copyResponse)(
         UDSServer_t *srv, const void *src,
         uint16_t len); /*! function for copying transfer data response data (optional) */
+    uint8_t (*reserve)(UDSServer_t *srv, uint8_t **ptr,
+                       uint16_t *capacity); /*! get a pointer into the response buffer */
+    uint8_t (*commit)(UDSServer_t *srv,
+                      uint16_t count); /*! append `count` bytes written after `reserve` */
 } UDSTransferDataArgs_t;
 
 /**
@@ -299,6 +790,12 @@ typedef struct {
     const uint16_t len;        /*! request data length */
     uint8_t (*copyResponse)(UDSServer_t *srv, const void *src,
                             uint16_t len); /*! function for copying response data (optional) */
+    uint8_t (*reserve)(UDSServer_t *srv, uint8_t **ptr,
+                       uint16_t *capacity); /*! get a pointer into the response buffer */
+    uint8_t (*commit)(UDSServer_t *srv,
+                      uint16_t count); /*! append `count` bytes written after `reserve` */
+    const uint32_t crc;     /*! UDSCRC32 of the downloaded data (see UDS_SERVER_XFER_CRC) */
+    const size_t byteCount; /*! number of bytes downloaded */
 } UDSRequestTransferExitArgs_t;
 
 /**
@@ -313,15 +810,18 @@ typedef struct {
     const size_t fileSizeCompressed;    /*! optional file size */
     uint16_t maxNumberOfBlockLength;    /*! optional response: inform client how many data bytes to
                                            send in each    `TransferData` request */
+    UDSXferCheckpoint_t checkpoint;     /*! ResumeFile response: the last checkpoint saved from
+                                           UDS_EVT_TransferCheckpoint for this file. The download
+                                           continues at checkpoint.byteCounter */
 } UDSRequestFileTransferArgs_t;
 
 /**
  * @brief Control DTC setting arguments
  */
 typedef struct {
-    uint8_t type; /*! invoked subfunction */
-    size_t len;   /*! length of data */
-    void *data;   /*! DTCSettingControlOptionRecord */
+    uint8_t type;     /*! invoked subfunction */
+    size_t len;       /*! length of data */
+    const void *data; /*! DTCSettingControlOptionRecord */
 } UDSControlDTCSettingArgs_t;
 
 /**
@@ -335,6 +835,18 @@ typedef struct {
                          linkControlModelIdentifier, on SubFunction 0x02 this is the linkRecord */
 } UDSLinkCtrlArgs_t;
 
+/**
+ * @brief Access timing parameter arguments
+ * @details Emitted before the timing parameters are changed by setTimingParametersToDefaultValues
+ * or setTimingParametersToGivenValues. The values have been checked against the limits already.
+ * Return an NRC to refuse the change.
+ */
+typedef struct {
+    const uint8_t type;        /*! timingParameterAccessType */
+    const uint16_t p2_ms;      /*! P2_server_max that will be applied */
+    const uint32_t p2_star_ms; /*! P2*_server_max that will be applied */
+} UDSAccessTimingArgs_t;
+
 /**
  * @brief Custom service arguments
  */
@@ -344,7 +856,160 @@ typedef struct {
     const uint16_t len;          /*! length of optional data */
     uint8_t (*copyResponse)(UDSServer_t *srv, const void *src,
                             uint16_t len); /*! function for copying response data (optional) */
+    uint8_t (*reserve)(UDSServer_t *srv, uint8_t **ptr,
+                       uint16_t *capacity); /*! get a pointer into the response buffer */
+    uint8_t (*commit)(UDSServer_t *srv,
+                      uint16_t count); /*! append `count` bytes written after `reserve` */
 } UDSCustomArgs_t;
 
 UDSErr_t UDSServerInit(UDSServer_t *srv);
 void UDSServerPoll(UDSServer_t *srv);
+
+/**
+ * @brief UDSServerPoll with the time read by the caller
+ * @details Lets a loop that polls many servers and clients read the clock once per pass (see
+ * UDSScheduler_t).
+ * @param srv
+ * @param now current UDSMillis()
+ */
+void UDSServerPollAt(UDSServer_t *srv, uint32_t now);
+
+/**
+ * @brief Get the time until UDSServerPoll next has work to do that is not triggered by incoming
+ * data: a pending response, a 0x78 keep-alive, a session timeout or a scheduled ECU reset.
+ * Intended as the timeout for an RTOS task that blocks on its receive queue between polls.
+ * Timers of the transport itself are not included: a multi-frame reception stalled by a missing
+ * consecutive frame (N_Cr) only times out once the transport is polled again.
+ * @param srv
+ * @return uint32_t milliseconds until the earliest deadline, 0 if the server should be polled
+ * again immediately, or UDS_NO_DEADLINE if no timer is pending
+ */
+uint32_t UDSServerNextDeadlineMs(const UDSServer_t *srv);
+
+/**
+ * @brief UDSServerNextDeadlineMs measured from `now` instead of the current UDSMillis()
+ */
+uint32_t UDSServerNextDeadlineMsAt(const UDSServer_t *srv, uint32_t now);
+
+/**
+ * @brief Register a table of data identifiers for 0x22 ReadDataByIdentifier and 0x2E
+ * WriteDataByIdentifier. The table is sorted in place and looked up with a binary search.
+ * @param srv
+ * @param table table of entries. Must remain valid for the lifetime of the server
+ * @param count number of entries in the table
+ * @return UDSErr_t UDS_OK on success, UDS_ERR_INVALID_ARG if the table contains duplicate DIDs
+ */
+UDSErr_t UDSServerRegisterDIDs(UDSServer_t *srv, UDSDIDEntry_t *table, size_t count);
+
+/**
+ * @brief Register a table of routines for 0x31 RoutineControl. The table is sorted in place and
+ * looked up with a binary search.
+ * @param srv
+ * @param table table of entries. Must remain valid for the lifetime of the server
+ * @param count number of entries in the table
+ * @return UDSErr_t UDS_OK on success, UDS_ERR_INVALID_ARG if the table contains duplicate RIDs
+ */
+UDSErr_t UDSServerRegisterRoutines(UDSServer_t *srv, UDSRoutineEntry_t *table, size_t count);
+
+/**
+ * @brief Register a DTC database. 0x19 ReadDTCInformation subfunctions 0x01
+ * (reportNumberOfDTCByStatusMask), 0x02 (reportDTCByStatusMask) and 0x0A (reportSupportedDTC) are
+ * then answered from the store without emitting UDS_EVT_ReadDTCInformation. 0x14
+ * ClearDiagnosticInformation clears the requested group in the store once
+ * UDS_EVT_ClearDiagnosticInfo has returned UDS_PositiveResponse. Functional groups such as
+ * 0xFFFF33 (emissions) are cleared once they are defined with UDSDTCStoreSetGroups.
+ * @param srv
+ * @param store initialized store (UDSDTCStoreInit). Must remain valid for the lifetime of the
+ * server. NULL unregisters the store
+ * @return UDSErr_t UDS_OK on success
+ */
+UDSErr_t UDSServerRegisterDTCStore(UDSServer_t *srv, UDSDTCStore_t *store);
+
+/**
+ * @brief Register a DTC record log (UDSDTCLogInit). Together with a registered DTC store, 0x19
+ * subfunctions 0x04, 0x06, 0x18 and 0x19 are then answered from the log without emitting
+ * UDS_EVT_ReadDTCInformation, and 0x14 deletes the records of the cleared group.
+ * @param srv
+ * @param log initialized log. Must remain valid for the lifetime of the server. NULL unregisters
+ * the log
+ * @return UDSErr_t UDS_OK on success
+ */
+UDSErr_t UDSServerRegisterDTCLog(UDSServer_t *srv, UDSDTCLog_t *log);
+
+/**
+ * @brief Drop the cached record of a DID so that the next 0x22 request produces it again. A DID
+ * written with 0x2E is dropped automatically. Not safe to call from another thread or core than
+ * UDSServerPoll: bump UDSDIDEntry_t.version there instead.
+ * @param srv
+ * @param did data identifier
+ */
+void UDSServerInvalidateDID(UDSServer_t *srv, uint16_t did);
+
+/**
+ * @brief Register a table of memory regions for 0x23 ReadMemoryByAddress and 0x3D
+ * WriteMemoryByAddress. Regions are searched in table order.
+ * @param srv
+ * @param table table of regions. Must remain valid for the lifetime of the server
+ * @param count number of entries in the table
+ * @return UDSErr_t UDS_OK on success, UDS_ERR_INVALID_ARG if a region wraps around the address
+ * space
+ */
+UDSErr_t UDSServerRegisterMemRegions(UDSServer_t *srv, const UDSMemRegion_t *table, size_t count);
+
+/**
+ * @brief Defer the response to the request being handled. Call from the service callback and
+ * return the result: the server answers 0x78 ResponsePending on its own P2* schedule without
+ * calling the callback again until UDSServerCompleteResponse is called with the token.
+ * @param srv
+ * @param token receives the token identifying the request
+ * @return UDSErr_t UDS_NRC_RequestCorrectlyReceived_ResponsePending on success, UDS_ERR_MISUSE if
+ * no request is being handled or its response has already been deferred
+ */
+UDSErr_t UDSServerDeferResponse(UDSServer_t *srv, UDSPendingToken_t *token);
+
+/**
+ * @brief Complete a response deferred with UDSServerDeferResponse. May be called from another
+ * thread or an interrupt. The response is sent from the next UDSServerPoll, which finishes the
+ * service exactly as if the callback had returned `nrc` after copying `data`.
+ * @param srv
+ * @param token token from UDSServerDeferResponse
+ * @param nrc UDS_PositiveResponse or a negative response code other than 0x78
+ * @param data response data appended to the positive response (optional). Must remain valid until
+ * the next call to UDSServerPoll
+ * @param len length of data
+ * @return UDSErr_t UDS_OK on success, UDS_ERR_INVALID_ARG if the token does not refer to a
+ * deferred response
+ */
+UDSErr_t UDSServerCompleteResponse(UDSServer_t *srv, UDSPendingToken_t token, UDSErr_t nrc,
+                                   const uint8_t *data, uint16_t len);
+
+/**
+ * @brief Test whether the request being handled arrived inside of 0x84 SecuredDataTransmission.
+ * Call from the service callback, e.g. to accept a write only over a secured channel.
+ * @param srv
+ * @return true if the request was unwrapped from 0x84
+ */
+bool UDSServerRequestIsSecured(UDSServer_t *srv);
+
+/**
+ * @brief Report a change of DTC status to the 0x86 ResponseOnEvent engine. onDTCStatusChange
+ * events whose DTCStatusMask covers a changed bit respond on the next UDSServerPoll.
+ * @param srv
+ * @param oldStatus statusOfDTC before the change
+ * @param newStatus statusOfDTC after the change
+ */
+void UDSServerNotifyDTCStatusChange(UDSServer_t *srv, uint8_t oldStatus, uint8_t newStatus);
+
+/**
+ * @brief Print the RAM taken by a server and its transport for the current configuration
+ * @details e.g. `UDS_SERVER_MEMORY_REPORT(printf, UDSISOTpC_t)`. See UDS_SERVER_SHARED_BUF,
+ * UDS_TP_HALF_DUPLEX and UDS_TP_SEND_IN_PLACE for how to reduce it.
+ * @param print printf-like function
+ * @param tp_type type of the transport handle
+ */
+#define UDS_SERVER_MEMORY_REPORT(print, tp_type)                                                   \
+    print("UDSServer_t %lu + " #tp_type " %lu = %lu bytes (UDS_TP_MTU %lu, "                       \
+          "UDS_SERVER_SHARED_BUF %d, UDS_TP_HALF_DUPLEX %d, UDS_TP_SEND_IN_PLACE %d)\n",           \
+          (unsigned long)sizeof(UDSServer_t), (unsigned long)sizeof(tp_type),                      \
+          (unsigned long)(sizeof(UDSServer_t) + sizeof(tp_type)), (unsigned long)UDS_TP_MTU,       \
+          UDS_SERVER_SHARED_BUF, UDS_TP_HALF_DUPLEX, UDS_TP_SEND_IN_PLACE)
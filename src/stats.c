@@ -0,0 +1,139 @@
+#include "stats.h"
+
+uint32_t UDSHistogramPercentile(const UDSHistogram_t *h, uint16_t permille) {
+    uint64_t total = 0;
+    for (unsigned i = 0; i < UDS_STATS_HIST_BUCKETS; i++) {
+        total += h->count[i];
+    }
+    if (0 == total) {
+        return 0;
+    }
+    // smallest bucket at or below which at least `permille` of the samples lie
+    uint64_t want = (total * permille + 999) / 1000;
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < UDS_STATS_HIST_BUCKETS - 1; i++) {
+        seen += h->count[i];
+        if (seen >= want) {
+            return (uint32_t)((1ULL << i) - 1);
+        }
+    }
+    return UINT32_MAX;
+}
+
+static uint8_t *PutU32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+    return p + 4;
+}
+
+static uint32_t GetU32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static size_t CountNonZero(const uint32_t *v, size_t n) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) {
+        count += v[i] ? 1 : 0;
+    }
+    return count;
+}
+
+UDSErr_t UDSPackServerStats(const UDSServerStats_t *stats, uint8_t *buf, size_t size,
+                            size_t *len) {
+    if (NULL == stats || NULL == buf || NULL == len) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    // NRC 0x00 is the positive response and is never counted
+    size_t sids = CountNonZero(stats->requests, UDS_STATS_SID_SLOTS);
+    size_t nrcs = CountNonZero(&stats->nrcs[1], 255);
+    size_t need = 1 + 4 * 4 + 1 + 5 * sids + 1 + 5 * nrcs + 1 + 2 * 4 * UDS_STATS_HIST_BUCKETS;
+    if (need > size) {
+        return UDS_ERR_BUFSIZ;
+    }
+
+    uint8_t *p = buf;
+    *p++ = UDS_STATS_RECORD_VERSION;
+    p = PutU32(p, stats->rcrrp);
+    p = PutU32(p, stats->suppressed);
+    p = PutU32(p, stats->dropped);
+    p = PutU32(p, stats->tpErrors);
+    *p++ = (uint8_t)sids;
+    for (uint8_t i = 0; i < UDS_STATS_SID_SLOTS; i++) {
+        if (stats->requests[i]) {
+            *p++ = UDSStatsSIDOfIndex(i);
+            p = PutU32(p, stats->requests[i]);
+        }
+    }
+    *p++ = (uint8_t)nrcs;
+    for (unsigned nrc = 1; nrc < 256; nrc++) {
+        if (stats->nrcs[nrc]) {
+            *p++ = (uint8_t)nrc;
+            p = PutU32(p, stats->nrcs[nrc]);
+        }
+    }
+    *p++ = UDS_STATS_HIST_BUCKETS;
+    for (unsigned i = 0; i < UDS_STATS_HIST_BUCKETS; i++) {
+        p = PutU32(p, stats->callback.count[i]);
+    }
+    for (unsigned i = 0; i < UDS_STATS_HIST_BUCKETS; i++) {
+        p = PutU32(p, stats->turnaround.count[i]);
+    }
+    *len = (size_t)(p - buf);
+    return UDS_OK;
+}
+
+static void UnpackHistogram(const uint8_t *p, uint8_t buckets, UDSHistogram_t *h) {
+    for (unsigned i = 0; i < buckets; i++) {
+        unsigned b = i < UDS_STATS_HIST_BUCKETS ? i : UDS_STATS_HIST_BUCKETS - 1;
+        h->count[b] += GetU32(p + 4 * i);
+    }
+}
+
+UDSErr_t UDSUnpackServerStats(const uint8_t *buf, size_t len, UDSServerStats_t *stats) {
+    if (NULL == buf || NULL == stats) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    memset(stats, 0, sizeof(*stats));
+    if (len < 1 + 4 * 4 + 1) {
+        return UDS_ERR_RESP_TOO_SHORT;
+    }
+    if (UDS_STATS_RECORD_VERSION != buf[0]) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    const uint8_t *p = buf + 1;
+    const uint8_t *end = buf + len;
+    stats->rcrrp = GetU32(p);
+    stats->suppressed = GetU32(p + 4);
+    stats->dropped = GetU32(p + 8);
+    stats->tpErrors = GetU32(p + 12);
+    p += 16;
+
+    uint8_t n = *p++;
+    if ((size_t)(end - p) < 5U * n + 1) {
+        return UDS_ERR_RESP_TOO_SHORT;
+    }
+    for (uint8_t i = 0; i < n; i++, p += 5) {
+        if (p[0] & 0x40) {
+            return UDS_ERR_INVALID_ARG;
+        }
+        stats->requests[UDSStatsSIDIndex(p[0])] = GetU32(p + 1);
+    }
+
+    n = *p++;
+    if ((size_t)(end - p) < 5U * n + 1) {
+        return UDS_ERR_RESP_TOO_SHORT;
+    }
+    for (uint8_t i = 0; i < n; i++, p += 5) {
+        stats->nrcs[p[0]] = GetU32(p + 1);
+    }
+
+    uint8_t buckets = *p++;
+    if ((size_t)(end - p) < 2U * 4U * buckets) {
+        return UDS_ERR_RESP_TOO_SHORT;
+    }
+    UnpackHistogram(p, buckets, &stats->callback);
+    UnpackHistogram(p + 4 * buckets, buckets, &stats->turnaround);
+    return UDS_OK;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "sys.h"
+#include "config.h"
+#include "uds.h"
+
+/**
+ * @brief Request statistics of the server and the client
+ * @details Enabled with UDS_SERVER_STATS and UDS_CLIENT_STATS. Counters are plain increments on
+ * the request path and times are taken with UDSMicros(), so the cost is a few cycles per request
+ * and one UDSMicros() call per callback. Counters wrap around; clear them with memset.
+ */
+
+/** number of request SIDs: 0x00-0x3F and 0x80-0xBF (bit 6 is the response bit) */
+#define UDS_STATS_SID_SLOTS 128
+
+/** version of the record written by UDSPackServerStats */
+#define UDS_STATS_RECORD_VERSION 1
+
+/**
+ * @brief Histogram of durations in microseconds with power of two buckets
+ * @details Bucket 0 counts durations of 0 us, bucket `i` durations in [2^(i-1), 2^i) us. The last
+ * bucket also counts everything longer.
+ */
+typedef struct {
+    uint32_t count[UDS_STATS_HIST_BUCKETS];
+} UDSHistogram_t;
+
+typedef struct {
+    uint32_t requests[UDS_STATS_SID_SLOTS]; /**< requests received, by UDSStatsSIDIndex() */
+    uint32_t nrcs[256];                     /**< negative responses sent, by NRC */
+    uint32_t rcrrp;                         /**< 0x78 responses sent, also counted in nrcs */
+    uint32_t suppressed;                    /**< requests that were not answered */
+    uint32_t dropped;                       /**< requests dropped because the tester was busy */
+    uint32_t tpErrors;                      /**< failed transport sends and receives */
+    UDSHistogram_t callback;                /**< time spent in srv->fn per event */
+    UDSHistogram_t turnaround;              /**< request received to final response sent */
+} UDSServerStats_t;
+
+typedef struct {
+    uint32_t requests[UDS_STATS_SID_SLOTS]; /**< requests sent, by UDSStatsSIDIndex() */
+    uint32_t nrcs[256];                     /**< negative responses received, by NRC */
+    uint32_t rcrrp;                         /**< 0x78 responses received, also counted in nrcs */
+    uint32_t timeouts;                      /**< requests that timed out waiting for a response */
+    uint32_t tpErrors;                      /**< failed transport sends and receives */
+    UDSHistogram_t turnaround;              /**< request sent to final response received */
+} UDSClientStats_t;
+
+/**
+ * @brief Index of a request SID in the `requests` counters. A response SID maps to its request.
+ */
+static inline uint8_t UDSStatsSIDIndex(uint8_t sid) {
+    return (uint8_t)(((sid >> 1) & 0x40) | (sid & 0x3F));
+}
+
+/**
+ * @brief Request SID of a `requests` index
+ */
+static inline uint8_t UDSStatsSIDOfIndex(uint8_t idx) {
+    return (uint8_t)(idx < 0x40 ? idx : idx + 0x40);
+}
+
+static inline void UDSHistogramAdd(UDSHistogram_t *h, uint32_t us) {
+#if defined(__GNUC__) || defined(__clang__)
+    unsigned b = us ? 32U - (unsigned)__builtin_clz(us) : 0U;
+#else
+    unsigned b = 0;
+    while (us >> b) {
+        b++;
+    }
+#endif
+    h->count[b < UDS_STATS_HIST_BUCKETS ? b : UDS_STATS_HIST_BUCKETS - 1]++;
+}
+
+/**
+ * @brief Upper bound of a percentile of a histogram
+ * @param permille percentile in tenths of a percent, e.g. 990 for p99
+ * @return the longest duration of the bucket the percentile falls in, in microseconds. 0 for an
+ * empty histogram and UINT32_MAX if it falls in the last bucket.
+ */
+uint32_t UDSHistogramPercentile(const UDSHistogram_t *h, uint16_t permille);
+
+/**
+ * @brief Write server statistics as a record, the data of the UDS_SERVER_STATS_DID
+ * @details Big endian: version (1 byte), rcrrp, suppressed, dropped, tpErrors (4 bytes each), the
+ * number of SIDs (1 byte) followed by a SID and a 4 byte count for every SID with requests, the
+ * same for NRCs, then the number of histogram buckets (1 byte) followed by the callback and the
+ * turnaround histograms (4 bytes per bucket).
+ * @param len set to the length of the record
+ * @return UDS_OK or UDS_ERR_BUFSIZ
+ */
+UDSErr_t UDSPackServerStats(const UDSServerStats_t *stats, uint8_t *buf, size_t size, size_t *len);
+
+/**
+ * @brief Read a record written by UDSPackServerStats, for example from the response to a 0x22 of
+ * UDS_SERVER_STATS_DID
+ * @details The record may come from a server built with another UDS_STATS_HIST_BUCKETS: extra
+ * buckets are added to the last one.
+ * @return UDS_OK, or UDS_ERR_RESP_TOO_SHORT or UDS_ERR_INVALID_ARG if the record is malformed
+ */
+UDSErr_t UDSUnpackServerStats(const uint8_t *buf, size_t len, UDSServerStats_t *stats);
@@ -8,6 +8,9 @@
 #include <string.h>
 #include <inttypes.h>
 #include "rtt_uds_config.h"
+#if defined(RT_USING_KTIME)
+#include <ktime.h>
+#endif
 
 #define UDS_TP_ISOTP_C 1
 
@@ -2,6 +2,13 @@
 
 #if UDS_SYS == UDS_SYS_UNIX
 
+// recvmmsg() and sendmmsg(), and pthread_setaffinity_np() for src/host.c. Only effective when this
+// is the first header included.
+#if defined(__linux__) && (defined(UDS_TP_ISOTP_C_SOCKETCAN) || defined(UDS_TP_ISOTP_SOCK)) &&     \
+    !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include <assert.h>
 #include <inttypes.h>
 #include <stdbool.h>
@@ -1,20 +1,56 @@
 #include "tp.h"
 #include "util.h"
+#include "trace.h"
 
 ssize_t UDSTpSend(struct UDSTp *hdl, const uint8_t *buf, ssize_t len, UDSSDU_t *info) {
     UDS_ASSERT(hdl);
     UDS_ASSERT(hdl->send);
-    return hdl->send(hdl, (uint8_t *)buf, len, info);
+    ssize_t ret = hdl->send(hdl, (uint8_t *)buf, len, info);
+#if UDS_TRACE
+    UDSTraceSDU(true, buf, ret, info);
+#endif
+    return ret;
 }
 
 ssize_t UDSTpRecv(struct UDSTp *hdl, uint8_t *buf, size_t bufsize, UDSSDU_t *info) {
     UDS_ASSERT(hdl);
     UDS_ASSERT(hdl->recv);
-    return hdl->recv(hdl, buf, bufsize, info);
+    ssize_t ret = hdl->recv(hdl, buf, bufsize, info);
+#if UDS_TRACE
+    if (ret) {
+        UDSTraceSDU(false, buf, ret, info);
+    }
+#endif
+    return ret;
 }
 
 UDSTpStatus_t UDSTpPoll(struct UDSTp *hdl) {
     UDS_ASSERT(hdl);
     UDS_ASSERT(hdl->poll);
     return hdl->poll(hdl);
+}
+
+ssize_t UDSTpPeek(struct UDSTp *hdl, uint8_t *scratch, size_t size, const uint8_t **buf,
+                  UDSSDU_t *info) {
+    UDS_ASSERT(hdl);
+    UDS_ASSERT(buf);
+    if (hdl->peek) {
+        UDS_ASSERT(hdl->ack);
+        ssize_t ret = hdl->peek(hdl, buf, info);
+#if UDS_TRACE
+        if (ret) {
+            UDSTraceSDU(false, *buf, ret, info);
+        }
+#endif
+        return ret;
+    }
+    *buf = scratch;
+    return UDSTpRecv(hdl, scratch, size, info);
+}
+
+void UDSTpAck(struct UDSTp *hdl) {
+    UDS_ASSERT(hdl);
+    if (hdl->ack) {
+        hdl->ack(hdl);
+    }
 }
\ No newline at end of file
@@ -2,7 +2,7 @@
 
 #include "sys.h"
 
-#if defined UDS_TP_ISOTP_C_SOCKETCAN
+#if defined UDS_TP_ISOTP_C_SOCKETCAN || defined UDS_TP_ESP32_TWAI
 #ifndef UDS_TP_ISOTP_C
 #define UDS_TP_ISOTP_C
 #endif
@@ -79,8 +79,43 @@ typedef struct UDSTp {
      * @return UDS_TP_IDLE if idle, otherwise UDS_TP_SEND_IN_PROGRESS or UDS_TP_RECV_COMPLETE
      */
     UDSTpStatus_t (*poll)(struct UDSTp *hdl);
+
+    /**
+     * @brief Borrow the next received message without copying it (optional, may be NULL)
+     * @param hdl: transport handle
+     * @param buf: set to the message, which stays valid and unchanged until ack is called
+     * @param info: pointer to SDU info to be updated by transport implementation. May be NULL.
+     * @note until ack is called the transport must not overwrite the message. Further messages
+     * may be held back or dropped.
+     * @return length of the message, 0 if none was received, negative on error
+     */
+    ssize_t (*peek)(struct UDSTp *hdl, const uint8_t **buf, UDSSDU_t *info);
+
+    /**
+     * @brief Release the message returned by peek (required if peek is set)
+     * @param hdl: transport handle
+     */
+    void (*ack)(struct UDSTp *hdl);
 } UDSTp_t;
 
 ssize_t UDSTpSend(UDSTp_t *hdl, const uint8_t *buf, ssize_t len, UDSSDU_t *info);
 ssize_t UDSTpRecv(UDSTp_t *hdl, uint8_t *buf, size_t bufsize, UDSSDU_t *info);
 UDSTpStatus_t UDSTpPoll(UDSTp_t *hdl);
+
+/**
+ * @brief Borrow the next received message. Transports without peek receive into scratch instead.
+ * @param hdl: transport handle
+ * @param scratch: buffer used if the transport cannot lend its own
+ * @param size: size of scratch
+ * @param buf: set to the message (either the transport's buffer or scratch)
+ * @param info: SDU info of the message. May be NULL.
+ * @return length of the message, 0 if none was received, negative on error. Call UDSTpAck() once
+ * the message is no longer needed if the return value is positive.
+ */
+ssize_t UDSTpPeek(UDSTp_t *hdl, uint8_t *scratch, size_t size, const uint8_t **buf,
+                  UDSSDU_t *info);
+
+/**
+ * @brief Release a message returned by UDSTpPeek(). A no-op for transports without peek.
+ */
+void UDSTpAck(UDSTp_t *hdl);
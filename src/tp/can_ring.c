@@ -0,0 +1,65 @@
+#include "tp/can_ring.h"
+#include "util.h"
+
+#define CAN_RING_MASK ((uint32_t)UDS_CAN_RING_SIZE - 1U)
+
+/*
+ * Each side reads the index published by the other side with acquire and publishes its own with
+ * release, so a slot is never read before its frame is complete nor refilled before it was read.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define CAN_RING_LOAD(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define CAN_RING_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#else
+/* single core: volatile accesses are not reordered against each other by the compiler */
+#define CAN_RING_LOAD(p) (*(p))
+#define CAN_RING_STORE(p, v) (*(p) = (v))
+#endif
+
+void UDSCANRingInit(UDSCANRing_t *ring) {
+    UDS_ASSERT(ring);
+    memset(ring, 0, sizeof(*ring));
+}
+
+bool UDSCANRingPush(UDSCANRing_t *ring, uint32_t id, const uint8_t *data, uint8_t len) {
+    if (len > UDS_CAN_RING_FRAME_LEN) {
+        ring->invalid = ring->invalid + 1;
+        return false;
+    }
+    const uint32_t head = ring->head;
+    if (head - CAN_RING_LOAD(&ring->tail) >= UDS_CAN_RING_SIZE) {
+        ring->dropped = ring->dropped + 1;
+        return false;
+    }
+    UDSCANFrame_t *frame = &ring->frames[head & CAN_RING_MASK];
+    frame->id = id;
+    frame->len = len;
+    memcpy(frame->data, data, len);
+    CAN_RING_STORE(&ring->head, head + 1);
+    return true;
+}
+
+size_t UDSCANRingDrain(UDSCANRing_t *ring, UDSCANRingFn fn, void *ctx, size_t max) {
+    UDS_ASSERT(ring);
+    UDS_ASSERT(fn);
+    const uint32_t tail = ring->tail;
+    uint32_t n = CAN_RING_LOAD(&ring->head) - tail;
+    if (n > ring->peak) {
+        ring->peak = n;
+    }
+    if (max > 0 && n > max) {
+        n = (uint32_t)max;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        fn(ctx, &ring->frames[(tail + i) & CAN_RING_MASK]);
+    }
+    if (n > 0) {
+        CAN_RING_STORE(&ring->tail, tail + n);
+    }
+    return n;
+}
+
+size_t UDSCANRingCount(const UDSCANRing_t *ring) {
+    UDS_ASSERT(ring);
+    return CAN_RING_LOAD(&ring->head) - CAN_RING_LOAD(&ring->tail);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "sys.h"
+#include "config.h"
+
+/**
+ * @file can_ring.h
+ * @brief Lock-free single-producer/single-consumer ring of CAN frames
+ * @details Hands received frames from a CAN interrupt to the task that runs the UDS stack without
+ * a kernel queue or a critical section. The interrupt is the only writer of `head` and the drop
+ * counters and the task is the only writer of `tail`, so each side only has to publish its own
+ * index after touching a slot. The task drains every pending frame in one batch and reads them in
+ * place.
+ */
+
+/** number of frames in the ring, must be a power of two */
+#ifndef UDS_CAN_RING_SIZE
+#define UDS_CAN_RING_SIZE (32)
+#endif
+
+#if (UDS_CAN_RING_SIZE < 2) || ((UDS_CAN_RING_SIZE & (UDS_CAN_RING_SIZE - 1)) != 0)
+#error "UDS_CAN_RING_SIZE must be a power of two"
+#endif
+
+/** largest frame payload kept, 64 for CAN FD */
+#ifndef UDS_CAN_RING_FRAME_LEN
+#define UDS_CAN_RING_FRAME_LEN (64)
+#endif
+
+/**
+ * @brief A received CAN frame
+ */
+typedef struct {
+    uint32_t id;                          /**< CAN identifier as reported by the driver */
+    uint8_t len;                          /**< number of bytes in data */
+    uint8_t data[UDS_CAN_RING_FRAME_LEN]; /**< frame payload */
+} UDSCANFrame_t;
+
+/**
+ * @brief Frame ring. Zero-initialize it or call UDSCANRingInit() before use.
+ */
+typedef struct {
+    UDSCANFrame_t frames[UDS_CAN_RING_SIZE];
+    volatile uint32_t head;    /**< frames pushed, written by the producer only */
+    volatile uint32_t tail;    /**< frames drained, written by the consumer only */
+    volatile uint32_t dropped; /**< frames lost because the ring was full */
+    volatile uint32_t invalid; /**< frames rejected because they were longer than a slot */
+    uint32_t peak;             /**< most frames ever found pending by UDSCANRingDrain() */
+} UDSCANRing_t;
+
+/**
+ * @brief Called by UDSCANRingDrain() for each frame. The frame is only valid during the call.
+ */
+typedef void (*UDSCANRingFn)(void *ctx, const UDSCANFrame_t *frame);
+
+void UDSCANRingInit(UDSCANRing_t *ring);
+
+/**
+ * @brief Copy a received frame into the ring. Safe to call from an interrupt.
+ * @param ring
+ * @param id CAN identifier
+ * @param data frame payload
+ * @param len length of data, at most UDS_CAN_RING_FRAME_LEN
+ * @return true if the frame was queued, false if it was dropped
+ * @note only one context may push into a ring
+ */
+bool UDSCANRingPush(UDSCANRing_t *ring, uint32_t id, const uint8_t *data, uint8_t len);
+
+/**
+ * @brief Pass up to `max` pending frames to `fn` in the order they were pushed, then release their
+ * slots to the producer all at once.
+ * @param ring
+ * @param fn called once per frame
+ * @param ctx passed to fn
+ * @param max most frames to drain, 0 for no limit
+ * @return number of frames drained
+ * @note only one context may drain a ring
+ */
+size_t UDSCANRingDrain(UDSCANRing_t *ring, UDSCANRingFn fn, void *ctx, size_t max);
+
+/**
+ * @brief Number of frames waiting to be drained
+ */
+size_t UDSCANRingCount(const UDSCANRing_t *ring);
@@ -0,0 +1,834 @@
+#if defined(UDS_TP_DOIP)
+
+#include "tp/doip.h"
+#include "uds.h"
+#include "log.h"
+#include "util.h"
+#include <string.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/* generic header plus the source and target address of a diagnostic message */
+#define DOIP_DIAG_HEADER_LEN (UDS_DOIP_HEADER_LEN + 4)
+
+/* ISO 13400-2:2012 Table 17 */
+enum {
+    DOIP_GENERIC_NACK = 0x0000,
+    DOIP_VEHICLE_ID_REQ = 0x0001,
+    DOIP_VEHICLE_ID_REQ_EID = 0x0002,
+    DOIP_VEHICLE_ID_REQ_VIN = 0x0003,
+    DOIP_VEHICLE_ANNOUNCEMENT = 0x0004,
+    DOIP_ROUTING_ACTIVATION_REQ = 0x0005,
+    DOIP_ROUTING_ACTIVATION_RESP = 0x0006,
+    DOIP_ALIVE_CHECK_REQ = 0x0007,
+    DOIP_ALIVE_CHECK_RESP = 0x0008,
+    DOIP_DIAG_MESSAGE = 0x8001,
+    DOIP_DIAG_ACK = 0x8002,
+    DOIP_DIAG_NACK = 0x8003,
+};
+
+/* generic header negative acknowledge codes, Table 19 */
+#define DOIP_NACK_INCORRECT_PATTERN (0x00)
+#define DOIP_NACK_UNKNOWN_PAYLOAD_TYPE (0x01)
+#define DOIP_NACK_MESSAGE_TOO_LARGE (0x02)
+#define DOIP_NACK_INVALID_PAYLOAD_LENGTH (0x04)
+
+/* routing activation response codes, Table 25 */
+#define DOIP_ROUTING_SA_ALREADY_REGISTERED (0x02)
+#define DOIP_ROUTING_UNSUPPORTED_TYPE (0x06)
+#define DOIP_ROUTING_SUCCESS (0x10)
+
+/* diagnostic message negative acknowledge codes, Table 28 */
+#define DOIP_DIAG_NACK_INVALID_SA (0x02)
+#define DOIP_DIAG_NACK_UNKNOWN_TA (0x03)
+#define DOIP_DIAG_NACK_MESSAGE_TOO_LARGE (0x04)
+
+/* vehicle announcement: VIN, logical address, EID, GID, further action, sync status */
+#define DOIP_ANNOUNCEMENT_LEN (UDS_DOIP_VIN_LEN + 2 + UDS_DOIP_EID_LEN + UDS_DOIP_GID_LEN + 2)
+
+static_assert(DOIP_ANNOUNCEMENT_LEN <= UDS_DOIP_CTRL_PAYLOAD_MAX, "");
+
+static uint16_t DoIPGet16(const uint8_t *p) { return (uint16_t)((p[0] << 8) | p[1]); }
+
+static uint32_t DoIPGet32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static void DoIPPut16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+/* protocol version and inverse protocol version, ISO 13400-2:2012 Table 16 */
+static bool DoIPPatternValid(const uint8_t *hdr) { return 0xFF == (hdr[0] ^ hdr[1]); }
+
+static void DoIPWriteHeader(uint8_t *hdr, uint16_t type, uint32_t len) {
+    hdr[0] = UDS_DOIP_PROTOCOL_VERSION;
+    hdr[1] = (uint8_t)~UDS_DOIP_PROTOCOL_VERSION;
+    DoIPPut16(&hdr[2], type);
+    DoIPPut16(&hdr[4], (uint16_t)(len >> 16));
+    DoIPPut16(&hdr[6], (uint16_t)len);
+}
+
+/* write every byte of `iov`, waiting for the socket when its send buffer is full */
+static ssize_t DoIPSendAll(int fd, struct iovec *iov, int iovcnt) {
+    size_t sent = 0;
+    while (iovcnt > 0) {
+        struct msghdr msg = {.msg_iov = iov, .msg_iovlen = (size_t)iovcnt};
+        ssize_t ret = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (ret < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+            if (EAGAIN == errno || EWOULDBLOCK == errno) {
+                struct pollfd pfd = {.fd = fd, .events = POLLOUT};
+                if (poll(&pfd, 1, UDS_DOIP_CTRL_TIMEOUT_MS) > 0) {
+                    continue;
+                }
+            }
+            UDS_LOGE(__FILE__, "DoIP send failed: %s (%d)", strerror(errno), errno);
+            return -1;
+        }
+        sent += (size_t)ret;
+        size_t n = (size_t)ret;
+        while (iovcnt > 0 && n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (uint8_t *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return (ssize_t)sent;
+}
+
+static ssize_t DoIPSendCtrl(int fd, uint16_t type, const uint8_t *payload, uint32_t len) {
+    uint8_t hdr[UDS_DOIP_HEADER_LEN];
+    DoIPWriteHeader(hdr, type, len);
+    struct iovec iov[2] = {
+        {.iov_base = hdr, .iov_len = sizeof(hdr)},
+        {.iov_base = (void *)payload, .iov_len = len},
+    };
+    return DoIPSendAll(fd, iov, len ? 2 : 1);
+}
+
+static void DoIPSendNack(int fd, uint8_t code) {
+    UDS_LOGI(__FILE__, "DoIP generic NACK 0x%02x", code);
+    (void)DoIPSendCtrl(fd, DOIP_GENERIC_NACK, &code, 1);
+}
+
+static void DoIPSendDiagAck(UDSTpDoIP_t *impl, uint16_t type, uint16_t ta, uint8_t code) {
+    uint8_t payload[5];
+    DoIPPut16(&payload[0], impl->sa);
+    DoIPPut16(&payload[2], ta);
+    payload[4] = code;
+    (void)DoIPSendCtrl(impl->fd, type, payload, sizeof(payload));
+}
+
+/*
+ * A whole diagnostic message must fit in the socket buffers: it is only read once it has fully
+ * arrived, and then straight into the caller's buffer.
+ */
+static void DoIPConfigureSocket(int fd) {
+    int one = 1;
+    int size = 2 * (DOIP_DIAG_HEADER_LEN + UDS_TP_MTU);
+    (void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    (void)setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    (void)setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+}
+
+static void DoIPOpenConn(UDSTpDoIP_t *impl, int fd) {
+    impl->fd = fd;
+    impl->state = UDS_DOIP_ACTIVATING;
+    impl->timer = UDSMillis() + UDS_DOIP_INITIAL_INACTIVITY_MS;
+    impl->idle_timer = UDSMillis() + UDS_DOIP_GENERAL_INACTIVITY_MS;
+    UDS_LOGI(__FILE__, "'%s' accepted connection (fd %d)", impl->tag, fd);
+}
+
+static void DoIPCloseConn(UDSTpDoIP_t *impl) {
+    if (impl->fd >= 0) {
+        close(impl->fd);
+        UDS_LOGI(__FILE__, "'%s' closed connection (fd %d)", impl->tag, impl->fd);
+    }
+    impl->fd = -1;
+    impl->discard = 0;
+    impl->alive_pending = false;
+    impl->ack_pending = false;
+    if (!impl->is_server) {
+        impl->state = UDS_DOIP_FAILED;
+        impl->err = true;
+    } else if (impl->pending_fd >= 0) {
+        // the connection that was waiting takes over the socket
+        DoIPOpenConn(impl, impl->pending_fd);
+        impl->pending_fd = -1;
+    } else {
+        impl->state = UDS_DOIP_CLOSED;
+    }
+}
+
+static void DoIPHandleRoutingActivation(UDSTpDoIP_t *impl, const uint8_t *p, uint32_t len) {
+    if (7 != len && 11 != len) {
+        DoIPSendNack(impl->fd, DOIP_NACK_INVALID_PAYLOAD_LENGTH);
+        DoIPCloseConn(impl);
+        return;
+    }
+    uint16_t sa = DoIPGet16(p);
+    uint8_t activationType = p[2];
+    uint8_t code = DOIP_ROUTING_SUCCESS;
+    if (0x00 != activationType && 0x01 != activationType) {
+        code = DOIP_ROUTING_UNSUPPORTED_TYPE;
+    } else if (UDS_DOIP_ROUTED == impl->state && sa != impl->ta) {
+        code = DOIP_ROUTING_SA_ALREADY_REGISTERED;
+    }
+
+    uint8_t resp[9] = {0};
+    DoIPPut16(&resp[0], sa);
+    DoIPPut16(&resp[2], impl->sa);
+    resp[4] = code;
+    (void)DoIPSendCtrl(impl->fd, DOIP_ROUTING_ACTIVATION_RESP, resp, sizeof(resp));
+    if (DOIP_ROUTING_SUCCESS != code) {
+        UDS_LOGW(__FILE__, "'%s' denied routing activation of 0x%04x: 0x%02x", impl->tag, sa, code);
+        DoIPCloseConn(impl);
+        return;
+    }
+    impl->ta = sa;
+    impl->state = UDS_DOIP_ROUTED;
+    UDS_LOGI(__FILE__, "'%s' activated routing for tester 0x%04x", impl->tag, sa);
+}
+
+static void DoIPHandleCtrl(UDSTpDoIP_t *impl, uint16_t type, const uint8_t *p, uint32_t len) {
+    switch (type) {
+    case DOIP_ROUTING_ACTIVATION_REQ:
+        if (!impl->is_server) {
+            break;
+        }
+        DoIPHandleRoutingActivation(impl, p, len);
+        return;
+    case DOIP_ROUTING_ACTIVATION_RESP:
+        if (impl->is_server) {
+            break;
+        }
+        if (len < 9) {
+            DoIPSendNack(impl->fd, DOIP_NACK_INVALID_PAYLOAD_LENGTH);
+            DoIPCloseConn(impl);
+        } else if (UDS_DOIP_ACTIVATING == impl->state && DOIP_ROUTING_SUCCESS == p[4]) {
+            impl->state = UDS_DOIP_ROUTED;
+            UDS_LOGI(__FILE__, "'%s' routing activated by 0x%04x", impl->tag, DoIPGet16(&p[2]));
+        } else {
+            UDS_LOGE(__FILE__, "'%s' routing activation denied: 0x%02x", impl->tag, p[4]);
+            DoIPCloseConn(impl);
+        }
+        return;
+    case DOIP_ALIVE_CHECK_REQ: {
+        uint8_t resp[2];
+        DoIPPut16(resp, impl->sa);
+        (void)DoIPSendCtrl(impl->fd, DOIP_ALIVE_CHECK_RESP, resp, sizeof(resp));
+        return;
+    }
+    case DOIP_ALIVE_CHECK_RESP:
+        if (!impl->is_server) {
+            break;
+        }
+        if (impl->alive_pending && impl->pending_fd >= 0) {
+            // the registered tester is still there, so the new connection is turned away
+            close(impl->pending_fd);
+            impl->pending_fd = -1;
+        }
+        impl->alive_pending = false;
+        return;
+    case DOIP_DIAG_ACK:
+        if (impl->is_server) {
+            break;
+        }
+        impl->ack_pending = false;
+        return;
+    case DOIP_DIAG_NACK:
+        if (impl->is_server) {
+            break;
+        }
+        UDS_LOGE(__FILE__, "'%s' diagnostic message rejected: 0x%02x", impl->tag,
+                 len >= 5 ? p[4] : 0);
+        impl->ack_pending = false;
+        impl->err = true;
+        return;
+    case DOIP_GENERIC_NACK:
+        UDS_LOGE(__FILE__, "'%s' received generic NACK 0x%02x", impl->tag, len >= 1 ? p[0] : 0);
+        impl->err = true;
+        return;
+    default:
+        break;
+    }
+    DoIPSendNack(impl->fd, DOIP_NACK_UNKNOWN_PAYLOAD_TYPE);
+}
+
+static bool DoIPAcceptsTA(const UDSTpDoIP_t *impl, uint16_t ta) {
+    return impl->accept_ta && impl->accept_ta(impl->accept_ctx, ta);
+}
+
+static ssize_t DoIPHandleDiag(UDSTpDoIP_t *impl, const uint8_t *hdr, size_t len,
+                              UDSSDU_t *info) {
+    uint16_t sa = DoIPGet16(&hdr[UDS_DOIP_HEADER_LEN]);
+    uint16_t ta = DoIPGet16(&hdr[UDS_DOIP_HEADER_LEN + 2]);
+    UDS_A_TA_Type_t ta_type = UDS_A_TA_TYPE_PHYSICAL;
+    if (impl->is_server) {
+        if (UDS_DOIP_ROUTED != impl->state || sa != impl->ta) {
+            DoIPSendDiagAck(impl, DOIP_DIAG_NACK, sa, DOIP_DIAG_NACK_INVALID_SA);
+            return 0;
+        }
+        if (ta == impl->func_ta) {
+            ta_type = UDS_A_TA_TYPE_FUNCTIONAL;
+        } else if (ta != impl->sa && !DoIPAcceptsTA(impl, ta)) {
+            DoIPSendDiagAck(impl, DOIP_DIAG_NACK, sa, DOIP_DIAG_NACK_UNKNOWN_TA);
+            return 0;
+        }
+        DoIPSendDiagAck(impl, DOIP_DIAG_ACK, sa, 0x00);
+    } else if (sa != impl->ta || ta != impl->sa) {
+        UDS_LOGW(__FILE__, "'%s' dropped message from 0x%04x to 0x%04x", impl->tag, sa, ta);
+        return 0;
+    }
+
+    if (info) {
+        info->A_Mtype = UDS_A_MTYPE_DIAG;
+        info->A_SA = sa;
+        info->A_TA = ta;
+        info->A_TA_Type = ta_type;
+        info->A_AE = 0;
+    }
+    return (ssize_t)len;
+}
+
+/*
+ * Handle the next message of the data connection. Returns true if a message was consumed, with
+ * the length of a diagnostic message read into `buf` in `*out`. Without `buf`, diagnostic
+ * messages are left in the socket for recv.
+ */
+static bool DoIPRecvOne(UDSTpDoIP_t *impl, uint8_t *buf, size_t bufsize, UDSSDU_t *info,
+                        ssize_t *out) {
+    *out = 0;
+    if (impl->fd < 0) {
+        return false;
+    }
+    if (impl->discard) {
+        uint8_t scratch[256];
+        size_t n = impl->discard < sizeof(scratch) ? impl->discard : sizeof(scratch);
+        ssize_t ret = recv(impl->fd, scratch, n, 0);
+        if (ret <= 0) {
+            if (ret < 0 && (EAGAIN == errno || EWOULDBLOCK == errno || EINTR == errno)) {
+                return false;
+            }
+            DoIPCloseConn(impl);
+            return false;
+        }
+        impl->discard -= (size_t)ret;
+        return true;
+    }
+
+    uint8_t hdr[DOIP_DIAG_HEADER_LEN];
+    ssize_t ret = recv(impl->fd, hdr, sizeof(hdr), MSG_PEEK);
+    if (0 == ret) {
+        UDS_LOGI(__FILE__, "'%s' connection closed by peer", impl->tag);
+        DoIPCloseConn(impl);
+        return false;
+    } else if (ret < 0) {
+        if (EAGAIN != errno && EWOULDBLOCK != errno && EINTR != errno) {
+            UDS_LOGE(__FILE__, "'%s' recv failed: %s (%d)", impl->tag, strerror(errno), errno);
+            DoIPCloseConn(impl);
+        }
+        return false;
+    } else if (ret < UDS_DOIP_HEADER_LEN) {
+        return false;
+    }
+    if (!DoIPPatternValid(hdr)) {
+        DoIPSendNack(impl->fd, DOIP_NACK_INCORRECT_PATTERN);
+        DoIPCloseConn(impl);
+        return false;
+    }
+    uint16_t type = DoIPGet16(&hdr[2]);
+    uint32_t len = DoIPGet32(&hdr[4]);
+    int avail = 0;
+    if (ioctl(impl->fd, FIONREAD, &avail) < 0) {
+        DoIPCloseConn(impl);
+        return false;
+    }
+    bool complete = (size_t)avail >= UDS_DOIP_HEADER_LEN + (size_t)len;
+    impl->idle_timer = UDSMillis() + UDS_DOIP_GENERAL_INACTIVITY_MS;
+
+    if (DOIP_DIAG_MESSAGE == type) {
+        if (len < 4) {
+            DoIPSendNack(impl->fd, DOIP_NACK_INVALID_PAYLOAD_LENGTH);
+            DoIPCloseConn(impl);
+            return false;
+        }
+        size_t data_len = len - 4;
+        if (data_len > UDS_TP_MTU) {
+            DoIPSendNack(impl->fd, DOIP_NACK_MESSAGE_TOO_LARGE);
+            impl->discard = UDS_DOIP_HEADER_LEN + (size_t)len;
+            return true;
+        }
+        if (NULL == buf || ret < DOIP_DIAG_HEADER_LEN || !complete) {
+            return false;
+        }
+        if (data_len > bufsize) {
+            UDS_LOGW(__FILE__, "'%s' %zu byte message too large for %zu byte buffer", impl->tag,
+                     data_len, bufsize);
+            DoIPSendDiagAck(impl, DOIP_DIAG_NACK, DoIPGet16(&hdr[UDS_DOIP_HEADER_LEN]),
+                            DOIP_DIAG_NACK_MESSAGE_TOO_LARGE);
+            impl->discard = UDS_DOIP_HEADER_LEN + (size_t)len;
+            return true;
+        }
+        // the addresses go to `hdr`, the user data straight to the caller
+        struct iovec iov[2] = {
+            {.iov_base = hdr, .iov_len = sizeof(hdr)},
+            {.iov_base = buf, .iov_len = data_len},
+        };
+        struct msghdr msg = {.msg_iov = iov, .msg_iovlen = 2};
+        ret = recvmsg(impl->fd, &msg, MSG_WAITALL);
+        if (ret != (ssize_t)(DOIP_DIAG_HEADER_LEN + data_len)) {
+            DoIPCloseConn(impl);
+            return false;
+        }
+        *out = DoIPHandleDiag(impl, hdr, data_len, info);
+        return true;
+    }
+
+    if (len > UDS_DOIP_CTRL_PAYLOAD_MAX) {
+        DoIPSendNack(impl->fd, DOIP_NACK_MESSAGE_TOO_LARGE);
+        impl->discard = UDS_DOIP_HEADER_LEN + (size_t)len;
+        return true;
+    }
+    if (!complete) {
+        return false;
+    }
+    ret = recv(impl->fd, impl->ctrl_buf, UDS_DOIP_HEADER_LEN + len, 0);
+    if (ret != (ssize_t)(UDS_DOIP_HEADER_LEN + len)) {
+        DoIPCloseConn(impl);
+        return false;
+    }
+    DoIPHandleCtrl(impl, type, &impl->ctrl_buf[UDS_DOIP_HEADER_LEN], len);
+    return true;
+}
+
+static void DoIPSendAnnouncement(UDSTpDoIP_t *impl, const struct sockaddr_in *to) {
+    uint8_t msg[UDS_DOIP_HEADER_LEN + DOIP_ANNOUNCEMENT_LEN] = {0};
+    uint8_t *p = &msg[UDS_DOIP_HEADER_LEN];
+    DoIPWriteHeader(msg, DOIP_VEHICLE_ANNOUNCEMENT, DOIP_ANNOUNCEMENT_LEN);
+    memcpy(p, impl->entity.vin, UDS_DOIP_VIN_LEN);
+    p += UDS_DOIP_VIN_LEN;
+    DoIPPut16(p, impl->entity.logicalAddress);
+    p += 2;
+    memcpy(p, impl->entity.eid, UDS_DOIP_EID_LEN);
+    p += UDS_DOIP_EID_LEN;
+    memcpy(p, impl->entity.gid, UDS_DOIP_GID_LEN);
+    // further action required and VIN/GID sync status are both 0x00
+    if (sendto(impl->udp_fd, msg, sizeof(msg), 0, (const struct sockaddr *)to, sizeof(*to)) < 0) {
+        UDS_LOGW(__FILE__, "'%s' announcement failed: %s", impl->tag, strerror(errno));
+    }
+}
+
+static void DoIPServeDiscovery(UDSTpDoIP_t *impl) {
+    uint8_t msg[UDS_DOIP_HEADER_LEN + UDS_DOIP_VIN_LEN];
+    struct sockaddr_in from;
+    socklen_t from_len = sizeof(from);
+    ssize_t ret;
+    while ((ret = recvfrom(impl->udp_fd, msg, sizeof(msg), 0, (struct sockaddr *)&from,
+                           &from_len)) >= UDS_DOIP_HEADER_LEN) {
+        if (!DoIPPatternValid(msg)) {
+            continue;
+        }
+        uint16_t type = DoIPGet16(&msg[2]);
+        uint32_t len = DoIPGet32(&msg[4]);
+        const uint8_t *p = &msg[UDS_DOIP_HEADER_LEN];
+        size_t p_len = (size_t)ret - UDS_DOIP_HEADER_LEN;
+        bool match = false;
+        if (DOIP_VEHICLE_ID_REQ == type) {
+            match = 0 == len;
+        } else if (DOIP_VEHICLE_ID_REQ_EID == type) {
+            match = UDS_DOIP_EID_LEN == len && UDS_DOIP_EID_LEN == p_len &&
+                    0 == memcmp(p, impl->entity.eid, UDS_DOIP_EID_LEN);
+        } else if (DOIP_VEHICLE_ID_REQ_VIN == type) {
+            match = UDS_DOIP_VIN_LEN == len && UDS_DOIP_VIN_LEN == p_len &&
+                    0 == memcmp(p, impl->entity.vin, UDS_DOIP_VIN_LEN);
+        }
+        if (match) {
+            DoIPSendAnnouncement(impl, &from);
+        }
+        from_len = sizeof(from);
+    }
+}
+
+static void DoIPServerAccept(UDSTpDoIP_t *impl) {
+    int fd = accept(impl->listen_fd, NULL, NULL);
+    if (fd < 0) {
+        return;
+    }
+    int flags = fcntl(fd, F_GETFL, 0);
+    (void)fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    DoIPConfigureSocket(fd);
+    if (impl->fd < 0) {
+        DoIPOpenConn(impl, fd);
+    } else if (impl->pending_fd < 0) {
+        // ISO 13400-2:2012 9.6.2: check that the registered tester is still alive before
+        // handing its socket to someone else
+        impl->pending_fd = fd;
+        impl->alive_pending = true;
+        impl->alive_timer = UDSMillis() + UDS_DOIP_CTRL_TIMEOUT_MS;
+        (void)DoIPSendCtrl(impl->fd, DOIP_ALIVE_CHECK_REQ, NULL, 0);
+    } else {
+        close(fd);
+    }
+}
+
+static UDSTpStatus_t doip_server_poll(UDSTp_t *hdl) {
+    UDSTpDoIP_t *impl = (UDSTpDoIP_t *)hdl;
+    UDSTpStatus_t status = 0;
+    DoIPServeDiscovery(impl);
+    DoIPServerAccept(impl);
+
+    uint32_t now = UDSMillis();
+    if (impl->alive_pending && UDSTimeAfter(now, impl->alive_timer)) {
+        UDS_LOGI(__FILE__, "'%s' alive check timed out", impl->tag);
+        DoIPCloseConn(impl);
+    }
+    if (impl->fd >= 0 && UDS_DOIP_ACTIVATING == impl->state && UDSTimeAfter(now, impl->timer)) {
+        UDS_LOGI(__FILE__, "'%s' no routing activation", impl->tag);
+        DoIPCloseConn(impl);
+    }
+    if (impl->fd >= 0 && UDSTimeAfter(now, impl->idle_timer)) {
+        UDS_LOGI(__FILE__, "'%s' connection idle", impl->tag);
+        DoIPCloseConn(impl);
+    }
+
+    ssize_t len = 0;
+    while (DoIPRecvOne(impl, NULL, 0, NULL, &len)) {
+        ;
+    }
+    if (impl->err) {
+        impl->err = false;
+        status |= UDS_TP_ERR;
+    }
+    return status;
+}
+
+static UDSTpStatus_t doip_client_poll(UDSTp_t *hdl) {
+    UDSTpDoIP_t *impl = (UDSTpDoIP_t *)hdl;
+    UDSTpStatus_t status = 0;
+    uint32_t now = UDSMillis();
+
+    if (UDS_DOIP_CONNECTING == impl->state) {
+        struct pollfd pfd = {.fd = impl->fd, .events = POLLOUT};
+        if (poll(&pfd, 1, 0) > 0) {
+            int pending_err = 0;
+            socklen_t err_len = sizeof(pending_err);
+            if (getsockopt(impl->fd, SOL_SOCKET, SO_ERROR, &pending_err, &err_len) < 0 ||
+                pending_err) {
+                UDS_LOGE(__FILE__, "'%s' connect failed: %s", impl->tag, strerror(pending_err));
+                DoIPCloseConn(impl);
+            } else {
+                // activation type 0x00 (default), reserved by ISO 13400
+                uint8_t req[7] = {0};
+                DoIPPut16(req, impl->sa);
+                impl->state = UDS_DOIP_ACTIVATING;
+                impl->timer = now + UDS_DOIP_CTRL_TIMEOUT_MS;
+                if (DoIPSendCtrl(impl->fd, DOIP_ROUTING_ACTIVATION_REQ, req, sizeof(req)) < 0) {
+                    DoIPCloseConn(impl);
+                }
+            }
+        } else if (UDSTimeAfter(now, impl->timer)) {
+            UDS_LOGE(__FILE__, "'%s' connect timed out", impl->tag);
+            DoIPCloseConn(impl);
+        }
+    } else if (UDS_DOIP_ACTIVATING == impl->state && UDSTimeAfter(now, impl->timer)) {
+        UDS_LOGE(__FILE__, "'%s' routing activation timed out", impl->tag);
+        DoIPCloseConn(impl);
+    }
+
+    ssize_t len = 0;
+    while (DoIPRecvOne(impl, NULL, 0, NULL, &len)) {
+        ;
+    }
+    if (impl->ack_pending) {
+        if (UDSTimeAfter(now, impl->ack_timer)) {
+            UDS_LOGE(__FILE__, "'%s' diagnostic message not acknowledged", impl->tag);
+            impl->ack_pending = false;
+            impl->err = true;
+        } else {
+            status |= UDS_TP_SEND_IN_PROGRESS;
+        }
+    }
+    if (impl->err) {
+        impl->err = false;
+        status |= UDS_TP_ERR;
+    }
+    return status;
+}
+
+static ssize_t doip_tp_recv(UDSTp_t *hdl, uint8_t *buf, size_t bufsize, UDSSDU_t *info) {
+    UDS_ASSERT(hdl);
+    UDS_ASSERT(buf);
+    UDSTpDoIP_t *impl = (UDSTpDoIP_t *)hdl;
+    ssize_t len = 0;
+    while (DoIPRecvOne(impl, buf, bufsize, info, &len) && 0 == len) {
+        ;
+    }
+    if (len > 0) {
+        UDS_LOGD(__FILE__, "'%s' received %zd bytes", impl->tag, len);
+        UDS_LOG_SDU(__FILE__, buf, len, info);
+    }
+    return len;
+}
+
+static ssize_t doip_tp_send(UDSTp_t *hdl, uint8_t *buf, size_t len, UDSSDU_t *info) {
+    UDS_ASSERT(hdl);
+    UDSTpDoIP_t *impl = (UDSTpDoIP_t *)hdl;
+    if (UDS_DOIP_ROUTED != impl->state) {
+        // a tester waits for routing activation, an entity without a tester has no one to answer
+        return impl->is_server || UDS_DOIP_FAILED == impl->state ? -1 : 0;
+    }
+    if (impl->ack_pending) {
+        return 0;
+    }
+    if (len > UDS_TP_MTU) {
+        return -1;
+    }
+    uint16_t sa = impl->sa;
+    uint16_t ta = impl->ta;
+    if (!impl->is_server && info && UDS_A_TA_TYPE_FUNCTIONAL == info->A_TA_Type) {
+        ta = impl->func_ta;
+    }
+    if (impl->is_server && info && info->A_SA <= UINT16_MAX && info->A_SA != sa &&
+        DoIPAcceptsTA(impl, (uint16_t)info->A_SA)) {
+        sa = (uint16_t)info->A_SA;
+    }
+
+    uint8_t hdr[DOIP_DIAG_HEADER_LEN];
+    DoIPWriteHeader(hdr, DOIP_DIAG_MESSAGE, (uint32_t)len + 4);
+    DoIPPut16(&hdr[UDS_DOIP_HEADER_LEN], sa);
+    DoIPPut16(&hdr[UDS_DOIP_HEADER_LEN + 2], ta);
+    struct iovec iov[2] = {
+        {.iov_base = hdr, .iov_len = sizeof(hdr)},
+        {.iov_base = buf, .iov_len = len},
+    };
+    if (DoIPSendAll(impl->fd, iov, 2) < 0) {
+        DoIPCloseConn(impl);
+        return -1;
+    }
+    if (!impl->is_server) {
+        impl->ack_pending = true;
+        impl->ack_timer = UDSMillis() + UDS_DOIP_CTRL_TIMEOUT_MS;
+    }
+    UDS_LOGD(__FILE__, "'%s' sends %zu bytes to 0x%04x", impl->tag, len, ta);
+    UDS_LOG_SDU(__FILE__, buf, len, info);
+    return (ssize_t)len;
+}
+
+static int DoIPSocket(int type) {
+    int fd = socket(AF_INET, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        UDS_LOGE(__FILE__, "socket failed: %s", strerror(errno));
+    }
+    return fd;
+}
+
+static bool DoIPAddr(struct sockaddr_in *addr, const char *ip, uint16_t port) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons(port);
+    if (NULL == ip) {
+        addr->sin_addr.s_addr = htonl(INADDR_ANY);
+        return true;
+    }
+    if (1 != inet_pton(AF_INET, ip, &addr->sin_addr)) {
+        UDS_LOGE(__FILE__, "invalid address: %s", ip);
+        return false;
+    }
+    return true;
+}
+
+static void DoIPInit(UDSTpDoIP_t *tp, const char *tag) {
+    memset(tp, 0, sizeof(*tp));
+    tp->hdl.send = doip_tp_send;
+    tp->hdl.recv = doip_tp_recv;
+    tp->fd = -1;
+    tp->listen_fd = -1;
+    tp->udp_fd = -1;
+    tp->pending_fd = -1;
+    memmove(tp->tag, tag, strlen(tag));
+}
+
+UDSErr_t UDSTpDoIPInitServer(UDSTpDoIP_t *tp, const char *ip, uint16_t port, uint16_t logical_addr,
+                             uint16_t func_addr) {
+    UDS_ASSERT(tp);
+    DoIPInit(tp, "server");
+    tp->hdl.poll = doip_server_poll;
+    tp->is_server = true;
+    tp->port = port;
+    tp->sa = logical_addr;
+    tp->func_ta = func_addr;
+    tp->entity.logicalAddress = logical_addr;
+
+    struct sockaddr_in addr;
+    if (!DoIPAddr(&addr, ip, port)) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    int one = 1;
+    tp->listen_fd = DoIPSocket(SOCK_STREAM);
+    if (tp->listen_fd < 0) {
+        goto fail;
+    }
+    (void)setsockopt(tp->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    // buffer sizes set before listen() are inherited by accepted sockets and affect the window
+    DoIPConfigureSocket(tp->listen_fd);
+    if (bind(tp->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(tp->listen_fd, 2) < 0) {
+        UDS_LOGE(__FILE__, "TCP bind/listen on port %u failed: %s", port, strerror(errno));
+        goto fail;
+    }
+
+    // vehicle identification requests are often broadcast, so listen on every address
+    tp->udp_fd = DoIPSocket(SOCK_DGRAM);
+    if (tp->udp_fd < 0) {
+        goto fail;
+    }
+    (void)setsockopt(tp->udp_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    (void)setsockopt(tp->udp_fd, SOL_SOCKET, SO_BROADCAST, &one, sizeof(one));
+    (void)DoIPAddr(&addr, NULL, port);
+    if (bind(tp->udp_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        UDS_LOGE(__FILE__, "UDP bind on port %u failed: %s", port, strerror(errno));
+        goto fail;
+    }
+    UDS_LOGI(__FILE__, "%s listening on port %u, logical address 0x%04x func 0x%04x", tp->tag,
+             port, logical_addr, func_addr);
+    return UDS_OK;
+fail:
+    UDSTpDoIPDeinit(tp);
+    return UDS_FAIL;
+}
+
+UDSErr_t UDSTpDoIPInitClient(UDSTpDoIP_t *tp, const char *ip, uint16_t port, uint16_t source_addr,
+                             uint16_t target_addr, uint16_t target_addr_func) {
+    UDS_ASSERT(tp);
+    UDS_ASSERT(ip);
+    DoIPInit(tp, "client");
+    tp->hdl.poll = doip_client_poll;
+    tp->port = port;
+    tp->sa = source_addr;
+    tp->ta = target_addr;
+    tp->func_ta = target_addr_func;
+
+    struct sockaddr_in addr;
+    if (!DoIPAddr(&addr, ip, port)) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    tp->fd = DoIPSocket(SOCK_STREAM);
+    if (tp->fd < 0) {
+        return UDS_FAIL;
+    }
+    DoIPConfigureSocket(tp->fd);
+    if (connect(tp->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 && EINPROGRESS != errno) {
+        UDS_LOGE(__FILE__, "connect to %s:%u failed: %s", ip, port, strerror(errno));
+        UDSTpDoIPDeinit(tp);
+        return UDS_FAIL;
+    }
+    tp->state = UDS_DOIP_CONNECTING;
+    tp->timer = UDSMillis() + UDS_DOIP_CTRL_TIMEOUT_MS;
+    tp->idle_timer = UDSMillis() + UDS_DOIP_GENERAL_INACTIVITY_MS;
+    UDS_LOGI(__FILE__, "%s connecting to %s:%u as 0x%04x, target 0x%04x func 0x%04x", tp->tag, ip,
+             port, source_addr, target_addr, target_addr_func);
+    return UDS_OK;
+}
+
+UDSErr_t UDSTpDoIPAnnounce(UDSTpDoIP_t *tp) {
+    if (NULL == tp || tp->udp_fd < 0) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    struct sockaddr_in addr;
+    (void)DoIPAddr(&addr, "255.255.255.255", tp->port);
+    DoIPSendAnnouncement(tp, &addr);
+    return UDS_OK;
+}
+
+void UDSTpDoIPDeinit(UDSTpDoIP_t *tp) {
+    if (NULL == tp) {
+        return;
+    }
+    int *fds[] = {&tp->fd, &tp->listen_fd, &tp->udp_fd, &tp->pending_fd};
+    for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++) {
+        if (*fds[i] >= 0) {
+            close(*fds[i]);
+            *fds[i] = -1;
+        }
+    }
+    tp->state = UDS_DOIP_CLOSED;
+}
+
+UDSErr_t UDSDoIPDiscoveryInit(UDSDoIPDiscovery_t *d, const char *ip, uint16_t port) {
+    UDS_ASSERT(d);
+    struct sockaddr_in addr;
+    if (!DoIPAddr(&addr, ip, port)) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    d->fd = DoIPSocket(SOCK_DGRAM);
+    if (d->fd < 0) {
+        return UDS_FAIL;
+    }
+    int one = 1;
+    (void)setsockopt(d->fd, SOL_SOCKET, SO_BROADCAST, &one, sizeof(one));
+    uint8_t req[UDS_DOIP_HEADER_LEN];
+    DoIPWriteHeader(req, DOIP_VEHICLE_ID_REQ, 0);
+    if (sendto(d->fd, req, sizeof(req), 0, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        UDS_LOGE(__FILE__, "vehicle identification request failed: %s", strerror(errno));
+        UDSDoIPDiscoveryDeinit(d);
+        return UDS_FAIL;
+    }
+    return UDS_OK;
+}
+
+bool UDSDoIPDiscoveryPoll(UDSDoIPDiscovery_t *d, UDSDoIPEntity_t *entity) {
+    UDS_ASSERT(d);
+    UDS_ASSERT(entity);
+    uint8_t msg[UDS_DOIP_HEADER_LEN + UDS_DOIP_CTRL_PAYLOAD_MAX];
+    struct sockaddr_in from;
+    socklen_t from_len = sizeof(from);
+    ssize_t ret;
+    while (d->fd >= 0 && (ret = recvfrom(d->fd, msg, sizeof(msg), 0, (struct sockaddr *)&from,
+                                         &from_len)) >= 0) {
+        from_len = sizeof(from);
+        // the VIN/GID sync status byte is optional
+        if (ret < UDS_DOIP_HEADER_LEN + DOIP_ANNOUNCEMENT_LEN - 1 || !DoIPPatternValid(msg) ||
+            DOIP_VEHICLE_ANNOUNCEMENT != DoIPGet16(&msg[2])) {
+            continue;
+        }
+        const uint8_t *p = &msg[UDS_DOIP_HEADER_LEN];
+        memset(entity, 0, sizeof(*entity));
+        memcpy(entity->vin, p, UDS_DOIP_VIN_LEN);
+        p += UDS_DOIP_VIN_LEN;
+        entity->logicalAddress = DoIPGet16(p);
+        p += 2;
+        memcpy(entity->eid, p, UDS_DOIP_EID_LEN);
+        p += UDS_DOIP_EID_LEN;
+        memcpy(entity->gid, p, UDS_DOIP_GID_LEN);
+        (void)inet_ntop(AF_INET, &from.sin_addr, entity->ip, sizeof(entity->ip));
+        return true;
+    }
+    return false;
+}
+
+void UDSDoIPDiscoveryDeinit(UDSDoIPDiscovery_t *d) {
+    if (d && d->fd >= 0) {
+        close(d->fd);
+        d->fd = -1;
+    }
+}
+
+#endif
@@ -0,0 +1,154 @@
+#if defined(UDS_TP_DOIP)
+
+#pragma once
+#include "tp.h"
+#include "uds.h"
+
+/** ISO 13400-2 UDP_DISCOVERY and TCP_DATA port */
+#define UDS_DOIP_PORT (13400)
+
+/** protocol version sent in the generic DoIP header. 0x02 is ISO 13400-2:2012 */
+#ifndef UDS_DOIP_PROTOCOL_VERSION
+#define UDS_DOIP_PROTOCOL_VERSION (0x02)
+#endif
+
+/** A_DoIP_Ctrl: how long routing activation and alive checks may take */
+#ifndef UDS_DOIP_CTRL_TIMEOUT_MS
+#define UDS_DOIP_CTRL_TIMEOUT_MS (2000)
+#endif
+
+/** T_TCP_Initial_Inactivity: how long a new connection may stay without routing activation */
+#ifndef UDS_DOIP_INITIAL_INACTIVITY_MS
+#define UDS_DOIP_INITIAL_INACTIVITY_MS (2000)
+#endif
+
+/** T_TCP_General_Inactivity: idle connections are closed after this long */
+#ifndef UDS_DOIP_GENERAL_INACTIVITY_MS
+#define UDS_DOIP_GENERAL_INACTIVITY_MS (300000)
+#endif
+
+#define UDS_DOIP_HEADER_LEN (8)
+#define UDS_DOIP_VIN_LEN (17)
+#define UDS_DOIP_EID_LEN (6)
+#define UDS_DOIP_GID_LEN (6)
+
+/** largest payload of a message other than a diagnostic message (a vehicle announcement) */
+#define UDS_DOIP_CTRL_PAYLOAD_MAX (40)
+
+/**
+ * @brief Identity of a DoIP entity, as sent in vehicle announcements
+ */
+typedef struct {
+    uint8_t vin[UDS_DOIP_VIN_LEN]; /**< vehicle identification number */
+    uint16_t logicalAddress;       /**< logical address of the entity */
+    uint8_t eid[UDS_DOIP_EID_LEN]; /**< entity identification, usually the MAC address */
+    uint8_t gid[UDS_DOIP_GID_LEN]; /**< group identification */
+    char ip[16];                   /**< address the announcement came from (discovery only) */
+} UDSDoIPEntity_t;
+
+typedef enum {
+    UDS_DOIP_CLOSED = 0,  /**< no connection */
+    UDS_DOIP_CONNECTING,  /**< client: TCP connection in progress */
+    UDS_DOIP_ACTIVATING,  /**< connected, routing not yet activated */
+    UDS_DOIP_ROUTED,      /**< diagnostic messages can be exchanged */
+    UDS_DOIP_FAILED,      /**< client: connection refused, closed or routing activation denied */
+} UDSDoIPState_t;
+
+/**
+ * @brief DoIP (ISO 13400-2) transport over TCP/IP
+ * @details Diagnostic messages are read from the socket directly into the buffer passed to
+ * `recv` and written from the buffer passed to `send`, so UDS_TP_MTU may be raised far above
+ * UDS_ISOTP_MTU without adding buffers here.
+ */
+typedef struct {
+    UDSTp_t hdl;
+    bool is_server;
+    UDSDoIPState_t state;
+    int fd;                 /**< TCP data connection */
+    int listen_fd;          /**< server: listening TCP socket */
+    int udp_fd;             /**< server: receives vehicle identification requests */
+    int pending_fd;         /**< server: new connection waiting for the alive check of `fd` */
+    uint16_t port;          /**< TCP and UDP port */
+    uint16_t sa;            /**< own logical address */
+    uint16_t ta;            /**< peer logical address. On a server, set by routing activation */
+    uint16_t func_ta;       /**< functional logical address */
+    /**
+     * @brief Server: also accept physical requests to `ta`, e.g. the ECUs behind a gateway
+     * (UDSRouterAcceptTA). Messages sent with `info->A_SA` set to such an address are sent from
+     * it. Optional.
+     */
+    bool (*accept_ta)(void *ctx, uint32_t ta);
+    void *accept_ctx;       /**< passed to accept_ta */
+    uint32_t timer;         /**< deadline of UDS_DOIP_CONNECTING and UDS_DOIP_ACTIVATING */
+    uint32_t idle_timer;    /**< T_TCP_General_Inactivity deadline */
+    uint32_t alive_timer;   /**< server: deadline of the alive check */
+    uint32_t ack_timer;     /**< client: deadline of the diagnostic message acknowledgement */
+    bool alive_pending;     /**< server: alive check request sent, no response yet */
+    bool ack_pending;       /**< client: diagnostic message sent, not yet acknowledged */
+    bool err;               /**< error to report in the next poll */
+    size_t discard;         /**< bytes of a rejected message still to be dropped */
+    uint8_t ctrl_buf[UDS_DOIP_HEADER_LEN + UDS_DOIP_CTRL_PAYLOAD_MAX];
+    UDSDoIPEntity_t entity; /**< server: identity sent in vehicle identification responses */
+    char tag[16];
+} UDSTpDoIP_t;
+
+/**
+ * @brief Initialize a DoIP entity that accepts one tester connection at a time
+ * @param tp
+ * @param ip local address to listen on, or NULL for any
+ * @param port TCP and UDP port, usually UDS_DOIP_PORT
+ * @param logical_addr logical address of the entity
+ * @param func_addr functional logical address the entity also accepts requests on
+ * @note set `tp->entity` after initialization to announce the VIN, EID and GID
+ * @return UDS_OK or UDS_FAIL
+ */
+UDSErr_t UDSTpDoIPInitServer(UDSTpDoIP_t *tp, const char *ip, uint16_t port, uint16_t logical_addr,
+                             uint16_t func_addr);
+
+/**
+ * @brief Initialize a DoIP tester
+ * @details The connection and routing activation complete in the background. Sends wait until
+ * routing is active.
+ * @param tp
+ * @param ip address of the DoIP entity
+ * @param port TCP port of the entity, usually UDS_DOIP_PORT
+ * @param source_addr logical address of the tester
+ * @param target_addr logical address of the entity
+ * @param target_addr_func functional logical address
+ * @return UDS_OK or UDS_FAIL
+ */
+UDSErr_t UDSTpDoIPInitClient(UDSTpDoIP_t *tp, const char *ip, uint16_t port, uint16_t source_addr,
+                             uint16_t target_addr, uint16_t target_addr_func);
+
+/**
+ * @brief Broadcast a vehicle announcement. Call after initialization to let testers know the
+ * entity is available.
+ */
+UDSErr_t UDSTpDoIPAnnounce(UDSTpDoIP_t *tp);
+
+void UDSTpDoIPDeinit(UDSTpDoIP_t *tp);
+
+/**
+ * @brief Vehicle discovery over UDP
+ */
+typedef struct {
+    int fd;
+} UDSDoIPDiscovery_t;
+
+/**
+ * @brief Send a vehicle identification request
+ * @param ip address to send to, e.g. "255.255.255.255" to reach every entity on the network
+ * @param port UDP port, usually UDS_DOIP_PORT
+ * @return UDS_OK or UDS_FAIL
+ */
+UDSErr_t UDSDoIPDiscoveryInit(UDSDoIPDiscovery_t *d, const char *ip, uint16_t port);
+
+/**
+ * @brief Check for a vehicle announcement
+ * @return true if `entity` was filled in. Call again until false to collect every response.
+ */
+bool UDSDoIPDiscoveryPoll(UDSDoIPDiscovery_t *d, UDSDoIPEntity_t *entity);
+
+void UDSDoIPDiscoveryDeinit(UDSDoIPDiscovery_t *d);
+
+#endif
@@ -0,0 +1,247 @@
+#if defined(UDS_TP_ESP32_TWAI)
+
+#include "tp/esp32_twai.h"
+#include "iso14229.h"
+#include "tp/isotp-c/isotp_defines.h"
+#include <stdarg.h>
+
+#define TWAI_ALERTS                                                                                \
+    (TWAI_ALERT_RX_DATA | TWAI_ALERT_RX_QUEUE_FULL | TWAI_ALERT_RX_FIFO_OVERRUN |                 \
+     TWAI_ALERT_BUS_OFF | TWAI_ALERT_BUS_RECOVERED)
+
+/* how long the RX task blocks on alerts before checking `stop` */
+#define TWAI_ALERT_WAIT_TICKS pdMS_TO_TICKS(100)
+
+static bool IsExtended(uint32_t id) { return UDS_TP_NOOP_ADDR != id && id > 0x7FF; }
+
+/* accept only the physical and functional source IDs in hardware. The SJA1000-style filter holds
+ * two standard IDs in dual filter mode or one extended ID (with don't-care bits) in single filter
+ * mode. Mask bits set to 1 are ignored. */
+static twai_filter_config_t AcceptanceFilter(uint32_t phys, uint32_t func) {
+    twai_filter_config_t f = TWAI_FILTER_CONFIG_ACCEPT_ALL();
+    if (UDS_TP_NOOP_ADDR == func) {
+        func = phys;
+    }
+    if (!IsExtended(phys) && !IsExtended(func)) {
+        // filter 1: ID in bits 31..21, RTR in bit 20, first data nibble in bits 19..16
+        // filter 2: ID in bits 15..5, RTR in bit 4, bits 3..0 unused
+        f.acceptance_code = (phys << 21) | (func << 5);
+        f.acceptance_mask = 0x000F000F;
+        f.single_filter = false;
+    } else if (IsExtended(phys) && IsExtended(func)) {
+        // ID in bits 31..3, RTR in bit 2. Bits that differ between the two IDs are ignored, so a
+        // few other IDs may pass. UDSISOTpCOnFrame() drops those.
+        f.acceptance_code = phys << 3;
+        f.acceptance_mask = ((phys ^ func) << 3) | 0x3;
+        f.single_filter = true;
+    }
+    // mixed standard and extended IDs: accept all and filter in software
+    return f;
+}
+
+uint32_t isotp_user_get_us(void) { return UDSMicros(); }
+
+__attribute__((format(printf, 1, 2))) void isotp_user_debug(const char *message, ...) {
+    va_list args;
+    va_start(args, message);
+    vprintf(message, args);
+    va_end(args);
+}
+
+#ifndef ISO_TP_USER_SEND_CAN_ARG
+#error "ISO_TP_USER_SEND_CAN_ARG must be defined"
+#endif
+int isotp_user_send_can(const uint32_t arbitration_id, const uint8_t *data, const uint8_t size,
+                        void *user_data) {
+    UDS_ASSERT(user_data);
+    UDSTpESP32TWAI_t *tp = (UDSTpESP32TWAI_t *)user_data;
+    twai_message_t msg = {0};
+    if (size > TWAI_FRAME_MAX_DLC) {
+        return ISOTP_RET_ERROR;
+    }
+    msg.identifier = arbitration_id;
+    msg.extd = IsExtended(arbitration_id);
+    msg.data_length_code = size;
+    memmove(msg.data, data, size);
+    switch (twai_transmit(&msg, 0)) {
+    case ESP_OK:
+        return ISOTP_RET_OK;
+    case ESP_ERR_TIMEOUT:
+        // TX queue full, isotp_poll() retries the frame
+        return ISOTP_RET_NOSPACE;
+    default:
+        tp->tx_failed++;
+        return ISOTP_RET_ERROR;
+    }
+}
+
+static bool RingFull(const UDSCANRing_t *ring) {
+    return (uint32_t)(ring->head - ring->tail) >= UDS_CAN_RING_SIZE;
+}
+
+/* move frames from the driver RX queue to the ring, waking the waiter once per batch. Frames that
+ * do not fit stay in the driver queue. Returns true if some were left there. */
+static bool MoveFrames(UDSTpESP32TWAI_t *tp) {
+    twai_message_t msg;
+    for (;;) {
+        unsigned n = 0;
+        while (n < UDS_TP_ESP32_TWAI_RX_BATCH && !RingFull(&tp->ring) &&
+               ESP_OK == twai_receive(&msg, 0)) {
+            if (msg.rtr) {
+                continue;
+            }
+            UDSCANRingPush(&tp->ring, msg.identifier, msg.data, msg.data_length_code);
+            n++;
+        }
+        TaskHandle_t waiter = tp->waiter;
+        if (n > 0 && NULL != waiter) {
+            xTaskNotifyGive(waiter);
+        }
+        if (n < UDS_TP_ESP32_TWAI_RX_BATCH) {
+            return RingFull(&tp->ring);
+        }
+    }
+}
+
+static void RxTask(void *arg) {
+    UDSTpESP32TWAI_t *tp = (UDSTpESP32TWAI_t *)arg;
+    bool pending = false;
+    while (!tp->stop) {
+        uint32_t alerts = 0;
+        // frames left in the driver queue are retried once the ring has been drained
+        twai_read_alerts(&alerts, pending ? 1 : TWAI_ALERT_WAIT_TICKS);
+        if (alerts & TWAI_ALERT_BUS_OFF) {
+            UDS_LOGW(__FILE__, "TWAI bus-off, recovering");
+            tp->bus_off++;
+            twai_initiate_recovery();
+            continue;
+        }
+        if (alerts & TWAI_ALERT_BUS_RECOVERED) {
+            UDS_LOGI(__FILE__, "TWAI bus recovered");
+            twai_start();
+        }
+        if (pending || (alerts & (TWAI_ALERT_RX_DATA | TWAI_ALERT_RX_QUEUE_FULL |
+                                  TWAI_ALERT_RX_FIFO_OVERRUN))) {
+            pending = MoveFrames(tp);
+        }
+    }
+    tp->rx_task = NULL;
+    vTaskDelete(NULL);
+}
+
+/* feed the received frames to isotp-c, then send what the link has ready */
+static UDSTpStatus_t esp32_twai_tp_poll(UDSTp_t *hdl) {
+    UDS_ASSERT(hdl);
+    UDSTpESP32TWAI_t *tp = (UDSTpESP32TWAI_t *)hdl;
+    UDSTpStatus_t status = 0;
+    IsoTpLink *link = &tp->isotp.phys_link;
+
+    tp->rx_frames += UDSISOTpCDrainRing(&tp->isotp, &tp->ring);
+
+    // isotp_poll() sends at most one consecutive frame. Without STmin, keep the driver TX queue
+    // full until flow control or the queue stops it.
+    do {
+        const uint16_t offset = link->send_offset;
+        isotp_poll(link);
+        if (offset == link->send_offset || 0 != link->send_st_min_us) {
+            break;
+        }
+    } while (ISOTP_SEND_STATUS_INPROGRESS == link->send_status);
+
+    if (ISOTP_SEND_STATUS_INPROGRESS == link->send_status) {
+        status |= UDS_TP_SEND_IN_PROGRESS;
+    }
+    if (ISOTP_SEND_STATUS_ERROR == link->send_status) {
+        status |= UDS_TP_ERR;
+    }
+    return status;
+}
+
+UDSErr_t UDSTpESP32TWAIInit(UDSTpESP32TWAI_t *tp, const UDSTpESP32TWAIConfig_t *cfg) {
+    if (NULL == tp || NULL == cfg || cfg->isotp.tx_dl > TWAI_FRAME_MAX_DLC) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    memset(tp, 0, sizeof(*tp));
+    UDSErr_t err = UDSISOTpCInit(&tp->isotp, &cfg->isotp);
+    if (err) {
+        return err;
+    }
+    // the hdl is the first member of both structs
+    tp->isotp.hdl.poll = esp32_twai_tp_poll;
+    tp->isotp.phys_link.user_send_can_arg = tp;
+    tp->isotp.func_link.user_send_can_arg = tp;
+    UDSCANRingInit(&tp->ring);
+
+    twai_general_config_t g_config =
+        TWAI_GENERAL_CONFIG_DEFAULT(cfg->tx_io, cfg->rx_io, TWAI_MODE_NORMAL);
+    g_config.tx_queue_len = cfg->tx_queue_len ? cfg->tx_queue_len : 32;
+    g_config.rx_queue_len = cfg->rx_queue_len ? cfg->rx_queue_len : 32;
+    g_config.alerts_enabled = TWAI_ALERTS;
+    const twai_filter_config_t f_config =
+        AcceptanceFilter(cfg->isotp.source_addr, cfg->isotp.source_addr_func);
+
+    if (ESP_OK != twai_driver_install(&g_config, &cfg->timing, &f_config)) {
+        UDS_LOGE(__FILE__, "twai_driver_install failed");
+        return UDS_FAIL;
+    }
+    if (ESP_OK != twai_start()) {
+        UDS_LOGE(__FILE__, "twai_start failed");
+        twai_driver_uninstall();
+        return UDS_FAIL;
+    }
+    TaskHandle_t task = NULL;
+    if (pdPASS != xTaskCreatePinnedToCore(RxTask, "uds_twai_rx", 3072, tp, cfg->rx_priority, &task,
+                                          cfg->rx_core)) {
+        UDS_LOGE(__FILE__, "failed to create the TWAI RX task");
+        twai_stop();
+        twai_driver_uninstall();
+        return UDS_FAIL;
+    }
+    tp->rx_task = task;
+    return UDS_OK;
+}
+
+void UDSTpESP32TWAIDeinit(UDSTpESP32TWAI_t *tp) {
+    UDS_ASSERT(tp);
+    tp->stop = true;
+    while (NULL != tp->rx_task) {
+        vTaskDelay(1);
+    }
+    twai_stop();
+    twai_driver_uninstall();
+}
+
+void UDSTpESP32TWAIWait(UDSTpESP32TWAI_t *tp, TickType_t ticks) {
+    UDS_ASSERT(tp);
+    // published before the ring is checked so that a frame pushed in between still wakes us
+    tp->waiter = xTaskGetCurrentTaskHandle();
+    if (tp->ring.head != tp->ring.tail) {
+        return;
+    }
+    // consecutive frames separated by STmin are sent from the poll
+    if (ISOTP_SEND_STATUS_INPROGRESS == tp->isotp.phys_link.send_status && ticks > 1) {
+        ticks = 1;
+    }
+    ulTaskNotifyTake(pdTRUE, ticks);
+}
+
+UDSErr_t UDSTpESP32TWAIGetStats(UDSTpESP32TWAI_t *tp, UDSTpESP32TWAIStats_t *stats) {
+    if (NULL == tp || NULL == stats) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    twai_status_info_t info = {0};
+    if (ESP_OK != twai_get_status_info(&info)) {
+        return UDS_FAIL;
+    }
+    stats->rx_frames = tp->rx_frames;
+    stats->rx_dropped = tp->ring.dropped;
+    stats->rx_missed = info.rx_missed_count;
+    stats->rx_overrun = info.rx_overrun_count;
+    stats->tx_failed = info.tx_failed_count + tp->tx_failed;
+    stats->arb_lost = info.arb_lost_count;
+    stats->bus_errors = info.bus_error_count;
+    stats->bus_off = tp->bus_off;
+    return UDS_OK;
+}
+
+#endif
@@ -0,0 +1,93 @@
+#pragma once
+
+#if defined(UDS_TP_ESP32_TWAI)
+
+#include "sys.h"
+#include "config.h"
+#include "uds.h"
+#include "tp.h"
+#include "tp/can_ring.h"
+#include "tp/isotp_c.h"
+#include <driver/twai.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/** most frames the RX task moves from the TWAI driver to the ring before waking the UDS task */
+#ifndef UDS_TP_ESP32_TWAI_RX_BATCH
+#define UDS_TP_ESP32_TWAI_RX_BATCH (16)
+#endif
+
+/**
+ * @brief Configuration of an ESP32 TWAI transport
+ */
+typedef struct {
+    UDSISOTpCConfig_t isotp; /**< CAN IDs. IDs above 0x7FF are sent and received as extended IDs.
+                                tx_dl must be 0 or 8: TWAI is a classic CAN controller */
+    gpio_num_t tx_io;
+    gpio_num_t rx_io;
+    twai_timing_config_t timing; /**< e.g. TWAI_TIMING_CONFIG_500KBITS() */
+    uint32_t tx_queue_len;       /**< frames the driver queues for sending. 0: 32 */
+    uint32_t rx_queue_len;       /**< frames the driver queues before the RX task runs. 0: 32 */
+    BaseType_t rx_core;          /**< core the RX task is pinned to */
+    UBaseType_t rx_priority;     /**< priority of the RX task, above the task polling the server */
+} UDSTpESP32TWAIConfig_t;
+
+/**
+ * @brief Bus and queue counters of an ESP32 TWAI transport
+ */
+typedef struct {
+    uint32_t rx_frames;  /**< frames passed to isotp-c */
+    uint32_t rx_dropped; /**< frames lost because the ring was full */
+    uint32_t rx_missed;  /**< frames lost because the driver RX queue was full */
+    uint32_t rx_overrun; /**< frames lost because the controller RX FIFO overran */
+    uint32_t tx_failed;  /**< frames that could not be sent */
+    uint32_t arb_lost;   /**< arbitration losses */
+    uint32_t bus_errors; /**< bus errors */
+    uint32_t bus_off;    /**< times the controller went bus-off and was recovered */
+} UDSTpESP32TWAIStats_t;
+
+/**
+ * @brief isotp-c over the ESP32 TWAI driver
+ * @details Only the hardware acceptance filter's IDs reach the driver. A task pinned to `rx_core`
+ * waits on TWAI alerts and moves the received frames from the driver into a lock-free ring in
+ * batches of up to UDS_TP_ESP32_TWAI_RX_BATCH, waking the task blocked in UDSTpESP32TWAIWait()
+ * once per batch rather than once per frame. Polling the
+ * transport feeds the whole ring to isotp-c at once and, while flow control allows back-to-back
+ * consecutive frames, keeps handing frames to the driver until its TX queue is full. Bus-off is
+ * recovered from automatically.
+ */
+typedef struct {
+    UDSISOTpC_t isotp; /**< set srv.tp or client.tp to &tp.isotp.hdl */
+    UDSCANRing_t ring; /**< frames received by the RX task, not yet passed to isotp-c */
+    TaskHandle_t volatile rx_task; /**< NULL once the RX task has exited */
+    TaskHandle_t volatile waiter;  /**< task that last called UDSTpESP32TWAIWait(), NULL if none */
+    volatile bool stop;            /**< asks the RX task to exit */
+    volatile uint32_t bus_off;     /**< see UDSTpESP32TWAIStats_t */
+    uint32_t rx_frames;            /**< see UDSTpESP32TWAIStats_t */
+    uint32_t tx_failed;            /**< see UDSTpESP32TWAIStats_t */
+} UDSTpESP32TWAI_t;
+
+/**
+ * @brief Install and start the TWAI driver, then start the RX task
+ * @return UDS_OK, UDS_ERR_INVALID_ARG, or UDS_FAIL if the driver or the task could not be started
+ */
+UDSErr_t UDSTpESP32TWAIInit(UDSTpESP32TWAI_t *tp, const UDSTpESP32TWAIConfig_t *cfg);
+
+/**
+ * @brief Stop the RX task and uninstall the TWAI driver
+ */
+void UDSTpESP32TWAIDeinit(UDSTpESP32TWAI_t *tp);
+
+/**
+ * @brief Block the calling task until frames are received or `ticks` have elapsed
+ * @details Call it between polls of the server or client instead of a fixed delay, so that a
+ * request is handled as soon as its last frame arrives.
+ */
+void UDSTpESP32TWAIWait(UDSTpESP32TWAI_t *tp, TickType_t ticks);
+
+/**
+ * @brief Read the bus and queue counters
+ */
+UDSErr_t UDSTpESP32TWAIGetStats(UDSTpESP32TWAI_t *tp, UDSTpESP32TWAIStats_t *stats);
+
+#endif
@@ -29,6 +29,35 @@ static uint32_t isotp_st_min_to_us(uint8_t st_min) {
     return 0;
 }
 
+/* round a frame length up to the next valid CAN FD data length */
+static uint8_t isotp_can_dl(uint8_t len) {
+    static const uint8_t fd_dls[] = {12, 16, 20, 24, 32, 48, 64};
+    uint8_t i;
+
+    if (len <= ISO_TP_CAN_DL) {
+        return len;
+    }
+    for (i = 0; i < sizeof(fd_dls); i++) {
+        if (len <= fd_dls[i]) {
+            return fd_dls[i];
+        }
+    }
+    return ISO_TP_CANFD_MAX_DL;
+}
+
+/* pad a frame holding len bytes, returns the length of the frame to send */
+static uint8_t isotp_pad_frame(uint8_t *frame, uint8_t len) {
+    /* CAN FD frames longer than 8 bytes must always be padded to a valid data length */
+    uint8_t padded = isotp_can_dl(len);
+#ifdef ISO_TP_FRAME_PADDING
+    if (padded < ISO_TP_CAN_DL) {
+        padded = ISO_TP_CAN_DL;
+    }
+#endif
+    (void) memset(frame + len, ISO_TP_FRAME_PADDING_VALUE, padded - len);
+    return padded;
+}
+
 static int isotp_send_flow_control(const IsoTpLink* link, uint8_t flow_status, uint8_t block_size, uint32_t st_min_us) {
 
     IsoTpCanMessage message;
@@ -44,7 +73,7 @@ static int isotp_send_flow_control(const IsoTpLink* link, uint8_t flow_status, u
     /* send message */
 #ifdef ISO_TP_FRAME_PADDING
     (void) memset(message.as.flow_control.reserve, ISO_TP_FRAME_PADDING_VALUE, sizeof(message.as.flow_control.reserve));
-    size = sizeof(message);
+    size = ISO_TP_CAN_DL;
 #else
     size = 3;
 #endif
@@ -63,23 +92,26 @@ static int isotp_send_single_frame(const IsoTpLink* link, uint32_t id) {
     IsoTpCanMessage message;
     int ret;
     uint8_t size = 0;
+    uint8_t pci_len = 1;
     (void)id;
 
-    /* multi frame message length must greater than 7  */
-    assert(link->send_size <= 7);
+    /* multi frame message length must greater than the single frame capacity */
+    assert(link->send_size <= isotp_max_single_frame_size(link));
 
     /* setup message  */
     message.as.single_frame.type = ISOTP_PCI_TYPE_SINGLE;
-    message.as.single_frame.SF_DL = (uint8_t) link->send_size;
-    (void) memcpy(message.as.single_frame.data, link->send_buffer, link->send_size);
+    if (link->send_size <= 7) {
+        message.as.single_frame.SF_DL = (uint8_t) link->send_size;
+    } else {
+        /* CAN FD: SF_DL escape sequence, the length follows in the second byte */
+        message.as.single_frame.SF_DL = 0;
+        message.as.data_array.ptr[1] = (uint8_t) link->send_size;
+        pci_len = 2;
+    }
+    (void) memcpy(message.as.data_array.ptr + pci_len, link->send_data, link->send_size);
 
     /* send message */
-#ifdef ISO_TP_FRAME_PADDING
-    (void) memset(message.as.single_frame.data + link->send_size, ISO_TP_FRAME_PADDING_VALUE, sizeof(message.as.single_frame.data) - link->send_size);
-    size = sizeof(message);
-#else
-    size = link->send_size + 1;
-#endif
+    size = isotp_pad_frame(message.as.data_array.ptr, (uint8_t) (pci_len + link->send_size));
 
     ret = isotp_user_send_can(link->send_arbitration_id, message.as.data_array.ptr, size
     #if defined (ISO_TP_USER_SEND_CAN_ARG)
@@ -94,25 +126,39 @@ static int isotp_send_first_frame(IsoTpLink* link, uint32_t id) {
     
     IsoTpCanMessage message;
     int ret;
+    uint8_t pci_len = 2;
+    uint8_t data_length;
 
-    /* multi frame message length must greater than 7  */
-    assert(link->send_size > 7);
+    /* multi frame message length must greater than the single frame capacity */
+    assert(link->send_size > isotp_max_single_frame_size(link));
 
     /* setup message  */
     message.as.first_frame.type = ISOTP_PCI_TYPE_FIRST_FRAME;
-    message.as.first_frame.FF_DL_low = (uint8_t) link->send_size;
-    message.as.first_frame.FF_DL_high = (uint8_t) (0x0F & (link->send_size >> 8));
-    (void) memcpy(message.as.first_frame.data, link->send_buffer, sizeof(message.as.first_frame.data));
+    if (link->send_size <= ISO_TP_FF_DL_12BIT_MAX) {
+        message.as.first_frame.FF_DL_low = (uint8_t) link->send_size;
+        message.as.first_frame.FF_DL_high = (uint8_t) (0x0F & (link->send_size >> 8));
+    } else {
+        /* FF_DL escape sequence, the length follows as a 32 bit big endian value */
+        message.as.first_frame.FF_DL_low = 0;
+        message.as.first_frame.FF_DL_high = 0;
+        message.as.data_array.ptr[2] = 0;
+        message.as.data_array.ptr[3] = 0;
+        message.as.data_array.ptr[4] = (uint8_t) (link->send_size >> 8);
+        message.as.data_array.ptr[5] = (uint8_t) link->send_size;
+        pci_len = 6;
+    }
+    data_length = (uint8_t) (link->send_frame_len - pci_len);
+    (void) memcpy(message.as.data_array.ptr + pci_len, link->send_data, data_length);
 
     /* send message */
-    ret = isotp_user_send_can(id, message.as.data_array.ptr, sizeof(message) 
+    ret = isotp_user_send_can(id, message.as.data_array.ptr, link->send_frame_len
     #if defined (ISO_TP_USER_SEND_CAN_ARG)
     ,link->user_send_can_arg
     #endif
 
     );
     if (ISOTP_RET_OK == ret) {
-        link->send_offset += sizeof(message.as.first_frame.data);
+        link->send_offset += data_length;
         link->send_sn = 1;
     }
 
@@ -126,25 +172,20 @@ static int isotp_send_consecutive_frame(IsoTpLink* link) {
     int ret;
     uint8_t size = 0;
 
-    /* multi frame message length must greater than 7  */
-    assert(link->send_size > 7);
+    /* multi frame message length must greater than the single frame capacity */
+    assert(link->send_size > isotp_max_single_frame_size(link));
 
     /* setup message  */
     message.as.consecutive_frame.type = TSOTP_PCI_TYPE_CONSECUTIVE_FRAME;
     message.as.consecutive_frame.SN = link->send_sn;
     data_length = link->send_size - link->send_offset;
-    if (data_length > sizeof(message.as.consecutive_frame.data)) {
-        data_length = sizeof(message.as.consecutive_frame.data);
+    if (data_length > link->send_frame_len - 1) {
+        data_length = link->send_frame_len - 1;
     }
-    (void) memcpy(message.as.consecutive_frame.data, link->send_buffer + link->send_offset, data_length);
+    (void) memcpy(message.as.data_array.ptr + 1, link->send_data + link->send_offset, data_length);
 
     /* send message */
-#ifdef ISO_TP_FRAME_PADDING
-    (void) memset(message.as.consecutive_frame.data + data_length, ISO_TP_FRAME_PADDING_VALUE, sizeof(message.as.consecutive_frame.data) - data_length);
-    size = sizeof(message);
-#else
-    size = data_length + 1;
-#endif
+    size = isotp_pad_frame(message.as.data_array.ptr, (uint8_t) (data_length + 1));
 
     ret = isotp_user_send_can(link->send_arbitration_id,
             message.as.data_array.ptr, size
@@ -164,33 +205,61 @@ static int isotp_send_consecutive_frame(IsoTpLink* link) {
 }
 
 static int isotp_receive_single_frame(IsoTpLink* link, const IsoTpCanMessage* message, uint8_t len) {
+    uint8_t sf_dl = message->as.single_frame.SF_DL;
+    uint8_t pci_len = 1;
+
+    /* CAN FD: frames longer than 8 bytes carry SF_DL after the escape sequence */
+    if (len > ISO_TP_CAN_DL) {
+        if (0 != sf_dl) {
+            isotp_user_debug("Single-frame escape sequence missing.");
+            return ISOTP_RET_LENGTH;
+        }
+        sf_dl = message->as.data_array.ptr[1];
+        pci_len = 2;
+    }
+
     /* check data length */
-    if ((0 == message->as.single_frame.SF_DL) || (message->as.single_frame.SF_DL > (len - 1))) {
+    if ((0 == sf_dl) || (sf_dl > (len - pci_len))) {
         isotp_user_debug("Single-frame length too small.");
         return ISOTP_RET_LENGTH;
     }
 
     /* copying data */
-    (void) memcpy(link->receive_buffer, message->as.single_frame.data, message->as.single_frame.SF_DL);
-    link->receive_size = message->as.single_frame.SF_DL;
+    (void) memcpy(link->receive_buffer, message->as.data_array.ptr + pci_len, sf_dl);
+    link->receive_size = sf_dl;
     
     return ISOTP_RET_OK;
 }
 
 static int isotp_receive_first_frame(IsoTpLink *link, IsoTpCanMessage *message, uint8_t len) {
-    uint16_t payload_length;
+    uint32_t payload_length;
+    uint8_t pci_len = 2;
 
-    if (8 != len) {
-        isotp_user_debug("First frame should be 8 bytes in length.");
+    /* the first frame sets RX_DL, it must be 8 bytes or a CAN FD data length */
+    if (len < ISO_TP_CAN_DL || isotp_can_dl(len) != len) {
+        isotp_user_debug("First frame should be 8 bytes in length or a CAN FD data length.");
         return ISOTP_RET_LENGTH;
     }
 
     /* check data length */
     payload_length = message->as.first_frame.FF_DL_high;
-    payload_length = (uint16_t)(payload_length << 8) + message->as.first_frame.FF_DL_low;
+    payload_length = (payload_length << 8) + message->as.first_frame.FF_DL_low;
+
+    /* FF_DL escape sequence */
+    if (0 == payload_length) {
+        payload_length = ((uint32_t) message->as.data_array.ptr[2] << 24) |
+                         ((uint32_t) message->as.data_array.ptr[3] << 16) |
+                         ((uint32_t) message->as.data_array.ptr[4] << 8) |
+                         (uint32_t) message->as.data_array.ptr[5];
+        pci_len = 6;
+        if (payload_length <= ISO_TP_FF_DL_12BIT_MAX) {
+            isotp_user_debug("Escape sequence used for a short first frame.");
+            return ISOTP_RET_LENGTH;
+        }
+    }
 
     /* should not use multiple frame transmition */
-    if (payload_length <= 7) {
+    if (payload_length <= (len > ISO_TP_CAN_DL ? len - 2u : 7u)) {
         isotp_user_debug("Should not use multiple frame transmission.");
         return ISOTP_RET_LENGTH;
     }
@@ -201,9 +270,10 @@ static int isotp_receive_first_frame(IsoTpLink *link, IsoTpCanMessage *message,
     }
     
     /* copying data */
-    (void) memcpy(link->receive_buffer, message->as.first_frame.data, sizeof(message->as.first_frame.data));
-    link->receive_size = payload_length;
-    link->receive_offset = sizeof(message->as.first_frame.data);
+    (void) memcpy(link->receive_buffer, message->as.data_array.ptr + pci_len, len - pci_len);
+    link->receive_size = (uint16_t) payload_length;
+    link->receive_offset = len - pci_len;
+    link->receive_frame_len = len;
     link->receive_sn = 1;
 
     return ISOTP_RET_OK;
@@ -219,8 +289,8 @@ static int isotp_receive_consecutive_frame(IsoTpLink *link, IsoTpCanMessage *mes
 
     /* check data length */
     remaining_bytes = link->receive_size - link->receive_offset;
-    if (remaining_bytes > sizeof(message->as.consecutive_frame.data)) {
-        remaining_bytes = sizeof(message->as.consecutive_frame.data);
+    if (remaining_bytes > link->receive_frame_len - 1) {
+        remaining_bytes = link->receive_frame_len - 1;
     }
     if (remaining_bytes > len - 1) {
         isotp_user_debug("Consecutive frame too short.");
@@ -228,7 +298,7 @@ static int isotp_receive_consecutive_frame(IsoTpLink *link, IsoTpCanMessage *mes
     }
 
     /* copying data */
-    (void) memcpy(link->receive_buffer + link->receive_offset, message->as.consecutive_frame.data, remaining_bytes);
+    (void) memcpy(link->receive_buffer + link->receive_offset, message->as.data_array.ptr + 1, remaining_bytes);
 
     link->receive_offset += remaining_bytes;
     if (++(link->receive_sn) > 0x0F) {
@@ -256,13 +326,25 @@ static int isotp_receive_flow_control_frame(IsoTpLink *link, IsoTpCanMessage *me
 ///                 PUBLIC FUNCTIONS                ///
 ///////////////////////////////////////////////////////
 
+int isotp_set_tx_dl(IsoTpLink *link, uint8_t tx_dl) {
+    if (link == 0x0 || tx_dl < ISO_TP_CAN_DL || isotp_can_dl(tx_dl) != tx_dl) {
+        return ISOTP_RET_ERROR;
+    }
+    link->send_frame_len = tx_dl;
+    return ISOTP_RET_OK;
+}
+
+uint16_t isotp_max_single_frame_size(const IsoTpLink *link) {
+    return link->send_frame_len > ISO_TP_CAN_DL ? link->send_frame_len - 2 : 7;
+}
+
+static int isotp_start_send(IsoTpLink *link, uint32_t id, const uint8_t *data, uint16_t size);
+
 int isotp_send(IsoTpLink *link, const uint8_t payload[], uint16_t size) {
     return isotp_send_with_id(link, link->send_arbitration_id, payload, size);
 }
 
 int isotp_send_with_id(IsoTpLink *link, uint32_t id, const uint8_t payload[], uint16_t size) {
-    int ret;
-
     if (link == 0x0) {
         isotp_user_debug("Link is null!");
         return ISOTP_RET_ERROR;
@@ -286,12 +368,39 @@ int isotp_send_with_id(IsoTpLink *link, uint32_t id, const uint8_t payload[], ui
         return ISOTP_RET_INPROGRESS;
     }
 
+    /* a half duplex link drops the message it was receiving, the buffer now holds the payload */
+    if (link->send_buffer == link->receive_buffer) {
+        link->receive_status = ISOTP_RECEIVE_STATUS_IDLE;
+    }
+
     /* copy into local buffer */
+    (void) memcpy(link->send_buffer, payload, size);
+
+    return isotp_start_send(link, id, link->send_buffer, size);
+}
+
+int isotp_send_in_place(IsoTpLink *link, uint32_t id, const uint8_t payload[], uint16_t size) {
+    if (link == 0x0 || (payload == 0x0 && size > 0)) {
+        isotp_user_debug("Link or payload is null!");
+        return ISOTP_RET_ERROR;
+    }
+
+    if (ISOTP_SEND_STATUS_INPROGRESS == link->send_status) {
+        isotp_user_debug("Abort previous message, transmission in progress.\n");
+        return ISOTP_RET_INPROGRESS;
+    }
+
+    return isotp_start_send(link, id, payload, size);
+}
+
+static int isotp_start_send(IsoTpLink *link, uint32_t id, const uint8_t *data, uint16_t size) {
+    int ret;
+
+    link->send_data = data;
     link->send_size = size;
     link->send_offset = 0;
-    (void) memcpy(link->send_buffer, payload, size);
- 
-    if (link->send_size < 8) {
+
+    if (link->send_size <= isotp_max_single_frame_size(link)) {
         /* send single frame */
         ret = isotp_send_single_frame(link, id);
     } else {
@@ -313,19 +422,120 @@ int isotp_send_with_id(IsoTpLink *link, uint32_t id, const uint8_t payload[], ui
     return ret;
 }
 
+/* sends the flow control chosen by the link's policy. An FC.WAIT already sent is repeated only
+ * when its timer expires, unless send_wait is set */
+static void isotp_flow_control(IsoTpLink *link, int send_wait) {
+    IsoTpFlowControlParams fc;
+
+    fc.flow_status = PCI_FLOW_STATUS_CONTINUE;
+    fc.block_size = ISO_TP_DEFAULT_BLOCK_SIZE;
+    fc.st_min_us = ISO_TP_DEFAULT_ST_MIN_US;
+    if (NULL != link->receive_fc_fn) {
+        link->receive_fc_fn(link, &fc, link->receive_fc_arg);
+    }
+
+    /* a held first frame cannot be copied before the previous message has been read */
+    if (0 != link->receive_ff_len && PCI_FLOW_STATUS_CONTINUE == fc.flow_status) {
+        fc.flow_status = PCI_FLOW_STATUS_WAIT;
+    }
+
+    if (PCI_FLOW_STATUS_WAIT == fc.flow_status) {
+        if (!send_wait && !IsoTpTimeAfter(isotp_user_get_us(), link->receive_timer_wait)) {
+            return;
+        }
+        if (link->receive_wft_count < ISO_TP_MAX_WFT_NUMBER) {
+            isotp_send_flow_control(link, PCI_FLOW_STATUS_WAIT, 0, 0);
+            link->receive_wft_count += 1;
+            link->receive_fc_wait_count += 1;
+            link->receive_fc_pending = 1;
+            /* repeat before the sender's N_Bs expires */
+            link->receive_timer_wait = isotp_user_get_us() + ISO_TP_DEFAULT_RESPONSE_TIMEOUT_US / 2;
+            link->receive_timer_cr = isotp_user_get_us() + ISO_TP_DEFAULT_RESPONSE_TIMEOUT_US;
+            return;
+        }
+        /* N_WFTmax reached */
+        fc.flow_status = PCI_FLOW_STATUS_OVERFLOW;
+    }
+
+    link->receive_fc_pending = 0;
+    if (PCI_FLOW_STATUS_CONTINUE != fc.flow_status) {
+        isotp_send_flow_control(link, PCI_FLOW_STATUS_OVERFLOW, 0, 0);
+        link->receive_ff_len = 0;
+        if (ISOTP_RECEIVE_STATUS_INPROGRESS == link->receive_status) {
+            link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_BUFFER_OVFLW;
+            link->receive_status = ISOTP_RECEIVE_STATUS_IDLE;
+        }
+        return;
+    }
+
+    link->receive_wft_count = 0;
+    link->receive_bs_count = fc.block_size;
+    link->receive_fc_bs = fc.block_size;
+    link->receive_fc_st_min_us = fc.st_min_us;
+    isotp_send_flow_control(link, PCI_FLOW_STATUS_CONTINUE, fc.block_size, fc.st_min_us);
+}
+
+static void isotp_on_first_frame(IsoTpLink *link, IsoTpCanMessage *message, uint8_t len) {
+    int ret;
+
+    /* update protocol result */
+    if (ISOTP_RECEIVE_STATUS_INPROGRESS == link->receive_status) {
+        link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_UNEXP_PDU;
+    } else {
+        link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_OK;
+    }
+
+    /* handle message */
+    ret = isotp_receive_first_frame(link, message, len);
+
+    /* if overflow happened */
+    if (ISOTP_RET_OVERFLOW == ret) {
+        /* update protocol result */
+        link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_BUFFER_OVFLW;
+        /* change status */
+        link->receive_status = ISOTP_RECEIVE_STATUS_IDLE;
+        /* send error message */
+        isotp_send_flow_control(link, PCI_FLOW_STATUS_OVERFLOW, 0, 0);
+        return;
+    }
+
+    /* if receive successful */
+    if (ISOTP_RET_OK == ret) {
+        /* change status */
+        link->receive_status = ISOTP_RECEIVE_STATUS_INPROGRESS;
+        link->receive_timer_poll = 0;
+        /* refresh timer cs */
+        link->receive_timer_cr = isotp_user_get_us() + ISO_TP_DEFAULT_RESPONSE_TIMEOUT_US;
+        /* send fc frame */
+        isotp_flow_control(link, 1);
+    }
+}
+
 void isotp_on_can_message(IsoTpLink* link, const uint8_t* data, uint8_t len) {
     IsoTpCanMessage message;
     int ret;
     
-    if (len < 2 || len > 8) {
+    if (len < 2 || len > ISO_TP_MAX_FRAME_LEN) {
         return;
     }
 
     memcpy(message.as.data_array.ptr, data, len);
     memset(message.as.data_array.ptr + len, 0, sizeof(message.as.data_array.ptr) - len);
 
+    /* a half duplex link is sending from the buffer it would receive into */
+    if (link->send_data == link->receive_buffer &&
+        ISOTP_SEND_STATUS_INPROGRESS == link->send_status &&
+        ISOTP_PCI_TYPE_FLOW_CONTROL_FRAME != message.as.common.type) {
+        return;
+    }
+
     switch (message.as.common.type) {
         case ISOTP_PCI_TYPE_SINGLE: {
+            /* the previous message is still lent out with isotp_receive_peek() */
+            if (ISOTP_RECEIVE_STATUS_HELD == link->receive_status) {
+                break;
+            }
+
             /* update protocol result */
             if (ISOTP_RECEIVE_STATUS_INPROGRESS == link->receive_status) {
                 link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_UNEXP_PDU;
@@ -343,38 +553,16 @@ void isotp_on_can_message(IsoTpLink* link, const uint8_t* data, uint8_t len) {
             break;
         }
         case ISOTP_PCI_TYPE_FIRST_FRAME: {
-            /* update protocol result */
-            if (ISOTP_RECEIVE_STATUS_INPROGRESS == link->receive_status) {
-                link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_UNEXP_PDU;
-            } else {
-                link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_OK;
-            }
-
-            /* handle message */
-            ret = isotp_receive_first_frame(link, &message, len);
-
-            /* if overflow happened */
-            if (ISOTP_RET_OVERFLOW == ret) {
-                /* update protocol result */
-                link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_BUFFER_OVFLW;
-                /* change status */
-                link->receive_status = ISOTP_RECEIVE_STATUS_IDLE;
-                /* send error message */
-                isotp_send_flow_control(link, PCI_FLOW_STATUS_OVERFLOW, 0, 0);
+            link->receive_wft_count = 0;
+            if (ISOTP_RECEIVE_STATUS_HELD == link->receive_status ||
+                (NULL != link->receive_fc_fn && ISOTP_RECEIVE_STATUS_FULL == link->receive_status)) {
+                /* hold the first frame until the previous message has been read */
+                (void) memcpy(link->receive_ff, data, len);
+                link->receive_ff_len = len;
+                isotp_flow_control(link, 1);
                 break;
             }
-
-            /* if receive successful */
-            if (ISOTP_RET_OK == ret) {
-                /* change status */
-                link->receive_status = ISOTP_RECEIVE_STATUS_INPROGRESS;
-                /* send fc frame */
-                link->receive_bs_count = ISO_TP_DEFAULT_BLOCK_SIZE;
-                isotp_send_flow_control(link, PCI_FLOW_STATUS_CONTINUE, link->receive_bs_count, ISO_TP_DEFAULT_ST_MIN_US);
-                /* refresh timer cs */
-                link->receive_timer_cr = isotp_user_get_us() + ISO_TP_DEFAULT_RESPONSE_TIMEOUT_US;
-            }
-            
+            isotp_on_first_frame(link, &message, len);
             break;
         }
         case TSOTP_PCI_TYPE_CONSECUTIVE_FRAME: {
@@ -403,10 +591,9 @@ void isotp_on_can_message(IsoTpLink* link, const uint8_t* data, uint8_t len) {
                 if (link->receive_offset >= link->receive_size) {
                     link->receive_status = ISOTP_RECEIVE_STATUS_FULL;
                 } else {
-                    /* send fc when bs reaches limit */
-                    if (0 == --link->receive_bs_count) {
-                        link->receive_bs_count = ISO_TP_DEFAULT_BLOCK_SIZE;
-                        isotp_send_flow_control(link, PCI_FLOW_STATUS_CONTINUE, link->receive_bs_count, ISO_TP_DEFAULT_ST_MIN_US);
+                    /* send fc when bs reaches limit, BS=0 asks for none */
+                    if (0 != link->receive_fc_bs && 0 == --link->receive_bs_count) {
+                        isotp_flow_control(link, 1);
                     }
                 }
             }
@@ -482,19 +669,62 @@ int isotp_receive(IsoTpLink *link, uint8_t *payload, const uint16_t payload_size
     return ISOTP_RET_OK;
 }
 
+int isotp_receive_peek(IsoTpLink *link, const uint8_t **payload, uint16_t *out_size) {
+    if (ISOTP_RECEIVE_STATUS_FULL != link->receive_status &&
+        ISOTP_RECEIVE_STATUS_HELD != link->receive_status) {
+        return ISOTP_RET_NO_DATA;
+    }
+
+    *payload = link->receive_buffer;
+    *out_size = link->receive_size;
+    link->receive_status = ISOTP_RECEIVE_STATUS_HELD;
+
+    return ISOTP_RET_OK;
+}
+
+void isotp_receive_release(IsoTpLink *link) {
+    if (ISOTP_RECEIVE_STATUS_HELD == link->receive_status) {
+        link->receive_status = ISOTP_RECEIVE_STATUS_IDLE;
+    }
+}
+
 void isotp_init_link(IsoTpLink *link, uint32_t sendid, uint8_t *sendbuf, uint16_t sendbufsize, uint8_t *recvbuf, uint16_t recvbufsize) {
     memset(link, 0, sizeof(*link));
     link->receive_status = ISOTP_RECEIVE_STATUS_IDLE;
     link->send_status = ISOTP_SEND_STATUS_IDLE;
     link->send_arbitration_id = sendid;
+    link->send_frame_len = ISO_TP_CAN_DL;
     link->send_buffer = sendbuf;
     link->send_buf_size = sendbufsize;
     link->receive_buffer = recvbuf;
     link->receive_buf_size = recvbufsize;
+    link->receive_poll_us = UINT32_MAX;
     
     return;
 }
 
+void isotp_set_flow_control(IsoTpLink *link, IsoTpFlowControlFn fn, void *arg) {
+    link->receive_fc_fn = fn;
+    link->receive_fc_arg = arg;
+}
+
+void isotp_flow_control_adaptive(const IsoTpLink *link, IsoTpFlowControlParams *fc, void *arg) {
+    uint32_t cf_len = (link->receive_frame_len > 1 ? link->receive_frame_len : ISO_TP_CAN_DL) - 1u;
+    uint32_t frames_left = (link->receive_size - link->receive_offset + cf_len - 1) / cf_len;
+    (void) arg;
+
+    fc->flow_status = PCI_FLOW_STATUS_CONTINUE;
+    fc->st_min_us = 0;
+    if (frames_left <= ISO_TP_RX_QUEUE_FRAMES ||
+        link->receive_poll_us <= ISO_TP_RX_QUEUE_FRAMES * ISO_TP_MIN_FRAME_TIME_US / 2) {
+        /* the receiver keeps up */
+        fc->block_size = 0;
+    } else {
+        /* stop the sender before the driver queue overruns */
+        fc->block_size = ISO_TP_RX_QUEUE_FRAMES;
+    }
+}
+
 void isotp_poll(IsoTpLink *link) {
     int ret;
 
@@ -533,9 +763,35 @@ void isotp_poll(IsoTpLink *link) {
         }
     }
 
+    /* flow control postponed with FC.WAIT */
+    if (link->receive_fc_pending) {
+        if (0 != link->receive_ff_len && ISOTP_RECEIVE_STATUS_FULL != link->receive_status &&
+            ISOTP_RECEIVE_STATUS_HELD != link->receive_status) {
+            /* the previous message has been read, take the first frame held for it */
+            IsoTpCanMessage message;
+            uint8_t len = link->receive_ff_len;
+
+            (void) memcpy(message.as.data_array.ptr, link->receive_ff, len);
+            (void) memset(message.as.data_array.ptr + len, 0, sizeof(message.as.data_array.ptr) - len);
+            link->receive_ff_len = 0;
+            link->receive_fc_pending = 0;
+            isotp_on_first_frame(link, &message, len);
+        } else {
+            isotp_flow_control(link, 0);
+        }
+    }
+
     /* only polling when operation in progress */
     if (ISOTP_RECEIVE_STATUS_INPROGRESS == link->receive_status) {
-        
+        uint32_t now = isotp_user_get_us();
+
+        /* observe how often the application polls */
+        if (0 != link->receive_timer_poll) {
+            uint32_t gap = now - link->receive_timer_poll;
+            link->receive_poll_us = UINT32_MAX == link->receive_poll_us ? gap : (3 * link->receive_poll_us + gap) / 4;
+        }
+        link->receive_timer_poll = now;
+
         /* check timeout */
         if (IsoTpTimeAfter(isotp_user_get_us(), link->receive_timer_cr)) {
             link->receive_protocol_result = ISOTP_PROTOCOL_RESULT_TIMEOUT_CR;
@@ -14,6 +14,23 @@ extern "C" {
 #include "isotp_config.h"
 #include "isotp_user.h"
 
+struct IsoTpLink;
+
+/**
+ * @brief Flow control frame a receiving link sends after a first frame or a complete block.
+ */
+typedef struct IsoTpFlowControlParams {
+    uint8_t                     flow_status; /* PCI_FLOW_STATUS_CONTINUE, _WAIT or _OVERFLOW */
+    uint8_t                     block_size;  /* BS, 0 to receive the rest without further flow control */
+    uint32_t                    st_min_us;   /* STmin */
+} IsoTpFlowControlParams;
+
+/**
+ * @brief Chooses the flow control of a receiving link. @p fc holds ISO_TP_DEFAULT_BLOCK_SIZE
+ * and ISO_TP_DEFAULT_ST_MIN_US on entry.
+ */
+typedef void (*IsoTpFlowControlFn)(const struct IsoTpLink *link, IsoTpFlowControlParams *fc, void *arg);
+
 /**
  * @brief Struct containing the data for linking an application to a CAN instance.
  * The data stored in this struct is used internally and may be used by software programs
@@ -25,8 +42,11 @@ typedef struct IsoTpLink {
     /* message buffer */
     uint8_t*                    send_buffer;
     uint16_t                    send_buf_size;
+    const uint8_t*              send_data;      /* message being sent: send_buffer, or the
+                                                   caller's payload with isotp_send_in_place() */
     uint16_t                    send_size;
     uint16_t                    send_offset;
+    uint8_t                     send_frame_len; /* TX_DL: 8 for classic CAN, up to 64 for CAN FD */
     /* multi-frame flags */
     uint8_t                     send_sn;
     uint16_t                    send_bs_remain; /* Remaining block size */
@@ -45,6 +65,7 @@ typedef struct IsoTpLink {
     uint16_t                    receive_buf_size;
     uint16_t                    receive_size;
     uint16_t                    receive_offset;
+    uint8_t                     receive_frame_len; /* RX_DL: length of the first frame received */
     /* multi-frame control */
     uint8_t                     receive_sn;
     uint8_t                     receive_bs_count; /* Maximum number of FC.Wait frame transmissions  */
@@ -53,6 +74,19 @@ typedef struct IsoTpLink {
                                                      end at receive FC */
     int                         receive_protocol_result;
     uint8_t                     receive_status;                                                     
+    /* flow control policy */
+    IsoTpFlowControlFn          receive_fc_fn;    /* NULL to always send the defaults */
+    void*                       receive_fc_arg;
+    uint8_t                     receive_fc_bs;    /* BS of the last FC.CTS sent */
+    uint32_t                    receive_fc_st_min_us; /* STmin of the last FC.CTS sent */
+    uint32_t                    receive_fc_wait_count; /* FC.WAIT frames sent */
+    uint8_t                     receive_wft_count; /* FC.WAIT frames sent in a row */
+    uint8_t                     receive_fc_pending; /* FC.WAIT sent, FC.CTS not yet */
+    uint32_t                    receive_timer_wait; /* Time to repeat FC.WAIT */
+    uint8_t                     receive_ff[ISO_TP_MAX_FRAME_LEN]; /* first frame held while the previous message is unread */
+    uint8_t                     receive_ff_len;
+    uint32_t                    receive_timer_poll; /* Last isotp_poll() during a reception */
+    uint32_t                    receive_poll_us;  /* Smoothed interval between isotp_poll() calls during a reception, UINT32_MAX until observed */
 
 #if defined(ISO_TP_USER_SEND_CAN_ARG)
     void*                       user_send_can_arg;
@@ -68,11 +102,59 @@ typedef struct IsoTpLink {
  * @param sendbufsize The size of the buffer area.
  * @param recvbuf A pointer to an area in memory which can be used as a buffer for data to be received.
  * @param recvbufsize The size of the buffer area.
+ *
+ * If recvbuf is sendbuf the link is half duplex: while a message is being sent only flow control
+ * frames are accepted, and sending discards the message being received or not yet read.
  */
 void isotp_init_link(IsoTpLink *link, uint32_t sendid, 
                      uint8_t *sendbuf, uint16_t sendbufsize,
                      uint8_t *recvbuf, uint16_t recvbufsize);
 
+/**
+ * @brief Sets the data length of the CAN frames sent on a link (TX_DL).
+ * The default is 8 (classic CAN). CAN FD links may use 12, 16, 20, 24, 32, 48 or 64, in which case
+ * single frames carry up to TX_DL - 2 bytes and consecutive frames TX_DL - 1 bytes.
+ * Frames of any valid length are received regardless of this setting.
+ *
+ * @param link The @code IsoTpLink @endcode instance used.
+ * @param tx_dl The data length of the frames sent.
+ *
+ * @return ISOTP_RET_OK, or ISOTP_RET_ERROR if tx_dl is not a valid CAN FD data length.
+ */
+int isotp_set_tx_dl(IsoTpLink *link, uint8_t tx_dl);
+
+/**
+ * @brief Returns the largest payload that fits a single frame, and so the largest payload that
+ * can be sent with functional addressing.
+ *
+ * @param link The @code IsoTpLink @endcode instance used.
+ */
+uint16_t isotp_max_single_frame_size(const IsoTpLink *link);
+
+/**
+ * @brief Sets the flow control policy of a link.
+ * The policy is asked for the flow status, BS and STmin each time a flow control frame is due.
+ * When it answers PCI_FLOW_STATUS_WAIT, FC.WAIT is sent and the policy is asked again on each
+ * isotp_poll() until it allows the transfer, or ISO_TP_MAX_WFT_NUMBER waits were sent, in which case
+ * the reception is aborted with FC.OVFLW.
+ * With a policy set, a first frame received while the previous message has not been read with
+ * isotp_receive() is held and answered with FC.WAIT rather than overwriting that message.
+ *
+ * @param link The @code IsoTpLink @endcode instance used.
+ * @param fn The policy, e.g. isotp_flow_control_adaptive, or NULL for the compile time defaults.
+ * @param arg Passed to @p fn.
+ */
+void isotp_set_flow_control(IsoTpLink *link, IsoTpFlowControlFn fn, void *arg);
+
+/**
+ * @brief Built-in flow control policy.
+ * Lets the sender transmit the rest of the message without further flow control (BS=0, STmin=0)
+ * when it fits the ISO_TP_RX_QUEUE_FRAMES frames the driver can queue, or when isotp_poll() is
+ * called often enough to drain that queue at the fastest frame rate. Otherwise BS is limited to
+ * ISO_TP_RX_QUEUE_FRAMES so the queue cannot overrun.
+ */
+void isotp_flow_control_adaptive(const IsoTpLink *link, IsoTpFlowControlParams *fc, void *arg);
+
 /**
  * @brief Polling function; call this function periodically to handle timeouts, send consecutive frames, etc.
  *
@@ -97,7 +179,8 @@ void isotp_on_can_message(IsoTpLink *link, const uint8_t *data, uint8_t len);
  * Multi-frame messages will be sent consecutively when calling isotp_poll.
  *
  * @param link The @code IsoTpLink @endcode instance used for transceiving data.
- * @param payload The payload to be sent. (Up to 4095 bytes).
+ * @param payload The payload to be sent. Up to 4095 bytes are sent with a 12 bit first frame length,
+ * longer payloads with the 32 bit escape sequence.
  * @param size The size of the payload to be sent.
  *
  * @return Possible return values:
@@ -113,6 +196,14 @@ int isotp_send(IsoTpLink *link, const uint8_t payload[], uint16_t size);
  */
 int isotp_send_with_id(IsoTpLink *link, uint32_t id, const uint8_t payload[], uint16_t size);
 
+/**
+ * @brief See @link isotp_send_with_id @endlink, except that the payload is sent from where it is
+ * instead of being copied into the link's send buffer, which may then be NULL.
+ * The payload must stay valid and unchanged while send_status is ISOTP_SEND_STATUS_INPROGRESS.
+ * Single frames are sent immediately and do not keep a reference.
+ */
+int isotp_send_in_place(IsoTpLink *link, uint32_t id, const uint8_t payload[], uint16_t size);
+
 /**
  * @brief Receives and parses the received data and copies the parsed data in to the internal buffer.
  * @param link The @link IsoTpLink @endlink instance used to transceive data.
@@ -126,6 +217,26 @@ int isotp_send_with_id(IsoTpLink *link, uint32_t id, const uint8_t payload[], ui
  */
 int isotp_receive(IsoTpLink *link, uint8_t *payload, const uint16_t payload_size, uint16_t *out_size);
 
+/**
+ * @brief Gives access to the received message in place instead of copying it.
+ * The message stays valid until isotp_receive_release(). Meanwhile single frames are dropped and a
+ * first frame is held and answered with FC.WAIT, as with a flow control policy.
+ * @param link The @link IsoTpLink @endlink instance used to transceive data.
+ * @param payload Set to the message in the link's receive buffer.
+ * @param out_size A reference to a variable which will contain the size of the message.
+ *
+ * @return Possible return values:
+ *      - @link ISOTP_RET_OK @endlink
+ *      - @link ISOTP_RET_NO_DATA @endlink
+ */
+int isotp_receive_peek(IsoTpLink *link, const uint8_t **payload, uint16_t *out_size);
+
+/**
+ * @brief Releases the message returned by isotp_receive_peek(), so that the link can receive again.
+ * @param link The @link IsoTpLink @endlink instance used to transceive data.
+ */
+void isotp_receive_release(IsoTpLink *link);
+
 #ifdef __cplusplus
 }
 #endif
@@ -22,6 +22,19 @@
 #define ISO_TP_MAX_WFT_NUMBER       1
 #endif
 
+/* Frames the CAN driver can queue between two calls of isotp_poll(). Used by
+ * isotp_flow_control_adaptive() as the block size when the application polls slowly.
+ */
+#ifndef ISO_TP_RX_QUEUE_FRAMES
+#define ISO_TP_RX_QUEUE_FRAMES      ISO_TP_DEFAULT_BLOCK_SIZE
+#endif
+
+/* Shortest time between two consecutive frames a sender may achieve on the bus.
+ */
+#ifndef ISO_TP_MIN_FRAME_TIME_US
+#define ISO_TP_MIN_FRAME_TIME_US    100
+#endif
+
 /* Private: The default timeout to use when waiting for a response during a
  * multi-frame send or receive.
  */
@@ -50,6 +50,15 @@
 /*  invalid bs */
 #define ISOTP_INVALID_BS       0xFFFF
 
+/* CAN frame data length (TX_DL / RX_DL). 8 for classic CAN, up to 64 for CAN FD */
+#define ISO_TP_CAN_DL          8
+#define ISO_TP_CANFD_MAX_DL    64
+#define ISO_TP_MAX_FRAME_LEN   ISO_TP_CANFD_MAX_DL
+
+/* largest FF_DL that fits the 12 bit length of a first frame. Longer messages use the escape
+ * sequence: a 12 bit FF_DL of 0 followed by a 32 bit FF_DL */
+#define ISO_TP_FF_DL_12BIT_MAX 4095
+
 /* ISOTP sender status */
 typedef enum {
     ISOTP_SEND_STATUS_IDLE,
@@ -62,6 +71,7 @@ typedef enum {
     ISOTP_RECEIVE_STATUS_IDLE,
     ISOTP_RECEIVE_STATUS_INPROGRESS,
     ISOTP_RECEIVE_STATUS_FULL,
+    ISOTP_RECEIVE_STATUS_HELD, /* lent out by isotp_receive_peek() until isotp_receive_release() */
 } IsoTpReceiveStatusTypes;
 
 /* can fram defination */
@@ -176,8 +186,10 @@ typedef struct {
 
 #endif
 
+/* the frame views above describe the protocol control information of a classic CAN frame, CAN FD
+ * frames are accessed through the data array */
 typedef struct {
-    uint8_t ptr[8];
+    uint8_t ptr[ISO_TP_MAX_FRAME_LEN];
 } IsoTpDataArray;
 
 typedef struct {
@@ -1,3 +1,21 @@
+#if defined(UDS_TP_ISOTP_C) || defined(UDS_TP_ISOTP_C_SOCKETCAN)
+
+#include "tp/isotp_c.h"
+#include "tp/isotp-c/isotp.h"
+
+int UDSISOTpCLinkSend(IsoTpLink *link, const uint8_t *buf, size_t len) {
+#if UDS_TP_SEND_IN_PLACE
+    if (len > UDS_TP_MTU) {
+        return ISOTP_RET_OVERFLOW;
+    }
+    return isotp_send_in_place(link, link->send_arbitration_id, buf, (uint16_t)len);
+#else
+    return isotp_send(link, buf, len);
+#endif
+}
+
+#endif
+
 #if defined(UDS_TP_ISOTP_C)
 
 #include "util.h"
@@ -28,8 +46,9 @@ static ssize_t tp_send(UDSTp_t *hdl, uint8_t *buf, size_t len, UDSSDU_t *info) {
         break;
     case UDS_A_TA_TYPE_FUNCTIONAL:
         link = &tp->func_link;
-        if (len > 7) {
-            UDS_LOGI(__FILE__, "Cannot send more than 7 bytes via functional addressing\n");
+        if (len > isotp_max_single_frame_size(link)) {
+            UDS_LOGI(__FILE__, "Cannot send more than %u bytes via functional addressing\n",
+                     isotp_max_single_frame_size(link));
             ret = -3;
             goto done;
         }
@@ -39,7 +58,7 @@ static ssize_t tp_send(UDSTp_t *hdl, uint8_t *buf, size_t len, UDSSDU_t *info) {
         goto done;
     }
 
-    int send_status = isotp_send(link, buf, len);
+    int send_status = UDSISOTpCLinkSend(link, buf, len);
     switch (send_status) {
     case ISOTP_RET_OK:
         ret = len;
@@ -88,6 +107,59 @@ static ssize_t tp_recv(UDSTp_t *hdl, uint8_t *buf, size_t bufsize, UDSSDU_t *inf
     return out_size;
 }
 
+#if !UDS_TP_HALF_DUPLEX
+static ssize_t tp_peek(UDSTp_t *hdl, const uint8_t **buf, UDSSDU_t *info) {
+    UDS_ASSERT(hdl);
+    UDS_ASSERT(buf);
+    uint16_t out_size = 0;
+    UDSISOTpC_t *tp = (UDSISOTpC_t *)hdl;
+
+    if (ISOTP_RET_OK == isotp_receive_peek(&tp->phys_link, buf, &out_size)) {
+        if (NULL != info) {
+            info->A_TA = tp->phys_sa;
+            info->A_SA = tp->phys_ta;
+            info->A_TA_Type = UDS_A_TA_TYPE_PHYSICAL;
+        }
+    } else if (ISOTP_RET_OK == isotp_receive_peek(&tp->func_link, buf, &out_size)) {
+        if (NULL != info) {
+            info->A_TA = tp->func_sa;
+            info->A_SA = tp->func_ta;
+            info->A_TA_Type = UDS_A_TA_TYPE_FUNCTIONAL;
+        }
+    }
+    return out_size;
+}
+
+static void tp_ack(UDSTp_t *hdl) {
+    UDS_ASSERT(hdl);
+    UDSISOTpC_t *tp = (UDSISOTpC_t *)hdl;
+    isotp_receive_release(&tp->phys_link);
+    isotp_receive_release(&tp->func_link);
+}
+#endif
+
+void UDSISOTpCOnFrame(UDSISOTpC_t *tp, uint32_t id, const uint8_t *data, uint8_t len) {
+    UDS_ASSERT(tp);
+    if (id == tp->phys_sa) {
+        isotp_on_can_message(&tp->phys_link, data, len);
+    } else if (id == tp->func_sa) {
+        if (ISOTP_RECEIVE_STATUS_IDLE != tp->phys_link.receive_status) {
+            UDS_LOGI(__FILE__, "func frame received but cannot process because link is not idle");
+            return;
+        }
+        isotp_on_can_message(&tp->func_link, data, len);
+    }
+}
+
+static void tp_on_ring_frame(void *ctx, const UDSCANFrame_t *frame) {
+    UDSISOTpCOnFrame((UDSISOTpC_t *)ctx, frame->id, frame->data, frame->len);
+}
+
+size_t UDSISOTpCDrainRing(UDSISOTpC_t *tp, UDSCANRing_t *ring) {
+    UDS_ASSERT(tp);
+    return UDSCANRingDrain(ring, tp_on_ring_frame, tp, 0);
+}
+
 UDSErr_t UDSISOTpCInit(UDSISOTpC_t *tp, const UDSISOTpCConfig_t *cfg) {
     if (cfg == NULL || tp == NULL) {
         return UDS_ERR_INVALID_ARG;
@@ -95,15 +167,37 @@ UDSErr_t UDSISOTpCInit(UDSISOTpC_t *tp, const UDSISOTpCConfig_t *cfg) {
     tp->hdl.poll = tp_poll;
     tp->hdl.send = tp_send;
     tp->hdl.recv = tp_recv;
+#if UDS_TP_HALF_DUPLEX
+    tp->hdl.peek = NULL;
+    tp->hdl.ack = NULL;
+#else
+    tp->hdl.peek = tp_peek;
+    tp->hdl.ack = tp_ack;
+#endif
     tp->phys_sa = cfg->source_addr;
     tp->phys_ta = cfg->target_addr;
     tp->func_sa = cfg->source_addr_func;
     tp->func_ta = cfg->target_addr_func;
 
+#if UDS_TP_HALF_DUPLEX && UDS_TP_SEND_IN_PLACE
+    isotp_init_link(&tp->phys_link, tp->phys_ta, NULL, 0, tp->phys_buf, sizeof(tp->phys_buf));
+#elif UDS_TP_HALF_DUPLEX
+    isotp_init_link(&tp->phys_link, tp->phys_ta, tp->phys_buf, sizeof(tp->phys_buf), tp->phys_buf,
+                    sizeof(tp->phys_buf));
+#elif UDS_TP_SEND_IN_PLACE
+    isotp_init_link(&tp->phys_link, tp->phys_ta, NULL, 0, tp->recv_buf, sizeof(tp->recv_buf));
+#else
     isotp_init_link(&tp->phys_link, tp->phys_ta, tp->send_buf, sizeof(tp->send_buf), tp->recv_buf,
                     sizeof(tp->recv_buf));
-    isotp_init_link(&tp->func_link, tp->func_ta, tp->recv_buf, sizeof(tp->send_buf), tp->recv_buf,
-                    sizeof(tp->recv_buf));
+#endif
+    isotp_init_link(&tp->func_link, tp->func_ta, tp->func_buf, sizeof(tp->func_buf), tp->func_buf,
+                    sizeof(tp->func_buf));
+    if (cfg->tx_dl) {
+        if (ISOTP_RET_OK != isotp_set_tx_dl(&tp->phys_link, cfg->tx_dl) ||
+            ISOTP_RET_OK != isotp_set_tx_dl(&tp->func_link, cfg->tx_dl)) {
+            return UDS_ERR_INVALID_ARG;
+        }
+    }
     return UDS_OK;
 }
 
@@ -1,4 +1,19 @@
 #pragma once
+#if defined(UDS_TP_ISOTP_C) || defined(UDS_TP_ISOTP_C_SOCKETCAN)
+
+#include "sys.h"
+#include "config.h"
+#include "tp/isotp-c/isotp.h"
+
+/**
+ * @brief Start sending `buf` on `link`. With UDS_TP_SEND_IN_PLACE the link reads `buf` until
+ * UDSTpPoll() no longer reports UDS_TP_SEND_IN_PROGRESS.
+ * @return an ISOTP_RET_* code
+ */
+int UDSISOTpCLinkSend(IsoTpLink *link, const uint8_t *buf, size_t len);
+
+#endif
+
 #if defined(UDS_TP_ISOTP_C)
 
 #include "sys.h"
@@ -6,13 +21,21 @@
 #include "uds.h"
 #include "tp.h"
 #include "tp/isotp-c/isotp.h"
+#include "tp/can_ring.h"
 
 typedef struct {
     UDSTp_t hdl;
     IsoTpLink phys_link;
     IsoTpLink func_link;
-    uint8_t send_buf[UDS_ISOTP_MTU];
-    uint8_t recv_buf[UDS_ISOTP_MTU];
+#if UDS_TP_HALF_DUPLEX
+    uint8_t phys_buf[UDS_TP_MTU]; /**< phys_link receives here, and sends unless in place */
+#else
+#if !UDS_TP_SEND_IN_PLACE
+    uint8_t send_buf[UDS_TP_MTU];
+#endif
+    uint8_t recv_buf[UDS_TP_MTU];
+#endif
+    uint8_t func_buf[ISO_TP_MAX_FRAME_LEN]; /**< func_link carries single frames only */
     uint32_t phys_sa, phys_ta;
     uint32_t func_sa, func_ta;
 } UDSISOTpC_t;
@@ -22,10 +45,24 @@ typedef struct {
     uint32_t target_addr;
     uint32_t source_addr_func;
     uint32_t target_addr_func;
+    uint8_t tx_dl; /**< CAN FD data length of the frames sent (up to 64). 0 for classic CAN */
 } UDSISOTpCConfig_t;
 
 UDSErr_t UDSISOTpCInit(UDSISOTpC_t *tp, const UDSISOTpCConfig_t *cfg);
 
 void UDSISOTpCDeinit(UDSISOTpC_t *tp);
 
+/**
+ * @brief Pass a received CAN frame to the physical or functional link it is addressed to
+ * @details Frames with other IDs are ignored. A functional frame is dropped while a physical
+ * message is being received or has not been handled yet.
+ */
+void UDSISOTpCOnFrame(UDSISOTpC_t *tp, uint32_t id, const uint8_t *data, uint8_t len);
+
+/**
+ * @brief Pass every frame pending in `ring` to UDSISOTpCOnFrame()
+ * @return number of frames drained
+ */
+size_t UDSISOTpCDrainRing(UDSISOTpC_t *tp, UDSCANRing_t *ring);
+
 #endif
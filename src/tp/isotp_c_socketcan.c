@@ -1,6 +1,7 @@
 #if defined(UDS_TP_ISOTP_C_SOCKETCAN)
 
 #include "tp/isotp_c_socketcan.h"
+#include "tp/isotp_c.h"
 #include "iso14229.h"
 #include "tp/isotp-c/isotp_defines.h"
 #include <linux/can.h>
@@ -10,6 +11,8 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <errno.h>
 #include <stdarg.h>
@@ -43,7 +46,35 @@ done:
     return sockfd;
 }
 
-uint32_t isotp_user_get_us(void) { return UDSMillis() * 1000; }
+/* match exactly one standard or extended data frame ID */
+static struct can_filter SocketCANFilter(uint32_t id) {
+    struct can_filter filter;
+    filter.can_id = id;
+    filter.can_mask = CAN_EFF_FLAG | CAN_RTR_FLAG | ((id & CAN_EFF_FLAG) ? CAN_EFF_MASK : CAN_SFF_MASK);
+    return filter;
+}
+
+/* queue only the frames addressed to this link, so that many links can share one interface */
+static void SetupFilters(int sockfd, uint32_t phys_sa, uint32_t func_sa) {
+    struct can_filter filters[2];
+    int n = 0;
+    const uint32_t ids[] = {phys_sa, func_sa};
+    if (sockfd < 0) {
+        return;
+    }
+    for (int i = 0; i < 2; i++) {
+        if (UDS_TP_NOOP_ADDR == ids[i]) {
+            continue;
+        }
+        filters[n++] = SocketCANFilter(ids[i]);
+    }
+    if (n > 0 && setsockopt(sockfd, SOL_CAN_RAW, CAN_RAW_FILTER, filters,
+                            (socklen_t)(n * sizeof(filters[0]))) < 0) {
+        perror("setsockopt");
+    }
+}
+
+uint32_t isotp_user_get_us(void) { return UDSMicros(); }
 
 __attribute__((format(printf, 1, 2))) void isotp_user_debug(const char *message, ...) {
     va_list args;
@@ -55,59 +86,236 @@ __attribute__((format(printf, 1, 2))) void isotp_user_debug(const char *message,
 #ifndef ISO_TP_USER_SEND_CAN_ARG
 #error "ISO_TP_USER_SEND_CAN_ARG must be defined"
 #endif
+/* write the queued frames with as few sendmmsg() calls as the socket allows. Frames the socket
+ * cannot take yet stay queued for the next poll. Returns -1 if they could not be written at all */
+static int SocketCANFlush(UDSTpISOTpC_t *tp) {
+    struct mmsghdr msgs[UDS_ISOTP_C_SOCKETCAN_BATCH];
+    struct iovec iov[UDS_ISOTP_C_SOCKETCAN_BATCH];
+    // a classic frame is the first CAN_MTU bytes of a canfd_frame
+    const size_t mtu = tp->canfd ? CANFD_MTU : CAN_MTU;
+    unsigned sent = 0;
+
+    for (unsigned i = 0; i < tp->tx_count; i++) {
+        iov[i].iov_base = &tp->tx_frames[i];
+        iov[i].iov_len = mtu;
+        memset(&msgs[i], 0, sizeof(msgs[i]));
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    while (sent < tp->tx_count) {
+        int n = sendmmsg(tp->fd, &msgs[sent], tp->tx_count - sent, 0);
+        if (n < 0) {
+            if (EAGAIN == errno || EWOULDBLOCK == errno || ENOBUFS == errno) {
+                break;
+            }
+            perror("sendmmsg");
+            tp->tx_count = 0;
+            return -1;
+        }
+        sent += (unsigned)n;
+    }
+    memmove(tp->tx_frames, &tp->tx_frames[sent], (tp->tx_count - sent) * sizeof(tp->tx_frames[0]));
+    tp->tx_count -= sent;
+    return 0;
+}
+
+/* queues the frame. Queued frames are written by SocketCANFlush() */
 int isotp_user_send_can(const uint32_t arbitration_id, const uint8_t *data, const uint8_t size,
                         void *user_data) {
     (void)fflush(stdout);
     UDS_ASSERT(user_data);
-    int sockfd = *(int *)user_data;
-    struct can_frame frame = {0};
-    frame.can_id = arbitration_id;
-    frame.can_dlc = size;
-    memmove(frame.data, data, size);
-    if (write(sockfd, &frame, sizeof(struct can_frame)) != sizeof(struct can_frame)) {
-        perror("Write err");
+    UDSTpISOTpC_t *tp = (UDSTpISOTpC_t *)user_data;
+    if (size > (tp->canfd ? CANFD_MAX_DLEN : CAN_MAX_DLEN)) {
         return ISOTP_RET_ERROR;
     }
+    if (tp->tx_count >= UDS_ISOTP_C_SOCKETCAN_BATCH) {
+        if (SocketCANFlush(tp) < 0) {
+            return ISOTP_RET_ERROR;
+        }
+        if (tp->tx_count >= UDS_ISOTP_C_SOCKETCAN_BATCH) {
+            return ISOTP_RET_NOSPACE;
+        }
+    }
+    struct canfd_frame *frame = &tp->tx_frames[tp->tx_count++];
+    memset(frame, 0, sizeof(*frame));
+    frame->can_id = arbitration_id;
+    frame->len = size;
+    if (tp->canfd) {
+        frame->flags = CANFD_BRS;
+    }
+    memmove(frame->data, data, size);
     return ISOTP_RET_OK;
 }
 
-static void SocketCANRecv(UDSTpISOTpC_t *tp) {
-    UDS_ASSERT(tp);
-    struct can_frame frame = {0};
-    int nbytes = 0;
+static void SocketCANDispatch(void *ctx, const struct canfd_frame *frame) {
+    UDSTpISOTpC_t *tp = (UDSTpISOTpC_t *)ctx;
+    // the CAN_RAW_FILTER installed by SetupFilters() already drops other IDs in the kernel
+    if (frame->can_id == tp->phys_sa) {
+        isotp_on_can_message(&tp->phys_link, frame->data, frame->len);
+    } else if (frame->can_id == tp->func_sa) {
+        if (ISOTP_RECEIVE_STATUS_IDLE != tp->phys_link.receive_status) {
+            UDS_LOGI(__FILE__, "func frame received but cannot process because link is not idle");
+            return;
+        }
+        // TODO: reject if it's longer than a single frame
+        isotp_on_can_message(&tp->func_link, frame->data, frame->len);
+    }
+}
+
+/* read every pending frame in batches and pass each one to dispatch */
+static void SocketCANDrain(int fd, void (*dispatch)(void *ctx, const struct canfd_frame *frame),
+                           void *ctx) {
+    // CAN_MTU bytes are read for classic frames, CANFD_MTU for CAN FD frames
+    struct canfd_frame frames[UDS_ISOTP_C_SOCKETCAN_BATCH];
+    struct mmsghdr msgs[UDS_ISOTP_C_SOCKETCAN_BATCH];
+    struct iovec iov[UDS_ISOTP_C_SOCKETCAN_BATCH];
+
+    memset(msgs, 0, sizeof(msgs));
+    for (unsigned i = 0; i < UDS_ISOTP_C_SOCKETCAN_BATCH; i++) {
+        iov[i].iov_base = &frames[i];
+        iov[i].iov_len = sizeof(frames[i]);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
 
     for (;;) {
-        nbytes = read(tp->fd, &frame, sizeof(struct can_frame));
-        if (nbytes < 0) {
-            if (EAGAIN == errno || EWOULDBLOCK == errno) {
-                break;
-            } else {
-                perror("read");
+        int n = recvmmsg(fd, msgs, UDS_ISOTP_C_SOCKETCAN_BATCH, MSG_DONTWAIT, NULL);
+        if (n < 0) {
+            if (EAGAIN != errno && EWOULDBLOCK != errno) {
+                perror("recvmmsg");
             }
-        } else if (nbytes == 0) {
             break;
-        } else {
-            if (frame.can_id == tp->phys_sa) {
-                isotp_on_can_message(&tp->phys_link, frame.data, frame.can_dlc);
-            } else if (frame.can_id == tp->func_sa) {
-                if (ISOTP_RECEIVE_STATUS_IDLE != tp->phys_link.receive_status) {
-                    UDS_LOGI(__FILE__,
-                             "func frame received but cannot process because link is not idle");
-                    return;
+        }
+        for (int i = 0; i < n; i++) {
+            if (msgs[i].msg_len >= CAN_MTU) {
+                dispatch(ctx, &frames[i]);
+            }
+        }
+        if (n < UDS_ISOTP_C_SOCKETCAN_BATCH) {
+            break;
+        }
+    }
+}
+
+static size_t EndpointHash(uint32_t id) {
+    id ^= id >> 16;
+    id *= 0x45d9f3bU;
+    id ^= id >> 16;
+    return id & (UDS_ISOTP_C_ENDPOINT_ROUTES - 1);
+}
+
+static void EndpointDispatch(void *ctx, const struct canfd_frame *frame) {
+    UDSISOTpCEndpoint_t *ep = (UDSISOTpCEndpoint_t *)ctx;
+    size_t slot = EndpointHash(frame->can_id);
+    // several transports may share a functional ID, so every match is dispatched
+    for (size_t i = 0; i < UDS_ISOTP_C_ENDPOINT_ROUTES; i++) {
+        const UDSISOTpCRoute_t *route = &ep->routes[slot];
+        if (NULL == route->tp && !route->deleted) {
+            break;
+        }
+        if (NULL != route->tp && route->id == frame->can_id) {
+            SocketCANDispatch(route->tp, frame);
+        }
+        slot = (slot + 1) & (UDS_ISOTP_C_ENDPOINT_ROUTES - 1);
+    }
+}
+
+static bool EndpointHasID(const UDSISOTpCEndpoint_t *ep, uint32_t id) {
+    size_t slot = EndpointHash(id);
+    for (size_t i = 0; i < UDS_ISOTP_C_ENDPOINT_ROUTES; i++) {
+        const UDSISOTpCRoute_t *route = &ep->routes[slot];
+        if (NULL == route->tp && !route->deleted) {
+            break;
+        }
+        if (NULL != route->tp && route->id == id) {
+            return true;
+        }
+        slot = (slot + 1) & (UDS_ISOTP_C_ENDPOINT_ROUTES - 1);
+    }
+    return false;
+}
+
+static void EndpointApplyFilters(const UDSISOTpCEndpoint_t *ep) {
+    struct can_filter all = {.can_id = 0, .can_mask = 0};
+    const void *filters = ep->filters;
+    size_t n = ep->filter_count;
+    if (n > CAN_RAW_FILTER_MAX) {
+        // too many IDs for the kernel, receive everything and let the hash table drop the rest
+        filters = &all;
+        n = 1;
+    }
+    if (setsockopt(ep->fd, SOL_CAN_RAW, CAN_RAW_FILTER, n ? filters : NULL,
+                   (socklen_t)(n * sizeof(struct can_filter))) < 0) {
+        perror("setsockopt");
+    }
+}
+
+static UDSErr_t EndpointAddRoute(UDSISOTpCEndpoint_t *ep, uint32_t id, UDSTpISOTpC_t *tp) {
+    if (ep->route_count >= UDS_ISOTP_C_ENDPOINT_ROUTES / 2) {
+        UDS_LOGE(__FILE__, "endpoint full, raise UDS_ISOTP_C_ENDPOINT_ROUTES");
+        return UDS_FAIL;
+    }
+    if (!EndpointHasID(ep, id)) {
+        ep->filters[ep->filter_count++] = SocketCANFilter(id);
+        EndpointApplyFilters(ep);
+    }
+    size_t slot = EndpointHash(id);
+    while (NULL != ep->routes[slot].tp) {
+        slot = (slot + 1) & (UDS_ISOTP_C_ENDPOINT_ROUTES - 1);
+    }
+    ep->routes[slot] = (UDSISOTpCRoute_t){.id = id, .tp = tp, .deleted = false};
+    ep->route_count++;
+    return UDS_OK;
+}
+
+static void EndpointRemoveRoutes(UDSISOTpCEndpoint_t *ep, const UDSTpISOTpC_t *tp) {
+    for (size_t i = 0; i < UDS_ISOTP_C_ENDPOINT_ROUTES; i++) {
+        UDSISOTpCRoute_t *route = &ep->routes[i];
+        if (route->tp != tp) {
+            continue;
+        }
+        route->tp = NULL;
+        route->deleted = true;
+        ep->route_count--;
+        if (!EndpointHasID(ep, route->id)) {
+            for (size_t j = 0; j < ep->filter_count; j++) {
+                if (ep->filters[j].can_id == route->id) {
+                    ep->filters[j] = ep->filters[--ep->filter_count];
+                    break;
                 }
-                // TODO: reject if it's longer than a single frame
-                isotp_on_can_message(&tp->func_link, frame.data, frame.can_dlc);
             }
+            EndpointApplyFilters(ep);
         }
     }
 }
 
-static UDSTpStatus_t isotp_c_socketcan_tp_poll(UDSTp_t *hdl) {
-    UDS_ASSERT(hdl);
+static void SocketCANRecv(UDSTpISOTpC_t *tp) {
+    UDS_ASSERT(tp);
+    if (tp->ep) {
+        SocketCANDrain(tp->ep->fd, EndpointDispatch, tp->ep);
+    } else {
+        SocketCANDrain(tp->fd, SocketCANDispatch, tp);
+    }
+}
+
+/* send what the link has ready and report its state */
+static UDSTpStatus_t SocketCANPollLink(UDSTpISOTpC_t *impl) {
     UDSTpStatus_t status = 0;
-    UDSTpISOTpC_t *impl = (UDSTpISOTpC_t *)hdl;
-    SocketCANRecv(impl);
-    isotp_poll(&impl->phys_link);
+
+    // isotp_poll() sends at most one consecutive frame. Without STmin, queue as many as flow
+    // control allows and write them together.
+    do {
+        const uint16_t offset = impl->phys_link.send_offset;
+        isotp_poll(&impl->phys_link);
+        if (offset == impl->phys_link.send_offset || 0 != impl->phys_link.send_st_min_us) {
+            break;
+        }
+    } while (ISOTP_SEND_STATUS_INPROGRESS == impl->phys_link.send_status &&
+             impl->tx_count < UDS_ISOTP_C_SOCKETCAN_BATCH);
+
+    if (SocketCANFlush(impl) < 0 && ISOTP_SEND_STATUS_INPROGRESS == impl->phys_link.send_status) {
+        impl->phys_link.send_status = ISOTP_SEND_STATUS_ERROR;
+    }
     if (impl->phys_link.send_status == ISOTP_SEND_STATUS_INPROGRESS) {
         status |= UDS_TP_SEND_IN_PROGRESS;
     }
@@ -117,6 +325,13 @@ static UDSTpStatus_t isotp_c_socketcan_tp_poll(UDSTp_t *hdl) {
     return status;
 }
 
+static UDSTpStatus_t isotp_c_socketcan_tp_poll(UDSTp_t *hdl) {
+    UDS_ASSERT(hdl);
+    UDSTpISOTpC_t *impl = (UDSTpISOTpC_t *)hdl;
+    SocketCANRecv(impl);
+    return SocketCANPollLink(impl);
+}
+
 static ssize_t isotp_c_socketcan_tp_send(UDSTp_t *hdl, uint8_t *buf, size_t len, UDSSDU_t *info) {
     UDS_ASSERT(hdl);
     ssize_t ret = -1;
@@ -130,8 +345,9 @@ static ssize_t isotp_c_socketcan_tp_send(UDSTp_t *hdl, uint8_t *buf, size_t len,
         break;
     case UDS_A_TA_TYPE_FUNCTIONAL:
         link = &tp->func_link;
-        if (len > 7) {
-            UDS_LOGI(__FILE__, "Cannot send more than 7 bytes via functional addressing");
+        if (len > isotp_max_single_frame_size(link)) {
+            UDS_LOGI(__FILE__, "Cannot send more than %u bytes via functional addressing",
+                     isotp_max_single_frame_size(link));
             ret = -3;
             goto done;
         }
@@ -141,7 +357,12 @@ static ssize_t isotp_c_socketcan_tp_send(UDSTp_t *hdl, uint8_t *buf, size_t len,
         goto done;
     }
 
-    int send_status = isotp_send(link, buf, len);
+    int send_status = UDSISOTpCLinkSend(link, buf, len);
+    // the single or first frame is written now rather than on the next poll
+    if (ISOTP_RET_OK == send_status && SocketCANFlush(tp) < 0) {
+        link->send_status = ISOTP_SEND_STATUS_IDLE;
+        send_status = ISOTP_RET_ERROR;
+    }
     switch (send_status) {
     case ISOTP_RET_OK:
         ret = len;
@@ -194,6 +415,64 @@ static ssize_t isotp_c_socketcan_tp_recv(UDSTp_t *hdl, uint8_t *buf, size_t bufs
     return out_size;
 }
 
+#if !UDS_TP_HALF_DUPLEX
+static ssize_t isotp_c_socketcan_tp_peek(UDSTp_t *hdl, const uint8_t **buf, UDSSDU_t *info) {
+    UDS_ASSERT(hdl);
+    UDS_ASSERT(buf);
+    uint16_t out_size = 0;
+    UDSTpISOTpC_t *tp = (UDSTpISOTpC_t *)hdl;
+
+    if (ISOTP_RET_OK == isotp_receive_peek(&tp->phys_link, buf, &out_size)) {
+        if (NULL != info) {
+            info->A_TA = tp->phys_sa;
+            info->A_SA = tp->phys_ta;
+            info->A_TA_Type = UDS_A_TA_TYPE_PHYSICAL;
+        }
+    } else if (ISOTP_RET_OK == isotp_receive_peek(&tp->func_link, buf, &out_size)) {
+        if (NULL != info) {
+            info->A_TA = tp->func_sa;
+            info->A_SA = tp->func_ta;
+            info->A_TA_Type = UDS_A_TA_TYPE_FUNCTIONAL;
+        }
+    }
+    return out_size;
+}
+
+static void isotp_c_socketcan_tp_ack(UDSTp_t *hdl) {
+    UDS_ASSERT(hdl);
+    UDSTpISOTpC_t *tp = (UDSTpISOTpC_t *)hdl;
+    isotp_receive_release(&tp->phys_link);
+    isotp_receive_release(&tp->func_link);
+}
+#endif
+
+/**
+ * @brief Set up the links and the receive entry points that depend on UDS_TP_HALF_DUPLEX
+ */
+static void InitLinks(UDSTpISOTpC_t *tp, uint32_t target_addr, uint32_t target_addr_func) {
+#if UDS_TP_HALF_DUPLEX
+    tp->hdl.peek = NULL;
+    tp->hdl.ack = NULL;
+#if UDS_TP_SEND_IN_PLACE
+    isotp_init_link(&tp->phys_link, target_addr, NULL, 0, tp->phys_buf, sizeof(tp->phys_buf));
+#else
+    isotp_init_link(&tp->phys_link, target_addr, tp->phys_buf, sizeof(tp->phys_buf), tp->phys_buf,
+                    sizeof(tp->phys_buf));
+#endif
+#else
+    tp->hdl.peek = isotp_c_socketcan_tp_peek;
+    tp->hdl.ack = isotp_c_socketcan_tp_ack;
+#if UDS_TP_SEND_IN_PLACE
+    isotp_init_link(&tp->phys_link, target_addr, NULL, 0, tp->recv_buf, sizeof(tp->recv_buf));
+#else
+    isotp_init_link(&tp->phys_link, target_addr, tp->send_buf, sizeof(tp->send_buf), tp->recv_buf,
+                    sizeof(tp->recv_buf));
+#endif
+#endif
+    isotp_init_link(&tp->func_link, target_addr_func, tp->func_buf, sizeof(tp->func_buf),
+                    tp->func_buf, sizeof(tp->func_buf));
+}
+
 UDSErr_t UDSTpISOTpCInit(UDSTpISOTpC_t *tp, const char *ifname, uint32_t source_addr,
                          uint32_t target_addr, uint32_t source_addr_func,
                          uint32_t target_addr_func) {
@@ -207,22 +486,148 @@ UDSErr_t UDSTpISOTpCInit(UDSTpISOTpC_t *tp, const char *ifname, uint32_t source_
     tp->func_sa = source_addr_func;
     tp->func_ta = target_addr;
     tp->fd = SetupSocketCAN(ifname);
+    SetupFilters(tp->fd, source_addr, source_addr_func);
 
-    isotp_init_link(&tp->phys_link, target_addr, tp->send_buf, sizeof(tp->send_buf), tp->recv_buf,
-                    sizeof(tp->recv_buf));
-    isotp_init_link(&tp->func_link, target_addr_func, tp->recv_buf, sizeof(tp->send_buf),
-                    tp->recv_buf, sizeof(tp->recv_buf));
+    InitLinks(tp, target_addr, target_addr_func);
+
+    tp->canfd = false;
+    tp->tx_count = 0;
+    tp->ep = NULL;
+    tp->ep_next = NULL;
+    tp->phys_link.user_send_can_arg = tp;
+    tp->func_link.user_send_can_arg = tp;
 
-    tp->phys_link.user_send_can_arg = &(tp->fd);
-    tp->func_link.user_send_can_arg = &(tp->fd);
+    return UDS_OK;
+}
 
+UDSErr_t UDSTpISOTpCInitFD(UDSTpISOTpC_t *tp, const char *ifname, uint32_t source_addr,
+                           uint32_t target_addr, uint32_t source_addr_func,
+                           uint32_t target_addr_func, uint8_t tx_dl) {
+    UDSErr_t err = UDSTpISOTpCInit(tp, ifname, source_addr, target_addr, source_addr_func,
+                                   target_addr_func);
+    if (UDS_OK != err) {
+        return err;
+    }
+    if (ISOTP_RET_OK != isotp_set_tx_dl(&tp->phys_link, tx_dl) ||
+        ISOTP_RET_OK != isotp_set_tx_dl(&tp->func_link, tx_dl)) {
+        UDS_LOGE(__FILE__, "invalid CAN FD data length %u", tx_dl);
+        UDSTpISOTpCDeinit(tp);
+        return UDS_ERR_INVALID_ARG;
+    }
+    const int enable = 1;
+    if (setsockopt(tp->fd, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &enable, sizeof(enable)) < 0) {
+        perror("setsockopt CAN_RAW_FD_FRAMES");
+        UDSTpISOTpCDeinit(tp);
+        return UDS_FAIL;
+    }
+    tp->canfd = true;
     return UDS_OK;
 }
 
 void UDSTpISOTpCDeinit(UDSTpISOTpC_t *tp) {
     UDS_ASSERT(tp);
-    close(tp->fd);
+    if (tp->ep) {
+        UDSTpISOTpC_t **p = &tp->ep->head;
+        while (*p && *p != tp) {
+            p = &(*p)->ep_next;
+        }
+        if (*p) {
+            *p = tp->ep_next;
+        }
+        EndpointRemoveRoutes(tp->ep, tp);
+        tp->ep = NULL;
+    } else {
+        close(tp->fd);
+    }
     tp->fd = -1;
 }
 
+UDSErr_t UDSISOTpCEndpointInit(UDSISOTpCEndpoint_t *ep, const char *ifname, bool canfd) {
+    UDS_ASSERT(ep);
+    UDS_ASSERT(ifname);
+    memset(ep, 0, sizeof(*ep));
+    ep->fd = SetupSocketCAN(ifname);
+    if (ep->fd < 0) {
+        return UDS_FAIL;
+    }
+    if (canfd) {
+        const int enable = 1;
+        if (setsockopt(ep->fd, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &enable, sizeof(enable)) < 0) {
+            perror("setsockopt CAN_RAW_FD_FRAMES");
+            UDSISOTpCEndpointDeinit(ep);
+            return UDS_FAIL;
+        }
+    }
+    ep->canfd = canfd;
+    // nothing is attached yet, so nothing is received
+    EndpointApplyFilters(ep);
+    return UDS_OK;
+}
+
+UDSErr_t UDSTpISOTpCInitOnEndpoint(UDSTpISOTpC_t *tp, UDSISOTpCEndpoint_t *ep,
+                                   uint32_t source_addr, uint32_t target_addr,
+                                   uint32_t source_addr_func, uint32_t target_addr_func,
+                                   uint8_t tx_dl) {
+    UDS_ASSERT(tp);
+    UDS_ASSERT(ep);
+    if (tx_dl > ISO_TP_CAN_DL && !ep->canfd) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    if (EndpointHasID(ep, source_addr)) {
+        UDS_LOGE(__FILE__, "0x%03x is already received by another transport", source_addr);
+        return UDS_FAIL;
+    }
+    memset(tp, 0, sizeof(*tp));
+    tp->hdl.poll = isotp_c_socketcan_tp_poll;
+    tp->hdl.send = isotp_c_socketcan_tp_send;
+    tp->hdl.recv = isotp_c_socketcan_tp_recv;
+    tp->phys_sa = source_addr;
+    tp->phys_ta = target_addr;
+    tp->func_sa = source_addr_func;
+    tp->func_ta = target_addr_func;
+    tp->fd = ep->fd;
+    tp->canfd = ep->canfd;
+
+    InitLinks(tp, target_addr, target_addr_func);
+    if (tx_dl && (ISOTP_RET_OK != isotp_set_tx_dl(&tp->phys_link, tx_dl) ||
+                  ISOTP_RET_OK != isotp_set_tx_dl(&tp->func_link, tx_dl))) {
+        return UDS_ERR_INVALID_ARG;
+    }
+    tp->phys_link.user_send_can_arg = tp;
+    tp->func_link.user_send_can_arg = tp;
+
+    if (UDS_OK != EndpointAddRoute(ep, source_addr, tp) ||
+        (UDS_TP_NOOP_ADDR != source_addr_func && UDS_OK != EndpointAddRoute(ep, source_addr_func, tp))) {
+        EndpointRemoveRoutes(ep, tp);
+        return UDS_FAIL;
+    }
+    tp->ep = ep;
+    tp->ep_next = ep->head;
+    ep->head = tp;
+    return UDS_OK;
+}
+
+UDSTpStatus_t UDSISOTpCEndpointPoll(UDSISOTpCEndpoint_t *ep) {
+    UDS_ASSERT(ep);
+    UDSTpStatus_t status = 0;
+    SocketCANDrain(ep->fd, EndpointDispatch, ep);
+    for (UDSTpISOTpC_t *tp = ep->head; tp; tp = tp->ep_next) {
+        status |= SocketCANPollLink(tp);
+    }
+    return status;
+}
+
+void UDSISOTpCEndpointDeinit(UDSISOTpCEndpoint_t *ep) {
+    UDS_ASSERT(ep);
+    for (UDSTpISOTpC_t *tp = ep->head; tp; tp = tp->ep_next) {
+        tp->ep = NULL;
+        tp->fd = -1;
+    }
+    ep->head = NULL;
+    if (ep->fd >= 0) {
+        close(ep->fd);
+    }
+    ep->fd = -1;
+}
+
 #endif
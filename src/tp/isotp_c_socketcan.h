@@ -4,22 +4,115 @@
 
 #include "tp.h"
 #include "tp/isotp-c/isotp.h"
+#include <linux/can.h>
 
-typedef struct {
+/** frames read by one recvmmsg() or written by one sendmmsg() */
+#ifndef UDS_ISOTP_C_SOCKETCAN_BATCH
+#define UDS_ISOTP_C_SOCKETCAN_BATCH (32)
+#endif
+
+/** CAN ID slots of a UDSISOTpCEndpoint_t. A power of two, at most half of them are used */
+#ifndef UDS_ISOTP_C_ENDPOINT_ROUTES
+#define UDS_ISOTP_C_ENDPOINT_ROUTES (1024)
+#endif
+
+struct UDSISOTpCEndpoint;
+
+typedef struct UDSTpISOTpC {
     UDSTp_t hdl;
     IsoTpLink phys_link;
     IsoTpLink func_link;
-    uint8_t send_buf[UDS_ISOTP_MTU];
-    uint8_t recv_buf[UDS_ISOTP_MTU];
+#if UDS_TP_HALF_DUPLEX
+    uint8_t phys_buf[UDS_TP_MTU]; /**< phys_link receives here, and sends unless in place */
+#else
+#if !UDS_TP_SEND_IN_PLACE
+    uint8_t send_buf[UDS_TP_MTU];
+#endif
+    uint8_t recv_buf[UDS_TP_MTU];
+#endif
+    uint8_t func_buf[ISO_TP_MAX_FRAME_LEN]; /**< func_link carries single frames only */
     int fd;
+    bool canfd; /**< frames are sent as CAN FD frames */
+    struct canfd_frame tx_frames[UDS_ISOTP_C_SOCKETCAN_BATCH]; /**< frames not yet written */
+    unsigned tx_count;
     uint32_t phys_sa, phys_ta;
     uint32_t func_sa, func_ta;
+    struct UDSISOTpCEndpoint *ep; /**< shared socket, NULL if the transport owns `fd` */
+    struct UDSTpISOTpC *ep_next;  /**< next transport on the same endpoint */
     char tag[16];
 } UDSTpISOTpC_t;
 
+typedef struct {
+    uint32_t id;        /**< CAN ID received */
+    UDSTpISOTpC_t *tp;  /**< transport the frames are dispatched to, NULL if the slot is free */
+    bool deleted;       /**< free slot that lookups must probe past */
+} UDSISOTpCRoute_t;
+
+/**
+ * @brief One SocketCAN socket shared by many isotp-c transports
+ * @details Received frames are drained once and dispatched through a CAN ID hash table, so a
+ * tester talking to many ECUs neither opens a socket per ECU nor copies the bus once per ECU. The
+ * kernel filter is kept to the IDs of the attached transports.
+ */
+typedef struct UDSISOTpCEndpoint {
+    int fd;
+    bool canfd;                                         /**< CAN FD frames are enabled */
+    UDSISOTpCRoute_t routes[UDS_ISOTP_C_ENDPOINT_ROUTES];
+    size_t route_count;
+    struct can_filter filters[UDS_ISOTP_C_ENDPOINT_ROUTES / 2];
+    size_t filter_count;                                /**< distinct IDs in `routes` */
+    UDSTpISOTpC_t *head;                                /**< attached transports */
+} UDSISOTpCEndpoint_t;
+
 UDSErr_t UDSTpISOTpCInit(UDSTpISOTpC_t *tp, const char *ifname, uint32_t source_addr,
                          uint32_t target_addr, uint32_t source_addr_func,
                          uint32_t target_addr_func);
+
+/**
+ * @brief Initialize an isotp-c transport that sends and receives CAN FD frames
+ * @param tx_dl data length of the frames sent: 8, 12, 16, 20, 24, 32, 48 or 64
+ * @note the interface must be CAN FD capable (`ip link set <ifname> mtu 72` for vcan)
+ * @return UDS_OK, UDS_ERR_INVALID_ARG for an invalid tx_dl, or UDS_FAIL if the socket does
+ * not support CAN FD
+ */
+UDSErr_t UDSTpISOTpCInitFD(UDSTpISOTpC_t *tp, const char *ifname, uint32_t source_addr,
+                           uint32_t target_addr, uint32_t source_addr_func,
+                           uint32_t target_addr_func, uint8_t tx_dl);
+
+/**
+ * @brief Detach a transport from its endpoint, or close its socket
+ */
 void UDSTpISOTpCDeinit(UDSTpISOTpC_t *tp);
 
+/**
+ * @brief Open a SocketCAN socket to share between transports
+ * @param canfd enable CAN FD frames. The interface must be CAN FD capable
+ * @return UDS_OK or UDS_FAIL
+ */
+UDSErr_t UDSISOTpCEndpointInit(UDSISOTpCEndpoint_t *ep, const char *ifname, bool canfd);
+
+/**
+ * @brief Initialize an isotp-c transport on a shared endpoint
+ * @details The transport is a complete UDSTp_t: polling it drains the endpoint. With many
+ * transports, call UDSISOTpCEndpointPoll() once per loop instead of polling each one.
+ * @param tx_dl data length of the frames sent, 0 for classic CAN
+ * @return UDS_OK, UDS_ERR_INVALID_ARG if tx_dl is invalid, or UDS_FAIL if source_addr is
+ * already used on the endpoint or the endpoint is full
+ */
+UDSErr_t UDSTpISOTpCInitOnEndpoint(UDSTpISOTpC_t *tp, UDSISOTpCEndpoint_t *ep,
+                                   uint32_t source_addr, uint32_t target_addr,
+                                   uint32_t source_addr_func, uint32_t target_addr_func,
+                                   uint8_t tx_dl);
+
+/**
+ * @brief Receive once for every attached transport and poll them all
+ * @return the status flags of all transports ORed together
+ */
+UDSTpStatus_t UDSISOTpCEndpointPoll(UDSISOTpCEndpoint_t *ep);
+
+/**
+ * @brief Close the socket. Attached transports must not be used afterwards
+ */
+void UDSISOTpCEndpointDeinit(UDSISOTpCEndpoint_t *ep);
+
 #endif
@@ -8,76 +8,254 @@
 #include <string.h>
 #include <stdlib.h>
 
-#define MAX_NUM_TP 16
-#define NUM_MSGS 8
-static ISOTPMock_t *TPs[MAX_NUM_TP];
+#define ROUTE_BUCKETS_MIN 64
+
+/**
+ * @brief A message on the network. Shared by every receiver of a functional message
+ */
+struct ISOTPMockMsg {
+    uint32_t deliver_time; /* network time at which the message arrives */
+    uint64_t seq;          /* sequence number, orders messages with the same delivery time */
+    unsigned refs;         /* receivers still holding the message */
+    UDSSDU_t info;
+    size_t len;
+    uint8_t buf[];
+};
+
+static ISOTPMock_t **TPs;
 static unsigned TPCount = 0;
+static unsigned TPCapacity = 0;
 static FILE *LogFile = NULL;
-static struct Msg {
-    uint8_t buf[UDS_ISOTP_MTU];
-    size_t len;
-    UDSSDU_t info;
-    uint32_t scheduled_tx_time;
-    ISOTPMock_t *sender;
-} msgs[NUM_MSGS];
-static unsigned MsgCount = 0;
 
-static void NetworkPoll(void) {
-    for (unsigned i = 0; i < MsgCount; i++) {
-        if (UDSTimeAfter(UDSMillis(), msgs[i].scheduled_tx_time)) {
-            bool found = false;
-            for (unsigned j = 0; j < TPCount; j++) {
-                ISOTPMock_t *tp = TPs[j];
-                if (tp->sa_phys == msgs[i].info.A_TA || tp->sa_func == msgs[i].info.A_TA) {
-                    found = true;
-                    if (tp->recv_len > 0) {
-                        UDS_LOGW(__FILE__,
-                                 "TPMock: %s recv buffer is already full. Message dropped",
-                                 tp->name);
-                        continue;
-                    }
-
-                    UDS_LOGD(__FILE__,
-                             "%s receives %ld bytes from TA=0x%03X (A_TA_Type=%s):", tp->name,
-                             msgs[i].len, msgs[i].info.A_TA,
-                             msgs[i].info.A_TA_Type == UDS_A_TA_TYPE_PHYSICAL ? "PHYSICAL"
-                                                                              : "FUNCTIONAL");
-                    UDS_LOG_SDU(__FILE__, msgs[i].buf, msgs[i].len, &(msgs[i].info));
-
-                    memmove(tp->recv_buf, msgs[i].buf, msgs[i].len);
-                    tp->recv_len = msgs[i].len;
-                    tp->recv_info = msgs[i].info;
-                }
-            }
+static ISOTPMockRoute_t **Routes; // address map, a power of two number of buckets
+static size_t RouteBuckets = 0;
+static size_t RouteCount = 0;
+
+static struct ISOTPMockMsg **InFlight; // min-heap by (deliver_time, seq)
+static size_t InFlightCount = 0;
+static size_t InFlightCapacity = 0;
+static uint64_t NextSeq = 0;
+
+static bool VirtualTime = false;
+static uint32_t VirtualNow = 0;
+static uint32_t RandState = 0x2545F491;
+
+uint32_t ISOTPMockMillis(void) { return VirtualTime ? VirtualNow : UDSMillis(); }
+
+void ISOTPMockSetTime(uint32_t ms) {
+    VirtualTime = true;
+    VirtualNow = ms;
+}
+
+void ISOTPMockAdvance(uint32_t ms) { VirtualNow += ms; }
+
+void ISOTPMockSeed(uint32_t seed) { RandState = seed ? seed : 0x2545F491; }
 
-            if (!found) {
-                UDS_LOGW(__FILE__, "TPMock: no matching receiver for message");
+size_t ISOTPMockInFlight(void) { return InFlightCount; }
+
+uint32_t ISOTPMockNextDeadlineMs(void) {
+    for (unsigned i = 0; i < TPCount; i++) {
+        if (TPs[i]->recv_len > 0) {
+            return 0; // a message is waiting to be read
+        }
+    }
+    if (0 == InFlightCount) {
+        return UDS_NO_DEADLINE;
+    }
+    return UDSMillisUntil(ISOTPMockMillis(), InFlight[0]->deliver_time);
+}
+
+static uint32_t Rand(void) {
+    // xorshift32
+    RandState ^= RandState << 13;
+    RandState ^= RandState >> 17;
+    RandState ^= RandState << 5;
+    return RandState;
+}
+
+static size_t RouteHash(uint32_t addr) {
+    addr ^= addr >> 16;
+    addr *= 0x45D9F3BU;
+    addr ^= addr >> 16;
+    return addr & (RouteBuckets - 1);
+}
+
+static void RouteGrow(void) {
+    size_t old_buckets = RouteBuckets;
+    ISOTPMockRoute_t **old = Routes;
+    RouteBuckets = old_buckets ? old_buckets * 2 : ROUTE_BUCKETS_MIN;
+    Routes = calloc(RouteBuckets, sizeof(*Routes));
+    UDS_ASSERT(Routes);
+    for (size_t i = 0; i < old_buckets; i++) {
+        // walk each chain from its head and append, which keeps routes sharing an address in
+        // the order they were added
+        ISOTPMockRoute_t *r = old[i];
+        while (r) {
+            ISOTPMockRoute_t *next = r->next;
+            ISOTPMockRoute_t **tail = &Routes[RouteHash(r->addr)];
+            while (*tail) {
+                tail = &(*tail)->next;
             }
+            r->next = NULL;
+            *tail = r;
+            r = next;
+        }
+    }
+    free(old);
+}
 
-            for (unsigned j = i + 1; j < MsgCount; j++) {
-                msgs[j - 1] = msgs[j];
+static void RouteAdd(ISOTPMockRoute_t *route, ISOTPMock_t *tp, uint32_t addr) {
+    route->addr = addr;
+    route->tp = tp;
+    route->next = NULL;
+    if (UDS_TP_NOOP_ADDR == addr) {
+        return;
+    }
+    if (RouteCount >= RouteBuckets) {
+        RouteGrow();
+    }
+    ISOTPMockRoute_t **tail = &Routes[RouteHash(addr)];
+    while (*tail) {
+        tail = &(*tail)->next;
+    }
+    *tail = route;
+    RouteCount++;
+}
+
+static void RouteRemove(ISOTPMockRoute_t *route) {
+    if (UDS_TP_NOOP_ADDR == route->addr || 0 == RouteBuckets) {
+        return;
+    }
+    for (ISOTPMockRoute_t **r = &Routes[RouteHash(route->addr)]; *r; r = &(*r)->next) {
+        if (*r == route) {
+            *r = route->next;
+            RouteCount--;
+            return;
+        }
+    }
+}
+
+static bool MsgBefore(const struct ISOTPMockMsg *a, const struct ISOTPMockMsg *b) {
+    if (a->deliver_time != b->deliver_time) {
+        return UDSTimeAfter(b->deliver_time, a->deliver_time);
+    }
+    return a->seq < b->seq;
+}
+
+static void InFlightPush(struct ISOTPMockMsg *m) {
+    if (InFlightCount >= InFlightCapacity) {
+        InFlightCapacity = InFlightCapacity ? InFlightCapacity * 2 : 64;
+        InFlight = realloc(InFlight, InFlightCapacity * sizeof(*InFlight));
+        UDS_ASSERT(InFlight);
+    }
+    size_t i = InFlightCount++;
+    while (i > 0 && MsgBefore(m, InFlight[(i - 1) / 2])) {
+        InFlight[i] = InFlight[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    InFlight[i] = m;
+}
+
+static struct ISOTPMockMsg *InFlightPop(void) {
+    struct ISOTPMockMsg *top = InFlight[0];
+    struct ISOTPMockMsg *last = InFlight[--InFlightCount];
+    size_t i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= InFlightCount) {
+            break;
+        }
+        if (child + 1 < InFlightCount && MsgBefore(InFlight[child + 1], InFlight[child])) {
+            child++;
+        }
+        if (!MsgBefore(InFlight[child], last)) {
+            break;
+        }
+        InFlight[i] = InFlight[child];
+        i = child;
+    }
+    if (InFlightCount) {
+        InFlight[i] = last;
+    }
+    return top;
+}
+
+static void MsgRelease(struct ISOTPMockMsg *m) {
+    if (0 == --m->refs) {
+        free(m);
+    }
+}
+
+/**
+ * @brief Move the oldest queued message into recv_buf once the previous one has been read
+ */
+static void Promote(ISOTPMock_t *tp) {
+    if (tp->recv_len > 0 || 0 == tp->rx_q_count) {
+        return;
+    }
+    struct ISOTPMockMsg *m = tp->rx_q[tp->rx_q_head];
+    tp->rx_q_head = (tp->rx_q_head + 1) % tp->rx_q_len;
+    tp->rx_q_count--;
+    memmove(tp->recv_buf, m->buf, m->len);
+    tp->recv_len = m->len;
+    tp->recv_info = m->info;
+    MsgRelease(m);
+}
+
+static void RxQueueClear(ISOTPMock_t *tp) {
+    while (tp->rx_q_count > 0) {
+        MsgRelease(tp->rx_q[tp->rx_q_head]);
+        tp->rx_q_head = (tp->rx_q_head + 1) % tp->rx_q_len;
+        tp->rx_q_count--;
+    }
+}
+
+static void Deliver(ISOTPMock_t *tp, struct ISOTPMockMsg *m) {
+    if (tp->rx_q_count >= tp->rx_q_len) {
+        UDS_LOGW(__FILE__, "TPMock: %s receive queue is full. Message dropped", tp->name);
+        tp->rx_dropped++;
+        return;
+    }
+    UDS_LOGD(__FILE__, "%s receives %ld bytes from TA=0x%03X (A_TA_Type=%s):", tp->name, m->len,
+             m->info.A_TA,
+             m->info.A_TA_Type == UDS_A_TA_TYPE_PHYSICAL ? "PHYSICAL" : "FUNCTIONAL");
+    UDS_LOG_SDU(__FILE__, m->buf, m->len, &(m->info));
+    m->refs++;
+    tp->rx_q[(tp->rx_q_head + tp->rx_q_count) % tp->rx_q_len] = m;
+    tp->rx_q_count++;
+    Promote(tp);
+}
+
+static void NetworkPoll(void) {
+    uint32_t now = ISOTPMockMillis();
+    while (InFlightCount > 0 && UDSTimeAfter(now, InFlight[0]->deliver_time)) {
+        struct ISOTPMockMsg *m = InFlightPop();
+        bool found = false;
+        for (ISOTPMockRoute_t *r = RouteBuckets ? Routes[RouteHash(m->info.A_TA)] : NULL; r;
+             r = r->next) {
+            if (r->addr == m->info.A_TA) {
+                found = true;
+                Deliver(r->tp, m);
             }
-            MsgCount--;
-            i--;
         }
+        if (!found) {
+            UDS_LOGW(__FILE__, "TPMock: no matching receiver for message");
+        }
+        MsgRelease(m);
     }
 }
 
 static ssize_t mock_tp_send(struct UDSTp *hdl, uint8_t *buf, size_t len, UDSSDU_t *info) {
     UDS_ASSERT(hdl);
     ISOTPMock_t *tp = (ISOTPMock_t *)hdl;
-    if (MsgCount >= NUM_MSGS) {
-        UDS_LOGW(__FILE__, "mock_tp_send: too many messages in the queue");
-        return -1;
-    }
-    struct Msg *m = &msgs[MsgCount++];
     UDSTpAddr_t ta_type =
         info == NULL ? (UDSTpAddr_t)UDS_A_TA_TYPE_PHYSICAL : (UDSTpAddr_t)info->A_TA_Type;
-    m->len = len;
-    m->info.A_AE = info == NULL ? 0 : info->A_AE;
+    UDSSDU_t msg_info = {.A_AE = info == NULL ? 0 : info->A_AE};
     if (UDS_A_TA_TYPE_PHYSICAL == ta_type) {
-        m->info.A_TA = tp->ta_phys;
-        m->info.A_SA = tp->sa_phys;
+        // a nonzero target address in `info` overrides the default peer (e.g. a server
+        // responding to one of several testers)
+        msg_info.A_TA = (info != NULL && info->A_TA != 0) ? info->A_TA : tp->ta_phys;
+        msg_info.A_SA = tp->sa_phys;
     } else if (UDS_A_TA_TYPE_FUNCTIONAL == ta_type) {
 
         // This condition is only true for standard CAN.
@@ -87,21 +265,47 @@ static ssize_t mock_tp_send(struct UDSTp *hdl, uint8_t *buf, size_t len, UDSSDU_
             UDS_LOGW(__FILE__, "mock_tp_send: functional message too long: %ld", len);
             return -1;
         }
-        m->info.A_TA = tp->ta_func;
-        m->info.A_SA = tp->sa_func;
+        msg_info.A_TA = tp->ta_func;
+        msg_info.A_SA = tp->sa_func;
     } else {
         UDS_LOGW(__FILE__, "mock_tp_send: unknown TA type: %d", ta_type);
         return -1;
     }
-    m->info.A_TA_Type = ta_type;
-    m->scheduled_tx_time = UDSMillis() + tp->send_tx_delay_ms;
-    memmove(m->buf, buf, len);
+    msg_info.A_TA_Type = ta_type;
+
+    // the link sends one message after the other at `bitrate`
+    uint32_t now = ISOTPMockMillis();
+    uint32_t deliver_time = now + tp->send_tx_delay_ms;
+    if (tp->bitrate) {
+        uint64_t now_us = (uint64_t)now * 1000;
+        uint64_t start_us = tp->tx_free_us > now_us ? tp->tx_free_us : now_us;
+        tp->tx_free_us = start_us + ((uint64_t)len * 8 * 1000000 + tp->bitrate - 1) / tp->bitrate;
+        deliver_time += (uint32_t)((tp->tx_free_us + 999) / 1000 - now_us / 1000);
+    }
 
     UDS_LOGD(__FILE__, "%s sends %ld bytes to TA=0x%03X (A_TA_Type=%s):", tp->name, len,
-             m->info.A_TA, m->info.A_TA_Type == UDS_A_TA_TYPE_PHYSICAL ? "PHYSICAL" : "FUNCTIONAL");
-    UDS_LOG_SDU(__FILE__, buf, len, &m->info);
+             msg_info.A_TA,
+             msg_info.A_TA_Type == UDS_A_TA_TYPE_PHYSICAL ? "PHYSICAL" : "FUNCTIONAL");
+    UDS_LOG_SDU(__FILE__, buf, len, &msg_info);
 
-    return len;
+    if (tp->loss_ppm && Rand() % 1000000 < tp->loss_ppm) {
+        UDS_LOGD(__FILE__, "%s: message lost", tp->name);
+        tp->lost++;
+        return (ssize_t)len;
+    }
+
+    struct ISOTPMockMsg *m = malloc(sizeof(*m) + len);
+    if (NULL == m) {
+        return -1;
+    }
+    m->deliver_time = deliver_time;
+    m->seq = NextSeq++;
+    m->refs = 1;
+    m->info = msg_info;
+    m->len = len;
+    memmove(m->buf, buf, len);
+    InFlightPush(m);
+    return (ssize_t)len;
 }
 
 static ssize_t mock_tp_recv(struct UDSTp *hdl, uint8_t *buf, size_t bufsize, UDSSDU_t *info) {
@@ -120,9 +324,30 @@ static ssize_t mock_tp_recv(struct UDSTp *hdl, uint8_t *buf, size_t bufsize, UDS
         *info = tp->recv_info;
     }
     tp->recv_len = 0;
+    Promote(tp);
     return len;
 }
 
+static ssize_t mock_tp_peek(struct UDSTp *hdl, const uint8_t **buf, UDSSDU_t *info) {
+    UDS_ASSERT(hdl);
+    ISOTPMock_t *tp = (ISOTPMock_t *)hdl;
+    if (tp->recv_len == 0) {
+        return 0;
+    }
+    *buf = tp->recv_buf;
+    if (info) {
+        *info = tp->recv_info;
+    }
+    return (ssize_t)tp->recv_len;
+}
+
+static void mock_tp_ack(struct UDSTp *hdl) {
+    UDS_ASSERT(hdl);
+    ISOTPMock_t *tp = (ISOTPMock_t *)hdl;
+    tp->recv_len = 0;
+    Promote(tp);
+}
+
 static UDSTpStatus_t mock_tp_poll(struct UDSTp *hdl) {
     (void)hdl; // unused parameter
     NetworkPoll();
@@ -135,41 +360,55 @@ static_assert(offsetof(ISOTPMock_t, hdl) == 0, "ISOTPMock_t must not have any me
 static void ISOTPMockAttach(ISOTPMock_t *tp, ISOTPMockArgs_t *args) {
     UDS_ASSERT(tp);
     UDS_ASSERT(args);
-    UDS_ASSERT(TPCount < MAX_NUM_TP);
+    if (TPCount >= TPCapacity) {
+        TPCapacity = TPCapacity ? TPCapacity * 2 : 16;
+        TPs = realloc(TPs, TPCapacity * sizeof(*TPs));
+        UDS_ASSERT(TPs);
+    }
+    tp->index = TPCount;
     TPs[TPCount++] = tp;
     tp->hdl.send = mock_tp_send;
     tp->hdl.recv = mock_tp_recv;
     tp->hdl.poll = mock_tp_poll;
+    tp->hdl.peek = mock_tp_peek;
+    tp->hdl.ack = mock_tp_ack;
     tp->sa_func = args->sa_func;
     tp->sa_phys = args->sa_phys;
     tp->ta_func = args->ta_func;
     tp->ta_phys = args->ta_phys;
+    tp->send_tx_delay_ms = args->send_tx_delay_ms;
+    tp->bitrate = args->bitrate;
+    tp->loss_ppm = args->loss_ppm;
     tp->recv_len = 0;
+    RouteAdd(&tp->routes[0], tp, tp->sa_phys);
+    // an endpoint with the same physical and functional address receives each message once
+    RouteAdd(&tp->routes[1], tp, tp->sa_func == tp->sa_phys ? UDS_TP_NOOP_ADDR : tp->sa_func);
     UDS_LOGV(__FILE__, "attached %s. TPCount: %d", tp->name, TPCount);
 }
 
 static void ISOTPMockDetach(ISOTPMock_t *tp) {
     UDS_ASSERT(tp);
-    for (unsigned i = 0; i < TPCount; i++) {
-        if (TPs[i] == tp) {
-            for (unsigned j = i + 1; j < TPCount; j++) {
-                TPs[j - 1] = TPs[j];
-            }
-            TPCount--;
-            UDS_LOGV(__FILE__, "TPMock: detached %s. TPCount: %d", tp->name, TPCount);
-            return;
-        }
-    }
-    UDS_ASSERT(false);
+    UDS_ASSERT(tp->index < TPCount && TPs[tp->index] == tp);
+    RouteRemove(&tp->routes[0]);
+    RouteRemove(&tp->routes[1]);
+    RxQueueClear(tp);
+    TPs[tp->index] = TPs[--TPCount];
+    TPs[tp->index]->index = tp->index;
+    UDS_LOGV(__FILE__, "TPMock: detached %s. TPCount: %d", tp->name, TPCount);
 }
 
 UDSTp_t *ISOTPMockNew(const char *name, ISOTPMockArgs_t *args) {
-    if (TPCount >= MAX_NUM_TP) {
-        UDS_LOGI(__FILE__, "TPCount: %d, too many TPs\n", TPCount);
+    ISOTPMock_t *tp = malloc(sizeof(ISOTPMock_t));
+    if (NULL == tp) {
         return NULL;
     }
-    ISOTPMock_t *tp = malloc(sizeof(ISOTPMock_t));
     memset(tp, 0, sizeof(ISOTPMock_t));
+    tp->rx_q_len = args->rx_queue_len ? args->rx_queue_len : ISOTP_MOCK_RX_QUEUE_LEN;
+    tp->rx_q = calloc(tp->rx_q_len, sizeof(*tp->rx_q));
+    if (NULL == tp->rx_q) {
+        free(tp);
+        return NULL;
+    }
     if (name) {
         if (snprintf(tp->name, sizeof(tp->name), "%s", name) >= (int)sizeof(tp->name)) {
             UDS_LOGE(__FILE__, "Transport name too long, truncated");
@@ -208,15 +447,33 @@ void ISOTPMockLogToStdout(void) {
 }
 
 void ISOTPMockReset(void) {
-    memset(TPs, 0, sizeof(TPs));
+    while (InFlightCount > 0) {
+        MsgRelease(InFlightPop());
+    }
+    for (unsigned i = 0; i < TPCount; i++) {
+        RxQueueClear(TPs[i]);
+    }
+    free(TPs);
+    TPs = NULL;
     TPCount = 0;
-    memset(msgs, 0, sizeof(msgs));
-    MsgCount = 0;
+    TPCapacity = 0;
+    free(Routes);
+    Routes = NULL;
+    RouteBuckets = 0;
+    RouteCount = 0;
+    free(InFlight);
+    InFlight = NULL;
+    InFlightCapacity = 0;
+    NextSeq = 0;
+    VirtualTime = false;
+    VirtualNow = 0;
+    ISOTPMockSeed(0);
 }
 
 void ISOTPMockFree(UDSTp_t *tp) {
     ISOTPMock_t *tpm = (ISOTPMock_t *)tp;
     ISOTPMockDetach(tpm);
+    free(tpm->rx_q);
     free(tp);
 }
 
@@ -10,6 +10,22 @@
 
 #include "iso14229.h"
 
+// Default number of received messages an endpoint holds behind the one in recv_buf
+#ifndef ISOTP_MOCK_RX_QUEUE_LEN
+#define ISOTP_MOCK_RX_QUEUE_LEN (8)
+#endif
+
+struct ISOTPMock;
+
+/**
+ * @brief Entry of the address to endpoint map
+ */
+typedef struct ISOTPMockRoute {
+    uint32_t addr;               /**< address the endpoint receives on */
+    struct ISOTPMock *tp;        /**< the endpoint */
+    struct ISOTPMockRoute *next; /**< next entry in the same bucket */
+} ISOTPMockRoute_t;
+
 typedef struct ISOTPMock {
     UDSTp_t hdl;
     uint8_t recv_buf[UDS_TP_MTU];
@@ -20,9 +36,21 @@ typedef struct ISOTPMock {
     uint32_t ta_phys;          // target address - physical messages are sent to this address
     uint32_t sa_func;          // source address - functional messages are sent from this address
     uint32_t ta_func;          // target address - functional messages are sent to this address
-    uint32_t send_tx_delay_ms; // simulated delay
+    uint32_t send_tx_delay_ms; // simulated latency of messages sent by this endpoint
     uint32_t send_buf_size;    // simulated size of the send buffer
+    uint32_t bitrate;          // simulated link speed in bits per second, 0 for unlimited
+    uint32_t loss_ppm;         // messages sent by this endpoint that are lost, per million
     char name[32];             // name for logging
+
+    uint64_t tx_free_us;        // time at which the link finishes sending queued messages
+    struct ISOTPMockMsg **rx_q; // messages received behind the one in recv_buf
+    uint32_t rx_q_len;          // capacity of rx_q
+    uint32_t rx_q_head;         // index of the oldest message in rx_q
+    uint32_t rx_q_count;        // number of messages in rx_q
+    uint32_t rx_dropped;        // messages dropped because rx_q was full
+    uint32_t lost;              // messages sent by this endpoint and lost to loss_ppm
+    unsigned index;             // position in the endpoint list
+    ISOTPMockRoute_t routes[2]; // entries in the address map for sa_phys and sa_func
 } ISOTPMock_t;
 
 typedef struct {
@@ -30,11 +58,20 @@ typedef struct {
     uint32_t ta_phys; // target address - physical messages are sent to this address
     uint32_t sa_func; // source address - functional messages are sent from this address
     uint32_t ta_func; // target address - functional messages are sent to this address
+
+    uint32_t send_tx_delay_ms; // simulated latency, see ISOTPMock_t
+    uint32_t bitrate;          // simulated link speed in bits per second, 0 for unlimited
+    uint32_t loss_ppm;         // messages lost, per million
+    uint32_t rx_queue_len;     // messages held by the receiver, 0 for ISOTP_MOCK_RX_QUEUE_LEN
 } ISOTPMockArgs_t;
 
 /**
  * @brief Create a mock transport. It is connected by default to a broadcast network of all other
  * mock transports in the same process.
+ * @details Messages are delivered in the order of their delivery time: the time they finish
+ * transmission at `bitrate` after the messages already queued by the sender, plus
+ * `send_tx_delay_ms`. Receivers are found through an address hash map, so the cost of a delivery
+ * does not grow with the number of endpoints.
  * @param name optional name of the transport (can be NULL)
  * @return UDSTp_t*
  */
@@ -54,4 +91,39 @@ void ISOTPMockLogToStdout(void);
  */
 void ISOTPMockReset(void);
 
+/**
+ * @brief Seed the generator that decides which messages are lost. The default seed is fixed, so
+ * runs are repeatable.
+ */
+void ISOTPMockSeed(uint32_t seed);
+
+/**
+ * @brief Network time in milliseconds: UDSMillis() until ISOTPMockSetTime() is called
+ */
+uint32_t ISOTPMockMillis(void);
+
+/**
+ * @brief Switch the network to a virtual clock that only moves with ISOTPMockAdvance()
+ * @details Once it is set, UDSMillis() may be implemented with ISOTPMockMillis() under
+ * UDS_CUSTOM_MILLIS to run servers and clients on the same clock.
+ */
+void ISOTPMockSetTime(uint32_t ms);
+
+/**
+ * @brief Move the virtual clock forward
+ */
+void ISOTPMockAdvance(uint32_t ms);
+
+/**
+ * @brief Number of messages queued on the network and not yet delivered
+ */
+size_t ISOTPMockInFlight(void);
+
+/**
+ * @brief Time until the network next has work to do, for simulations that skip idle time
+ * @return milliseconds until the next queued message is delivered, 0 if a transport holds a
+ * message that has not been read yet, or UDS_NO_DEADLINE if the network is idle
+ */
+uint32_t ISOTPMockNextDeadlineMs(void);
+
 #endif
@@ -29,7 +29,7 @@ static UDSTpStatus_t isotp_sock_tp_poll(UDSTp_t *hdl) {
     pfds[1].events = POLLERR | POLLOUT;
     pfds[1].revents = 0;
 
-    ret = poll(pfds, 2, 1);
+    ret = poll(pfds, 2, impl->poll_timeout_ms);
     if (ret < 0) {
         UDS_LOGE(__FILE__, "poll failed: %d", ret);
         status |= UDS_TP_ERR;
@@ -74,9 +74,27 @@ static UDSTpStatus_t isotp_sock_tp_poll(UDSTp_t *hdl) {
             }
         }
     }
+    // the physical socket stays without POLLOUT until the multi-frame send started by
+    // isotp_sock_tp_send() is done, even when no other event is pending
+    if (ret >= 0 && impl->send_in_progress && !(pfds[0].revents & POLLOUT)) {
+        status |= UDS_TP_SEND_IN_PROGRESS;
+    }
+    impl->send_in_progress = status & UDS_TP_SEND_IN_PROGRESS;
     return status;
 }
 
+int UDSTpIsoTpSockPollFds(const UDSTpIsoTpSock_t *tp, struct pollfd fds[2]) {
+    UDS_ASSERT(tp);
+    UDS_ASSERT(fds);
+    fds[0].fd = tp->phys_fd;
+    fds[0].events = POLLIN | (tp->send_in_progress ? POLLOUT : 0);
+    fds[0].revents = 0;
+    fds[1].fd = tp->func_fd;
+    fds[1].events = POLLIN;
+    fds[1].revents = 0;
+    return 2;
+}
+
 static ssize_t tp_recv_once(int fd, uint8_t *buf, size_t size) {
     ssize_t ret = read(fd, buf, size);
     if (ret < 0) {
@@ -120,12 +138,41 @@ static ssize_t isotp_sock_tp_recv(UDSTp_t *hdl, uint8_t *buf, size_t bufsize, UD
 
         UDS_LOGD(__FILE__, "'%s' received %ld bytes from 0x%03x (%s), ", impl->tag, ret, msg->A_TA,
                  msg->A_TA_Type == UDS_A_TA_TYPE_PHYSICAL ? "phys" : "func");
-        UDS_LOG_SDU(__FILE__, impl->recv_buf, ret, msg);
+        UDS_LOG_SDU(__FILE__, buf, ret, msg);
     }
 
     return ret;
 }
 
+#if !UDS_TP_HALF_DUPLEX
+/**
+ * @brief The kernel copies each message out of the socket anyway, so peek reads it into recv_buf
+ * and lends that. Further messages stay queued in the socket until the ack.
+ */
+static ssize_t isotp_sock_tp_peek(UDSTp_t *hdl, const uint8_t **buf, UDSSDU_t *info) {
+    UDS_ASSERT(hdl);
+    UDS_ASSERT(buf);
+    UDSTpIsoTpSock_t *impl = (UDSTpIsoTpSock_t *)hdl;
+    if (0 == impl->recv_len) {
+        ssize_t ret = isotp_sock_tp_recv(hdl, impl->recv_buf, sizeof(impl->recv_buf), NULL);
+        if (ret <= 0) {
+            return ret;
+        }
+        impl->recv_len = (size_t)ret;
+    }
+    *buf = impl->recv_buf;
+    if (info) {
+        *info = impl->recv_info;
+    }
+    return (ssize_t)impl->recv_len;
+}
+
+static void isotp_sock_tp_ack(UDSTp_t *hdl) {
+    UDS_ASSERT(hdl);
+    ((UDSTpIsoTpSock_t *)hdl)->recv_len = 0;
+}
+#endif
+
 static ssize_t isotp_sock_tp_send(UDSTp_t *hdl, uint8_t *buf, size_t len, UDSSDU_t *info) {
     UDS_ASSERT(hdl);
     ssize_t ret = -1;
@@ -148,6 +195,9 @@ static ssize_t isotp_sock_tp_send(UDSTp_t *hdl, uint8_t *buf, size_t len, UDSSDU
     ret = write(fd, buf, len);
     if (ret < 0) {
         perror("write");
+    } else if (len > 7 && UDS_A_TA_TYPE_PHYSICAL == ta_type) {
+        // a multi-frame send finishes in the background, poll for POLLOUT until it is done
+        impl->send_in_progress = true;
     }
 done:;
     int ta = ta_type == UDS_A_TA_TYPE_PHYSICAL ? impl->phys_ta : impl->func_ta;
@@ -219,6 +269,11 @@ UDSErr_t UDSTpIsoTpSockInitServer(UDSTpIsoTpSock_t *tp, const char *ifname, uint
     tp->hdl.send = isotp_sock_tp_send;
     tp->hdl.recv = isotp_sock_tp_recv;
     tp->hdl.poll = isotp_sock_tp_poll;
+#if !UDS_TP_HALF_DUPLEX
+    tp->hdl.peek = isotp_sock_tp_peek;
+    tp->hdl.ack = isotp_sock_tp_ack;
+#endif
+    tp->poll_timeout_ms = UDS_TP_ISOTP_SOCK_POLL_TIMEOUT_MS;
     tp->phys_sa = source_addr;
     tp->phys_ta = target_addr;
     tp->func_sa = source_addr_func;
@@ -245,6 +300,11 @@ UDSErr_t UDSTpIsoTpSockInitClient(UDSTpIsoTpSock_t *tp, const char *ifname, uint
     tp->hdl.send = isotp_sock_tp_send;
     tp->hdl.recv = isotp_sock_tp_recv;
     tp->hdl.poll = isotp_sock_tp_poll;
+#if !UDS_TP_HALF_DUPLEX
+    tp->hdl.peek = isotp_sock_tp_peek;
+    tp->hdl.ack = isotp_sock_tp_ack;
+#endif
+    tp->poll_timeout_ms = UDS_TP_ISOTP_SOCK_POLL_TIMEOUT_MS;
     tp->func_ta = target_addr_func;
     tp->phys_ta = target_addr;
     tp->phys_sa = source_addr;
@@ -1,19 +1,29 @@
 #if defined(UDS_TP_ISOTP_SOCK)
 
 #pragma once
+#include "config.h"
 #include "tp.h"
 #include "uds.h"
+#include <poll.h>
+
+/** default time UDSTpPoll() may block waiting for a multi-frame send to finish */
+#ifndef UDS_TP_ISOTP_SOCK_POLL_TIMEOUT_MS
+#define UDS_TP_ISOTP_SOCK_POLL_TIMEOUT_MS (1)
+#endif
 
 typedef struct {
     UDSTp_t hdl;
-    uint8_t recv_buf[UDS_ISOTP_MTU];
-    uint8_t send_buf[UDS_ISOTP_MTU];
-    size_t recv_len;
+#if !UDS_TP_HALF_DUPLEX
+    uint8_t recv_buf[UDS_ISOTP_MTU]; /**< message lent by peek */
+    size_t recv_len;                 /**< length of the message lent by peek, 0 if none */
+#endif
     UDSSDU_t recv_info;
     int phys_fd;
     int func_fd;
     uint32_t phys_sa, phys_ta;
     uint32_t func_sa, func_ta;
+    int poll_timeout_ms; /**< timeout of the poll() in UDSTpPoll(). 0 never blocks */
+    bool send_in_progress; /**< the last UDSTpPoll() reported UDS_TP_SEND_IN_PROGRESS */
     char tag[16];
 } UDSTpIsoTpSock_t;
 
@@ -23,4 +33,16 @@ UDSErr_t UDSTpIsoTpSockInitClient(UDSTpIsoTpSock_t *tp, const char *ifname, uint
                                   uint32_t target_addr, uint32_t target_addr_func);
 void UDSTpIsoTpSockDeinit(UDSTpIsoTpSock_t *tp);
 
+/**
+ * @brief Get the descriptors and events an external event loop should wait on
+ * @details POLLIN is requested on both sockets. POLLOUT is requested on the physical socket while
+ * a multi-frame send is in progress, so that its completion wakes the loop. The events map
+ * directly onto EPOLLIN and EPOLLOUT. Set `poll_timeout_ms` to 0 so that calling UDSTpPoll()
+ * after a wakeup never blocks.
+ * @param tp
+ * @param fds filled with the physical and functional socket
+ * @return the number of entries filled in (2)
+ */
+int UDSTpIsoTpSockPollFds(const UDSTpIsoTpSock_t *tp, struct pollfd fds[2]);
+
 #endif
@@ -0,0 +1,90 @@
+#include "trace.h"
+#include "util.h"
+
+#if UDS_TRACE
+
+#define TRACE_MASK ((uint32_t)UDS_TRACE_ENTRIES - 1U)
+
+/*
+ * A writer claims a slot by incrementing head, clears its seq, fills it and publishes seq last.
+ * A reader that sees the same non-zero seq before and after copying an entry has a complete one.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define TRACE_CLAIM(p) __atomic_fetch_add((p), 1U, __ATOMIC_RELAXED)
+#define TRACE_LOAD(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define TRACE_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define TRACE_FENCE() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#else
+/* single core, single context: volatile accesses are not reordered against each other */
+#define TRACE_CLAIM(p) ((*(p))++)
+#define TRACE_LOAD(p) (*(p))
+#define TRACE_STORE(p, v) (*(p) = (v))
+#define TRACE_FENCE()
+#endif
+
+UDSTraceRing_t UDSTrace = {
+    .magic = UDS_TRACE_MAGIC,
+    .version = UDS_TRACE_VERSION,
+    .dataLen = UDS_TRACE_DATA_LEN,
+    .entries = UDS_TRACE_ENTRIES,
+};
+
+static void TraceWrite(uint8_t event, uint8_t flags, uint32_t addr, uint16_t len,
+                       const uint8_t *data, size_t data_len) {
+    uint32_t n = TRACE_CLAIM(&UDSTrace.head);
+    volatile UDSTraceEntry_t *e = &UDSTrace.entry[n & TRACE_MASK];
+    TRACE_STORE(&e->seq, 0U);
+    TRACE_FENCE();
+    e->us = UDSMicros();
+    e->addr = addr;
+    e->len = len;
+    e->event = event;
+    e->flags = flags;
+    if (NULL == data) {
+        data_len = 0;
+    } else if (data_len > UDS_TRACE_DATA_LEN) {
+        data_len = UDS_TRACE_DATA_LEN;
+    }
+    for (size_t i = 0; i < data_len; i++) {
+        e->data[i] = data[i];
+    }
+    TRACE_STORE(&e->seq, n + 1U);
+}
+
+void UDSTraceRecord(uint8_t event, uint32_t addr, const uint8_t *data, size_t len) {
+    TraceWrite(event, 0, addr, len > UINT16_MAX ? UINT16_MAX : (uint16_t)len, data, len);
+}
+
+void UDSTraceSDU(bool tx, const uint8_t *buf, ssize_t ret, const UDSSDU_t *info) {
+    uint8_t flags =
+        (info && UDS_A_TA_TYPE_FUNCTIONAL == info->A_TA_Type) ? UDS_TRACE_FLAG_FUNCTIONAL : 0;
+    uint32_t addr = info ? (tx ? info->A_TA : info->A_SA) : 0;
+    if (ret < 0) {
+        uint16_t err = ret < -UINT16_MAX ? UINT16_MAX : (uint16_t)-ret;
+        TraceWrite(tx ? UDS_TRACE_EVT_TX_ERR : UDS_TRACE_EVT_RX_ERR, flags, addr, err, NULL, 0);
+        return;
+    }
+    uint16_t len = ret > UINT16_MAX ? UINT16_MAX : (uint16_t)ret;
+    TraceWrite(tx ? UDS_TRACE_EVT_TX : UDS_TRACE_EVT_RX, flags, addr, len, buf, (size_t)ret);
+}
+
+void UDSTraceSnapshot(UDSTraceRing_t *out) {
+    UDS_ASSERT(out);
+    out->magic = UDSTrace.magic;
+    out->version = UDSTrace.version;
+    out->dataLen = UDSTrace.dataLen;
+    out->entries = UDSTrace.entries;
+    out->head = TRACE_LOAD(&UDSTrace.head);
+    for (uint32_t i = 0; i < UDS_TRACE_ENTRIES; i++) {
+        volatile UDSTraceEntry_t *e = &UDSTrace.entry[i];
+        uint32_t seq = TRACE_LOAD(&e->seq);
+        memcpy(&out->entry[i], (const void *)e, sizeof(out->entry[i]));
+        TRACE_FENCE();
+        if (seq != TRACE_LOAD(&e->seq)) {
+            seq = 0;
+        }
+        out->entry[i].seq = seq;
+    }
+}
+
+#endif
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "sys.h"
+#include "config.h"
+#include "tp.h"
+
+/**
+ * @brief Binary trace of service data units
+ * @details Enabled with UDS_TRACE. Each SDU sent or received through UDSTpSend(), UDSTpRecv() or
+ * UDSTpPeek() is stored as one fixed size UDSTraceEntry_t in the RAM ring UDSTrace, overwriting
+ * the oldest entry. Recording is a memcpy of UDS_TRACE_DATA_LEN bytes and one UDSMicros() call, so
+ * the trace can stay on in production where UDS_LOG_SDU would break P2 timing.
+ *
+ * Read the ring with UDSTraceSnapshot(), or dump the memory of UDSTrace (e.g. with gdb
+ * `dump binary value trace.bin UDSTrace`), and decode it with tools/decode_trace.py.
+ */
+
+#define UDS_TRACE_MAGIC 0x54534455U /**< "UDST" in little endian */
+#define UDS_TRACE_VERSION 1
+
+typedef enum {
+    UDS_TRACE_EVT_NONE = 0,
+    UDS_TRACE_EVT_TX,          /**< SDU sent */
+    UDS_TRACE_EVT_RX,          /**< SDU received */
+    UDS_TRACE_EVT_TX_ERR,      /**< UDSTpSend failed, `len` holds the negated return value */
+    UDS_TRACE_EVT_RX_ERR,      /**< UDSTpRecv/UDSTpPeek failed, `len` as for TX_ERR */
+    UDS_TRACE_EVT_USER = 0x80, /**< first event ID for UDSTraceRecord() by the application */
+} UDSTraceEvent_t;
+
+#define UDS_TRACE_FLAG_FUNCTIONAL 0x01 /**< the SDU was functionally addressed */
+
+typedef struct {
+    uint32_t seq;                     /**< 1 + entries recorded before it, 0 while written */
+    uint32_t us;                      /**< UDSMicros() when the entry was recorded */
+    uint32_t addr;                    /**< A_TA passed to UDSTpSend (may be 0), A_SA received */
+    uint16_t len;                     /**< length of the SDU, which may be longer than `data` */
+    uint8_t event;                    /**< UDSTraceEvent_t */
+    uint8_t flags;                    /**< UDS_TRACE_FLAG_... */
+    uint8_t data[UDS_TRACE_DATA_LEN]; /**< leading bytes of the SDU, data[0] is the SID */
+} UDSTraceEntry_t;
+
+typedef struct {
+    uint32_t magic;   /**< UDS_TRACE_MAGIC, also gives the decoder the byte order */
+    uint16_t version; /**< UDS_TRACE_VERSION */
+    uint16_t dataLen; /**< UDS_TRACE_DATA_LEN */
+    uint32_t entries; /**< UDS_TRACE_ENTRIES */
+    uint32_t head;    /**< number of entries recorded, the next one goes to head % entries */
+    UDSTraceEntry_t entry[UDS_TRACE_ENTRIES];
+} UDSTraceRing_t;
+
+#if UDS_TRACE
+extern UDSTraceRing_t UDSTrace;
+
+/**
+ * @brief Record an application event in the trace
+ * @param event UDS_TRACE_EVT_USER or above
+ * @param data copied up to UDS_TRACE_DATA_LEN bytes, may be NULL if len is 0
+ * @note safe to call from several threads or interrupts: slots are claimed with an atomic
+ * increment where the compiler provides one
+ */
+void UDSTraceRecord(uint8_t event, uint32_t addr, const uint8_t *data, size_t len);
+
+/**
+ * @brief Record an SDU passing the transport API
+ * @param ret return value of the transport call: the length of the SDU, or a negative error
+ */
+void UDSTraceSDU(bool tx, const uint8_t *buf, ssize_t ret, const UDSSDU_t *info);
+
+/**
+ * @brief Copy the trace ring while it is being written
+ * @details Entries that were being overwritten during the copy have their `seq` set to 0 in `out`.
+ */
+void UDSTraceSnapshot(UDSTraceRing_t *out);
+#endif
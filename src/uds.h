@@ -33,12 +33,21 @@ typedef enum UDSEvent {
     UDS_EVT_RequestFileTransfer,  /**< Server evt 0x38, argtype: UDSRequestFileTransferArgs_t * */
     UDS_EVT_ControlDTCSetting,    /**< Server evt 0x85, argtype: UDSControlDTCSettingArgs_t * */
     UDS_EVT_LinkControl,          /**< Server evt 0x87, argtype: UDSLinkCtrlArgs_t * */
+    UDS_EVT_AccessTimingParam,    /**< Server evt 0x83, argtype: UDSAccessTimingArgs_t * */
+    UDS_EVT_TransferCheckpoint,   /**< Server evt 0x36, argtype: UDSXferCheckpoint_t * */
+    UDS_EVT_Authentication,       /**< Server evt 0x29, argtype: UDSAuthArgs_t * */
     UDS_EVT_Custom,               /**< Server evt other, argtype: UDSCustomArgs_t * */
 
     UDS_EVT_Poll,             /**< Client evt: Poll. Argument type: NULL */
     UDS_EVT_SendComplete,     /**< Client evt: Send complete. Argument type: NULL */
     UDS_EVT_ResponseReceived, /**< Client evt: Response received. Argument type: NULL */
     UDS_EVT_Idle,             /**< Client evt: Idle. Argument type: NULL */
+    UDS_EVT_DownloadComplete, /**< Client evt: Download done. Argument type: UDSDownloadStats_t * */
+    UDS_EVT_UploadComplete,   /**< Client evt: Upload done. Argument type: UDSUploadStats_t * */
+
+    /** Client evt: one response collected for a functional request. Argument type:
+     * UDSFunctionalResponse_t * */
+    UDS_EVT_FunctionalResponse,
 
     UDS_EVT_MAX, /**< Unused sentinel value */
 } UDSEvent_t;
@@ -173,6 +182,102 @@ typedef enum {
 #define UDS_CTP_NWMCM 2     // NetworkManagementCommunicationMessages
 #define UDS_CTP_NWMCM_NCM 3 // NetworkManagementCommunicationMessagesAndNormalCommunicationMessages
 
+/**
+ * @brief 0x29 Authentication SubFunction = [authenticationTask]
+ * ISO14229-1:2020 10.6
+ */
+#define UDS_LEV_AT_DA 0x00     // deAuthenticate
+#define UDS_LEV_AT_VCU 0x01    // verifyCertificateUnidirectional
+#define UDS_LEV_AT_VCB 0x02    // verifyCertificateBidirectional
+#define UDS_LEV_AT_POWN 0x03   // proofOfOwnership
+#define UDS_LEV_AT_TC 0x04     // transmitCertificate
+#define UDS_LEV_AT_RCFA 0x05   // requestChallengeForAuthentication
+#define UDS_LEV_AT_VPOWNU 0x06 // verifyProofOfOwnershipUnidirectional
+#define UDS_LEV_AT_VPOWNB 0x07 // verifyProofOfOwnershipBidirectional
+#define UDS_LEV_AT_AC 0x08     // authenticationConfiguration
+
+/**
+ * @brief 0x29 Authentication authenticationReturnParameter
+ * ISO14229-1:2020 10.6
+ */
+#define UDS_AT_RA 0x00      // RequestAccepted
+#define UDS_AT_GR 0x01      // GeneralReject
+#define UDS_AT_ACAPCE 0x02  // AuthenticationConfiguration APCE
+#define UDS_AT_ACACRAC 0x03 // AuthenticationConfiguration ACR with asymmetric cryptography
+#define UDS_AT_ACACRSC 0x04 // AuthenticationConfiguration ACR with symmetric cryptography
+#define UDS_AT_DAS 0x10     // DeAuthentication successful
+#define UDS_AT_CVOVN 0x11   // CertificateVerified, OwnershipVerificationNecessary
+#define UDS_AT_OVAC 0x12    // OwnershipVerified, AuthenticationComplete
+#define UDS_AT_CV 0x13      // CertificateVerified
+
+/**
+ * @brief 0x83 AccessTimingParameter SubFunction = [timingParameterAccessType]
+ * ISO14229-1:2013 Table 182
+ */
+#define UDS_LEV_ATP_RETPS 0x01  // readExtendedTimingParameterSet
+#define UDS_LEV_ATP_STPTDV 0x02 // setTimingParametersToDefaultValues
+#define UDS_LEV_ATP_RCATP 0x03  // readCurrentlyActiveTimingParameters
+#define UDS_LEV_ATP_STPTGV 0x04 // setTimingParametersToGivenValues
+
+/**
+ * @brief 0x84 SecuredDataTransmission administrativeParameter bits
+ * ISO14229-1:2020 Table 17.3
+ */
+#define UDS_SDT_AP_REQUEST 0x0001U   // message is a request
+#define UDS_SDT_AP_PRE_KEY 0x0002U   // pre-established key is used
+#define UDS_SDT_AP_ENCRYPTED 0x0004U // message is encrypted
+#define UDS_SDT_AP_SIGNED 0x0008U    // message is signed
+#define UDS_SDT_AP_SIGN_RESP 0x0010U // signature on the response is requested
+
+/**
+ * @brief 0x2A ReadDataByPeriodicIdentifier transmissionMode
+ * ISO14229-1:2020 Table C.10
+ */
+#define UDS_LEV_TM_SASR 1 // SendAtSlowRate
+#define UDS_LEV_TM_SAMR 2 // SendAtMediumRate
+#define UDS_LEV_TM_SAFR 3 // SendAtFastRate
+#define UDS_LEV_TM_SS 4   // StopSending
+
+/**
+ * @brief 0x2A periodicDataIdentifier N maps to dataIdentifier 0xF2NN
+ */
+#define UDS_PDID_TO_DID(pdid) ((uint16_t)(0xF200U | (pdid)))
+
+/**
+ * @brief 0x86 ResponseOnEvent SubFunction = [eventType]
+ * ISO14229-1:2020 Table 137
+ */
+#define UDS_LEV_RE_STPROE 0x00  // stopResponseOnEvent
+#define UDS_LEV_RE_ONDTCS 0x01  // onDTCStatusChange
+#define UDS_LEV_RE_OCODID 0x03  // onChangeOfDataIdentifier
+#define UDS_LEV_RE_RAE 0x04     // reportActivatedEvents
+#define UDS_LEV_RE_STRTROE 0x05 // startResponseOnEvent
+#define UDS_LEV_RE_CLRROE 0x06  // clearResponseOnEvent
+#define UDS_LEV_RE_OCOV 0x07    // onComparisonOfValues
+
+#define UDS_RE_STORAGE_STATE 0x40 // storeEvent bit of the eventType
+
+/**
+ * @brief 0x86 eventWindowTime
+ * ISO14229-1:2020 Table 138
+ */
+#define UDS_RE_WT_INFINITE 0x02     // infiniteTimeToResponse
+#define UDS_RE_WT_SHORT 0x03        // shortEventWindowTime
+#define UDS_RE_WT_MEDIUM 0x04       // mediumEventWindowTime
+#define UDS_RE_WT_LONG 0x05         // longEventWindowTime
+#define UDS_RE_WT_POWER 0x06        // powerWindowTime
+#define UDS_RE_WT_IGNITION 0x07     // ignitionWindowTime
+#define UDS_RE_WT_MANUFACTURER 0x08 // manufacturerTriggerEventWindowTime
+
+/**
+ * @brief 0x86 onComparisonOfValues comparison logic
+ * ISO14229-1:2020 Table 141
+ */
+#define UDS_RE_CMP_LT 0x01 // less than
+#define UDS_RE_CMP_GT 0x02 // larger than
+#define UDS_RE_CMP_EQ 0x03 // equal
+#define UDS_RE_CMP_NE 0x04 // not equal
+
 /**
  * @brief 0x31 RoutineControl SubFunction = [routineControlType]
  * ISO14229-1:2020 Table 426
@@ -210,6 +315,16 @@ typedef enum {
 // ISO-14229-1:2013 Table 2
 #define UDS_MAX_DIAGNOSTIC_SERVICES 0x7F
 
+/**
+ * @brief Session mask bit for a diagnostic session. Covers sessions 0x01 to 0x20.
+ */
+#define UDS_SESSION_BIT(sessionType) (1UL << (((sessionType)-1) & 0x1F))
+
+/**
+ * @brief Returned by UDSServerNextDeadlineMs and UDSClientNextDeadlineMs when no timer is pending
+ */
+#define UDS_NO_DEADLINE UINT32_MAX
+
 #define UDS_RESPONSE_SID_OF(request_sid) ((request_sid) + 0x40)
 #define UDS_REQUEST_SID_OF(response_sid) ((response_sid) - 0x40)
 
@@ -224,11 +339,17 @@ typedef enum {
 #define UDS_0X19_RESP_BASE_LEN 2U
 #define UDS_0X23_REQ_MIN_LEN 4U
 #define UDS_0X23_RESP_BASE_LEN 1U
+#define UDS_0X22_REQ_MIN_LEN 3U
 #define UDS_0X22_RESP_BASE_LEN 1U
 #define UDS_0X27_REQ_BASE_LEN 2U
 #define UDS_0X27_RESP_BASE_LEN 2U
 #define UDS_0X28_REQ_BASE_LEN 3U
 #define UDS_0X28_RESP_LEN 2U
+#define UDS_0X29_REQ_BASE_LEN 2U
+#define UDS_0X29_RESP_BASE_LEN 2U
+#define UDS_0X29_ALGORITHM_INDICATOR_LEN 16U
+#define UDS_0X2A_REQ_MIN_LEN 2U
+#define UDS_0X2A_RESP_LEN 1U
 #define UDS_0X2C_REQ_MIN_LEN 2U
 #define UDS_0X2C_RESP_BASE_LEN 2U
 #define UDS_0X2E_REQ_BASE_LEN 3U
@@ -253,8 +374,15 @@ typedef enum {
 #define UDS_0X3E_REQ_MIN_LEN 2U
 #define UDS_0X3E_REQ_MAX_LEN 2U
 #define UDS_0X3E_RESP_LEN 2U
+#define UDS_0X83_REQ_BASE_LEN 2U
+#define UDS_0X83_RESP_BASE_LEN 2U
+#define UDS_0X83_TIMING_RECORD_LEN 4U // P2 in 1 ms, P2* in 10 ms, as in the 0x10 response
+#define UDS_0X84_HEADER_LEN 8U   // SID to antiReplayCounter
+#define UDS_0X84_REQ_BASE_LEN 9U // header and internalMessageServiceRequestId
 #define UDS_0X85_REQ_BASE_LEN 2U
 #define UDS_0X85_RESP_LEN 2U
+#define UDS_0X86_REQ_MIN_LEN 3U
+#define UDS_0X86_RESP_BASE_LEN 4U
 #define UDS_0X87_REQ_BASE_LEN 2U
 #define UDS_0X87_RESP_LEN 2U
 
@@ -268,6 +396,7 @@ enum UDSDiagnosticServiceId {
     kSID_READ_SCALING_DATA_BY_IDENTIFIER = 0x24,
     kSID_SECURITY_ACCESS = 0x27,
     kSID_COMMUNICATION_CONTROL = 0x28,
+    kSID_AUTHENTICATION = 0x29,
     kSID_READ_PERIODIC_DATA_BY_IDENTIFIER = 0x2A,
     kSID_DYNAMICALLY_DEFINE_DATA_IDENTIFIER = 0x2C,
     kSID_WRITE_DATA_BY_IDENTIFIER = 0x2E,
@@ -28,6 +28,37 @@ uint32_t UDSMillis(void) {
 }
 #endif
 
+#if UDS_CUSTOM_MICROS
+#else
+uint32_t UDSMicros(void) {
+#if UDS_CUSTOM_MILLIS
+    return UDSMillis() * 1000u;
+#elif UDS_SYS == UDS_SYS_UNIX
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((ts.tv_sec * 1000000LL) + (ts.tv_nsec / 1000));
+#elif UDS_SYS == UDS_SYS_WINDOWS
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint32_t)(ts.tv_sec * 1000000LL + ts.tv_nsec / 1000);
+#elif UDS_SYS == UDS_SYS_ARDUINO
+    return micros();
+#elif UDS_SYS == UDS_SYS_ESP32
+    return (uint32_t)esp_timer_get_time();
+#elif UDS_SYS == UDS_SYS_RTT
+#if defined(RT_USING_KTIME)
+    struct timeval tv;
+    rt_ktime_boottime_get_us(&tv);
+    return (uint32_t)((tv.tv_sec * 1000000LL) + tv.tv_usec);
+#else
+    return (uint32_t)((rt_uint64_t)rt_tick_get() * 1000000 / RT_TICK_PER_SECOND);
+#endif
+#else
+#error "UDSMicros() undefined!"
+#endif
+}
+#endif
+
 /**
  * @brief Check if a security level is reserved per ISO14229-1:2020 Table 42
  *
@@ -49,6 +80,7 @@ bool UDSSecurityAccessLevelIsReserved(uint8_t subFunction) {
     return false;
 }
 
+#if UDS_CONFIG_STRINGS
 const char *UDSErrToStr(UDSErr_t err) {
     switch (err) {
     case UDS_OK:
@@ -237,6 +269,12 @@ const char *UDSEventToStr(UDSEvent_t evt) {
         return "UDS_EVT_DoScheduledReset";
     case UDS_EVT_RequestFileTransfer:
         return "UDS_EVT_RequestFileTransfer";
+    case UDS_EVT_TransferCheckpoint:
+        return "UDS_EVT_TransferCheckpoint";
+    case UDS_EVT_Authentication:
+        return "UDS_EVT_Authentication";
+    case UDS_EVT_AccessTimingParam:
+        return "UDS_EVT_AccessTimingParam";
     case UDS_EVT_Poll:
         return "UDS_EVT_Poll";
     case UDS_EVT_SendComplete:
@@ -245,6 +283,12 @@ const char *UDSEventToStr(UDSEvent_t evt) {
         return "UDS_EVT_ResponseReceived";
     case UDS_EVT_Idle:
         return "UDS_EVT_Idle";
+    case UDS_EVT_DownloadComplete:
+        return "UDS_EVT_DownloadComplete";
+    case UDS_EVT_UploadComplete:
+        return "UDS_EVT_UploadComplete";
+    case UDS_EVT_FunctionalResponse:
+        return "UDS_EVT_FunctionalResponse";
     case UDS_EVT_MAX:
         return "UDS_EVT_MAX";
     default:
@@ -252,6 +296,89 @@ const char *UDSEventToStr(UDSEvent_t evt) {
     }
 }
 
+const char *UDSSIDToStr(uint8_t sid) {
+    // a response SID names the service of its request
+    if (sid != 0x7F && (sid & 0x40)) {
+        sid = (uint8_t)(sid & ~0x40);
+    }
+    switch (sid) {
+    case kSID_DIAGNOSTIC_SESSION_CONTROL:
+        return "DiagnosticSessionControl";
+    case kSID_ECU_RESET:
+        return "ECUReset";
+    case kSID_CLEAR_DIAGNOSTIC_INFORMATION:
+        return "ClearDiagnosticInformation";
+    case kSID_READ_DTC_INFORMATION:
+        return "ReadDTCInformation";
+    case kSID_READ_DATA_BY_IDENTIFIER:
+        return "ReadDataByIdentifier";
+    case kSID_READ_MEMORY_BY_ADDRESS:
+        return "ReadMemoryByAddress";
+    case kSID_READ_SCALING_DATA_BY_IDENTIFIER:
+        return "ReadScalingDataByIdentifier";
+    case kSID_SECURITY_ACCESS:
+        return "SecurityAccess";
+    case kSID_COMMUNICATION_CONTROL:
+        return "CommunicationControl";
+    case kSID_AUTHENTICATION:
+        return "Authentication";
+    case kSID_READ_PERIODIC_DATA_BY_IDENTIFIER:
+        return "ReadPeriodicDataByIdentifier";
+    case kSID_DYNAMICALLY_DEFINE_DATA_IDENTIFIER:
+        return "DynamicallyDefineDataIdentifier";
+    case kSID_WRITE_DATA_BY_IDENTIFIER:
+        return "WriteDataByIdentifier";
+    case kSID_IO_CONTROL_BY_IDENTIFIER:
+        return "InputOutputControlByIdentifier";
+    case kSID_ROUTINE_CONTROL:
+        return "RoutineControl";
+    case kSID_REQUEST_DOWNLOAD:
+        return "RequestDownload";
+    case kSID_REQUEST_UPLOAD:
+        return "RequestUpload";
+    case kSID_TRANSFER_DATA:
+        return "TransferData";
+    case kSID_REQUEST_TRANSFER_EXIT:
+        return "RequestTransferExit";
+    case kSID_REQUEST_FILE_TRANSFER:
+        return "RequestFileTransfer";
+    case kSID_WRITE_MEMORY_BY_ADDRESS:
+        return "WriteMemoryByAddress";
+    case kSID_TESTER_PRESENT:
+        return "TesterPresent";
+    case kSID_ACCESS_TIMING_PARAMETER:
+        return "AccessTimingParameter";
+    case kSID_SECURED_DATA_TRANSMISSION:
+        return "SecuredDataTransmission";
+    case kSID_CONTROL_DTC_SETTING:
+        return "ControlDTCSetting";
+    case kSID_RESPONSE_ON_EVENT:
+        return "ResponseOnEvent";
+    case kSID_LINK_CONTROL:
+        return "LinkControl";
+    case 0x7F:
+        return "NegativeResponse";
+    default:
+        return "unknown";
+    }
+}
+#else
+const char *UDSErrToStr(UDSErr_t err) {
+    (void)err;
+    return "";
+}
+
+const char *UDSEventToStr(UDSEvent_t evt) {
+    (void)evt;
+    return "";
+}
+
+const char *UDSSIDToStr(uint8_t sid) {
+    (void)sid;
+    return "";
+}
+#endif
+
 bool UDSErrIsNRC(UDSErr_t err) {
     switch (err) {
     case UDS_PositiveResponse:
@@ -319,3 +446,38 @@ bool UDSErrIsNRC(UDSErr_t err) {
         return false;
     }
 }
+
+#if defined(__ARM_FEATURE_CRC32) && !defined(__ARM_BIG_ENDIAN)
+#include <arm_acle.h>
+
+uint32_t UDSCRC32(uint32_t crc, const void *data, size_t len) {
+    // ARMv8 CRC32 instructions use the same polynomial, four bytes per instruction
+    const uint8_t *p = data;
+    crc = ~crc;
+    for (; len >= 4; p += 4, len -= 4) {
+        uint32_t word;
+        memcpy(&word, p, sizeof(word));
+        crc = __crc32w(crc, word);
+    }
+    for (; len > 0; p++, len--) {
+        crc = __crc32b(crc, *p);
+    }
+    return ~crc;
+}
+#else
+uint32_t UDSCRC32(uint32_t crc, const void *data, size_t len) {
+    // one table lookup per nibble keeps the table at 64 bytes
+    static const uint32_t table[16] = {
+        0x00000000U, 0x1DB71064U, 0x3B6E20C8U, 0x26D930ACU, 0x76DC4190U, 0x6B6B51F4U,
+        0x4DB26158U, 0x5005713CU, 0xEDB88320U, 0xF00F9344U, 0xD6D6A3E8U, 0xCB61B38CU,
+        0x9B64C2B0U, 0x86D3D2D4U, 0xA00AE278U, 0xBDBDF21CU,
+    };
+    const uint8_t *p = data;
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc = table[(crc ^ p[i]) & 0x0F] ^ (crc >> 4);
+        crc = table[(crc ^ (p[i] >> 4)) & 0x0F] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+#endif
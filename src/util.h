@@ -12,14 +12,39 @@
 /* returns true if `a` is after `b` */
 static inline bool UDSTimeAfter(uint32_t a, uint32_t b) { return (int32_t)(a - b) > 0; }
 
+/* returns the number of milliseconds from `now` until UDSTimeAfter(now, deadline) becomes true */
+static inline uint32_t UDSMillisUntil(uint32_t now, uint32_t deadline) {
+    return UDSTimeAfter(now, deadline) ? 0 : deadline - now + 1;
+}
+
 /**
  * @brief Get time in milliseconds
  * @return current time in milliseconds
  */
 uint32_t UDSMillis(void);
 
+/**
+ * @brief Get time in microseconds, for ISO-TP STmin and N_Bs/N_Cr timing
+ * @return current time in microseconds. Wraps around every 71 minutes, compare with
+ * UDSTimeAfter()
+ * @note follows UDSMillis() at millisecond resolution when UDS_CUSTOM_MILLIS is set, unless
+ * UDS_CUSTOM_MICROS is also set
+ */
+uint32_t UDSMicros(void);
+
 bool UDSSecurityAccessLevelIsReserved(uint8_t securityLevel);
 bool UDSErrIsNRC(UDSErr_t err);
 
+/**
+ * @brief Names of error codes, events and services. Empty strings unless UDS_CONFIG_STRINGS is set
+ */
 const char *UDSErrToStr(UDSErr_t err);
 const char *UDSEventToStr(UDSEvent_t evt);
+const char *UDSSIDToStr(uint8_t sid); /**< a response SID names the service of its request */
+
+/**
+ * @brief Update a CRC-32 (IEEE 802.3, as used by zlib) with `len` bytes
+ * @param crc 0 to start, or the value returned for the preceding bytes
+ * @return the CRC of all bytes so far
+ */
+uint32_t UDSCRC32(uint32_t crc, const void *data, size_t len);
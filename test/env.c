@@ -117,35 +117,88 @@ void MockServerPoll(MockServer_t *srv) {
     }
 }
 
-void EnvRunMillis(Env_t *env, uint32_t millis) {
-    uint32_t end = UDSMillis() + millis;
-    while (UDSMillis() < end) {
-        if (env->do_not_poll) {
-            ;
-        } else {
-            if (env->server) {
-                UDSServerPoll(env->server);
-            }
-            if (env->server_tp) {
-                UDSTpPoll(env->server_tp);
-            }
-            if (env->client) {
-                UDSClientPoll(env->client);
-            }
-            if (env->client_tp) {
-                UDSTpPoll(env->client_tp);
-            }
-            if (env->mock_server) {
-                MockServerPoll(env->mock_server);
-            }
+static uint32_t MockServerNextDeadlineMs(MockServer_t *srv) {
+    struct MockServerImpl *impl = srv->impl;
+    uint32_t ms = UDS_NO_DEADLINE;
+    for (int i = 0; i < impl->num_events; i++) {
+        uint32_t until = UDSTimeAfter(impl->events[i].time_ms, UDSMillis())
+                             ? impl->events[i].time_ms - UDSMillis()
+                             : 0;
+        ms = until < ms ? until : ms;
+    }
+    return ms;
+}
+
+static uint32_t EnvNextDeadlineMs(Env_t *env) {
+#if defined(UDS_TP_ISOTP_MOCK)
+    uint32_t ms = ISOTPMockNextDeadlineMs();
+#else
+    uint32_t ms = 1; // other transports are polled every millisecond
+#endif
+    if (env->server) {
+        uint32_t srv_ms = UDSServerNextDeadlineMs(env->server);
+        ms = srv_ms < ms ? srv_ms : ms;
+    }
+    if (env->client) {
+        uint32_t client_ms = UDSClientNextDeadlineMs(env->client);
+        ms = client_ms < ms ? client_ms : ms;
+    }
+    if (env->mock_server) {
+        uint32_t mock_ms = MockServerNextDeadlineMs(env->mock_server);
+        ms = mock_ms < ms ? mock_ms : ms;
+    }
+    if (env->router) {
+        uint32_t router_ms = UDSRouterNextDeadlineMs(env->router);
+        ms = router_ms < ms ? router_ms : ms;
+    }
+    return ms;
+}
+
+void EnvStep(Env_t *env, uint32_t max_ms) {
+    if (env->do_not_poll) {
+        ;
+    } else {
+        if (env->server) {
+            UDSServerPoll(env->server);
+        }
+        if (env->server_tp) {
+            UDSTpPoll(env->server_tp);
+        }
+        if (env->client) {
+            UDSClientPoll(env->client);
         }
-        if (env->is_real_time) {
+        if (env->client_tp) {
+            UDSTpPoll(env->client_tp);
+        }
+        if (env->mock_server) {
+            MockServerPoll(env->mock_server);
+        }
+        if (env->router) {
+            UDSRouterPoll(env->router);
+        }
+        env->polls++;
+    }
+    if (env->is_real_time) {
 #ifdef _WIN32
-            Sleep(1);
+        Sleep(1);
 #else
-            usleep(1000);
+        usleep(1000);
 #endif
-        }
-        TimeNowMillis++;
+    }
+
+    uint32_t step = 1;
+    if (env->event_driven && !env->is_real_time) {
+        // nothing changes between deadlines, so time is moved straight to the next one
+        step = env->do_not_poll ? max_ms : EnvNextDeadlineMs(env);
+        step = step ? step : 1;
+    }
+    step = step < max_ms ? step : max_ms;
+    TimeNowMillis += step ? step : 1;
+}
+
+void EnvRunMillis(Env_t *env, uint32_t millis) {
+    uint32_t end = UDSMillis() + millis;
+    while (UDSTimeAfter(end, UDSMillis())) {
+        EnvStep(env, end - UDSMillis());
     }
 }
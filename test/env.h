@@ -50,15 +50,23 @@ typedef struct {
     MockServer_t *mock_server;
     UDSTp_t *server_tp;
     UDSTp_t *client_tp;
+    UDSRouter_t *router;
 
     bool is_real_time; // if true, EnvRunMillis will run for a wall-time duration rather than
                        // simulated time. This makes tests much slower, so use it only when
                        // necessary.
     bool do_not_poll; // if true, EnvRunMillis will not poll any objects
+    bool event_driven; // if true, time jumps from one deadline of the polled objects and the mock
+                       // network to the next instead of moving 1 ms per poll. Requires
+                       // ISOTPMock transports.
+    uint64_t polls;    // number of times the objects have been polled
 } Env_t;
 
 void EnvRunMillis(Env_t *env, uint32_t millis);
 
+// Poll once, then advance time to the next deadline (1 ms unless event_driven), at most max_ms
+void EnvStep(Env_t *env, uint32_t max_ms);
+
 #define _TEST_INT_COND(a, b, cond)                                                                 \
     {                                                                                              \
         int _a = a;                                                                                \
@@ -133,7 +141,7 @@ void EnvRunMillis(Env_t *env, uint32_t millis);
     {                                                                                              \
         uint32_t deadline = UDSMillis() + timeout_ms + 1;                                          \
         while (!(cond)) {                                                                          \
-            EnvRunMillis(env, 1);                                                                      \
+            EnvStep(env, deadline - UDSMillis());                                                  \
             TEST_INT_LE(UDSMillis(), deadline);                                                    \
         }                                                                                          \
     }
@@ -144,7 +152,7 @@ void EnvRunMillis(Env_t *env, uint32_t millis);
         uint32_t deadline = UDSMillis() + duration;                                                \
         while (UDSTimeAfter(deadline, UDSMillis())) {                                              \
             assert_true(cond);                                                                     \
-            EnvRunMillis(env, 1);                                                                      \
+            EnvStep(env, deadline - UDSMillis());                                                  \
         }                                                                                          \
     }
 
@@ -158,11 +166,11 @@ void EnvRunMillis(Env_t *env, uint32_t millis);
         uint32_t post_deadline = UDSMillis() + (int)((duration) * (1.0f + tolerance));             \
         while (UDSTimeAfter(pre_deadline, UDSMillis())) {                                          \
             assert_true(!(cond));                                                                  \
-            EnvRunMillis(env, 1);                                                                      \
+            EnvStep(env, pre_deadline - UDSMillis());                                              \
         }                                                                                          \
         while (!(cond)) {                                                                          \
             TEST_INT_LE(UDSMillis(), post_deadline);                                               \
-            EnvRunMillis(env, 1);                                                                      \
+            EnvStep(env, post_deadline + 1 - UDSMillis());                                         \
         }                                                                                          \
     }
 
@@ -0,0 +1,121 @@
+#include "test/env.h"
+#include <pthread.h>
+#include <sched.h>
+
+static UDSCANRing_t ring;
+
+typedef struct {
+    uint32_t next_id; /* id expected in the next frame */
+    size_t count;     /* frames seen */
+    bool in_order;    /* every frame carried the expected id and payload */
+} Sink_t;
+
+static void Collect(void *ctx, const UDSCANFrame_t *frame) {
+    Sink_t *sink = ctx;
+    if (frame->id != sink->next_id || frame->len != 4 ||
+        memcmp(frame->data, &sink->next_id, sizeof(sink->next_id))) {
+        sink->in_order = false;
+    }
+    sink->next_id++;
+    sink->count++;
+}
+
+static void Push(uint32_t id) { UDSCANRingPush(&ring, id, (const uint8_t *)&id, sizeof(id)); }
+
+int Setup(void **state) {
+    UDSCANRingInit(&ring);
+    return 0;
+}
+
+int Teardown(void **state) { return 0; }
+
+void test_drain_in_order(void **state) {
+    Sink_t sink = {.in_order = true};
+    for (uint32_t i = 0; i < 5; i++) {
+        Push(i);
+    }
+    TEST_INT_EQUAL(UDSCANRingCount(&ring), 5);
+
+    // frames should come out in the order they were pushed, in batches of at most `max`
+    TEST_INT_EQUAL(UDSCANRingDrain(&ring, Collect, &sink, 2), 2);
+    TEST_INT_EQUAL(UDSCANRingDrain(&ring, Collect, &sink, 0), 3);
+    TEST_INT_EQUAL(UDSCANRingDrain(&ring, Collect, &sink, 0), 0);
+    TEST_INT_EQUAL(sink.count, 5);
+    TEST_INT_EQUAL(sink.in_order, true);
+    TEST_INT_EQUAL(ring.peak, 5);
+}
+
+void test_full_ring_counts_drops(void **state) {
+    Sink_t sink = {.in_order = true};
+
+    // a full ring should reject frames without overwriting the oldest
+    for (uint32_t i = 0; i < UDS_CAN_RING_SIZE + 3; i++) {
+        Push(i);
+    }
+    TEST_INT_EQUAL(ring.dropped, 3);
+    TEST_INT_EQUAL(UDSCANRingCount(&ring), UDS_CAN_RING_SIZE);
+    TEST_INT_EQUAL(UDSCANRingDrain(&ring, Collect, &sink, 0), UDS_CAN_RING_SIZE);
+    TEST_INT_EQUAL(sink.in_order, true);
+
+    // frames longer than a slot should be rejected
+    uint8_t big[UDS_CAN_RING_FRAME_LEN + 1] = {0};
+    TEST_INT_EQUAL(UDSCANRingPush(&ring, 0x7E0, big, sizeof(big)), false);
+    TEST_INT_EQUAL(ring.invalid, 1);
+    TEST_INT_EQUAL(UDSCANRingCount(&ring), 0);
+}
+
+void test_indices_wrap(void **state) {
+    Sink_t sink = {.next_id = 0, .in_order = true};
+
+    // free-running indices should keep working across the 32-bit wrap
+    ring.head = ring.tail = UINT32_MAX - 2;
+    for (uint32_t i = 0; i < 6; i++) {
+        Push(i);
+    }
+    TEST_INT_EQUAL(UDSCANRingCount(&ring), 6);
+    TEST_INT_EQUAL(UDSCANRingDrain(&ring, Collect, &sink, 0), 6);
+    TEST_INT_EQUAL(sink.in_order, true);
+    TEST_INT_EQUAL(ring.tail, 3);
+}
+
+#define STRESS_FRAMES 200000
+
+static void *Producer(void *arg) {
+    (void)arg;
+    for (uint32_t i = 0; i < STRESS_FRAMES; i++) {
+        while (!UDSCANRingPush(&ring, i, (const uint8_t *)&i, sizeof(i))) {
+            sched_yield(); // wait for the consumer to free a slot
+        }
+    }
+    return NULL;
+}
+
+void test_concurrent_producer(void **state) {
+    Sink_t sink = {.in_order = true};
+    pthread_t producer;
+
+    // every frame pushed from another thread should be drained exactly once and in order
+    pthread_create(&producer, NULL, Producer, NULL);
+    while (sink.count < STRESS_FRAMES) {
+        if (0 == UDSCANRingDrain(&ring, Collect, &sink, 0)) {
+            sched_yield();
+        }
+    }
+    pthread_join(producer, NULL);
+    TEST_INT_EQUAL(sink.count, STRESS_FRAMES);
+    TEST_INT_EQUAL(sink.in_order, true);
+    TEST_INT_LE(ring.peak, UDS_CAN_RING_SIZE);
+}
+
+int main(int ac, char **av) {
+    if (ac > 1) {
+        cmocka_set_test_filter(av[1]);
+    }
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_drain_in_order, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_full_ring_counts_drops, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_indices_wrap, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_concurrent_producer, Setup, Teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
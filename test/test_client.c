@@ -3,6 +3,7 @@
 int Setup(void **state) {
     Env_t *env = malloc(sizeof(Env_t));
     memset(env, 0, sizeof(Env_t));
+    env->event_driven = true;
     env->client = malloc(sizeof(UDSClient_t));
     UDSClientInit(env->client);
     env->client->tp = ISOTPMockNew("client", &(ISOTPMockArgs_t){.sa_phys = 0x7E8,
@@ -40,6 +41,7 @@ int fn_test_poll_events(UDSClient_t *client, UDSEvent_t evt, void *ev_data) {
 void test_poll_events(void **state) {
     Env_t *e = *state;
     int count = 0;
+    e->event_driven = false; // one poll per millisecond
     e->client->fn = fn_test_poll_events;
     e->client->fn_data = &count;
     EnvRunMillis(e, 1000);
@@ -75,6 +77,24 @@ int fn_log_call_count(UDSClient_t *client, UDSEvent_t evt, void *ev_data) {
     return UDS_OK;
 }
 
+void test_next_deadline(void **state) {
+    Env_t *e = *state;
+    int call_count[UDS_EVT_MAX] = {0};
+    e->client->fn = fn_log_call_count;
+    e->client->fn_data = call_count;
+
+    // an idle client has nothing to wait for
+    TEST_INT_EQUAL(UDSClientNextDeadlineMs(e->client), UDS_NO_DEADLINE);
+
+    // once the request has been sent, the deadline is the p2 timeout
+    UDSSendECUReset(e->client, UDS_LEV_RT_HR);
+    e->do_not_poll = true;
+    UDSClientPoll(e->client);
+    TEST_INT_EQUAL(UDSClientNextDeadlineMs(e->client), e->client->p2_ms + 1);
+    EnvRunMillis(e, 10);
+    TEST_INT_EQUAL(UDSClientNextDeadlineMs(e->client), e->client->p2_ms + 1 - 10);
+}
+
 void test_0x11_good_response(void **state) {
     Env_t *e = *state;
     MockServerAddBehavior(e->mock_server, &(struct Behavior){.tag = ExactRequestResponse,
@@ -257,6 +277,201 @@ void test_0x11_suppress_pos_resp(void **state) {
     TEST_INT_EQUAL(call_count[UDS_EVT_Err], 0);
 }
 
+typedef struct {
+    int call_count[UDS_EVT_MAX];
+    uint32_t sa[4];
+    UDSErr_t err[4];
+} Collected_t;
+
+int fn_collect(UDSClient_t *client, UDSEvent_t evt, void *ev_data) {
+    Collected_t *c = (Collected_t *)client->fn_data;
+    if (UDS_EVT_FunctionalResponse == evt) {
+        UDSFunctionalResponse_t *resp = (UDSFunctionalResponse_t *)ev_data;
+        int i = c->call_count[evt];
+        if (i < 4) {
+            c->sa[i] = resp->A_SA;
+            c->err[i] = resp->err;
+        }
+    }
+    c->call_count[evt]++;
+    return UDS_OK;
+}
+
+void test_functional_collects_every_response(void **state) {
+    Env_t *e = *state;
+    Collected_t c = {0};
+    e->client->fn = fn_collect;
+    e->client->fn_data = &c;
+
+    // a second ECU answers on the client's own address, a third on another client-side link
+    UDSTp_t *ecu2 = ISOTPMockNew("ecu2", &(ISOTPMockArgs_t){.sa_phys = 0x7E1,
+                                                            .ta_phys = 0x7E8,
+                                                            .sa_func = UDS_TP_NOOP_ADDR,
+                                                            .ta_func = UDS_TP_NOOP_ADDR});
+    UDSTp_t *ecu3 = ISOTPMockNew("ecu3", &(ISOTPMockArgs_t){.sa_phys = 0x7E2,
+                                                            .ta_phys = 0x7E9,
+                                                            .sa_func = UDS_TP_NOOP_ADDR,
+                                                            .ta_func = UDS_TP_NOOP_ADDR});
+    UDSTp_t *link3 = ISOTPMockNew("link3", &(ISOTPMockArgs_t){.sa_phys = 0x7E9,
+                                                              .ta_phys = 0x7E2,
+                                                              .sa_func = UDS_TP_NOOP_ADDR,
+                                                              .ta_func = UDS_TP_NOOP_ADDR});
+    UDSTp_t *const links[] = {link3};
+    e->client->collect_tps = links;
+    e->client->collect_tps_len = 1;
+
+    MockServerAddBehavior(e->mock_server, &(struct Behavior){.tag = ExactRequestResponse,
+                                                             .exact_request_response = {
+                                                                 .req_data = {0x3E, 0x00},
+                                                                 .req_len = 2,
+                                                                 .resp_data = {0x7E, 0x00},
+                                                                 .resp_len = 2,
+                                                                 .delay_ms = 5,
+                                                             }});
+
+    // when a functional request is sent with UDS_COLLECT_RESPONSES
+    e->client->options |= UDS_FUNCTIONAL | UDS_COLLECT_RESPONSES;
+    UDSSendTesterPresent(e->client);
+    EnvRunMillis(e, 2);
+    const uint8_t RCRRP[] = {0x7F, 0x3E, 0x78};
+    const uint8_t NRC[] = {0x7F, 0x3E, 0x22};
+    UDSTpSend(ecu2, RCRRP, sizeof(RCRRP), NULL);
+    EnvRunMillis(e, 1);
+    UDSTpSend(ecu3, NRC, sizeof(NRC), NULL);
+    EnvRunMillis(e, 10);
+
+    // every response should be delivered with its source address
+    TEST_INT_EQUAL(c.call_count[UDS_EVT_FunctionalResponse], 2);
+    TEST_INT_EQUAL(c.sa[0], 0x7E2);
+    TEST_INT_EQUAL(c.err[0], UDS_NRC_ConditionsNotCorrect);
+    TEST_INT_EQUAL(c.sa[1], 0x7E0);
+    TEST_INT_EQUAL(c.err[1], UDS_OK);
+
+    // and the 0x78 should keep the window open past p2
+    EnvRunMillis(e, e->client->p2_ms + 10);
+    TEST_INT_EQUAL(c.call_count[UDS_EVT_Idle], 0);
+    const uint8_t POSITIVE_RESPONSE[] = {0x7E, 0x00};
+    UDSTpSend(ecu2, POSITIVE_RESPONSE, sizeof(POSITIVE_RESPONSE), NULL);
+    EnvRunMillis(e, e->client->p2_star_ms);
+
+    TEST_INT_EQUAL(c.call_count[UDS_EVT_FunctionalResponse], 3);
+    TEST_INT_EQUAL(c.sa[2], 0x7E1);
+    TEST_INT_EQUAL(c.err[2], UDS_OK);
+    TEST_INT_EQUAL(e->client->collected, 3);
+    TEST_INT_EQUAL(c.call_count[UDS_EVT_Idle], 1);
+    TEST_INT_EQUAL(c.call_count[UDS_EVT_ResponseReceived], 0);
+    TEST_INT_EQUAL(c.call_count[UDS_EVT_Err], 0);
+
+    ISOTPMockFree(ecu2);
+    ISOTPMockFree(ecu3);
+    ISOTPMockFree(link3);
+}
+
+typedef struct {
+    int done;
+    UDSErr_t err[4];
+    uint8_t resp_sid[4];
+    int idle_polls; // polls that ended with requests queued but none in flight
+} QueueLog_t;
+
+int fn_queue(UDSClient_t *client, UDSEvent_t evt, void *ev_data) {
+    QueueLog_t *log = (QueueLog_t *)client->fn_data;
+    if (UDS_EVT_Poll == evt && client->queue_len > 0 && !client->queue_active) {
+        log->idle_polls++;
+    }
+    return UDS_OK;
+}
+
+void queue_done(UDSClient_t *client, UDSErr_t err, void *ctx) {
+    QueueLog_t *log = (QueueLog_t *)ctx;
+    if (log->done < 4) {
+        log->err[log->done] = err;
+        log->resp_sid[log->done] = client->recv_size ? client->recv_buf[0] : 0;
+    }
+    log->done++;
+}
+
+void test_queue_sends_back_to_back(void **state) {
+    Env_t *e = *state;
+    QueueLog_t log = {0};
+    e->client->fn = fn_queue;
+    e->client->fn_data = &log;
+    MockServerAddBehavior(e->mock_server, &(struct Behavior){.tag = ExactRequestResponse,
+                                                             .exact_request_response = {
+                                                                 .req_data = {0x3E, 0x00},
+                                                                 .req_len = 2,
+                                                                 .resp_data = {0x7E, 0x00},
+                                                                 .resp_len = 2,
+                                                                 .delay_ms = 5,
+                                                             }});
+    MockServerAddBehavior(e->mock_server, &(struct Behavior){.tag = ExactRequestResponse,
+                                                             .exact_request_response = {
+                                                                 .req_data = {0x11, 0x01},
+                                                                 .req_len = 2,
+                                                                 .resp_data = {0x7F, 0x11, 0x22},
+                                                                 .resp_len = 3,
+                                                                 .delay_ms = 5,
+                                                             }});
+    MockServerAddBehavior(e->mock_server, &(struct Behavior){.tag = ExactRequestResponse,
+                                                             .exact_request_response = {
+                                                                 .req_data = {0x10, 0x03},
+                                                                 .req_len = 2,
+                                                                 .resp_data = {0x50, 0x03},
+                                                                 .resp_len = 2,
+                                                                 .delay_ms = 50,
+                                                             }});
+
+    const uint8_t TESTER_PRESENT[] = {0x3E, 0x00};
+    const uint8_t ECU_RESET[] = {0x11, 0x01};
+    const uint8_t DSC[] = {0x10, 0x03};
+
+    // when several requests are submitted at once
+    UDSClientRequest_t req = {.data = TESTER_PRESENT, .len = 2, .done = queue_done, .ctx = &log};
+    TEST_ERR_EQUAL(UDSClientSubmit(e->client, &req), UDS_OK);
+    req.data = ECU_RESET;
+    TEST_ERR_EQUAL(UDSClientSubmit(e->client, &req), UDS_OK);
+    req.data = DSC;
+    req.p2_ms = 20; // shorter than the server takes
+    TEST_ERR_EQUAL(UDSClientSubmit(e->client, &req), UDS_OK);
+    req.data = TESTER_PRESENT;
+    req.p2_ms = 0;
+    TEST_ERR_EQUAL(UDSClientSubmit(e->client, &req), UDS_OK);
+
+    // the first one should be sent right away while the others wait
+    TEST_INT_EQUAL(e->client->queue_len, 4);
+    TEST_INT_EQUAL(e->client->queue_active, true);
+    TEST_INT_EQUAL(UDSSendTesterPresent(e->client), UDS_ERR_BUSY);
+
+    EnvRunMillis(e, 1000);
+
+    // each should complete in order with its own result and timeout
+    TEST_INT_EQUAL(log.done, 4);
+    TEST_ERR_EQUAL(log.err[0], UDS_OK);
+    TEST_INT_EQUAL(log.resp_sid[0], 0x7E);
+    TEST_ERR_EQUAL(log.err[1], UDS_NRC_ConditionsNotCorrect);
+    TEST_ERR_EQUAL(log.err[2], UDS_ERR_TIMEOUT);
+    TEST_ERR_EQUAL(log.err[3], UDS_OK);
+    TEST_INT_EQUAL(e->client->queue_len, 0);
+
+    // and the next request should go out in the same poll that ended the previous one
+    TEST_INT_EQUAL(log.idle_polls, 0);
+}
+
+void test_queue_full(void **state) {
+    Env_t *e = *state;
+    QueueLog_t log = {0};
+    e->client->fn = fn_queue;
+    e->client->fn_data = &log;
+    const uint8_t TESTER_PRESENT[] = {0x3E, 0x00};
+    UDSClientRequest_t req = {.data = TESTER_PRESENT, .len = 2};
+    for (int i = 0; i < UDS_CLIENT_QUEUE_LEN; i++) {
+        TEST_ERR_EQUAL(UDSClientSubmit(e->client, &req), UDS_OK);
+    }
+    TEST_ERR_EQUAL(UDSClientSubmit(e->client, &req), UDS_ERR_BUSY);
+    req.len = 0;
+    TEST_ERR_EQUAL(UDSClientSubmit(e->client, &req), UDS_ERR_INVALID_ARG);
+}
+
 void test_0x22_unpack_rdbi_response(void **state) {
     Env_t *e = *state;
     int call_count[UDS_EVT_MAX] = {0};
@@ -288,6 +503,200 @@ void test_0x22_unpack_rdbi_response(void **state) {
     TEST_INT_EQUAL(var, 0x0a);
 }
 
+typedef struct {
+    uint16_t speed;
+    uint8_t vin[17];
+    uint8_t sw[10];
+    uint32_t odo;
+    uint8_t flags;
+} Vehicle_t;
+
+static const UDSRDBISchemaEntry_t VEHICLE_SCHEMA[] = {
+    {0x0100, 2, offsetof(Vehicle_t, speed), NULL},
+    {0xF190, 17, offsetof(Vehicle_t, vin), NULL},
+    {0xF195, 10, offsetof(Vehicle_t, sw), NULL},
+    {0x0200, 4, offsetof(Vehicle_t, odo), NULL},
+    {0x0300, 1, offsetof(Vehicle_t, flags), NULL},
+};
+
+static void plan_done(UDSClient_t *client, UDSRDBIPlan_t *plan) { (*(int *)plan->ctx)++; }
+
+void test_0x22_plan_packs_requests(void **state) {
+    Env_t *e = *state;
+    int call_count[UDS_EVT_MAX] = {0};
+    e->client->fn = fn_log_call_count;
+    e->client->fn_data = call_count;
+
+    // a server that sends at most 32 byte responses
+    MockServerAddBehavior(e->mock_server,
+                          &(struct Behavior){.tag = ExactRequestResponse,
+                                             .exact_request_response = {
+                                                 .req_data = {0x22, 0x01, 0x00, 0xF1, 0x90},
+                                                 .req_len = 5,
+                                                 .resp_data = {0x62, 0x01, 0x00, 0x34, 0x12,
+                                                               0xF1, 0x90, 'W',  'D',  'F',
+                                                               'K',  '0',  '0',  '0',  '0',
+                                                               '0',  '0',  '0',  '0',  '0',
+                                                               '0',  '0',  '0',  '1'},
+                                                 .resp_len = 24,
+                                             }});
+    MockServerAddBehavior(e->mock_server,
+                          &(struct Behavior){.tag = ExactRequestResponse,
+                                             .exact_request_response = {
+                                                 .req_data = {0x22, 0xF1, 0x95, 0x02, 0x00, 0x03,
+                                                              0x00},
+                                                 .req_len = 7,
+                                                 .resp_data = {0x62, 0xF1, 0x95, 'v',  '1',  '.',
+                                                               '2',  '.',  '3',  0,    0,    0,
+                                                               0,    0x02, 0x00, 0x78, 0x56, 0x34,
+                                                               0x12, 0x03, 0x00, 0xA5},
+                                                 .resp_len = 22,
+                                             }});
+
+    // when a schema is read through a plan
+    Vehicle_t v = {0};
+    UDSRDBIPlan_t plan;
+    int done = 0;
+    EXPECT_OK(UDSRDBIPlanInit(&plan, VEHICLE_SCHEMA, 5, &v, 32));
+    plan.done = plan_done;
+    plan.ctx = &done;
+
+    // it should take the fewest requests that fit the response size
+    TEST_INT_EQUAL(plan.requests, 2);
+    EXPECT_OK(UDSRDBIPlanStart(e->client, &plan));
+    EnvRunMillis(e, 100);
+
+    // and decode every DID into the struct
+    TEST_INT_EQUAL(done, 1);
+    TEST_ERR_EQUAL(plan.err, UDS_OK);
+    TEST_INT_EQUAL(plan.decoded, 5);
+    TEST_INT_EQUAL(v.speed, 0x1234);
+    TEST_MEMORY_EQUAL(v.vin, "WDFK0000000000001", 17);
+    TEST_MEMORY_EQUAL(v.sw, "v1.2.3\0\0\0\0", 10);
+    TEST_INT_EQUAL(v.odo, 0x12345678);
+    TEST_INT_EQUAL(v.flags, 0xA5);
+    TEST_INT_EQUAL(call_count[UDS_EVT_Err], 0);
+}
+
+void test_0x22_plan_continues_after_failure(void **state) {
+    Env_t *e = *state;
+    int call_count[UDS_EVT_MAX] = {0};
+    e->client->fn = fn_log_call_count;
+    e->client->fn_data = call_count;
+    MockServerAddBehavior(e->mock_server, &(struct Behavior){.tag = ExactRequestResponse,
+                                                             .exact_request_response = {
+                                                                 .req_data = {0x22, 0x01, 0x00},
+                                                                 .req_len = 3,
+                                                                 .resp_data = {0x7F, 0x22, 0x31},
+                                                                 .resp_len = 3,
+                                                             }});
+    MockServerAddBehavior(e->mock_server, &(struct Behavior){.tag = ExactRequestResponse,
+                                                             .exact_request_response = {
+                                                                 .req_data = {0x22, 0x03, 0x00},
+                                                                 .req_len = 3,
+                                                                 .resp_data = {0x62, 0x03, 0x00,
+                                                                               0x5A},
+                                                                 .resp_len = 4,
+                                                             }});
+
+    // with room for one DID per response
+    const UDSRDBISchemaEntry_t schema[] = {VEHICLE_SCHEMA[0], VEHICLE_SCHEMA[4]};
+    Vehicle_t v = {0};
+    UDSRDBIPlan_t plan;
+    EXPECT_OK(UDSRDBIPlanInit(&plan, schema, 2, &v, 5));
+    TEST_INT_EQUAL(plan.requests, 2);
+
+    // a DID that does not fit at all should be refused up front
+    TEST_ERR_EQUAL(UDSRDBIPlanInit(&plan, VEHICLE_SCHEMA, 5, &v, 5), UDS_ERR_BUFSIZ);
+
+    // a rejected request should not stop the next one
+    EXPECT_OK(UDSRDBIPlanInit(&plan, schema, 2, &v, 5));
+    EXPECT_OK(UDSRDBIPlanStart(e->client, &plan));
+    EnvRunMillis(e, 100);
+    TEST_ERR_EQUAL(plan.err, UDS_NRC_RequestOutOfRange);
+    TEST_INT_EQUAL(plan.decoded, 1);
+    TEST_INT_EQUAL(v.flags, 0x5A);
+}
+
+static const UDSDIDCachePolicy_t CACHE_POLICIES[] = {
+    {0xF190, 4, UDS_DID_CACHE_STATIC},
+    {0x0100, 2, 500},
+};
+
+static void Respond(MockServer_t *srv, const uint8_t *req, size_t req_len, const uint8_t *resp,
+                    size_t resp_len) {
+    struct Behavior b = {.tag = ExactRequestResponse};
+    memcpy(b.exact_request_response.req_data, req, req_len);
+    b.exact_request_response.req_len = req_len;
+    memcpy(b.exact_request_response.resp_data, resp, resp_len);
+    b.exact_request_response.resp_len = resp_len;
+    MockServerAddBehavior(srv, &b);
+}
+
+void test_0x22_did_cache(void **state) {
+    Env_t *e = *state;
+    int call_count[UDS_EVT_MAX] = {0};
+    e->client->fn = fn_log_call_count;
+    e->client->fn_data = call_count;
+    const uint8_t RDBI_REQ[] = {0x22, 0xF1, 0x90, 0x01, 0x00};
+    const uint8_t RDBI_RESP[] = {0x62, 0xF1, 0x90, 'W', 'D', 'F', 'K', 0x01, 0x00, 0x12, 0x34};
+    const uint8_t SESSION_REQ[] = {0x10, 0x03};
+    const uint8_t SESSION_RESP[] = {0x50, 0x03, 0x00, 0x32, 0x01, 0xF4};
+    const uint8_t WDBI_REQ[] = {0x2E, 0xF1, 0x90, 'A', 'B', 'C', 'D'};
+    const uint8_t WDBI_RESP[] = {0x6E, 0xF1, 0x90};
+    Respond(e->mock_server, RDBI_REQ, sizeof(RDBI_REQ), RDBI_RESP, sizeof(RDBI_RESP));
+    Respond(e->mock_server, SESSION_REQ, sizeof(SESSION_REQ), SESSION_RESP, sizeof(SESSION_RESP));
+    Respond(e->mock_server, WDBI_REQ, sizeof(WDBI_REQ), WDBI_RESP, sizeof(WDBI_RESP));
+    Respond(e->mock_server, (const uint8_t[]){0x11, 0x01}, 2, (const uint8_t[]){0x51, 0x01}, 2);
+
+    UDSDIDCache_t cache;
+    EXPECT_OK(UDSDIDCacheInit(&cache, CACHE_POLICIES, 2));
+    e->client->did_cache = &cache;
+    uint8_t vin[4] = {0};
+    uint16_t speed = 0;
+
+    // a cold cache should miss
+    TEST_INT_EQUAL(UDSDIDCacheRead(&cache, 0x7E0, 0xF190, vin, sizeof(vin)), UDS_FAIL);
+
+    // the records of an RDBI response should be cached under the address of the server
+    const uint16_t dids[] = {0xF190, 0x0100};
+    EXPECT_OK(UDSSendRDBI(e->client, dids, 2));
+    EnvRunMillis(e, 100);
+    EXPECT_OK(UDSDIDCacheRead(&cache, 0x7E0, 0xF190, vin, sizeof(vin)));
+    TEST_MEMORY_EQUAL(vin, "WDFK", 4);
+    EXPECT_OK(UDSDIDCacheRead(&cache, 0x7E0, 0x0100, &speed, sizeof(speed)));
+    TEST_INT_EQUAL(UDSDIDCacheRead(&cache, 0x7E1, 0xF190, vin, sizeof(vin)), UDS_FAIL);
+    TEST_INT_EQUAL(UDSDIDCacheRead(&cache, 0x7E0, 0xF190, vin, 3), UDS_ERR_BUFSIZ);
+
+    // a session change should drop volatile values only
+    EXPECT_OK(UDSSendDiagSessCtrl(e->client, 0x03));
+    EnvRunMillis(e, 100);
+    EXPECT_OK(UDSDIDCacheRead(&cache, 0x7E0, 0xF190, vin, sizeof(vin)));
+    TEST_INT_EQUAL(UDSDIDCacheRead(&cache, 0x7E0, 0x0100, &speed, sizeof(speed)), UDS_FAIL);
+
+    // volatile values should expire after their ttl
+    EXPECT_OK(UDSSendRDBI(e->client, dids, 2));
+    EnvRunMillis(e, 100);
+    EXPECT_OK(UDSDIDCacheRead(&cache, 0x7E0, 0x0100, &speed, sizeof(speed)));
+    EnvRunMillis(e, 500);
+    TEST_INT_EQUAL(UDSDIDCacheRead(&cache, 0x7E0, 0x0100, &speed, sizeof(speed)), UDS_FAIL);
+    EXPECT_OK(UDSDIDCacheRead(&cache, 0x7E0, 0xF190, vin, sizeof(vin)));
+
+    // a write should drop the value of that DID
+    EXPECT_OK(UDSSendWDBI(e->client, 0xF190, (const uint8_t *)"ABCD", 4));
+    EnvRunMillis(e, 100);
+    TEST_INT_EQUAL(UDSDIDCacheRead(&cache, 0x7E0, 0xF190, vin, sizeof(vin)), UDS_FAIL);
+
+    // and an ECU reset should drop static values too
+    EXPECT_OK(UDSSendRDBI(e->client, dids, 2));
+    EnvRunMillis(e, 100);
+    EXPECT_OK(UDSSendECUReset(e->client, 0x01));
+    EnvRunMillis(e, 100);
+    TEST_INT_EQUAL(UDSDIDCacheRead(&cache, 0x7E0, 0xF190, vin, sizeof(vin)), UDS_FAIL);
+    TEST_INT_EQUAL(cache.hits, 5);
+    TEST_INT_EQUAL(call_count[UDS_EVT_Err], 0);
+}
+
 void test_0x34_format(void **state) {
     Env_t *e = *state;
     UDSErr_t err = UDSSendRequestDownload(e->client, 0x11, 0x33, 0x602000, 0x00FFFF);
@@ -351,6 +760,436 @@ void test_0x2e_issue_59(void **state) {
     TEST_INT_EQUAL(call_count[UDS_EVT_Err], 1);
 }
 
+static const uint8_t DOWNLOAD_IMAGE[] = {0x00, 0x01, 0x02, 0x03, 0x04,
+                                         0x05, 0x06, 0x07, 0x08, 0x09};
+static const uint8_t BLOCK2_OK[] = {0x76, 0x02};
+
+// a server that accepts DOWNLOAD_IMAGE at 0x10 in blocks of 4 bytes
+static void AddDownloadBehaviors(Env_t *e, const uint8_t *block2_resp, size_t block2_resp_len) {
+    struct Behavior b[] = {
+        {.tag = ExactRequestResponse,
+         .exact_request_response = {.req_data = {0x34, 0x00, 0x11, 0x10, 0x0A},
+                                    .req_len = 5,
+                                    .resp_data = {0x74, 0x10, 0x06},
+                                    .resp_len = 3}},
+        {.tag = ExactRequestResponse,
+         .exact_request_response = {.req_data = {0x36, 0x01, 0x00, 0x01, 0x02, 0x03},
+                                    .req_len = 6,
+                                    .resp_data = {0x76, 0x01},
+                                    .resp_len = 2,
+                                    .delay_ms = 5}},
+        {.tag = ExactRequestResponse,
+         .exact_request_response = {.req_data = {0x36, 0x02, 0x04, 0x05, 0x06, 0x07},
+                                    .req_len = 6,
+                                    .resp_len = block2_resp_len,
+                                    .delay_ms = 20}},
+        {.tag = ExactRequestResponse,
+         .exact_request_response = {.req_data = {0x36, 0x03, 0x08, 0x09},
+                                    .req_len = 4,
+                                    .resp_data = {0x76, 0x03},
+                                    .resp_len = 2}},
+        {.tag = ExactRequestResponse,
+         .exact_request_response = {.req_data = {0x37},
+                                    .req_len = 1,
+                                    .resp_data = {0x77},
+                                    .resp_len = 1}},
+    };
+    memcpy(b[2].exact_request_response.resp_data, block2_resp, block2_resp_len);
+    for (size_t i = 0; i < sizeof(b) / sizeof(b[0]); i++) {
+        MockServerAddBehavior(e->mock_server, &b[i]);
+    }
+}
+
+void test_0x83_timings_follow_the_server(void **state) {
+    Env_t *e = *state;
+    MockServerAddBehavior(e->mock_server,
+                          &(struct Behavior){.tag = ExactRequestResponse,
+                                             .exact_request_response = {
+                                                 .req_data = {0x83, 0x04, 0x00, 0x14, 0x00, 0x32},
+                                                 .req_len = 6,
+                                                 .resp_data = {0xC3, 0x04},
+                                                 .resp_len = 2,
+                                             }});
+    MockServerAddBehavior(e->mock_server,
+                          &(struct Behavior){.tag = ExactRequestResponse,
+                                             .exact_request_response = {
+                                                 .req_data = {0x83, 0x03},
+                                                 .req_len = 2,
+                                                 .resp_data = {0xC3, 0x03, 0x00, 0x1E, 0x00, 0x64},
+                                                 .resp_len = 6,
+                                             }});
+    MockServerAddBehavior(e->mock_server, &(struct Behavior){.tag = ExactRequestResponse,
+                                                             .exact_request_response = {
+                                                                 .req_data = {0x83, 0x02},
+                                                                 .req_len = 2,
+                                                                 .resp_data = {0xC3, 0x02},
+                                                                 .resp_len = 2,
+                                                             }});
+    int call_count[UDS_EVT_MAX] = {0};
+    e->client->fn = fn_log_call_count;
+    e->client->fn_data = call_count;
+
+    TEST_INT_EQUAL(UDSSendAccessTimingParameter(e->client, UDS_LEV_ATP_STPTGV, 20, 500), UDS_OK);
+    EnvRunMillis(e, 100);
+    TEST_INT_EQUAL(e->client->p2_ms, 20);
+    TEST_INT_EQUAL(e->client->p2_star_ms, 500);
+
+    TEST_INT_EQUAL(UDSSendAccessTimingParameter(e->client, UDS_LEV_ATP_RCATP, 0, 0), UDS_OK);
+    EnvRunMillis(e, 100);
+    struct AccessTimingParameterResponse resp;
+    TEST_INT_EQUAL(UDSUnpackAccessTimingParameterResponse(e->client, &resp), UDS_OK);
+    TEST_INT_EQUAL(resp.p2_ms, 30);
+    TEST_INT_EQUAL(resp.p2_star_ms, 1000);
+    TEST_INT_EQUAL(e->client->p2_ms, 30);
+    TEST_INT_EQUAL(e->client->p2_star_ms, 1000);
+
+    // ignored when the client keeps its own timings
+    e->client->options |= UDS_IGNORE_SRV_TIMINGS;
+    TEST_INT_EQUAL(UDSSendAccessTimingParameter(e->client, UDS_LEV_ATP_STPTDV, 0, 0), UDS_OK);
+    EnvRunMillis(e, 100);
+    TEST_INT_EQUAL(e->client->p2_ms, 30);
+    e->client->options &= ~UDS_IGNORE_SRV_TIMINGS;
+    TEST_INT_EQUAL(UDSSendAccessTimingParameter(e->client, UDS_LEV_ATP_STPTDV, 0, 0), UDS_OK);
+    EnvRunMillis(e, 100);
+    TEST_INT_EQUAL(e->client->p2_ms, UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_INT_EQUAL(e->client->p2_star_ms, UDS_CLIENT_DEFAULT_P2_STAR_MS);
+}
+
+void test_download_from_memory(void **state) {
+    Env_t *e = *state;
+    int call_count[UDS_EVT_MAX] = {0};
+    e->client->fn = fn_log_call_count;
+    e->client->fn_data = call_count;
+    AddDownloadBehaviors(e, BLOCK2_OK, sizeof(BLOCK2_OK));
+
+    // when an image in memory is downloaded
+    const UDSDownloadSource_t src = {.data = DOWNLOAD_IMAGE, .size = sizeof(DOWNLOAD_IMAGE)};
+    EXPECT_OK(UDSStartDownload(e->client, 0x00, 0x11, 0x10, &src));
+
+    // other requests should be refused until it is done
+    TEST_ERR_EQUAL(UDSSendTesterPresent(e->client), UDS_ERR_BUSY);
+    EXPECT_WITHIN_MS(e, e->client->download.state == UDS_DOWNLOAD_DONE, 1000);
+
+    // the engine should have sent 0x34, three blocks and 0x37 by itself
+    TEST_INT_EQUAL(call_count[UDS_EVT_ResponseReceived], 5);
+    TEST_INT_EQUAL(call_count[UDS_EVT_DownloadComplete], 1);
+    TEST_INT_EQUAL(call_count[UDS_EVT_Err], 0);
+
+    // and measured the transfer
+    const UDSDownloadStats_t *stats = &e->client->download.stats;
+    TEST_INT_EQUAL(stats->bytes, sizeof(DOWNLOAD_IMAGE));
+    TEST_INT_EQUAL(stats->blocks, 3);
+    TEST_INT_GE(stats->maxBlockMs, 20);
+    TEST_INT_LT(stats->minBlockMs, 5);
+    TEST_INT_GREATER(stats->elapsedMs, stats->maxBlockMs);
+    TEST_INT_GREATER(stats->bytesPerSec, 0);
+    EXPECT_OK(UDSSendTesterPresent(e->client));
+}
+
+typedef struct {
+    int calls;
+    size_t offsets[4];
+} PullCtx_t;
+
+static ssize_t PullRead(void *ctx, size_t offset, uint8_t *dst, size_t len) {
+    PullCtx_t *pull = ctx;
+    pull->offsets[pull->calls++] = offset;
+    memcpy(dst, &DOWNLOAD_IMAGE[offset], len);
+    return (ssize_t)len;
+}
+
+void test_download_pull_source_reads_ahead(void **state) {
+    Env_t *e = *state;
+    int call_count[UDS_EVT_MAX] = {0};
+    e->client->fn = fn_log_call_count;
+    e->client->fn_data = call_count;
+    AddDownloadBehaviors(e, BLOCK2_OK, sizeof(BLOCK2_OK));
+
+    // when the image is pulled through an 8 byte readahead buffer
+    PullCtx_t pull = {0};
+    uint8_t readahead[8];
+    const UDSDownloadSource_t src = {
+        .size = sizeof(DOWNLOAD_IMAGE),
+        .ctx = &pull,
+        .readahead = readahead,
+        .readaheadSize = sizeof(readahead),
+        .read = PullRead,
+    };
+    EXPECT_OK(UDSStartDownload(e->client, 0x00, 0x11, 0x10, &src));
+    EXPECT_WITHIN_MS(e, e->client->download.state == UDS_DOWNLOAD_DONE, 1000);
+
+    // the two first blocks should be served by a single read
+    TEST_INT_EQUAL(pull.calls, 2);
+    TEST_INT_EQUAL(pull.offsets[0], 0);
+    TEST_INT_EQUAL(pull.offsets[1], 8);
+    TEST_INT_EQUAL(call_count[UDS_EVT_DownloadComplete], 1);
+}
+
+void test_config_download_from_file(void **state) {
+    Env_t *e = *state;
+    int call_count[UDS_EVT_MAX] = {0};
+    e->client->fn = fn_log_call_count;
+    e->client->fn_data = call_count;
+    AddDownloadBehaviors(e, BLOCK2_OK, sizeof(BLOCK2_OK));
+
+    FILE *fd = tmpfile();
+    assert_non_null(fd);
+    fwrite(DOWNLOAD_IMAGE, 1, sizeof(DOWNLOAD_IMAGE), fd);
+    rewind(fd);
+
+    EXPECT_OK(UDSConfigDownload(e->client, 0x00, 0x11, 0x10, sizeof(DOWNLOAD_IMAGE), fd));
+    EXPECT_WITHIN_MS(e, e->client->download.state == UDS_DOWNLOAD_DONE, 1000);
+    TEST_INT_EQUAL(e->client->download.stats.bytes, sizeof(DOWNLOAD_IMAGE));
+    fclose(fd);
+}
+
+void test_download_fails_on_negative_response(void **state) {
+    Env_t *e = *state;
+    int call_count[UDS_EVT_MAX] = {0};
+    e->client->fn = fn_log_call_count;
+    e->client->fn_data = call_count;
+    const uint8_t BLOCK2_FAILED[] = {0x7F, 0x36, 0x72};
+    AddDownloadBehaviors(e, BLOCK2_FAILED, sizeof(BLOCK2_FAILED));
+
+    // when the server rejects the second block
+    const UDSDownloadSource_t src = {.data = DOWNLOAD_IMAGE, .size = sizeof(DOWNLOAD_IMAGE)};
+    EXPECT_OK(UDSStartDownload(e->client, 0x00, 0x11, 0x10, &src));
+    EXPECT_WITHIN_MS(e, e->client->download.state == UDS_DOWNLOAD_FAILED, 1000);
+
+    // the download should stop with the NRC reported once
+    TEST_ERR_EQUAL(e->client->download.err, UDS_NRC_GeneralProgrammingFailure);
+    TEST_INT_EQUAL(e->client->download.stats.bytes, 4);
+    EnvRunMillis(e, 100);
+    TEST_INT_EQUAL(call_count[UDS_EVT_Err], 1);
+    TEST_INT_EQUAL(call_count[UDS_EVT_DownloadComplete], 0);
+    TEST_INT_EQUAL(call_count[UDS_EVT_ResponseReceived], 2);
+}
+
+void test_download_resumes_file(void **state) {
+    Env_t *e = *state;
+    int call_count[UDS_EVT_MAX] = {0};
+    e->client->fn = fn_log_call_count;
+    e->client->fn_data = call_count;
+
+    // when the server has already received the first 4 bytes of the file
+    struct Behavior b[] = {
+        {.tag = ExactRequestResponse,
+         .exact_request_response = {.req_data = {0x38, 0x06, 0x00, 0x01, 'f', 0x00, 0x04, 0x00,
+                                                 0x00, 0x00, 0x0A, 0x00, 0x00, 0x00, 0x0A},
+                                    .req_len = 15,
+                                    .resp_data = {0x78, 0x06, 0x02, 0x00, 0x06, 0x00, 0x00, 0x00,
+                                                  0x00, 0x00, 0x00, 0x00, 0x00, 0x04},
+                                    .resp_len = 14}},
+        {.tag = ExactRequestResponse,
+         .exact_request_response = {.req_data = {0x36, 0x01, 0x04, 0x05, 0x06, 0x07},
+                                    .req_len = 6,
+                                    .resp_data = {0x76, 0x01},
+                                    .resp_len = 2}},
+        {.tag = ExactRequestResponse,
+         .exact_request_response = {.req_data = {0x36, 0x02, 0x08, 0x09},
+                                    .req_len = 4,
+                                    .resp_data = {0x76, 0x02},
+                                    .resp_len = 2}},
+        {.tag = ExactRequestResponse,
+         .exact_request_response = {.req_data = {0x37},
+                                    .req_len = 1,
+                                    .resp_data = {0x77},
+                                    .resp_len = 1}},
+    };
+    for (size_t i = 0; i < sizeof(b) / sizeof(b[0]); i++) {
+        MockServerAddBehavior(e->mock_server, &b[i]);
+    }
+
+    // resuming the download should only send the rest of the image
+    const UDSDownloadSource_t src = {.data = DOWNLOAD_IMAGE, .size = sizeof(DOWNLOAD_IMAGE)};
+    EXPECT_OK(UDSStartFileDownload(e->client, UDS_MOOP_RSFILE, "f", 0x00, &src));
+    EXPECT_WITHIN_MS(e, e->client->download.state == UDS_DOWNLOAD_DONE, 1000);
+    TEST_INT_EQUAL(call_count[UDS_EVT_DownloadComplete], 1);
+    TEST_INT_EQUAL(call_count[UDS_EVT_Err], 0);
+
+    const UDSDownloadStats_t *stats = &e->client->download.stats;
+    TEST_INT_EQUAL(stats->startOffset, 4);
+    TEST_INT_EQUAL(stats->bytes, sizeof(DOWNLOAD_IMAGE) - 4);
+    TEST_INT_EQUAL(stats->imageBytes, sizeof(DOWNLOAD_IMAGE));
+    TEST_INT_EQUAL(stats->blocks, 2);
+}
+
+// a server that uploads DOWNLOAD_IMAGE from 0x10 in blocks of 4 bytes
+static void AddUploadBehaviors(Env_t *e) {
+    struct Behavior b[] = {
+        {.tag = ExactRequestResponse,
+         .exact_request_response = {.req_data = {0x35, 0x00, 0x11, 0x10, 0x0A},
+                                    .req_len = 5,
+                                    .resp_data = {0x75, 0x10, 0x06},
+                                    .resp_len = 3}},
+        {.tag = ExactRequestResponse,
+         .exact_request_response = {.req_data = {0x36, 0x01},
+                                    .req_len = 2,
+                                    .resp_data = {0x76, 0x01, 0x00, 0x01, 0x02, 0x03},
+                                    .resp_len = 6,
+                                    .delay_ms = 5}},
+        {.tag = ExactRequestResponse,
+         .exact_request_response = {.req_data = {0x36, 0x02},
+                                    .req_len = 2,
+                                    .resp_data = {0x76, 0x02, 0x04, 0x05, 0x06, 0x07},
+                                    .resp_len = 6,
+                                    .delay_ms = 20}},
+        {.tag = ExactRequestResponse,
+         .exact_request_response = {.req_data = {0x36, 0x03},
+                                    .req_len = 2,
+                                    .resp_data = {0x76, 0x03, 0x08, 0x09},
+                                    .resp_len = 4}},
+        {.tag = ExactRequestResponse,
+         .exact_request_response = {.req_data = {0x37},
+                                    .req_len = 1,
+                                    .resp_data = {0x77},
+                                    .resp_len = 1}},
+    };
+    for (size_t i = 0; i < sizeof(b) / sizeof(b[0]); i++) {
+        MockServerAddBehavior(e->mock_server, &b[i]);
+    }
+}
+
+void test_upload_to_memory(void **state) {
+    Env_t *e = *state;
+    int call_count[UDS_EVT_MAX] = {0};
+    e->client->fn = fn_log_call_count;
+    e->client->fn_data = call_count;
+    AddUploadBehaviors(e);
+
+    // when 10 bytes are uploaded into a buffer
+    uint8_t buf[sizeof(DOWNLOAD_IMAGE)] = {0};
+    const UDSUploadSink_t sink = {.data = buf, .size = sizeof(buf)};
+    EXPECT_OK(UDSStartUpload(e->client, 0x00, 0x11, 0x10, &sink));
+
+    // other requests should be refused until it is done
+    TEST_ERR_EQUAL(UDSSendTesterPresent(e->client), UDS_ERR_BUSY);
+    EXPECT_WITHIN_MS(e, e->client->upload.state == UDS_UPLOAD_DONE, 1000);
+
+    // the engine should have sent 0x35, three blocks and 0x37 by itself
+    TEST_MEMORY_EQUAL(buf, DOWNLOAD_IMAGE, sizeof(DOWNLOAD_IMAGE));
+    TEST_INT_EQUAL(call_count[UDS_EVT_ResponseReceived], 5);
+    TEST_INT_EQUAL(call_count[UDS_EVT_UploadComplete], 1);
+    TEST_INT_EQUAL(call_count[UDS_EVT_Err], 0);
+
+    const UDSUploadStats_t *stats = &e->client->upload.stats;
+    TEST_INT_EQUAL(stats->bytes, sizeof(DOWNLOAD_IMAGE));
+    TEST_INT_EQUAL(stats->blocks, 3);
+    TEST_INT_GE(stats->maxBlockMs, 20);
+    TEST_INT_GREATER(stats->bytesPerSec, 0);
+    EXPECT_OK(UDSSendTesterPresent(e->client));
+}
+
+typedef struct {
+    UDSClient_t *client;
+    int calls;
+    size_t offsets[4];
+    uint8_t next_sid[4]; /* request already sent when the block was written */
+    uint8_t buf[sizeof(DOWNLOAD_IMAGE)];
+} PushCtx_t;
+
+static ssize_t PushWrite(void *ctx, size_t offset, const uint8_t *src, size_t len) {
+    PushCtx_t *push = ctx;
+    push->offsets[push->calls] = offset;
+    push->next_sid[push->calls++] = push->client->send_buf[0];
+    memcpy(&push->buf[offset], src, len);
+    return (ssize_t)len;
+}
+
+void test_upload_writes_while_next_block_is_requested(void **state) {
+    Env_t *e = *state;
+    int call_count[UDS_EVT_MAX] = {0};
+    e->client->fn = fn_log_call_count;
+    e->client->fn_data = call_count;
+    AddUploadBehaviors(e);
+
+    PushCtx_t push = {.client = e->client};
+    const UDSUploadSink_t sink = {.size = sizeof(DOWNLOAD_IMAGE), .ctx = &push, .write = PushWrite};
+    EXPECT_OK(UDSStartUpload(e->client, 0x00, 0x11, 0x10, &sink));
+    EXPECT_WITHIN_MS(e, e->client->upload.state == UDS_UPLOAD_DONE, 1000);
+
+    // each block should be written once the request that follows it has been sent
+    TEST_INT_EQUAL(push.calls, 3);
+    TEST_INT_EQUAL(push.offsets[1], 4);
+    TEST_INT_EQUAL(push.offsets[2], 8);
+    TEST_INT_EQUAL(push.next_sid[0], 0x36);
+    TEST_INT_EQUAL(push.next_sid[1], 0x36);
+    TEST_INT_EQUAL(push.next_sid[2], 0x37);
+    TEST_MEMORY_EQUAL(push.buf, DOWNLOAD_IMAGE, sizeof(DOWNLOAD_IMAGE));
+}
+
+void test_upload_falls_back_to_read_memory(void **state) {
+    Env_t *e = *state;
+    int call_count[UDS_EVT_MAX] = {0};
+    e->client->fn = fn_log_call_count;
+    e->client->fn_data = call_count;
+    struct Behavior b[] = {
+        {.tag = ExactRequestResponse,
+         .exact_request_response = {.req_data = {0x35, 0x00, 0x11, 0x10, 0x0A},
+                                    .req_len = 5,
+                                    .resp_data = {0x7F, 0x35, 0x11},
+                                    .resp_len = 3}},
+        {.tag = ExactRequestResponse,
+         .exact_request_response = {.req_data = {0x23, 0x11, 0x10, 0x04},
+                                    .req_len = 4,
+                                    .resp_data = {0x63, 0x00, 0x01, 0x02, 0x03},
+                                    .resp_len = 5}},
+        {.tag = ExactRequestResponse,
+         .exact_request_response = {.req_data = {0x23, 0x11, 0x14, 0x04},
+                                    .req_len = 4,
+                                    .resp_data = {0x63, 0x04, 0x05, 0x06, 0x07},
+                                    .resp_len = 5}},
+        {.tag = ExactRequestResponse,
+         .exact_request_response = {.req_data = {0x23, 0x11, 0x18, 0x02},
+                                    .req_len = 4,
+                                    .resp_data = {0x63, 0x08, 0x09},
+                                    .resp_len = 3}},
+    };
+    for (size_t i = 0; i < sizeof(b) / sizeof(b[0]); i++) {
+        MockServerAddBehavior(e->mock_server, &b[i]);
+    }
+
+    // when the server does not support RequestUpload
+    uint8_t buf[sizeof(DOWNLOAD_IMAGE)] = {0};
+    const UDSUploadSink_t sink = {.data = buf, .size = sizeof(buf), .chunkSize = 4};
+    EXPECT_OK(UDSStartUpload(e->client, 0x00, 0x11, 0x10, &sink));
+    EXPECT_WITHIN_MS(e, e->client->upload.state == UDS_UPLOAD_DONE, 1000);
+
+    // the range should be read in chunks with ReadMemoryByAddress instead, without an error
+    TEST_MEMORY_EQUAL(buf, DOWNLOAD_IMAGE, sizeof(DOWNLOAD_IMAGE));
+    TEST_INT_EQUAL(e->client->upload.readMemory, true);
+    TEST_INT_EQUAL(e->client->upload.stats.blocks, 3);
+    TEST_INT_EQUAL(call_count[UDS_EVT_UploadComplete], 1);
+    TEST_INT_EQUAL(call_count[UDS_EVT_Err], 0);
+}
+
+void test_upload_fails_on_oversize_block(void **state) {
+    Env_t *e = *state;
+    int call_count[UDS_EVT_MAX] = {0};
+    e->client->fn = fn_log_call_count;
+    e->client->fn_data = call_count;
+    AddUploadBehaviors(e);
+
+    // when the server sends more than was asked for
+    uint8_t buf[6] = {0};
+    const UDSUploadSink_t sink = {.data = buf, .size = sizeof(buf)};
+    MockServerAddBehavior(e->mock_server,
+                          &(struct Behavior){.tag = ExactRequestResponse,
+                                             .exact_request_response = {
+                                                 .req_data = {0x35, 0x00, 0x11, 0x10, 0x06},
+                                                 .req_len = 5,
+                                                 .resp_data = {0x75, 0x10, 0x06},
+                                                 .resp_len = 3}});
+    EXPECT_OK(UDSStartUpload(e->client, 0x00, 0x11, 0x10, &sink));
+    EXPECT_WITHIN_MS(e, e->client->upload.state == UDS_UPLOAD_FAILED, 1000);
+
+    // the upload should stop before writing past the end of the sink
+    TEST_ERR_EQUAL(e->client->upload.err, UDS_FAIL);
+    TEST_INT_EQUAL(e->client->upload.stats.bytes, 4);
+    TEST_INT_EQUAL(call_count[UDS_EVT_Err], 1);
+    TEST_INT_EQUAL(call_count[UDS_EVT_UploadComplete], 0);
+}
+
 int main(int ac, char **av) {
     if (ac > 1) {
         cmocka_set_test_filter(av[1]);
@@ -367,11 +1206,29 @@ int main(int ac, char **av) {
         cmocka_unit_test_setup_teardown(test_0x11_rcrrp_timeout, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x11_rcrrp_ok, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x11_suppress_pos_resp, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_functional_collects_every_response, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_queue_sends_back_to_back, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_queue_full, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x22_unpack_rdbi_response, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x22_plan_packs_requests, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x22_plan_continues_after_failure, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x22_did_cache, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x34_format, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x38_format_add_file, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x38_format_delete_file, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x2e_issue_59, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x83_timings_follow_the_server, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_next_deadline, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_download_from_memory, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_download_pull_source_reads_ahead, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_config_download_from_file, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_download_fails_on_negative_response, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_download_resumes_file, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_upload_to_memory, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_upload_writes_while_next_block_is_requested, Setup,
+                                        Teardown),
+        cmocka_unit_test_setup_teardown(test_upload_falls_back_to_read_memory, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_upload_fails_on_oversize_block, Setup, Teardown),
     };
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
\ No newline at end of file
@@ -0,0 +1,187 @@
+#include "src/cpp/uds_client.hpp"
+extern "C" {
+#include <setjmp.h> // needed for cmocka
+#include <cmocka.h>
+}
+
+// test/env.h is C only (anonymous structs in unions, implicit enum conversions), so this test
+// keeps its own clock and answers requests from a small table
+struct Exchange {
+    uint8_t req[8];
+    size_t req_len;
+    uint8_t resp[8];
+    size_t resp_len;
+};
+
+static uint32_t now_ms;
+static UDSTp_t *client_tp;
+static UDSTp_t *server_tp;
+static Exchange exchanges[8];
+static size_t num_exchanges;
+
+extern "C" uint32_t UDSMillis(void) { return now_ms; }
+
+int Setup(void **state) {
+    num_exchanges = 0;
+    ISOTPMockArgs_t client_args = {.sa_phys = 0x7E8,
+                                   .ta_phys = 0x7E0,
+                                   .sa_func = UDS_TP_NOOP_ADDR,
+                                   .ta_func = 0x7DF};
+    ISOTPMockArgs_t server_args = {.sa_phys = 0x7E0,
+                                   .ta_phys = 0x7E8,
+                                   .sa_func = 0x7DF,
+                                   .ta_func = UDS_TP_NOOP_ADDR};
+    client_tp = ISOTPMockNew("client", &client_args);
+    server_tp = ISOTPMockNew("server", &server_args);
+    return 0;
+}
+
+int Teardown(void **state) {
+    ISOTPMockFree(client_tp);
+    ISOTPMockFree(server_tp);
+    ISOTPMockReset();
+    return 0;
+}
+
+static void Respond(std::initializer_list<uint8_t> req, std::initializer_list<uint8_t> resp) {
+    Exchange *x = &exchanges[num_exchanges++];
+    memcpy(x->req, req.begin(), req.size());
+    x->req_len = req.size();
+    memcpy(x->resp, resp.begin(), resp.size());
+    x->resp_len = resp.size();
+}
+
+// answer each request the millisecond after it arrives
+static void Run(uds::Client &ecu, uint32_t millis) {
+    for (uint32_t i = 0; i < millis; i++) {
+        ecu.poll();
+        UDSTpPoll(server_tp);
+        uint8_t buf[UDS_TP_MTU];
+        ssize_t len = UDSTpRecv(server_tp, buf, sizeof(buf), NULL);
+        for (size_t j = 0; len > 0 && j < num_exchanges; j++) {
+            if ((size_t)len == exchanges[j].req_len && !memcmp(buf, exchanges[j].req, len)) {
+                UDSTpSend(server_tp, exchanges[j].resp, exchanges[j].resp_len, NULL);
+            }
+        }
+        now_ms++;
+    }
+}
+
+static const uint8_t NEW_VALUE[] = {0x12, 0x35};
+
+static uds::Task ReadThenWrite(uds::Client &ecu, uint16_t *value) {
+    uds::Response r = co_await ecu.session(0x03);
+    if (!r) {
+        co_return r.err;
+    }
+    r = co_await ecu.rdbi(0xF190);
+    if (!r) {
+        co_return r.err;
+    }
+    UDSRDBIVar_t var = {0xF190, 2, value, memmove};
+    UDSErr_t err = UDSUnpackRDBIResponse(&ecu.c(), &var, 1);
+    if (err) {
+        co_return err;
+    }
+    r = co_await ecu.wdbi(0xF190, NEW_VALUE, sizeof(NEW_VALUE));
+    co_return r.err;
+}
+
+void test_sequence(void **state) {
+    uds::Client ecu(client_tp);
+    Respond({0x10, 0x03}, {0x50, 0x03, 0x00, 0x32, 0x01, 0xF4});
+    Respond({0x22, 0xF1, 0x90}, {0x62, 0xF1, 0x90, 0x34, 0x12});
+    Respond({0x2E, 0xF1, 0x90, 0x12, 0x35}, {0x6E, 0xF1, 0x90});
+
+    // a coroutine should read each response where a callback state machine would have been
+    uint16_t value = 0;
+    uds::Task task = ReadThenWrite(ecu, &value);
+    task.start();
+    Run(ecu, 100);
+    assert_int_equal(task.done(), true);
+    assert_int_equal(task.result(), UDS_OK);
+    assert_int_equal(value, 0x1234);
+    assert_int_equal(ecu.busy(), false);
+}
+
+static uds::Task Ping(uds::Client &ecu, int *pongs) {
+    uds::Response r = co_await ecu.tester_present();
+    if (r) {
+        (*pongs)++;
+    }
+    co_return r.err;
+}
+
+static uds::Task PingTwice(uds::Client &ecu, int *pongs) {
+    UDSErr_t err = co_await Ping(ecu, pongs);
+    if (err) {
+        co_return err;
+    }
+    co_return co_await Ping(ecu, pongs);
+}
+
+void test_concurrent_tasks(void **state) {
+    uds::Client ecu(client_tp);
+    Respond({0x3E, 0x00}, {0x7E, 0x00});
+    Respond({0x11, 0x01}, {0x7F, 0x11, 0x22});
+
+    // requests awaited from several coroutines should be queued on the one client
+    int pongs = 0;
+    uds::Task a = PingTwice(ecu, &pongs);
+    uds::Task b = Ping(ecu, &pongs);
+    a.start();
+    b.start();
+    assert_int_equal(ecu.c().queue_len, 2);
+    Run(ecu, 100);
+    assert_int_equal(a.done() && b.done(), true);
+    assert_int_equal(pongs, 3);
+
+    // and a negative response should come back as the result
+    uds::Task reset = [](uds::Client &c) -> uds::Task {
+        co_return (co_await c.ecu_reset(0x01)).err;
+    }(ecu);
+    reset.start();
+    Run(ecu, 100);
+    assert_int_equal(reset.result(), UDS_NRC_ConditionsNotCorrect);
+}
+
+static const uint8_t IMAGE[] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09};
+
+static uds::Task Flash(uds::Client &ecu) {
+    const UDSDownloadSource_t src = {.data = IMAGE, .size = sizeof(IMAGE)};
+    UDSErr_t err = co_await ecu.download(0x00, 0x11, 0x10, src);
+    if (err) {
+        co_return err;
+    }
+    co_return (co_await ecu.ecu_reset(0x01)).err;
+}
+
+void test_download(void **state) {
+    uds::Client ecu(client_tp);
+    Respond({0x34, 0x00, 0x11, 0x10, 0x0A}, {0x74, 0x10, 0x06});
+    Respond({0x36, 0x01, 0x00, 0x01, 0x02, 0x03}, {0x76, 0x01});
+    Respond({0x36, 0x02, 0x04, 0x05, 0x06, 0x07}, {0x76, 0x02});
+    Respond({0x36, 0x03, 0x08, 0x09}, {0x76, 0x03});
+    Respond({0x37}, {0x77});
+    Respond({0x11, 0x01}, {0x51, 0x01});
+
+    // the coroutine should resume once the download engine is done
+    uds::Task task = Flash(ecu);
+    task.start();
+    Run(ecu, 200);
+    assert_int_equal(task.done(), true);
+    assert_int_equal(task.result(), UDS_OK);
+    assert_int_equal(ecu.c().download.stats.bytes, sizeof(IMAGE));
+}
+
+int main(int ac, char **av) {
+    if (ac > 1) {
+        cmocka_set_test_filter(av[1]);
+    }
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_sequence, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_concurrent_tasks, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_download, Setup, Teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,200 @@
+#include "test/env.h"
+#include "test/diag_tables.h"
+
+// The server and the client both use the tables generated from test/diag_tables.json
+
+static DemoCalibration_t calibration;
+
+UDSErr_t DemoCalibrationRead(UDSServer_t *srv, const UDSDIDEntry_t *entry, uint8_t *dst) {
+    DemoCalibrationEncode(dst, &calibration);
+    return UDS_PositiveResponse;
+}
+
+UDSErr_t DemoCalibrationWrite(UDSServer_t *srv, const UDSDIDEntry_t *entry, const uint8_t *src,
+                              uint16_t len) {
+    TEST_INT_EQUAL(len, DEMO_CALIBRATION_LEN);
+    DemoCalibrationDecode(&calibration, src);
+    return UDS_PositiveResponse;
+}
+
+static DemoEraseMemoryOption_t erased;
+
+UDSErr_t DemoEraseMemoryRoutine(UDSServer_t *srv, const UDSRoutineEntry_t *entry,
+                                UDSRoutineCtrlArgs_t *args) {
+    if (args->len != DEMO_ERASE_MEMORY_OPTION_LEN) {
+        return UDS_NRC_IncorrectMessageLengthOrInvalidFormat;
+    }
+    DemoEraseMemoryOptionDecode(&erased, args->optionRecord);
+    uint8_t status[DEMO_ERASE_MEMORY_STATUS_LEN];
+    DemoEraseMemoryStatusEncode(status, &(DemoEraseMemoryStatus_t){.result = 0x00});
+    return args->copyStatusRecord(srv, status, sizeof(status));
+}
+
+static UDSErr_t fn(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    // 0x0202 has no handler and goes to the event, everything else is served from the tables
+    TEST_INT_EQUAL(ev, UDS_EVT_RoutineCtrl);
+    TEST_INT_EQUAL(((UDSRoutineCtrlArgs_t *)arg)->id, DEMO_CHECK_DEPENDENCIES_RID);
+    return UDS_PositiveResponse;
+}
+
+static int ClientFn(UDSClient_t *client, UDSEvent_t evt, void *ev_data) { return UDS_OK; }
+
+int Setup(void **state) {
+    Env_t *env = malloc(sizeof(Env_t));
+    memset(env, 0, sizeof(Env_t));
+    env->server = malloc(sizeof(UDSServer_t));
+    UDSServerInit(env->server);
+    env->server->fn = fn;
+    env->server->tp = ISOTPMockNew("server", &(ISOTPMockArgs_t){.sa_phys = 0x7E0,
+                                                                .ta_phys = 0x7E8,
+                                                                .sa_func = 0x7DF,
+                                                                .ta_func = UDS_TP_NOOP_ADDR});
+    env->client = malloc(sizeof(UDSClient_t));
+    UDSClientInit(env->client);
+    env->client->fn = ClientFn;
+    env->client->tp = ISOTPMockNew("client", &(ISOTPMockArgs_t){.sa_phys = 0x7E8,
+                                                                .ta_phys = 0x7E0,
+                                                                .sa_func = UDS_TP_NOOP_ADDR,
+                                                                .ta_func = 0x7DF});
+    EXPECT_OK(UDSServerRegisterDIDs(env->server, DemoDIDs, DEMO_DID_COUNT));
+    EXPECT_OK(UDSServerRegisterRoutines(env->server, DemoRoutines, DEMO_ROUTINE_COUNT));
+    *state = env;
+    return 0;
+}
+
+int Teardown(void **state) {
+    Env_t *env = *state;
+    ISOTPMockFree(env->server->tp);
+    ISOTPMockFree(env->client->tp);
+    ISOTPMockReset();
+    free(env->server);
+    free(env->client);
+    free(env);
+    return 0;
+}
+
+void test_tables_are_sorted(void **state) {
+    for (size_t i = 1; i < DEMO_DID_COUNT; i++) {
+        TEST_INT_LT(DemoDIDs[i - 1].did, DemoDIDs[i].did);
+    }
+    TEST_INT_LT(DemoRoutines[0].rid, DemoRoutines[1].rid);
+    TEST_INT_EQUAL(DemoDTCRecords[0].dtc[0], 0x01);
+
+    // fields are packed without padding
+    TEST_INT_EQUAL(DEMO_ENGINE_STATE_TEMP_OFFSET, 2);
+    TEST_INT_EQUAL(DEMO_ENGINE_STATE_ODO_OFFSET, 3);
+    TEST_INT_EQUAL(DEMO_ENGINE_STATE_LEN, 6);
+}
+
+void test_record_round_trip(void **state) {
+    const DemoEngineState_t in = {.rpm = 0xABCD, .temp = -40, .odo = 0x123456};
+    uint8_t wire[DEMO_ENGINE_STATE_LEN];
+    DemoEngineStateEncode(wire, &in);
+    const uint8_t EXPECTED[] = {0xAB, 0xCD, 0xD8, 0x12, 0x34, 0x56};
+    TEST_MEMORY_EQUAL(wire, EXPECTED, sizeof(EXPECTED));
+
+    DemoEngineState_t out = {0};
+    DemoEngineStateDecode(&out, wire);
+    TEST_INT_EQUAL(out.rpm, in.rpm);
+    TEST_INT_EQUAL(out.temp, in.temp);
+    TEST_INT_EQUAL(out.odo, in.odo);
+}
+
+void test_client_reads_generated_schema(void **state) {
+    Env_t *e = *state;
+    e->server->sessionType = UDS_LEV_DS_EXTDS;
+    e->server->securityLevel = 0x01;
+    DemoEngineStateEncode(DemoEngineStateRecord,
+                          &(DemoEngineState_t){.rpm = 3000, .temp = -7, .odo = 120000});
+    calibration = (DemoCalibration_t){.offset = -100000, .gain = 512};
+    DemoVINEncode(DemoVINRecord, &(DemoVIN_t){.vin = "WDFK0000000000001"});
+
+    DemoDIDValues_t v = {0};
+    UDSRDBIPlan_t plan;
+    EXPECT_OK(UDSRDBIPlanInit(&plan, DemoRDBISchema, DEMO_RDBI_SCHEMA_LEN, &v, 0));
+    EXPECT_OK(UDSRDBIPlanStart(e->client, &plan));
+    EXPECT_WITHIN_MS(e, plan.decoded == DEMO_RDBI_SCHEMA_LEN || plan.err != UDS_OK, 1000);
+
+    TEST_ERR_EQUAL(plan.err, UDS_OK);
+    TEST_INT_EQUAL(plan.decoded, DEMO_RDBI_SCHEMA_LEN);
+    TEST_INT_EQUAL(v.EngineState.rpm, 3000);
+    TEST_INT_EQUAL(v.EngineState.temp, -7);
+    TEST_INT_EQUAL(v.EngineState.odo, 120000);
+    TEST_INT_EQUAL(v.Calibration.offset, -100000);
+    TEST_INT_EQUAL(v.Calibration.gain, 512);
+    TEST_MEMORY_EQUAL(v.VIN.vin, "WDFK0000000000001", 17);
+}
+
+void test_generated_masks_are_enforced(void **state) {
+    Env_t *e = *state;
+
+    // EngineState needs the extended session and security level 0x01
+    e->server->sessionType = UDS_LEV_DS_EXTDS;
+    EXPECT_OK(UDSSendRDBI(e->client, (const uint16_t[]){DEMO_ENGINE_STATE_DID}, 1));
+    EXPECT_WITHIN_MS(e, 0 == e->client->state, 200);
+    TEST_INT_EQUAL(e->client->recv_size, 3);
+    TEST_MEMORY_EQUAL(e->client->recv_buf, ((uint8_t[]){0x7F, 0x22, 0x33}), 3);
+}
+
+void test_client_writes_generated_did(void **state) {
+    Env_t *e = *state;
+    e->server->sessionType = UDS_LEV_DS_EXTDS;
+    e->server->securityLevel = 0x01;
+    EXPECT_OK(DemoWriteEngineState(e->client,
+                                   &(DemoEngineState_t){.rpm = 800, .temp = 90, .odo = 7}));
+    EXPECT_WITHIN_MS(e, 0 == e->client->state, 200);
+    TEST_MEMORY_EQUAL(e->client->recv_buf, ((uint8_t[]){0x6E, 0x01, 0x00}), 3);
+
+    DemoEngineState_t stored = {0};
+    DemoEngineStateDecode(&stored, DemoEngineStateRecord);
+    TEST_INT_EQUAL(stored.rpm, 800);
+    TEST_INT_EQUAL(stored.temp, 90);
+    TEST_INT_EQUAL(stored.odo, 7);
+
+    EXPECT_OK(DemoWriteCalibration(e->client, &(DemoCalibration_t){.offset = 1, .gain = -2}));
+    EXPECT_WITHIN_MS(e, 0 == e->client->state, 200);
+    TEST_INT_EQUAL(calibration.offset, 1);
+    TEST_INT_EQUAL(calibration.gain, -2);
+}
+
+void test_client_starts_generated_routine(void **state) {
+    Env_t *e = *state;
+    e->server->sessionType = UDS_LEV_DS_PRGS;
+    e->server->securityLevel = 0x01;
+    EXPECT_OK(DemoStartEraseMemory(e->client,
+                                   &(DemoEraseMemoryOption_t){.addr = 0x08004000, .size = 0x4000}));
+    EXPECT_WITHIN_MS(e, 0 == e->client->state, 200);
+    const uint8_t RESP[] = {0x71, 0x01, 0xFF, 0x00, 0x00};
+    TEST_INT_EQUAL(e->client->recv_size, sizeof(RESP));
+    TEST_MEMORY_EQUAL(e->client->recv_buf, RESP, sizeof(RESP));
+    TEST_INT_EQUAL(erased.addr, 0x08004000);
+    TEST_INT_EQUAL(erased.size, 0x4000);
+
+    EXPECT_OK(DemoStartCheckDependencies(e->client));
+    EXPECT_WITHIN_MS(e, 0 == e->client->state, 200);
+    TEST_MEMORY_EQUAL(e->client->recv_buf, ((uint8_t[]){0x71, 0x01, 0x02, 0x02}), 4);
+}
+
+void test_generated_dtc_store(void **state) {
+    UDSDTCStore_t store;
+    EXPECT_OK(DemoDTCStoreInit(&store));
+    TEST_INT_EQUAL(store.availabilityMask, DEMO_DTC_AVAILABILITY_MASK);
+    assert_non_null(UDSDTCStoreFind(&store, DEMO_DTC_OVERTEMP));
+    assert_non_null(UDSDTCStoreFind(&store, DEMO_DTC_BATTERY_LOW));
+}
+
+int main(int ac, char **av) {
+    if (ac > 1) {
+        cmocka_set_test_filter(av[1]);
+    }
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_tables_are_sorted),
+        cmocka_unit_test(test_record_round_trip),
+        cmocka_unit_test_setup_teardown(test_client_reads_generated_schema, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_generated_masks_are_enforced, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_client_writes_generated_did, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_client_starts_generated_routine, Setup, Teardown),
+        cmocka_unit_test(test_generated_dtc_store),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
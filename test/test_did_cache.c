@@ -0,0 +1,188 @@
+#include "test/env.h"
+#include <stdint.h>
+
+#if UDS_SERVER_DID_CACHE_ENTRIES != 2
+#error "this test requires UDS_SERVER_DID_CACHE_ENTRIES == 2"
+#endif
+
+typedef struct {
+    int reads;  /* calls of read_counter */
+    int events; /* UDS_EVT_ReadDataByIdent seen */
+} Ctx_t;
+
+int Setup(void **state) {
+    Env_t *env = malloc(sizeof(Env_t));
+    memset(env, 0, sizeof(Env_t));
+    env->server = malloc(sizeof(UDSServer_t));
+    UDSServerInit(env->server);
+    env->server->tp = ISOTPMockNew("server", &(ISOTPMockArgs_t){.sa_phys = 0x7E0,
+                                                                .ta_phys = 0x7E8,
+                                                                .sa_func = 0x7DF,
+                                                                .ta_func = UDS_TP_NOOP_ADDR});
+    env->client_tp = ISOTPMockNew("client", &(ISOTPMockArgs_t){.sa_phys = 0x7E8,
+                                                               .ta_phys = 0x7E0,
+                                                               .sa_func = UDS_TP_NOOP_ADDR,
+                                                               .ta_func = 0x7DF});
+    *state = env;
+    return 0;
+}
+
+int Teardown(void **state) {
+    Env_t *env = *state;
+    ISOTPMockFree(env->server->tp);
+    ISOTPMockFree(env->client_tp);
+    ISOTPMockReset();
+    free(env->server);
+    free(env);
+    return 0;
+}
+
+/* the record is the number of times it has been produced */
+static UDSErr_t read_counter(UDSServer_t *srv, const UDSDIDEntry_t *entry, uint8_t *dst) {
+    Ctx_t *ctx = srv->fn_data;
+    ctx->reads++;
+    dst[0] = (uint8_t)ctx->reads;
+    return UDS_PositiveResponse;
+}
+
+static UDSErr_t write_ok(UDSServer_t *srv, const UDSDIDEntry_t *entry, const uint8_t *src,
+                         uint16_t len) {
+    return UDS_PositiveResponse;
+}
+
+static UDSErr_t fn(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    Ctx_t *ctx = srv->fn_data;
+    switch (ev) {
+    case UDS_EVT_ReadDataByIdent: {
+        UDSRDBIArgs_t *args = arg;
+        ctx->events++;
+        uint8_t value = (uint8_t)ctx->events;
+        return args->copy(srv, &value, sizeof(value));
+    }
+    default:
+        return UDS_NRC_GeneralReject;
+    }
+}
+
+static uint32_t version = 0;
+
+static UDSDIDEntry_t did_table[] = {
+    {.did = 0x0100, .len = 1, .read = read_counter, .write = write_ok,
+     .access = UDS_DID_READ | UDS_DID_WRITE, .cacheMs = 1000, .version = &version},
+    {.did = 0x0101, .len = 1, .read = read_counter, .access = UDS_DID_READ, .cacheMs = 1000},
+    {.did = 0x0102, .len = 1, .read = read_counter, .access = UDS_DID_READ, .cacheMs = 1000},
+    {.did = 0x0103, .len = 1, .read = read_counter, .access = UDS_DID_READ},
+    {.did = 0xF190, .access = UDS_DID_READ, .cacheMs = 1000}, /* computed: served by fn */
+};
+
+static void Init(Env_t *e, Ctx_t *ctx) {
+    e->server->fn = fn;
+    e->server->fn_data = ctx;
+    version = 0;
+    TEST_ERR_EQUAL(UDSServerRegisterDIDs(e->server, did_table,
+                                         sizeof(did_table) / sizeof(did_table[0])),
+                   UDS_OK);
+}
+
+/* read a DID and return its one byte record */
+static uint8_t Read(Env_t *e, uint16_t did) {
+    const uint8_t REQ[] = {0x22, did >> 8, did & 0xFF};
+    uint8_t buf[8] = {0};
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == 4,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_INT_EQUAL(buf[0], 0x62);
+    TEST_INT_EQUAL((buf[1] << 8) | buf[2], did);
+    return buf[3];
+}
+
+void test_cached_record_is_served_until_it_expires(void **state) {
+    Env_t *e = *state;
+    Ctx_t ctx = {0};
+    Init(e, &ctx);
+
+    TEST_INT_EQUAL(Read(e, 0x0101), 1);
+    TEST_INT_EQUAL(Read(e, 0x0101), 1);
+    TEST_INT_EQUAL(ctx.reads, 1);
+
+    // a DID without a cacheMs is produced on every request
+    TEST_INT_EQUAL(Read(e, 0x0103), 2);
+    TEST_INT_EQUAL(Read(e, 0x0103), 3);
+
+    EnvRunMillis(e, 1000);
+    TEST_INT_EQUAL(Read(e, 0x0101), 4);
+    TEST_INT_EQUAL(ctx.reads, 4);
+}
+
+void test_version_change_refreshes_the_record(void **state) {
+    Env_t *e = *state;
+    Ctx_t ctx = {0};
+    Init(e, &ctx);
+
+    TEST_INT_EQUAL(Read(e, 0x0100), 1);
+    TEST_INT_EQUAL(Read(e, 0x0100), 1);
+    version++;
+    TEST_INT_EQUAL(Read(e, 0x0100), 2);
+    TEST_INT_EQUAL(Read(e, 0x0100), 2);
+}
+
+void test_invalidate(void **state) {
+    Env_t *e = *state;
+    Ctx_t ctx = {0};
+    Init(e, &ctx);
+
+    TEST_INT_EQUAL(Read(e, 0x0101), 1);
+    UDSServerInvalidateDID(e->server, 0x0101);
+    TEST_INT_EQUAL(Read(e, 0x0101), 2);
+
+    // a successful 0x2E drops the record that was written
+    TEST_INT_EQUAL(Read(e, 0x0100), 3);
+    const uint8_t REQ[] = {0x2E, 0x01, 0x00, 0xAA};
+    const uint8_t RESP[] = {0x6E, 0x01, 0x00};
+    uint8_t buf[8] = {0};
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == sizeof(RESP),
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, RESP, sizeof(RESP));
+    TEST_INT_EQUAL(Read(e, 0x0100), 4);
+}
+
+void test_event_record_is_cached(void **state) {
+    Env_t *e = *state;
+    Ctx_t ctx = {0};
+    Init(e, &ctx);
+
+    TEST_INT_EQUAL(Read(e, 0xF190), 1);
+    TEST_INT_EQUAL(Read(e, 0xF190), 1);
+    TEST_INT_EQUAL(ctx.events, 1);
+}
+
+void test_least_recently_used_record_is_evicted(void **state) {
+    Env_t *e = *state;
+    Ctx_t ctx = {0};
+    Init(e, &ctx);
+
+    TEST_INT_EQUAL(Read(e, 0x0100), 1);
+    TEST_INT_EQUAL(Read(e, 0x0101), 2);
+    TEST_INT_EQUAL(Read(e, 0x0100), 1); // 0x0101 is now the least recently used
+    TEST_INT_EQUAL(Read(e, 0x0102), 3);
+    TEST_INT_EQUAL(Read(e, 0x0100), 1);
+    TEST_INT_EQUAL(Read(e, 0x0101), 4);
+    TEST_INT_EQUAL(ctx.reads, 4);
+}
+
+int main(int ac, char **av) {
+    if (ac > 1) {
+        cmocka_set_test_filter(av[1]);
+    }
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_cached_record_is_served_until_it_expires, Setup,
+                                        Teardown),
+        cmocka_unit_test_setup_teardown(test_version_change_refreshes_the_record, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_invalidate, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_event_record_is_cached, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_least_recently_used_record_is_evicted, Setup,
+                                        Teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,193 @@
+#include "test/env.h"
+#include <stdint.h>
+
+#if !UDS_SERVER_0x36_DECOMPRESS || !UDS_CLIENT_DOWNLOAD_COMPRESS
+#error "this test requires UDS_SERVER_0x36_DECOMPRESS and UDS_CLIENT_DOWNLOAD_COMPRESS"
+#endif
+
+#define DFI_LZ (UDS_LZ_COMPRESSION_METHOD << 4)
+#define IMAGE_SIZE 20000
+
+typedef struct {
+    uint8_t flash[IMAGE_SIZE]; /* data passed to UDS_EVT_TransferData */
+    size_t written;            /* bytes passed to UDS_EVT_TransferData */
+    int calls;                 /* number of UDS_EVT_TransferData events */
+    bool busy;                 /* answer every third TransferData event with 0x78 once */
+    bool exited;               /* UDS_EVT_RequestTransferExit was emitted */
+} Ctx_t;
+
+static uint8_t image[IMAGE_SIZE];
+
+int Setup(void **state) {
+    Env_t *env = malloc(sizeof(Env_t));
+    memset(env, 0, sizeof(Env_t));
+    env->server = malloc(sizeof(UDSServer_t));
+    UDSServerInit(env->server);
+    env->server->tp = ISOTPMockNew("server", &(ISOTPMockArgs_t){.sa_phys = 0x7E0,
+                                                                .ta_phys = 0x7E8,
+                                                                .sa_func = 0x7DF,
+                                                                .ta_func = UDS_TP_NOOP_ADDR});
+    env->client = malloc(sizeof(UDSClient_t));
+    UDSClientInit(env->client);
+    env->client->tp = ISOTPMockNew("client", &(ISOTPMockArgs_t){.sa_phys = 0x7E8,
+                                                                .ta_phys = 0x7E0,
+                                                                .sa_func = UDS_TP_NOOP_ADDR,
+                                                                .ta_func = 0x7DF});
+
+    // a calibration-like image: repeated records with a few changing fields
+    for (size_t i = 0; i < IMAGE_SIZE; i++) {
+        image[i] = (uint8_t)((i % 64) < 48 ? i % 16 : (i * 7) >> 6);
+    }
+    *state = env;
+    return 0;
+}
+
+int Teardown(void **state) {
+    Env_t *env = *state;
+    ISOTPMockFree(env->server->tp);
+    ISOTPMockFree(env->client->tp);
+    ISOTPMockReset();
+    free(env->server);
+    free(env->client);
+    free(env);
+    return 0;
+}
+
+static UDSErr_t fn(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    Ctx_t *ctx = srv->fn_data;
+    switch (ev) {
+    case UDS_EVT_RequestDownload: {
+        UDSRequestDownloadArgs_t *args = arg;
+        args->maxNumberOfBlockLength = 258;
+        return UDS_PositiveResponse;
+    }
+    case UDS_EVT_TransferData: {
+        UDSTransferDataArgs_t *args = arg;
+        if (ctx->busy && 0 == ctx->calls++ % 3) {
+            ctx->busy = false;
+            return UDS_NRC_RequestCorrectlyReceived_ResponsePending;
+        }
+        ctx->busy = true;
+        TEST_INT_LE(ctx->written + args->len, IMAGE_SIZE);
+        memcpy(&ctx->flash[ctx->written], args->data, args->len);
+        ctx->written += args->len;
+        return UDS_PositiveResponse;
+    }
+    case UDS_EVT_RequestTransferExit:
+        ctx->exited = true;
+        return UDS_PositiveResponse;
+    default:
+        return UDS_NRC_GeneralReject;
+    }
+}
+
+static int client_fn(UDSClient_t *client, UDSEvent_t evt, void *ev_data) { return UDS_OK; }
+
+void test_codec_round_trip(void **state) {
+    static UDSLZEncoder_t enc;
+    static UDSLZDecoder_t dec;
+    static uint8_t compressed[IMAGE_SIZE + IMAGE_SIZE / 8 + UDS_LZ_MAX_GROUP_SIZE];
+    static uint8_t decoded[IMAGE_SIZE];
+    UDSLZEncoderInit(&enc);
+    UDSLZDecoderInit(&dec);
+
+    // when the image is fed to the encoder in odd-sized pieces
+    size_t in = 0;
+    size_t clen = 0;
+    for (;;) {
+        uint8_t *dst = NULL;
+        size_t space = UDSLZEncoderSpace(&enc, &dst);
+        size_t n = IMAGE_SIZE - in < 333 ? IMAGE_SIZE - in : 333;
+        n = n < space ? n : space;
+        memcpy(dst, &image[in], n);
+        UDSLZEncoderAdd(&enc, n);
+        in += n;
+        size_t out = UDSLZEncode(&enc, &compressed[clen], sizeof(compressed) - clen,
+                                 IMAGE_SIZE == in);
+        clen += out;
+        if (IMAGE_SIZE == in && UDSLZEncoderIsEmpty(&enc)) {
+            break;
+        }
+    }
+
+    // it should shrink
+    TEST_INT_LT(clen, IMAGE_SIZE / 3);
+
+    // and decode to the original bytes, whatever the input chunking
+    size_t pos = 0;
+    size_t dlen = 0;
+    while (pos < clen || dec.matchLen > 0) {
+        size_t chunk = clen - pos < 7 ? clen - pos : 7;
+        size_t consumed = 0;
+        EXPECT_OK(UDSLZDecode(&dec, &compressed[pos], chunk, &consumed));
+        pos += consumed;
+        const uint8_t *data = NULL;
+        uint16_t n = UDSLZDecoderOutput(&dec, &data);
+        memcpy(&decoded[dlen], data, n);
+        dlen += n;
+        UDSLZDecoderRelease(&dec);
+    }
+    TEST_INT_EQUAL(dlen, IMAGE_SIZE);
+    TEST_MEMORY_EQUAL(decoded, image, IMAGE_SIZE);
+}
+
+void test_compressed_download(void **state) {
+    Env_t *e = *state;
+    static Ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    e->server->fn = fn;
+    e->server->fn_data = &ctx;
+    e->client->fn = client_fn;
+
+    // when the client downloads with the LZ compressionMethod
+    const UDSDownloadSource_t src = {.data = image, .size = IMAGE_SIZE};
+    EXPECT_OK(UDSStartDownload(e->client, DFI_LZ, 0x22, 0x1000, &src));
+    EXPECT_WITHIN_MS(e, e->client->download.state == UDS_DOWNLOAD_DONE, 10000);
+
+    // the server should see the original image, even though its callback was busy at times
+    TEST_INT_EQUAL(ctx.written, IMAGE_SIZE);
+    TEST_MEMORY_EQUAL(ctx.flash, image, IMAGE_SIZE);
+    TEST_INT_EQUAL(e->server->xferByteCounter, 0);
+    TEST_INT_EQUAL(ctx.exited, true);
+
+    // while far fewer bytes went over the bus
+    const UDSDownloadStats_t *stats = &e->client->download.stats;
+    TEST_INT_EQUAL(stats->imageBytes, IMAGE_SIZE);
+    TEST_INT_LT(stats->bytes, IMAGE_SIZE / 3);
+}
+
+void test_corrupt_stream_is_rejected(void **state) {
+    Env_t *e = *state;
+    static Ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    e->server->fn = fn;
+    e->server->fn_data = &ctx;
+    uint8_t buf[8] = {0};
+
+    const uint8_t REQ[] = {0x34, DFI_LZ, 0x11, 0x10, 0x40};
+    UDSTpSend(e->client->tp, REQ, sizeof(REQ), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client->tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_INT_EQUAL(buf[0], 0x74);
+
+    // a match that refers back before the start of the image
+    const uint8_t BLOCK[] = {0x36, 0x01, 0x02, 0xAA, 0x00, 0x50};
+    UDSTpSend(e->client->tp, BLOCK, sizeof(BLOCK), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client->tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    const uint8_t NRC[] = {0x7F, 0x36, 0x31};
+    TEST_MEMORY_EQUAL(buf, NRC, sizeof(NRC));
+    TEST_INT_EQUAL(e->server->xferIsActive, false);
+}
+
+int main(int ac, char **av) {
+    if (ac > 1) {
+        cmocka_set_test_filter(av[1]);
+    }
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_codec_round_trip, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_compressed_download, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_corrupt_stream_is_rejected, Setup, Teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,305 @@
+#include "test/env.h"
+#include <stdint.h>
+
+#define SECTOR_SIZE 128
+#define SECTOR_COUNT 3
+#define INDEX_SIZE 8
+
+/* NOR flash model: programming only clears bits, erasing sets a whole sector to 0xFF */
+typedef struct {
+    uint8_t mem[SECTOR_SIZE * SECTOR_COUNT];
+    int erases[SECTOR_COUNT];
+    int programs;     /* calls of Program */
+    int fail_program; /* Program fails once this many calls have been made, 0: never */
+    bool off;         /* reset by a failed Program: nothing is programmed or erased until Reboot */
+} Flash_t;
+
+static Flash_t flash;
+static UDSDTCLogEntry_t index_buf[INDEX_SIZE];
+static UDSDTCLog_t dtc_log;
+
+static UDSErr_t Read(void *ctx, uint32_t addr, void *dst, size_t len) {
+    Flash_t *f = ctx;
+    TEST_INT_LE(addr + len, sizeof(f->mem));
+    memcpy(dst, &f->mem[addr], len);
+    return UDS_OK;
+}
+
+static UDSErr_t Program(void *ctx, uint32_t addr, const void *src, size_t len) {
+    Flash_t *f = ctx;
+    const uint8_t *p = src;
+    TEST_INT_EQUAL(addr % 4, 0);
+    TEST_INT_LE(addr + len, sizeof(f->mem));
+    if (f->off) {
+        return UDS_FAIL;
+    }
+    if (f->fail_program && ++f->programs >= f->fail_program) {
+        // reset in the middle of programming: only half of the bytes are written
+        len /= 2;
+        f->off = true;
+    }
+    for (size_t i = 0; i < len; i++) {
+        TEST_INT_EQUAL(f->mem[addr + i], 0xFF);
+        f->mem[addr + i] &= p[i];
+    }
+    return UDS_OK;
+}
+
+static UDSErr_t Erase(void *ctx, uint32_t addr) {
+    Flash_t *f = ctx;
+    TEST_INT_EQUAL(addr % SECTOR_SIZE, 0);
+    if (f->off) {
+        return UDS_FAIL;
+    }
+    memset(&f->mem[addr], 0xFF, SECTOR_SIZE);
+    f->erases[addr / SECTOR_SIZE]++;
+    return UDS_OK;
+}
+
+static const UDSDTCFlash_t flash_driver = {
+    .read = Read,
+    .program = Program,
+    .erase = Erase,
+    .sectorSize = SECTOR_SIZE,
+    .sectorCount = SECTOR_COUNT,
+    .ctx = &flash,
+};
+
+int Setup(void **state) {
+    memset(&flash, 0xFF, sizeof(flash.mem));
+    memset(flash.erases, 0, sizeof(flash.erases));
+    flash.programs = 0;
+    flash.fail_program = 0;
+    flash.off = false;
+    TEST_ERR_EQUAL(UDSDTCLogInit(&dtc_log, &flash_driver, index_buf, INDEX_SIZE), UDS_OK);
+    return 0;
+}
+
+int Teardown(void **state) { return 0; }
+
+/* what the log holds after a reset */
+static void Reboot(void) {
+    flash.off = false;
+    memset(index_buf, 0, sizeof(index_buf));
+    TEST_ERR_EQUAL(UDSDTCLogInit(&dtc_log, &flash_driver, index_buf, INDEX_SIZE), UDS_OK);
+}
+
+void test_records_survive_a_reset(void **state) {
+    const uint8_t SNAP1[] = {0x01, 0xF1, 0x90, 0xAA};
+    const uint8_t SNAP2[] = {0x01, 0xF1, 0x90, 0xBB};
+    const uint8_t EXT[] = {0x05, 0x06};
+    TEST_ERR_EQUAL(UDSDTCLogWrite(&dtc_log, UDS_DTC_LOG_SNAPSHOT, 0, 0x123456, 2, SNAP2,
+                                  sizeof(SNAP2)),
+                   UDS_OK);
+    TEST_ERR_EQUAL(UDSDTCLogWrite(&dtc_log, UDS_DTC_LOG_SNAPSHOT, 0, 0x123456, 1, SNAP1,
+                                  sizeof(SNAP1)),
+                   UDS_OK);
+    TEST_ERR_EQUAL(
+        UDSDTCLogWrite(&dtc_log, UDS_DTC_LOG_EXT_DATA, 0, 0x123456, 1, EXT, sizeof(EXT)), UDS_OK);
+
+    // all snapshot records in order of record number, then a single one
+    const uint8_t ALL[] = {0x01, 0x01, 0xF1, 0x90, 0xAA, 0x02, 0x01, 0xF1, 0x90, 0xBB};
+    const uint8_t ONE[] = {0x01, 0x05, 0x06};
+    uint8_t buf[32] = {0};
+    size_t len = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        TEST_ERR_EQUAL(UDSDTCLogRead(&dtc_log, UDS_DTC_LOG_SNAPSHOT, 0, 0x123456,
+                                     UDS_DTC_LOG_ALL_RECORDS, buf, sizeof(buf), &len),
+                       UDS_OK);
+        TEST_INT_EQUAL(len, sizeof(ALL));
+        TEST_MEMORY_EQUAL(buf, ALL, sizeof(ALL));
+        TEST_ERR_EQUAL(
+            UDSDTCLogRead(&dtc_log, UDS_DTC_LOG_EXT_DATA, 0, 0x123456, 1, buf, sizeof(buf), &len),
+            UDS_OK);
+        TEST_INT_EQUAL(len, sizeof(ONE));
+        TEST_MEMORY_EQUAL(buf, ONE, sizeof(ONE));
+        Reboot();
+    }
+
+    // too small a buffer, and a DTC without records
+    TEST_ERR_EQUAL(UDSDTCLogRead(&dtc_log, UDS_DTC_LOG_SNAPSHOT, 0, 0x123456,
+                                 UDS_DTC_LOG_ALL_RECORDS, buf, 6, &len),
+                   UDS_ERR_BUFSIZ);
+    TEST_ERR_EQUAL(UDSDTCLogRead(&dtc_log, UDS_DTC_LOG_SNAPSHOT, 0, 0x123457,
+                                 UDS_DTC_LOG_ALL_RECORDS, buf, sizeof(buf), &len),
+                   UDS_OK);
+    TEST_INT_EQUAL(len, 0);
+}
+
+void test_rewrites_wear_all_sectors_evenly(void **state) {
+    // two live records, rewritten many times
+    uint8_t data[20] = {0};
+    for (int i = 0; i < 200; i++) {
+        data[0] = (uint8_t)i;
+        TEST_ERR_EQUAL(UDSDTCLogWrite(&dtc_log, UDS_DTC_LOG_SNAPSHOT, 0, 0x000100 + (i % 2), 1,
+                                      data, sizeof(data)),
+                       UDS_OK);
+    }
+    TEST_INT_EQUAL(dtc_log.indexCount, 2);
+    for (int s = 0; s < SECTOR_COUNT; s++) {
+        TEST_INT_GE(flash.erases[s], 15);
+        TEST_INT_LE(flash.erases[s], 25);
+    }
+
+    Reboot();
+    uint8_t buf[32] = {0};
+    size_t len = 0;
+    TEST_ERR_EQUAL(
+        UDSDTCLogRead(&dtc_log, UDS_DTC_LOG_SNAPSHOT, 0, 0x000100, 1, buf, sizeof(buf), &len),
+        UDS_OK);
+    TEST_INT_EQUAL(len, 1 + sizeof(data));
+    TEST_INT_EQUAL(buf[1], 198);
+    TEST_ERR_EQUAL(
+        UDSDTCLogRead(&dtc_log, UDS_DTC_LOG_SNAPSHOT, 0, 0x000101, 1, buf, sizeof(buf), &len),
+        UDS_OK);
+    TEST_INT_EQUAL(buf[1], 199);
+}
+
+void test_clear(void **state) {
+    const uint8_t DATA[] = {0x00};
+    uint8_t buf[8] = {0};
+    size_t len = 0;
+    TEST_ERR_EQUAL(
+        UDSDTCLogWrite(&dtc_log, UDS_DTC_LOG_SNAPSHOT, 0, 0x000001, 1, DATA, sizeof(DATA)), UDS_OK);
+    TEST_ERR_EQUAL(
+        UDSDTCLogWrite(&dtc_log, UDS_DTC_LOG_SNAPSHOT, 0, 0x000002, 1, DATA, sizeof(DATA)), UDS_OK);
+    TEST_ERR_EQUAL(
+        UDSDTCLogWrite(&dtc_log, UDS_DTC_LOG_SNAPSHOT, 1, 0x000002, 1, DATA, sizeof(DATA)), UDS_OK);
+
+    TEST_ERR_EQUAL(UDSDTCLogClear(&dtc_log, 0, 0x000002), UDS_OK);
+    Reboot();
+    TEST_INT_EQUAL(dtc_log.indexCount, 2);
+    UDSDTCLogRead(&dtc_log, UDS_DTC_LOG_SNAPSHOT, 0, 0x000002, 1, buf, sizeof(buf), &len);
+    TEST_INT_EQUAL(len, 0);
+
+    // other memories are not affected
+    TEST_ERR_EQUAL(UDSDTCLogClear(&dtc_log, 0, UDS_DTC_GROUP_ALL), UDS_OK);
+    Reboot();
+    TEST_INT_EQUAL(dtc_log.indexCount, 1);
+    UDSDTCLogRead(&dtc_log, UDS_DTC_LOG_SNAPSHOT, 1, 0x000002, 1, buf, sizeof(buf), &len);
+    TEST_INT_EQUAL(len, 2);
+
+    // clearing an empty group writes nothing
+    uint32_t head = dtc_log.head;
+    TEST_ERR_EQUAL(UDSDTCLogClear(&dtc_log, 0, UDS_DTC_GROUP_ALL), UDS_OK);
+    TEST_INT_EQUAL(dtc_log.head, head);
+}
+
+void test_record_cut_short_by_a_reset_is_ignored(void **state) {
+    const uint8_t OLD[] = {0x11, 0x11, 0x11, 0x11};
+    const uint8_t NEW[] = {0x22, 0x22, 0x22, 0x22};
+    TEST_ERR_EQUAL(
+        UDSDTCLogWrite(&dtc_log, UDS_DTC_LOG_EXT_DATA, 0, 0x000001, 1, OLD, sizeof(OLD)), UDS_OK);
+    flash.programs = 0;
+    flash.fail_program = 2; // the data of the next record
+    UDSDTCLogWrite(&dtc_log, UDS_DTC_LOG_EXT_DATA, 0, 0x000001, 1, NEW, sizeof(NEW));
+    flash.fail_program = 0;
+
+    Reboot();
+    uint8_t buf[8] = {0};
+    size_t len = 0;
+    TEST_ERR_EQUAL(
+        UDSDTCLogRead(&dtc_log, UDS_DTC_LOG_EXT_DATA, 0, 0x000001, 1, buf, sizeof(buf), &len),
+        UDS_OK);
+    TEST_INT_EQUAL(len, 1 + sizeof(OLD));
+    TEST_MEMORY_EQUAL(&buf[1], OLD, sizeof(OLD));
+
+    // the damaged sector is not written to again
+    TEST_ERR_EQUAL(
+        UDSDTCLogWrite(&dtc_log, UDS_DTC_LOG_EXT_DATA, 0, 0x000001, 1, NEW, sizeof(NEW)), UDS_OK);
+    TEST_INT_EQUAL(dtc_log.head / SECTOR_SIZE, 1);
+    Reboot();
+    UDSDTCLogRead(&dtc_log, UDS_DTC_LOG_EXT_DATA, 0, 0x000001, 1, buf, sizeof(buf), &len);
+    TEST_MEMORY_EQUAL(&buf[1], NEW, sizeof(NEW));
+}
+
+static void ExpectSnapshot(uint32_t dtc, uint8_t first) {
+    uint8_t buf[32] = {0};
+    size_t len = 0;
+    TEST_ERR_EQUAL(
+        UDSDTCLogRead(&dtc_log, UDS_DTC_LOG_SNAPSHOT, 0, dtc, 1, buf, sizeof(buf), &len), UDS_OK);
+    TEST_INT_EQUAL(len, 21);
+    TEST_INT_EQUAL(buf[1], first);
+}
+
+void test_collect_cut_short_by_a_reset_is_resumed(void **state) {
+    // the writes of the record that takes the last free sector: its sector header, the copies of
+    // DTC 2 and 3 from sector 0, the mark of the complete copy, then the record itself
+    for (int tear = 1; tear <= 6; tear++) {
+        Setup(state);
+        uint8_t data[20] = {0};
+        for (uint32_t dtc = 1; dtc <= 3; dtc++) {
+            data[0] = (uint8_t)dtc;
+            TEST_ERR_EQUAL(UDSDTCLogWrite(&dtc_log, UDS_DTC_LOG_SNAPSHOT, 0, dtc, 1, data,
+                                          sizeof(data)),
+                           UDS_OK);
+        }
+        for (uint8_t i = 0; i < 3; i++) {
+            data[0] = (uint8_t)(0x10 + i);
+            TEST_ERR_EQUAL(
+                UDSDTCLogWrite(&dtc_log, UDS_DTC_LOG_SNAPSHOT, 0, 1, 1, data, sizeof(data)),
+                UDS_OK);
+        }
+        TEST_INT_EQUAL(dtc_log.used, 2);
+
+        flash.programs = 0;
+        flash.fail_program = tear;
+        data[0] = 0x13;
+        UDSDTCLogWrite(&dtc_log, UDS_DTC_LOG_SNAPSHOT, 0, 1, 1, data, sizeof(data));
+        flash.fail_program = 0;
+
+        // every boot after the reset finds the same records and a free sector
+        for (int boot = 0; boot < 2; boot++) {
+            Reboot();
+            TEST_INT_LT(dtc_log.used, SECTOR_COUNT);
+            ExpectSnapshot(1, 0x12);
+            ExpectSnapshot(2, 2);
+            ExpectSnapshot(3, 3);
+        }
+
+        // and the log keeps working
+        data[0] = 0x14;
+        TEST_ERR_EQUAL(UDSDTCLogWrite(&dtc_log, UDS_DTC_LOG_SNAPSHOT, 0, 1, 1, data, sizeof(data)),
+                       UDS_OK);
+        Reboot();
+        ExpectSnapshot(1, 0x14);
+        ExpectSnapshot(2, 2);
+        ExpectSnapshot(3, 3);
+    }
+}
+
+void test_full(void **state) {
+    const uint8_t DATA[] = {0x00};
+    for (uint32_t i = 0; i < INDEX_SIZE; i++) {
+        TEST_ERR_EQUAL(
+            UDSDTCLogWrite(&dtc_log, UDS_DTC_LOG_SNAPSHOT, 0, i, 1, DATA, sizeof(DATA)), UDS_OK);
+    }
+    // a new record does not fit in the index, replacing one still does
+    TEST_ERR_EQUAL(
+        UDSDTCLogWrite(&dtc_log, UDS_DTC_LOG_SNAPSHOT, 0, INDEX_SIZE, 1, DATA, sizeof(DATA)),
+        UDS_ERR_BUFSIZ);
+    TEST_ERR_EQUAL(
+        UDSDTCLogWrite(&dtc_log, UDS_DTC_LOG_SNAPSHOT, 0, 0, 1, DATA, sizeof(DATA)), UDS_OK);
+
+    // a record larger than a sector
+    uint8_t big[SECTOR_SIZE] = {0};
+    TEST_ERR_EQUAL(UDSDTCLogWrite(&dtc_log, UDS_DTC_LOG_SNAPSHOT, 0, 0, 2, big, sizeof(big)),
+                   UDS_ERR_INVALID_ARG);
+}
+
+int main(int ac, char **av) {
+    if (ac > 1) {
+        cmocka_set_test_filter(av[1]);
+    }
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_records_survive_a_reset, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_rewrites_wear_all_sectors_evenly, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_clear, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_record_cut_short_by_a_reset_is_ignored, Setup,
+                                        Teardown),
+        cmocka_unit_test_setup_teardown(test_collect_cut_short_by_a_reset_is_resumed, Setup,
+                                        Teardown),
+        cmocka_unit_test_setup_teardown(test_full, Setup, Teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
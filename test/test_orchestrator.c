@@ -0,0 +1,195 @@
+#include "test/env.h"
+#include <stdint.h>
+
+#define NUM_ECUS 2
+#define IMAGE_SIZE 64
+
+typedef struct {
+    uint8_t image[IMAGE_SIZE];  /* data received through UDS_EVT_TransferData */
+    size_t received;            /* bytes received */
+    uint32_t erase_ms;          /* time the 0x34 request is held off with 0x78 */
+    uint32_t erase_until;       /* end of the simulated erase, 0 if not started */
+    uint32_t done_at;           /* time of the 0x37 request */
+    UDSErr_t transfer_resp;     /* value returned for UDS_EVT_TransferData */
+} Ecu_t;
+
+static UDSServer_t servers[NUM_ECUS];
+static UDSClient_t clients[NUM_ECUS];
+static Ecu_t ecus[NUM_ECUS];
+static UDSFlashJob_t jobs[NUM_ECUS];
+static uint8_t IMAGE[IMAGE_SIZE];
+
+static UDSErr_t server_fn(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    Ecu_t *ecu = srv->fn_data;
+    switch (ev) {
+    case UDS_EVT_RequestDownload: {
+        UDSRequestDownloadArgs_t *args = arg;
+        if (0 == ecu->erase_until) {
+            ecu->erase_until = UDSMillis() + ecu->erase_ms;
+        }
+        if (UDSTimeAfter(ecu->erase_until, UDSMillis())) {
+            return UDS_NRC_RequestCorrectlyReceived_ResponsePending;
+        }
+        args->maxNumberOfBlockLength = 18;
+        return UDS_PositiveResponse;
+    }
+    case UDS_EVT_TransferData: {
+        UDSTransferDataArgs_t *args = arg;
+        if (UDS_PositiveResponse == ecu->transfer_resp) {
+            memcpy(&ecu->image[ecu->received], args->data, args->len);
+            ecu->received += args->len;
+        }
+        return ecu->transfer_resp;
+    }
+    case UDS_EVT_RequestTransferExit:
+        ecu->done_at = UDSMillis();
+        return UDS_PositiveResponse;
+    default:
+        return UDS_NRC_ServiceNotSupported;
+    }
+}
+
+static int client_fn(UDSClient_t *client, UDSEvent_t evt, void *ev_data) { return UDS_OK; }
+
+static void progress(UDSOrchestrator_t *orch, UDSFlashJob_t *job) {
+    int *reports = orch->fn_data;
+    reports[job - orch->jobs]++;
+}
+
+int Setup(void **state) {
+    Env_t *env = malloc(sizeof(Env_t));
+    memset(env, 0, sizeof(Env_t));
+    memset(ecus, 0, sizeof(ecus));
+    for (uint32_t i = 0; i < IMAGE_SIZE; i++) {
+        IMAGE[i] = (uint8_t)(i * 7);
+    }
+    for (uint32_t i = 0; i < NUM_ECUS; i++) {
+        UDSServerInit(&servers[i]);
+        servers[i].fn = server_fn;
+        servers[i].fn_data = &ecus[i];
+        servers[i].tp = ISOTPMockNew("server", &(ISOTPMockArgs_t){.sa_phys = 0x7E0 + i,
+                                                                  .ta_phys = 0x7E8 + i,
+                                                                  .sa_func = UDS_TP_NOOP_ADDR,
+                                                                  .ta_func = UDS_TP_NOOP_ADDR});
+        UDSClientInit(&clients[i]);
+        clients[i].fn = client_fn;
+        clients[i].tp = ISOTPMockNew("client", &(ISOTPMockArgs_t){.sa_phys = 0x7E8 + i,
+                                                                  .ta_phys = 0x7E0 + i,
+                                                                  .sa_func = UDS_TP_NOOP_ADDR,
+                                                                  .ta_func = UDS_TP_NOOP_ADDR});
+        ecus[i].transfer_resp = UDS_PositiveResponse;
+        jobs[i] = (UDSFlashJob_t){
+            .client = &clients[i],
+            .fd = -1,
+            .addressAndLengthFormatIdentifier = 0x11,
+            .memoryAddress = 0x10,
+            .src = {.data = IMAGE, .size = sizeof(IMAGE)},
+        };
+    }
+    *state = env;
+    return 0;
+}
+
+int Teardown(void **state) {
+    Env_t *env = *state;
+    for (int i = 0; i < NUM_ECUS; i++) {
+        ISOTPMockFree(servers[i].tp);
+        ISOTPMockFree(clients[i].tp);
+    }
+    ISOTPMockReset();
+    free(env);
+    return 0;
+}
+
+/* poll the orchestrator and every server until it is done */
+static void RunUntilDone(Env_t *e, UDSOrchestrator_t *orch, uint32_t timeout_ms) {
+    uint32_t deadline = UDSMillis() + timeout_ms;
+    while (!UDSOrchestratorIsDone(orch)) {
+        UDSOrchestratorPoll(orch);
+        for (int i = 0; i < NUM_ECUS; i++) {
+            UDSServerPoll(&servers[i]);
+        }
+        EnvRunMillis(e, 1);
+        TEST_INT_LE(UDSMillis(), deadline);
+    }
+}
+
+void test_downloads_overlap(void **state) {
+    Env_t *e = *state;
+    int reports[NUM_ECUS] = {0};
+
+    // when ECU 0 takes 500 ms to erase before accepting data
+    ecus[0].erase_ms = 500;
+    UDSOrchestrator_t orch;
+    EXPECT_OK(UDSOrchestratorInit(&orch, jobs, NUM_ECUS));
+    orch.progress = progress;
+    orch.fn_data = reports;
+    uint32_t start = UDSMillis();
+    RunUntilDone(e, &orch, 2000);
+
+    // both ECUs should have received the image
+    TEST_INT_EQUAL(orch.done, NUM_ECUS);
+    TEST_INT_EQUAL(orch.failed, 0);
+    for (int i = 0; i < NUM_ECUS; i++) {
+        TEST_INT_EQUAL(jobs[i].state, UDS_DOWNLOAD_DONE);
+        TEST_INT_EQUAL(ecus[i].received, IMAGE_SIZE);
+        TEST_MEMORY_EQUAL(ecus[i].image, IMAGE, IMAGE_SIZE);
+        // one report per block and one at the end
+        TEST_INT_EQUAL(reports[i], (int)clients[i].download.stats.blocks + 1);
+    }
+
+    // ECU 1 should have been flashed while ECU 0 was erasing
+    TEST_INT_LT(ecus[1].done_at, ecus[0].erase_until);
+
+    // so the whole run should take less than flashing one after the other
+    uint32_t one = ecus[1].done_at - start;
+    TEST_INT_LT(ecus[0].done_at - start, ecus[0].erase_ms + 2 * one);
+}
+
+void test_max_active_runs_jobs_in_turn(void **state) {
+    Env_t *e = *state;
+
+    // when only one job may run at a time
+    UDSOrchestrator_t orch;
+    EXPECT_OK(UDSOrchestratorInit(&orch, jobs, NUM_ECUS));
+    orch.maxActive = 1;
+    UDSOrchestratorPoll(&orch);
+    TEST_INT_EQUAL(orch.active, 1);
+    TEST_INT_EQUAL(jobs[1].state, UDS_DOWNLOAD_IDLE);
+    RunUntilDone(e, &orch, 2000);
+
+    // the second job should start after the first
+    TEST_INT_EQUAL(orch.done, NUM_ECUS);
+    TEST_INT_GE(ecus[1].done_at, ecus[0].done_at);
+}
+
+void test_failed_job_does_not_stop_others(void **state) {
+    Env_t *e = *state;
+
+    // when ECU 0 fails to program
+    ecus[0].transfer_resp = UDS_NRC_GeneralProgrammingFailure;
+    UDSOrchestrator_t orch;
+    EXPECT_OK(UDSOrchestratorInit(&orch, jobs, NUM_ECUS));
+    RunUntilDone(e, &orch, 2000);
+
+    // its job should fail with the NRC and the other ECU should still be flashed
+    TEST_INT_EQUAL(orch.failed, 1);
+    TEST_INT_EQUAL(orch.done, 1);
+    TEST_INT_EQUAL(jobs[0].state, UDS_DOWNLOAD_FAILED);
+    TEST_ERR_EQUAL(jobs[0].err, UDS_NRC_GeneralProgrammingFailure);
+    TEST_INT_EQUAL(jobs[1].state, UDS_DOWNLOAD_DONE);
+    TEST_MEMORY_EQUAL(ecus[1].image, IMAGE, IMAGE_SIZE);
+    TEST_INT_EQUAL(UDSOrchestratorNextDeadlineMs(&orch), UDS_NO_DEADLINE);
+}
+
+int main(int ac, char **av) {
+    if (ac > 1) {
+        cmocka_set_test_filter(av[1]);
+    }
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_downloads_overlap, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_max_active_runs_jobs_in_turn, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_failed_job_does_not_stop_others, Setup, Teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
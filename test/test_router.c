@@ -0,0 +1,310 @@
+#include "test/env.h"
+#include <stdint.h>
+
+// tester -> gateway (0x10, 0x11, functional 0xE400) -> ECU A (UDSServer_t), ECU B (mock server)
+typedef struct {
+    Env_t env;
+    UDSRouter_t router;
+    UDSRoute_t routes[2];
+    UDSTp_t *up[2];
+    UDSTp_t *down[2];
+    bool pending; /* ECU A responds to 0x31 with 0x78 */
+} Ctx_t;
+
+static UDSErr_t fn(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    Ctx_t *ctx = srv->fn_data;
+    switch (ev) {
+    case UDS_EVT_RoutineCtrl:
+        return ctx->pending ? UDS_NRC_RequestCorrectlyReceived_ResponsePending
+                            : UDS_PositiveResponse;
+    default:
+        return UDS_NRC_GeneralReject;
+    }
+}
+
+int Setup(void **state) {
+    Ctx_t *ctx = malloc(sizeof(Ctx_t));
+    memset(ctx, 0, sizeof(Ctx_t));
+    Env_t *e = &ctx->env;
+    e->client_tp = ISOTPMockNew("tester", &(ISOTPMockArgs_t){.sa_phys = 0xF1,
+                                                             .ta_phys = 0x10,
+                                                             .sa_func = 0xF1,
+                                                             .ta_func = 0xE400});
+    ctx->up[0] = ISOTPMockNew("gw_a", &(ISOTPMockArgs_t){.sa_phys = 0x10,
+                                                         .ta_phys = 0xF1,
+                                                         .sa_func = 0xE400,
+                                                         .ta_func = UDS_TP_NOOP_ADDR});
+    ctx->up[1] = ISOTPMockNew("gw_b", &(ISOTPMockArgs_t){.sa_phys = 0x11,
+                                                         .ta_phys = 0xF1,
+                                                         .sa_func = 0xE400,
+                                                         .ta_func = UDS_TP_NOOP_ADDR});
+    ctx->down[0] = ISOTPMockNew("link_a", &(ISOTPMockArgs_t){.sa_phys = 0x7E8,
+                                                             .ta_phys = 0x7E0,
+                                                             .sa_func = UDS_TP_NOOP_ADDR,
+                                                             .ta_func = 0x7DF});
+    ctx->down[1] = ISOTPMockNew("link_b", &(ISOTPMockArgs_t){.sa_phys = 0x7E9,
+                                                             .ta_phys = 0x7E1,
+                                                             .sa_func = UDS_TP_NOOP_ADDR,
+                                                             .ta_func = 0x7DF});
+
+    e->server = malloc(sizeof(UDSServer_t));
+    UDSServerInit(e->server);
+    e->server->fn = fn;
+    e->server->fn_data = ctx;
+    e->server->tp = ISOTPMockNew("ecu_a", &(ISOTPMockArgs_t){.sa_phys = 0x7E0,
+                                                             .ta_phys = 0x7E8,
+                                                             .sa_func = 0x7DF,
+                                                             .ta_func = UDS_TP_NOOP_ADDR});
+    e->mock_server = MockServerNew();
+    e->mock_server->tp = ISOTPMockNew("ecu_b", &(ISOTPMockArgs_t){.sa_phys = 0x7E1,
+                                                                  .ta_phys = 0x7E9,
+                                                                  .sa_func = 0x7DF,
+                                                                  .ta_func = UDS_TP_NOOP_ADDR});
+
+    // functional requests go out once, on the bus of ECU A that ECU B shares
+    ctx->routes[0] = (UDSRoute_t){.up = ctx->up[0], .ta = 0x10, .down = ctx->down[0],
+                                  .functional = true};
+    ctx->routes[1] = (UDSRoute_t){.up = ctx->up[1], .ta = 0x11, .down = ctx->down[1]};
+    EXPECT_OK(UDSRouterInit(&ctx->router, ctx->routes, 2));
+    e->router = &ctx->router;
+    *state = ctx;
+    return 0;
+}
+
+int Teardown(void **state) {
+    Ctx_t *ctx = *state;
+    Env_t *e = &ctx->env;
+    ISOTPMockFree(e->server->tp);
+    ISOTPMockFree(e->mock_server->tp);
+    ISOTPMockFree(e->client_tp);
+    for (int i = 0; i < 2; i++) {
+        ISOTPMockFree(ctx->up[i]);
+        ISOTPMockFree(ctx->down[i]);
+    }
+    ISOTPMockReset();
+    MockServerFree(e->mock_server);
+    free(e->server);
+    free(ctx);
+    return 0;
+}
+
+static ssize_t TesterRecv(Env_t *e, uint8_t *buf, size_t size, UDSSDU_t *info,
+                          uint32_t timeout_ms) {
+    ssize_t len = 0;
+    EXPECT_WITHIN_MS(e, (len = UDSTpRecv(e->client_tp, buf, size, info)) > 0, timeout_ms);
+    return len;
+}
+
+void test_requests_to_two_ecus_are_in_flight_at_once(void **state) {
+    Ctx_t *ctx = *state;
+    Env_t *e = &ctx->env;
+    ctx->pending = true;
+    MockServerAddBehavior(e->mock_server,
+                          &(struct Behavior){
+                              .tag = ExactRequestResponse,
+                              .exact_request_response = {.req_data = {0x22, 0xF1, 0x90},
+                                                         .req_len = 3,
+                                                         .resp_data = {0x62, 0xF1, 0x90, 0x42},
+                                                         .resp_len = 4,
+                                                         .delay_ms = 20},
+                          });
+
+    const uint8_t REQ_A[] = {0x31, 0x01, 0x12, 0x34};
+    const uint8_t REQ_B[] = {0x22, 0xF1, 0x90};
+    UDSTpSend(e->client_tp, REQ_A, sizeof(REQ_A), NULL);
+    UDSTpSend(e->client_tp, REQ_B, sizeof(REQ_B), &(UDSSDU_t){.A_TA = 0x11});
+
+    // ECU A keeps its request pending while ECU B answers
+    const uint8_t RCRRP[] = {0x7F, 0x31, 0x78};
+    const uint8_t RESP_B[] = {0x62, 0xF1, 0x90, 0x42};
+    uint8_t buf[16] = {0};
+    UDSSDU_t info = {0};
+    bool seen_rcrrp = false, seen_b = false;
+    while (!seen_rcrrp || !seen_b) {
+        ssize_t len = TesterRecv(e, buf, sizeof(buf), &info, UDS_CLIENT_DEFAULT_P2_MS);
+        TEST_INT_EQUAL(info.A_TA, 0xF1);
+        if (0x10 == info.A_SA) {
+            TEST_INT_EQUAL(len, sizeof(RCRRP));
+            TEST_MEMORY_EQUAL(buf, RCRRP, sizeof(RCRRP));
+            seen_rcrrp = true;
+        } else {
+            TEST_INT_EQUAL(info.A_SA, 0x11);
+            TEST_INT_EQUAL(len, sizeof(RESP_B));
+            TEST_MEMORY_EQUAL(buf, RESP_B, sizeof(RESP_B));
+            seen_b = true;
+        }
+    }
+    TEST_INT_EQUAL(ctx->routes[0].pending, true);
+    TEST_INT_EQUAL(ctx->routes[1].pending, false);
+
+    // 0x78 moved the deadline of the route to P2*, so it waits for the final response
+    EnvRunMillis(e, UDS_CLIENT_DEFAULT_P2_MS * 2);
+    TEST_INT_EQUAL(ctx->routes[0].pending, true);
+    while (UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0) {
+        TEST_MEMORY_EQUAL(buf, RCRRP, sizeof(RCRRP));
+    }
+    ctx->pending = false;
+    const uint8_t RESP_A[] = {0x71, 0x01, 0x12, 0x34};
+    ssize_t len = 0;
+    do {
+        len = TesterRecv(e, buf, sizeof(buf), &info, e->server->p2_star_ms);
+    } while (sizeof(RCRRP) == len && 0 == memcmp(buf, RCRRP, sizeof(RCRRP)));
+    TEST_INT_EQUAL(len, sizeof(RESP_A));
+    TEST_MEMORY_EQUAL(buf, RESP_A, sizeof(RESP_A));
+    TEST_INT_EQUAL(info.A_SA, 0x10);
+    TEST_INT_EQUAL(ctx->routes[0].pending, false);
+    TEST_INT_GE(ctx->routes[0].rcrrp, 1);
+    TEST_INT_EQUAL(ctx->router.requests, 2);
+    TEST_INT_EQUAL(ctx->router.timeouts, 0);
+    TEST_INT_EQUAL(ctx->router.dropped, 0);
+}
+
+void test_functional_request_reaches_every_ecu(void **state) {
+    Ctx_t *ctx = *state;
+    Env_t *e = &ctx->env;
+    MockServerAddBehavior(e->mock_server,
+                          &(struct Behavior){
+                              .tag = ExactRequestResponse,
+                              .exact_request_response = {.req_data = {0x3E, 0x00},
+                                                         .req_len = 2,
+                                                         .resp_data = {0x7E, 0x00},
+                                                         .resp_len = 2},
+                          });
+
+    const uint8_t REQ[] = {0x3E, 0x00};
+    const uint8_t RESP[] = {0x7E, 0x00};
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), &(UDSSDU_t){.A_TA_Type = UDS_A_TA_TYPE_FUNCTIONAL});
+
+    uint8_t buf[8] = {0};
+    UDSSDU_t info = {0};
+    uint32_t from = 0;
+    for (int i = 0; i < 2; i++) {
+        TEST_INT_EQUAL(TesterRecv(e, buf, sizeof(buf), &info, UDS_CLIENT_DEFAULT_P2_MS),
+                       sizeof(RESP));
+        TEST_MEMORY_EQUAL(buf, RESP, sizeof(RESP));
+        from |= 1U << (info.A_SA - 0x10);
+    }
+    TEST_INT_EQUAL(from, 0x3);
+    TEST_INT_EQUAL(ctx->router.requests, 1);
+    TEST_INT_EQUAL(ctx->router.responses, 2);
+}
+
+void test_functional_request_stays_on_its_upstream(void **state) {
+    Ctx_t *ctx = *state;
+    Env_t *e = &ctx->env;
+    MockServerAddBehavior(e->mock_server,
+                          &(struct Behavior){
+                              .tag = ExactRequestResponse,
+                              .exact_request_response = {.req_data = {0x3E, 0x00},
+                                                         .req_len = 2,
+                                                         .resp_data = {0x7E, 0x00},
+                                                         .resp_len = 2},
+                          });
+
+    // ECU B is reached through an upstream link that does not hear the functional request and
+    // serves a tester of its own
+    ISOTPMockFree(ctx->up[1]);
+    ctx->up[1] = ISOTPMockNew("gw_b", &(ISOTPMockArgs_t){.sa_phys = 0x11,
+                                                         .ta_phys = 0xF2,
+                                                         .sa_func = UDS_TP_NOOP_ADDR,
+                                                         .ta_func = UDS_TP_NOOP_ADDR});
+    ctx->routes[1].up = ctx->up[1];
+    ctx->routes[1].tester = 0xF2;
+
+    const uint8_t REQ[] = {0x3E, 0x00};
+    const uint8_t RESP[] = {0x7E, 0x00};
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), &(UDSSDU_t){.A_TA_Type = UDS_A_TA_TYPE_FUNCTIONAL});
+
+    // only ECU A answers on the link the request came from
+    uint8_t buf[8] = {0};
+    UDSSDU_t info = {0};
+    TEST_INT_EQUAL(TesterRecv(e, buf, sizeof(buf), &info, UDS_CLIENT_DEFAULT_P2_MS),
+                   sizeof(RESP));
+    TEST_MEMORY_EQUAL(buf, RESP, sizeof(RESP));
+    TEST_INT_EQUAL(info.A_SA, 0x10);
+    EnvRunMillis(e, UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_INT_EQUAL(UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL), 0);
+
+    // and ECU B keeps answering its own tester
+    TEST_INT_EQUAL(ctx->routes[1].tester, 0xF2);
+}
+
+void test_unanswered_request_frees_the_route(void **state) {
+    Ctx_t *ctx = *state;
+    Env_t *e = &ctx->env;
+    const uint8_t REQ[] = {0x22, 0xF1, 0x90}; // ECU B has no behavior for it
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), &(UDSSDU_t){.A_TA = 0x11});
+    EXPECT_WITHIN_MS(e, ctx->routes[1].pending, 5);
+    EXPECT_WITHIN_MS(e, !ctx->routes[1].pending, ctx->router.p2_ms + 5);
+    TEST_INT_EQUAL(ctx->router.timeouts, 1);
+    TEST_INT_EQUAL(UDSRouterNextDeadlineMs(&ctx->router), UDS_NO_DEADLINE);
+}
+
+static int busy_sends;
+static ssize_t (*link_send)(struct UDSTp *hdl, uint8_t *buf, size_t len, UDSSDU_t *info);
+
+static ssize_t BusySend(struct UDSTp *hdl, uint8_t *buf, size_t len, UDSSDU_t *info) {
+    if (busy_sends > 0) {
+        busy_sends--;
+        return 0;
+    }
+    return link_send(hdl, buf, len, info);
+}
+
+void test_request_waits_while_downstream_is_busy(void **state) {
+    Ctx_t *ctx = *state;
+    Env_t *e = &ctx->env;
+
+    // a transport without peek (e.g. DoIP) receives into the router's scratch buffer
+    ctx->up[0]->peek = NULL;
+    ctx->up[0]->ack = NULL;
+    link_send = ctx->down[0]->send;
+    ctx->down[0]->send = BusySend;
+    busy_sends = 3;
+
+    // When the request arrives while the link to ECU A is busy
+    const uint8_t REQ[] = {0x31, 0x01, 0x12, 0x34};
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+
+    // it should be forwarded once the link is free
+    const uint8_t RESP[] = {0x71, 0x01, 0x12, 0x34};
+    uint8_t buf[16] = {0};
+    ssize_t len = TesterRecv(e, buf, sizeof(buf), NULL, UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_INT_EQUAL(len, sizeof(RESP));
+    TEST_MEMORY_EQUAL(buf, RESP, sizeof(RESP));
+    TEST_INT_EQUAL(busy_sends, 0);
+    TEST_INT_EQUAL(ctx->router.requests, 1);
+    TEST_INT_EQUAL(ctx->router.dropped, 0);
+}
+
+void test_accept_ta_matches_routes(void **state) {
+    Ctx_t *ctx = *state;
+    assert_true(UDSRouterAcceptTA(&ctx->router, 0x10));
+    assert_true(UDSRouterAcceptTA(&ctx->router, 0x11));
+    assert_false(UDSRouterAcceptTA(&ctx->router, 0x12));
+
+    // a shared downstream transport cannot tell its ECUs apart
+    UDSRoute_t shared[2] = {ctx->routes[0], ctx->routes[1]};
+    shared[1].down = shared[0].down;
+    UDSRouter_t router;
+    TEST_ERR_EQUAL(UDSRouterInit(&router, shared, 2), UDS_ERR_INVALID_ARG);
+}
+
+int main(int ac, char **av) {
+    if (ac > 1) {
+        cmocka_set_test_filter(av[1]);
+    }
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_requests_to_two_ecus_are_in_flight_at_once, Setup,
+                                        Teardown),
+        cmocka_unit_test_setup_teardown(test_functional_request_reaches_every_ecu, Setup,
+                                        Teardown),
+        cmocka_unit_test_setup_teardown(test_functional_request_stays_on_its_upstream, Setup,
+                                        Teardown),
+        cmocka_unit_test_setup_teardown(test_unanswered_request_frees_the_route, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_request_waits_while_downstream_is_busy, Setup,
+                                        Teardown),
+        cmocka_unit_test_setup_teardown(test_accept_ta_matches_routes, Setup, Teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,193 @@
+#include "test/env.h"
+#include <stdint.h>
+
+typedef struct {
+    int polls;            /* UDS_EVT_Poll seen by the client */
+    UDSErr_t err;         /* last UDS_EVT_Err of the client */
+    uint32_t timeout_at;  /* time of the server's UDS_EVT_SessionTimeout */
+} Ctx_t;
+
+static UDSServer_t servers[2];
+static UDSClient_t client;
+
+int Setup(void **state) {
+    Env_t *env = malloc(sizeof(Env_t));
+    memset(env, 0, sizeof(Env_t));
+    env->do_not_poll = true; // the scheduler polls
+    for (uint32_t i = 0; i < 2; i++) {
+        UDSServerInit(&servers[i]);
+        servers[i].tp = ISOTPMockNew("server", &(ISOTPMockArgs_t){.sa_phys = 0x7E0 + i,
+                                                                  .ta_phys = 0x7E8 + i,
+                                                                  .sa_func = UDS_TP_NOOP_ADDR,
+                                                                  .ta_func = UDS_TP_NOOP_ADDR});
+    }
+    UDSClientInit(&client);
+    env->client_tp = ISOTPMockNew("client", &(ISOTPMockArgs_t){.sa_phys = 0x7E8,
+                                                               .ta_phys = 0x7E0,
+                                                               .sa_func = UDS_TP_NOOP_ADDR,
+                                                               .ta_func = UDS_TP_NOOP_ADDR});
+    client.tp = env->client_tp;
+    *state = env;
+    return 0;
+}
+
+int Teardown(void **state) {
+    Env_t *env = *state;
+    for (int i = 0; i < 2; i++) {
+        ISOTPMockFree(servers[i].tp);
+    }
+    ISOTPMockFree(env->client_tp);
+    ISOTPMockReset();
+    free(env);
+    return 0;
+}
+
+static UDSErr_t server_fn(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    Ctx_t *ctx = srv->fn_data;
+    if (UDS_EVT_SessionTimeout == ev) {
+        ctx->timeout_at = UDSMillis();
+    }
+    return UDS_PositiveResponse;
+}
+
+static int client_fn(UDSClient_t *c, UDSEvent_t evt, void *ev_data) {
+    Ctx_t *ctx = c->fn_data;
+    if (UDS_EVT_Poll == evt) {
+        ctx->polls++;
+    } else if (UDS_EVT_Err == evt) {
+        ctx->err = *(UDSErr_t *)ev_data;
+    }
+    return UDS_OK;
+}
+
+/* poll the scheduler once per millisecond */
+static void Run(Env_t *e, UDSScheduler_t *sched, uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++) {
+        UDSSchedulerPoll(sched);
+        EnvRunMillis(e, 1);
+    }
+}
+
+void test_idle_server_is_polled_once_woken(void **state) {
+    Env_t *e = *state;
+    Ctx_t ctx = {0};
+    servers[0].fn = server_fn;
+    servers[0].fn_data = &ctx;
+    UDSScheduler_t sched;
+    EXPECT_OK(UDSSchedulerInit(&sched));
+    UDSSchedEntry_t *entry = UDSSchedulerAddServer(&sched, &servers[0]);
+    assert_non_null(entry);
+
+    // a server in the default session with nothing to send has no deadline
+    uint32_t added = UDSMillis();
+    Run(e, &sched, 100);
+    TEST_INT_EQUAL(servers[0].now, added);
+    TEST_INT_EQUAL(UDSSchedulerNextDeadlineMs(&sched), UDS_NO_DEADLINE);
+
+    // until its transport receives a request
+    const uint8_t REQ[] = {0x3E, 0x00};
+    const uint8_t RESP[] = {0x7E, 0x00};
+    uint8_t buf[8] = {0};
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+    EnvRunMillis(e, 1); // the mock network delivers it 1 ms later
+    UDSSchedulerWake(&sched, entry);
+    TEST_INT_EQUAL(UDSSchedulerNextDeadlineMs(&sched), 0);
+    Run(e, &sched, 2); // receive, then respond
+    UDSTpPoll(e->client_tp);
+    TEST_INT_EQUAL(UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL), sizeof(RESP));
+    TEST_MEMORY_EQUAL(buf, RESP, sizeof(RESP));
+}
+
+void test_servers_are_polled_at_their_deadlines(void **state) {
+    Env_t *e = *state;
+    Ctx_t ctx[2] = {0};
+    UDSScheduler_t sched;
+    EXPECT_OK(UDSSchedulerInit(&sched));
+
+    // two servers in the extended session, timing out 100 ms apart
+    uint32_t start = UDSMillis();
+    for (int i = 0; i < 2; i++) {
+        servers[i].fn = server_fn;
+        servers[i].fn_data = &ctx[i];
+        servers[i].sessionType = UDS_LEV_DS_EXTDS;
+        servers[i].s3_session_timeout_timer = start + 100 * (uint32_t)(i + 1);
+    }
+    // added in the reverse order of their deadlines
+    assert_non_null(UDSSchedulerAddServer(&sched, &servers[1]));
+    assert_non_null(UDSSchedulerAddServer(&sched, &servers[0]));
+    Run(e, &sched, 1);
+    TEST_INT_EQUAL(UDSSchedulerNextDeadlineMs(&sched), 100);
+
+    Run(e, &sched, 150);
+    TEST_INT_EQUAL(ctx[0].timeout_at, start + 101);
+    TEST_INT_EQUAL(ctx[1].timeout_at, 0);
+    // the second server has not been polled since it was added
+    TEST_INT_EQUAL(servers[1].now, start);
+
+    Run(e, &sched, 100);
+    TEST_INT_EQUAL(ctx[1].timeout_at, start + 201);
+    TEST_INT_EQUAL(UDSSchedulerNextDeadlineMs(&sched), UDS_NO_DEADLINE);
+}
+
+void test_client_is_polled_at_its_p2_timeout(void **state) {
+    Env_t *e = *state;
+    Ctx_t ctx = {0};
+    client.fn = client_fn;
+    client.fn_data = &ctx;
+    UDSScheduler_t sched;
+    EXPECT_OK(UDSSchedulerInit(&sched));
+    assert_non_null(UDSSchedulerAddClient(&sched, &client));
+
+    // the server is not polled, so the request times out
+    EXPECT_OK(UDSSendTesterPresent(&client));
+    Run(e, &sched, client.p2_ms + 10);
+    TEST_INT_EQUAL(ctx.err, UDS_ERR_TIMEOUT);
+
+    // polled while sending and once at the timeout, not on every pass
+    TEST_INT_LE(ctx.polls, 4);
+}
+
+void test_deferred_server_is_polled_later(void **state) {
+    Env_t *e = *state;
+    Ctx_t ctx = {0};
+    servers[0].fn = server_fn;
+    servers[0].fn_data = &ctx;
+    UDSScheduler_t sched;
+    EXPECT_OK(UDSSchedulerInit(&sched));
+    UDSSchedEntry_t *entry = UDSSchedulerAddServer(&sched, &servers[0]);
+    Run(e, &sched, 1);
+    TEST_INT_EQUAL(UDSSchedulerNextDeadlineMs(&sched), UDS_NO_DEADLINE);
+
+    // an idle server is polled again after the delay
+    uint32_t deferred = sched.now;
+    UDSSchedulerDefer(&sched, entry, 10);
+    Run(e, &sched, 9);
+    TEST_INT_EQUAL(servers[0].now, deferred);
+    Run(e, &sched, 2);
+    TEST_INT_EQUAL(servers[0].now, deferred + 10);
+}
+
+void test_full(void **state) {
+    (void)state;
+    UDSScheduler_t sched;
+    EXPECT_OK(UDSSchedulerInit(&sched));
+    for (int i = 0; i < UDS_SCHEDULER_MAX_ENTRIES; i++) {
+        assert_non_null(UDSSchedulerAddServer(&sched, &servers[0]));
+    }
+    TEST_PTR_EQUAL(UDSSchedulerAddClient(&sched, &client), NULL);
+}
+
+int main(int ac, char **av) {
+    if (ac > 1) {
+        cmocka_set_test_filter(av[1]);
+    }
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_idle_server_is_polled_once_woken, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_servers_are_polled_at_their_deadlines, Setup,
+                                        Teardown),
+        cmocka_unit_test_setup_teardown(test_client_is_polled_at_its_p2_timeout, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_deferred_server_is_polled_later, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_full, Setup, Teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
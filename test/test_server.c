@@ -4,6 +4,7 @@
 int Setup(void **state) {
     Env_t *env = malloc(sizeof(Env_t));
     memset(env, 0, sizeof(Env_t));
+    env->event_driven = true;
     env->server = malloc(sizeof(UDSServer_t));
     UDSServerInit(env->server);
     env->server->tp = ISOTPMockNew("server", &(ISOTPMockArgs_t){.sa_phys = 0x7E0,
@@ -28,6 +29,16 @@ int Teardown(void **state) {
     return 0;
 }
 
+/* send a request from the client and expect exactly `resp` back within p2 */
+static void Exchange(Env_t *e, const uint8_t *req, size_t req_len, const uint8_t *resp,
+                     size_t resp_len) {
+    uint8_t buf[UDS_TP_MTU] = {0};
+    UDSTpSend(e->client_tp, req, req_len, NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == (ssize_t)resp_len,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, resp, resp_len);
+}
+
 int fn_test_session_timeout(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
     int *call_count = (int *)srv->fn_data;
     TEST_INT_EQUAL(UDS_EVT_SessionTimeout, ev);
@@ -67,6 +78,72 @@ void test_programming_session_times_out(void **state) {
     TEST_INT_GE(call_count, 1);
 }
 
+void test_next_deadline_idle(void **state) {
+    Env_t *e = *state;
+
+    // A server in the default session with no request pending has nothing to wait for
+    TEST_INT_EQUAL(UDSServerNextDeadlineMs(e->server), UDS_NO_DEADLINE);
+}
+
+void test_next_deadline_session_timeout(void **state) {
+    Env_t *e = *state;
+    int call_count = 0;
+    e->server->fn = fn_test_session_timeout;
+    e->server->fn_data = &call_count;
+    e->server->sessionType = UDS_LEV_DS_PRGS;
+    e->server->s3_session_timeout_timer = UDSMillis() + e->server->s3_ms;
+    e->do_not_poll = true;
+
+    // the deadline should be the session timeout
+    uint32_t ms = UDSServerNextDeadlineMs(e->server);
+    TEST_INT_EQUAL(ms, e->server->s3_ms + 1);
+
+    // polling before the deadline does nothing
+    EnvRunMillis(e, ms - 1);
+    UDSServerPoll(e->server);
+    TEST_INT_EQUAL(call_count, 0);
+
+    // polling at the deadline times the session out
+    EnvRunMillis(e, 1);
+    UDSServerPoll(e->server);
+    TEST_INT_EQUAL(call_count, 1);
+    TEST_INT_EQUAL(UDSServerNextDeadlineMs(e->server), UDS_NO_DEADLINE);
+}
+
+int fn_test_next_deadline(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    return *(int *)srv->fn_data;
+}
+
+void test_next_deadline_response_pending(void **state) {
+    Env_t *e = *state;
+    int resp = UDS_NRC_RequestCorrectlyReceived_ResponsePending;
+    e->server->fn = fn_test_next_deadline;
+    e->server->fn_data = &resp;
+
+    // When a request is received
+    const uint8_t REQ[] = {0x31, 0x01, 0x12, 0x34};
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+    EXPECT_WITHIN_MS(e, e->server->requestInProgress, 10);
+    e->do_not_poll = true;
+
+    // the deadline should be the next 0x78 response
+    uint32_t ms = UDSServerNextDeadlineMs(e->server);
+    TEST_INT_GE(ms, 1);
+    TEST_INT_LE(ms, e->server->p2_ms + 1);
+
+    // which is not sent before the deadline
+    uint32_t p2_timer = e->server->p2_timer;
+    EnvRunMillis(e, ms - 1);
+    UDSServerPoll(e->server);
+    TEST_INT_EQUAL(e->server->p2_timer, p2_timer);
+
+    // but is sent at the deadline
+    EnvRunMillis(e, 1);
+    UDSServerPoll(e->server);
+    TEST_INT_NE(e->server->p2_timer, p2_timer);
+    TEST_INT_EQUAL(e->server->requestInProgress, true);
+}
+
 void test_0x10_no_fn_results_in_negative_resp(void **state) {
     Env_t *e = *state;
     uint8_t buf[8] = {0};
@@ -262,6 +339,227 @@ void test_0x14_negative_response(void **state) {
     TEST_MEMORY_EQUAL(buf, EXPECTED_RESP, sizeof(EXPECTED_RESP));
 }
 
+static UDSErr_t fn_test_dtc_store(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    // with a DTC store, 0x19 status mask requests must not reach the application
+    TEST_INT_EQUAL(ev, UDS_EVT_ClearDiagnosticInfo);
+    return UDS_PositiveResponse;
+}
+
+/* 36 DTCs so the status bitmaps span two words */
+#define TEST_DTC_COUNT 36
+static UDSDTCRecord_t test_dtcs[TEST_DTC_COUNT];
+static uint32_t test_dtc_bitmaps[UDS_DTC_BITMAP_SIZE(TEST_DTC_COUNT)];
+static UDSDTCStore_t test_dtc_store;
+
+static void DTCStoreSetup(Env_t *e) {
+    // registered in descending order to exercise sorting
+    for (int i = 0; i < TEST_DTC_COUNT; i++) {
+        uint32_t dtc = 0x010000 + (uint32_t)(TEST_DTC_COUNT - i);
+        test_dtcs[i] = (UDSDTCRecord_t){
+            .dtc = {(uint8_t)(dtc >> 16), (uint8_t)(dtc >> 8), (uint8_t)dtc}, .status = 0};
+    }
+    TEST_INT_EQUAL(UDSDTCStoreInit(&test_dtc_store, test_dtcs, TEST_DTC_COUNT, test_dtc_bitmaps,
+                                   0x7F),
+                   UDS_OK);
+    e->server->fn = fn_test_dtc_store;
+    UDSServerRegisterDTCStore(e->server, &test_dtc_store);
+}
+
+void test_0x19_dtc_store(void **state) {
+    Env_t *e = *state;
+    DTCStoreSetup(e);
+
+    // confirm one DTC in each bitmap word; WIR is not in the availability mask
+    UDSDTCStoreSetStatus(&test_dtc_store, 0x010002, UDS_DTC_STATUS_CDTC | UDS_DTC_STATUS_WIR);
+    UDSDTCStoreSetStatus(&test_dtc_store, 0x010022, UDS_DTC_STATUS_CDTC | UDS_DTC_STATUS_TF);
+    UDSDTCStoreSetStatus(&test_dtc_store, 0x010010, UDS_DTC_STATUS_PDTC);
+    TEST_INT_EQUAL(UDSDTCStoreFind(&test_dtc_store, 0x010002)->status, UDS_DTC_STATUS_CDTC);
+
+    const uint8_t COUNT[] = {0x19, 0x01, UDS_DTC_STATUS_CDTC};
+    const uint8_t COUNT_RESP[] = {0x59, 0x01, 0x7F, UDS_DTC_FORMAT_ISO14229_1, 0x00, 0x02};
+    Exchange(e, COUNT, sizeof(COUNT), COUNT_RESP, sizeof(COUNT_RESP));
+
+    // a DTC matches if any bit of the mask is set
+    const uint8_t LIST[] = {0x19, 0x02, UDS_DTC_STATUS_CDTC | UDS_DTC_STATUS_PDTC};
+    const uint8_t LIST_RESP[] = {0x59, 0x02, 0x7F, 0x01, 0x00, 0x02, 0x08, 0x01, 0x00,
+                                 0x10, 0x04, 0x01, 0x00, 0x22, 0x09};
+    Exchange(e, LIST, sizeof(LIST), LIST_RESP, sizeof(LIST_RESP));
+
+    // reportSupportedDTC lists every DTC in order
+    const uint8_t SUPPORTED[] = {0x19, 0x0A};
+    uint8_t supported_resp[3 + TEST_DTC_COUNT * 4] = {0x59, 0x0A, 0x7F};
+    for (int i = 0; i < TEST_DTC_COUNT; i++) {
+        uint32_t dtc = 0x010001 + (uint32_t)i;
+        uint8_t *rec = &supported_resp[3 + i * 4];
+        rec[0] = (uint8_t)(dtc >> 16);
+        rec[1] = (uint8_t)(dtc >> 8);
+        rec[2] = (uint8_t)dtc;
+        rec[3] = UDSDTCStoreFind(&test_dtc_store, dtc)->status;
+    }
+    Exchange(e, SUPPORTED, sizeof(SUPPORTED), supported_resp, sizeof(supported_resp));
+}
+
+void test_0x14_dtc_store(void **state) {
+    Env_t *e = *state;
+    DTCStoreSetup(e);
+    UDSDTCStoreSetStatus(&test_dtc_store, 0x010002, UDS_DTC_STATUS_CDTC);
+    UDSDTCStoreSetStatus(&test_dtc_store, 0x010022, UDS_DTC_STATUS_CDTC);
+
+    // clearing a single DTC
+    const uint8_t CLEAR_ONE[] = {0x14, 0x01, 0x00, 0x02};
+    const uint8_t CLEAR_RESP[] = {0x54};
+    Exchange(e, CLEAR_ONE, sizeof(CLEAR_ONE), CLEAR_RESP, sizeof(CLEAR_RESP));
+    TEST_INT_EQUAL(UDSDTCStoreFind(&test_dtc_store, 0x010002)->status, UDS_DTC_STATUS_CLEARED);
+    TEST_INT_EQUAL(UDSDTCStoreCountByMask(&test_dtc_store, UDS_DTC_STATUS_CDTC), 1);
+
+    // an unknown DTC is out of range
+    const uint8_t CLEAR_UNKNOWN[] = {0x14, 0x02, 0x00, 0x00};
+    const uint8_t OUT_OF_RANGE[] = {0x7F, 0x14, 0x31};
+    Exchange(e, CLEAR_UNKNOWN, sizeof(CLEAR_UNKNOWN), OUT_OF_RANGE, sizeof(OUT_OF_RANGE));
+
+    // and so is a functional group until it is defined
+    const uint8_t CLEAR_EMISSIONS[] = {0x14, 0xFF, 0xFF, 0x33};
+    Exchange(e, CLEAR_EMISSIONS, sizeof(CLEAR_EMISSIONS), OUT_OF_RANGE, sizeof(OUT_OF_RANGE));
+    TEST_INT_EQUAL(UDSDTCStoreCountByMask(&test_dtc_store, UDS_DTC_STATUS_CDTC), 1);
+
+    // a group of two ranges clears the DTCs of both and leaves the others
+    const UDSDTCGroup_t GROUPS[] = {
+        {.group = 0xFFFF33, .first = 0x010010, .last = 0x010014},
+        {.group = 0xFFFFD0, .first = 0x010000, .last = 0x0100FF},
+        {.group = 0xFFFF33, .first = 0x010020, .last = 0x010021},
+    };
+    TEST_ERR_EQUAL(UDSDTCStoreSetGroups(&test_dtc_store, GROUPS, 3), UDS_OK);
+    UDSDTCStoreSetStatus(&test_dtc_store, 0x010012, UDS_DTC_STATUS_CDTC);
+    UDSDTCStoreSetStatus(&test_dtc_store, 0x010021, UDS_DTC_STATUS_CDTC);
+    Exchange(e, CLEAR_EMISSIONS, sizeof(CLEAR_EMISSIONS), CLEAR_RESP, sizeof(CLEAR_RESP));
+    TEST_INT_EQUAL(UDSDTCStoreFind(&test_dtc_store, 0x010012)->status, UDS_DTC_STATUS_CLEARED);
+    TEST_INT_EQUAL(UDSDTCStoreFind(&test_dtc_store, 0x010021)->status, UDS_DTC_STATUS_CLEARED);
+    TEST_INT_EQUAL(UDSDTCStoreCountByMask(&test_dtc_store, UDS_DTC_STATUS_CDTC), 1);
+    TEST_INT_EQUAL(UDSDTCStoreFind(&test_dtc_store, 0x010022)->status, UDS_DTC_STATUS_CDTC);
+
+    // clearing all DTCs
+    const uint8_t CLEAR_ALL[] = {0x14, 0xFF, 0xFF, 0xFF};
+    Exchange(e, CLEAR_ALL, sizeof(CLEAR_ALL), CLEAR_RESP, sizeof(CLEAR_RESP));
+    TEST_INT_EQUAL(UDSDTCStoreCountByMask(&test_dtc_store, UDS_DTC_STATUS_CDTC), 0);
+    TEST_INT_EQUAL(UDSDTCStoreCountByMask(&test_dtc_store, UDS_DTC_STATUS_TNCSLC), TEST_DTC_COUNT);
+}
+
+static uint8_t test_dtc_flash[4 * 256];
+static UDSDTCLogEntry_t test_dtc_log_index[8];
+static UDSDTCLog_t test_dtc_log;
+
+static UDSErr_t DTCFlashRead(void *ctx, uint32_t addr, void *dst, size_t len) {
+    memcpy(dst, &test_dtc_flash[addr], len);
+    return UDS_OK;
+}
+
+static UDSErr_t DTCFlashProgram(void *ctx, uint32_t addr, const void *src, size_t len) {
+    memcpy(&test_dtc_flash[addr], src, len);
+    return UDS_OK;
+}
+
+static UDSErr_t DTCFlashErase(void *ctx, uint32_t addr) {
+    memset(&test_dtc_flash[addr], 0xFF, 256);
+    return UDS_OK;
+}
+
+static const UDSDTCFlash_t test_dtc_flash_driver = {
+    .read = DTCFlashRead,
+    .program = DTCFlashProgram,
+    .erase = DTCFlashErase,
+    .sectorSize = 256,
+    .sectorCount = 4,
+};
+
+static void DTCLogSetup(Env_t *e) {
+    DTCStoreSetup(e);
+    memset(test_dtc_flash, 0xFF, sizeof(test_dtc_flash));
+    TEST_ERR_EQUAL(UDSDTCLogInit(&test_dtc_log, &test_dtc_flash_driver, test_dtc_log_index,
+                                 sizeof(test_dtc_log_index) / sizeof(test_dtc_log_index[0])),
+                   UDS_OK);
+    UDSServerRegisterDTCLog(e->server, &test_dtc_log);
+    UDSDTCStoreSetStatus(&test_dtc_store, 0x010002, UDS_DTC_STATUS_CDTC);
+
+    const uint8_t SNAP1[] = {0x01, 0xF1, 0x90, 0xAA};
+    const uint8_t SNAP2[] = {0x01, 0xF1, 0x90, 0xBB};
+    const uint8_t EXT[] = {0x05};
+    UDSDTCLogWrite(&test_dtc_log, UDS_DTC_LOG_SNAPSHOT, 0, 0x010002, 1, SNAP1, sizeof(SNAP1));
+    UDSDTCLogWrite(&test_dtc_log, UDS_DTC_LOG_SNAPSHOT, 0, 0x010002, 2, SNAP2, sizeof(SNAP2));
+    UDSDTCLogWrite(&test_dtc_log, UDS_DTC_LOG_EXT_DATA, 0, 0x010002, 0x10, EXT, sizeof(EXT));
+    UDSDTCLogWrite(&test_dtc_log, UDS_DTC_LOG_EXT_DATA, 3, 0x010002, 0x10, EXT, sizeof(EXT));
+}
+
+void test_0x19_dtc_log(void **state) {
+    Env_t *e = *state;
+    DTCLogSetup(e);
+
+    // reportDTCSnapshotRecordByDTCNumber, all records and a single one
+    const uint8_t SNAP_ALL[] = {0x19, 0x04, 0x01, 0x00, 0x02, 0xFF};
+    const uint8_t SNAP_ALL_RESP[] = {0x59, 0x04, 0x01, 0x00, 0x02, 0x08, 0x01, 0x01,
+                                     0xF1, 0x90, 0xAA, 0x02, 0x01, 0xF1, 0x90, 0xBB};
+    Exchange(e, SNAP_ALL, sizeof(SNAP_ALL), SNAP_ALL_RESP, sizeof(SNAP_ALL_RESP));
+    const uint8_t SNAP_2[] = {0x19, 0x04, 0x01, 0x00, 0x02, 0x02};
+    const uint8_t SNAP_2_RESP[] = {0x59, 0x04, 0x01, 0x00, 0x02, 0x08,
+                                   0x02, 0x01, 0xF1, 0x90, 0xBB};
+    Exchange(e, SNAP_2, sizeof(SNAP_2), SNAP_2_RESP, sizeof(SNAP_2_RESP));
+
+    // reportDTCExtDataRecordByDTCNumber, and a DTC in the store without records
+    const uint8_t EXT[] = {0x19, 0x06, 0x01, 0x00, 0x02, 0xFF};
+    const uint8_t EXT_RESP[] = {0x59, 0x06, 0x01, 0x00, 0x02, 0x08, 0x10, 0x05};
+    Exchange(e, EXT, sizeof(EXT), EXT_RESP, sizeof(EXT_RESP));
+    const uint8_t EXT_NONE[] = {0x19, 0x06, 0x01, 0x00, 0x03, 0xFF};
+    const uint8_t EXT_NONE_RESP[] = {0x59, 0x06, 0x01, 0x00, 0x03, 0x00};
+    Exchange(e, EXT_NONE, sizeof(EXT_NONE), EXT_NONE_RESP, sizeof(EXT_NONE_RESP));
+
+    // reportUserDefMemoryDTCExtDataRecordByDTCNumber
+    const uint8_t USER_EXT[] = {0x19, 0x19, 0x01, 0x00, 0x02, 0x10, 0x03};
+    const uint8_t USER_EXT_RESP[] = {0x59, 0x19, 0x03, 0x01, 0x00, 0x02, 0x08, 0x10, 0x05};
+    Exchange(e, USER_EXT, sizeof(USER_EXT), USER_EXT_RESP, sizeof(USER_EXT_RESP));
+
+    // a DTC that is not in the store
+    const uint8_t UNKNOWN[] = {0x19, 0x04, 0x02, 0x00, 0x00, 0xFF};
+    const uint8_t OUT_OF_RANGE[] = {0x7F, 0x19, 0x31};
+    Exchange(e, UNKNOWN, sizeof(UNKNOWN), OUT_OF_RANGE, sizeof(OUT_OF_RANGE));
+}
+
+void test_0x14_dtc_log(void **state) {
+    Env_t *e = *state;
+    DTCLogSetup(e);
+
+    // clearing the primary memory keeps the records of user defined memory 3
+    const uint8_t CLEAR[] = {0x14, 0xFF, 0xFF, 0xFF};
+    const uint8_t CLEAR_RESP[] = {0x54};
+    Exchange(e, CLEAR, sizeof(CLEAR), CLEAR_RESP, sizeof(CLEAR_RESP));
+    const uint8_t SNAP_ALL[] = {0x19, 0x04, 0x01, 0x00, 0x02, 0xFF};
+    const uint8_t SNAP_ALL_RESP[] = {0x59, 0x04, 0x01, 0x00, 0x02, 0x50};
+    Exchange(e, SNAP_ALL, sizeof(SNAP_ALL), SNAP_ALL_RESP, sizeof(SNAP_ALL_RESP));
+    TEST_INT_EQUAL(test_dtc_log.indexCount, 1);
+
+    const uint8_t CLEAR_MEM[] = {0x14, 0x01, 0x00, 0x02, 0x03};
+    Exchange(e, CLEAR_MEM, sizeof(CLEAR_MEM), CLEAR_RESP, sizeof(CLEAR_RESP));
+    TEST_INT_EQUAL(test_dtc_log.indexCount, 0);
+}
+
+void test_0x14_dtc_log_group(void **state) {
+    Env_t *e = *state;
+    DTCLogSetup(e);
+    const uint8_t EXT[] = {0x07};
+    UDSDTCLogWrite(&test_dtc_log, UDS_DTC_LOG_EXT_DATA, 0, 0x010010, 0x10, EXT, sizeof(EXT));
+    const UDSDTCGroup_t GROUPS[] = {{.group = 0xFFFF33, .first = 0x010001, .last = 0x010003}};
+    TEST_ERR_EQUAL(UDSDTCStoreSetGroups(&test_dtc_store, GROUPS, 1), UDS_OK);
+
+    // the records of 0x010002 are in the group, those of 0x010010 are not
+    const uint8_t CLEAR[] = {0x14, 0xFF, 0xFF, 0x33};
+    const uint8_t CLEAR_RESP[] = {0x54};
+    Exchange(e, CLEAR, sizeof(CLEAR), CLEAR_RESP, sizeof(CLEAR_RESP));
+    const uint8_t SNAP_ALL[] = {0x19, 0x04, 0x01, 0x00, 0x02, 0xFF};
+    const uint8_t SNAP_ALL_RESP[] = {0x59, 0x04, 0x01, 0x00, 0x02, 0x50};
+    Exchange(e, SNAP_ALL, sizeof(SNAP_ALL), SNAP_ALL_RESP, sizeof(SNAP_ALL_RESP));
+    const uint8_t EXT_KEPT[] = {0x19, 0x06, 0x01, 0x00, 0x10, 0xFF};
+    const uint8_t EXT_KEPT_RESP[] = {0x59, 0x06, 0x01, 0x00, 0x10, 0x00, 0x10, 0x07};
+    Exchange(e, EXT_KEPT, sizeof(EXT_KEPT), EXT_KEPT_RESP, sizeof(EXT_KEPT_RESP));
+}
+
 // Container to provide data and length to the 0x19 handler function
 typedef struct {
     void *data;
@@ -2532,175 +2830,772 @@ void test_0x22_misuse(void **state) {
     TEST_MEMORY_EQUAL(buf, RESP, sizeof(RESP));
 }
 
-int fn_test_0x23(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
-    TEST_INT_EQUAL(ev, UDS_EVT_ReadMemByAddr);
-    UDSReadMemByAddrArgs_t *r = (UDSReadMemByAddrArgs_t *)arg;
-    TEST_PTR_EQUAL(r->memAddr, (void *)0x20481392);
-    TEST_INT_EQUAL(r->memSize, 259);
-    return r->copy(srv, srv->fn_data, r->memSize);
+static uint8_t did_0x0110[] = {0x8C};
+static uint8_t did_0x0200[] = {0x01, 0x02};
+
+UDSErr_t read_did_0x010A(UDSServer_t *srv, const UDSDIDEntry_t *entry, uint8_t *dst) {
+    const uint8_t data[] = {0xA6, 0x66, 0x07, 0x50, 0x20, 0x1A, 0x00, 0x63, 0x4A, 0x82, 0x7E};
+    TEST_INT_EQUAL(entry->len, sizeof(data));
+    memcpy(dst, data, sizeof(data));
+    return UDS_PositiveResponse;
 }
 
-void test_0x23(void **state) {
-    Env_t *e = *state;
-    uint8_t buf[512] = {0};
+static UDSDIDEntry_t did_table[] = {
+    {.did = 0x0200, .len = sizeof(did_0x0200), .ptr = did_0x0200,
+     .access = UDS_DID_READ | UDS_DID_WRITE, .sessionMask = UDS_SESSION_BIT(UDS_LEV_DS_EXTDS)},
+    {.did = 0x0110, .len = sizeof(did_0x0110), .ptr = did_0x0110, .access = UDS_DID_READ},
+    {.did = 0x010A, .len = 11, .read = read_did_0x010A, .access = UDS_DID_READ},
+    {.did = 0xF190, .access = UDS_DID_READ}, /* computed: served by fn_test_0x22 */
+};
 
-    uint8_t FakeData[259];
-    for (int i = 0; i < sizeof(FakeData); i++) {
-        FakeData[i] = i % 256;
-    }
+// 11.2.5.2 Example #2 read multiple dataIdentifiers 0x010A and 0x0110 from the DID table
+typedef struct {
+    UDSPendingToken_t token;
+    int calls[3]; /* calls per DID */
+} DeferDIDCtx_t;
 
-    uint8_t EXPECTED_RESP[sizeof(FakeData) + 1] = {0x63}; // SID 0x23 + 0x40
-    for (int i = 0; i < sizeof(FakeData); i++) {
-        EXPECTED_RESP[i + 1] = FakeData[i];
+// 0x0001 and 0x0003 are answered right away, 0x0002 is deferred
+int fn_test_0x22_defer_one_did(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    DeferDIDCtx_t *ctx = srv->fn_data;
+    TEST_INT_EQUAL(UDS_EVT_ReadDataByIdent, ev);
+    UDSRDBIArgs_t *r = (UDSRDBIArgs_t *)arg;
+    TEST_INT_LE(r->dataId, 3);
+    ctx->calls[r->dataId - 1]++;
+    if (0x0002 == r->dataId) {
+        return UDSServerDeferResponse(srv, &ctx->token);
     }
+    const uint8_t data = (uint8_t)(r->dataId * 0x11);
+    return r->copy(srv, &data, sizeof(data));
+}
 
-    e->server->fn = fn_test_0x23;
-    e->server->fn_data = FakeData;
-
-    // Request per ISO14229-1 2020 Table 200
-    const uint8_t REQ[] = {
-        0x23, // SID
-        0x24, // AddressAndLengthFormatIdentifier
-        0x20, // memoryAddress byte #1 (MSB)
-        0x48, // memoryAddress byte #2
-        0x13, // memoryAddress byte #3
-        0x92, // memoryAddress byte #4 (LSB)
-        0x01, // memorySize byte #1 (MSB)
-        0x03, // memorySize byte #2 (LSB)
-    };
+void test_0x22_deferred_did_among_several(void **state) {
+    Env_t *e = *state;
+    DeferDIDCtx_t ctx = {0};
+    e->server->fn = fn_test_0x22_defer_one_did;
+    e->server->fn_data = &ctx;
 
+    const uint8_t REQ[] = {0x22, 0x00, 0x01, 0x00, 0x02, 0x00, 0x03};
+    const uint8_t RCRRP[] = {0x7F, 0x22, 0x78};
+    uint8_t buf[16] = {0};
     UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
-
-    // the client transport should receive a positive response within client_p2 ms
     EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
                      UDS_CLIENT_DEFAULT_P2_MS);
-    TEST_MEMORY_EQUAL(buf, EXPECTED_RESP, sizeof(EXPECTED_RESP));
+    TEST_MEMORY_EQUAL(buf, RCRRP, sizeof(RCRRP));
+
+    // the result belongs to 0x0002 and not to the first DID read again
+    const uint8_t DATA[] = {0x22};
+    TEST_ERR_EQUAL(UDS_OK, UDSServerCompleteResponse(e->server, ctx.token, UDS_PositiveResponse,
+                                                     DATA, sizeof(DATA)));
+    const uint8_t RESP[] = {0x62, 0x00, 0x01, 0x11, 0x00, 0x02, 0x22, 0x00, 0x03, 0x33};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == sizeof(RESP),
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, RESP, sizeof(RESP));
+    TEST_INT_EQUAL(ctx.calls[1], 1);
+    TEST_INT_EQUAL(ctx.calls[2], 1);
 }
 
-typedef struct {
-    const void *expectedMemAddr;
-    const size_t expectedMemSize;
-    const void *expectedMemData;
-} Test0x3DTestFnData_t;
+void test_0x22_did_table(void **state) {
+    Env_t *e = *state;
+    uint8_t buf[64] = {0};
+    e->server->fn = fn_test_0x22;
+    TEST_ERR_EQUAL(UDSServerRegisterDIDs(e->server, did_table,
+                                         sizeof(did_table) / sizeof(did_table[0])),
+                   UDS_OK);
 
-int fn_test_0x3D(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
-    Test0x3DTestFnData_t *fnData = (Test0x3DTestFnData_t *)srv->fn_data;
+    const uint8_t REQ[] = {0x22, 0x01, 0x0A, 0x01, 0x10, 0xF1, 0x90};
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
 
-    TEST_INT_EQUAL(ev, UDS_EVT_WriteMemByAddr);
-    UDSWriteMemByAddrArgs_t *r = (UDSWriteMemByAddrArgs_t *)arg;
+    const uint8_t RESP[] = {0x62, 0x01, 0x0A, 0xA6, 0x66, 0x07, 0x50, 0x20, 0x1A, 0x00, 0x63,
+                            0x4A, 0x82, 0x7E, 0x01, 0x10, 0x8C, 0xF1, 0x90, 0x57, 0x30, 0x4C,
+                            0x30, 0x30, 0x30, 0x30, 0x34, 0x33, 0x4D, 0x42, 0x35, 0x34, 0x31,
+                            0x33, 0x32, 0x36};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == sizeof(RESP),
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, RESP, sizeof(RESP));
+}
 
-    TEST_PTR_EQUAL(r->memAddr, fnData->expectedMemAddr);
-    TEST_INT_EQUAL(r->memSize, fnData->expectedMemSize);
-    TEST_MEMORY_EQUAL(r->data, fnData->expectedMemData, r->memSize);
+void test_0x22_did_table_wrong_session(void **state) {
+    Env_t *e = *state;
+    uint8_t buf[8] = {0};
+    e->server->fn = fn_test_0x22;
+    UDSServerRegisterDIDs(e->server, did_table, sizeof(did_table) / sizeof(did_table[0]));
 
-    return UDS_PositiveResponse;
+    // 0x0200 is only accessible in the extended diagnostic session
+    const uint8_t REQ[] = {0x22, 0x02, 0x00};
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+
+    const uint8_t RESP[] = {0x7F, 0x22, 0x31};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == sizeof(RESP),
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, RESP, sizeof(RESP));
 }
 
-void test_0x3D_example_1(void **state) {
+void test_0x2E_did_table(void **state) {
     Env_t *e = *state;
-    uint8_t buf[512] = {0};
+    uint8_t buf[8] = {0};
+    e->server->fn = fn_test_0x22;
+    UDSServerRegisterDIDs(e->server, did_table, sizeof(did_table) / sizeof(did_table[0]));
+    e->server->sessionType = UDS_LEV_DS_EXTDS;
+
+    // a write with the wrong length should be rejected
+    const uint8_t SHORT_REQ[] = {0x2E, 0x02, 0x00, 0xAA};
+    UDSTpSend(e->client_tp, SHORT_REQ, sizeof(SHORT_REQ), NULL);
+    const uint8_t NRC_RESP[] = {0x7F, 0x2E, 0x13};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == sizeof(NRC_RESP),
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, NRC_RESP, sizeof(NRC_RESP));
 
-    uint8_t expected_mem_data[] = {0x00, 0x8C};
+    // a write with the registered length should be stored without calling srv->fn
+    const uint8_t REQ[] = {0x2E, 0x02, 0x00, 0xAA, 0xBB};
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+    const uint8_t RESP[] = {0x6E, 0x02, 0x00};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == sizeof(RESP),
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, RESP, sizeof(RESP));
+    const uint8_t EXPECTED[] = {0xAA, 0xBB};
+    TEST_MEMORY_EQUAL(did_0x0200, EXPECTED, sizeof(EXPECTED));
+
+    // a read-only DID should not be writable
+    const uint8_t RO_REQ[] = {0x2E, 0x01, 0x10, 0x00};
+    UDSTpSend(e->client_tp, RO_REQ, sizeof(RO_REQ), NULL);
+    const uint8_t RO_RESP[] = {0x7F, 0x2E, 0x31};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == sizeof(RO_RESP),
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, RO_RESP, sizeof(RO_RESP));
+}
 
-    Test0x3DTestFnData_t fnData = {
-        .expectedMemAddr = (void *)0x00002048,
-        .expectedMemSize = 2,
-        .expectedMemData = expected_mem_data,
-    };
+static const uint8_t *wdbi_data = NULL;
 
-    e->server->fn = fn_test_0x3D;
-    e->server->fn_data = &fnData;
+static UDSErr_t fn_test_0x2E_record_data(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    TEST_INT_EQUAL(UDS_EVT_WriteDataByIdent, ev);
+    wdbi_data = ((UDSWDBIArgs_t *)arg)->data;
+    return UDS_PositiveResponse;
+}
 
-    // Request per ISO14229-1 2020 Table 289
-    const uint8_t REQ[] = {
-        0x3D, // SID
-        0x12, // AddressAndLengthFormatIdentifier
-        0x20, // memoryAddress byte #1 (MSB)
-        0x48, // memoryAddress byte #2 (LSB)
-        0x02, // memorySize byte #1
-        0x00, // data byte #1
-        0x8C, // data byte #2
-    };
+void test_request_read_in_place(void **state) {
+    Env_t *e = *state;
+    uint8_t buf[8] = {0};
+    e->server->fn = fn_test_0x2E_record_data;
+    const uint8_t REQ[] = {0x2E, 0x12, 0x34, 0xAA, 0xBB};
+    const uint8_t RESP[] = {0x6E, 0x12, 0x34};
 
+    // the mock transport lends its receive buffer, so the request is not copied
     UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
-
-    // the client transport should receive a positive response within client_p2 ms
-    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == sizeof(RESP),
                      UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, RESP, sizeof(RESP));
+    TEST_PTR_EQUAL(wdbi_data, ((ISOTPMock_t *)e->server->tp)->recv_buf + 3);
 
-    // Response per ISO14229-1 2020 Table 290
-    const uint8_t EXPECTED_RESP[] = {
-        0x7D, // SID 0x3D + 0x40
-        0x12, // AddressAndLengthFormatIdentifier
-        0x20, // memoryAddress byte #1 (MSB)
-        0x48, // memoryAddress byte #2 (LSB)
-        0x02, // memorySize byte #1
-    };
+    // and is released once the response is sent
+    TEST_INT_EQUAL(((ISOTPMock_t *)e->server->tp)->recv_len, 0);
+    TEST_PTR_EQUAL(e->server->r.recv_buf, e->server->r.recv_storage);
 
-    TEST_MEMORY_EQUAL(buf, EXPECTED_RESP, sizeof(EXPECTED_RESP));
+    // a transport without peek is received into the server's own buffer
+    e->server->tp->peek = NULL;
+    e->server->tp->ack = NULL;
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == sizeof(RESP),
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, RESP, sizeof(RESP));
+    TEST_PTR_EQUAL(wdbi_data, e->server->r.recv_storage + 3);
 }
 
-void test_0x3D_example_2(void **state) {
+void test_did_table_rejects_duplicates(void **state) {
     Env_t *e = *state;
-    uint8_t buf[512] = {0};
-
-    uint8_t expected_mem_data[] = {0x00, 0x01, 0x8C};
-
-    Test0x3DTestFnData_t fnData = {
-        .expectedMemAddr = (void *)0x00204813,
-        .expectedMemSize = 3,
-        .expectedMemData = expected_mem_data,
+    UDSDIDEntry_t table[] = {
+        {.did = 0x1234, .access = UDS_DID_READ},
+        {.did = 0x0001, .access = UDS_DID_READ},
+        {.did = 0x1234, .access = UDS_DID_READ},
     };
+    TEST_ERR_EQUAL(UDSServerRegisterDIDs(e->server, table, 3), UDS_ERR_INVALID_ARG);
+}
 
-    e->server->fn = fn_test_0x3D;
-    e->server->fn_data = &fnData;
+int fn_test_not_called(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    fail();
+    return UDS_PositiveResponse;
+}
 
-    // Request per ISO14229-1 2020 Table 291
-    const uint8_t REQ[] = {
-        0x3D, // SID
-        0x13, // AddressAndLengthFormatIdentifier
-        0x20, // memoryAddress byte #1 (MSB)
-        0x48, // memoryAddress byte #2
-        0x13, // memoryAddress byte #3 (LSB)
-        0x03, // memorySize byte #1
-        0x00, // data byte #1
-        0x01, // data byte #2
-        0x8C, // data byte #3
+static uint8_t did_0x0300[] = {0x5A};
+
+void test_0x22_did_table_security_level(void **state) {
+    Env_t *e = *state;
+    uint8_t buf[8] = {0};
+    e->server->fn = fn_test_not_called;
+    UDSDIDEntry_t table[] = {
+        {.did = 0x0300, .len = sizeof(did_0x0300), .ptr = did_0x0300, .access = UDS_DID_READ,
+         .securityLevel = 0x01},
     };
+    UDSServerRegisterDIDs(e->server, table, 1);
 
+    // locked: the DID is registered, but SecurityAccess level 0x01 is required
+    const uint8_t REQ[] = {0x22, 0x03, 0x00};
     UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
-
-    // the client transport should receive a positive response within client_p2 ms
-    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+    const uint8_t NRC_RESP[] = {0x7F, 0x22, 0x33};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == sizeof(NRC_RESP),
                      UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, NRC_RESP, sizeof(NRC_RESP));
 
-    // Response per ISO14229-1 2020 Table 292
-    const uint8_t EXPECTED_RESP[] = {
-        0x7D, // SID 0x3D + 0x40
-        0x13, // AddressAndLengthFormatIdentifier
-        0x20, // memoryAddress byte #1 (MSB)
-        0x48, // memoryAddress byte #2
-        0x13, // memoryAddress byte #3 (LSB)
-        0x03, // memorySize byte #1
-    };
+    e->server->securityLevel = 0x01;
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+    const uint8_t RESP[] = {0x62, 0x03, 0x00, 0x5A};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == sizeof(RESP),
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, RESP, sizeof(RESP));
+}
 
-    TEST_MEMORY_EQUAL(buf, EXPECTED_RESP, sizeof(EXPECTED_RESP));
+static UDSErr_t erase_routine(UDSServer_t *srv, const UDSRoutineEntry_t *entry,
+                              UDSRoutineCtrlArgs_t *args) {
+    TEST_INT_EQUAL(entry->rid, 0xFF00);
+    const uint8_t status = 0x00;
+    return args->copyStatusRecord(srv, &status, sizeof(status));
 }
 
-void test_0x3D_example_3(void **state) {
-    Env_t *e = *state;
-    uint8_t buf[512] = {0};
+static UDSRoutineEntry_t routine_table[] = {
+    {.rid = 0xFF00, .ctrl = UDS_RID_START | UDS_RID_RESULTS,
+     .sessionMask = UDS_SESSION_BIT(UDS_LEV_DS_PRGS), .securityLevel = 0x01, .fn = erase_routine},
+    {.rid = 0x0202, .ctrl = UDS_RID_START},
+};
 
-    uint8_t expected_mem_data[] = {0x00, 0x01, 0x8C, 0x09, 0xAF};
+void test_0x31_routine_table(void **state) {
+    Env_t *e = *state;
+    uint8_t buf[8] = {0};
+    e->server->fn = fn_test_not_called;
+    TEST_ERR_EQUAL(UDSServerRegisterRoutines(e->server, routine_table,
+                                             sizeof(routine_table) / sizeof(routine_table[0])),
+                   UDS_OK);
+    TEST_INT_EQUAL(routine_table[0].rid, 0x0202);
+
+    struct {
+        uint8_t session, level;
+        uint8_t req[4];
+        uint8_t resp[5];
+        size_t resp_len;
+    } cases[] = {
+        // the routine is only accessible in the programming session
+        {UDS_LEV_DS_DS, 0x00, {0x31, 0x01, 0xFF, 0x00}, {0x7F, 0x31, 0x31}, 3},
+        // and with SecurityAccess level 0x01
+        {UDS_LEV_DS_PRGS, 0x00, {0x31, 0x01, 0xFF, 0x00}, {0x7F, 0x31, 0x33}, 3},
+        {UDS_LEV_DS_PRGS, 0x01, {0x31, 0x01, 0xFF, 0x00}, {0x71, 0x01, 0xFF, 0x00, 0x00}, 5},
+        // it cannot be stopped
+        {UDS_LEV_DS_PRGS, 0x01, {0x31, 0x02, 0xFF, 0x00}, {0x7F, 0x31, 0x12}, 3},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        e->server->sessionType = cases[i].session;
+        e->server->securityLevel = cases[i].level;
+        UDSTpSend(e->client_tp, cases[i].req, sizeof(cases[i].req), NULL);
+        ssize_t len = 0;
+        EXPECT_WITHIN_MS(e, (len = UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL)) > 0,
+                         UDS_CLIENT_DEFAULT_P2_MS);
+        TEST_INT_EQUAL(len, cases[i].resp_len);
+        TEST_MEMORY_EQUAL(buf, cases[i].resp, cases[i].resp_len);
+    }
+}
 
-    Test0x3DTestFnData_t fnData = {
-        .expectedMemAddr = (void *)0x000020481309,
-        .expectedMemSize = 5,
-        .expectedMemData = expected_mem_data,
-    };
+static uint8_t did_0xF201[] = {0x11, 0x22};
+static uint8_t did_0xF202[] = {0x33};
 
-    e->server->fn = fn_test_0x3D;
-    e->server->fn_data = &fnData;
+static UDSDIDEntry_t periodic_did_table[] = {
+    {.did = 0xF201, .len = sizeof(did_0xF201), .ptr = did_0xF201, .access = UDS_DID_READ},
+    {.did = 0xF202, .len = sizeof(did_0xF202), .ptr = did_0xF202, .access = UDS_DID_READ},
+};
+
+void test_0x2A_periodic_did(void **state) {
+    Env_t *e = *state;
+    uint8_t buf[8] = {0};
+    e->server->fn = fn_test_not_called;
+    UDSServerRegisterDIDs(e->server, periodic_did_table,
+                          sizeof(periodic_did_table) / sizeof(periodic_did_table[0]));
+
+    // When periodicDataIdentifier 0x01 is scheduled at the fast rate
+    const uint8_t REQ[] = {0x2A, UDS_LEV_TM_SAFR, 0x01};
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+
+    // the server should confirm
+    const uint8_t RESP[] = {0x6A};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == sizeof(RESP),
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, RESP, sizeof(RESP));
+
+    // and then send the data at the fast rate without further requests
+    const uint8_t PERIODIC[] = {0x6A, 0x01, 0x11, 0x22};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == sizeof(PERIODIC), 10);
+    TEST_MEMORY_EQUAL(buf, PERIODIC, sizeof(PERIODIC));
+    for (int i = 0; i < 3; i++) {
+        EXPECT_IN_APPROX_MS(e,
+                            UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == sizeof(PERIODIC),
+                            UDS_SERVER_0x2A_FAST_RATE_MS);
+        TEST_MEMORY_EQUAL(buf, PERIODIC, sizeof(PERIODIC));
+    }
+
+    // When transmission is stopped
+    const uint8_t STOP_REQ[] = {0x2A, UDS_LEV_TM_SS, 0x01};
+    UDSTpSend(e->client_tp, STOP_REQ, sizeof(STOP_REQ), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == sizeof(RESP),
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, RESP, sizeof(RESP));
+
+    // no more periodic data should be sent
+    EnvRunMillis(e, 2 * UDS_SERVER_0x2A_SLOW_RATE_MS);
+    TEST_INT_EQUAL(UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL), 0);
+    TEST_INT_EQUAL(e->server->periodicCount, 0);
+}
+
+void test_0x2A_multiple_rates(void **state) {
+    Env_t *e = *state;
+    uint8_t buf[8] = {0};
+    e->server->fn = fn_test_not_called;
+    UDSServerRegisterDIDs(e->server, periodic_did_table,
+                          sizeof(periodic_did_table) / sizeof(periodic_did_table[0]));
+
+    const uint8_t REQ_FAST[] = {0x2A, UDS_LEV_TM_SAFR, 0x01};
+    UDSTpSend(e->client_tp, REQ_FAST, sizeof(REQ_FAST), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == 1,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    const uint8_t REQ_SLOW[] = {0x2A, UDS_LEV_TM_SASR, 0x02};
+    UDSTpSend(e->client_tp, REQ_SLOW, sizeof(REQ_SLOW), NULL);
+
+    // over one slow period, the fast identifier should be sent about SLOW/FAST times as often
+    int counts[3] = {0};
+    uint32_t end = UDSMillis() + UDS_SERVER_0x2A_SLOW_RATE_MS;
+    while (UDSTimeAfter(end, UDSMillis())) {
+        EnvRunMillis(e, 1);
+        ssize_t len = UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL);
+        if (len > 1 && buf[0] == 0x6A && buf[1] <= 2) {
+            counts[buf[1]]++;
+        }
+    }
+    TEST_INT_GE(counts[1], UDS_SERVER_0x2A_SLOW_RATE_MS / UDS_SERVER_0x2A_FAST_RATE_MS - 2);
+    TEST_INT_GE(counts[2], 1);
+    TEST_INT_LE(counts[2], 2);
+}
+
+void test_0x2A_rejects_unknown_pdid(void **state) {
+    Env_t *e = *state;
+    uint8_t buf[8] = {0};
+    e->server->fn = fn_test_not_called;
+    UDSServerRegisterDIDs(e->server, periodic_did_table,
+                          sizeof(periodic_did_table) / sizeof(periodic_did_table[0]));
+
+    // 0x03 is not in the DID table, so nothing in the request should be scheduled
+    const uint8_t REQ[] = {0x2A, UDS_LEV_TM_SAMR, 0x01, 0x03};
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+    const uint8_t RESP[] = {0x7F, 0x2A, 0x31};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == sizeof(RESP),
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, RESP, sizeof(RESP));
+    TEST_INT_EQUAL(e->server->periodicCount, 0);
+
+    // an invalid transmissionMode should be rejected
+    const uint8_t BAD_MODE_REQ[] = {0x2A, 0x05, 0x01};
+    UDSTpSend(e->client_tp, BAD_MODE_REQ, sizeof(BAD_MODE_REQ), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == sizeof(RESP),
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, RESP, sizeof(RESP));
+}
+
+static uint8_t did_0x0123[] = {0x00};
+static uint8_t did_0x0124[] = {0x00, 0x00};
+
+static UDSDIDEntry_t roe_did_table[] = {
+    {.did = 0x0123, .len = sizeof(did_0x0123), .ptr = did_0x0123, .access = UDS_DID_READ},
+    {.did = 0x0124, .len = sizeof(did_0x0124), .ptr = did_0x0124, .access = UDS_DID_READ},
+};
+
+static void ROESetupServer(Env_t *e) {
+    e->server->fn = fn_test_not_called;
+    did_0x0123[0] = 0;
+    did_0x0124[0] = 0;
+    did_0x0124[1] = 0;
+    UDSServerRegisterDIDs(e->server, roe_did_table,
+                          sizeof(roe_did_table) / sizeof(roe_did_table[0]));
+}
+
+void test_0x86_on_change_of_did(void **state) {
+    Env_t *e = *state;
+    uint8_t buf[8] = {0};
+    ROESetupServer(e);
+
+    // set up onChangeOfDataIdentifier 0x0123 responding with ReadDataByIdentifier 0x0123
+    const uint8_t SETUP[] = {0x86, UDS_LEV_RE_OCODID, 0x02, 0x01, 0x23, 0x22, 0x01, 0x23};
+    const uint8_t SETUP_RESP[] = {0xC6, UDS_LEV_RE_OCODID, 0x00, 0x02, 0x01, 0x23, 0x22, 0x01, 0x23};
+    Exchange(e, SETUP, sizeof(SETUP), SETUP_RESP, sizeof(SETUP_RESP));
+
+    const uint8_t START[] = {0x86, UDS_LEV_RE_STRTROE, 0x02};
+    const uint8_t START_RESP[] = {0xC6, UDS_LEV_RE_STRTROE, 0x00, 0x02};
+    Exchange(e, START, sizeof(START), START_RESP, sizeof(START_RESP));
+
+    // the event should be reported as active
+    const uint8_t REPORT[] = {0x86, UDS_LEV_RE_RAE, 0x02};
+    const uint8_t REPORT_RESP[] = {0xC6, UDS_LEV_RE_RAE, 0x01, UDS_LEV_RE_OCODID, 0x02,
+                                   0x01, 0x23, 0x22, 0x01, 0x23};
+    Exchange(e, REPORT, sizeof(REPORT), REPORT_RESP, sizeof(REPORT_RESP));
+
+    // nothing is sent while the DID does not change
+    EnvRunMillis(e, 500);
+    TEST_INT_EQUAL(UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL), 0);
+
+    // When the DID changes
+    did_0x0123[0] = 0x42;
+
+    // the server should respond to the event
+    const uint8_t EVENT_RESP[] = {0x62, 0x01, 0x23, 0x42};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == sizeof(EVENT_RESP),
+                     UDS_SERVER_0x86_SAMPLE_MS + UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, EVENT_RESP, sizeof(EVENT_RESP));
+
+    // once
+    EnvRunMillis(e, 500);
+    TEST_INT_EQUAL(UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL), 0);
+
+    // When ResponseOnEvent is stopped
+    const uint8_t STOP[] = {0x86, UDS_LEV_RE_STPROE, 0x02};
+    const uint8_t STOP_RESP[] = {0xC6, UDS_LEV_RE_STPROE, 0x01, 0x02};
+    Exchange(e, STOP, sizeof(STOP), STOP_RESP, sizeof(STOP_RESP));
+
+    // changes should no longer be reported
+    did_0x0123[0] = 0x43;
+    EnvRunMillis(e, 500);
+    TEST_INT_EQUAL(UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL), 0);
+}
+
+void test_0x86_on_comparison_of_values(void **state) {
+    Env_t *e = *state;
+    uint8_t buf[8] = {0};
+    ROESetupServer(e);
+
+    // fire when the unsigned 16 bit value of DID 0x0124 is larger than 1000, 10% hysteresis
+    const uint8_t SETUP[] = {0x86, UDS_LEV_RE_OCOV, 0x02, 0x01, 0x24, UDS_RE_CMP_GT, 0x00, 0x00,
+                             0x03, 0xE8, 10,   0x40, 0x00, 0x22, 0x01, 0x24};
+    uint8_t SETUP_RESP[sizeof(SETUP) + 1] = {0xC6, UDS_LEV_RE_OCOV, 0x00};
+    memcpy(&SETUP_RESP[3], &SETUP[2], sizeof(SETUP) - 2);
+    Exchange(e, SETUP, sizeof(SETUP), SETUP_RESP, sizeof(SETUP_RESP));
+    const uint8_t START[] = {0x86, UDS_LEV_RE_STRTROE, 0x02};
+    const uint8_t START_RESP[] = {0xC6, UDS_LEV_RE_STRTROE, 0x00, 0x02};
+    Exchange(e, START, sizeof(START), START_RESP, sizeof(START_RESP));
+
+    const uint16_t values[] = {900, 1100, 1050, 950, 899, 1001};
+    const bool fires[] = {false, true, false, false, false, true};
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        did_0x0124[0] = values[i] >> 8;
+        did_0x0124[1] = values[i] & 0xFF;
+        EnvRunMillis(e, 200);
+        ssize_t len = UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL);
+        ssize_t expected_len = fires[i] ? 5 : 0;
+        TEST_INT_EQUAL(len, expected_len);
+        if (fires[i]) {
+            const uint8_t EVENT_RESP[] = {0x62, 0x01, 0x24, did_0x0124[0], did_0x0124[1]};
+            TEST_MEMORY_EQUAL(buf, EVENT_RESP, sizeof(EVENT_RESP));
+        }
+    }
+}
+
+void test_0x86_on_dtc_status_change(void **state) {
+    Env_t *e = *state;
+    uint8_t buf[8] = {0};
+    ROESetupServer(e);
+
+    // set up onDTCStatusChange for the confirmedDTC bit
+    const uint8_t SETUP[] = {0x86, UDS_LEV_RE_ONDTCS, 0x02, 0x08, 0x22, 0x01, 0x23};
+    const uint8_t SETUP_RESP[] = {0xC6, UDS_LEV_RE_ONDTCS, 0x00, 0x02, 0x08, 0x22, 0x01, 0x23};
+    Exchange(e, SETUP, sizeof(SETUP), SETUP_RESP, sizeof(SETUP_RESP));
+    const uint8_t START[] = {0x86, UDS_LEV_RE_STRTROE, 0x02};
+    const uint8_t START_RESP[] = {0xC6, UDS_LEV_RE_STRTROE, 0x00, 0x02};
+    Exchange(e, START, sizeof(START), START_RESP, sizeof(START_RESP));
+
+    // a change outside the mask is ignored
+    UDSServerNotifyDTCStatusChange(e->server, 0x00, 0x01);
+    EnvRunMillis(e, 200);
+    TEST_INT_EQUAL(UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL), 0);
+
+    // a change inside the mask is reported
+    UDSServerNotifyDTCStatusChange(e->server, 0x01, 0x09);
+    const uint8_t EVENT_RESP[] = {0x62, 0x01, 0x23, 0x00};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == sizeof(EVENT_RESP),
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, EVENT_RESP, sizeof(EVENT_RESP));
+}
+
+void test_0x86_event_window_expires(void **state) {
+    Env_t *e = *state;
+    uint8_t buf[8] = {0};
+    ROESetupServer(e);
+
+    // set up onChangeOfDataIdentifier 0x0123 with a short event window
+    const uint8_t SETUP[] = {0x86, UDS_LEV_RE_OCODID, UDS_RE_WT_SHORT, 0x01, 0x23, 0x22, 0x01, 0x23};
+    const uint8_t SETUP_RESP[] = {0xC6, UDS_LEV_RE_OCODID, 0x00, UDS_RE_WT_SHORT,
+                                  0x01, 0x23,           0x22, 0x01, 0x23};
+    Exchange(e, SETUP, sizeof(SETUP), SETUP_RESP, sizeof(SETUP_RESP));
+    const uint8_t START[] = {0x86, UDS_LEV_RE_STRTROE, UDS_RE_WT_SHORT};
+    const uint8_t START_RESP[] = {0xC6, UDS_LEV_RE_STRTROE, 0x00, UDS_RE_WT_SHORT};
+    Exchange(e, START, sizeof(START), START_RESP, sizeof(START_RESP));
+
+    // a change inside the window is reported
+    did_0x0123[0] = 0x42;
+    const uint8_t EVENT_RESP[] = {0x62, 0x01, 0x23, 0x42};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == sizeof(EVENT_RESP),
+                     UDS_SERVER_0x86_SAMPLE_MS + UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, EVENT_RESP, sizeof(EVENT_RESP));
+
+    // When the window ends
+    EnvRunMillis(e, UDS_SERVER_0x86_SHORT_WINDOW_MS);
+
+    // the event should no longer be active
+    const uint8_t REPORT[] = {0x86, UDS_LEV_RE_RAE, UDS_RE_WT_INFINITE};
+    const uint8_t REPORT_RESP[] = {0xC6, UDS_LEV_RE_RAE, 0x00};
+    Exchange(e, REPORT, sizeof(REPORT), REPORT_RESP, sizeof(REPORT_RESP));
+
+    // and changes should not be reported
+    did_0x0123[0] = 0x43;
+    EnvRunMillis(e, 500);
+    TEST_INT_EQUAL(UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL), 0);
+}
+
+void test_0x86_rejects_invalid_setup(void **state) {
+    Env_t *e = *state;
+    ROESetupServer(e);
+
+    // unknown DID
+    const uint8_t UNKNOWN_DID[] = {0x86, UDS_LEV_RE_OCODID, 0x02, 0x12, 0x34, 0x22, 0x12, 0x34};
+    const uint8_t OUT_OF_RANGE[] = {0x7F, 0x86, 0x31};
+    Exchange(e, UNKNOWN_DID, sizeof(UNKNOWN_DID), OUT_OF_RANGE, sizeof(OUT_OF_RANGE));
+
+    // missing serviceToRespondToRecord
+    const uint8_t SHORT[] = {0x86, UDS_LEV_RE_OCODID, 0x02, 0x01, 0x23};
+    const uint8_t BAD_LEN[] = {0x7F, 0x86, 0x13};
+    Exchange(e, SHORT, sizeof(SHORT), BAD_LEN, sizeof(BAD_LEN));
+
+    // reserved eventWindowTime
+    const uint8_t BAD_WINDOW[] = {0x86, UDS_LEV_RE_OCODID, 0x01, 0x01, 0x23, 0x22, 0x01, 0x23};
+    Exchange(e, BAD_WINDOW, sizeof(BAD_WINDOW), OUT_OF_RANGE, sizeof(OUT_OF_RANGE));
+
+    // start without any event logic
+    const uint8_t START[] = {0x86, UDS_LEV_RE_STRTROE, 0x02};
+    const uint8_t NOT_CORRECT[] = {0x7F, 0x86, 0x22};
+    Exchange(e, START, sizeof(START), NOT_CORRECT, sizeof(NOT_CORRECT));
+}
+
+void test_min_length_checked_before_handler(void **state) {
+    Env_t *e = *state;
+    uint8_t buf[8] = {0};
+    e->server->fn = fn_test_not_called;
+
+    // a RoutineControl request without a routineIdentifier
+    const uint8_t REQ[] = {0x31, 0x01};
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+
+    // should be rejected without calling the server callback
+    const uint8_t RESP[] = {0x7F, 0x31, 0x13};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == sizeof(RESP),
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, RESP, sizeof(RESP));
+}
+
+int fn_test_0x23(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    TEST_INT_EQUAL(ev, UDS_EVT_ReadMemByAddr);
+    UDSReadMemByAddrArgs_t *r = (UDSReadMemByAddrArgs_t *)arg;
+    TEST_PTR_EQUAL(r->memAddr, (void *)0x20481392);
+    TEST_INT_EQUAL(r->memSize, 259);
+    return r->copy(srv, srv->fn_data, r->memSize);
+}
+
+void test_0x23(void **state) {
+    Env_t *e = *state;
+    uint8_t buf[512] = {0};
+
+    uint8_t FakeData[259];
+    for (int i = 0; i < sizeof(FakeData); i++) {
+        FakeData[i] = i % 256;
+    }
+
+    uint8_t EXPECTED_RESP[sizeof(FakeData) + 1] = {0x63}; // SID 0x23 + 0x40
+    for (int i = 0; i < sizeof(FakeData); i++) {
+        EXPECTED_RESP[i + 1] = FakeData[i];
+    }
+
+    e->server->fn = fn_test_0x23;
+    e->server->fn_data = FakeData;
+
+    // Request per ISO14229-1 2020 Table 200
+    const uint8_t REQ[] = {
+        0x23, // SID
+        0x24, // AddressAndLengthFormatIdentifier
+        0x20, // memoryAddress byte #1 (MSB)
+        0x48, // memoryAddress byte #2
+        0x13, // memoryAddress byte #3
+        0x92, // memoryAddress byte #4 (LSB)
+        0x01, // memorySize byte #1 (MSB)
+        0x03, // memorySize byte #2 (LSB)
+    };
+
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+
+    // the client transport should receive a positive response within client_p2 ms
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, EXPECTED_RESP, sizeof(EXPECTED_RESP));
+}
+
+int fn_test_0x23_reserve_commit(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    TEST_INT_EQUAL(ev, UDS_EVT_ReadMemByAddr);
+    UDSReadMemByAddrArgs_t *r = (UDSReadMemByAddrArgs_t *)arg;
+    uint8_t *dst = NULL;
+    uint16_t capacity = 0;
+    TEST_INT_EQUAL(r->reserve(srv, &dst, &capacity), UDS_PositiveResponse);
+    TEST_INT_GE(capacity, r->memSize);
+
+    // produce the data directly into the response buffer
+    for (size_t i = 0; i < r->memSize; i++) {
+        dst[i] = (uint8_t)(i % 256);
+    }
+
+    // committing more than was reserved should fail
+    TEST_INT_EQUAL(r->commit(srv, capacity + 1), UDS_NRC_ResponseTooLong);
+    return r->commit(srv, (uint16_t)r->memSize);
+}
+
+void test_0x23_reserve_commit(void **state) {
+    Env_t *e = *state;
+    uint8_t buf[512] = {0};
+
+    uint8_t EXPECTED_RESP[259 + 1] = {0x63};
+    for (int i = 0; i < 259; i++) {
+        EXPECTED_RESP[i + 1] = i % 256;
+    }
+
+    e->server->fn = fn_test_0x23_reserve_commit;
+
+    const uint8_t REQ[] = {0x23, 0x24, 0x20, 0x48, 0x13, 0x92, 0x01, 0x03};
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == sizeof(EXPECTED_RESP),
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, EXPECTED_RESP, sizeof(EXPECTED_RESP));
+}
+
+typedef struct {
+    const void *expectedMemAddr;
+    const size_t expectedMemSize;
+    const void *expectedMemData;
+} Test0x3DTestFnData_t;
+
+int fn_test_0x3D(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    Test0x3DTestFnData_t *fnData = (Test0x3DTestFnData_t *)srv->fn_data;
+
+    TEST_INT_EQUAL(ev, UDS_EVT_WriteMemByAddr);
+    UDSWriteMemByAddrArgs_t *r = (UDSWriteMemByAddrArgs_t *)arg;
+
+    TEST_PTR_EQUAL(r->memAddr, fnData->expectedMemAddr);
+    TEST_INT_EQUAL(r->memSize, fnData->expectedMemSize);
+    TEST_MEMORY_EQUAL(r->data, fnData->expectedMemData, r->memSize);
+
+    return UDS_PositiveResponse;
+}
+
+void test_0x3D_example_1(void **state) {
+    Env_t *e = *state;
+    uint8_t buf[512] = {0};
+
+    uint8_t expected_mem_data[] = {0x00, 0x8C};
+
+    Test0x3DTestFnData_t fnData = {
+        .expectedMemAddr = (void *)0x00002048,
+        .expectedMemSize = 2,
+        .expectedMemData = expected_mem_data,
+    };
+
+    e->server->fn = fn_test_0x3D;
+    e->server->fn_data = &fnData;
+
+    // Request per ISO14229-1 2020 Table 289
+    const uint8_t REQ[] = {
+        0x3D, // SID
+        0x12, // AddressAndLengthFormatIdentifier
+        0x20, // memoryAddress byte #1 (MSB)
+        0x48, // memoryAddress byte #2 (LSB)
+        0x02, // memorySize byte #1
+        0x00, // data byte #1
+        0x8C, // data byte #2
+    };
+
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+
+    // the client transport should receive a positive response within client_p2 ms
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+
+    // Response per ISO14229-1 2020 Table 290
+    const uint8_t EXPECTED_RESP[] = {
+        0x7D, // SID 0x3D + 0x40
+        0x12, // AddressAndLengthFormatIdentifier
+        0x20, // memoryAddress byte #1 (MSB)
+        0x48, // memoryAddress byte #2 (LSB)
+        0x02, // memorySize byte #1
+    };
+
+    TEST_MEMORY_EQUAL(buf, EXPECTED_RESP, sizeof(EXPECTED_RESP));
+}
+
+void test_0x3D_example_2(void **state) {
+    Env_t *e = *state;
+    uint8_t buf[512] = {0};
+
+    uint8_t expected_mem_data[] = {0x00, 0x01, 0x8C};
+
+    Test0x3DTestFnData_t fnData = {
+        .expectedMemAddr = (void *)0x00204813,
+        .expectedMemSize = 3,
+        .expectedMemData = expected_mem_data,
+    };
+
+    e->server->fn = fn_test_0x3D;
+    e->server->fn_data = &fnData;
+
+    // Request per ISO14229-1 2020 Table 291
+    const uint8_t REQ[] = {
+        0x3D, // SID
+        0x13, // AddressAndLengthFormatIdentifier
+        0x20, // memoryAddress byte #1 (MSB)
+        0x48, // memoryAddress byte #2
+        0x13, // memoryAddress byte #3 (LSB)
+        0x03, // memorySize byte #1
+        0x00, // data byte #1
+        0x01, // data byte #2
+        0x8C, // data byte #3
+    };
+
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+
+    // the client transport should receive a positive response within client_p2 ms
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+
+    // Response per ISO14229-1 2020 Table 292
+    const uint8_t EXPECTED_RESP[] = {
+        0x7D, // SID 0x3D + 0x40
+        0x13, // AddressAndLengthFormatIdentifier
+        0x20, // memoryAddress byte #1 (MSB)
+        0x48, // memoryAddress byte #2
+        0x13, // memoryAddress byte #3 (LSB)
+        0x03, // memorySize byte #1
+    };
+
+    TEST_MEMORY_EQUAL(buf, EXPECTED_RESP, sizeof(EXPECTED_RESP));
+}
+
+void test_0x3D_example_3(void **state) {
+    Env_t *e = *state;
+    uint8_t buf[512] = {0};
+
+    uint8_t expected_mem_data[] = {0x00, 0x01, 0x8C, 0x09, 0xAF};
+
+    Test0x3DTestFnData_t fnData = {
+        .expectedMemAddr = (void *)0x000020481309,
+        .expectedMemSize = 5,
+        .expectedMemData = expected_mem_data,
+    };
+
+    e->server->fn = fn_test_0x3D;
+    e->server->fn_data = &fnData;
 
     // Request per ISO14229-1 2020 Table 289
     const uint8_t REQ[] = {
@@ -2738,6 +3633,229 @@ void test_0x3D_example_3(void **state) {
     TEST_MEMORY_EQUAL(buf, EXPECTED_RESP, sizeof(EXPECTED_RESP));
 }
 
+/* "external flash" at 0x10000 behind a copy engine that can finish later, like a DMA */
+typedef struct {
+    uint8_t flash[64];
+    bool defer;              /* start the transfer and complete it later */
+    UDSPendingToken_t token; /* deferred transfer */
+    uint8_t *dst;            /* destination of the deferred read */
+    uintptr_t addr;          /* address of the deferred transfer */
+    size_t len;              /* length of the deferred transfer */
+    int calls;               /* calls to the copy functions */
+} FlashCtx_t;
+
+static UDSErr_t FlashRead(UDSServer_t *srv, const UDSMemRegion_t *region, uintptr_t addr,
+                          uint8_t *dst, size_t len) {
+    FlashCtx_t *f = region->ctx;
+    f->calls++;
+    if (f->defer) {
+        f->dst = dst;
+        f->addr = addr;
+        f->len = len;
+        return UDSServerDeferResponse(srv, &f->token);
+    }
+    memcpy(dst, &f->flash[addr - region->start], len);
+    return UDS_PositiveResponse;
+}
+
+static UDSErr_t FlashWrite(UDSServer_t *srv, const UDSMemRegion_t *region, uintptr_t addr,
+                           const uint8_t *src, size_t len) {
+    FlashCtx_t *f = region->ctx;
+    f->calls++;
+    memcpy(&f->flash[addr - region->start], src, len);
+    if (f->defer) {
+        return UDSServerDeferResponse(srv, &f->token);
+    }
+    return UDS_PositiveResponse;
+}
+
+int fn_test_mem_regions(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    // registered regions are served without events
+    TEST_INT_NE(ev, UDS_EVT_ReadMemByAddr);
+    TEST_INT_NE(ev, UDS_EVT_WriteMemByAddr);
+    return UDS_PositiveResponse;
+}
+
+static void SetupMemRegions(Env_t *e, UDSMemRegion_t *regions, FlashCtx_t *f, uint8_t *ram,
+                            size_t ramLen) {
+    regions[0] = (UDSMemRegion_t){.start = 0x10000,
+                                  .len = sizeof(f->flash),
+                                  .access = UDS_MEM_READ | UDS_MEM_WRITE,
+                                  .ctx = f,
+                                  .read = FlashRead,
+                                  .write = FlashWrite};
+    // read-only RAM served with memcpy
+    regions[1] = (UDSMemRegion_t){.start = (uintptr_t)ram, .len = ramLen, .access = UDS_MEM_READ};
+    // calibration that needs the extended session and security level 1
+    regions[2] = (UDSMemRegion_t){.start = 0x20000,
+                                  .len = 16,
+                                  .access = UDS_MEM_READ | UDS_MEM_WRITE,
+                                  .sessionMask = UDS_SESSION_BIT(UDS_LEV_DS_EXTDS),
+                                  .securityLevel = 1,
+                                  .ctx = f,
+                                  .read = FlashRead,
+                                  .write = FlashWrite};
+    EXPECT_OK(UDSServerRegisterMemRegions(e->server, regions, 3));
+    e->server->fn = fn_test_mem_regions;
+}
+
+static void ExpectResponse(Env_t *e, const uint8_t *req, size_t req_len, const uint8_t *resp,
+                           size_t resp_len) {
+    uint8_t buf[64] = {0};
+    UDSTpSend(e->client_tp, req, (ssize_t)req_len, NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, resp, resp_len);
+}
+
+void test_0x23_mem_regions(void **state) {
+    Env_t *e = *state;
+    UDSMemRegion_t regions[3];
+    FlashCtx_t f = {0};
+    uint8_t ram[8] = {0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7};
+    SetupMemRegions(e, regions, &f, ram, sizeof(ram));
+    for (int i = 0; i < 64; i++) {
+        f.flash[i] = (uint8_t)i;
+    }
+
+    // external flash through the copy engine
+    const uint8_t FLASH_REQ[] = {0x23, 0x14, 0x00, 0x01, 0x00, 0x3C, 0x04};
+    const uint8_t FLASH_RESP[] = {0x63, 0x3C, 0x3D, 0x3E, 0x3F};
+    ExpectResponse(e, FLASH_REQ, sizeof(FLASH_REQ), FLASH_RESP, sizeof(FLASH_RESP));
+    TEST_INT_EQUAL(f.calls, 1);
+
+    // RAM with memcpy
+    uint8_t ram_req[2 + sizeof(uintptr_t) + 1] = {0x23, 0x10 | sizeof(uintptr_t)};
+    uintptr_t addr = (uintptr_t)&ram[2];
+    for (size_t i = 0; i < sizeof(uintptr_t); i++) {
+        ram_req[2 + i] = (uint8_t)(addr >> (8 * (sizeof(uintptr_t) - 1 - i)));
+    }
+    ram_req[sizeof(ram_req) - 1] = 3;
+    const uint8_t RAM_RESP[] = {0x63, 0xA2, 0xA3, 0xA4};
+    ExpectResponse(e, ram_req, sizeof(ram_req), RAM_RESP, sizeof(RAM_RESP));
+
+    // past the end of the region, outside of every region, wrong session, not unlocked
+    const uint8_t OUT_OF_RANGE[] = {0x7F, 0x23, 0x31};
+    const uint8_t PAST_END[] = {0x23, 0x14, 0x00, 0x01, 0x00, 0x3E, 0x04};
+    ExpectResponse(e, PAST_END, sizeof(PAST_END), OUT_OF_RANGE, sizeof(OUT_OF_RANGE));
+    const uint8_t UNMAPPED[] = {0x23, 0x14, 0x00, 0x03, 0x00, 0x00, 0x01};
+    ExpectResponse(e, UNMAPPED, sizeof(UNMAPPED), OUT_OF_RANGE, sizeof(OUT_OF_RANGE));
+    const uint8_t CAL_REQ[] = {0x23, 0x14, 0x00, 0x02, 0x00, 0x00, 0x01};
+    ExpectResponse(e, CAL_REQ, sizeof(CAL_REQ), OUT_OF_RANGE, sizeof(OUT_OF_RANGE));
+    e->server->sessionType = UDS_LEV_DS_EXTDS;
+    const uint8_t DENIED[] = {0x7F, 0x23, 0x33};
+    ExpectResponse(e, CAL_REQ, sizeof(CAL_REQ), DENIED, sizeof(DENIED));
+    e->server->securityLevel = 1;
+    const uint8_t CAL_RESP[] = {0x63, 0x00};
+    ExpectResponse(e, CAL_REQ, sizeof(CAL_REQ), CAL_RESP, sizeof(CAL_RESP));
+}
+
+void test_0x23_mem_region_deferred_read(void **state) {
+    Env_t *e = *state;
+    UDSMemRegion_t regions[3];
+    FlashCtx_t f = {.defer = true};
+    uint8_t ram[1];
+    SetupMemRegions(e, regions, &f, ram, sizeof(ram));
+    for (int i = 0; i < 64; i++) {
+        f.flash[i] = (uint8_t)(0xFF - i);
+    }
+
+    const uint8_t REQ[] = {0x23, 0x14, 0x00, 0x01, 0x00, 0x00, 0x20};
+    const uint8_t RCRRP[] = {0x7F, 0x23, 0x78};
+    ExpectResponse(e, REQ, sizeof(REQ), RCRRP, sizeof(RCRRP));
+
+    // the "DMA" finishes while the server keeps sending 0x78
+    EnvRunMillis(e, 100);
+    memcpy(f.dst, &f.flash[f.addr - 0x10000], f.len);
+    TEST_ERR_EQUAL(UDS_OK,
+                   UDSServerCompleteResponse(e->server, f.token, UDS_PositiveResponse, NULL, 0));
+
+    uint8_t expected[1 + 0x20] = {0x63};
+    memcpy(&expected[1], f.flash, 0x20);
+    uint8_t buf[64] = {0};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, expected, sizeof(expected));
+    TEST_INT_EQUAL(f.calls, 1);
+}
+
+void test_0x2C_memory_source_obeys_mem_regions(void **state) {
+    Env_t *e = *state;
+    UDSMemRegion_t regions[3];
+    FlashCtx_t f = {0};
+    uint8_t ram[1];
+    SetupMemRegions(e, regions, &f, ram, sizeof(ram));
+    for (int i = 0; i < 64; i++) {
+        f.flash[i] = (uint8_t)i;
+    }
+
+    // two bytes of external flash are read through the copy engine
+    const uint8_t DEFINE_FLASH[] = {0x2C, 0x02, 0xF3, 0x10, 0x14, 0x00, 0x01, 0x00, 0x02, 0x02};
+    const uint8_t DEFINE_RESP[] = {0x6C, 0x02, 0xF3, 0x10};
+    ExpectResponse(e, DEFINE_FLASH, sizeof(DEFINE_FLASH), DEFINE_RESP, sizeof(DEFINE_RESP));
+
+    // the calibration needs the extended session and then security level 1, as with 0x23
+    const uint8_t DEFINE_CAL[] = {0x2C, 0x02, 0xF3, 0x10, 0x14, 0x00, 0x02, 0x00, 0x04, 0x01};
+    const uint8_t OUT_OF_RANGE[] = {0x7F, 0x2C, 0x31};
+    ExpectResponse(e, DEFINE_CAL, sizeof(DEFINE_CAL), OUT_OF_RANGE, sizeof(OUT_OF_RANGE));
+    e->server->sessionType = UDS_LEV_DS_EXTDS;
+    const uint8_t DENIED[] = {0x7F, 0x2C, 0x33};
+    ExpectResponse(e, DEFINE_CAL, sizeof(DEFINE_CAL), DENIED, sizeof(DENIED));
+    e->server->securityLevel = 1;
+    ExpectResponse(e, DEFINE_CAL, sizeof(DEFINE_CAL), DEFINE_RESP, sizeof(DEFINE_RESP));
+
+    const uint8_t READ[] = {0x22, 0xF3, 0x10};
+    const uint8_t READ_RESP[] = {0x62, 0xF3, 0x10, 0x02, 0x03, 0x04};
+    ExpectResponse(e, READ, sizeof(READ), READ_RESP, sizeof(READ_RESP));
+    TEST_INT_EQUAL(f.calls, 2);
+
+    // and is checked again when the DID is read
+    e->server->securityLevel = 0;
+    const uint8_t READ_DENIED[] = {0x7F, 0x22, 0x33};
+    ExpectResponse(e, READ, sizeof(READ), READ_DENIED, sizeof(READ_DENIED));
+}
+
+void test_0x3D_mem_regions(void **state) {
+    Env_t *e = *state;
+    UDSMemRegion_t regions[3];
+    FlashCtx_t f = {0};
+    uint8_t ram[4] = {0};
+    SetupMemRegions(e, regions, &f, ram, sizeof(ram));
+
+    const uint8_t REQ[] = {0x3D, 0x14, 0x00, 0x01, 0x00, 0x10, 0x02, 0xBE, 0xEF};
+    const uint8_t RESP[] = {0x7D, 0x14, 0x00, 0x01, 0x00, 0x10, 0x02};
+    ExpectResponse(e, REQ, sizeof(REQ), RESP, sizeof(RESP));
+    TEST_INT_EQUAL(f.flash[0x10], 0xBE);
+    TEST_INT_EQUAL(f.flash[0x11], 0xEF);
+
+    // the RAM region is read-only
+    uint8_t ram_req[2 + sizeof(uintptr_t) + 2] = {0x3D, 0x10 | sizeof(uintptr_t)};
+    uintptr_t addr = (uintptr_t)ram;
+    for (size_t i = 0; i < sizeof(uintptr_t); i++) {
+        ram_req[2 + i] = (uint8_t)(addr >> (8 * (sizeof(uintptr_t) - 1 - i)));
+    }
+    ram_req[sizeof(ram_req) - 2] = 1;
+    ram_req[sizeof(ram_req) - 1] = 0x55;
+    const uint8_t OUT_OF_RANGE[] = {0x7F, 0x3D, 0x31};
+    ExpectResponse(e, ram_req, sizeof(ram_req), OUT_OF_RANGE, sizeof(OUT_OF_RANGE));
+    TEST_INT_EQUAL(ram[0], 0);
+
+    // a deferred write answers once the engine completes
+    f.defer = true;
+    const uint8_t REQ2[] = {0x3D, 0x14, 0x00, 0x01, 0x00, 0x20, 0x01, 0x42};
+    const uint8_t RCRRP[] = {0x7F, 0x3D, 0x78};
+    const uint8_t RESP2[] = {0x7D, 0x14, 0x00, 0x01, 0x00, 0x20, 0x01};
+    ExpectResponse(e, REQ2, sizeof(REQ2), RCRRP, sizeof(RCRRP));
+    TEST_ERR_EQUAL(UDS_OK,
+                   UDSServerCompleteResponse(e->server, f.token, UDS_PositiveResponse, NULL, 0));
+    uint8_t buf[16] = {0};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, RESP2, sizeof(RESP2));
+    TEST_INT_EQUAL(f.flash[0x20], 0x42);
+    TEST_INT_EQUAL(f.calls, 2);
+}
+
 void test_0x27_level_is_zero_at_init(void **state) {
     Env_t *e = *state;
     TEST_INT_EQUAL(e->server->securityLevel, 0);
@@ -2853,36 +3971,248 @@ void test_0x27_brute_force_prevention_2(void **state) {
     const uint8_t SEED_REQUEST[] = {0x27, 0x01};
     UDSTpSend(e->client_tp, SEED_REQUEST, sizeof(SEED_REQUEST), NULL);
 
-    // should get this response
-    const uint8_t SEED_RESPONSE[] = {0x67, 0x01, 0x36, 0x57};
+    // should get this response
+    const uint8_t SEED_RESPONSE[] = {0x67, 0x01, 0x36, 0x57};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, SEED_RESPONSE, sizeof(SEED_RESPONSE));
+
+    // the server security level should still be 0
+    TEST_INT_EQUAL(e->server->securityLevel, 0);
+
+    // sending a bad unlock request
+    const uint8_t UNLOCK_REQUEST[] = {0x27, 0x02, 0xFF, 0xFF};
+    UDSTpSend(e->client_tp, UNLOCK_REQUEST, sizeof(UNLOCK_REQUEST), NULL);
+
+    // should get a negative response
+    const uint8_t NEG_RESPONSE[] = {0x7F, 0x27, 0x33};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, NEG_RESPONSE, sizeof(NEG_RESPONSE));
+
+    // the server security level should still be 0
+    TEST_INT_EQUAL(e->server->securityLevel, 0);
+
+    // and sending another seed request right away
+    UDSTpSend(e->client_tp, SEED_REQUEST, sizeof(SEED_REQUEST), NULL);
+
+    // should get a negative response due to brute force prevention
+    const uint8_t DENIED[] = {0x7F, 0x27, 0x36};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS)
+    TEST_MEMORY_EQUAL(buf, DENIED, sizeof(DENIED));
+}
+
+typedef struct {
+    UDSPendingToken_t token; /* key check handed to the "HSM" */
+    int calls;               /* UDS_EVT_SecAccessValidateKey events */
+} AsyncKeyCtx_t;
+
+int fn_test_0x27_async_key(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    AsyncKeyCtx_t *ctx = srv->fn_data;
+    if (UDS_EVT_SecAccessRequestSeed == ev) {
+        return fn_test_0x27_security_access(srv, ev, arg);
+    }
+    TEST_INT_EQUAL(ev, UDS_EVT_SecAccessValidateKey);
+    ctx->calls++;
+    return UDSServerDeferResponse(srv, &ctx->token);
+}
+
+static void UnlockAsync(Env_t *e, AsyncKeyCtx_t *ctx, UDSErr_t result, const uint8_t *expected,
+                        size_t expected_len) {
+    uint8_t buf[8] = {0};
+    e->server->fn = fn_test_0x27_async_key;
+    e->server->fn_data = ctx;
+    EnvRunMillis(e, UDS_SERVER_0x27_BRUTE_FORCE_MITIGATION_BOOT_DELAY_MS + 10);
+
+    const uint8_t SEED_REQUEST[] = {0x27, 0x01};
+    UDSTpSend(e->client_tp, SEED_REQUEST, sizeof(SEED_REQUEST), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+
+    // the key check takes longer than p2: the server answers 0x78 on its own meanwhile
+    const uint8_t UNLOCK_REQUEST[] = {0x27, 0x02, 0xC9, 0xA9};
+    const uint8_t RCRRP[] = {0x7F, 0x27, 0x78};
+    UDSTpSend(e->client_tp, UNLOCK_REQUEST, sizeof(UNLOCK_REQUEST), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, RCRRP, sizeof(RCRRP));
+    EnvRunMillis(e, 80);
+    TEST_INT_EQUAL(e->server->securityLevel, 0);
+
+    TEST_ERR_EQUAL(UDS_OK, UDSServerCompleteResponse(e->server, ctx->token, result, NULL, 0));
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, expected, expected_len);
+    TEST_INT_EQUAL(ctx->calls, 1);
+}
+
+void test_0x27_deferred_key_check(void **state) {
+    Env_t *e = *state;
+    AsyncKeyCtx_t ctx = {0};
+    const uint8_t UNLOCK_RESPONSE[] = {0x67, 0x02};
+    UnlockAsync(e, &ctx, UDS_PositiveResponse, UNLOCK_RESPONSE, sizeof(UNLOCK_RESPONSE));
+    TEST_INT_EQUAL(e->server->securityLevel, 1);
+}
+
+void test_0x27_deferred_key_check_fails(void **state) {
+    Env_t *e = *state;
+    AsyncKeyCtx_t ctx = {0};
+    const uint8_t NEG_RESPONSE[] = {0x7F, 0x27, 0x35};
+    UnlockAsync(e, &ctx, UDS_NRC_InvalidKey, NEG_RESPONSE, sizeof(NEG_RESPONSE));
+    TEST_INT_EQUAL(e->server->securityLevel, 0);
+
+    // the failed check starts the brute force delay
+    uint8_t buf[8] = {0};
+    const uint8_t SEED_REQUEST[] = {0x27, 0x01};
+    const uint8_t DENIED[] = {0x7F, 0x27, 0x36};
+    UDSTpSend(e->client_tp, SEED_REQUEST, sizeof(SEED_REQUEST), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, DENIED, sizeof(DENIED));
+}
+
+typedef struct {
+    bool defer;              /* defer verifyCertificateUnidirectional */
+    UDSPendingToken_t token; /* deferred certificate check */
+    uint8_t last_type;       /* authenticationTask of the last event */
+} AuthCtx_t;
+
+int fn_test_0x29(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    AuthCtx_t *ctx = srv->fn_data;
+    TEST_INT_EQUAL(ev, UDS_EVT_Authentication);
+    UDSAuthArgs_t *args = arg;
+    ctx->last_type = args->type;
+    switch (args->type) {
+    case UDS_LEV_AT_DA:
+        return UDS_PositiveResponse;
+    case UDS_LEV_AT_VCU: {
+        const uint8_t CERT[] = {0xC0, 0xC1, 0xC2};
+        const uint8_t CHALLENGE[] = {0xD0, 0xD1};
+        TEST_INT_EQUAL(args->communicationConfiguration, 0x00);
+        TEST_INT_EQUAL(args->certificateLen, sizeof(CERT));
+        TEST_MEMORY_EQUAL(args->certificate, CERT, sizeof(CERT));
+        TEST_INT_EQUAL(args->challengeLen, sizeof(CHALLENGE));
+        TEST_MEMORY_EQUAL(args->challenge, CHALLENGE, sizeof(CHALLENGE));
+        if (ctx->defer) {
+            return UDSServerDeferResponse(srv, &ctx->token);
+        }
+        // CertificateVerified_OwnershipVerificationNecessary, challengeServer, no ephemeral key
+        const uint8_t resp[] = {UDS_AT_CVOVN, 0x00, 0x02, 0xE0, 0xE1, 0x00, 0x00};
+        return args->copy(srv, resp, sizeof(resp));
+    }
+    case UDS_LEV_AT_POWN: {
+        const uint8_t POWN[] = {0xF0, 0xF1, 0xF2, 0xF3};
+        if (args->proofOfOwnershipLen != sizeof(POWN) ||
+            memcmp(args->proofOfOwnership, POWN, sizeof(POWN))) {
+            return UDS_NRC_OwnershipVerificationFailed;
+        }
+        TEST_INT_EQUAL(args->ephemeralPublicKeyLen, 0);
+        const uint8_t resp[] = {UDS_AT_OVAC, 0x00, 0x00}; // no sessionKeyInfo
+        return args->copy(srv, resp, sizeof(resp));
+    }
+    default:
+        return UDS_NRC_SubFunctionNotSupported;
+    }
+}
+
+// 0x29 Authentication with PKI Certificate Exchange, unidirectional
+void test_0x29_certificate_exchange(void **state) {
+    Env_t *e = *state;
+    uint8_t buf[16] = {0};
+    AuthCtx_t ctx = {0};
+    e->server->fn = fn_test_0x29;
+    e->server->fn_data = &ctx;
+    TEST_INT_EQUAL(e->server->authState, UDS_AUTH_NONE);
+
+    const uint8_t VCU_REQ[] = {
+        0x29,             /* SID */
+        0x01,             /* verifyCertificateUnidirectional */
+        0x00,             /* communicationConfiguration */
+        0x00, 0x03,       /* lengthOfCertificateClient */
+        0xC0, 0xC1, 0xC2, /* certificateClient */
+        0x00, 0x02,       /* lengthOfChallengeClient */
+        0xD0, 0xD1,       /* challengeClient */
+    };
+    const uint8_t VCU_RESP[] = {0x69, 0x01, 0x11, 0x00, 0x02, 0xE0, 0xE1, 0x00, 0x00};
+    UDSTpSend(e->client_tp, VCU_REQ, sizeof(VCU_REQ), NULL);
     EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
                      UDS_CLIENT_DEFAULT_P2_MS);
-    TEST_MEMORY_EQUAL(buf, SEED_RESPONSE, sizeof(SEED_RESPONSE));
-
-    // the server security level should still be 0
-    TEST_INT_EQUAL(e->server->securityLevel, 0);
+    TEST_MEMORY_EQUAL(buf, VCU_RESP, sizeof(VCU_RESP));
+    TEST_INT_EQUAL(e->server->authState, UDS_AUTH_CERT_VERIFIED);
+
+    const uint8_t POWN_REQ[] = {
+        0x29,                   /* SID */
+        0x03,                   /* proofOfOwnership */
+        0x00, 0x04,             /* lengthOfProofOfOwnershipClient */
+        0xF0, 0xF1, 0xF2, 0xF3, /* proofOfOwnershipClient */
+        0x00, 0x00,             /* lengthOfEphemeralPublicKeyClient */
+    };
+    const uint8_t POWN_RESP[] = {0x69, 0x03, 0x12, 0x00, 0x00};
+    UDSTpSend(e->client_tp, POWN_REQ, sizeof(POWN_REQ), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, POWN_RESP, sizeof(POWN_RESP));
+    TEST_INT_EQUAL(e->server->authState, UDS_AUTH_AUTHENTICATED);
 
-    // sending a bad unlock request
-    const uint8_t UNLOCK_REQUEST[] = {0x27, 0x02, 0xFF, 0xFF};
-    UDSTpSend(e->client_tp, UNLOCK_REQUEST, sizeof(UNLOCK_REQUEST), NULL);
+    const uint8_t DA_REQ[] = {0x29, 0x00};
+    const uint8_t DA_RESP[] = {0x69, 0x00, 0x10};
+    UDSTpSend(e->client_tp, DA_REQ, sizeof(DA_REQ), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, DA_RESP, sizeof(DA_RESP));
+    TEST_INT_EQUAL(e->server->authState, UDS_AUTH_NONE);
+}
 
-    // should get a negative response
-    const uint8_t NEG_RESPONSE[] = {0x7F, 0x27, 0x33};
+void test_0x29_deferred_certificate_check(void **state) {
+    Env_t *e = *state;
+    uint8_t buf[16] = {0};
+    AuthCtx_t ctx = {.defer = true};
+    e->server->fn = fn_test_0x29;
+    e->server->fn_data = &ctx;
+
+    const uint8_t VCU_REQ[] = {0x29, 0x01, 0x00, 0x00, 0x03, 0xC0,
+                               0xC1, 0xC2, 0x00, 0x02, 0xD0, 0xD1};
+    const uint8_t RCRRP[] = {0x7F, 0x29, 0x78};
+    UDSTpSend(e->client_tp, VCU_REQ, sizeof(VCU_REQ), NULL);
     EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
                      UDS_CLIENT_DEFAULT_P2_MS);
-    TEST_MEMORY_EQUAL(buf, NEG_RESPONSE, sizeof(NEG_RESPONSE));
+    TEST_MEMORY_EQUAL(buf, RCRRP, sizeof(RCRRP));
+    TEST_INT_EQUAL(e->server->authState, UDS_AUTH_NONE);
 
-    // the server security level should still be 0
-    TEST_INT_EQUAL(e->server->securityLevel, 0);
+    const uint8_t RESULT[] = {UDS_AT_CVOVN, 0x00, 0x00, 0x00, 0x00};
+    TEST_ERR_EQUAL(UDS_OK, UDSServerCompleteResponse(e->server, ctx.token, UDS_PositiveResponse,
+                                                     RESULT, sizeof(RESULT)));
+    const uint8_t VCU_RESP[] = {0x69, 0x01, 0x11, 0x00, 0x00, 0x00, 0x00};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, VCU_RESP, sizeof(VCU_RESP));
+    TEST_INT_EQUAL(e->server->authState, UDS_AUTH_CERT_VERIFIED);
+}
 
-    // and sending another seed request right away
-    UDSTpSend(e->client_tp, SEED_REQUEST, sizeof(SEED_REQUEST), NULL);
+void test_0x29_invalid_requests(void **state) {
+    Env_t *e = *state;
+    uint8_t buf[16] = {0};
+    AuthCtx_t ctx = {0};
+    e->server->fn = fn_test_0x29;
+    e->server->fn_data = &ctx;
+
+    // proofOfOwnership before a certificate was verified
+    const uint8_t POWN_REQ[] = {0x29, 0x03, 0x00, 0x04, 0xF0, 0xF1, 0xF2, 0xF3, 0x00, 0x00};
+    const uint8_t SEQUENCE_ERROR[] = {0x7F, 0x29, 0x24};
+    UDSTpSend(e->client_tp, POWN_REQ, sizeof(POWN_REQ), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, SEQUENCE_ERROR, sizeof(SEQUENCE_ERROR));
 
-    // should get a negative response due to brute force prevention
-    const uint8_t DENIED[] = {0x7F, 0x27, 0x36};
+    // lengthOfCertificateClient runs past the end of the request
+    const uint8_t SHORT_REQ[] = {0x29, 0x01, 0x00, 0x00, 0x09, 0xC0, 0xC1};
+    const uint8_t FORMAT_ERROR[] = {0x7F, 0x29, 0x13};
+    UDSTpSend(e->client_tp, SHORT_REQ, sizeof(SHORT_REQ), NULL);
     EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
-                     UDS_CLIENT_DEFAULT_P2_MS)
-    TEST_MEMORY_EQUAL(buf, DENIED, sizeof(DENIED));
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, FORMAT_ERROR, sizeof(FORMAT_ERROR));
+    TEST_INT_EQUAL(ctx.last_type, 0);
 }
 
 UDSErr_t fn_test_0x28_comm_ctrl(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
@@ -3513,6 +4843,192 @@ void test_0x2C_sub_0x03_negative_response(void **state) {
     TEST_MEMORY_EQUAL(buf, EXPECTED_RESP, sizeof(EXPECTED_RESP));
 }
 
+static uint8_t dddi_table_src[] = {0x11, 0x22, 0x33, 0x44};
+static uint8_t dddi_mem_src[] = {0xC0, 0xC1};
+
+static UDSDIDEntry_t dddi_did_table[] = {
+    {.did = 0x1234, .len = sizeof(dddi_table_src), .ptr = dddi_table_src, .access = UDS_DID_READ},
+};
+
+UDSErr_t fn_test_0x2C_engine(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    switch (ev) {
+    case UDS_EVT_DynamicDefineDataId:
+        return UDS_PositiveResponse;
+    case UDS_EVT_ReadDataByIdent: {
+        UDSRDBIArgs_t *args = arg;
+        const uint8_t record[] = {0xA0, 0xA1, 0xA2};
+        if (args->dataId != 0x5678) {
+            return UDS_NRC_RequestOutOfRange;
+        }
+        return args->copy(srv, record, sizeof(record));
+    }
+    case UDS_EVT_ReadMemByAddr: {
+        UDSReadMemByAddrArgs_t *args = arg;
+        return args->copy(srv, args->memAddr, (uint16_t)args->memSize);
+    }
+    default:
+        return UDS_NRC_ServiceNotSupported;
+    }
+}
+
+void test_0x2C_defined_did_is_read_by_0x22(void **state) {
+    Env_t *e = *state;
+    e->server->fn = fn_test_0x2C_engine;
+    UDSServerRegisterDIDs(e->server, dddi_did_table,
+                          sizeof(dddi_did_table) / sizeof(dddi_did_table[0]));
+
+    // define 0xF300 from bytes 2-3 of DID 0x1234 (DID table) and byte 3 of DID 0x5678 (event)
+    const uint8_t DEFINE_BY_ID[] = {0x2C, 0x01, 0xF3, 0x00, 0x12, 0x34,
+                                    0x02, 0x02, 0x56, 0x78, 0x03, 0x01};
+    const uint8_t DEFINE_BY_ID_RESP[] = {0x6C, 0x01, 0xF3, 0x00};
+    Exchange(e, DEFINE_BY_ID, sizeof(DEFINE_BY_ID), DEFINE_BY_ID_RESP, sizeof(DEFINE_BY_ID_RESP));
+
+    // and append the second byte of dddi_mem_src
+    uint8_t define_by_mem[32] = {0x2C, 0x02, 0xF3, 0x00, 0x10 | sizeof(void *)};
+    uintptr_t addr = (uintptr_t)&dddi_mem_src[1];
+    size_t len = 5;
+    for (size_t i = 0; i < sizeof(void *); i++) {
+        define_by_mem[len++] = (uint8_t)(addr >> (8 * (sizeof(void *) - 1 - i)));
+    }
+    define_by_mem[len++] = 1;
+    const uint8_t DEFINE_BY_MEM_RESP[] = {0x6C, 0x02, 0xF3, 0x00};
+    Exchange(e, define_by_mem, len, DEFINE_BY_MEM_RESP, sizeof(DEFINE_BY_MEM_RESP));
+
+    // reading the dynamic DID should produce the composed record
+    const uint8_t READ[] = {0x22, 0xF3, 0x00};
+    const uint8_t READ_RESP[] = {0x62, 0xF3, 0x00, 0x22, 0x33, 0xA2, 0xC1};
+    Exchange(e, READ, sizeof(READ), READ_RESP, sizeof(READ_RESP));
+
+    // with the current source data
+    dddi_table_src[1] = 0x55;
+    const uint8_t READ_RESP_2[] = {0x62, 0xF3, 0x00, 0x55, 0x33, 0xA2, 0xC1};
+    Exchange(e, READ, sizeof(READ), READ_RESP_2, sizeof(READ_RESP_2));
+    dddi_table_src[1] = 0x22;
+
+    // once cleared, the DID is no longer served by the server
+    const uint8_t CLEAR[] = {0x2C, 0x03, 0xF3, 0x00};
+    const uint8_t CLEAR_RESP[] = {0x6C, 0x03, 0xF3, 0x00};
+    Exchange(e, CLEAR, sizeof(CLEAR), CLEAR_RESP, sizeof(CLEAR_RESP));
+    const uint8_t OUT_OF_RANGE[] = {0x7F, 0x22, 0x31};
+    Exchange(e, READ, sizeof(READ), OUT_OF_RANGE, sizeof(OUT_OF_RANGE));
+}
+
+void test_0x2C_rejected_definition_is_not_stored(void **state) {
+    Env_t *e = *state;
+    e->server->fn = fn_test_0x2C_engine;
+    UDSServerRegisterDIDs(e->server, dddi_did_table,
+                          sizeof(dddi_did_table) / sizeof(dddi_did_table[0]));
+
+    // the second source reaches past the end of DID 0x1234
+    const uint8_t DEFINE[] = {0x2C, 0x01, 0xF3, 0x01, 0x12, 0x34,
+                              0x01, 0x01, 0x12, 0x34, 0x04, 0x02};
+    const uint8_t DEFINE_RESP[] = {0x7F, 0x2C, 0x31};
+    Exchange(e, DEFINE, sizeof(DEFINE), DEFINE_RESP, sizeof(DEFINE_RESP));
+
+    // so no part of the definition should have been kept
+    const uint8_t READ[] = {0x22, 0xF3, 0x01};
+    const uint8_t READ_RESP[] = {0x7F, 0x22, 0x31};
+    Exchange(e, READ, sizeof(READ), READ_RESP, sizeof(READ_RESP));
+    TEST_INT_EQUAL(e->server->dddiCount, 0);
+}
+
+void test_0x2C_locked_source_did_is_denied(void **state) {
+    Env_t *e = *state;
+    e->server->fn = fn_test_0x2C_engine;
+    UDSDIDEntry_t table[] = {
+        {.did = 0x1234,
+         .len = sizeof(dddi_table_src),
+         .ptr = dddi_table_src,
+         .access = UDS_DID_READ,
+         .securityLevel = 0x01},
+    };
+    UDSServerRegisterDIDs(e->server, table, 1);
+
+    // the source DID needs security level 1
+    const uint8_t DEFINE[] = {0x2C, 0x01, 0xF3, 0x02, 0x12, 0x34, 0x01, 0x01};
+    const uint8_t DENIED[] = {0x7F, 0x2C, 0x33};
+    Exchange(e, DEFINE, sizeof(DEFINE), DENIED, sizeof(DENIED));
+    TEST_INT_EQUAL(e->server->dddiCount, 0);
+
+    e->server->securityLevel = 0x01;
+    const uint8_t DEFINE_RESP[] = {0x6C, 0x01, 0xF3, 0x02};
+    Exchange(e, DEFINE, sizeof(DEFINE), DEFINE_RESP, sizeof(DEFINE_RESP));
+}
+
+UDSErr_t fn_test_0x2C_session(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    switch (ev) {
+    case UDS_EVT_DiagSessCtrl:
+    case UDS_EVT_EcuReset:
+    case UDS_EVT_SessionTimeout:
+        return UDS_PositiveResponse;
+    default:
+        return fn_test_0x2C_engine(srv, ev, arg);
+    }
+}
+
+static const uint8_t DDDI_DEFINE[] = {0x2C, 0x01, 0xF3, 0x00, 0x12, 0x34, 0x01, 0x01};
+static const uint8_t DDDI_DEFINE_RESP[] = {0x6C, 0x01, 0xF3, 0x00};
+static const uint8_t DDDI_READ[] = {0x22, 0xF3, 0x00};
+static const uint8_t DDDI_READ_RESP[] = {0x62, 0xF3, 0x00, 0x11};
+static const uint8_t DDDI_READ_OUT_OF_RANGE[] = {0x7F, 0x22, 0x31};
+
+static void DDDIChangeSession(Env_t *e, uint8_t sessionType) {
+    uint8_t buf[8] = {0};
+    const uint8_t REQ[] = {0x10, sessionType};
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_INT_EQUAL(buf[0], 0x50);
+    TEST_INT_EQUAL(buf[1], sessionType);
+}
+
+void test_0x2C_definitions_cleared_in_default_session(void **state) {
+    Env_t *e = *state;
+    e->server->fn = fn_test_0x2C_session;
+    UDSServerRegisterDIDs(e->server, dddi_did_table,
+                          sizeof(dddi_did_table) / sizeof(dddi_did_table[0]));
+
+    // a DID defined in the extended session
+    DDDIChangeSession(e, UDS_LEV_DS_EXTDS);
+    Exchange(e, DDDI_DEFINE, sizeof(DDDI_DEFINE), DDDI_DEFINE_RESP, sizeof(DDDI_DEFINE_RESP));
+    Exchange(e, DDDI_READ, sizeof(DDDI_READ), DDDI_READ_RESP, sizeof(DDDI_READ_RESP));
+
+    // survives a change to another non-default session
+    DDDIChangeSession(e, UDS_LEV_DS_PRGS);
+    Exchange(e, DDDI_READ, sizeof(DDDI_READ), DDDI_READ_RESP, sizeof(DDDI_READ_RESP));
+
+    // and is cleared by a return to the default session
+    DDDIChangeSession(e, UDS_LEV_DS_DS);
+    Exchange(e, DDDI_READ, sizeof(DDDI_READ), DDDI_READ_OUT_OF_RANGE,
+             sizeof(DDDI_READ_OUT_OF_RANGE));
+    TEST_INT_EQUAL(e->server->dddiCount, 0);
+
+    // or by a session timeout
+    DDDIChangeSession(e, UDS_LEV_DS_EXTDS);
+    Exchange(e, DDDI_DEFINE, sizeof(DDDI_DEFINE), DDDI_DEFINE_RESP, sizeof(DDDI_DEFINE_RESP));
+    TEST_INT_EQUAL(e->server->dddiCount, 1);
+    EnvRunMillis(e, e->server->s3_ms + 10);
+    TEST_INT_EQUAL(e->server->sessionType, UDS_LEV_DS_DS);
+    TEST_INT_EQUAL(e->server->dddiCount, 0);
+}
+
+void test_0x2C_definitions_cleared_on_ecu_reset(void **state) {
+    Env_t *e = *state;
+    e->server->fn = fn_test_0x2C_session;
+    UDSServerRegisterDIDs(e->server, dddi_did_table,
+                          sizeof(dddi_did_table) / sizeof(dddi_did_table[0]));
+    Exchange(e, DDDI_DEFINE, sizeof(DDDI_DEFINE), DDDI_DEFINE_RESP, sizeof(DDDI_DEFINE_RESP));
+    Exchange(e, DDDI_READ, sizeof(DDDI_READ), DDDI_READ_RESP, sizeof(DDDI_READ_RESP));
+
+    // When the ECU is reset
+    const uint8_t RESET[] = {0x11, UDS_LEV_RT_HR};
+    const uint8_t RESET_RESP[] = {0x51, UDS_LEV_RT_HR};
+    Exchange(e, RESET, sizeof(RESET), RESET_RESP, sizeof(RESET_RESP));
+
+    // the dynamically defined DID should be gone
+    TEST_INT_EQUAL(e->server->dddiCount, 0);
+}
+
 int fn_test_0x2F(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
     UDSIOCtrlArgs_t *args = arg;
 
@@ -3701,6 +5217,93 @@ void test_0x31_RCRRP(void **state) {
     TEST_MEMORY_EQUAL(buf, POSITIVE_RESPONSE, sizeof(POSITIVE_RESPONSE));
 }
 
+typedef struct {
+    int call_count;
+    UDSPendingToken_t token;
+} DeferCtx_t;
+
+int fn_test_deferred_response(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    DeferCtx_t *ctx = srv->fn_data;
+    TEST_INT_EQUAL(ev, UDS_EVT_RoutineCtrl);
+    ctx->call_count++;
+    return UDSServerDeferResponse(srv, &ctx->token);
+}
+
+void test_deferred_response(void **state) {
+    Env_t *e = *state;
+    uint8_t buf[8] = {0};
+    DeferCtx_t ctx = {0};
+    e->server->fn = fn_test_deferred_response;
+    e->server->fn_data = &ctx;
+
+    // when a server handler defers its response
+    const uint8_t REQ[] = {0x31, 0x01, 0x12, 0x34};
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+
+    // the server should keep responding with RCRRP at intervals of p2_star * 0.3 ms
+    const uint8_t RCRRP[] = {0x7F, 0x31, 0x78};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, RCRRP, sizeof(RCRRP));
+    for (int i = 0; i < 3; i++) {
+        EXPECT_IN_APPROX_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                            e->server->p2_star_ms * 0.3);
+        TEST_MEMORY_EQUAL(buf, RCRRP, sizeof(RCRRP));
+    }
+
+    // without calling the handler again
+    TEST_INT_EQUAL(ctx.call_count, 1);
+    TEST_INT_NE(ctx.token, 0);
+
+    // When the response is completed
+    const uint8_t STATUS[] = {0xAB};
+    TEST_ERR_EQUAL(UDS_OK, UDSServerCompleteResponse(e->server, ctx.token, UDS_PositiveResponse,
+                                                     STATUS, sizeof(STATUS)));
+
+    // the server's next response should be a positive one carrying the data
+    const uint8_t POSITIVE_RESPONSE[] = {0x71, 0x01, 0x12, 0x34, 0xAB};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, POSITIVE_RESPONSE, sizeof(POSITIVE_RESPONSE));
+    TEST_INT_EQUAL(ctx.call_count, 1);
+
+    // and the token should no longer be valid
+    TEST_ERR_EQUAL(UDS_ERR_INVALID_ARG, UDSServerCompleteResponse(e->server, ctx.token,
+                                                                  UDS_PositiveResponse, NULL, 0));
+}
+
+void test_deferred_response_negative(void **state) {
+    Env_t *e = *state;
+    uint8_t buf[8] = {0};
+    DeferCtx_t ctx = {0};
+    e->server->fn = fn_test_deferred_response;
+    e->server->fn_data = &ctx;
+
+    const uint8_t REQ[] = {0x31, 0x01, 0x12, 0x34};
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+    const uint8_t RCRRP[] = {0x7F, 0x31, 0x78};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, RCRRP, sizeof(RCRRP));
+
+    // completing with 0x78 is not allowed
+    TEST_ERR_EQUAL(UDS_ERR_INVALID_ARG,
+                   UDSServerCompleteResponse(e->server, ctx.token,
+                                             UDS_NRC_RequestCorrectlyReceived_ResponsePending,
+                                             NULL, 0));
+
+    // When the response is completed with a negative response code
+    TEST_ERR_EQUAL(UDS_OK, UDSServerCompleteResponse(e->server, ctx.token,
+                                                     UDS_NRC_ConditionsNotCorrect, NULL, 0));
+
+    // the server should send it
+    const uint8_t NEGATIVE_RESPONSE[] = {0x7F, 0x31, 0x22};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, NEGATIVE_RESPONSE, sizeof(NEGATIVE_RESPONSE));
+    TEST_INT_EQUAL(ctx.call_count, 1);
+}
+
 void test_0x34_no_handler(void **state) {
     Env_t *e = *state;
     uint8_t buf[8] = {0};
@@ -3830,6 +5433,182 @@ void test_0x38_delfile(void **state) {
     TEST_MEMORY_EQUAL(buf, RESP, sizeof(RESP));
 }
 
+static UDSXferCheckpoint_t resume_saved;
+static int resume_checkpoints;
+
+int fn_test_0x38_resume_file(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    switch (ev) {
+    case UDS_EVT_RequestFileTransfer: {
+        UDSRequestFileTransferArgs_t *r = (UDSRequestFileTransferArgs_t *)arg;
+        if (UDS_MOOP_RSFILE == r->modeOfOperation) {
+            r->checkpoint = resume_saved;
+        }
+        r->maxNumberOfBlockLength = 6;
+        return UDS_PositiveResponse;
+    }
+    case UDS_EVT_TransferData:
+        return UDS_PositiveResponse;
+    case UDS_EVT_TransferCheckpoint:
+        resume_saved = *(UDSXferCheckpoint_t *)arg;
+        resume_checkpoints++;
+        return UDS_PositiveResponse;
+    default:
+        return UDS_NRC_ServiceNotSupported;
+    }
+}
+
+static void ResumeExchange(Env_t *e, const uint8_t *req, size_t req_len, const uint8_t *resp,
+                           size_t resp_len) {
+    uint8_t buf[16] = {0};
+    UDSTpSend(e->client_tp, req, req_len, NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == (ssize_t)resp_len,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, resp, resp_len);
+}
+
+void test_0x38_resume_file(void **state) {
+    Env_t *e = *state;
+    const uint8_t IMAGE[] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07};
+    memset(&resume_saved, 0, sizeof(resume_saved));
+    resume_checkpoints = 0;
+    TEST_INT_EQUAL(UDSCRC32(0, "123456789", 9), 0xCBF43926);
+
+    // When checkpoints are taken every 4 bytes of an 8 byte file
+    e->server->fn = fn_test_0x38_resume_file;
+    e->server->xferCheckpointInterval = 4;
+    const uint8_t ADDFILE_REQUEST[] = {0x38, 0x01, 0x00, 0x01, 'f', 0x00, 0x01, 0x08, 0x08};
+    const uint8_t ADDFILE_RESP[] = {0x78, 0x01, 0x02, 0x00, 0x06, 0x00};
+    ResumeExchange(e, ADDFILE_REQUEST, sizeof(ADDFILE_REQUEST), ADDFILE_RESP,
+                   sizeof(ADDFILE_RESP));
+
+    const uint8_t BLOCK1[] = {0x36, 0x01, 0x00, 0x01, 0x02, 0x03};
+    const uint8_t RESP1[] = {0x76, 0x01};
+    ResumeExchange(e, BLOCK1, sizeof(BLOCK1), RESP1, sizeof(RESP1));
+    const uint8_t BLOCK2[] = {0x36, 0x02, 0x04, 0x05};
+    const uint8_t RESP2[] = {0x76, 0x02};
+    ResumeExchange(e, BLOCK2, sizeof(BLOCK2), RESP2, sizeof(RESP2));
+
+    // a checkpoint should have been saved at byte 4 only
+    TEST_INT_EQUAL(resume_checkpoints, 1);
+    TEST_INT_EQUAL(resume_saved.byteCounter, 4);
+    TEST_INT_EQUAL(resume_saved.blockSequenceCounter, 1);
+    TEST_INT_EQUAL(resume_saved.crc, UDSCRC32(0, IMAGE, 4));
+
+    // after the ECU loses power
+    UDSTp_t *tp = e->server->tp;
+    UDSServerInit(e->server);
+    e->server->tp = tp;
+    e->server->fn = fn_test_0x38_resume_file;
+    e->server->xferCheckpointInterval = 4;
+
+    // ResumeFile should report the checkpoint as filePosition
+    const uint8_t RSFILE_REQUEST[] = {0x38, 0x06, 0x00, 0x01, 'f', 0x00, 0x01, 0x08, 0x08};
+    const uint8_t RSFILE_RESP[] = {0x78, 0x06, 0x02, 0x00, 0x06, 0x00, 0x00, 0x00,
+                                   0x00, 0x00, 0x00, 0x00, 0x00, 0x04};
+    ResumeExchange(e, RSFILE_REQUEST, sizeof(RSFILE_REQUEST), RSFILE_RESP, sizeof(RSFILE_RESP));
+
+    // and the download should continue from there with the block counter restarted
+    const uint8_t BLOCK3[] = {0x36, 0x01, 0x04, 0x05, 0x06, 0x07};
+    ResumeExchange(e, BLOCK3, sizeof(BLOCK3), RESP1, sizeof(RESP1));
+    TEST_INT_EQUAL(resume_checkpoints, 2);
+    TEST_INT_EQUAL(resume_saved.byteCounter, 8);
+    TEST_INT_EQUAL(resume_saved.crc, UDSCRC32(0, IMAGE, sizeof(IMAGE)));
+
+    // data beyond the file size should be refused
+    const uint8_t BLOCK4[] = {0x36, 0x02, 0x08};
+    const uint8_t SUSPENDED[] = {0x7F, 0x36, 0x71};
+    ResumeExchange(e, BLOCK4, sizeof(BLOCK4), SUSPENDED, sizeof(SUSPENDED));
+}
+
+void test_0x38_resume_past_end_of_file(void **state) {
+    Env_t *e = *state;
+    resume_saved = (UDSXferCheckpoint_t){.byteCounter = 9};
+    e->server->fn = fn_test_0x38_resume_file;
+
+    // a checkpoint beyond the file size should be rejected
+    const uint8_t RSFILE_REQUEST[] = {0x38, 0x06, 0x00, 0x01, 'f', 0x00, 0x01, 0x08, 0x08};
+    const uint8_t RESP[] = {0x7F, 0x38, 0x31};
+    ResumeExchange(e, RSFILE_REQUEST, sizeof(RSFILE_REQUEST), RESP, sizeof(RESP));
+
+    // and no transfer should be active
+    const uint8_t BLOCK[] = {0x36, 0x01, 0x00};
+    const uint8_t NOT_ACCEPTED[] = {0x7F, 0x36, 0x70};
+    ResumeExchange(e, BLOCK, sizeof(BLOCK), NOT_ACCEPTED, sizeof(NOT_ACCEPTED));
+}
+
+typedef struct {
+    uint32_t exit_crc;     /* crc passed to UDS_EVT_RequestTransferExit */
+    size_t exit_bytes;     /* byteCount passed to UDS_EVT_RequestTransferExit */
+    uint32_t routine_crc;  /* xferCrc passed to UDS_EVT_RoutineCtrl */
+    size_t routine_bytes;  /* xferByteCount passed to UDS_EVT_RoutineCtrl */
+    size_t digest_bytes;   /* bytes passed to xferDigestUpdate */
+} DigestCtx_t;
+
+static void digest_update(UDSServer_t *srv, const uint8_t *data, uint16_t len) {
+    DigestCtx_t *ctx = srv->fn_data;
+    ctx->digest_bytes += len;
+}
+
+int fn_test_0x36_running_crc(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    DigestCtx_t *ctx = srv->fn_data;
+    switch (ev) {
+    case UDS_EVT_RequestDownload:
+        ((UDSRequestDownloadArgs_t *)arg)->maxNumberOfBlockLength = 0x0010;
+        return UDS_PositiveResponse;
+    case UDS_EVT_TransferData:
+        return UDS_PositiveResponse;
+    case UDS_EVT_RequestTransferExit: {
+        UDSRequestTransferExitArgs_t *r = (UDSRequestTransferExitArgs_t *)arg;
+        ctx->exit_crc = r->crc;
+        ctx->exit_bytes = r->byteCount;
+        return UDS_PositiveResponse;
+    }
+    case UDS_EVT_RoutineCtrl: {
+        UDSRoutineCtrlArgs_t *r = (UDSRoutineCtrlArgs_t *)arg;
+        ctx->routine_crc = r->xferCrc;
+        ctx->routine_bytes = r->xferByteCount;
+        return UDS_PositiveResponse;
+    }
+    default:
+        return UDS_NRC_ServiceNotSupported;
+    }
+}
+
+void test_0x36_running_crc(void **state) {
+    Env_t *e = *state;
+    DigestCtx_t ctx = {0};
+    const uint8_t IMAGE[] = {0x10, 0x20, 0x30, 0x40, 0x50, 0x60};
+    e->server->fn = fn_test_0x36_running_crc;
+    e->server->fn_data = &ctx;
+    e->server->xferDigestUpdate = digest_update;
+
+    // When an image is downloaded in two blocks
+    const uint8_t REQ[] = {0x34, 0x00, 0x11, 0x10, 0x06};
+    const uint8_t RESP[] = {0x74, 0x20, 0x00, 0x10};
+    ResumeExchange(e, REQ, sizeof(REQ), RESP, sizeof(RESP));
+    const uint8_t BLOCK1[] = {0x36, 0x01, 0x10, 0x20, 0x30, 0x40};
+    const uint8_t RESP1[] = {0x76, 0x01};
+    ResumeExchange(e, BLOCK1, sizeof(BLOCK1), RESP1, sizeof(RESP1));
+    const uint8_t BLOCK2[] = {0x36, 0x02, 0x50, 0x60};
+    const uint8_t RESP2[] = {0x76, 0x02};
+    ResumeExchange(e, BLOCK2, sizeof(BLOCK2), RESP2, sizeof(RESP2));
+    const uint8_t EXIT[] = {0x37};
+    const uint8_t EXIT_RESP[] = {0x77};
+    ResumeExchange(e, EXIT, sizeof(EXIT), EXIT_RESP, sizeof(EXIT_RESP));
+
+    // the exit handler should see the CRC of the whole image without reading it back
+    TEST_INT_EQUAL(ctx.exit_crc, UDSCRC32(0, IMAGE, sizeof(IMAGE)));
+    TEST_INT_EQUAL(ctx.exit_bytes, sizeof(IMAGE));
+    TEST_INT_EQUAL(ctx.digest_bytes, sizeof(IMAGE));
+
+    // and so should a check-memory routine run afterwards
+    const uint8_t RC_REQ[] = {0x31, 0x01, 0xFF, 0x01};
+    const uint8_t RC_RESP[] = {0x71, 0x01, 0xFF, 0x01};
+    ResumeExchange(e, RC_REQ, sizeof(RC_REQ), RC_RESP, sizeof(RC_RESP));
+    TEST_INT_EQUAL(ctx.routine_crc, ctx.exit_crc);
+    TEST_INT_EQUAL(ctx.routine_bytes, sizeof(IMAGE));
+}
+
 int fn_test_0x3e_suppress_positive_response(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
     return UDS_PositiveResponse;
 }
@@ -3869,6 +5648,235 @@ UDSErr_t fn_test_0x85_control_dtc_setting(UDSServer_t *srv, UDSEvent_t ev, void
 }
 
 // ISO14229-1 2020 10.8.5.2 Example #2 - ControlDTCSetting ( DTCSettingType = on)
+/* toy 0x84 crypto: XOR "encryption", a one byte sum "MAC" and an incrementing anti-replay counter */
+typedef struct {
+    uint16_t counter; /* next expected antiReplayCounter */
+    int unwraps;      /* calls to unwrap */
+    bool secured;     /* UDSServerRequestIsSecured() in the last event */
+} SecuredCtx_t;
+
+static uint8_t ToyMac(const uint8_t *data, uint16_t len) {
+    uint8_t mac = 0;
+    for (uint16_t i = 0; i < len; i++) {
+        mac = (uint8_t)(mac + data[i]);
+    }
+    return mac;
+}
+
+static UDSErr_t ToyUnwrap(void *ctx, const UDSSecuredHeader_t *hdr, const uint8_t *in, uint8_t *out,
+                          uint16_t len, const uint8_t *sig) {
+    SecuredCtx_t *c = ctx;
+    c->unwraps++;
+    if (hdr->antiReplayCounter != c->counter || 1 != hdr->signatureLength ||
+        sig[0] != ToyMac(in, len)) {
+        return UDS_NRC_SecureDataVerificationFailed;
+    }
+    c->counter++;
+    for (uint16_t i = 0; out && i < len; i++) {
+        out[i] = in[i] ^ 0x5A;
+    }
+    return UDS_PositiveResponse;
+}
+
+static UDSErr_t ToyWrap(void *ctx, UDSSecuredHeader_t *hdr, uint8_t *data, uint16_t len,
+                        uint8_t *sig, uint16_t sigSize) {
+    for (uint16_t i = 0; (hdr->administrativeParameter & UDS_SDT_AP_ENCRYPTED) && i < len; i++) {
+        data[i] ^= 0x5A;
+    }
+    sig[0] = ToyMac(data, len);
+    hdr->signatureLength = 1;
+    return UDS_PositiveResponse;
+}
+
+UDSErr_t fn_test_0x83(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    switch (ev) {
+    case UDS_EVT_DiagSessCtrl:
+        return UDS_PositiveResponse;
+    case UDS_EVT_AccessTimingParam: {
+        UDSAccessTimingArgs_t *args = arg;
+        // refuse to go below 20 ms
+        return args->p2_ms < 20 ? UDS_NRC_ConditionsNotCorrect : UDS_PositiveResponse;
+    }
+    default:
+        return UDS_NRC_GeneralReject;
+    }
+}
+
+static void Exchange0x83(Env_t *e, const uint8_t *req, size_t reqLen, const uint8_t *resp,
+                         size_t respLen) {
+    uint8_t buf[20] = {0};
+    UDSTpSend(e->client_tp, req, reqLen, NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, resp, respLen);
+}
+
+void test_0x83_read_extended_timing_parameter_set(void **state) {
+    Env_t *e = *state;
+    e->server->fn = fn_test_0x83;
+
+    const uint8_t REQ[] = {0x83, 0x01};
+    const uint8_t RESP[] = {
+        0xC3, 0x01,             /* readExtendedTimingParameterSet */
+        0x00, 0x0A, 0x00, 0x0A, /* shortest: 10 ms, 100 ms */
+        0x00, 0x32, 0x01, 0xF4, /* longest: 50 ms, 5000 ms */
+    };
+    Exchange0x83(e, REQ, sizeof(REQ), RESP, sizeof(RESP));
+}
+
+void test_0x83_set_given_values_until_session_change(void **state) {
+    Env_t *e = *state;
+    e->server->fn = fn_test_0x83;
+
+    const uint8_t SET[] = {0x83, 0x04, 0x00, 0x14, 0x00, 0x32};
+    const uint8_t SET_RESP[] = {0xC3, 0x04};
+    Exchange0x83(e, SET, sizeof(SET), SET_RESP, sizeof(SET_RESP));
+    TEST_INT_EQUAL(e->server->p2_ms, 20);
+    TEST_INT_EQUAL(e->server->p2_star_ms, 500);
+
+    const uint8_t READ[] = {0x83, 0x03};
+    const uint8_t READ_RESP[] = {0xC3, 0x03, 0x00, 0x14, 0x00, 0x32};
+    Exchange0x83(e, READ, sizeof(READ), READ_RESP, sizeof(READ_RESP));
+
+    // a session change restores the configured values
+    const uint8_t DSC[] = {0x10, 0x03};
+    const uint8_t DSC_RESP[] = {0x50, 0x03};
+    Exchange0x83(e, DSC, sizeof(DSC), DSC_RESP, sizeof(DSC_RESP));
+    TEST_INT_EQUAL(e->server->p2_ms, UDS_SERVER_DEFAULT_P2_MS);
+    TEST_INT_EQUAL(e->server->p2_star_ms, UDS_SERVER_DEFAULT_P2_STAR_MS);
+
+    Exchange0x83(e, SET, sizeof(SET), SET_RESP, sizeof(SET_RESP));
+    const uint8_t DEFAULT[] = {0x83, 0x02};
+    const uint8_t DEFAULT_RESP[] = {0xC3, 0x02};
+    Exchange0x83(e, DEFAULT, sizeof(DEFAULT), DEFAULT_RESP, sizeof(DEFAULT_RESP));
+    TEST_INT_EQUAL(e->server->p2_ms, UDS_SERVER_DEFAULT_P2_MS);
+    TEST_INT_EQUAL(e->server->p2_star_ms, UDS_SERVER_DEFAULT_P2_STAR_MS);
+}
+
+void test_0x83_set_given_values_out_of_range(void **state) {
+    Env_t *e = *state;
+    e->server->fn = fn_test_0x83;
+    const uint8_t OUT_OF_RANGE[] = {0x7F, 0x83, 0x31};
+
+    const uint8_t TOO_SHORT[] = {0x83, 0x04, 0x00, 0x05, 0x00, 0x32};
+    Exchange0x83(e, TOO_SHORT, sizeof(TOO_SHORT), OUT_OF_RANGE, sizeof(OUT_OF_RANGE));
+    const uint8_t TOO_LONG[] = {0x83, 0x04, 0x00, 0x64, 0x00, 0x32};
+    Exchange0x83(e, TOO_LONG, sizeof(TOO_LONG), OUT_OF_RANGE, sizeof(OUT_OF_RANGE));
+    const uint8_t STAR_TOO_LONG[] = {0x83, 0x04, 0x00, 0x14, 0x01, 0xF5};
+    Exchange0x83(e, STAR_TOO_LONG, sizeof(STAR_TOO_LONG), OUT_OF_RANGE, sizeof(OUT_OF_RANGE));
+
+    // within the limits, but refused by the application
+    const uint8_t REFUSED[] = {0x83, 0x04, 0x00, 0x0A, 0x00, 0x32};
+    const uint8_t REFUSED_RESP[] = {0x7F, 0x83, 0x22};
+    Exchange0x83(e, REFUSED, sizeof(REFUSED), REFUSED_RESP, sizeof(REFUSED_RESP));
+
+    const uint8_t BAD_LEN[] = {0x83, 0x04, 0x00, 0x14};
+    const uint8_t BAD_LEN_RESP[] = {0x7F, 0x83, 0x13};
+    Exchange0x83(e, BAD_LEN, sizeof(BAD_LEN), BAD_LEN_RESP, sizeof(BAD_LEN_RESP));
+    TEST_INT_EQUAL(e->server->p2_ms, UDS_SERVER_DEFAULT_P2_MS);
+}
+
+int fn_test_0x84(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    SecuredCtx_t *ctx = srv->secured->ctx;
+    TEST_INT_EQUAL(ev, UDS_EVT_ReadDataByIdent);
+    ctx->secured = UDSServerRequestIsSecured(srv);
+    UDSRDBIArgs_t *args = arg;
+    const uint8_t data[] = {0xAB, 0xCD};
+    return args->copy(srv, data, sizeof(data));
+}
+
+static void SetupSecured(Env_t *e, UDSSecuredProvider_t *provider, SecuredCtx_t *ctx) {
+    *provider = (UDSSecuredProvider_t){.unwrap = ToyUnwrap, .wrap = ToyWrap, .ctx = ctx};
+    e->server->secured = provider;
+    e->server->fn = fn_test_0x84;
+}
+
+// 0x22 ReadDataByIdentifier inside of a signed 0x84 request
+void test_0x84_signed_request(void **state) {
+    Env_t *e = *state;
+    uint8_t buf[32] = {0};
+    SecuredCtx_t ctx = {.counter = 0x0102};
+    UDSSecuredProvider_t provider;
+    SetupSecured(e, &provider, &ctx);
+
+    const uint8_t REQ[] = {
+        0x84,             /* SID */
+        0x00, 0x09,       /* administrativeParameter: request, signed */
+        0x01,             /* signatureEncryptionCalculation */
+        0x00, 0x01,       /* signatureLength */
+        0x01, 0x02,       /* antiReplayCounter */
+        0x22, 0xF1, 0x90, /* internal request */
+        0xA3,             /* signature: 0x22 + 0xF1 + 0x90 */
+    };
+    const uint8_t RESP[] = {
+        0xC4,                         /* response SID */
+        0x00, 0x08,                   /* administrativeParameter: response, signed */
+        0x01,                         /* signatureEncryptionCalculation */
+        0x00, 0x01,                   /* signatureLength */
+        0x01, 0x02,                   /* antiReplayCounter */
+        0x62, 0xF1, 0x90, 0xAB, 0xCD, /* internal response */
+        0x5B,                         /* signature */
+    };
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, RESP, sizeof(RESP));
+    TEST_INT_EQUAL(ctx.secured, true);
+
+    // replaying the request fails the anti-replay check
+    const uint8_t NEG_RESP[] = {0x7F, 0x84, 0x3A};
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, NEG_RESP, sizeof(NEG_RESP));
+    TEST_INT_EQUAL(ctx.unwraps, 2);
+}
+
+void test_0x84_encrypted_request(void **state) {
+    Env_t *e = *state;
+    uint8_t buf[32] = {0};
+    SecuredCtx_t ctx = {0};
+    UDSSecuredProvider_t provider;
+    SetupSecured(e, &provider, &ctx);
+
+    const uint8_t REQ[] = {0x84, 0x00, 0x0D, 0x01, 0x00, 0x01, 0x00, 0x00,
+                           0x22 ^ 0x5A, 0xF1 ^ 0x5A, 0x90 ^ 0x5A,
+                           (uint8_t)((0x22 ^ 0x5A) + (0xF1 ^ 0x5A) + (0x90 ^ 0x5A))};
+    const uint8_t RESP[] = {0xC4, 0x00, 0x0C, 0x01, 0x00, 0x01, 0x00, 0x00,
+                            0x62 ^ 0x5A, 0xF1 ^ 0x5A, 0x90 ^ 0x5A, 0xAB ^ 0x5A, 0xCD ^ 0x5A};
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, RESP, sizeof(RESP));
+    TEST_INT_EQUAL(buf[sizeof(RESP)], ToyMac(&RESP[8], sizeof(RESP) - 8));
+}
+
+void test_0x84_internal_negative_response(void **state) {
+    Env_t *e = *state;
+    uint8_t buf[32] = {0};
+    SecuredCtx_t ctx = {0};
+    UDSSecuredProvider_t provider;
+    SetupSecured(e, &provider, &ctx);
+
+    // the internal request is too short: its negative response is sent secured
+    const uint8_t REQ[] = {0x84, 0x00, 0x09, 0x01, 0x00, 0x01, 0x00, 0x00, 0x22, 0x22};
+    const uint8_t RESP[] = {0xC4, 0x00, 0x08, 0x01, 0x00, 0x01, 0x00,
+                            0x00, 0x7F, 0x22, 0x13, 0xB4};
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, RESP, sizeof(RESP));
+
+    // the signatureLength runs past the end of the request
+    const uint8_t BAD_REQ[] = {0x84, 0x00, 0x09, 0x01, 0x00, 0x08, 0x00, 0x01, 0x22, 0x00};
+    const uint8_t NEG_RESP[] = {0x7F, 0x84, 0x13};
+    UDSTpSend(e->client_tp, BAD_REQ, sizeof(BAD_REQ), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, NEG_RESP, sizeof(NEG_RESP));
+    TEST_INT_EQUAL(ctx.unwraps, 1);
+}
+
 void test_0x85_control_dtc_setting(void **state) {
     Env_t *e = *state;
     uint8_t buf[20] = {0};
@@ -4186,6 +6194,48 @@ void test_security_level_resets_on_session_timeout(void **state) {
     TEST_INT_EQUAL(e->server->securityLevel, 0);
 }
 
+static UDSErr_t fn_soak(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    int *timeouts = (int *)srv->fn_data;
+    if (UDS_EVT_SessionTimeout == ev) {
+        (*timeouts)++;
+    }
+    return UDS_PositiveResponse;
+}
+
+void test_soak_tester_present_for_hours(void **state) {
+    Env_t *e = *state;
+    int timeouts = 0;
+    e->server->fn = fn_soak;
+    e->server->fn_data = &timeouts;
+    uint8_t buf[UDS_TP_MTU] = {0};
+
+    const uint8_t SESSION_REQUEST[] = {0x10, 0x03};
+    UDSTpSend(e->client_tp, SESSION_REQUEST, sizeof(SESSION_REQUEST), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_INT_EQUAL(buf[0], 0x50);
+
+    // When a tester keeps the session alive with 0x3E 0x80 every 4 s for two simulated hours
+    const uint8_t TESTER_PRESENT[] = {0x3E, 0x80};
+    uint64_t polls = e->polls;
+    for (int i = 0; i < 2 * 3600 / 4; i++) {
+        UDSTpSend(e->client_tp, TESTER_PRESENT, sizeof(TESTER_PRESENT), NULL);
+        EnvRunMillis(e, 4000);
+        TEST_INT_EQUAL(UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL), 0);
+    }
+
+    // the session should stay active
+    TEST_INT_EQUAL(e->server->sessionType, UDS_LEV_DS_EXTDS);
+    TEST_INT_EQUAL(timeouts, 0);
+    // and time should have jumped between deadlines rather than moved 1 ms per poll
+    TEST_INT_LE((int)(e->polls - polls), 2 * 3600 / 4 * 10);
+
+    // When the tester stops, the session should time out after S3
+    EnvRunMillis(e, e->server->s3_ms + 10);
+    TEST_INT_EQUAL(e->server->sessionType, UDS_LEV_DS_DS);
+    TEST_INT_EQUAL(timeouts, 1);
+}
+
 void test_badness(void **state) { TEST_INT_EQUAL(UDS_ERR_INVALID_ARG, UDSServerInit(NULL)); }
 
 int main(int ac, char **av) {
@@ -4195,6 +6245,9 @@ int main(int ac, char **av) {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test_setup_teardown(test_default_session_does_not_timeout, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_programming_session_times_out, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_next_deadline_idle, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_next_deadline_session_timeout, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_next_deadline_response_pending, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x10_no_fn_results_in_negative_resp, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x10_no_fn_results_in_negative_resp_functional, Setup,
                                         Teardown),
@@ -4203,6 +6256,11 @@ int main(int ac, char **av) {
         cmocka_unit_test_setup_teardown(test_0x14_positive_response, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x14_incorrect_request_length, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x14_negative_response, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x14_dtc_store, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x19_dtc_store, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x19_dtc_log, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x14_dtc_log, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x14_dtc_log_group, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x19_sub_0x01, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x19_sub_0x02, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x19_sub_0x02_no_matching_dtc, Setup, Teardown),
@@ -4253,13 +6311,36 @@ int main(int ac, char **av) {
         cmocka_unit_test_setup_teardown(test_0x19_shrink_default_response_len, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x19_malformed_responses, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x22, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x22_did_table, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x22_did_table_wrong_session, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x2E_did_table, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_request_read_in_place, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_did_table_rejects_duplicates, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x22_did_table_security_level, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x31_routine_table, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x2A_periodic_did, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x2A_multiple_rates, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x2A_rejects_unknown_pdid, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x86_on_change_of_did, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x86_on_comparison_of_values, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x86_on_dtc_status_change, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x86_event_window_expires, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x86_rejects_invalid_setup, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x22_nonexistent, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x22_misuse, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x22_deferred_did_among_several, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_min_length_checked_before_handler, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x23, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x23_reserve_commit, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x27_level_is_zero_at_init, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x27_unlock, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x27_brute_force_prevention_1, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x27_brute_force_prevention_2, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x27_deferred_key_check, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x27_deferred_key_check_fails, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x29_certificate_exchange, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x29_deferred_certificate_check, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x29_invalid_requests, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x28_comm_ctrl_example1, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x28_comm_ctrl_example2, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x28_comm_ctrl_invalid_request, Setup, Teardown),
@@ -4278,19 +6359,45 @@ int main(int ac, char **av) {
         cmocka_unit_test_setup_teardown(test_0x2C_sub_0x03, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x2C_sub_0x03_clear_all, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x2C_sub_0x03_negative_response, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x2C_defined_did_is_read_by_0x22, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x2C_rejected_definition_is_not_stored, Setup,
+                                        Teardown),
+        cmocka_unit_test_setup_teardown(test_0x2C_locked_source_did_is_denied, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x2C_definitions_cleared_in_default_session, Setup,
+                                        Teardown),
+        cmocka_unit_test_setup_teardown(test_0x2C_definitions_cleared_on_ecu_reset, Setup,
+                                        Teardown),
         cmocka_unit_test_setup_teardown(test_0x2F_example, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x2F_incorrect_request_length, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x2F_negative_response, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x31_RCRRP, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_deferred_response, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_deferred_response_negative, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x34_no_handler, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x34, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x38_no_handler, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x38_addfile, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x38_delfile, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x38_resume_file, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x38_resume_past_end_of_file, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x36_running_crc, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x3D_example_1, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x3D_example_2, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x3D_example_3, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x23_mem_regions, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x23_mem_region_deferred_read, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x2C_memory_source_obeys_mem_regions, Setup,
+                                        Teardown),
+        cmocka_unit_test_setup_teardown(test_0x3D_mem_regions, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x3e_suppress_positive_response, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x83_read_extended_timing_parameter_set, Setup,
+                                        Teardown),
+        cmocka_unit_test_setup_teardown(test_0x83_set_given_values_until_session_change, Setup,
+                                        Teardown),
+        cmocka_unit_test_setup_teardown(test_0x83_set_given_values_out_of_range, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x84_signed_request, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x84_encrypted_request, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_0x84_internal_negative_response, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x85_control_dtc_setting, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_0x85_control_dtc_setting_with_control_data, Setup,
                                         Teardown),
@@ -4303,6 +6410,7 @@ int main(int ac, char **av) {
         cmocka_unit_test_setup_teardown(test_0x87_link_ctrl_negative_response, Setup, Teardown),
         cmocka_unit_test_setup_teardown(test_security_level_resets_on_session_timeout, Setup,
                                         Teardown),
+        cmocka_unit_test_setup_teardown(test_soak_tester_present_for_hours, Setup, Teardown),
     };
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
\ No newline at end of file
@@ -0,0 +1,373 @@
+#include "test/env.h"
+#include <stdint.h>
+
+#if UDS_SERVER_MAX_TESTERS < 2
+#error "this test requires UDS_SERVER_MAX_TESTERS >= 2"
+#endif
+
+typedef struct {
+    int routine_resp;     /* value returned by the 0x31 handler */
+    uint32_t routine_crc; /* xferCrc passed to the 0x31 handler */
+    size_t routine_bytes; /* xferByteCount passed to the 0x31 handler */
+} Ctx_t;
+
+static UDSTp_t *tester_tp[3];
+
+int Setup(void **state) {
+    Env_t *env = malloc(sizeof(Env_t));
+    memset(env, 0, sizeof(Env_t));
+    env->server = malloc(sizeof(UDSServer_t));
+    UDSServerInit(env->server);
+    env->server->tp = ISOTPMockNew("server", &(ISOTPMockArgs_t){.sa_phys = 0x7E0,
+                                                                .ta_phys = 0x7E8,
+                                                                .sa_func = 0x7DF,
+                                                                .ta_func = UDS_TP_NOOP_ADDR});
+    for (uint32_t i = 0; i < 3; i++) {
+        tester_tp[i] = ISOTPMockNew("tester", &(ISOTPMockArgs_t){.sa_phys = 0x7E8 + i,
+                                                                 .ta_phys = 0x7E0,
+                                                                 .sa_func = UDS_TP_NOOP_ADDR,
+                                                                 .ta_func = 0x7DF});
+    }
+    env->client_tp = tester_tp[0];
+    *state = env;
+    return 0;
+}
+
+int Teardown(void **state) {
+    Env_t *env = *state;
+    ISOTPMockFree(env->server->tp);
+    for (int i = 0; i < 3; i++) {
+        ISOTPMockFree(tester_tp[i]);
+    }
+    ISOTPMockReset();
+    free(env->server);
+    free(env);
+    return 0;
+}
+
+static UDSErr_t fn(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    Ctx_t *ctx = srv->fn_data;
+    switch (ev) {
+    case UDS_EVT_DiagSessCtrl:
+        return UDS_PositiveResponse;
+    case UDS_EVT_ReadDataByIdent: {
+        UDSRDBIArgs_t *args = arg;
+        return args->copy(srv, &srv->sessionType, 1);
+    }
+    case UDS_EVT_RoutineCtrl: {
+        UDSRoutineCtrlArgs_t *args = arg;
+        ctx->routine_crc = args->xferCrc;
+        ctx->routine_bytes = args->xferByteCount;
+        return ctx->routine_resp;
+    }
+    case UDS_EVT_AccessTimingParam:
+        return UDS_PositiveResponse;
+    case UDS_EVT_RequestDownload:
+        ((UDSRequestDownloadArgs_t *)arg)->maxNumberOfBlockLength = 0x0010;
+        return UDS_PositiveResponse;
+    case UDS_EVT_TransferData:
+    case UDS_EVT_RequestTransferExit:
+        return UDS_PositiveResponse;
+    default:
+        return UDS_NRC_ServiceNotSupported;
+    }
+}
+
+static void Recv(Env_t *e, UDSTp_t *tp, uint8_t *buf, size_t size) {
+    EXPECT_WITHIN_MS(e, UDSTpRecv(tp, buf, size, NULL) > 0, UDS_CLIENT_DEFAULT_P2_MS);
+}
+
+void test_sessions_are_per_tester(void **state) {
+    Env_t *e = *state;
+    Ctx_t ctx = {0};
+    uint8_t buf[8] = {0};
+    e->server->fn = fn;
+    e->server->fn_data = &ctx;
+
+    // when tester 0 enters the extended diagnostic session
+    const uint8_t DSC_REQ[] = {0x10, 0x03};
+    UDSTpSend(tester_tp[0], DSC_REQ, sizeof(DSC_REQ), NULL);
+    Recv(e, tester_tp[0], buf, sizeof(buf));
+    TEST_INT_EQUAL(buf[0], 0x50);
+
+    // tester 1 should still be in the default session
+    const uint8_t RDBI_REQ[] = {0x22, 0x00, 0x01};
+    UDSTpSend(tester_tp[1], RDBI_REQ, sizeof(RDBI_REQ), NULL);
+    Recv(e, tester_tp[1], buf, sizeof(buf));
+    const uint8_t DEFAULT_SESSION[] = {0x62, 0x00, 0x01, UDS_LEV_DS_DS};
+    TEST_MEMORY_EQUAL(buf, DEFAULT_SESSION, sizeof(DEFAULT_SESSION));
+
+    // and tester 0 should still be in the extended session
+    UDSTpSend(tester_tp[0], RDBI_REQ, sizeof(RDBI_REQ), NULL);
+    Recv(e, tester_tp[0], buf, sizeof(buf));
+    const uint8_t EXTENDED_SESSION[] = {0x62, 0x00, 0x01, UDS_LEV_DS_EXTDS};
+    TEST_MEMORY_EQUAL(buf, EXTENDED_SESSION, sizeof(EXTENDED_SESSION));
+}
+
+void test_pending_request_does_not_block_other_tester(void **state) {
+    Env_t *e = *state;
+    Ctx_t ctx = {.routine_resp = UDS_NRC_RequestCorrectlyReceived_ResponsePending};
+    uint8_t buf[8] = {0};
+    e->server->fn = fn;
+    e->server->fn_data = &ctx;
+
+    // when tester 0 starts a long-running routine
+    const uint8_t RC_REQ[] = {0x31, 0x01, 0x12, 0x34};
+    UDSTpSend(tester_tp[0], RC_REQ, sizeof(RC_REQ), NULL);
+    Recv(e, tester_tp[0], buf, sizeof(buf));
+    const uint8_t RCRRP[] = {0x7F, 0x31, 0x78};
+    TEST_MEMORY_EQUAL(buf, RCRRP, sizeof(RCRRP));
+
+    // tester 1 should be served while tester 0's request is pending
+    const uint8_t DSC_REQ[] = {0x10, 0x03};
+    UDSTpSend(tester_tp[1], DSC_REQ, sizeof(DSC_REQ), NULL);
+    Recv(e, tester_tp[1], buf, sizeof(buf));
+    TEST_INT_EQUAL(buf[0], 0x50);
+
+    // and tester 0 should receive its positive response once the routine completes
+    ctx.routine_resp = UDS_PositiveResponse;
+    Recv(e, tester_tp[0], buf, sizeof(buf));
+    const uint8_t RC_RESP[] = {0x71, 0x01, 0x12, 0x34};
+    TEST_MEMORY_EQUAL(buf, RC_RESP, sizeof(RC_RESP));
+}
+
+void test_busy_when_all_testers_in_use(void **state) {
+    Env_t *e = *state;
+    Ctx_t ctx = {0};
+    uint8_t buf[8] = {0};
+    e->server->fn = fn;
+    e->server->fn_data = &ctx;
+
+    // when every tester slot holds a non-default session
+    const uint8_t DSC_REQ[] = {0x10, 0x03};
+    for (int i = 0; i < UDS_SERVER_MAX_TESTERS; i++) {
+        UDSTpSend(tester_tp[i], DSC_REQ, sizeof(DSC_REQ), NULL);
+        Recv(e, tester_tp[i], buf, sizeof(buf));
+        TEST_INT_EQUAL(buf[0], 0x50);
+    }
+
+    // another tester should be told to retry
+    UDSTpSend(tester_tp[UDS_SERVER_MAX_TESTERS], DSC_REQ, sizeof(DSC_REQ), NULL);
+    Recv(e, tester_tp[UDS_SERVER_MAX_TESTERS], buf, sizeof(buf));
+    const uint8_t BUSY[] = {0x7F, 0x10, 0x21};
+    TEST_MEMORY_EQUAL(buf, BUSY, sizeof(BUSY));
+
+    // until a slot is released by a session timeout
+    EnvRunMillis(e, e->server->s3_ms + 10);
+    UDSTpSend(tester_tp[UDS_SERVER_MAX_TESTERS], DSC_REQ, sizeof(DSC_REQ), NULL);
+    Recv(e, tester_tp[UDS_SERVER_MAX_TESTERS], buf, sizeof(buf));
+    TEST_INT_EQUAL(buf[0], 0x50);
+}
+
+void test_next_deadline_covers_all_testers(void **state) {
+    Env_t *e = *state;
+    Ctx_t ctx = {0};
+    uint8_t buf[8] = {0};
+    e->server->fn = fn;
+    e->server->fn_data = &ctx;
+    TEST_INT_EQUAL(UDSServerNextDeadlineMs(e->server), UDS_NO_DEADLINE);
+
+    // when tester 1 enters the extended diagnostic session
+    const uint8_t DSC_REQ[] = {0x10, 0x03};
+    UDSTpSend(tester_tp[1], DSC_REQ, sizeof(DSC_REQ), NULL);
+    Recv(e, tester_tp[1], buf, sizeof(buf));
+    TEST_INT_EQUAL(buf[0], 0x50);
+
+    // the deadline should be its session timeout
+    uint32_t ms = UDSServerNextDeadlineMs(e->server);
+    TEST_INT_GE(ms, 1);
+    TEST_INT_LE(ms, e->server->s3_ms + 1);
+}
+
+static uint8_t did_0xF201[] = {0x11, 0x22};
+
+static UDSDIDEntry_t periodic_did_table[] = {
+    {.did = 0xF201, .len = sizeof(did_0xF201), .ptr = did_0xF201, .access = UDS_DID_READ},
+};
+
+void test_periodic_dids_are_per_tester(void **state) {
+    Env_t *e = *state;
+    Ctx_t ctx = {0};
+    uint8_t buf[8] = {0};
+    e->server->fn = fn;
+    e->server->fn_data = &ctx;
+    UDSServerRegisterDIDs(e->server, periodic_did_table,
+                          sizeof(periodic_did_table) / sizeof(periodic_did_table[0]));
+
+    // when both testers schedule periodicDataIdentifier 0x01
+    const uint8_t REQ[] = {0x2A, UDS_LEV_TM_SAFR, 0x01};
+    for (int i = 0; i < 2; i++) {
+        UDSTpSend(tester_tp[i], REQ, sizeof(REQ), NULL);
+        Recv(e, tester_tp[i], buf, sizeof(buf));
+        TEST_INT_EQUAL(buf[0], 0x6A);
+    }
+    TEST_INT_EQUAL(e->server->periodicCount, 2);
+
+    // each tester should receive the periodic data
+    const uint8_t PERIODIC[] = {0x6A, 0x01, 0x11, 0x22};
+    for (int i = 0; i < 2; i++) {
+        EXPECT_WITHIN_MS(e, UDSTpRecv(tester_tp[i], buf, sizeof(buf), NULL) == sizeof(PERIODIC),
+                         2 * UDS_SERVER_0x2A_FAST_RATE_MS);
+        TEST_MEMORY_EQUAL(buf, PERIODIC, sizeof(PERIODIC));
+    }
+
+    // when tester 0 stops periodicDataIdentifier 0x01
+    const uint8_t STOP_REQ[] = {0x2A, UDS_LEV_TM_SS, 0x01};
+    UDSTpSend(tester_tp[0], STOP_REQ, sizeof(STOP_REQ), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(tester_tp[0], buf, sizeof(buf), NULL) == 1,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_INT_EQUAL(buf[0], 0x6A);
+    TEST_INT_EQUAL(e->server->periodicCount, 1);
+
+    // tester 0 should receive nothing more while tester 1 still receives the data
+    EnvRunMillis(e, 2 * UDS_SERVER_0x2A_FAST_RATE_MS);
+    while (UDSTpRecv(tester_tp[0], buf, sizeof(buf), NULL) > 0) {
+    }
+    while (UDSTpRecv(tester_tp[1], buf, sizeof(buf), NULL) > 0) {
+    }
+    EnvRunMillis(e, 2 * UDS_SERVER_0x2A_FAST_RATE_MS);
+    TEST_INT_EQUAL(UDSTpRecv(tester_tp[0], buf, sizeof(buf), NULL), 0);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(tester_tp[1], buf, sizeof(buf), NULL) == sizeof(PERIODIC),
+                     2 * UDS_SERVER_0x2A_FAST_RATE_MS);
+    TEST_MEMORY_EQUAL(buf, PERIODIC, sizeof(PERIODIC));
+}
+
+static uint8_t did_0x0123[] = {0x00};
+
+static UDSDIDEntry_t roe_did_table[] = {
+    {.did = 0x0123, .len = sizeof(did_0x0123), .ptr = did_0x0123, .access = UDS_DID_READ},
+};
+
+void test_response_on_event_is_per_tester(void **state) {
+    Env_t *e = *state;
+    Ctx_t ctx = {0};
+    uint8_t buf[16] = {0};
+    e->server->fn = fn;
+    e->server->fn_data = &ctx;
+    did_0x0123[0] = 0;
+    UDSServerRegisterDIDs(e->server, roe_did_table,
+                          sizeof(roe_did_table) / sizeof(roe_did_table[0]));
+
+    // when tester 0 sets up and starts onChangeOfDataIdentifier 0x0123
+    const uint8_t SETUP[] = {0x86, UDS_LEV_RE_OCODID, 0x02, 0x01, 0x23, 0x22, 0x01, 0x23};
+    UDSTpSend(tester_tp[0], SETUP, sizeof(SETUP), NULL);
+    Recv(e, tester_tp[0], buf, sizeof(buf));
+    TEST_INT_EQUAL(buf[0], 0xC6);
+    const uint8_t START[] = {0x86, UDS_LEV_RE_STRTROE, 0x02};
+    UDSTpSend(tester_tp[0], START, sizeof(START), NULL);
+    Recv(e, tester_tp[0], buf, sizeof(buf));
+    TEST_INT_EQUAL(buf[0], 0xC6);
+
+    // tester 1 has no event logic to start
+    UDSTpSend(tester_tp[1], START, sizeof(START), NULL);
+    Recv(e, tester_tp[1], buf, sizeof(buf));
+    const uint8_t NOT_CORRECT[] = {0x7F, 0x86, 0x22};
+    TEST_MEMORY_EQUAL(buf, NOT_CORRECT, sizeof(NOT_CORRECT));
+
+    // and stopping its events leaves tester 0's running
+    const uint8_t STOP[] = {0x86, UDS_LEV_RE_STPROE, 0x02};
+    UDSTpSend(tester_tp[1], STOP, sizeof(STOP), NULL);
+    Recv(e, tester_tp[1], buf, sizeof(buf));
+    TEST_INT_EQUAL(buf[0], 0xC6);
+
+    // When the DID changes, only tester 0 should receive the response
+    did_0x0123[0] = 0x42;
+    const uint8_t EVENT_RESP[] = {0x62, 0x01, 0x23, 0x42};
+    Recv(e, tester_tp[0], buf, sizeof(buf));
+    TEST_MEMORY_EQUAL(buf, EVENT_RESP, sizeof(EVENT_RESP));
+    TEST_INT_EQUAL(UDSTpRecv(tester_tp[1], buf, sizeof(buf), NULL), 0);
+}
+
+void test_timing_parameters_are_per_tester(void **state) {
+    Env_t *e = *state;
+    Ctx_t ctx = {0};
+    uint8_t buf[8] = {0};
+    e->server->fn = fn;
+    e->server->fn_data = &ctx;
+
+    // when tester 0 sets P2 to 20 ms and P2* to 500 ms
+    const uint8_t SET[] = {0x83, UDS_LEV_ATP_STPTGV, 0x00, 0x14, 0x00, 0x32};
+    UDSTpSend(tester_tp[0], SET, sizeof(SET), NULL);
+    Recv(e, tester_tp[0], buf, sizeof(buf));
+    TEST_INT_EQUAL(buf[0], 0xC3);
+
+    // tester 1 should still use the configured timing
+    const uint8_t READ[] = {0x83, UDS_LEV_ATP_RCATP};
+    const uint8_t DEFAULT_RESP[] = {0xC3,
+                                    UDS_LEV_ATP_RCATP,
+                                    UDS_SERVER_DEFAULT_P2_MS >> 8,
+                                    UDS_SERVER_DEFAULT_P2_MS & 0xFF,
+                                    (UDS_SERVER_DEFAULT_P2_STAR_MS / 10) >> 8,
+                                    (UDS_SERVER_DEFAULT_P2_STAR_MS / 10) & 0xFF};
+    UDSTpSend(tester_tp[1], READ, sizeof(READ), NULL);
+    Recv(e, tester_tp[1], buf, sizeof(buf));
+    TEST_MEMORY_EQUAL(buf, DEFAULT_RESP, sizeof(DEFAULT_RESP));
+
+    // while tester 0 keeps its own
+    const uint8_t SET_RESP[] = {0xC3, UDS_LEV_ATP_RCATP, 0x00, 0x14, 0x00, 0x32};
+    UDSTpSend(tester_tp[0], READ, sizeof(READ), NULL);
+    Recv(e, tester_tp[0], buf, sizeof(buf));
+    TEST_MEMORY_EQUAL(buf, SET_RESP, sizeof(SET_RESP));
+    TEST_INT_EQUAL(e->server->p2_ms, UDS_SERVER_DEFAULT_P2_MS);
+    TEST_INT_EQUAL(e->server->p2_star_ms, UDS_SERVER_DEFAULT_P2_STAR_MS);
+}
+
+void test_download_crc_is_per_tester(void **state) {
+    Env_t *e = *state;
+    Ctx_t ctx = {0};
+    uint8_t buf[8] = {0};
+    e->server->fn = fn;
+    e->server->fn_data = &ctx;
+
+    // when tester 0 downloads an image in the programming session
+    const uint8_t PRGS[] = {0x10, UDS_LEV_DS_PRGS};
+    UDSTpSend(tester_tp[0], PRGS, sizeof(PRGS), NULL);
+    Recv(e, tester_tp[0], buf, sizeof(buf));
+    TEST_INT_EQUAL(buf[0], 0x50);
+    const uint8_t IMAGE[] = {0x10, 0x20, 0x30, 0x40};
+    const uint8_t DOWNLOAD[] = {0x34, 0x00, 0x11, 0x10, sizeof(IMAGE)};
+    const uint8_t BLOCK[] = {0x36, 0x01, 0x10, 0x20, 0x30, 0x40};
+    const uint8_t EXIT[] = {0x37};
+    UDSTpSend(tester_tp[0], DOWNLOAD, sizeof(DOWNLOAD), NULL);
+    Recv(e, tester_tp[0], buf, sizeof(buf));
+    TEST_INT_EQUAL(buf[0], 0x74);
+    UDSTpSend(tester_tp[0], BLOCK, sizeof(BLOCK), NULL);
+    Recv(e, tester_tp[0], buf, sizeof(buf));
+    TEST_INT_EQUAL(buf[0], 0x76);
+    UDSTpSend(tester_tp[0], EXIT, sizeof(EXIT), NULL);
+    Recv(e, tester_tp[0], buf, sizeof(buf));
+    TEST_INT_EQUAL(buf[0], 0x77);
+
+    // a check routine of tester 1 should not see its CRC
+    const uint8_t CHECK[] = {0x31, 0x01, 0xFF, 0x01};
+    UDSTpSend(tester_tp[1], CHECK, sizeof(CHECK), NULL);
+    Recv(e, tester_tp[1], buf, sizeof(buf));
+    TEST_INT_EQUAL(buf[0], 0x71);
+    TEST_INT_EQUAL(ctx.routine_crc, 0);
+    TEST_INT_EQUAL(ctx.routine_bytes, 0);
+
+    // while the one of tester 0 does
+    UDSTpSend(tester_tp[0], CHECK, sizeof(CHECK), NULL);
+    Recv(e, tester_tp[0], buf, sizeof(buf));
+    TEST_INT_EQUAL(buf[0], 0x71);
+    TEST_INT_EQUAL(ctx.routine_crc, UDSCRC32(0, IMAGE, sizeof(IMAGE)));
+    TEST_INT_EQUAL(ctx.routine_bytes, sizeof(IMAGE));
+}
+
+int main(int ac, char **av) {
+    if (ac > 1) {
+        cmocka_set_test_filter(av[1]);
+    }
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_sessions_are_per_tester, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_pending_request_does_not_block_other_tester, Setup,
+                                        Teardown),
+        cmocka_unit_test_setup_teardown(test_busy_when_all_testers_in_use, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_next_deadline_covers_all_testers, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_periodic_dids_are_per_tester, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_response_on_event_is_per_tester, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_timing_parameters_are_per_tester, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_download_crc_is_per_tester, Setup, Teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
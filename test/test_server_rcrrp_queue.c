@@ -0,0 +1,180 @@
+#include "test/env.h"
+#include <stdint.h>
+
+#if UDS_SERVER_RCRRP_QUEUE_LEN != 2
+#error "this test requires UDS_SERVER_RCRRP_QUEUE_LEN == 2"
+#endif
+
+typedef struct {
+    bool pending;   /* 0x31 responds with 0x78 */
+    int rdbi_calls; /* UDS_EVT_ReadDataByIdent seen while pending */
+} Ctx_t;
+
+int Setup(void **state) {
+    Env_t *env = malloc(sizeof(Env_t));
+    memset(env, 0, sizeof(Env_t));
+    env->server = malloc(sizeof(UDSServer_t));
+    UDSServerInit(env->server);
+    env->server->tp = ISOTPMockNew("server", &(ISOTPMockArgs_t){.sa_phys = 0x7E0,
+                                                                .ta_phys = 0x7E8,
+                                                                .sa_func = 0x7DF,
+                                                                .ta_func = UDS_TP_NOOP_ADDR});
+    env->client_tp = ISOTPMockNew("client", &(ISOTPMockArgs_t){.sa_phys = 0x7E8,
+                                                               .ta_phys = 0x7E0,
+                                                               .sa_func = UDS_TP_NOOP_ADDR,
+                                                               .ta_func = 0x7DF});
+    *state = env;
+    return 0;
+}
+
+int Teardown(void **state) {
+    Env_t *env = *state;
+    ISOTPMockFree(env->server->tp);
+    ISOTPMockFree(env->client_tp);
+    ISOTPMockReset();
+    free(env->server);
+    free(env);
+    return 0;
+}
+
+static UDSErr_t fn(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    Ctx_t *ctx = srv->fn_data;
+    switch (ev) {
+    case UDS_EVT_RoutineCtrl:
+        return ctx->pending ? UDS_NRC_RequestCorrectlyReceived_ResponsePending
+                            : UDS_PositiveResponse;
+    case UDS_EVT_ReadDataByIdent: {
+        UDSRDBIArgs_t *args = arg;
+        if (ctx->pending) {
+            ctx->rdbi_calls++;
+        }
+        uint8_t value = (uint8_t)args->dataId;
+        return args->copy(srv, &value, sizeof(value));
+    }
+    default:
+        return UDS_NRC_GeneralReject;
+    }
+}
+
+/* receive the next response that is not 0x78 */
+static ssize_t RecvFinal(Env_t *e, uint8_t *buf, size_t size) {
+    ssize_t len = 0;
+    do {
+        EXPECT_WITHIN_MS(e, (len = UDSTpRecv(e->client_tp, buf, size, NULL)) > 0,
+                         e->server->p2_star_ms);
+    } while (3 == len && 0x7F == buf[0] && 0x78 == buf[2]);
+    return len;
+}
+
+static void StartPending(Env_t *e, Ctx_t *ctx) {
+    e->server->fn = fn;
+    e->server->fn_data = ctx;
+    ctx->pending = true;
+    const uint8_t REQ[] = {0x31, 0x01, 0x12, 0x34};
+    const uint8_t RCRRP[] = {0x7F, 0x31, 0x78};
+    uint8_t buf[8] = {0};
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, RCRRP, sizeof(RCRRP));
+    // the second 0x78 is where the server used to stop receiving
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     e->server->p2_star_ms);
+    TEST_MEMORY_EQUAL(buf, RCRRP, sizeof(RCRRP));
+}
+
+void test_tester_present_is_answered_while_pending(void **state) {
+    Env_t *e = *state;
+    Ctx_t ctx = {0};
+    e->server->sessionType = UDS_LEV_DS_EXTDS;
+    StartPending(e, &ctx);
+
+    // answered within a few ms instead of after the pending request
+    const uint8_t REQ[] = {0x3E, 0x00};
+    const uint8_t RESP[] = {0x7E, 0x00};
+    uint8_t buf[8] = {0};
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0, 5);
+    TEST_MEMORY_EQUAL(buf, RESP, sizeof(RESP));
+
+    // a functional TesterPresent without response keeps the session alive
+    uint32_t before = e->server->s3_session_timeout_timer;
+    const uint8_t SUPPRESSED[] = {0x3E, 0x80};
+    UDSTpSend(e->client_tp, SUPPRESSED, sizeof(SUPPRESSED),
+              &(UDSSDU_t){.A_TA_Type = UDS_A_TA_TYPE_FUNCTIONAL});
+    EnvRunMillis(e, 5);
+    TEST_INT_NE(e->server->s3_session_timeout_timer, before);
+    TEST_INT_EQUAL(e->server->sessionType, UDS_LEV_DS_EXTDS);
+    TEST_INT_EQUAL(e->server->RCRRP, true);
+}
+
+void test_queued_requests_run_after_the_pending_one(void **state) {
+    Env_t *e = *state;
+    Ctx_t ctx = {0};
+    StartPending(e, &ctx);
+
+    // two requests fit in the queue, the third is refused
+    const uint8_t REQ1[] = {0x22, 0xF1, 0x01};
+    const uint8_t REQ2[] = {0x22, 0xF1, 0x02};
+    const uint8_t REQ3[] = {0x22, 0xF1, 0x03};
+    const uint8_t BUSY[] = {0x7F, 0x22, 0x21};
+    uint8_t buf[8] = {0};
+    UDSTpSend(e->client_tp, REQ1, sizeof(REQ1), NULL);
+    EnvRunMillis(e, 5);
+    UDSTpSend(e->client_tp, REQ2, sizeof(REQ2), NULL);
+    EnvRunMillis(e, 5);
+    UDSTpSend(e->client_tp, REQ3, sizeof(REQ3), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0, 5);
+    TEST_MEMORY_EQUAL(buf, BUSY, sizeof(BUSY));
+    TEST_INT_EQUAL(e->server->queueCount, 2);
+
+    // the pending request completes first, then the queued ones in order
+    ctx.pending = false;
+    const uint8_t RESP0[] = {0x71, 0x01, 0x12, 0x34};
+    const uint8_t RESP1[] = {0x62, 0xF1, 0x01, 0x01};
+    const uint8_t RESP2[] = {0x62, 0xF1, 0x02, 0x02};
+    TEST_INT_EQUAL(RecvFinal(e, buf, sizeof(buf)), sizeof(RESP0));
+    TEST_MEMORY_EQUAL(buf, RESP0, sizeof(RESP0));
+    TEST_INT_EQUAL(RecvFinal(e, buf, sizeof(buf)), sizeof(RESP1));
+    TEST_MEMORY_EQUAL(buf, RESP1, sizeof(RESP1));
+    TEST_INT_EQUAL(RecvFinal(e, buf, sizeof(buf)), sizeof(RESP2));
+    TEST_MEMORY_EQUAL(buf, RESP2, sizeof(RESP2));
+    TEST_INT_EQUAL(ctx.rdbi_calls, 0);
+    TEST_INT_EQUAL(e->server->queueCount, 0);
+}
+
+void test_functional_request_is_dropped_when_full(void **state) {
+    Env_t *e = *state;
+    Ctx_t ctx = {0};
+    StartPending(e, &ctx);
+
+    const uint8_t REQ[] = {0x22, 0xF1, 0x01};
+    uint8_t buf[8] = {0};
+    for (int i = 0; i < UDS_SERVER_RCRRP_QUEUE_LEN; i++) {
+        UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+        EnvRunMillis(e, 5);
+    }
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), &(UDSSDU_t){.A_TA_Type = UDS_A_TA_TYPE_FUNCTIONAL});
+    EnvRunMillis(e, 5);
+
+    // no 0x21 for the functional request, only the next 0x78
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     e->server->p2_star_ms);
+    TEST_INT_EQUAL(buf[2], UDS_NRC_RequestCorrectlyReceived_ResponsePending);
+    TEST_INT_EQUAL(e->server->queueCount, UDS_SERVER_RCRRP_QUEUE_LEN);
+}
+
+int main(int ac, char **av) {
+    if (ac > 1) {
+        cmocka_set_test_filter(av[1]);
+    }
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_tester_present_is_answered_while_pending, Setup,
+                                        Teardown),
+        cmocka_unit_test_setup_teardown(test_queued_requests_run_after_the_pending_one, Setup,
+                                        Teardown),
+        cmocka_unit_test_setup_teardown(test_functional_request_is_dropped_when_full, Setup,
+                                        Teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
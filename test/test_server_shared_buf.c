@@ -0,0 +1,172 @@
+#include "test/env.h"
+#include <stdint.h>
+
+#if !UDS_SERVER_SHARED_BUF || UDS_SERVER_SEND_BUF_SIZE != 64
+#error "this test requires UDS_SERVER_SHARED_BUF and UDS_SERVER_SEND_BUF_SIZE == 64"
+#endif
+
+typedef struct {
+    bool pending;        /* 0x2E responds with 0x78 */
+    const uint8_t *data; /* dataRecord seen by the last 0x2E handler call */
+} Ctx_t;
+
+int Setup(void **state) {
+    Env_t *env = malloc(sizeof(Env_t));
+    memset(env, 0, sizeof(Env_t));
+    env->server = malloc(sizeof(UDSServer_t));
+    UDSServerInit(env->server);
+    env->server->tp = ISOTPMockNew("server", &(ISOTPMockArgs_t){.sa_phys = 0x7E0,
+                                                                .ta_phys = 0x7E8,
+                                                                .sa_func = 0x7DF,
+                                                                .ta_func = UDS_TP_NOOP_ADDR});
+    env->client_tp = ISOTPMockNew("client", &(ISOTPMockArgs_t){.sa_phys = 0x7E8,
+                                                               .ta_phys = 0x7E0,
+                                                               .sa_func = UDS_TP_NOOP_ADDR,
+                                                               .ta_func = 0x7DF});
+    *state = env;
+    return 0;
+}
+
+int Teardown(void **state) {
+    Env_t *env = *state;
+    ISOTPMockFree(env->server->tp);
+    ISOTPMockFree(env->client_tp);
+    ISOTPMockReset();
+    free(env->server);
+    free(env);
+    return 0;
+}
+
+static UDSErr_t fn(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    Ctx_t *ctx = srv->fn_data;
+    switch (ev) {
+    case UDS_EVT_ReadDataByIdent: {
+        UDSRDBIArgs_t *args = arg;
+        uint8_t record[60];
+        memset(record, 0xA5, sizeof(record));
+        return args->copy(srv, record, sizeof(record));
+    }
+    case UDS_EVT_WriteDataByIdent: {
+        UDSWDBIArgs_t *args = arg;
+        ctx->data = args->data;
+        if (ctx->pending) {
+            return UDS_NRC_RequestCorrectlyReceived_ResponsePending;
+        }
+        return UDS_PositiveResponse;
+    }
+    default:
+        return UDS_NRC_GeneralReject;
+    }
+}
+
+/* a transport without peek receives into send_buf, so the server owns one buffer */
+static void NoPeek(Env_t *e) {
+    e->server->tp->peek = NULL;
+    e->server->tp->ack = NULL;
+}
+
+void test_request_is_kept_behind_the_response(void **state) {
+    Env_t *e = *state;
+    Ctx_t ctx = {0};
+    e->server->fn = fn;
+    e->server->fn_data = &ctx;
+    NoPeek(e);
+    UDS_SERVER_MEMORY_REPORT(printf, ISOTPMock_t);
+
+    const uint8_t REQ[] = {0x2E, 0x12, 0x34, 0xAA, 0xBB};
+    const uint8_t RESP[] = {0x6E, 0x12, 0x34};
+    uint8_t buf[8] = {0};
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == sizeof(RESP),
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, RESP, sizeof(RESP));
+    TEST_PTR_EQUAL(ctx.data, e->server->r.send_buf + sizeof(e->server->r.send_buf) - 2);
+
+    // and the whole buffer is available again once the response is sent
+    TEST_INT_EQUAL(e->server->r.send_buf_size, sizeof(e->server->r.send_buf));
+}
+
+void test_request_survives_response_pending(void **state) {
+    Env_t *e = *state;
+    Ctx_t ctx = {.pending = true};
+    e->server->fn = fn;
+    e->server->fn_data = &ctx;
+    NoPeek(e);
+
+    const uint8_t REQ[] = {0x2E, 0x12, 0x34, 0xAA, 0xBB};
+    const uint8_t RCRRP[] = {0x7F, 0x2E, 0x78};
+    const uint8_t RESP[] = {0x6E, 0x12, 0x34};
+    uint8_t buf[8] = {0};
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == sizeof(RCRRP),
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, RCRRP, sizeof(RCRRP));
+
+    // the 0x78 response is built in front of the request, which the handler sees unchanged
+    ctx.pending = false;
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == sizeof(RESP),
+                     UDS_SERVER_DEFAULT_P2_STAR_MS);
+    TEST_MEMORY_EQUAL(buf, RESP, sizeof(RESP));
+    TEST_INT_EQUAL(ctx.data[0], 0xAA);
+    TEST_INT_EQUAL(ctx.data[1], 0xBB);
+}
+
+void test_response_is_limited_to_the_space_in_front(void **state) {
+    Env_t *e = *state;
+    Ctx_t ctx = {0};
+    e->server->fn = fn;
+    e->server->fn_data = &ctx;
+
+    // 3 + 60 bytes fit in send_buf while the transport lends the request
+    const uint8_t REQ[] = {0x22, 0x12, 0x34};
+    uint8_t buf[UDS_TP_MTU] = {0};
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == 63,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+
+    // but not in front of the 3 byte request kept in send_buf
+    NoPeek(e);
+    const uint8_t RESP[] = {0x7F, 0x22, 0x14};
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == sizeof(RESP),
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, RESP, sizeof(RESP));
+}
+
+void test_request_without_room_for_a_response_is_dropped(void **state) {
+    Env_t *e = *state;
+    Ctx_t ctx = {0};
+    e->server->fn = fn;
+    e->server->fn_data = &ctx;
+    NoPeek(e);
+
+    uint8_t req[UDS_SERVER_SEND_BUF_SIZE - UDS_SERVER_SHARED_BUF_MIN_RESP_LEN + 1] = {0x2E, 0x12,
+                                                                                      0x34};
+    uint8_t buf[8] = {0};
+    UDSTpSend(e->client_tp, req, sizeof(req), NULL);
+    EXPECT_WHILE_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == 0,
+                    UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_PTR_EQUAL(ctx.data, NULL);
+
+    // one byte shorter is accepted
+    const uint8_t RESP[] = {0x6E, 0x12, 0x34};
+    UDSTpSend(e->client_tp, req, sizeof(req) - 1, NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == sizeof(RESP),
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, RESP, sizeof(RESP));
+}
+
+int main(int ac, char **av) {
+    if (ac > 1) {
+        cmocka_set_test_filter(av[1]);
+    }
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_request_is_kept_behind_the_response, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_request_survives_response_pending, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_response_is_limited_to_the_space_in_front, Setup,
+                                        Teardown),
+        cmocka_unit_test_setup_teardown(test_request_without_room_for_a_response_is_dropped, Setup,
+                                        Teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,165 @@
+#include "test/env.h"
+#include <stdint.h>
+
+#if UDS_SERVER_0x36_PIPELINE_DEPTH != 2
+#error "this test requires UDS_SERVER_0x36_PIPELINE_DEPTH == 2"
+#endif
+
+#define DOWNLOAD_ADDR 0x10
+#define DOWNLOAD_SIZE 16
+
+typedef struct {
+    UDSErr_t write_resp;          /* value returned by the sink */
+    uint8_t flash[DOWNLOAD_SIZE]; /* data written through the sink */
+    int writes;                   /* number of blocks accepted by the sink */
+} Ctx_t;
+
+int Setup(void **state) {
+    Env_t *env = malloc(sizeof(Env_t));
+    memset(env, 0, sizeof(Env_t));
+    env->server = malloc(sizeof(UDSServer_t));
+    UDSServerInit(env->server);
+    env->server->tp = ISOTPMockNew("server", &(ISOTPMockArgs_t){.sa_phys = 0x7E0,
+                                                                .ta_phys = 0x7E8,
+                                                                .sa_func = 0x7DF,
+                                                                .ta_func = UDS_TP_NOOP_ADDR});
+    env->client_tp = ISOTPMockNew("client", &(ISOTPMockArgs_t){.sa_phys = 0x7E8,
+                                                               .ta_phys = 0x7E0,
+                                                               .sa_func = UDS_TP_NOOP_ADDR,
+                                                               .ta_func = 0x7DF});
+    *state = env;
+    return 0;
+}
+
+int Teardown(void **state) {
+    Env_t *env = *state;
+    ISOTPMockFree(env->server->tp);
+    ISOTPMockFree(env->client_tp);
+    ISOTPMockReset();
+    free(env->server);
+    free(env);
+    return 0;
+}
+
+static UDSErr_t fn(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    switch (ev) {
+    case UDS_EVT_RequestDownload:
+    case UDS_EVT_RequestTransferExit:
+        return UDS_PositiveResponse;
+    default:
+        // UDS_EVT_TransferData must not be emitted while the pipeline is in use
+        fail();
+        return UDS_NRC_GeneralReject;
+    }
+}
+
+static UDSErr_t sink(UDSServer_t *srv, void *addr, const uint8_t *data, uint16_t len) {
+    Ctx_t *ctx = srv->fn_data;
+    if (UDS_PositiveResponse == ctx->write_resp) {
+        size_t offset = (size_t)((uintptr_t)addr - DOWNLOAD_ADDR);
+        TEST_INT_LE(offset + len, DOWNLOAD_SIZE);
+        memcpy(&ctx->flash[offset], data, len);
+        ctx->writes++;
+    }
+    return ctx->write_resp;
+}
+
+static void Exchange(Env_t *e, const uint8_t *req, size_t req_len, const uint8_t *resp,
+                     size_t resp_len) {
+    uint8_t buf[32] = {0};
+    UDSTpSend(e->client_tp, req, req_len, NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) == (ssize_t)resp_len,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, resp, resp_len);
+}
+
+static void StartDownload(Env_t *e, Ctx_t *ctx) {
+    e->server->fn = fn;
+    e->server->fn_data = ctx;
+    e->server->xferWrite = sink;
+    const uint8_t REQ[] = {0x34, 0x00, 0x11, DOWNLOAD_ADDR, DOWNLOAD_SIZE};
+    UDSTpSend(e->client_tp, REQ, sizeof(REQ), NULL);
+    uint8_t buf[16] = {0};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_INT_EQUAL(buf[0], 0x74);
+}
+
+void test_blocks_are_acknowledged_before_they_are_written(void **state) {
+    Env_t *e = *state;
+    Ctx_t ctx = {.write_resp = UDS_NRC_RequestCorrectlyReceived_ResponsePending};
+    StartDownload(e, &ctx);
+
+    // while the sink is busy, one block per buffer is acknowledged immediately
+    const uint8_t BLOCK1[] = {0x36, 0x01, 0x00, 0x01, 0x02, 0x03};
+    const uint8_t RESP1[] = {0x76, 0x01};
+    Exchange(e, BLOCK1, sizeof(BLOCK1), RESP1, sizeof(RESP1));
+    const uint8_t BLOCK2[] = {0x36, 0x02, 0x04, 0x05, 0x06, 0x07};
+    const uint8_t RESP2[] = {0x76, 0x02};
+    Exchange(e, BLOCK2, sizeof(BLOCK2), RESP2, sizeof(RESP2));
+    TEST_INT_EQUAL(UDSServerNextDeadlineMs(e->server), 0);
+
+    // once all buffers are full the tester is held off
+    const uint8_t BLOCK3[] = {0x36, 0x03, 0x08, 0x09, 0x0A, 0x0B};
+    const uint8_t RCRRP[] = {0x7F, 0x36, 0x78};
+    Exchange(e, BLOCK3, sizeof(BLOCK3), RCRRP, sizeof(RCRRP));
+
+    // until the sink completes
+    ctx.write_resp = UDS_PositiveResponse;
+    uint8_t buf[8] = {0};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    const uint8_t RESP3[] = {0x76, 0x03};
+    TEST_MEMORY_EQUAL(buf, RESP3, sizeof(RESP3));
+
+    const uint8_t BLOCK4[] = {0x36, 0x04, 0x0C, 0x0D, 0x0E, 0x0F};
+    const uint8_t RESP4[] = {0x76, 0x04};
+    Exchange(e, BLOCK4, sizeof(BLOCK4), RESP4, sizeof(RESP4));
+
+    // the exit response is sent after every block has been written
+    const uint8_t EXIT[] = {0x37};
+    const uint8_t EXIT_RESP[] = {0x77};
+    UDSTpSend(e->client_tp, EXIT, sizeof(EXIT), NULL);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->client_tp, buf, sizeof(buf), NULL) > 0 && buf[0] == 0x77,
+                     UDS_CLIENT_DEFAULT_P2_MS);
+    TEST_MEMORY_EQUAL(buf, EXIT_RESP, sizeof(EXIT_RESP));
+    TEST_INT_EQUAL(ctx.writes, 4);
+    for (int i = 0; i < DOWNLOAD_SIZE; i++) {
+        TEST_INT_EQUAL(ctx.flash[i], i);
+    }
+    TEST_INT_EQUAL(UDSServerNextDeadlineMs(e->server), UDS_NO_DEADLINE);
+}
+
+void test_sink_error_fails_the_download(void **state) {
+    Env_t *e = *state;
+    Ctx_t ctx = {.write_resp = UDS_NRC_GeneralProgrammingFailure};
+    StartDownload(e, &ctx);
+
+    // the block is acknowledged before the sink has seen it
+    const uint8_t BLOCK1[] = {0x36, 0x01, 0x00, 0x01, 0x02, 0x03};
+    const uint8_t RESP1[] = {0x76, 0x01};
+    Exchange(e, BLOCK1, sizeof(BLOCK1), RESP1, sizeof(RESP1));
+
+    // the sink's error is reported to the next request
+    const uint8_t BLOCK2[] = {0x36, 0x02, 0x04, 0x05, 0x06, 0x07};
+    const uint8_t FAILED[] = {0x7F, 0x36, 0x72};
+    Exchange(e, BLOCK2, sizeof(BLOCK2), FAILED, sizeof(FAILED));
+
+    // and the download is over
+    const uint8_t BLOCK3[] = {0x36, 0x03, 0x08, 0x09, 0x0A, 0x0B};
+    const uint8_t NOT_ACCEPTED[] = {0x7F, 0x36, 0x70};
+    Exchange(e, BLOCK3, sizeof(BLOCK3), NOT_ACCEPTED, sizeof(NOT_ACCEPTED));
+    TEST_INT_EQUAL(ctx.writes, 0);
+}
+
+int main(int ac, char **av) {
+    if (ac > 1) {
+        cmocka_set_test_filter(av[1]);
+    }
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_blocks_are_acknowledged_before_they_are_written,
+                                        Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_sink_error_fails_the_download, Setup, Teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
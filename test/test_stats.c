@@ -0,0 +1,174 @@
+#include "test/env.h"
+
+#if !UDS_SERVER_STATS || !UDS_CLIENT_STATS
+#error "this test requires UDS_SERVER_STATS and UDS_CLIENT_STATS"
+#endif
+
+// the routine is still running when p2 expires, so the server sends one 0x78
+#define ROUTINE_POLLS 60
+
+typedef struct {
+    int routineCalls; /* UDS_EVT_RoutineCtrl events, the first ROUTINE_POLLS return 0x78 */
+} Ctx_t;
+
+static int ClientFn(UDSClient_t *client, UDSEvent_t evt, void *ev_data) { return UDS_OK; }
+
+int Setup(void **state) {
+    Env_t *env = malloc(sizeof(Env_t));
+    memset(env, 0, sizeof(Env_t));
+    env->server = malloc(sizeof(UDSServer_t));
+    UDSServerInit(env->server);
+    env->server->tp = ISOTPMockNew("server", &(ISOTPMockArgs_t){.sa_phys = 0x7E0,
+                                                                .ta_phys = 0x7E8,
+                                                                .sa_func = 0x7DF,
+                                                                .ta_func = UDS_TP_NOOP_ADDR});
+    env->client = malloc(sizeof(UDSClient_t));
+    UDSClientInit(env->client);
+    env->client->fn = ClientFn;
+    env->client->tp = ISOTPMockNew("client", &(ISOTPMockArgs_t){.sa_phys = 0x7E8,
+                                                                .ta_phys = 0x7E0,
+                                                                .sa_func = UDS_TP_NOOP_ADDR,
+                                                                .ta_func = 0x7DF});
+    *state = env;
+    return 0;
+}
+
+int Teardown(void **state) {
+    Env_t *env = *state;
+    ISOTPMockFree(env->server->tp);
+    ISOTPMockFree(env->client->tp);
+    ISOTPMockReset();
+    free(env->server);
+    free(env->client);
+    free(env);
+    return 0;
+}
+
+static UDSErr_t fn(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    Ctx_t *ctx = srv->fn_data;
+    switch (ev) {
+    case UDS_EVT_ReadDataByIdent: {
+        UDSRDBIArgs_t *r = arg;
+        if (0xF190 != r->dataId) {
+            return UDS_NRC_RequestOutOfRange;
+        }
+        const uint8_t vin[] = {0x12, 0x34};
+        return r->copy(srv, vin, sizeof(vin));
+    }
+    case UDS_EVT_RoutineCtrl:
+        if (ctx->routineCalls++ < ROUTINE_POLLS) {
+            return UDS_NRC_RequestCorrectlyReceived_ResponsePending;
+        }
+        return UDS_PositiveResponse;
+    default:
+        return UDS_PositiveResponse;
+    }
+}
+
+static uint32_t Total(const UDSHistogram_t *h) {
+    uint32_t total = 0;
+    for (int i = 0; i < UDS_STATS_HIST_BUCKETS; i++) {
+        total += h->count[i];
+    }
+    return total;
+}
+
+static void Request(Env_t *env, const uint8_t *req, uint16_t len) {
+    EXPECT_OK(UDSSendBytes(env->client, req, len));
+    EXPECT_WITHIN_MS(env, 0 == env->client->state, 200);
+}
+
+void test_counters(void **state) {
+    Env_t *env = *state;
+    Ctx_t ctx = {0};
+    env->server->fn = fn;
+    env->server->fn_data = &ctx;
+
+    const uint8_t rdbi[] = {0x22, 0xF1, 0x90};
+    const uint8_t rdbi_unknown[] = {0x22, 0x12, 0x34};
+    const uint8_t routine[] = {0x31, 0x01, 0x02, 0x03};
+    const uint8_t tester_present[] = {0x3E, 0x80};
+    Request(env, rdbi, sizeof(rdbi));
+    Request(env, rdbi_unknown, sizeof(rdbi_unknown));
+    Request(env, routine, sizeof(routine));
+    env->client->options |= UDS_SUPPRESS_POS_RESP;
+    Request(env, tester_present, sizeof(tester_present));
+    EnvRunMillis(env, 100);
+
+    // every request, NRC and 0x78 should be counted once on both sides
+    const UDSServerStats_t *srv = &env->server->stats;
+    TEST_INT_EQUAL(srv->requests[UDSStatsSIDIndex(0x22)], 2);
+    TEST_INT_EQUAL(srv->requests[UDSStatsSIDIndex(0x31)], 1);
+    TEST_INT_EQUAL(srv->requests[UDSStatsSIDIndex(0x3E)], 1);
+    TEST_INT_EQUAL(srv->nrcs[UDS_NRC_RequestOutOfRange], 1);
+    TEST_INT_EQUAL(srv->nrcs[UDS_NRC_RequestCorrectlyReceived_ResponsePending], 1);
+    TEST_INT_EQUAL(srv->rcrrp, 1);
+    TEST_INT_EQUAL(srv->suppressed, 1);
+    TEST_INT_EQUAL(srv->tpErrors, 0);
+    TEST_INT_EQUAL(Total(&srv->turnaround), 4);
+    // 0x3E is answered without the callback
+    TEST_INT_EQUAL(Total(&srv->callback), 2 + ROUTINE_POLLS + 1);
+
+    const UDSClientStats_t *client = &env->client->stats;
+    TEST_INT_EQUAL(client->requests[UDSStatsSIDIndex(0x22)], 2);
+    TEST_INT_EQUAL(client->requests[UDSStatsSIDIndex(0x31)], 1);
+    TEST_INT_EQUAL(client->nrcs[UDS_NRC_RequestOutOfRange], 1);
+    TEST_INT_EQUAL(client->rcrrp, 1);
+    TEST_INT_EQUAL(client->timeouts, 0);
+    TEST_INT_EQUAL(Total(&client->turnaround), 3);
+}
+
+void test_read_through_did(void **state) {
+    Env_t *env = *state;
+    Ctx_t ctx = {0};
+    env->server->fn = fn;
+    env->server->fn_data = &ctx;
+    const uint8_t rdbi_unknown[] = {0x22, 0x12, 0x34};
+    Request(env, rdbi_unknown, sizeof(rdbi_unknown));
+
+    // the statistics should be readable with 0x22 and unpack to what the server holds
+    const uint8_t req[] = {0x22, UDS_SERVER_STATS_DID >> 8, UDS_SERVER_STATS_DID & 0xFF};
+    Request(env, req, sizeof(req));
+    TEST_INT_EQUAL(env->client->recv_buf[0], 0x62);
+    UDSServerStats_t stats;
+    EXPECT_OK(UDSUnpackServerStats(&env->client->recv_buf[3], env->client->recv_size - 3, &stats));
+    TEST_MEMORY_EQUAL(stats.requests, env->server->stats.requests, sizeof(stats.requests));
+    TEST_MEMORY_EQUAL(stats.nrcs, env->server->stats.nrcs, sizeof(stats.nrcs));
+    TEST_INT_EQUAL(stats.requests[UDSStatsSIDIndex(0x22)], 2);
+    TEST_INT_EQUAL(stats.nrcs[UDS_NRC_RequestOutOfRange], 1);
+    // the turnaround of the request reading the statistics is added once it has been answered
+    TEST_INT_EQUAL(Total(&stats.turnaround), 1);
+
+    // a truncated record should be rejected
+    TEST_ERR_EQUAL(UDSUnpackServerStats(&env->client->recv_buf[3], 20, &stats),
+                   UDS_ERR_RESP_TOO_SHORT);
+}
+
+void test_histogram(void **state) {
+    UDSHistogram_t h = {0};
+    TEST_INT_EQUAL(UDSHistogramPercentile(&h, 500), 0);
+    for (int i = 0; i < 98; i++) {
+        UDSHistogramAdd(&h, 100); // [64, 128)
+    }
+    UDSHistogramAdd(&h, 3000);       // [2048, 4096)
+    UDSHistogramAdd(&h, 0xFFFFFFFF); // last bucket
+    TEST_INT_EQUAL(h.count[0], 0);
+    TEST_INT_EQUAL(h.count[7], 98);
+    TEST_INT_EQUAL(h.count[12], 1);
+    TEST_INT_EQUAL(h.count[UDS_STATS_HIST_BUCKETS - 1], 1);
+    TEST_INT_EQUAL(UDSHistogramPercentile(&h, 500), 127);
+    TEST_INT_EQUAL(UDSHistogramPercentile(&h, 990), 4095);
+    TEST_INT_EQUAL((UDSHistogramPercentile(&h, 999) == UINT32_MAX), true);
+}
+
+int main(int ac, char **av) {
+    if (ac > 1) {
+        cmocka_set_test_filter(av[1]);
+    }
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_counters, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_read_through_did, Setup, Teardown),
+        cmocka_unit_test(test_histogram),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,193 @@
+#include "test/env.h"
+#include <stdint.h>
+
+#if UDS_TP_MTU < 0x10000 - 1
+#error "this test requires UDS_TP_MTU=65535"
+#endif
+
+#define PORT 23400
+#define ENTITY_ADDR 0x0E80
+#define TESTER_ADDR 0x0E00
+#define FUNC_ADDR 0xE400
+#define IMAGE_SIZE (150 * 1024)
+
+static UDSTpDoIP_t server_tp;
+static UDSTpDoIP_t client_tp;
+static uint8_t buf[UDS_TP_MTU];
+static uint8_t msg[UDS_TP_MTU];
+static uint8_t image[IMAGE_SIZE];
+
+int Setup(void **state) {
+    Env_t *env = malloc(sizeof(Env_t));
+    memset(env, 0, sizeof(Env_t));
+    // the sockets are real, so are the timeouts
+    env->is_real_time = true;
+    EXPECT_OK(UDSTpDoIPInitServer(&server_tp, "127.0.0.1", PORT, ENTITY_ADDR, FUNC_ADDR));
+    env->server_tp = &server_tp.hdl;
+    for (size_t i = 0; i < sizeof(msg); i++) {
+        msg[i] = (uint8_t)(i * 13);
+    }
+    *state = env;
+    return 0;
+}
+
+int Teardown(void **state) {
+    Env_t *env = *state;
+    UDSTpDoIPDeinit(&client_tp);
+    UDSTpDoIPDeinit(&server_tp);
+    free(env->server);
+    free(env->client);
+    free(env);
+    return 0;
+}
+
+static void Connect(Env_t *e, uint16_t target_addr) {
+    EXPECT_OK(UDSTpDoIPInitClient(&client_tp, "127.0.0.1", PORT, TESTER_ADDR, target_addr,
+                                  FUNC_ADDR));
+    e->client_tp = &client_tp.hdl;
+    EXPECT_WITHIN_MS(e, client_tp.state == UDS_DOIP_ROUTED, 1000);
+    TEST_INT_EQUAL(server_tp.state, UDS_DOIP_ROUTED);
+    TEST_INT_EQUAL(server_tp.ta, TESTER_ADDR);
+}
+
+void test_large_messages_are_exchanged(void **state) {
+    Env_t *e = *state;
+    Connect(e, ENTITY_ADDR);
+
+    // a request far larger than an ISO-TP message
+    UDSSDU_t info = {0};
+    TEST_INT_EQUAL(UDSTpSend(&client_tp.hdl, msg, sizeof(msg), NULL), sizeof(msg));
+    EXPECT_WITHIN_MS(e, UDSTpRecv(&server_tp.hdl, buf, sizeof(buf), &info) == sizeof(msg), 1000);
+    TEST_MEMORY_EQUAL(buf, msg, sizeof(msg));
+    TEST_INT_EQUAL(info.A_SA, TESTER_ADDR);
+    TEST_INT_EQUAL(info.A_TA, ENTITY_ADDR);
+    TEST_INT_EQUAL(info.A_TA_Type, UDS_A_TA_TYPE_PHYSICAL);
+
+    // is acknowledged by the entity
+    EXPECT_WITHIN_MS(e, !(UDSTpPoll(&client_tp.hdl) & UDS_TP_SEND_IN_PROGRESS), 1000);
+
+    // and so is the response
+    memset(buf, 0, sizeof(buf));
+    TEST_INT_EQUAL(UDSTpSend(&server_tp.hdl, &msg[1], sizeof(msg) - 1, NULL), sizeof(msg) - 1);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(&client_tp.hdl, buf, sizeof(buf), &info) == sizeof(msg) - 1,
+                     1000);
+    TEST_MEMORY_EQUAL(buf, &msg[1], sizeof(msg) - 1);
+    TEST_INT_EQUAL(info.A_SA, ENTITY_ADDR);
+    TEST_INT_EQUAL(info.A_TA, TESTER_ADDR);
+}
+
+void test_functional_request(void **state) {
+    Env_t *e = *state;
+    Connect(e, ENTITY_ADDR);
+
+    // a request sent with functional addressing
+    const uint8_t REQ[] = {0x3E, 0x80};
+    UDSSDU_t info = {.A_TA_Type = UDS_A_TA_TYPE_FUNCTIONAL};
+    TEST_INT_EQUAL(UDSTpSend(&client_tp.hdl, REQ, sizeof(REQ), &info), sizeof(REQ));
+
+    // should be received on the functional address
+    memset(&info, 0, sizeof(info));
+    EXPECT_WITHIN_MS(e, UDSTpRecv(&server_tp.hdl, buf, sizeof(buf), &info) == sizeof(REQ), 1000);
+    TEST_INT_EQUAL(info.A_TA, FUNC_ADDR);
+    TEST_INT_EQUAL(info.A_TA_Type, UDS_A_TA_TYPE_FUNCTIONAL);
+}
+
+void test_unknown_target_is_rejected(void **state) {
+    Env_t *e = *state;
+
+    // when the tester addresses an ECU the entity does not route to
+    Connect(e, ENTITY_ADDR + 1);
+    const uint8_t REQ[] = {0x3E, 0x00};
+    TEST_INT_EQUAL(UDSTpSend(&client_tp.hdl, REQ, sizeof(REQ), NULL), sizeof(REQ));
+
+    // the entity should drop it and the tester should see the negative acknowledgement
+    bool err = false;
+    for (int i = 0; i < 1000 && !err; i++) {
+        TEST_INT_EQUAL(UDSTpRecv(&server_tp.hdl, buf, sizeof(buf), NULL), 0);
+        err = UDSTpPoll(&client_tp.hdl) & UDS_TP_ERR;
+        EnvRunMillis(e, 1);
+    }
+    TEST_INT_EQUAL(err, true);
+}
+
+void test_vehicle_discovery(void **state) {
+    Env_t *e = *state;
+    memcpy(server_tp.entity.vin, "WDFKPROG000000001", UDS_DOIP_VIN_LEN);
+
+    // a vehicle identification request
+    UDSDoIPDiscovery_t d;
+    EXPECT_OK(UDSDoIPDiscoveryInit(&d, "127.0.0.1", PORT));
+
+    // should be answered with the entity's announcement
+    UDSDoIPEntity_t entity;
+    EXPECT_WITHIN_MS(e, UDSDoIPDiscoveryPoll(&d, &entity), 1000);
+    TEST_MEMORY_EQUAL(entity.vin, "WDFKPROG000000001", UDS_DOIP_VIN_LEN);
+    TEST_INT_EQUAL(entity.logicalAddress, ENTITY_ADDR);
+    TEST_INT_EQUAL(strcmp(entity.ip, "127.0.0.1"), 0);
+    UDSDoIPDiscoveryDeinit(&d);
+}
+
+static UDSErr_t server_fn(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    size_t *received = srv->fn_data;
+    switch (ev) {
+    case UDS_EVT_RequestDownload:
+        ((UDSRequestDownloadArgs_t *)arg)->maxNumberOfBlockLength = UDS_TP_MTU;
+        return UDS_PositiveResponse;
+    case UDS_EVT_TransferData: {
+        UDSTransferDataArgs_t *args = arg;
+        TEST_MEMORY_EQUAL(args->data, &image[*received], args->len);
+        *received += args->len;
+        return UDS_PositiveResponse;
+    }
+    case UDS_EVT_RequestTransferExit:
+        return UDS_PositiveResponse;
+    default:
+        return UDS_NRC_ServiceNotSupported;
+    }
+}
+
+static int client_fn(UDSClient_t *client, UDSEvent_t evt, void *ev_data) { return UDS_OK; }
+
+void test_download_uses_64k_blocks(void **state) {
+    Env_t *e = *state;
+    size_t received = 0;
+    for (size_t i = 0; i < sizeof(image); i++) {
+        image[i] = (uint8_t)(i * 7);
+    }
+    e->server = malloc(sizeof(UDSServer_t));
+    UDSServerInit(e->server);
+    e->server->tp = &server_tp.hdl;
+    e->server->fn = server_fn;
+    e->server->fn_data = &received;
+    e->server_tp = NULL;
+    e->client = malloc(sizeof(UDSClient_t));
+    UDSClientInit(e->client);
+    e->client->fn = client_fn;
+    Connect(e, ENTITY_ADDR);
+    e->client->tp = &client_tp.hdl;
+    e->client_tp = NULL;
+
+    // when an image is downloaded over DoIP
+    UDSDownloadSource_t src = {.data = image, .size = sizeof(image)};
+    EXPECT_OK(UDSStartDownload(e->client, 0x00, 0x44, 0x0, &src));
+    EXPECT_WITHIN_MS(e, UDS_DOWNLOAD_DONE == e->client->download.state, 5000);
+
+    // each TransferData request should carry almost 64 KiB
+    TEST_INT_EQUAL(received, IMAGE_SIZE);
+    TEST_INT_EQUAL(e->client->download.blockLength, UDS_TP_MTU);
+    TEST_INT_EQUAL(e->client->download.stats.blocks, 3);
+}
+
+int main(int ac, char **av) {
+    if (ac > 1) {
+        cmocka_set_test_filter(av[1]);
+    }
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_large_messages_are_exchanged, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_functional_request, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_unknown_target_is_rejected, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_vehicle_discovery, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_download_uses_64k_blocks, Setup, Teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
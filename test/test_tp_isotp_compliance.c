@@ -107,6 +107,68 @@ int TeardownIsoTpCClientOnly(void **state) {
     return 0;
 }
 
+int SetupIsoTpCFDPair(void **state) {
+    Env_t *env = malloc(sizeof(Env_t));
+    memset(env, 0, sizeof(Env_t));
+    UDSTpISOTpC_t *server_isotp = malloc(sizeof(UDSTpISOTpC_t));
+    strcpy(server_isotp->tag, "server");
+    assert(UDS_OK == UDSTpISOTpCInitFD(server_isotp, "vcan0", 0x7e8, 0x7e0, 0x7df, 0, 64));
+    env->server_tp = (UDSTp_t *)server_isotp;
+
+    UDSTpISOTpC_t *client_isotp = malloc(sizeof(UDSTpISOTpC_t));
+    strcpy(client_isotp->tag, "client");
+    assert(UDS_OK == UDSTpISOTpCInitFD(client_isotp, "vcan0", 0x7e0, 0x7e8, 0, 0x7df, 64));
+    env->client_tp = (UDSTp_t *)client_isotp;
+
+    env->is_real_time = true;
+    *state = env;
+    return 0;
+}
+
+int SetupIsoTpCFDClientOnly(void **state) {
+    Env_t *env = malloc(sizeof(Env_t));
+    memset(env, 0, sizeof(Env_t));
+    UDSTpISOTpC_t *client_isotp = malloc(sizeof(UDSTpISOTpC_t));
+    strcpy(client_isotp->tag, "client");
+    assert(UDS_OK == UDSTpISOTpCInitFD(client_isotp, "vcan0", 0x7e0, 0x7e8, 0, 0x7df, 64));
+    env->client_tp = (UDSTp_t *)client_isotp;
+    env->is_real_time = true;
+    *state = env;
+    return 0;
+}
+
+static UDSISOTpCEndpoint_t server_ep;
+static UDSISOTpCEndpoint_t client_ep;
+
+int SetupIsoTpCEndpointPair(void **state) {
+    Env_t *env = malloc(sizeof(Env_t));
+    memset(env, 0, sizeof(Env_t));
+    assert(UDS_OK == UDSISOTpCEndpointInit(&server_ep, "vcan0", false));
+    assert(UDS_OK == UDSISOTpCEndpointInit(&client_ep, "vcan0", false));
+    UDSTpISOTpC_t *server_isotp = malloc(sizeof(UDSTpISOTpC_t));
+    assert(UDS_OK ==
+           UDSTpISOTpCInitOnEndpoint(server_isotp, &server_ep, 0x7e8, 0x7e0, 0x7df, 0, 0));
+    strcpy(server_isotp->tag, "server");
+    env->server_tp = (UDSTp_t *)server_isotp;
+
+    UDSTpISOTpC_t *client_isotp = malloc(sizeof(UDSTpISOTpC_t));
+    assert(UDS_OK ==
+           UDSTpISOTpCInitOnEndpoint(client_isotp, &client_ep, 0x7e0, 0x7e8, 0, 0x7df, 0));
+    strcpy(client_isotp->tag, "client");
+    env->client_tp = (UDSTp_t *)client_isotp;
+
+    env->is_real_time = true;
+    *state = env;
+    return 0;
+}
+
+int TeardownIsoTpCEndpointPair(void **state) {
+    TeardownIsoTpCPair(state);
+    UDSISOTpCEndpointDeinit(&server_ep);
+    UDSISOTpCEndpointDeinit(&client_ep);
+    return 0;
+}
+
 int SetupIsoTpSockPair(void **state) {
     Env_t *env = malloc(sizeof(Env_t));
     memset(env, 0, sizeof(Env_t));
@@ -218,6 +280,34 @@ void test_send_functional_larger_than_single_frame_fails(void **state) {
     assert_true(ret < 0);
 }
 
+// ISO 15765-2 2016 9.6.2.1: with CAN FD a single frame carries up to TX_DL - 2 bytes after the
+// SF_DL escape sequence
+void test_send_recv_largest_fd_single_frame(void **state) {
+    Env_t *e = *state;
+    uint8_t buf[62] = {0};
+
+    // When a functional request filling a 64 byte CAN FD frame is sent
+    uint8_t MSG[62] = {0};
+    for (size_t i = 0; i < sizeof(MSG); i++) {
+        MSG[i] = (uint8_t)i;
+    }
+    ssize_t ret = UDSTpSend(e->client_tp, MSG, sizeof(MSG),
+                            &(UDSSDU_t){.A_TA_Type = UDS_A_TA_TYPE_FUNCTIONAL});
+    TEST_INT_EQUAL(ret, sizeof(MSG));
+
+    // the server should receive it as one functional request
+    UDSSDU_t info2 = {0};
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->server_tp, buf, sizeof(buf), &info2) > 0, 10);
+    TEST_MEMORY_EQUAL(buf, MSG, sizeof(MSG));
+    assert_int_equal(info2.A_TA_Type, UDS_A_TA_TYPE_FUNCTIONAL);
+
+    // and one byte more should not fit
+    uint8_t TOO_LONG[63] = {0};
+    ret = UDSTpSend(e->client_tp, TOO_LONG, sizeof(TOO_LONG),
+                    &(UDSSDU_t){.A_TA_Type = UDS_A_TA_TYPE_FUNCTIONAL});
+    assert_true(ret < 0);
+}
+
 void test_send_recv_max_len(void **state) {
     Env_t *e = *state;
     uint8_t buf[4095] = {0};
@@ -257,6 +347,122 @@ void test_flow_control_frame_timeout(void **state) {
     fail();
 }
 
+void test_flow_control_wait_while_unread(void **state) {
+    Env_t *e = *state;
+    UDSTpISOTpC_t *server = (UDSTpISOTpC_t *)e->server_tp;
+    uint8_t msg[100];
+    uint8_t buf[200];
+    isotp_set_flow_control(&server->phys_link, isotp_flow_control_adaptive, NULL);
+
+    // when a message has been received but not yet read
+    memset(msg, 1, sizeof(msg));
+    TEST_INT_EQUAL(UDSTpSend(e->client_tp, msg, sizeof(msg), NULL), sizeof(msg));
+    EnvRunMillis(e, 10);
+    TEST_INT_EQUAL(server->phys_link.receive_status, ISOTP_RECEIVE_STATUS_FULL);
+
+    // the first frame of the next one should be answered with FC.WAIT
+    memset(msg, 2, sizeof(msg));
+    TEST_INT_EQUAL(UDSTpSend(e->client_tp, msg, 50, NULL), 50);
+    EnvRunMillis(e, 10);
+    TEST_INT_EQUAL(server->phys_link.receive_fc_wait_count, 1);
+    TEST_INT_EQUAL((UDSTpPoll(e->client_tp) & UDS_TP_SEND_IN_PROGRESS), UDS_TP_SEND_IN_PROGRESS);
+
+    // and neither message should be lost once the first is read
+    TEST_INT_EQUAL(UDSTpRecv(e->server_tp, buf, sizeof(buf), NULL), 100);
+    memset(msg, 1, sizeof(msg));
+    TEST_MEMORY_EQUAL(buf, msg, 100);
+    EXPECT_WITHIN_MS(e, UDSTpRecv(e->server_tp, buf, sizeof(buf), NULL) == 50, 20);
+    memset(msg, 2, sizeof(msg));
+    TEST_MEMORY_EQUAL(buf, msg, 50);
+
+    // the rest fits the receive queue, so the sender was not asked to stop again
+    TEST_INT_EQUAL(server->phys_link.receive_fc_bs, 0);
+}
+
+void test_endpoint_many_links(void **state) {
+    Env_t *e = *state;
+#define NUM_LINKS 32
+    static UDSTpISOTpC_t servers[NUM_LINKS];
+    static UDSTpISOTpC_t clients[NUM_LINKS];
+    uint8_t msg[64];
+
+    // when many links share each endpoint
+    for (int i = 0; i < NUM_LINKS; i++) {
+        TEST_INT_EQUAL(UDS_OK, UDSTpISOTpCInitOnEndpoint(&servers[i], &server_ep, 0x600 + i,
+                                                         0x680 + i, 0x7df, 0, 0));
+        TEST_INT_EQUAL(UDS_OK, UDSTpISOTpCInitOnEndpoint(&clients[i], &client_ep, 0x680 + i,
+                                                         0x600 + i, 0, 0x7df, 0));
+    }
+
+    // a source address may be used by only one of them
+    UDSTpISOTpC_t dup;
+    TEST_INT_EQUAL(UDS_FAIL, UDSTpISOTpCInitOnEndpoint(&dup, &server_ep, 0x600, 0x680, 0, 0, 0));
+
+    // and each should receive the multi-frame message addressed to it
+    for (int i = 0; i < NUM_LINKS; i++) {
+        memset(msg, i, sizeof(msg));
+        TEST_INT_EQUAL(UDSTpSend(&clients[i].hdl, msg, sizeof(msg) - i, NULL), sizeof(msg) - i);
+    }
+    int received = 0;
+    uint8_t buf[UDS_TP_MTU];
+    for (int t = 0; t < 1000 && received < NUM_LINKS; t++) {
+        UDSISOTpCEndpointPoll(&client_ep);
+        UDSISOTpCEndpointPoll(&server_ep);
+        for (int i = 0; i < NUM_LINKS; i++) {
+            ssize_t len = UDSTpRecv(&servers[i].hdl, buf, sizeof(buf), NULL);
+            if (len > 0) {
+                memset(msg, i, sizeof(msg));
+                TEST_INT_EQUAL(len, sizeof(msg) - i);
+                TEST_MEMORY_EQUAL(buf, msg, len);
+                received++;
+            }
+        }
+        EnvRunMillis(e, 1);
+    }
+    TEST_INT_EQUAL(received, NUM_LINKS);
+
+    for (int i = 0; i < NUM_LINKS; i++) {
+        UDSTpISOTpCDeinit(&servers[i]);
+        UDSTpISOTpCDeinit(&clients[i]);
+    }
+    // detaching keeps the endpoint's own socket open
+    TEST_INT_EQUAL(server_ep.route_count, 2);
+    test_send_recv(state);
+}
+
+void test_isotp_sock_event_loop(void **state) {
+    Env_t *e = *state;
+    UDSTpIsoTpSock_t *server = (UDSTpIsoTpSock_t *)e->server_tp;
+    UDSTpIsoTpSock_t *client = (UDSTpIsoTpSock_t *)e->client_tp;
+    server->poll_timeout_ms = 0;
+    client->poll_timeout_ms = 0;
+    uint8_t buf[64] = {0};
+
+    // When a multi-frame request is sent
+    uint8_t MSG[64] = {0};
+    MSG[0] = 0x2E;
+    MSG[63] = 0x01;
+    TEST_INT_EQUAL(UDSTpSend(e->client_tp, MSG, sizeof(MSG), NULL), sizeof(MSG));
+
+    // the client should wait for the send to finish
+    struct pollfd fds[2];
+    TEST_INT_EQUAL(UDSTpIsoTpSockPollFds(client, fds), 2);
+    TEST_INT_EQUAL(fds[0].fd, client->phys_fd);
+    TEST_INT_EQUAL(fds[0].events, (POLLIN | POLLOUT));
+
+    // and the server's descriptors should become readable without polling the transport
+    TEST_INT_EQUAL(UDSTpIsoTpSockPollFds(server, fds), 2);
+    TEST_INT_EQUAL(poll(fds, 2, 1000), 1);
+    TEST_INT_EQUAL((fds[0].revents & POLLIN), POLLIN);
+    TEST_INT_EQUAL(UDSTpRecv(e->server_tp, buf, sizeof(buf), NULL), sizeof(MSG));
+    TEST_MEMORY_EQUAL(buf, MSG, sizeof(MSG));
+
+    // once the send is done the client should only wait for data
+    EXPECT_WITHIN_MS(e, !(UDSTpPoll(e->client_tp) & UDS_TP_SEND_IN_PROGRESS), 100);
+    UDSTpIsoTpSockPollFds(client, fds);
+    TEST_INT_EQUAL(fds[0].events, POLLIN);
+}
+
 // clang-format off
 const struct CMUnitTest tests_tp_mock[] = {
     cmocka_unit_test_setup_teardown(test_send_recv,                                         SetupMockTpPair,        TeardownMockTpPair),
@@ -283,6 +489,26 @@ const struct CMUnitTest tests_tp_isotp_c[] = {
     cmocka_unit_test_setup_teardown(test_send_functional_larger_than_single_frame_fails,    SetupIsoTpCPair,        TeardownIsoTpCPair),
     cmocka_unit_test_setup_teardown(test_send_recv_max_len,                                 SetupIsoTpCPair,        TeardownIsoTpCPair),
     cmocka_unit_test_setup_teardown(test_flow_control_frame_timeout,                        SetupIsoTpCClientOnly,  TeardownIsoTpCClientOnly),
+    cmocka_unit_test_setup_teardown(test_flow_control_wait_while_unread,                    SetupIsoTpCPair,        TeardownIsoTpCPair),
+};
+
+const struct CMUnitTest tests_tp_isotp_c_fd[] = {
+    cmocka_unit_test_setup_teardown(test_send_recv,                                         SetupIsoTpCFDPair,          TeardownIsoTpCPair),
+    cmocka_unit_test_setup_teardown(test_send_recv_functional,                              SetupIsoTpCFDPair,          TeardownIsoTpCPair),
+    cmocka_unit_test_setup_teardown(test_send_recv_largest_single_frame,                    SetupIsoTpCFDPair,          TeardownIsoTpCPair),
+    cmocka_unit_test_setup_teardown(test_send_recv_largest_fd_single_frame,                 SetupIsoTpCFDPair,          TeardownIsoTpCPair),
+    cmocka_unit_test_setup_teardown(test_send_recv_max_len,                                 SetupIsoTpCFDPair,          TeardownIsoTpCPair),
+    cmocka_unit_test_setup_teardown(test_flow_control_frame_timeout,                        SetupIsoTpCFDClientOnly,    TeardownIsoTpCClientOnly),
+};
+
+const struct CMUnitTest tests_tp_isotp_c_ep[] = {
+    cmocka_unit_test_setup_teardown(test_send_recv,                                         SetupIsoTpCEndpointPair,    TeardownIsoTpCEndpointPair),
+    cmocka_unit_test_setup_teardown(test_send_recv_functional,                              SetupIsoTpCEndpointPair,    TeardownIsoTpCEndpointPair),
+    cmocka_unit_test_setup_teardown(test_send_recv_largest_single_frame,                    SetupIsoTpCEndpointPair,    TeardownIsoTpCEndpointPair),
+    cmocka_unit_test_setup_teardown(test_send_functional_larger_than_single_frame_fails,    SetupIsoTpCEndpointPair,    TeardownIsoTpCEndpointPair),
+    cmocka_unit_test_setup_teardown(test_send_recv_max_len,                                 SetupIsoTpCEndpointPair,    TeardownIsoTpCEndpointPair),
+    cmocka_unit_test_setup_teardown(test_endpoint_many_links,                               SetupIsoTpCEndpointPair,    TeardownIsoTpCEndpointPair),
+    cmocka_unit_test_setup_teardown(test_flow_control_wait_while_unread,                    SetupIsoTpCEndpointPair,    TeardownIsoTpCEndpointPair),
 };
 
 const struct CMUnitTest tests_tp_isotp_sock[] = {
@@ -292,6 +518,7 @@ const struct CMUnitTest tests_tp_isotp_sock[] = {
     cmocka_unit_test_setup_teardown(test_send_functional_larger_than_single_frame_fails,    SetupIsoTpSockPair,         TeardownIsoTpSockPair),
     cmocka_unit_test_setup_teardown(test_send_recv_max_len,                                 SetupIsoTpSockPair,         TeardownIsoTpSockPair),
     cmocka_unit_test_setup_teardown(test_flow_control_frame_timeout,                        SetupIsoTpSockClientOnly,   TeardownIsoTpSockClientOnly),
+    cmocka_unit_test_setup_teardown(test_isotp_sock_event_loop,                             SetupIsoTpSockPair,         TeardownIsoTpSockPair),
 };
 // clang-format on
 
@@ -309,6 +536,12 @@ int main(int ac, char **av) {
         } else if (0 == strcmp(av[1], "c")) {
             UDS_LOGI(__FILE__, "running isotp_c tests. av[1]=%s", av[1]);
             return cmocka_run_group_tests(tests_tp_isotp_c, NULL, NULL);
+        } else if (0 == strcmp(av[1], "c_fd")) {
+            UDS_LOGI(__FILE__, "running isotp_c CAN FD tests. av[1]=%s", av[1]);
+            return cmocka_run_group_tests(tests_tp_isotp_c_fd, NULL, NULL);
+        } else if (0 == strcmp(av[1], "c_ep")) {
+            UDS_LOGI(__FILE__, "running isotp_c endpoint tests. av[1]=%s", av[1]);
+            return cmocka_run_group_tests(tests_tp_isotp_c_ep, NULL, NULL);
         } else if (0 == strcmp(av[1], "sock")) {
             UDS_LOGI(__FILE__, "running isotp_sock tests. av[1]=%s", av[1]);
             return cmocka_run_group_tests(tests_tp_isotp_sock, NULL, NULL);
@@ -319,5 +552,7 @@ int main(int ac, char **av) {
     UDS_LOGI(__FILE__, "running all tests");
     return cmocka_run_group_tests(tests_tp_mock, NULL, NULL) +
            cmocka_run_group_tests(tests_tp_isotp_c, NULL, NULL) +
+           cmocka_run_group_tests(tests_tp_isotp_c_fd, NULL, NULL) +
+           cmocka_run_group_tests(tests_tp_isotp_c_ep, NULL, NULL) +
            cmocka_run_group_tests(tests_tp_isotp_sock, NULL, NULL);
 }
@@ -0,0 +1,149 @@
+#include "test/env.h"
+
+#define NUM_ECUS 1000
+
+static UDSTp_t *tester;
+static UDSTp_t *ecus[NUM_ECUS];
+
+int Setup(void **state) {
+    ISOTPMockSetTime(0);
+    tester = ISOTPMockNew("tester", &(ISOTPMockArgs_t){.sa_phys = 0x100,
+                                                       .ta_phys = 0x200,
+                                                       .sa_func = UDS_TP_NOOP_ADDR,
+                                                       .ta_func = 0x7DF,
+                                                       .rx_queue_len = NUM_ECUS});
+    return 0;
+}
+
+int Teardown(void **state) {
+    ISOTPMockFree(tester);
+    for (int i = 0; i < NUM_ECUS; i++) {
+        if (ecus[i]) {
+            ISOTPMockFree(ecus[i]);
+            ecus[i] = NULL;
+        }
+    }
+    ISOTPMockReset();
+    return 0;
+}
+
+static void AddECUs(int n) {
+    for (int i = 0; i < n; i++) {
+        ecus[i] = ISOTPMockNew(NULL, &(ISOTPMockArgs_t){.sa_phys = 0x200 + i,
+                                                         .ta_phys = 0x100,
+                                                         .sa_func = 0x7DF,
+                                                         .ta_func = UDS_TP_NOOP_ADDR});
+        assert_non_null(ecus[i]);
+    }
+}
+
+static ssize_t Send(UDSTp_t *tp, uint32_t ta, const uint8_t *buf, size_t len) {
+    UDSSDU_t info = {.A_TA_Type = UDS_A_TA_TYPE_PHYSICAL, .A_TA = ta};
+    return UDSTpSend(tp, buf, (ssize_t)len, &info);
+}
+
+void test_many_endpoints(void **state) {
+    AddECUs(NUM_ECUS);
+
+    // a functional request should reach every ECU
+    const uint8_t req[] = {0x3E, 0x00};
+    UDSSDU_t func = {.A_TA_Type = UDS_A_TA_TYPE_FUNCTIONAL};
+    TEST_INT_EQUAL(UDSTpSend(tester, req, sizeof(req), &func), sizeof(req));
+    ISOTPMockAdvance(1);
+    UDSTpPoll(tester);
+    for (int i = 0; i < NUM_ECUS; i++) {
+        uint8_t buf[8];
+        TEST_INT_EQUAL(UDSTpRecv(ecus[i], buf, sizeof(buf), NULL), sizeof(req));
+        const uint8_t resp[] = {0x7E, 0x00, (uint8_t)i};
+        TEST_INT_EQUAL(UDSTpSend(ecus[i], resp, sizeof(resp), NULL), sizeof(resp));
+    }
+
+    // and every response should be queued at the tester in the order it was sent
+    ISOTPMockAdvance(1);
+    UDSTpPoll(tester);
+    TEST_INT_EQUAL(ISOTPMockInFlight(), 0);
+    for (int i = 0; i < NUM_ECUS; i++) {
+        uint8_t buf[8];
+        UDSSDU_t info = {0};
+        TEST_INT_EQUAL(UDSTpRecv(tester, buf, sizeof(buf), &info), 3);
+        TEST_INT_EQUAL(info.A_SA, 0x200 + i);
+        TEST_INT_EQUAL(buf[2], (uint8_t)i);
+    }
+    TEST_INT_EQUAL(((ISOTPMock_t *)tester)->rx_dropped, 0);
+}
+
+void test_bitrate_and_latency(void **state) {
+    AddECUs(1);
+    ISOTPMock_t *link = (ISOTPMock_t *)tester;
+    link->bitrate = 100000; // 1 ms for 12.5 bytes
+    link->send_tx_delay_ms = 2;
+
+    // back to back messages should be serialized on the link
+    uint8_t msg[125] = {0};
+    Send(tester, 0x200, msg, sizeof(msg)); // 10 ms on the wire
+    Send(tester, 0x200, msg, sizeof(msg)); // done at 20 ms
+    uint8_t buf[sizeof(msg)];
+    ISOTPMockAdvance(12);
+    UDSTpPoll(tester);
+    TEST_INT_EQUAL(UDSTpRecv(ecus[0], buf, sizeof(buf), NULL), 0);
+    ISOTPMockAdvance(1);
+    UDSTpPoll(tester);
+    TEST_INT_EQUAL(UDSTpRecv(ecus[0], buf, sizeof(buf), NULL), sizeof(msg));
+    TEST_INT_EQUAL(UDSTpRecv(ecus[0], buf, sizeof(buf), NULL), 0);
+    ISOTPMockAdvance(10);
+    UDSTpPoll(tester);
+    TEST_INT_EQUAL(UDSTpRecv(ecus[0], buf, sizeof(buf), NULL), sizeof(msg));
+}
+
+void test_loss(void **state) {
+    AddECUs(1);
+    ISOTPMock_t *link = (ISOTPMock_t *)tester;
+    link->loss_ppm = 250000;
+
+    // about a quarter of the messages should be lost, and the rest delivered
+    int received = 0;
+    for (int i = 0; i < 4000; i++) {
+        const uint8_t msg[] = {0x3E, 0x00};
+        Send(tester, 0x200, msg, sizeof(msg));
+        ISOTPMockAdvance(1);
+        UDSTpPoll(tester);
+        uint8_t buf[8];
+        if (UDSTpRecv(ecus[0], buf, sizeof(buf), NULL) > 0) {
+            received++;
+        }
+    }
+    TEST_INT_EQUAL(received + link->lost, 4000);
+    TEST_INT_GREATER(link->lost, 800);
+    TEST_INT_LT(link->lost, 1200);
+}
+
+void test_virtual_time(void **state) {
+    AddECUs(1);
+    ((ISOTPMock_t *)tester)->send_tx_delay_ms = 5000;
+
+    // the network should only move with its own clock, whatever UDSMillis says
+    const uint8_t msg[] = {0x3E, 0x00};
+    Send(tester, 0x200, msg, sizeof(msg));
+    EnvRunMillis(&(Env_t){0}, 6000);
+    uint8_t buf[8];
+    UDSTpPoll(tester);
+    TEST_INT_EQUAL(UDSTpRecv(ecus[0], buf, sizeof(buf), NULL), 0);
+    TEST_INT_EQUAL(ISOTPMockInFlight(), 1);
+    ISOTPMockAdvance(5001);
+    UDSTpPoll(tester);
+    TEST_INT_EQUAL(UDSTpRecv(ecus[0], buf, sizeof(buf), NULL), sizeof(msg));
+    TEST_INT_EQUAL(ISOTPMockMillis(), 5001);
+}
+
+int main(int ac, char **av) {
+    if (ac > 1) {
+        cmocka_set_test_filter(av[1]);
+    }
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_many_endpoints, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_bitrate_and_latency, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_loss, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_virtual_time, Setup, Teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
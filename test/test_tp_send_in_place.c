@@ -0,0 +1,176 @@
+#include "test/env.h"
+#include <stdarg.h>
+
+// isotp-c links of a server and a tester on a simulated CAN bus. Frames are delivered between
+// polls so that a link never receives while it is sending.
+#define BUS_LEN 64
+
+static struct {
+    uint32_t id;
+    uint8_t data[8];
+    uint8_t len;
+} bus[BUS_LEN];
+static size_t bus_count = 0;
+
+int isotp_user_send_can(const uint32_t arbitration_id, const uint8_t *data, const uint8_t size,
+                        void *arg) {
+    if (bus_count >= BUS_LEN || size > sizeof(bus[0].data)) {
+        return ISOTP_RET_NOSPACE;
+    }
+    bus[bus_count].id = arbitration_id;
+    memcpy(bus[bus_count].data, data, size);
+    bus[bus_count].len = size;
+    bus_count++;
+    return ISOTP_RET_OK;
+}
+
+uint32_t isotp_user_get_us(void) { return UDSMillis() * 1000; }
+
+void isotp_user_debug(const char *message, ...) {
+    va_list args;
+    va_start(args, message);
+    vprintf(message, args);
+    va_end(args);
+}
+
+typedef struct {
+    Env_t env;
+    UDSISOTpC_t server_tp;
+    UDSISOTpC_t client_tp;
+} Ctx_t;
+
+static void Step(Ctx_t *ctx) {
+    for (size_t i = 0; i < bus_count; i++) {
+        UDSISOTpCOnFrame(&ctx->server_tp, bus[i].id, bus[i].data, bus[i].len);
+        UDSISOTpCOnFrame(&ctx->client_tp, bus[i].id, bus[i].data, bus[i].len);
+    }
+    bus_count = 0;
+    EnvStep(&ctx->env, 1);
+}
+
+static uint8_t record[300];
+static uint8_t small_record[40];
+
+static UDSErr_t fn(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    switch (ev) {
+    case UDS_EVT_ReadDataByIdent: {
+        UDSRDBIArgs_t *args = arg;
+        switch (args->dataId) {
+        case 0x1234:
+            return args->copy(srv, record, sizeof(record));
+        case 0x5678:
+            return args->copy(srv, small_record, sizeof(small_record));
+        default:
+            return UDS_NRC_RequestOutOfRange;
+        }
+    }
+    default:
+        return UDS_PositiveResponse;
+    }
+}
+
+int Setup(void **state) {
+    Ctx_t *ctx = malloc(sizeof(Ctx_t));
+    memset(ctx, 0, sizeof(Ctx_t));
+    bus_count = 0;
+    for (size_t i = 0; i < sizeof(record); i++) {
+        record[i] = (uint8_t)i;
+    }
+    memset(small_record, 0xA5, sizeof(small_record));
+    EXPECT_OK(UDSISOTpCInit(&ctx->server_tp, &(UDSISOTpCConfig_t){.source_addr = 0x7E0,
+                                                                    .target_addr = 0x7E8,
+                                                                    .source_addr_func = 0x7DF,
+                                                                    .target_addr_func = 0}));
+    EXPECT_OK(UDSISOTpCInit(&ctx->client_tp, &(UDSISOTpCConfig_t){.source_addr = 0x7E8,
+                                                                    .target_addr = 0x7E0,
+                                                                    .source_addr_func = 0,
+                                                                    .target_addr_func = 0x7DF}));
+    Env_t *e = &ctx->env;
+    e->server = malloc(sizeof(UDSServer_t));
+    UDSServerInit(e->server);
+    e->server->fn = fn;
+    e->server->tp = &ctx->server_tp.hdl;
+    e->client_tp = &ctx->client_tp.hdl;
+    *state = ctx;
+    return 0;
+}
+
+int Teardown(void **state) {
+    Ctx_t *ctx = *state;
+    free(ctx->env.server);
+    free(ctx);
+    return 0;
+}
+
+static ssize_t TesterRecv(Ctx_t *ctx, uint8_t *buf, size_t size) {
+    ssize_t len = 0;
+    for (int i = 0; i < 1000 && len <= 0; i++) {
+        Step(ctx);
+        len = UDSTpRecv(ctx->env.client_tp, buf, size, NULL);
+    }
+    return len;
+}
+
+void test_links_have_no_send_buffer(void **state) {
+    Ctx_t *ctx = *state;
+    TEST_PTR_EQUAL(ctx->server_tp.phys_link.send_buffer, NULL);
+    TEST_INT_EQUAL(ctx->server_tp.phys_link.send_buf_size, 0);
+}
+
+void test_multi_frame_response_is_sent_from_send_buf(void **state) {
+    Ctx_t *ctx = *state;
+    UDSServer_t *srv = ctx->env.server;
+    uint8_t req[] = {0x22, 0x12, 0x34};
+    UDSTpSend(ctx->env.client_tp, req, sizeof(req), NULL);
+
+    // the link reads the response from the buffer of the server while it is in flight
+    for (int i = 0; i < 100 && ISOTP_SEND_STATUS_INPROGRESS != ctx->server_tp.phys_link.send_status;
+         i++) {
+        Step(ctx);
+    }
+    TEST_INT_EQUAL(ctx->server_tp.phys_link.send_status, ISOTP_SEND_STATUS_INPROGRESS);
+    TEST_PTR_EQUAL(ctx->server_tp.phys_link.send_data, srv->r.send_buf);
+
+    uint8_t buf[UDS_TP_MTU] = {0};
+    TEST_INT_EQUAL(TesterRecv(ctx, buf, sizeof(buf)), 3 + sizeof(record));
+    TEST_MEMORY_EQUAL(buf, ((uint8_t[]){0x62, 0x12, 0x34}), 3);
+    TEST_MEMORY_EQUAL(buf + 3, record, sizeof(record));
+}
+
+void test_request_during_transfer_waits_for_send_buf(void **state) {
+    Ctx_t *ctx = *state;
+    uint8_t req[] = {0x22, 0x12, 0x34};
+    UDSTpSend(ctx->env.client_tp, req, sizeof(req), NULL);
+    for (int i = 0; i < 100 && ISOTP_SEND_STATUS_INPROGRESS != ctx->server_tp.phys_link.send_status;
+         i++) {
+        Step(ctx);
+    }
+    TEST_INT_EQUAL(ctx->server_tp.phys_link.send_status, ISOTP_SEND_STATUS_INPROGRESS);
+
+    // a functional request arrives while the response is being sent
+    uint8_t func_req[] = {0x22, 0x56, 0x78};
+    UDSTpSend(ctx->env.client_tp, func_req, sizeof(func_req),
+              &(UDSSDU_t){.A_TA_Type = UDS_A_TA_TYPE_FUNCTIONAL});
+
+    // the response is not overwritten, and the functional request is answered after it
+    uint8_t buf[UDS_TP_MTU] = {0};
+    TEST_INT_EQUAL(TesterRecv(ctx, buf, sizeof(buf)), 3 + sizeof(record));
+    TEST_MEMORY_EQUAL(buf + 3, record, sizeof(record));
+    TEST_INT_EQUAL(TesterRecv(ctx, buf, sizeof(buf)), 3 + sizeof(small_record));
+    TEST_MEMORY_EQUAL(buf, ((uint8_t[]){0x62, 0x56, 0x78}), 3);
+    TEST_MEMORY_EQUAL(buf + 3, small_record, sizeof(small_record));
+}
+
+int main(int ac, char **av) {
+    if (ac > 1) {
+        cmocka_set_test_filter(av[1]);
+    }
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_links_have_no_send_buffer, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_multi_frame_response_is_sent_from_send_buf, Setup,
+                                        Teardown),
+        cmocka_unit_test_setup_teardown(test_request_during_transfer_waits_for_send_buf, Setup,
+                                        Teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
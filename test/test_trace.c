@@ -0,0 +1,111 @@
+#include "test/env.h"
+
+#if !UDS_TRACE
+#error "this test requires UDS_TRACE"
+#endif
+
+static int ClientFn(UDSClient_t *client, UDSEvent_t evt, void *ev_data) { return UDS_OK; }
+
+int Setup(void **state) {
+    Env_t *env = malloc(sizeof(Env_t));
+    memset(env, 0, sizeof(Env_t));
+    env->server = malloc(sizeof(UDSServer_t));
+    UDSServerInit(env->server);
+    env->server->tp = ISOTPMockNew("server", &(ISOTPMockArgs_t){.sa_phys = 0x7E0,
+                                                                .ta_phys = 0x7E8,
+                                                                .sa_func = 0x7DF,
+                                                                .ta_func = UDS_TP_NOOP_ADDR});
+    env->client = malloc(sizeof(UDSClient_t));
+    UDSClientInit(env->client);
+    env->client->fn = ClientFn;
+    env->client->tp = ISOTPMockNew("client", &(ISOTPMockArgs_t){.sa_phys = 0x7E8,
+                                                                .ta_phys = 0x7E0,
+                                                                .sa_func = UDS_TP_NOOP_ADDR,
+                                                                .ta_func = 0x7DF});
+    UDSTrace.head = 0;
+    memset(UDSTrace.entry, 0, sizeof(UDSTrace.entry));
+    *state = env;
+    return 0;
+}
+
+int Teardown(void **state) {
+    Env_t *env = *state;
+    ISOTPMockFree(env->server->tp);
+    ISOTPMockFree(env->client->tp);
+    ISOTPMockReset();
+    free(env->server);
+    free(env->client);
+    free(env);
+    return 0;
+}
+
+static UDSErr_t fn(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    if (UDS_EVT_ReadDataByIdent == ev) {
+        UDSRDBIArgs_t *r = arg;
+        uint8_t value[20] = {0};
+        return r->copy(srv, value, sizeof(value));
+    }
+    return UDS_NRC_ServiceNotSupported;
+}
+
+static void ExpectEntry(const UDSTraceRing_t *ring, uint32_t n, uint8_t event, uint32_t addr,
+                        uint16_t len, const uint8_t *data, size_t data_len) {
+    const UDSTraceEntry_t *e = &ring->entry[n % UDS_TRACE_ENTRIES];
+    TEST_INT_EQUAL(e->seq, n + 1);
+    TEST_INT_EQUAL(e->event, event);
+    TEST_INT_EQUAL(e->addr, addr);
+    TEST_INT_EQUAL(e->len, len);
+    TEST_MEMORY_EQUAL(e->data, data, data_len);
+}
+
+void test_exchange(void **state) {
+    Env_t *env = *state;
+    env->server->fn = fn;
+
+    // a request and its response should leave four entries: sent and received on each side
+    const uint8_t req[] = {0x22, 0xF1, 0x90};
+    EXPECT_OK(UDSSendBytes(env->client, req, sizeof(req)));
+    EXPECT_WITHIN_MS(env, 0 == env->client->state, 200);
+
+    static UDSTraceRing_t ring;
+    UDSTraceSnapshot(&ring);
+    TEST_INT_EQUAL(ring.magic, UDS_TRACE_MAGIC);
+    TEST_INT_EQUAL(ring.dataLen, UDS_TRACE_DATA_LEN);
+    TEST_INT_EQUAL(ring.head, 4);
+    const uint8_t resp[UDS_TRACE_DATA_LEN] = {0x62, 0xF1, 0x90};
+    // both sides leave the target address to their transport
+    ExpectEntry(&ring, 0, UDS_TRACE_EVT_TX, 0, sizeof(req), req, sizeof(req));
+    ExpectEntry(&ring, 1, UDS_TRACE_EVT_RX, 0x7E8, sizeof(req), req, sizeof(req));
+    ExpectEntry(&ring, 2, UDS_TRACE_EVT_TX, 0, 23, resp, sizeof(resp));
+    ExpectEntry(&ring, 3, UDS_TRACE_EVT_RX, 0x7E0, 23, resp, sizeof(resp));
+    TEST_INT_EQUAL((ring.entry[0].us <= ring.entry[3].us), true);
+}
+
+void test_wraps_around(void **state) {
+    // the ring should keep the newest UDS_TRACE_ENTRIES events
+    const uint32_t total = UDS_TRACE_ENTRIES * 2 + 3;
+    for (uint32_t i = 0; i < total; i++) {
+        const uint8_t data[4] = {(uint8_t)(i >> 24), (uint8_t)(i >> 16), (uint8_t)(i >> 8),
+                                 (uint8_t)i};
+        UDSTraceRecord(UDS_TRACE_EVT_USER, i, data, sizeof(data));
+    }
+    static UDSTraceRing_t ring;
+    UDSTraceSnapshot(&ring);
+    TEST_INT_EQUAL(ring.head, total);
+    for (uint32_t n = total - UDS_TRACE_ENTRIES; n < total; n++) {
+        const uint8_t data[4] = {(uint8_t)(n >> 24), (uint8_t)(n >> 16), (uint8_t)(n >> 8),
+                                 (uint8_t)n};
+        ExpectEntry(&ring, n, UDS_TRACE_EVT_USER, n, sizeof(data), data, sizeof(data));
+    }
+}
+
+int main(int ac, char **av) {
+    if (ac > 1) {
+        cmocka_set_test_filter(av[1]);
+    }
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_exchange, Setup, Teardown),
+        cmocka_unit_test_setup_teardown(test_wraps_around, Setup, Teardown),
+    };
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
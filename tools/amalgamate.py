@@ -10,8 +10,18 @@ iso14229_c = os.path.join(out_dir, "iso14229.c")
 parser = argparse.ArgumentParser()
 parser.add_argument("--out_c", help="output c file", default=iso14229_c)
 parser.add_argument("--out_h", help="output h file", default=iso14229_h)
+parser.add_argument(
+    "--profile",
+    help="build profile the amalgamation defaults to (see UDS_PROFILE in src/config.h)",
+    choices=["full-featured", "minimal-bootloader"],
+)
 parser.add_argument("srcs", nargs="*")
 args = parser.parse_args()
+
+PROFILE_MACROS = {
+    "full-featured": "UDS_PROFILE_FULL_FEATURED",
+    "minimal-bootloader": "UDS_PROFILE_MINIMAL_BOOTLOADER",
+}
 srcs = {os.path.basename(src): src for src in args.srcs}
 
 
@@ -49,13 +59,24 @@ with open(args.out_c, "w", encoding="utf-8") as f:
     for src in [
         "src/client.c",
         "src/server.c",
+        "src/dtc.c",
+        "src/lz.c",
+        "src/stats.c",
+        "src/trace.c",
+        "src/orchestrator.c",
+        "src/router.c",
+        "src/scheduler.c",
         "src/tp.c",
+        "src/tp/can_ring.c",
         "src/util.c",
         "src/log.c",
         "src/tp/isotp_c.c",
         "src/tp/isotp_c_socketcan.c",
+        "src/tp/esp32_twai.c",
         "src/tp/isotp_sock.c",
+        "src/host.c",
         "src/tp/isotp_mock.c",
+        "src/tp/doip.c",
     ]:
         f.write("\n")
         f.write("#ifdef UDS_LINES\n")
@@ -81,6 +102,11 @@ with open(args.out_h, "w", encoding="utf-8") as f:
     f.write(" * @see https://github.com/driftregion/iso14229\n")
     f.write(" */\n")
     f.write("\n")
+    if args.profile:
+        f.write("#ifndef UDS_PROFILE\n")
+        f.write(f"#define UDS_PROFILE {PROFILE_MACROS[args.profile]}\n")
+        f.write("#endif\n")
+        f.write("\n")
     f.write("#ifdef __cplusplus\n")
     f.write("extern \"C\" {\n")
     f.write("#endif\n")
@@ -98,8 +124,15 @@ with open(args.out_h, "w", encoding="utf-8") as f:
         "src/uds.h",
         "src/util.h",
         "src/log.h",
+        "src/lz.h",
+        "src/stats.h",
+        "src/trace.h",
         "src/client.h",
+        "src/orchestrator.h",
+        "src/dtc.h",
         "src/server.h",
+        "src/scheduler.h",
+        "src/router.h",
     ]:
         f.write("\n")
         src_path = next((s for s in args.srcs if src in s))
@@ -112,10 +145,14 @@ with open(args.out_h, "w", encoding="utf-8") as f:
 
 
     for src in [
+        "src/tp/can_ring.h",
         "src/tp/isotp_c.h",
         "src/tp/isotp_c_socketcan.h",
+        "src/tp/esp32_twai.h",
         "src/tp/isotp_sock.h",
         "src/tp/isotp_mock.h",
+        "src/tp/doip.h",
+        "src/host.h",
     ]:
         f.write("\n")
         with open(src) as src_file:
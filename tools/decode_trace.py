@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+"""
+Decode a dump of the UDS_TRACE ring (UDSTraceRing_t in src/trace.h).
+
+The dump is the raw memory of `UDSTrace` or of a ring filled by UDSTraceSnapshot(), for example
+    (gdb) dump binary value trace.bin UDSTrace
+The byte order is taken from the magic number, so dumps from big endian targets decode as well.
+
+Usage: decode_trace.py [--json] trace.bin
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+MAGIC = 0x54534455
+HEADER = "IHHII"
+ENTRY_HEADER = "IIIHBB"
+
+EVENTS = {1: "TX", 2: "RX", 3: "TX_ERR", 4: "RX_ERR"}
+FLAG_FUNCTIONAL = 0x01
+
+SERVICES = {
+    0x10: "DiagnosticSessionControl",
+    0x11: "ECUReset",
+    0x14: "ClearDiagnosticInformation",
+    0x19: "ReadDTCInformation",
+    0x22: "ReadDataByIdentifier",
+    0x23: "ReadMemoryByAddress",
+    0x24: "ReadScalingDataByIdentifier",
+    0x27: "SecurityAccess",
+    0x28: "CommunicationControl",
+    0x29: "Authentication",
+    0x2A: "ReadPeriodicDataByIdentifier",
+    0x2C: "DynamicallyDefineDataIdentifier",
+    0x2E: "WriteDataByIdentifier",
+    0x2F: "InputOutputControlByIdentifier",
+    0x31: "RoutineControl",
+    0x34: "RequestDownload",
+    0x35: "RequestUpload",
+    0x36: "TransferData",
+    0x37: "RequestTransferExit",
+    0x38: "RequestFileTransfer",
+    0x3D: "WriteMemoryByAddress",
+    0x3E: "TesterPresent",
+    0x83: "AccessTimingParameter",
+    0x84: "SecuredDataTransmission",
+    0x85: "ControlDTCSetting",
+    0x86: "ResponseOnEvent",
+    0x87: "LinkControl",
+}
+
+
+def describe(data):
+    """Name the service of an SDU from its leading bytes."""
+    if not data:
+        return ""
+    sid = data[0]
+    if sid == 0x7F and len(data) >= 3:
+        name = SERVICES.get(data[1], f"0x{data[1]:02X}")
+        return f"{name} NRC 0x{data[2]:02X}"
+    if sid & 0x40 and (sid & ~0x40) in SERVICES:
+        return SERVICES[sid & ~0x40] + " response"
+    return SERVICES.get(sid, "")
+
+
+def decode(blob):
+    """Return the complete entries of a ring dump, oldest first."""
+    if len(blob) < struct.calcsize("<" + HEADER):
+        raise ValueError("dump is shorter than the ring header")
+    for order in "<>":
+        if struct.unpack_from(order + "I", blob)[0] == MAGIC:
+            break
+    else:
+        raise ValueError("not a trace dump: bad magic")
+    _, version, data_len, entries, head = struct.unpack_from(order + HEADER, blob)
+    if version != 1:
+        raise ValueError(f"unsupported trace version {version}")
+    offset = struct.calcsize(order + HEADER)
+    entry_size = struct.calcsize(order + ENTRY_HEADER) + data_len
+    if len(blob) < offset + entries * entry_size:
+        raise ValueError("dump is shorter than the ring")
+
+    out = []
+    for i in range(entries):
+        base = offset + i * entry_size
+        seq, us, addr, length, event, flags = struct.unpack_from(order + ENTRY_HEADER, blob, base)
+        # empty, torn or a slot index that does not match its sequence number
+        if seq == 0 or (seq - 1) % entries != i or seq > head:
+            continue
+        start = base + struct.calcsize(order + ENTRY_HEADER)
+        is_sdu = event in (1, 2)
+        is_err = event in (3, 4)
+        data = b"" if is_err else blob[start : start + min(length, data_len)]
+        out.append(
+            {
+                "seq": seq,
+                "us": us,
+                "event": EVENTS.get(event, f"USER_0x{event:02X}" if event >= 0x80 else str(event)),
+                "addr": addr,
+                "functional": bool(flags & FLAG_FUNCTIONAL),
+                "len": length,
+                "error": -length if is_err else None,
+                "data": data.hex(" "),
+                "service": describe(data) if is_sdu else "",
+            }
+        )
+    out.sort(key=lambda e: e["seq"])
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawTextHelpFormatter
+    )
+    parser.add_argument("dump", help="raw dump of UDSTrace, - for stdin")
+    parser.add_argument("--json", action="store_true", help="print the entries as JSON")
+    args = parser.parse_args()
+
+    if args.dump == "-":
+        blob = sys.stdin.buffer.read()
+    else:
+        with open(args.dump, "rb") as f:
+            blob = f.read()
+    try:
+        entries = decode(blob)
+    except ValueError as e:
+        sys.exit(f"{args.dump}: {e}")
+
+    if args.json:
+        json.dump(entries, sys.stdout, indent=2)
+        print()
+        return
+    if not entries:
+        return
+    # timestamps are relative to the oldest entry and UDSMicros() wraps every 71 minutes
+    t0 = entries[0]["us"]
+    for e in entries:
+        t = ((e["us"] - t0) & 0xFFFFFFFF) / 1000.0
+        addr = f"0x{e['addr']:03X}" + (" func" if e["functional"] else "")
+        if e["error"] is not None:
+            print(f"{e['seq']:>8} {t:>12.3f} ms  {e['event']:<7} {addr:<12} error {e['error']}")
+            continue
+        more = " ..." if e["len"] > len(e["data"].split()) else ""
+        print(
+            f"{e['seq']:>8} {t:>12.3f} ms  {e['event']:<7} {addr:<12} len {e['len']:<5} "
+            f"{e['data']}{more}  {e['service']}"
+        )
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""
+Print the flash and RAM taken by the symbols of one or more binaries, and the largest functions.
+
+Built with -ffunction-sections -fdata-sections -Wl,--gc-sections (see //tools:footprint), so
+unreferenced functions are already gone. The totals include a few hundred bytes of C runtime
+(crt, libc stubs) that are not part of the library.
+
+bazel run //tools:footprint
+bazel run //tools:footprint -- --nm arm-none-eabi-nm --top 20 path/to/firmware.elf
+"""
+
+import argparse
+import subprocess
+from pathlib import Path
+
+# nm symbol type -> section group
+KINDS = {
+    "t": "text",
+    "w": "text",
+    "r": "rodata",
+    "d": "data",
+    "b": "bss",
+    "v": "data",
+}
+
+
+def symbols(nm, path):
+    out = subprocess.run(
+        [nm, "--print-size", "--size-sort", "--radix=d", path],
+        check=True,
+        capture_output=True,
+        text=True,
+    ).stdout
+    for line in out.splitlines():
+        fields = line.split()
+        if len(fields) < 4:
+            continue
+        _, size, kind, name = fields[:4]
+        group = KINDS.get(kind.lower())
+        if group:
+            yield group, int(size), name
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument("--nm", default="nm", help="nm of the toolchain that built the binaries")
+    parser.add_argument("--top", type=int, default=10, help="largest functions listed per binary")
+    parser.add_argument("binaries", nargs="+")
+    args = parser.parse_args()
+
+    print(f"{'binary':<32} {'text':>8} {'rodata':>8} {'data':>8} {'bss':>8} {'flash':>8} {'ram':>8}")
+    largest = {}
+    for path in args.binaries:
+        totals = {"text": 0, "rodata": 0, "data": 0, "bss": 0}
+        funcs = []
+        for group, size, name in symbols(args.nm, path):
+            totals[group] += size
+            if group == "text":
+                funcs.append((size, name))
+        flash = totals["text"] + totals["rodata"] + totals["data"]
+        ram = totals["data"] + totals["bss"]
+        print(
+            f"{Path(path).name:<32} {totals['text']:>8} {totals['rodata']:>8} {totals['data']:>8}"
+            f" {totals['bss']:>8} {flash:>8} {ram:>8}"
+        )
+        largest[path] = sorted(funcs, reverse=True)[: args.top]
+
+    for path, funcs in largest.items():
+        print(f"\n{Path(path).name}: largest functions")
+        for size, name in funcs:
+            print(f"  {size:>6} {name}")
+
+
+if __name__ == "__main__":
+    main()
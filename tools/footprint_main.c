@@ -0,0 +1,64 @@
+/**
+ * @file footprint_main.c
+ * @brief Smallest useful isotp-c server, linked once per build profile to measure the footprint
+ * @details The CAN driver and clock are stand-ins read through volatile variables so that the
+ * compiler cannot drop the paths a real driver would reach. Measure the result with
+ * tools/footprint.py.
+ */
+#include "src/iso14229.h"
+
+volatile uint32_t FootprintMillis;
+volatile uint32_t FootprintRxId;
+volatile uint8_t FootprintRxLen;
+volatile uint8_t FootprintRxData[8];
+volatile uint8_t FootprintTx[8];
+
+static UDSServer_t srv;
+static UDSISOTpC_t tp;
+
+uint32_t UDSMillis(void) { return FootprintMillis; }
+
+int isotp_user_send_can(const uint32_t arbitration_id, const uint8_t *data, const uint8_t size,
+                        void *user_data) {
+    (void)arbitration_id;
+    (void)user_data;
+    for (uint8_t i = 0; i < size && i < sizeof(FootprintTx); i++) {
+        FootprintTx[i] = data[i];
+    }
+    return ISOTP_RET_OK;
+}
+
+void isotp_user_debug(const char *message, ...) { (void)message; }
+
+uint32_t isotp_user_get_us(void) { return UDSMicros(); }
+
+static UDSErr_t fn(UDSServer_t *server, UDSEvent_t ev, void *arg) {
+    (void)server;
+    (void)ev;
+    (void)arg;
+    return UDS_PositiveResponse;
+}
+
+int main(void) {
+    UDSServerInit(&srv);
+    srv.fn = fn;
+    srv.tp = &tp.hdl;
+    UDSISOTpCInit(&tp, &(UDSISOTpCConfig_t){
+                           .source_addr = 0x7E8,
+                           .target_addr = 0x7E0,
+                           .source_addr_func = 0x7DF,
+                           .target_addr_func = UDS_TP_NOOP_ADDR,
+                       });
+    for (;;) {
+        uint8_t len = FootprintRxLen;
+        if (len > 0 && len <= 8) {
+            uint8_t data[8];
+            for (uint8_t i = 0; i < len; i++) {
+                data[i] = FootprintRxData[i];
+            }
+            UDSISOTpCOnFrame(&tp, FootprintRxId, data, len);
+            FootprintRxLen = 0;
+        }
+        UDSServerPoll(&srv);
+    }
+}
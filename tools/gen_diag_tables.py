@@ -0,0 +1,489 @@
+#!/usr/bin/env python3
+"""
+Generate the DID, routine and DTC tables of an ECU and the matching client codecs from one
+description, so that the server and the tester cannot drift apart.
+
+The description is JSON, or YAML if the file ends in .yaml/.yml and PyYAML is installed:
+
+    {
+      "prefix": "Demo",
+      "dids": [
+        {"name": "EngineState", "did": "0x0100", "access": "rw", "sessions": ["extended"],
+         "security": 1, "fields": [{"name": "rpm", "type": "u16"}, {"name": "temp", "type": "i8"}]},
+        {"name": "VIN", "did": "0xF190", "access": "r", "storage": "callback",
+         "fields": [{"name": "vin", "type": "bytes[17]"}]}
+      ],
+      "routines": [
+        {"name": "EraseMemory", "rid": "0xFF00", "ctrl": ["start", "results"],
+         "sessions": ["programming"], "security": 1, "handler": true,
+         "option": [{"name": "addr", "type": "u32"}], "status": [{"name": "result", "type": "u8"}]}
+      ],
+      "dtc_availability_mask": "0x09",
+      "dtcs": [{"name": "BatteryLow", "dtc": "0x912345"}]
+    }
+
+Field types are u8, u16, u24, u32, i8, i16, i32 and bytes[N], packed big endian without padding.
+Sessions are numbers or "default", "programming" and "extended". A DID with "storage": "record"
+(the default) is served with memcpy from <Prefix><Name>Record, which the application keeps up to
+date with <Prefix><Name>Encode(). "callback" DIDs call <Prefix><Name>Read/Write instead, and
+routines with "handler" call <Prefix><Name>Routine; the application defines those.
+
+Output, with every table sorted so that registration only has to verify the order:
+    - record layouts: <PREFIX>_<NAME>_DID, _LEN and _<FIELD>_OFFSET, a struct and Encode/Decode
+    - server: <Prefix>DIDs for UDSServerRegisterDIDs(), <Prefix>Routines for
+      UDSServerRegisterRoutines(), and <Prefix>DTCStoreInit()
+    - client: <Prefix>RDBISchema for UDSRDBIPlanInit() decoding into <Prefix>DIDValues_t,
+      <Prefix>Write<Name>() and <Prefix>Start<Name>()
+
+Usage: gen_diag_tables.py --out_c tables.c --out_h tables.h [--include iso14229.h] description
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+
+INT_TYPES = {
+    "u8": ("uint8_t", 1, False),
+    "u16": ("uint16_t", 2, False),
+    "u24": ("uint32_t", 3, False),
+    "u32": ("uint32_t", 4, False),
+    "i8": ("int8_t", 1, True),
+    "i16": ("int16_t", 2, True),
+    "i32": ("int32_t", 4, True),
+}
+
+SESSIONS = {
+    "default": "UDS_LEV_DS_DS",
+    "programming": "UDS_LEV_DS_PRGS",
+    "extended": "UDS_LEV_DS_EXTDS",
+}
+
+CTRL = {"start": "UDS_RID_START", "stop": "UDS_RID_STOP", "results": "UDS_RID_RESULTS"}
+
+
+def fail(msg):
+    sys.exit("gen_diag_tables: " + msg)
+
+
+def number(value, what):
+    try:
+        return int(value, 0) if isinstance(value, str) else int(value)
+    except (TypeError, ValueError):
+        fail("%s: not a number: %r" % (what, value))
+
+
+def snake(name):
+    """EngineState -> ENGINE_STATE, VIN -> VIN"""
+    s = re.sub(r"([a-z0-9])([A-Z])", r"\1_\2", name)
+    s = re.sub(r"([A-Z]+)([A-Z][a-z])", r"\1_\2", s)
+    return s.upper()
+
+
+def identifier(name, what):
+    if not re.fullmatch(r"[A-Za-z_][A-Za-z0-9_]*", str(name)):
+        fail("%s: %r is not a C identifier" % (what, name))
+    return name
+
+
+class Record:
+    """A data record made of fields packed big endian"""
+
+    def __init__(self, fields, what):
+        self.fields = []
+        offset = 0
+        for f in fields or []:
+            name = identifier(f.get("name"), what)
+            ftype = f.get("type", "")
+            m = re.fullmatch(r"bytes\[(\d+)\]", ftype)
+            if m:
+                size = int(m.group(1))
+                if size == 0:
+                    fail("%s.%s: empty bytes field" % (what, name))
+                self.fields.append((name, None, size, offset))
+            elif ftype in INT_TYPES:
+                size = INT_TYPES[ftype][1]
+                self.fields.append((name, ftype, size, offset))
+            else:
+                fail("%s.%s: unknown type %r" % (what, name, ftype))
+            offset += size
+        self.len = offset
+        if self.len > 0xFFFF:
+            fail("%s: record of %d bytes" % (what, self.len))
+
+    def struct(self, type_name):
+        lines = ["typedef struct {"]
+        for name, ftype, size, _ in self.fields:
+            if ftype is None:
+                lines.append("    uint8_t %s[%d];" % (name, size))
+            else:
+                lines.append("    %s %s;" % (INT_TYPES[ftype][0], name))
+        lines.append("} %s;" % type_name)
+        return lines
+
+    def encode(self, func, type_name, macro):
+        lines = ["static inline void %s(uint8_t *dst, const %s *v) {" % (func, type_name)]
+        for name, ftype, size, _ in self.fields:
+            off = "%s_%s_OFFSET" % (macro, snake(name))
+            if ftype is None:
+                lines.append("    memcpy(dst + %s, v->%s, %d);" % (off, name, size))
+                continue
+            for k in range(size):
+                shift = 8 * (size - 1 - k)
+                value = "(uint32_t)v->%s" % name
+                if shift:
+                    value = "(%s >> %d)" % (value, shift)
+                pos = off if k == 0 else "%s + %d" % (off, k)
+                lines.append("    dst[%s] = (uint8_t)%s;" % (pos, value))
+        lines.append("}")
+        return lines
+
+    def decode(self, func, type_name, macro):
+        lines = ["static inline void %s(%s *v, const uint8_t *src) {" % (func, type_name)]
+        for name, ftype, size, _ in self.fields:
+            off = "%s_%s_OFFSET" % (macro, snake(name))
+            if ftype is None:
+                lines.append("    memcpy(v->%s, src + %s, %d);" % (name, off, size))
+                continue
+            ctype, _, signed = INT_TYPES[ftype]
+            terms = []
+            for k in range(size):
+                shift = 8 * (size - 1 - k)
+                pos = off if k == 0 else "%s + %d" % (off, k)
+                term = "(uint32_t)src[%s]" % pos
+                terms.append("(%s << %d)" % (term, shift) if shift else term)
+            value = " | ".join(terms)
+            if signed:
+                value = "(%s)(u%s)(%s)" % (ctype, ctype, value)
+            else:
+                value = "(%s)(%s)" % (ctype, value)
+            lines.append("    v->%s = %s;" % (name, value))
+        lines.append("}")
+        return lines
+
+    def layout(self, macro):
+        return ["#define %s_%s_OFFSET %d" % (macro, snake(name), off)
+                for name, _, _, off in self.fields]
+
+
+def session_mask(sessions, what):
+    bits = []
+    for s in sessions or []:
+        if isinstance(s, str) and s in SESSIONS:
+            bits.append("UDS_SESSION_BIT(%s)" % SESSIONS[s])
+        else:
+            n = number(s, what + ".sessions")
+            if not 0x01 <= n <= 0x20:
+                fail("%s: session 0x%02X cannot be put in a session mask" % (what, n))
+            bits.append("UDS_SESSION_BIT(0x%02X)" % n)
+    return " | ".join(bits) if bits else "0"
+
+
+def security(entry, what):
+    level = number(entry.get("security", 0), what + ".security")
+    if not 0 <= level <= 0x7F:
+        fail("%s: security level 0x%X" % (what, level))
+    return level
+
+
+def sorted_unique(items, key, what):
+    items = sorted(items, key=lambda item: item[key])
+    for a, b in zip(items, items[1:]):
+        if a[key] == b[key]:
+            fail("duplicate %s 0x%X (%s, %s)" % (what, a[key], a["name"], b["name"]))
+    return items
+
+
+def load(path):
+    with open(path) as f:
+        if path.endswith((".yaml", ".yml")):
+            import yaml  # only needed for YAML descriptions
+
+            return yaml.safe_load(f)
+        return json.load(f)
+
+
+def generate(desc, include, header, source):
+    prefix = identifier(desc.get("prefix", ""), "prefix")
+    PREFIX = snake(prefix)
+    h = [
+        "// Generated by tools/gen_diag_tables.py from %s. Do not edit." % source,
+        "#pragma once",
+        "",
+        '#include "%s"' % include,
+        "#include <string.h>",
+        "",
+    ]
+    c = [
+        "// Generated by tools/gen_diag_tables.py from %s. Do not edit." % source,
+        '#include "%s"' % header,
+        "#include <stddef.h>",
+        "",
+    ]
+
+    def record_codec(rec, type_name, macro, func_base):
+        h.extend(rec.layout(macro))
+        h.append("")
+        h.extend(rec.struct(type_name))
+        h.append("")
+        h.extend(rec.encode(func_base + "Encode", type_name, macro))
+        h.append("")
+        h.extend(rec.decode(func_base + "Decode", type_name, macro))
+        h.append("")
+
+    # data identifiers
+    dids = []
+    for d in desc.get("dids", []):
+        name = identifier(d.get("name"), "did")
+        did = number(d.get("did"), name + ".did")
+        if not 0 <= did <= 0xFFFF:
+            fail("%s: DID 0x%X" % (name, did))
+        access = d.get("access", "r")
+        if access not in ("r", "w", "rw"):
+            fail("%s: access must be r, w or rw" % name)
+        storage = d.get("storage", "record")
+        if storage not in ("record", "callback"):
+            fail("%s: storage must be record or callback" % name)
+        rec = Record(d.get("fields"), name)
+        if rec.len == 0:
+            fail("%s: a DID needs at least one field" % name)
+        dids.append({
+            "name": name,
+            "did": did,
+            "access": access,
+            "storage": storage,
+            "rec": rec,
+            "sessions": session_mask(d.get("sessions"), name),
+            "security": security(d, name),
+            "cache_ms": number(d.get("cache_ms", 0), name + ".cache_ms"),
+        })
+    dids = sorted_unique(dids, "did", "DID")
+
+    for d in dids:
+        macro = "%s_%s" % (PREFIX, snake(d["name"]))
+        h.append("// DID 0x%04X %s" % (d["did"], d["name"]))
+        h.append("#define %s_DID 0x%04X" % (macro, d["did"]))
+        h.append("#define %s_LEN %d" % (macro, d["rec"].len))
+        record_codec(d["rec"], "%s%s_t" % (prefix, d["name"]), macro, prefix + d["name"])
+
+    readable = [d for d in dids if "r" in d["access"]]
+    if dids:
+        h.append("// server: UDSServerRegisterDIDs(srv, %sDIDs, %s_DID_COUNT)" % (prefix, PREFIX))
+        h.append("#define %s_DID_COUNT %d" % (PREFIX, len(dids)))
+        h.append("extern UDSDIDEntry_t %sDIDs[%s_DID_COUNT];" % (prefix, PREFIX))
+        for d in dids:
+            fn = prefix + d["name"]
+            macro = "%s_%s" % (PREFIX, snake(d["name"]))
+            if d["storage"] == "record":
+                h.append("extern uint8_t %sRecord[%s_LEN];" % (fn, macro))
+                c.append("uint8_t %sRecord[%s_LEN];" % (fn, macro))
+                continue
+            if "r" in d["access"]:
+                h.append("UDSErr_t %sRead(UDSServer_t *srv, const UDSDIDEntry_t *entry, "
+                         "uint8_t *dst);" % fn)
+            if "w" in d["access"]:
+                h.append("UDSErr_t %sWrite(UDSServer_t *srv, const UDSDIDEntry_t *entry, "
+                         "const uint8_t *src, uint16_t len);" % fn)
+        h.append("")
+        c.append("")
+        c.append("UDSDIDEntry_t %sDIDs[%s_DID_COUNT] = {" % (prefix, PREFIX))
+        for d in dids:
+            fn = prefix + d["name"]
+            macro = "%s_%s" % (PREFIX, snake(d["name"]))
+            access = " | ".join(a for a, k in (("UDS_DID_READ", "r"), ("UDS_DID_WRITE", "w"))
+                                if k in d["access"])
+            fields = [".did = %s_DID" % macro, ".len = %s_LEN" % macro]
+            if d["storage"] == "record":
+                fields.append(".ptr = %sRecord" % fn)
+            else:
+                if "r" in d["access"]:
+                    fields.append(".read = %sRead" % fn)
+                if "w" in d["access"]:
+                    fields.append(".write = %sWrite" % fn)
+            fields += [".access = " + access, ".sessionMask = " + d["sessions"],
+                       ".securityLevel = 0x%02X" % d["security"]]
+            if d["cache_ms"]:
+                fields.append(".cacheMs = %d" % d["cache_ms"])
+            c.append("    {%s}," % ", ".join(fields))
+        c.append("};")
+        c.append("")
+
+    if readable:
+        h.append("// client: UDSRDBIPlanInit(plan, %sRDBISchema, %s_RDBI_SCHEMA_LEN, &values, ...)"
+                 % (prefix, PREFIX))
+        h.append("typedef struct {")
+        for d in readable:
+            h.append("    %s%s_t %s;" % (prefix, d["name"], d["name"]))
+        h.append("} %sDIDValues_t;" % prefix)
+        h.append("")
+        h.append("#define %s_RDBI_SCHEMA_LEN %d" % (PREFIX, len(readable)))
+        h.append("extern const UDSRDBISchemaEntry_t %sRDBISchema[%s_RDBI_SCHEMA_LEN];"
+                 % (prefix, PREFIX))
+        for d in readable:
+            h.append("void *%s%sUnpack(void *dst, const void *src, size_t n);" % (prefix, d["name"]))
+        h.append("")
+        for d in readable:
+            fn = prefix + d["name"]
+            c.append("void *%sUnpack(void *dst, const void *src, size_t n) {" % fn)
+            c.append("    (void)n; // always %s_%s_LEN: the plan checks the length"
+                     % (PREFIX, snake(d["name"])))
+            c.append("    %sDecode((%s_t *)dst, (const uint8_t *)src);" % (fn, fn))
+            c.append("    return dst;")
+            c.append("}")
+            c.append("")
+        c.append("const UDSRDBISchemaEntry_t %sRDBISchema[%s_RDBI_SCHEMA_LEN] = {"
+                 % (prefix, PREFIX))
+        for d in readable:
+            fn = prefix + d["name"]
+            macro = "%s_%s" % (PREFIX, snake(d["name"]))
+            c.append("    {.did = %s_DID, .len = %s_LEN, .offset = offsetof(%sDIDValues_t, %s), "
+                     ".UnpackFn = %sUnpack}," % (macro, macro, prefix, d["name"], fn))
+        c.append("};")
+        c.append("")
+
+    for d in dids:
+        if "w" not in d["access"]:
+            continue
+        fn = prefix + d["name"]
+        macro = "%s_%s" % (PREFIX, snake(d["name"]))
+        h.append("static inline UDSErr_t %sWrite%s(UDSClient_t *client, const %s_t *v) {"
+                 % (prefix, d["name"], fn))
+        h.append("    uint8_t data[%s_LEN];" % macro)
+        h.append("    %sEncode(data, v);" % fn)
+        h.append("    return UDSSendWDBI(client, %s_DID, data, %s_LEN);" % (macro, macro))
+        h.append("}")
+        h.append("")
+
+    # routines
+    routines = []
+    for r in desc.get("routines", []):
+        name = identifier(r.get("name"), "routine")
+        rid = number(r.get("rid"), name + ".rid")
+        if not 0 <= rid <= 0xFFFF:
+            fail("%s: RID 0x%X" % (name, rid))
+        ctrl = r.get("ctrl", ["start"])
+        for k in ctrl:
+            if k not in CTRL:
+                fail("%s: ctrl must be start, stop and/or results" % name)
+        routines.append({
+            "name": name,
+            "rid": rid,
+            "ctrl": " | ".join(CTRL[k] for k in CTRL if k in ctrl),
+            "sessions": session_mask(r.get("sessions"), name),
+            "security": security(r, name),
+            "handler": bool(r.get("handler", False)),
+            "option": Record(r.get("option"), name + ".option"),
+            "status": Record(r.get("status"), name + ".status"),
+        })
+    routines = sorted_unique(routines, "rid", "RID")
+
+    for r in routines:
+        macro = "%s_%s" % (PREFIX, snake(r["name"]))
+        fn = prefix + r["name"]
+        h.append("// RID 0x%04X %s" % (r["rid"], r["name"]))
+        h.append("#define %s_RID 0x%04X" % (macro, r["rid"]))
+        h.append("#define %s_OPTION_LEN %d" % (macro, r["option"].len))
+        h.append("#define %s_STATUS_LEN %d" % (macro, r["status"].len))
+        if r["option"].fields:
+            record_codec(r["option"], fn + "Option_t", macro + "_OPTION", fn + "Option")
+        if r["status"].fields:
+            record_codec(r["status"], fn + "Status_t", macro + "_STATUS", fn + "Status")
+        if "UDS_RID_START" in r["ctrl"]:
+            if r["option"].fields:
+                h.append("static inline UDSErr_t %sStart%s(UDSClient_t *client, "
+                         "const %sOption_t *v) {" % (prefix, r["name"], fn))
+                h.append("    uint8_t data[%s_OPTION_LEN];" % macro)
+                h.append("    %sOptionEncode(data, v);" % fn)
+                h.append("    return UDSSendRoutineCtrl(client, UDS_LEV_RCTP_STR, %s_RID, data, "
+                         "sizeof(data));" % macro)
+            else:
+                h.append("static inline UDSErr_t %sStart%s(UDSClient_t *client) {"
+                         % (prefix, r["name"]))
+                h.append("    return UDSSendRoutineCtrl(client, UDS_LEV_RCTP_STR, %s_RID, NULL, 0);"
+                         % macro)
+            h.append("}")
+            h.append("")
+
+    if routines:
+        h.append("// server: UDSServerRegisterRoutines(srv, %sRoutines, %s_ROUTINE_COUNT)"
+                 % (prefix, PREFIX))
+        h.append("#define %s_ROUTINE_COUNT %d" % (PREFIX, len(routines)))
+        h.append("extern UDSRoutineEntry_t %sRoutines[%s_ROUTINE_COUNT];" % (prefix, PREFIX))
+        for r in routines:
+            if r["handler"]:
+                h.append("UDSErr_t %s%sRoutine(UDSServer_t *srv, const UDSRoutineEntry_t *entry, "
+                         "UDSRoutineCtrlArgs_t *args);" % (prefix, r["name"]))
+        h.append("")
+        c.append("UDSRoutineEntry_t %sRoutines[%s_ROUTINE_COUNT] = {" % (prefix, PREFIX))
+        for r in routines:
+            fields = [".rid = %s_%s_RID" % (PREFIX, snake(r["name"])), ".ctrl = " + r["ctrl"],
+                      ".sessionMask = " + r["sessions"], ".securityLevel = 0x%02X" % r["security"]]
+            if r["handler"]:
+                fields.append(".fn = %s%sRoutine" % (prefix, r["name"]))
+            c.append("    {%s}," % ", ".join(fields))
+        c.append("};")
+        c.append("")
+
+    # DTCs
+    dtcs = []
+    for d in desc.get("dtcs", []):
+        name = identifier(d.get("name"), "dtc")
+        dtc = number(d.get("dtc"), name + ".dtc")
+        if not 0 <= dtc <= 0xFFFFFF:
+            fail("%s: DTC 0x%X" % (name, dtc))
+        dtcs.append({"name": name, "dtc": dtc})
+    dtcs = sorted_unique(dtcs, "dtc", "DTC")
+
+    if dtcs:
+        mask = number(desc.get("dtc_availability_mask", "0xFF"), "dtc_availability_mask")
+        for d in dtcs:
+            h.append("#define %s_DTC_%s 0x%06XU" % (PREFIX, snake(d["name"]), d["dtc"]))
+        h.append("#define %s_DTC_COUNT %d" % (PREFIX, len(dtcs)))
+        h.append("#define %s_DTC_AVAILABILITY_MASK 0x%02X" % (PREFIX, mask))
+        h.append("extern UDSDTCRecord_t %sDTCRecords[%s_DTC_COUNT];" % (prefix, PREFIX))
+        h.append("")
+        h.append("// server: %sDTCStoreInit(&store), then UDSServerRegisterDTCStore(srv, &store)"
+                 % prefix)
+        h.append("UDSErr_t %sDTCStoreInit(UDSDTCStore_t *store);" % prefix)
+        h.append("")
+        c.append("UDSDTCRecord_t %sDTCRecords[%s_DTC_COUNT] = {" % (prefix, PREFIX))
+        for d in dtcs:
+            b = d["dtc"]
+            c.append("    {.dtc = {0x%02X, 0x%02X, 0x%02X}}, // %s"
+                     % (b >> 16, (b >> 8) & 0xFF, b & 0xFF, d["name"]))
+        c.append("};")
+        c.append("")
+        c.append("static uint32_t %sDTCBitmaps[UDS_DTC_BITMAP_SIZE(%s_DTC_COUNT)];"
+                 % (prefix, PREFIX))
+        c.append("")
+        c.append("UDSErr_t %sDTCStoreInit(UDSDTCStore_t *store) {" % prefix)
+        c.append("    return UDSDTCStoreInit(store, %sDTCRecords, %s_DTC_COUNT, %sDTCBitmaps,"
+                 % (prefix, PREFIX, prefix))
+        c.append("                           %s_DTC_AVAILABILITY_MASK);" % PREFIX)
+        c.append("}")
+        c.append("")
+
+    if not (dids or routines or dtcs):
+        fail("the description has no dids, routines or dtcs")
+    return "\n".join(h).rstrip("\n") + "\n", "\n".join(c).rstrip("\n") + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="generate DID, routine and DTC tables")
+    parser.add_argument("--out_c", required=True, help="output c file")
+    parser.add_argument("--out_h", required=True, help="output h file")
+    parser.add_argument("--include", default="iso14229.h", help="header of the library")
+    parser.add_argument("description", help="JSON or YAML description")
+    args = parser.parse_args()
+
+    out_h, out_c = generate(load(args.description), args.include, os.path.basename(args.out_h),
+                            os.path.basename(args.description))
+    with open(args.out_h, "w") as f:
+        f.write(out_h)
+    with open(args.out_c, "w") as f:
+        f.write(out_c)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,1155 @@
+/**
+ * @file uds_decode.c
+ * @brief Offline ISO-TP reassembly and UDS request/response pairing for CAN captures
+ * @details The capture is mapped into memory and decoded in two passes:
+ * 1. the file is split into chunks that are indexed in parallel. Every frame is assigned to a
+ *    shard by its conversation (a request ID and its response ID always share a shard) and only
+ *    its file offset is kept. Functional requests go to every shard.
+ * 2. each shard is decoded by its own thread, in file order: ISO-TP messages are reassembled per
+ *    CAN ID, requests are paired with the responses on the matching response ID, and every
+ *    exchange becomes one output line.
+ * The lines of all shards are then written out ordered by request time.
+ *
+ * Reassembly is passive: no flow control is sent and any number of concurrent streams is
+ * reassembled with one buffer per stream that has a multi-frame message in progress.
+ *
+ * Pairing follows normal addressing by default: an 11-bit request ID with bit 3 clear is answered
+ * on ID + 8 (0x7E0 -> 0x7E8), a 29-bit normal fixed ID 0x18DA<TA><SA> on 0x18DA<SA><TA>. 0x7DF and
+ * 0x18DB<TA><SA> are functional and are paired with every response that follows within the
+ * timeout. Use --pair and --func for other schemes.
+ *
+ * Input formats:
+ * - candump log files (`candump -l`): `(1700000000.123456) can0 7E0#0210030000000000`, CAN FD as
+ *   `7E0##<flags><data>`
+ * - pcap files with LINKTYPE_CAN_SOCKETCAN, either byte order, micro- or nanosecond timestamps
+ *
+ * Usage: uds_decode [-j THREADS] [--csv] [--pair REQ:RESP]... [--func ID]...
+ *                   [--timeout MS] [--max-bytes N] [--quiet] CAPTURE
+ *
+ * Output (one JSON object per line, or CSV with --csv):
+ *   t, req_id, resp_id, sid, service, result (positive, negative, no_response, suppressed,
+ *   unsolicited), nrc, nrc_name, latency_us, rcrrp, req_len, resp_len, req, resp
+ * A summary with frame and message counts and the decoding rate is printed to stderr.
+ */
+#include "src/iso14229.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ID_EXT 0x80000000U /* 29-bit identifier, as in SocketCAN's CAN_EFF_FLAG */
+#define ID_RTR 0x40000000U
+#define ID_ERR 0x20000000U
+#define ID_MASK 0x1FFFFFFFU
+#define KEY_BROADCAST 0xFFFFFFFFU
+#define NO_ID 0xFFFFFFFFU
+
+#define MAX_THREADS 64
+#define MAX_PAIRS 64
+#define MAX_FUNC 16
+#define MAX_FUNC_PENDING 8
+#define MAX_FRAME_LEN 64
+#define MAX_MSG_LEN 65536 /* longer FF_DL are counted as errors and skipped */
+#define MAX_BYTES_LIMIT 4096
+#define LINE_MAX_LEN (256 + 4 * MAX_BYTES_LIMIT)
+
+#define PCAP_MAGIC_US 0xA1B2C3D4U
+#define PCAP_MAGIC_NS 0xA1B23C4DU
+#define LINKTYPE_CAN_SOCKETCAN 227
+
+typedef enum {
+    FORMAT_CANDUMP,
+    FORMAT_PCAP,
+} Format_t;
+
+typedef struct {
+    const uint8_t *base;
+    size_t size;
+    Format_t format;
+    bool swap;  /* pcap written with the other byte order */
+    bool nsec;  /* pcap timestamps in nanoseconds */
+    size_t first; /* offset of the first record */
+} Capture_t;
+
+typedef struct {
+    uint64_t ts_ns;
+    uint32_t id; /* identifier with ID_EXT */
+    uint8_t len;
+    const uint8_t *data;
+    uint8_t buf[MAX_FRAME_LEN]; /* data of text formats */
+} Frame_t;
+
+typedef struct {
+    uint32_t req;
+    uint32_t resp;
+} Pair_t;
+
+typedef struct {
+    Pair_t pairs[MAX_PAIRS];
+    int numPairs;
+    uint32_t func[MAX_FUNC];
+    int numFunc;
+    uint64_t timeout_ns;
+    unsigned maxBytes;
+    bool csv;
+    bool quiet;
+    int threads;
+} Config_t;
+
+typedef enum {
+    RESULT_POSITIVE,
+    RESULT_NEGATIVE,
+    RESULT_NO_RESPONSE,
+    RESULT_SUPPRESSED,
+    RESULT_UNSOLICITED,
+    RESULT_MAX,
+} Result_t;
+
+static const char *ResultName[] = {"positive", "negative", "no_response", "suppressed",
+                                   "unsolicited"};
+
+/* a request waiting for its response */
+typedef struct {
+    bool active;
+    uint32_t id;
+    uint64_t ts_ns;
+    uint64_t seq;     /* functional requests: order, so a stream answers each one once */
+    uint16_t rcrrp;   /* 0x78 responses seen */
+    uint32_t len;     /* full request length */
+    uint8_t *data;    /* first maxBytes of the request */
+} Pending_t;
+
+/* reassembly state of one CAN ID */
+typedef struct {
+    uint32_t id; /* NO_ID if the slot is free */
+    bool receiving;
+    uint8_t sn;
+    uint32_t total;
+    uint32_t got;
+    uint64_t ts_ns; /* time of the first frame of the message */
+    uint8_t *buf;
+    uint32_t cap;
+    Pending_t pending; /* physical request answered on this ID */
+    uint64_t funcSeq;  /* last functional request answered on this ID */
+} Stream_t;
+
+typedef struct {
+    uint64_t *v;
+    size_t n;
+    size_t cap;
+} Vec_t;
+
+typedef struct {
+    uint64_t ts_ns;
+    uint64_t resp_ts_ns; /* orders the answers to one functional request */
+    uint64_t off;
+    uint32_t len;
+    uint16_t shard;
+} Line_t;
+
+typedef struct {
+    uint64_t frames;
+    uint64_t messages;
+    uint64_t results[RESULT_MAX];
+    uint64_t isotpErrors;
+    uint64_t malformed;
+} Counters_t;
+
+struct Decoder;
+
+typedef struct {
+    struct Decoder *dec;
+    int index;
+    Stream_t *streams;
+    size_t streamCap; /* power of two */
+    size_t streamCount;
+    Pending_t func[MAX_FUNC_PENDING];
+    uint64_t funcSeq;
+    char *text;
+    size_t textLen;
+    size_t textCap;
+    Line_t *lines;
+    size_t lineCount;
+    size_t lineCap;
+    Counters_t counters;
+} Shard_t;
+
+typedef struct {
+    struct Decoder *dec;
+    size_t start;
+    size_t end;
+    Vec_t refs[MAX_THREADS]; /* record offsets per shard */
+    uint64_t malformed;
+} Chunk_t;
+
+typedef struct Decoder {
+    const Config_t *cfg;
+    Capture_t cap;
+    Chunk_t *chunks;
+    int numChunks;
+    Shard_t shards[MAX_THREADS];
+    int numShards;
+} Decoder_t;
+
+static void *XRealloc(void *p, size_t size) {
+    void *r = realloc(p, size);
+    if (NULL == r) {
+        fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    return r;
+}
+
+static void VecPush(Vec_t *vec, uint64_t x) {
+    if (vec->n == vec->cap) {
+        vec->cap = vec->cap ? 2 * vec->cap : 1024;
+        vec->v = XRealloc(vec->v, vec->cap * sizeof(vec->v[0]));
+    }
+    vec->v[vec->n++] = x;
+}
+
+static uint32_t Rd32(const Capture_t *cap, const uint8_t *p) {
+    uint32_t x;
+    memcpy(&x, p, sizeof(x));
+    return cap->swap ? __builtin_bswap32(x) : x;
+}
+
+/* ------------------------------------------------------------------------------------------ */
+/* capture parsing                                                                             */
+/* ------------------------------------------------------------------------------------------ */
+
+static int HexVal(uint8_t c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+static int OpenCapture(Capture_t *cap, const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size <= 0) {
+        fprintf(stderr, "%s: empty or unreadable\n", path);
+        close(fd);
+        return -1;
+    }
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (MAP_FAILED == base) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    posix_madvise(base, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+    memset(cap, 0, sizeof(*cap));
+    cap->base = base;
+    cap->size = (size_t)st.st_size;
+
+    uint32_t magic = 0;
+    if (cap->size >= 24) {
+        memcpy(&magic, cap->base, sizeof(magic));
+    }
+    if (PCAP_MAGIC_US == magic || PCAP_MAGIC_NS == magic) {
+        cap->format = FORMAT_PCAP;
+    } else if (__builtin_bswap32(PCAP_MAGIC_US) == magic ||
+               __builtin_bswap32(PCAP_MAGIC_NS) == magic) {
+        cap->format = FORMAT_PCAP;
+        cap->swap = true;
+    } else if ('(' == cap->base[0]) {
+        cap->format = FORMAT_CANDUMP;
+        return 0;
+    } else {
+        fprintf(stderr, "%s: not a candump log or pcap file (pcapng and BLF are not supported)\n",
+                path);
+        return -1;
+    }
+    cap->nsec = PCAP_MAGIC_NS == Rd32(cap, cap->base);
+    uint32_t linktype = Rd32(cap, cap->base + 20);
+    if (LINKTYPE_CAN_SOCKETCAN != linktype) {
+        fprintf(stderr, "%s: pcap link type %" PRIu32 " is not LINKTYPE_CAN_SOCKETCAN\n", path,
+                linktype);
+        return -1;
+    }
+    cap->first = 24;
+    return 0;
+}
+
+/* offset of the record at or after `pos` and of the one after it. False at the end */
+static bool NextRecord(const Capture_t *cap, size_t *pos, size_t end, size_t *rec) {
+    if (*pos >= end) {
+        return false;
+    }
+    if (FORMAT_PCAP == cap->format) {
+        if (*pos + 16 > cap->size) {
+            return false;
+        }
+        uint32_t incl = Rd32(cap, cap->base + *pos + 8);
+        *rec = *pos;
+        *pos += 16 + (size_t)incl;
+        return true;
+    }
+    const uint8_t *nl = memchr(cap->base + *pos, '\n', cap->size - *pos);
+    *rec = *pos;
+    *pos = nl ? (size_t)(nl - cap->base) + 1 : cap->size;
+    return true;
+}
+
+/* parse a candump log line: `(sec.frac) iface ID#DATA` or `ID##FDATA` */
+static bool ParseCandump(const Capture_t *cap, size_t rec, Frame_t *f, bool idOnly) {
+    const uint8_t *p = cap->base + rec;
+    const uint8_t *end = cap->base + cap->size;
+    if (p >= end || '(' != *p) {
+        return false;
+    }
+    p++;
+    uint64_t sec = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        sec = sec * 10 + (uint64_t)(*p++ - '0');
+    }
+    uint64_t frac = 0;
+    uint64_t scale = 1000000000ULL;
+    if (p < end && '.' == *p) {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (scale > 1) {
+                scale /= 10;
+                frac += (uint64_t)(*p - '0') * scale;
+            }
+            p++;
+        }
+    }
+    f->ts_ns = sec * 1000000000ULL + frac;
+    while (p < end && ' ' != *p) {
+        p++;
+    }
+    while (p < end && ' ' == *p) {
+        p++;
+    }
+    while (p < end && ' ' != *p) { // interface
+        p++;
+    }
+    while (p < end && ' ' == *p) {
+        p++;
+    }
+    uint32_t id = 0;
+    int digits = 0;
+    int h;
+    while (p < end && (h = HexVal(*p)) >= 0) {
+        id = (id << 4) | (uint32_t)h;
+        digits++;
+        p++;
+    }
+    if (0 == digits || p >= end || '#' != *p) {
+        return false;
+    }
+    p++;
+    if (digits > 3) {
+        if (id & ID_ERR) {
+            return false;
+        }
+        id = (id & ID_MASK) | ID_EXT;
+    }
+    f->id = id;
+    bool fd = false;
+    if (p < end && '#' == *p) {
+        fd = true;
+        p += 2; // flags nibble
+    } else if (p < end && 'R' == *p) {
+        return false;
+    }
+    if (idOnly) {
+        return true;
+    }
+    uint8_t len = 0;
+    int hi, lo;
+    while (p + 1 < end && (hi = HexVal(p[0])) >= 0 && (lo = HexVal(p[1])) >= 0) {
+        if (len == (fd ? MAX_FRAME_LEN : 8)) {
+            return false;
+        }
+        f->buf[len++] = (uint8_t)((hi << 4) | lo);
+        p += 2;
+        if (p < end && '.' == *p) { // separators as accepted by cansend
+            p++;
+        }
+    }
+    f->len = len;
+    f->data = f->buf;
+    return true;
+}
+
+/* parse a pcap record of LINKTYPE_CAN_SOCKETCAN. The CAN ID is big endian in that link type */
+static bool ParsePcap(const Capture_t *cap, size_t rec, Frame_t *f, bool idOnly) {
+    const uint8_t *hdr = cap->base + rec;
+    uint32_t incl = Rd32(cap, hdr + 8);
+    if (rec + 16 + incl > cap->size || incl < 8) {
+        return false;
+    }
+    const uint8_t *pkt = hdr + 16;
+    uint32_t id = (uint32_t)pkt[0] << 24 | (uint32_t)pkt[1] << 16 | (uint32_t)pkt[2] << 8 | pkt[3];
+    if (id & (ID_RTR | ID_ERR)) {
+        return false;
+    }
+    f->id = (id & ID_EXT) ? ((id & ID_MASK) | ID_EXT) : (id & 0x7FF);
+    uint64_t sec = Rd32(cap, hdr);
+    uint64_t sub = Rd32(cap, hdr + 4);
+    f->ts_ns = sec * 1000000000ULL + (cap->nsec ? sub : sub * 1000ULL);
+    if (idOnly) {
+        return true;
+    }
+    uint8_t len = pkt[4];
+    if (len > MAX_FRAME_LEN || 8U + len > incl) {
+        return false;
+    }
+    f->len = len;
+    f->data = pkt + 8;
+    return true;
+}
+
+static bool ParseRecord(const Capture_t *cap, size_t rec, Frame_t *f, bool idOnly) {
+    return FORMAT_PCAP == cap->format ? ParsePcap(cap, rec, f, idOnly)
+                                      : ParseCandump(cap, rec, f, idOnly);
+}
+
+/* ------------------------------------------------------------------------------------------ */
+/* addressing                                                                                  */
+/* ------------------------------------------------------------------------------------------ */
+
+static bool IsNormalFixed(uint32_t id, uint32_t pf) {
+    return (id & ID_EXT) && ((id & ID_MASK) >> 16) == pf;
+}
+
+static bool IsFunctional(const Config_t *cfg, uint32_t id) {
+    if (0x7DF == id || IsNormalFixed(id, 0x18DB)) {
+        return true;
+    }
+    for (int i = 0; i < cfg->numFunc; i++) {
+        if (cfg->func[i] == id) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* ID a physical request on `id` is answered on, or NO_ID */
+static uint32_t ResponseId(const Config_t *cfg, uint32_t id) {
+    for (int i = 0; i < cfg->numPairs; i++) {
+        if (cfg->pairs[i].req == id) {
+            return cfg->pairs[i].resp;
+        }
+    }
+    if (!(id & ID_EXT)) {
+        return (id & 0x8) ? NO_ID : id + 8;
+    }
+    if (IsNormalFixed(id, 0x18DA)) {
+        return (id & 0xFFFF0000U) | ((id & 0xFF) << 8) | ((id >> 8) & 0xFF);
+    }
+    return NO_ID;
+}
+
+/* whether a response on `id` may answer the functional request on `func` */
+static bool AnswersFunctional(uint32_t func, uint32_t id) {
+    if (IsNormalFixed(func, 0x18DB)) {
+        return IsNormalFixed(id, 0x18DA) && ((id >> 8) & 0xFF) == (func & 0xFF);
+    }
+    if (0x7DF == func) {
+        return id >= 0x7E8 && id <= 0x7EF;
+    }
+    return (func & ID_EXT) == (id & ID_EXT);
+}
+
+/* frames of a request and of its response share a key, and so a shard */
+static uint32_t ConversationKey(const Config_t *cfg, uint32_t id) {
+    if (IsFunctional(cfg, id)) {
+        return KEY_BROADCAST;
+    }
+    for (int i = 0; i < cfg->numPairs; i++) {
+        if (cfg->pairs[i].req == id || cfg->pairs[i].resp == id) {
+            return cfg->pairs[i].req;
+        }
+    }
+    if (!(id & ID_EXT)) {
+        return id & ~0x8U;
+    }
+    if (IsNormalFixed(id, 0x18DA)) {
+        uint32_t ta = (id >> 8) & 0xFF;
+        uint32_t sa = id & 0xFF;
+        return (id & 0xFFFF0000U) | (ta < sa ? ta << 8 | sa : sa << 8 | ta);
+    }
+    return id;
+}
+
+static unsigned ShardOf(uint32_t key, int numShards) {
+    uint32_t h = key * 0x9E3779B1U;
+    return (h >> 16) % (unsigned)numShards;
+}
+
+/* ------------------------------------------------------------------------------------------ */
+/* output                                                                                      */
+/* ------------------------------------------------------------------------------------------ */
+
+static char *Reserve(Shard_t *sh, size_t n) {
+    if (sh->textLen + n > sh->textCap) {
+        sh->textCap = sh->textCap ? 2 * sh->textCap : (1 << 20);
+        while (sh->textLen + n > sh->textCap) {
+            sh->textCap *= 2;
+        }
+        sh->text = XRealloc(sh->text, sh->textCap);
+    }
+    return sh->text + sh->textLen;
+}
+
+static char *PutHex(char *p, const uint8_t *data, uint32_t len) {
+    static const char digits[] = "0123456789ABCDEF";
+    for (uint32_t i = 0; i < len; i++) {
+        *p++ = digits[data[i] >> 4];
+        *p++ = digits[data[i] & 0xF];
+    }
+    return p;
+}
+
+static int FormatId(char *dst, uint32_t id) {
+    if (NO_ID == id) {
+        return 0;
+    }
+    return (id & ID_EXT) ? sprintf(dst, "%08" PRIX32, id & ID_MASK)
+                         : sprintf(dst, "%03" PRIX32, id);
+}
+
+/* append one exchange. `req` or `resp` may be NULL */
+static void Emit(Shard_t *sh, Result_t result, const Pending_t *req, uint32_t respId,
+                 uint64_t resp_ts, const uint8_t *resp, uint32_t respLen) {
+    const Config_t *cfg = sh->dec->cfg;
+    char *line = Reserve(sh, LINE_MAX_LEN);
+    char *p = line;
+    char reqId[16] = "", rspId[16] = "", sid[4] = "", nrc[4] = "", lat[24] = "";
+    const char *nrcName = "";
+    uint8_t s = req ? (req->len ? req->data[0] : 0) : resp[0];
+    uint64_t ts = req ? req->ts_ns : resp_ts;
+
+    FormatId(reqId, req ? req->id : NO_ID);
+    FormatId(rspId, resp ? respId : NO_ID);
+    if (req ? req->len > 0 : respLen > 0) {
+        if (!req && 0x7F == s && respLen >= 2) {
+            s = resp[1];
+        } else if (!req && 0x7F != s) {
+            s &= (uint8_t)~0x40;
+        }
+        sprintf(sid, "%02X", s);
+    }
+    if (RESULT_NEGATIVE == result || (RESULT_UNSOLICITED == result && respLen >= 3 &&
+                                      0x7F == resp[0])) {
+        sprintf(nrc, "%02X", resp[2]);
+        nrcName = UDSErrToStr((UDSErr_t)resp[2]);
+    }
+    if (req && resp) {
+        sprintf(lat, "%" PRIu64, (resp_ts - req->ts_ns) / 1000);
+    }
+    uint32_t reqLen = req ? req->len : 0;
+    uint32_t reqShown = reqLen < cfg->maxBytes ? reqLen : cfg->maxBytes;
+    uint32_t respShown = respLen < cfg->maxBytes ? respLen : cfg->maxBytes;
+    const char *service = sid[0] ? UDSSIDToStr(s) : "";
+    unsigned rcrrp = req ? req->rcrrp : 0;
+    uint64_t sec = ts / 1000000000U;
+    uint64_t usec = ts % 1000000000U / 1000U;
+
+    if (cfg->csv) {
+        p += sprintf(p, "%" PRIu64 ".%06" PRIu64 ",%s,%s,%s,%s,%s,%s,%s,%s,%u,%" PRIu32 ",%" PRIu32
+                        ",",
+                     sec, usec, reqId, rspId, sid, service, ResultName[result], nrc, nrcName, lat,
+                     rcrrp, reqLen, respLen);
+        p = PutHex(p, req ? req->data : NULL, reqShown);
+        *p++ = ',';
+        p = PutHex(p, resp, respShown);
+        *p++ = '\n';
+    } else {
+        p += sprintf(p, "{\"t\":%" PRIu64 ".%06" PRIu64, sec, usec);
+        if (reqId[0]) {
+            p += sprintf(p, ",\"req_id\":\"%s\"", reqId);
+        }
+        if (rspId[0]) {
+            p += sprintf(p, ",\"resp_id\":\"%s\"", rspId);
+        }
+        if (sid[0]) {
+            p += sprintf(p, ",\"sid\":\"%s\",\"service\":\"%s\"", sid, service);
+        }
+        p += sprintf(p, ",\"result\":\"%s\"", ResultName[result]);
+        if (nrc[0]) {
+            p += sprintf(p, ",\"nrc\":\"%s\",\"nrc_name\":\"%s\"", nrc, nrcName);
+        }
+        if (lat[0]) {
+            p += sprintf(p, ",\"latency_us\":%s", lat);
+        }
+        if (rcrrp) {
+            p += sprintf(p, ",\"rcrrp\":%u", rcrrp);
+        }
+        if (req) {
+            p += sprintf(p, ",\"req_len\":%" PRIu32 ",\"req\":\"", reqLen);
+            p = PutHex(p, req->data, reqShown);
+            *p++ = '"';
+        }
+        if (resp) {
+            p += sprintf(p, ",\"resp_len\":%" PRIu32 ",\"resp\":\"", respLen);
+            p = PutHex(p, resp, respShown);
+            *p++ = '"';
+        }
+        *p++ = '}';
+        *p++ = '\n';
+    }
+
+    if (sh->lineCount == sh->lineCap) {
+        sh->lineCap = sh->lineCap ? 2 * sh->lineCap : 4096;
+        sh->lines = XRealloc(sh->lines, sh->lineCap * sizeof(sh->lines[0]));
+    }
+    sh->lines[sh->lineCount++] = (Line_t){
+        .ts_ns = ts,
+        .resp_ts_ns = resp_ts,
+        .off = sh->textLen,
+        .len = (uint32_t)(p - line),
+        .shard = (uint16_t)sh->index,
+    };
+    sh->textLen += (size_t)(p - line);
+    sh->counters.results[result]++;
+}
+
+/* ------------------------------------------------------------------------------------------ */
+/* pairing                                                                                     */
+/* ------------------------------------------------------------------------------------------ */
+
+static bool HasSubfunction(uint8_t sid) {
+    switch (sid) {
+    case 0x10: case 0x11: case 0x19: case 0x27: case 0x28: case 0x29: case 0x2C:
+    case 0x31: case 0x3E: case 0x83: case 0x85: case 0x86: case 0x87:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static void PendingSet(Pending_t *pend, const Config_t *cfg, uint32_t id, uint64_t ts,
+                       const uint8_t *data, uint32_t len) {
+    // SID and subfunction are kept even if less is printed
+    uint32_t keep = cfg->maxBytes > 2 ? cfg->maxBytes : 2;
+    if (NULL == pend->data) {
+        pend->data = XRealloc(NULL, keep);
+    }
+    pend->active = true;
+    pend->id = id;
+    pend->ts_ns = ts;
+    pend->rcrrp = 0;
+    pend->len = len;
+    memcpy(pend->data, data, len < keep ? len : keep);
+}
+
+/* a physical request that got no response */
+static void PendingExpire(Shard_t *sh, Pending_t *pend) {
+    if (!pend->active) {
+        return;
+    }
+    bool suppressed = pend->len >= 2 && HasSubfunction(pend->data[0]) && (pend->data[1] & 0x80);
+    Emit(sh, suppressed ? RESULT_SUPPRESSED : RESULT_NO_RESPONSE, pend, NO_ID, 0, NULL, 0);
+    pend->active = false;
+}
+
+static bool Answers(const Pending_t *pend, const uint8_t *resp, uint32_t len) {
+    uint8_t sid = pend->data[0];
+    if (0x7F == resp[0]) {
+        return len >= 3 && resp[1] == sid;
+    }
+    return resp[0] == (uint8_t)(sid | 0x40);
+}
+
+static Stream_t *GetStream(Shard_t *sh, uint32_t id);
+
+static void OnRequest(Shard_t *sh, uint32_t id, uint64_t ts, const uint8_t *msg, uint32_t len) {
+    const Config_t *cfg = sh->dec->cfg;
+    if (IsFunctional(cfg, id)) {
+        // the oldest functional request is replaced
+        Pending_t *slot = &sh->func[0];
+        for (int i = 0; i < MAX_FUNC_PENDING; i++) {
+            if (!sh->func[i].active || sh->func[i].id == id) {
+                slot = &sh->func[i];
+                break;
+            }
+            if (sh->func[i].ts_ns < slot->ts_ns) {
+                slot = &sh->func[i];
+            }
+        }
+        PendingSet(slot, cfg, id, ts, msg, len);
+        slot->seq = ++sh->funcSeq;
+        return;
+    }
+    uint32_t respId = ResponseId(cfg, id);
+    if (NO_ID == respId) {
+        Pending_t tmp = {0};
+        PendingSet(&tmp, cfg, id, ts, msg, len);
+        Emit(sh, RESULT_NO_RESPONSE, &tmp, NO_ID, 0, NULL, 0);
+        free(tmp.data);
+        return;
+    }
+    Stream_t *st = GetStream(sh, respId);
+    PendingExpire(sh, &st->pending);
+    PendingSet(&st->pending, cfg, id, ts, msg, len);
+}
+
+static void OnResponse(Shard_t *sh, Stream_t *st, uint64_t ts, const uint8_t *msg,
+                       uint32_t len) {
+    const Config_t *cfg = sh->dec->cfg;
+    bool rcrrp = len >= 3 && 0x7F == msg[0] &&
+                 UDS_NRC_RequestCorrectlyReceived_ResponsePending == msg[2];
+    Result_t result = 0x7F == msg[0] ? RESULT_NEGATIVE : RESULT_POSITIVE;
+
+    Pending_t *pend = &st->pending;
+    if (pend->active && ts - pend->ts_ns > cfg->timeout_ns * (pend->rcrrp + 1)) {
+        PendingExpire(sh, pend);
+    }
+    if (pend->active && pend->len && Answers(pend, msg, len)) {
+        if (rcrrp) {
+            pend->rcrrp++;
+            return;
+        }
+        Emit(sh, result, pend, st->id, ts, msg, len);
+        pend->active = false;
+        return;
+    }
+    for (int i = 0; i < MAX_FUNC_PENDING; i++) {
+        Pending_t *f = &sh->func[i];
+        if (f->active && f->seq > st->funcSeq && f->len && AnswersFunctional(f->id, st->id) &&
+            ts - f->ts_ns <= cfg->timeout_ns && Answers(f, msg, len)) {
+            if (rcrrp) {
+                return;
+            }
+            st->funcSeq = f->seq;
+            Emit(sh, result, f, st->id, ts, msg, len);
+            return;
+        }
+    }
+    Emit(sh, RESULT_UNSOLICITED, NULL, st->id, ts, msg, len);
+}
+
+static void OnMessage(Shard_t *sh, Stream_t *st, uint64_t ts, const uint8_t *msg, uint32_t len) {
+    if (0 == sh->index || !IsFunctional(sh->dec->cfg, st->id)) { // every shard sees those
+        sh->counters.messages++;
+    }
+    if (0 == len) {
+        return;
+    }
+    if (0x7F == msg[0] || (msg[0] & 0x40)) {
+        OnResponse(sh, st, ts, msg, len);
+    } else {
+        OnRequest(sh, st->id, ts, msg, len);
+    }
+}
+
+/* ------------------------------------------------------------------------------------------ */
+/* reassembly                                                                                  */
+/* ------------------------------------------------------------------------------------------ */
+
+static size_t StreamSlot(const Shard_t *sh, uint32_t id) {
+    size_t mask = sh->streamCap - 1;
+    size_t i = (size_t)(id * 0x9E3779B1U) & mask;
+    while (NO_ID != sh->streams[i].id && sh->streams[i].id != id) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static Stream_t *GetStream(Shard_t *sh, uint32_t id) {
+    size_t i = StreamSlot(sh, id);
+    if (sh->streams[i].id == id) {
+        return &sh->streams[i];
+    }
+    if (2 * (sh->streamCount + 1) > sh->streamCap) {
+        Stream_t *old = sh->streams;
+        size_t oldCap = sh->streamCap;
+        sh->streamCap *= 2;
+        sh->streams = XRealloc(NULL, sh->streamCap * sizeof(Stream_t));
+        for (size_t j = 0; j < sh->streamCap; j++) {
+            sh->streams[j].id = NO_ID;
+        }
+        for (size_t j = 0; j < oldCap; j++) {
+            if (NO_ID != old[j].id) {
+                sh->streams[StreamSlot(sh, old[j].id)] = old[j];
+            }
+        }
+        free(old);
+        i = StreamSlot(sh, id);
+    }
+    memset(&sh->streams[i], 0, sizeof(Stream_t));
+    sh->streams[i].id = id;
+    sh->streamCount++;
+    return &sh->streams[i];
+}
+
+static void OnFrame(Shard_t *sh, const Frame_t *f) {
+    if (0 == sh->index || !IsFunctional(sh->dec->cfg, f->id)) {
+        sh->counters.frames++;
+    }
+    if (0 == f->len) {
+        return;
+    }
+    const uint8_t *d = f->data;
+    Stream_t *st = GetStream(sh, f->id);
+    switch (d[0] >> 4) {
+    case 0: { // single frame
+        uint32_t len = d[0] & 0xF;
+        uint32_t off = 1;
+        if (0 == len && f->len > 8) { // CAN FD escape
+            len = f->len > 1 ? d[1] : 0;
+            off = 2;
+        }
+        if (st->receiving) {
+            sh->counters.isotpErrors++; // interrupted multi-frame message
+            st->receiving = false;
+        }
+        if (0 == len || off + len > f->len) {
+            sh->counters.isotpErrors++;
+            return;
+        }
+        OnMessage(sh, st, f->ts_ns, d + off, len);
+        return;
+    }
+    case 1: { // first frame
+        uint32_t total = ((uint32_t)(d[0] & 0xF) << 8) | (f->len > 1 ? d[1] : 0);
+        uint32_t off = 2;
+        if (0 == total && f->len >= 6) { // FF_DL > 4095
+            total = (uint32_t)d[2] << 24 | (uint32_t)d[3] << 16 | (uint32_t)d[4] << 8 | d[5];
+            off = 6;
+        }
+        if (st->receiving) {
+            sh->counters.isotpErrors++;
+        }
+        st->receiving = false;
+        if (total > MAX_MSG_LEN || total < f->len - off || f->len < off) {
+            sh->counters.isotpErrors++;
+            return;
+        }
+        if (st->cap < total) {
+            st->buf = XRealloc(st->buf, total);
+            st->cap = total;
+        }
+        st->total = total;
+        st->got = f->len - off;
+        memcpy(st->buf, d + off, st->got);
+        st->sn = 1;
+        st->ts_ns = f->ts_ns;
+        st->receiving = true;
+        return;
+    }
+    case 2: { // consecutive frame
+        if (!st->receiving) {
+            sh->counters.isotpErrors++;
+            return;
+        }
+        if ((d[0] & 0xF) != st->sn) {
+            sh->counters.isotpErrors++;
+            st->receiving = false;
+            return;
+        }
+        st->sn = (st->sn + 1) & 0xF;
+        uint32_t n = f->len - 1U;
+        if (n > st->total - st->got) {
+            n = st->total - st->got; // padding
+        }
+        memcpy(st->buf + st->got, d + 1, n);
+        st->got += n;
+        if (st->got == st->total) {
+            st->receiving = false;
+            // the message is timed by its last frame, as a receiver would see it
+            OnMessage(sh, st, f->ts_ns, st->buf, st->total);
+        }
+        return;
+    }
+    case 3: // flow control
+        return;
+    default:
+        sh->counters.isotpErrors++;
+        return;
+    }
+}
+
+/* ------------------------------------------------------------------------------------------ */
+/* threads                                                                                     */
+/* ------------------------------------------------------------------------------------------ */
+
+static void *IndexChunk(void *arg) {
+    Chunk_t *chunk = arg;
+    Decoder_t *dec = chunk->dec;
+    Frame_t f;
+    size_t pos = chunk->start;
+    size_t rec;
+    while (NextRecord(&dec->cap, &pos, chunk->end, &rec)) {
+        if (!ParseRecord(&dec->cap, rec, &f, true)) {
+            chunk->malformed++;
+            continue;
+        }
+        uint32_t key = ConversationKey(dec->cfg, f.id);
+        if (KEY_BROADCAST == key) {
+            for (int s = 0; s < dec->numShards; s++) {
+                VecPush(&chunk->refs[s], rec);
+            }
+        } else {
+            VecPush(&chunk->refs[ShardOf(key, dec->numShards)], rec);
+        }
+    }
+    return NULL;
+}
+
+static void ShardFinish(Shard_t *sh) {
+    for (size_t i = 0; i < sh->streamCap; i++) {
+        Stream_t *st = &sh->streams[i];
+        if (NO_ID == st->id) {
+            continue;
+        }
+        PendingExpire(sh, &st->pending);
+        free(st->pending.data);
+        free(st->buf);
+    }
+    for (int i = 0; i < MAX_FUNC_PENDING; i++) {
+        free(sh->func[i].data);
+    }
+    free(sh->streams);
+    sh->streams = NULL;
+}
+
+static void *DecodeShard(void *arg) {
+    Shard_t *sh = arg;
+    Decoder_t *dec = sh->dec;
+    Frame_t f;
+    for (int c = 0; c < dec->numChunks; c++) {
+        const Vec_t *refs = &dec->chunks[c].refs[sh->index];
+        for (size_t i = 0; i < refs->n; i++) {
+            if (ParseRecord(&dec->cap, (size_t)refs->v[i], &f, false)) {
+                OnFrame(sh, &f);
+            } else {
+                sh->counters.malformed++;
+            }
+        }
+    }
+    ShardFinish(sh);
+    return NULL;
+}
+
+static int CompareLines(const void *a, const void *b) {
+    const Line_t *x = a, *y = b;
+    if (x->ts_ns != y->ts_ns) {
+        return x->ts_ns < y->ts_ns ? -1 : 1;
+    }
+    if (x->resp_ts_ns != y->resp_ts_ns) {
+        return x->resp_ts_ns < y->resp_ts_ns ? -1 : 1;
+    }
+    if (x->shard != y->shard) {
+        return x->shard < y->shard ? -1 : 1;
+    }
+    return x->off < y->off ? -1 : (x->off > y->off);
+}
+
+static double Now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int Decode(Decoder_t *dec) {
+    const Config_t *cfg = dec->cfg;
+    dec->numShards = cfg->threads;
+    // only text captures can be split at arbitrary offsets
+    dec->numChunks = FORMAT_CANDUMP == dec->cap.format ? cfg->threads : 1;
+    dec->chunks = calloc((size_t)dec->numChunks, sizeof(Chunk_t));
+    pthread_t threads[MAX_THREADS];
+
+    size_t span = (dec->cap.size - dec->cap.first) / (size_t)dec->numChunks;
+    size_t start = dec->cap.first;
+    for (int c = 0; c < dec->numChunks; c++) {
+        size_t end = c == dec->numChunks - 1 ? dec->cap.size : start + span;
+        if (end < dec->cap.size) {
+            const uint8_t *nl = memchr(dec->cap.base + end, '\n', dec->cap.size - end);
+            end = nl ? (size_t)(nl - dec->cap.base) + 1 : dec->cap.size;
+        }
+        dec->chunks[c].start = start;
+        dec->chunks[c].end = end;
+        dec->chunks[c].dec = dec;
+        start = end;
+    }
+    for (int c = 0; c < dec->numChunks; c++) {
+        pthread_create(&threads[c], NULL, IndexChunk, &dec->chunks[c]);
+    }
+    for (int c = 0; c < dec->numChunks; c++) {
+        pthread_join(threads[c], NULL);
+    }
+
+    for (int s = 0; s < dec->numShards; s++) {
+        Shard_t *sh = &dec->shards[s];
+        sh->dec = dec;
+        sh->index = s;
+        sh->streamCap = 1024;
+        sh->streams = XRealloc(NULL, sh->streamCap * sizeof(Stream_t));
+        for (size_t i = 0; i < sh->streamCap; i++) {
+            sh->streams[i].id = NO_ID;
+        }
+        pthread_create(&threads[s], NULL, DecodeShard, sh);
+    }
+    for (int s = 0; s < dec->numShards; s++) {
+        pthread_join(threads[s], NULL);
+    }
+    return 0;
+}
+
+static void Write(Decoder_t *dec) {
+    size_t total = 0;
+    for (int s = 0; s < dec->numShards; s++) {
+        total += dec->shards[s].lineCount;
+    }
+    Line_t *all = XRealloc(NULL, (total ? total : 1) * sizeof(Line_t));
+    size_t n = 0;
+    for (int s = 0; s < dec->numShards; s++) {
+        memcpy(&all[n], dec->shards[s].lines, dec->shards[s].lineCount * sizeof(Line_t));
+        n += dec->shards[s].lineCount;
+    }
+    qsort(all, total, sizeof(Line_t), CompareLines);
+
+    if (dec->cfg->csv) {
+        fputs("t,req_id,resp_id,sid,service,result,nrc,nrc_name,latency_us,rcrrp,req_len,resp_len,"
+              "req,resp\n",
+              stdout);
+    }
+    static char out[1 << 16];
+    setvbuf(stdout, out, _IOFBF, sizeof(out));
+    for (size_t i = 0; i < total; i++) {
+        fwrite(dec->shards[all[i].shard].text + all[i].off, 1, all[i].len, stdout);
+    }
+    fflush(stdout);
+    free(all);
+}
+
+static bool ParseId(const char *s, uint32_t *id) {
+    char *end;
+    unsigned long x = strtoul(s, &end, 16);
+    if (end == s || x > ID_MASK) {
+        return false;
+    }
+    *id = end - s > 3 ? ((uint32_t)x | ID_EXT) : (uint32_t)x;
+    return true;
+}
+
+static void Usage(void) {
+    fprintf(stderr, "usage: uds_decode [-j THREADS] [--csv] [--pair REQ:RESP]... [--func ID]...\n"
+                    "                  [--timeout MS] [--max-bytes N] [--quiet] CAPTURE\n"
+                    "IDs are hexadecimal. IDs of more than 3 digits are 29-bit.\n");
+}
+
+int main(int ac, char **av) {
+    static Config_t cfg = {
+        .timeout_ns = 5000ULL * 1000000ULL,
+        .maxBytes = 32,
+    };
+    const char *path = NULL;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    cfg.threads = ncpu > 0 ? (int)ncpu : 1;
+
+    for (int i = 1; i < ac; i++) {
+        const char *arg = av[i];
+        const char *val = i + 1 < ac ? av[i + 1] : NULL;
+        if (0 == strcmp(arg, "-j") && val) {
+            cfg.threads = atoi(val);
+            i++;
+        } else if (0 == strcmp(arg, "--csv")) {
+            cfg.csv = true;
+        } else if (0 == strcmp(arg, "--quiet")) {
+            cfg.quiet = true;
+        } else if (0 == strcmp(arg, "--pair") && val && cfg.numPairs < MAX_PAIRS) {
+            char req[32];
+            const char *colon = strchr(val, ':');
+            if (NULL == colon || (size_t)(colon - val) >= sizeof(req)) {
+                Usage();
+                return EXIT_FAILURE;
+            }
+            memcpy(req, val, (size_t)(colon - val));
+            req[colon - val] = '\0';
+            Pair_t *pair = &cfg.pairs[cfg.numPairs++];
+            if (!ParseId(req, &pair->req) || !ParseId(colon + 1, &pair->resp)) {
+                Usage();
+                return EXIT_FAILURE;
+            }
+            i++;
+        } else if (0 == strcmp(arg, "--func") && val && cfg.numFunc < MAX_FUNC) {
+            if (!ParseId(val, &cfg.func[cfg.numFunc++])) {
+                Usage();
+                return EXIT_FAILURE;
+            }
+            i++;
+        } else if (0 == strcmp(arg, "--timeout") && val) {
+            cfg.timeout_ns = strtoull(val, NULL, 10) * 1000000ULL;
+            i++;
+        } else if (0 == strcmp(arg, "--max-bytes") && val) {
+            cfg.maxBytes = (unsigned)atoi(val);
+            i++;
+        } else if ('-' != arg[0] && NULL == path) {
+            path = arg;
+        } else {
+            Usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (NULL == path || cfg.maxBytes > MAX_BYTES_LIMIT) {
+        Usage();
+        return EXIT_FAILURE;
+    }
+    if (cfg.threads < 1) {
+        cfg.threads = 1;
+    }
+    if (cfg.threads > MAX_THREADS) {
+        cfg.threads = MAX_THREADS;
+    }
+
+    static Decoder_t dec;
+    dec.cfg = &cfg;
+    if (OpenCapture(&dec.cap, path)) {
+        return EXIT_FAILURE;
+    }
+    double t0 = Now();
+    Decode(&dec);
+    double t1 = Now();
+    Write(&dec);
+
+    if (!cfg.quiet) {
+        Counters_t sum = {0};
+        for (int c = 0; c < dec.numChunks; c++) {
+            sum.malformed += dec.chunks[c].malformed;
+        }
+        for (int s = 0; s < dec.numShards; s++) {
+            const Counters_t *c = &dec.shards[s].counters;
+            sum.frames += c->frames;
+            sum.messages += c->messages;
+            sum.isotpErrors += c->isotpErrors;
+            sum.malformed += c->malformed;
+            for (int r = 0; r < RESULT_MAX; r++) {
+                sum.results[r] += c->results[r];
+            }
+        }
+        double secs = t1 - t0 > 1e-9 ? t1 - t0 : 1e-9;
+        fprintf(stderr,
+                "%" PRIu64 " frames, %" PRIu64 " messages, %" PRIu64 " skipped records, %" PRIu64
+                " ISO-TP errors\n",
+                sum.frames, sum.messages, sum.malformed, sum.isotpErrors);
+        for (int r = 0; r < RESULT_MAX; r++) {
+            fprintf(stderr, "%s: %" PRIu64 "\n", ResultName[r], sum.results[r]);
+        }
+        fprintf(stderr, "decoded in %.3f s on %d threads, %.0f frames/s\n", secs, dec.numShards,
+                (double)sum.frames / secs);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,509 @@
+/**
+ * @file vcan_bench.c
+ * @brief End-to-end benchmark of the Linux ISO-TP transports on a vcan interface
+ * @details A server and a client run in one process and talk over the interface, first on the
+ * kernel ISO-TP transport (isotp_sock) and then on the userspace isotp-c transport
+ * (isotp_c_socketcan). For every flow control given with --bs and --stmin it measures
+ * - the request/response latency of 0x3E and of a 0x22 with a multi-frame response (p50, p99,
+ *   p999)
+ * - the sustained 0x36 throughput for every block length given with --block, and the CPU time
+ *   (user + system, from getrusage) spent per MB transferred
+ *
+ * The flow control is the one the server sends while it receives 0x36 blocks. The loop sleeps in
+ * poll() on the sockets of both transports except while the isotp-c sender has consecutive frames
+ * to send, since isotp-c paces them from userspace. Kernel time spent in softirq context is not
+ * always accounted to the process, so the CPU figure of isotp_sock is a lower bound.
+ *
+ * Usage: vcan_bench [--if NAME] [--transport sock,c] [--bs LIST] [--stmin LIST] [--block LIST]
+ *                   [--iterations N] [--kb N] [--json FILE]
+ *
+ * STmin is given as sent on the bus: 0x00-0x7F milliseconds, 0xF1-0xF9 100-900 microseconds.
+ */
+#include "src/iso14229.h"
+#include <linux/can/isotp.h>
+#include <net/if.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SERVER_SA 0x7E0
+#define CLIENT_SA 0x7E8
+#define FUNC_SA 0x7DF
+#define NUM_DIDS 32
+#define DID_LEN 4
+#define MAX_LIST 8
+#define MAX_RESULTS 256
+#define TIMEOUT_MS 5000
+
+typedef enum {
+    TRANSPORT_SOCK,
+    TRANSPORT_C,
+} Transport_t;
+
+static const char *TransportName[] = {"isotp_sock", "isotp_c_socketcan"};
+
+typedef struct {
+    Transport_t transport;
+    UDSTpIsoTpSock_t sock_srv;
+    UDSTpIsoTpSock_t sock_client;
+    UDSTpISOTpC_t c_srv;
+    UDSTpISOTpC_t c_client;
+    IsoTpFlowControlParams fc; /* flow control of the isotp-c server */
+    UDSServer_t srv;
+    UDSClient_t client;
+    uint16_t blockLength; /* maxNumberOfBlockLength returned to 0x34 */
+} Bench_t;
+
+typedef struct {
+    char name[64];
+    Transport_t transport;
+    uint8_t bs;
+    uint8_t stmin;
+    uint16_t block;     /* 0 for latency results */
+    uint64_t count;     /* requests */
+    double p50_us;
+    double p99_us;
+    double p999_us;
+    double mb_per_s;     /* 0x36 only */
+    double cpu_s_per_mb; /* 0x36 only */
+} Result_t;
+
+typedef struct {
+    unsigned values[MAX_LIST];
+    int n;
+} List_t;
+
+static uint64_t NowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static double CPUSeconds(void) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (double)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) +
+           (double)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+static UDSErr_t ServerFn(UDSServer_t *srv, UDSEvent_t ev, void *arg) {
+    Bench_t *b = (Bench_t *)srv->fn_data;
+    switch (ev) {
+    case UDS_EVT_ReadDataByIdent: {
+        UDSRDBIArgs_t *r = (UDSRDBIArgs_t *)arg;
+        const uint8_t value[DID_LEN] = {(uint8_t)(r->dataId >> 8), (uint8_t)r->dataId, 0xA5, 0x5A};
+        return r->copy(srv, value, sizeof(value));
+    }
+    case UDS_EVT_RequestDownload: {
+        UDSRequestDownloadArgs_t *r = (UDSRequestDownloadArgs_t *)arg;
+        r->maxNumberOfBlockLength = b->blockLength;
+        return UDS_PositiveResponse;
+    }
+    default:
+        return UDS_PositiveResponse;
+    }
+}
+
+/**
+ * @brief Replace the physical socket of the isotp_sock server with one that sends the given flow
+ * control. The kernel only accepts CAN_ISOTP_RECV_FC before the socket is bound.
+ */
+static int SockRebind(UDSTpIsoTpSock_t *tp, const char *ifname, uint8_t bs, uint8_t stmin) {
+    int fd = socket(AF_CAN, SOCK_DGRAM | SOCK_NONBLOCK, CAN_ISOTP);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    struct can_isotp_fc_options fcopts = {.bs = bs, .stmin = stmin, .wftmax = 0};
+    if (setsockopt(fd, SOL_CAN_ISOTP, CAN_ISOTP_RECV_FC, &fcopts, sizeof(fcopts)) < 0) {
+        perror("setsockopt");
+        close(fd);
+        return -1;
+    }
+    struct sockaddr_can addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family = AF_CAN;
+    addr.can_addr.tp.rx_id = tp->phys_sa;
+    addr.can_addr.tp.tx_id = tp->phys_ta;
+    addr.can_ifindex = (int)if_nametoindex(ifname);
+    close(tp->phys_fd);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("bind");
+        close(fd);
+        return -1;
+    }
+    tp->phys_fd = fd;
+    return 0;
+}
+
+static uint32_t STminUs(uint8_t stmin) {
+    if (stmin <= 0x7F) {
+        return stmin * 1000U;
+    }
+    if (stmin >= 0xF1 && stmin <= 0xF9) {
+        return (stmin - 0xF0) * 100U;
+    }
+    return 0x7F * 1000U; // reserved values are treated as the maximum
+}
+
+static void CFlowControl(const IsoTpLink *link, IsoTpFlowControlParams *fc, void *arg) {
+    (void)link;
+    const IsoTpFlowControlParams *want = (const IsoTpFlowControlParams *)arg;
+    fc->block_size = want->block_size;
+    fc->st_min_us = want->st_min_us;
+}
+
+static int BenchInit(Bench_t *b, Transport_t transport, const char *ifname, uint8_t bs,
+                     uint8_t stmin) {
+    memset(b, 0, sizeof(*b));
+    b->transport = transport;
+    UDSServerInit(&b->srv);
+    UDSClientInit(&b->client);
+    b->srv.fn = ServerFn;
+    b->srv.fn_data = b;
+    // the server would otherwise hold each response until p2 has passed since the last one
+    b->srv.p2_ms = 0;
+
+    if (TRANSPORT_SOCK == transport) {
+        if (UDSTpIsoTpSockInitServer(&b->sock_srv, ifname, SERVER_SA, CLIENT_SA, FUNC_SA) ||
+            UDSTpIsoTpSockInitClient(&b->sock_client, ifname, CLIENT_SA, SERVER_SA, FUNC_SA) ||
+            SockRebind(&b->sock_srv, ifname, bs, stmin)) {
+            return -1;
+        }
+        // the loop below waits in poll() itself
+        b->sock_srv.poll_timeout_ms = 0;
+        b->sock_client.poll_timeout_ms = 0;
+        b->srv.tp = &b->sock_srv.hdl;
+        b->client.tp = &b->sock_client.hdl;
+    } else {
+        if (UDSTpISOTpCInit(&b->c_srv, ifname, SERVER_SA, CLIENT_SA, FUNC_SA, 0) ||
+            UDSTpISOTpCInit(&b->c_client, ifname, CLIENT_SA, SERVER_SA, 0, FUNC_SA)) {
+            return -1;
+        }
+        b->fc.block_size = bs;
+        b->fc.st_min_us = STminUs(stmin);
+        isotp_set_flow_control(&b->c_srv.phys_link, CFlowControl, &b->fc);
+        b->srv.tp = &b->c_srv.hdl;
+        b->client.tp = &b->c_client.hdl;
+    }
+    return 0;
+}
+
+static void BenchFree(Bench_t *b) {
+    if (TRANSPORT_SOCK == b->transport) {
+        UDSTpIsoTpSockDeinit(&b->sock_srv);
+        UDSTpIsoTpSockDeinit(&b->sock_client);
+    } else {
+        UDSTpISOTpCDeinit(&b->c_srv);
+        UDSTpISOTpCDeinit(&b->c_client);
+    }
+}
+
+static void Wait(Bench_t *b) {
+    struct pollfd fds[4];
+    int n = 0;
+    int timeout_ms = 1;
+    if (TRANSPORT_SOCK == b->transport) {
+        n += UDSTpIsoTpSockPollFds(&b->sock_srv, &fds[n]);
+        n += UDSTpIsoTpSockPollFds(&b->sock_client, &fds[n]);
+    } else {
+        fds[n++] = (struct pollfd){.fd = b->c_srv.fd, .events = POLLIN};
+        fds[n++] = (struct pollfd){.fd = b->c_client.fd, .events = POLLIN};
+        if (ISOTP_SEND_STATUS_INPROGRESS == b->c_srv.phys_link.send_status ||
+            ISOTP_SEND_STATUS_INPROGRESS == b->c_client.phys_link.send_status) {
+            timeout_ms = 0;
+        }
+    }
+    (void)poll(fds, (nfds_t)n, timeout_ms);
+}
+
+/**
+ * @brief Send one request and run both ends until it is answered
+ * @return length of the positive response, or -1
+ */
+static int Exchange(Bench_t *b, const uint8_t *req, uint16_t len) {
+    if (UDSSendBytes(&b->client, req, len)) {
+        return -1;
+    }
+    uint32_t deadline = UDSMillis() + TIMEOUT_MS;
+    while (UDSTimeAfter(deadline, UDSMillis())) {
+        UDSServerPoll(&b->srv);
+        if (UDSClientPoll(&b->client)) {
+            return -1;
+        }
+        if (0 == b->client.state) {
+            return b->client.recv_size;
+        }
+        Wait(b);
+    }
+    return -1;
+}
+
+static int CompareU64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static double Percentile(const uint64_t *sorted, uint64_t n, double p) {
+    uint64_t i = (uint64_t)(p * (double)(n - 1) + 0.5);
+    return (double)sorted[i] / 1000.0;
+}
+
+static int RunLatency(Bench_t *b, const char *name, const uint8_t *req, uint16_t len,
+                      uint64_t iterations, Result_t *r) {
+    uint64_t *ns = calloc(iterations, sizeof(*ns));
+    if (NULL == ns) {
+        return -1;
+    }
+    for (uint64_t i = 0; i < iterations; i++) {
+        uint64_t start = NowNs();
+        if (Exchange(b, req, len) <= 0) {
+            (void)fprintf(stderr, "%s: request failed\n", name);
+            free(ns);
+            return -1;
+        }
+        ns[i] = NowNs() - start;
+    }
+    qsort(ns, iterations, sizeof(*ns), CompareU64);
+    (void)snprintf(r->name, sizeof(r->name), "%s", name);
+    r->count = iterations;
+    r->p50_us = Percentile(ns, iterations, 0.50);
+    r->p99_us = Percentile(ns, iterations, 0.99);
+    r->p999_us = Percentile(ns, iterations, 0.999);
+    free(ns);
+    return 0;
+}
+
+static int RunDownload(Bench_t *b, uint16_t block, uint32_t kb, Result_t *r) {
+    static const uint8_t req34[] = {0x34, 0x00, 0x44, 0x00, 0x00, 0x00, 0x00,
+                                    0x7F, 0xFF, 0xFF, 0xFF};
+    b->blockLength = block;
+    if (Exchange(b, req34, sizeof(req34)) <= 0) {
+        (void)fprintf(stderr, "0x34: request failed\n");
+        return -1;
+    }
+
+    static uint8_t req[UDS_TP_MTU];
+    req[0] = 0x36;
+    req[1] = 0;
+    uint64_t total = (uint64_t)kb * 1024ULL;
+    uint64_t bytes = 0;
+    uint64_t count = 0;
+    double cpu = CPUSeconds();
+    uint64_t start = NowNs();
+    while (bytes < total) {
+        req[1]++; // blockSequenceCounter
+        if (Exchange(b, req, block) <= 0) {
+            (void)fprintf(stderr, "0x36 %u: request failed\n", block);
+            return -1;
+        }
+        bytes += (uint64_t)block - 2;
+        count++;
+    }
+    double elapsed = (double)(NowNs() - start) / 1e9;
+    cpu = CPUSeconds() - cpu;
+
+    uint8_t req37[] = {0x37};
+    (void)Exchange(b, req37, sizeof(req37));
+
+    double mb = (double)bytes / 1e6;
+    (void)snprintf(r->name, sizeof(r->name), "0x36_TransferData_%u", block);
+    r->block = block;
+    r->count = count;
+    r->mb_per_s = mb / elapsed;
+    r->cpu_s_per_mb = cpu / mb;
+    return 0;
+}
+
+static int ParseList(const char *s, List_t *list) {
+    list->n = 0;
+    char *end = NULL;
+    while (*s) {
+        if (list->n == MAX_LIST) {
+            return -1;
+        }
+        list->values[list->n++] = (unsigned)strtoul(s, &end, 0);
+        if (end == s || (*end && *end != ',')) {
+            return -1;
+        }
+        s = *end ? end + 1 : end;
+    }
+    return list->n ? 0 : -1;
+}
+
+static int ParseTransports(const char *s, List_t *list) {
+    list->n = 0;
+    while (*s) {
+        size_t len = strcspn(s, ",");
+        if (list->n == MAX_LIST) {
+            return -1;
+        } else if (4 == len && 0 == strncmp(s, "sock", len)) {
+            list->values[list->n++] = TRANSPORT_SOCK;
+        } else if (1 == len && 'c' == *s) {
+            list->values[list->n++] = TRANSPORT_C;
+        } else {
+            return -1;
+        }
+        s += s[len] ? len + 1 : len;
+    }
+    return list->n ? 0 : -1;
+}
+
+static void Print(const Result_t *r) {
+    if (r->block) {
+        printf("%-18s bs=%-3u stmin=0x%02x %-26s %8llu blocks %10.3f MB/s %10.4f cpu s/MB\n",
+               TransportName[r->transport], r->bs, r->stmin, r->name,
+               (unsigned long long)r->count, r->mb_per_s, r->cpu_s_per_mb);
+    } else {
+        printf("%-18s bs=%-3u stmin=0x%02x %-26s p50 %9.1f us  p99 %9.1f us  p999 %9.1f us\n",
+               TransportName[r->transport], r->bs, r->stmin, r->name, r->p50_us, r->p99_us,
+               r->p999_us);
+    }
+}
+
+static void WriteJSON(FILE *f, const char *ifname, const Result_t *results, int n) {
+    (void)fprintf(f,
+                  "{\n  \"context\": {\"library\": \"iso14229\", \"version\": \"%s\", "
+                  "\"interface\": \"%s\"},\n",
+                  UDS_LIB_VERSION, ifname);
+    (void)fprintf(f, "  \"benchmarks\": [\n");
+    for (int i = 0; i < n; i++) {
+        const Result_t *r = &results[i];
+        (void)fprintf(f,
+                      "    {\"transport\": \"%s\", \"name\": \"%s\", \"bs\": %u, \"stmin\": %u, "
+                      "\"block\": %u, \"count\": %llu, \"p50_us\": %.1f, \"p99_us\": %.1f, "
+                      "\"p999_us\": %.1f, \"mb_per_s\": %.3f, \"cpu_s_per_mb\": %.4f}%s\n",
+                      TransportName[r->transport], r->name, r->bs, r->stmin, r->block,
+                      (unsigned long long)r->count, r->p50_us, r->p99_us, r->p999_us,
+                      r->mb_per_s, r->cpu_s_per_mb, i + 1 < n ? "," : "");
+    }
+    (void)fprintf(f, "  ]\n}\n");
+}
+
+static int Usage(const char *prog) {
+    (void)fprintf(stderr,
+                  "usage: %s [--if NAME] [--transport sock,c] [--bs LIST] [--stmin LIST]\n"
+                  "          [--block LIST] [--iterations N] [--kb N] [--json FILE]\n",
+                  prog);
+    return 2;
+}
+
+int main(int ac, char **av) {
+    const char *ifname = "vcan0";
+    const char *json_path = NULL;
+    List_t transports = {.values = {TRANSPORT_SOCK, TRANSPORT_C}, .n = 2};
+    List_t bs = {.values = {0, 8}, .n = 2};
+    List_t stmin = {.values = {0}, .n = 1};
+    List_t blocks = {.values = {256, 1024, 4095}, .n = 3};
+    uint64_t iterations = 1000;
+    uint32_t kb = 256;
+
+    for (int i = 1; i < ac; i++) {
+        const char *opt = av[i];
+        const char *val = i + 1 < ac ? av[++i] : NULL;
+        if (NULL == val) {
+            return Usage(av[0]);
+        } else if (0 == strcmp(opt, "--if")) {
+            ifname = val;
+        } else if (0 == strcmp(opt, "--json")) {
+            json_path = val;
+        } else if (0 == strcmp(opt, "--transport")) {
+            if (ParseTransports(val, &transports)) {
+                return Usage(av[0]);
+            }
+        } else if (0 == strcmp(opt, "--bs")) {
+            if (ParseList(val, &bs)) {
+                return Usage(av[0]);
+            }
+        } else if (0 == strcmp(opt, "--stmin")) {
+            if (ParseList(val, &stmin)) {
+                return Usage(av[0]);
+            }
+        } else if (0 == strcmp(opt, "--block")) {
+            if (ParseList(val, &blocks)) {
+                return Usage(av[0]);
+            }
+        } else if (0 == strcmp(opt, "--iterations")) {
+            iterations = strtoull(val, NULL, 0);
+        } else if (0 == strcmp(opt, "--kb")) {
+            kb = (uint32_t)strtoul(val, NULL, 0);
+        } else {
+            return Usage(av[0]);
+        }
+    }
+    if (0 == transports.n || 0 == iterations || 0 == kb) {
+        return Usage(av[0]);
+    }
+    for (int i = 0; i < blocks.n; i++) {
+        if (blocks.values[i] < 3 || blocks.values[i] > UDS_TP_MTU) {
+            (void)fprintf(stderr, "block length must be between 3 and %d\n", UDS_TP_MTU);
+            return 2;
+        }
+    }
+
+    uint8_t rdbi[1 + 2 * NUM_DIDS] = {0x22};
+    for (int i = 0; i < NUM_DIDS; i++) {
+        rdbi[1 + 2 * i] = 0xF1;
+        rdbi[2 + 2 * i] = (uint8_t)(0x80 + i);
+    }
+    static const uint8_t tester_present[] = {0x3E, 0x00};
+
+    static Result_t results[MAX_RESULTS];
+    int n = 0;
+    static Bench_t b;
+    for (int t = 0; t < transports.n; t++) {
+        for (int i = 0; i < bs.n; i++) {
+            for (int j = 0; j < stmin.n; j++) {
+                if (n + 2 + blocks.n > MAX_RESULTS) {
+                    (void)fprintf(stderr, "too many combinations\n");
+                    return 2;
+                }
+                Transport_t transport = (Transport_t)transports.values[t];
+                if (BenchInit(&b, transport, ifname, (uint8_t)bs.values[i],
+                              (uint8_t)stmin.values[j])) {
+                    (void)fprintf(stderr, "%s: cannot open %s\n", TransportName[transport],
+                                  ifname);
+                    return 1;
+                }
+                Result_t *first = &results[n];
+                if (RunLatency(&b, "0x3E_TesterPresent", tester_present, sizeof(tester_present),
+                               iterations, &results[n++]) ||
+                    RunLatency(&b, "0x22_RDBI_32_DIDs", rdbi, sizeof(rdbi), iterations,
+                               &results[n++])) {
+                    BenchFree(&b);
+                    return 1;
+                }
+                for (int k = 0; k < blocks.n; k++) {
+                    if (RunDownload(&b, (uint16_t)blocks.values[k], kb, &results[n++])) {
+                        BenchFree(&b);
+                        return 1;
+                    }
+                }
+                BenchFree(&b);
+                for (Result_t *r = first; r < &results[n]; r++) {
+                    r->transport = transport;
+                    r->bs = (uint8_t)bs.values[i];
+                    r->stmin = (uint8_t)stmin.values[j];
+                    Print(r);
+                }
+            }
+        }
+    }
+
+    if (json_path) {
+        FILE *f = fopen(json_path, "w");
+        if (NULL == f) {
+            (void)fprintf(stderr, "cannot open %s\n", json_path);
+            return 1;
+        }
+        WriteJSON(f, ifname, results, n);
+        (void)fclose(f);
+    }
+    return 0;
+}